@@ -0,0 +1,182 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "audio_a2dp_hw/include/audio_a2dp_hw_pcm_ring.h"
+
+using ::benchmark::State;
+
+namespace {
+
+// 48 kHz, 16 bits, stereo
+constexpr size_t kBytesPerSecond = 48000 * 4;
+// What AudioFlinger writes at a time, and what the SBC encoder reads
+constexpr size_t kWriteSize = 3840;
+constexpr size_t kReadSize = 512;
+constexpr size_t kBufferSize = 2 * kWriteSize;
+constexpr int kTimeoutMs = 1000;
+
+uint64_t NowNs(clockid_t clock) {
+  struct timespec ts;
+  clock_gettime(clock, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// The audio data socket, written to as skt_write() does and read from as
+// UIPC_Read() does.
+class SocketLoopback {
+ public:
+  SocketLoopback() {
+    socketpair(AF_LOCAL, SOCK_STREAM, 0, fds_);
+    int len = kBufferSize;
+    setsockopt(fds_[0], SOL_SOCKET, SO_SNDBUF, &len, sizeof(len));
+    setsockopt(fds_[1], SOL_SOCKET, SO_RCVBUF, &len, sizeof(len));
+  }
+  ~SocketLoopback() {
+    close(fds_[0]);
+    close(fds_[1]);
+  }
+
+  size_t Write(const uint8_t* p, size_t len) {
+    size_t count = 0;
+    while (count < len) {
+      ssize_t sent = send(fds_[0], p + count, len - count, MSG_NOSIGNAL);
+      if (sent <= 0) break;
+      count += sent;
+    }
+    return count;
+  }
+
+  size_t Read(uint8_t* p, size_t len) {
+    size_t count = 0;
+    while (count < len) {
+      struct pollfd pfd = {fds_[1], POLLIN, 0};
+      if (poll(&pfd, 1, kTimeoutMs) <= 0) break;
+      ssize_t n = recv(fds_[1], p + count, len - count, 0);
+      if (n <= 0) break;
+      count += n;
+    }
+    return count;
+  }
+
+ private:
+  int fds_[2];
+};
+
+// The shared memory PCM ring, with the audio HAL and the stack each mapping
+// it, as they do in their own processes.
+class RingLoopback {
+ public:
+  RingLoopback()
+      : reader_(A2dpPcmRing::Create(kBufferSize)),
+        writer_(A2dpPcmRing::Attach(dup(reader_->memfd()),
+                                    dup(reader_->data_event_fd()),
+                                    dup(reader_->space_event_fd()))) {}
+
+  size_t Write(const uint8_t* p, size_t len) {
+    return writer_->Write(p, len, kTimeoutMs);
+  }
+
+  size_t Read(uint8_t* p, size_t len) {
+    ssize_t n = reader_->Read(p, len, kTimeoutMs);
+    return n < 0 ? 0 : n;
+  }
+
+ private:
+  std::unique_ptr<A2dpPcmRing> reader_;
+  std::unique_ptr<A2dpPcmRing> writer_;
+};
+
+// Time from the audio HAL writing a buffer to the stack having read it all,
+// one buffer in flight at a time, so that the reader sleeps each time.
+template <class Loopback>
+void BM_PcmLatency(State& state) {
+  Loopback loopback;
+  std::atomic<bool> running(true);
+  std::atomic<uint64_t> latency_ns(0);
+  std::atomic<uint64_t> buffers(0);
+
+  std::thread reader([&]() {
+    std::vector<uint8_t> buffer(kWriteSize);
+    while (running) {
+      if (loopback.Read(buffer.data(), kWriteSize) != kWriteSize) continue;
+      uint64_t written_ns;
+      memcpy(&written_ns, buffer.data(), sizeof(written_ns));
+      latency_ns += NowNs(CLOCK_MONOTONIC) - written_ns;
+      buffers++;
+    }
+  });
+
+  std::vector<uint8_t> buffer(kWriteSize);
+  uint64_t sent = 0;
+  for (auto _ : state) {
+    uint64_t now_ns = NowNs(CLOCK_MONOTONIC);
+    memcpy(buffer.data(), &now_ns, sizeof(now_ns));
+    loopback.Write(buffer.data(), kWriteSize);
+    sent++;
+    while (buffers.load() != sent) std::this_thread::yield();
+  }
+
+  running = false;
+  loopback.Write(buffer.data(), kWriteSize);
+  reader.join();
+  state.counters["latency_us"] = latency_ns / 1000.0 / sent;
+}
+BENCHMARK_TEMPLATE(BM_PcmLatency, SocketLoopback);
+BENCHMARK_TEMPLATE(BM_PcmLatency, RingLoopback);
+
+// CPU time to move one second of audio, as it flows when streaming: the
+// audio HAL writes a buffer, then the encoder reads it on its timer, a frame
+// at a time, with the data already there.
+template <class Loopback>
+void BM_PcmCpuPerSecond(State& state) {
+  Loopback loopback;
+  std::vector<uint8_t> write_buffer(kWriteSize);
+  std::vector<uint8_t> read_buffer(kReadSize);
+  uint64_t cpu_ns = 0;
+  uint64_t seconds = 0;
+
+  for (auto _ : state) {
+    uint64_t start_ns = NowNs(CLOCK_THREAD_CPUTIME_ID);
+    for (size_t pos = 0; pos < kBytesPerSecond; pos += kWriteSize) {
+      loopback.Write(write_buffer.data(), kWriteSize);
+      for (size_t n = 0; n + kReadSize <= kWriteSize; n += kReadSize)
+        loopback.Read(read_buffer.data(), kReadSize);
+      // and what is left of the buffer
+      loopback.Read(read_buffer.data(), kWriteSize % kReadSize);
+    }
+    cpu_ns += NowNs(CLOCK_THREAD_CPUTIME_ID) - start_ns;
+    seconds++;
+  }
+
+  state.counters["cpu_us_per_audio_s"] = cpu_ns / 1000.0 / seconds;
+  state.SetBytesProcessed(seconds * kBytesPerSecond);
+}
+BENCHMARK_TEMPLATE(BM_PcmCpuPerSecond, SocketLoopback);
+BENCHMARK_TEMPLATE(BM_PcmCpuPerSecond, RingLoopback);
+
+}  // namespace
@@ -86,6 +86,11 @@ typedef enum {
   A2DP_CTRL_SET_OUTPUT_AUDIO_CONFIG,
   A2DP_CTRL_CMD_OFFLOAD_START,
   A2DP_CTRL_GET_PRESENTATION_POSITION,
+  // Asks for the shared memory PCM ring. After the ACK, the audio HAL sends
+  // the ring size it wants (uint32_t); the stack answers with the size of the
+  // ring (uint32_t), carrying its memfd, data eventfd and space eventfd, or 0
+  // with no descriptors if it has no ring. See A2dpPcmRing.
+  A2DP_CTRL_GET_PCM_RING,
 } tA2DP_CTRL_CMD;
 
 typedef enum {
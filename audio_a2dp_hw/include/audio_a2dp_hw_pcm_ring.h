@@ -0,0 +1,142 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <atomic>
+#include <memory>
+
+// Single writer, single reader ring of PCM bytes in shared memory, from the
+// audio HAL (the writer) to the A2DP source (the reader).
+//
+// The stack creates the ring: a memfd holding the header and the data, and
+// two eventfds, one signalled when data is written, one when space is freed.
+// The three descriptors are passed to the audio HAL over the A2DP control
+// channel (A2DP_CTRL_GET_PCM_RING), which attaches to the same memory.
+//
+// The data is mapped twice, back to back, so that every readable or writable
+// span is contiguous and can be used in place. A side only signals an
+// eventfd when the other side has said it is waiting, so streaming makes no
+// system call as long as neither side runs dry.
+//
+// Memfd layout:
+//   header_t, padded to |data_offset| (the page size)
+//   |data_size| bytes of PCM, a power of two. Stream position |pos| is at
+//   |pos| modulo |data_size|.
+class A2dpPcmRing {
+ public:
+  static constexpr uint32_t kMagic = 0x4d435041;  // "APCM"
+  static constexpr uint32_t kVersion = 1;
+
+  typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t data_offset;
+    uint32_t data_size;
+
+    // Written by the writer. |write_timestamp_ns| is the CLOCK_MONOTONIC time
+    // |write_pos| was last moved.
+    alignas(64) std::atomic<uint64_t> write_pos;
+    std::atomic<uint64_t> write_timestamp_ns;
+    std::atomic<uint32_t> writer_waiting;
+
+    // Written by the reader. |read_timestamp_ns| is the CLOCK_MONOTONIC time
+    // |read_pos| was last moved.
+    alignas(64) std::atomic<uint64_t> read_pos;
+    std::atomic<uint64_t> read_timestamp_ns;
+    std::atomic<uint32_t> reader_waiting;
+  } header_t;
+
+  // Creates a ring holding at least |data_size| bytes, rounded up to a power
+  // of two and to the page size. Returns nullptr if memfd or eventfd are not
+  // available, or the ring cannot be mapped.
+  static std::unique_ptr<A2dpPcmRing> Create(size_t data_size);
+
+  // Maps the ring created by Create() in another process, from its
+  // descriptors. Takes ownership of the descriptors, also on failure.
+  // Returns nullptr if |memfd| does not hold a ring.
+  static std::unique_ptr<A2dpPcmRing> Attach(int memfd, int data_event_fd,
+                                             int space_event_fd);
+
+  ~A2dpPcmRing();
+
+  int memfd() const { return memfd_; }
+  int data_event_fd() const { return data_event_fd_; }
+  int space_event_fd() const { return space_event_fd_; }
+  size_t data_size() const { return data_size_; }
+  const header_t* header() const { return header_; }
+
+  // Writer side.
+
+  // Returns the writable span, and sets |*len| to its size.
+  uint8_t* WriteBegin(size_t* len);
+
+  // Makes the first |len| bytes of the span returned by WriteBegin() readable.
+  void WriteCommit(size_t len);
+
+  // Copies |len| bytes from |p| into the ring, waiting for space for up to
+  // |timeout_ms| in total. Returns the number of bytes written, less than
+  // |len| on timeout.
+  size_t Write(const void* p, size_t len, int timeout_ms);
+
+  // Reader side.
+
+  // Returns the readable span, and sets |*len| to its size.
+  const uint8_t* ReadBegin(size_t* len);
+
+  // Frees the first |len| bytes of the span returned by ReadBegin().
+  void ReadCommit(size_t len);
+
+  // Copies up to |len| bytes from the ring into |p|. As UIPC_Read() does, it
+  // waits for up to |timeout_ms| each time the ring runs dry, and returns
+  // what it has if nothing comes. If |hangup_fd| is valid, the wait also ends
+  // when it hangs up, and -1 is returned.
+  ssize_t Read(void* p, size_t len, int timeout_ms, int hangup_fd = -1);
+
+  // Drops all readable bytes.
+  void Flush();
+
+  // Returns the number of readable bytes.
+  size_t Readable() const;
+
+  // Moves both positions back to 0. Neither side may be using the ring.
+  void Reset();
+
+ private:
+  A2dpPcmRing(int memfd, int data_event_fd, int space_event_fd);
+
+  bool Map(size_t data_offset, size_t data_size);
+
+  // Waits for |event_fd| to be signalled, for up to |timeout_ms|. Returns
+  // false if |hangup_fd| hung up.
+  static bool Wait(int event_fd, int timeout_ms, int hangup_fd);
+  static void Signal(int event_fd);
+
+  int memfd_;
+  int data_event_fd_;
+  int space_event_fd_;
+  uint8_t* base_ = nullptr;
+  size_t map_size_ = 0;
+  header_t* header_ = nullptr;
+  uint8_t* data_ = nullptr;
+  size_t data_size_ = 0;
+};
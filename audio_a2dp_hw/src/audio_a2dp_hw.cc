@@ -37,6 +37,7 @@
 #include <sys/un.h>
 #include <unistd.h>
 
+#include <memory>
 #include <mutex>
 
 #include <hardware/audio.h>
@@ -49,12 +50,14 @@
 #include "osi/include/socket_utils/sockets.h"
 
 #include "audio_a2dp_hw.h"
+#include "audio_a2dp_hw_pcm_ring.h"
 
 /*****************************************************************************
  *  Constants & Macros
  *****************************************************************************/
 
 #define CTRL_CHAN_RETRY_COUNT 3
+#define PCM_RING_NUM_FDS 3
 #define USEC_PER_SEC 1000000L
 #define SOCK_SEND_TIMEOUT_MS 2000 /* Timeout for sending */
 #define SOCK_RECV_TIMEOUT_MS 5000 /* Timeout for receiving */
@@ -122,6 +125,10 @@ struct a2dp_stream_common {
   std::recursive_mutex* mutex;  // See note below on mutex acquisition order.
   int ctrl_fd;
   int audio_fd;
+  // Shared memory PCM ring to the stack, written to instead of |audio_fd|
+  // when the stack has one. Held by out_write() while it writes.
+  std::shared_ptr<A2dpPcmRing>* pcm_ring;
+  bool use_pcm_ring;  // Output streams ask the stack for a PCM ring
   size_t buffer_sz;
   struct a2dp_config cfg;
   a2dp_state_t state;
@@ -379,6 +386,56 @@ static int a2dp_ctrl_receive(struct a2dp_stream_common* common, void* buffer,
   return ret;
 }
 
+// Receives control info for stream |common| into |buffer| of size |length|,
+// along with up to |max_fds| file descriptors into |fds|.
+// On success, returns the number of file descriptors received, otherwise -1.
+static int a2dp_ctrl_receive_fds(struct a2dp_stream_common* common,
+                                 void* buffer, size_t length, int* fds,
+                                 size_t max_fds) {
+  char control_buf[CMSG_SPACE(PCM_RING_NUM_FDS * sizeof(int))];
+  struct iovec iov;
+  struct msghdr msg;
+  ssize_t ret;
+
+  if (max_fds > PCM_RING_NUM_FDS) max_fds = PCM_RING_NUM_FDS;
+
+  iov.iov_base = buffer;
+  iov.iov_len = length;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control_buf;
+  msg.msg_controllen = CMSG_SPACE(max_fds * sizeof(int));
+
+  OSI_NO_INTR(ret = recvmsg(common->ctrl_fd, &msg, MSG_CMSG_CLOEXEC));
+  if (ret != static_cast<ssize_t>(length)) {
+    ERROR("receive control data failed: error(%s)",
+          ret < 0 ? strerror(errno) : "short read");
+    skt_disconnect(common->ctrl_fd);
+    common->ctrl_fd = AUDIO_SKT_DISCONNECTED;
+    return -1;
+  }
+
+  int num_fds = 0;
+  for (struct cmsghdr* header = CMSG_FIRSTHDR(&msg); header != NULL;
+       header = CMSG_NXTHDR(&msg, header)) {
+    if (header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_RIGHTS)
+      continue;
+    int count = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    for (int i = 0; i < count; i++) {
+      int fd;
+      memcpy(&fd, CMSG_DATA(header) + i * sizeof(int), sizeof(fd));
+      if (num_fds < static_cast<int>(max_fds)) {
+        fds[num_fds++] = fd;
+      } else {
+        close(fd);
+      }
+    }
+  }
+  if (msg.msg_flags & MSG_CTRUNC) WARN("file descriptors truncated");
+  return num_fds;
+}
+
 // Sends control info for stream |common|. The data to send is stored in
 // |buffer| and has size |length|.
 // On success, returns the number of octets sent, otherwise -1.
@@ -780,6 +837,42 @@ static int a2dp_get_presentation_position_cmd(struct a2dp_stream_common* common,
   return 0;
 }
 
+// Asks the stack for the shared memory PCM ring and attaches to it. Without
+// one, the audio data goes through the audio data socket.
+static void a2dp_get_pcm_ring(struct a2dp_stream_common* common) {
+  if (a2dp_command(common, A2DP_CTRL_GET_PCM_RING) < 0) {
+    INFO("no PCM ring, using the audio data socket");
+    return;
+  }
+
+  uint32_t size = common->buffer_sz;
+  if (a2dp_ctrl_send(common, &size, sizeof(size)) < 0) return;
+
+  uint32_t data_size = 0;
+  int fds[PCM_RING_NUM_FDS];
+  int num_fds = a2dp_ctrl_receive_fds(common, &data_size, sizeof(data_size),
+                                      fds, PCM_RING_NUM_FDS);
+  if (num_fds < 0) return;
+  if (data_size == 0 || num_fds != PCM_RING_NUM_FDS) {
+    INFO("stack has no PCM ring, using the audio data socket");
+    for (int i = 0; i < num_fds; i++) close(fds[i]);
+    return;
+  }
+
+  std::shared_ptr<A2dpPcmRing> ring =
+      A2dpPcmRing::Attach(fds[0], fds[1], fds[2]);
+  if (ring == nullptr) {
+    ERROR("unable to attach to the PCM ring");
+    return;
+  }
+  INFO("PCM ring of %u bytes", data_size);
+  *common->pcm_ring = ring;
+}
+
+static void a2dp_release_pcm_ring(struct a2dp_stream_common* common) {
+  common->pcm_ring->reset();
+}
+
 static void a2dp_open_ctrl_path(struct a2dp_stream_common* common) {
   int i;
 
@@ -817,6 +910,8 @@ static void a2dp_stream_common_init(struct a2dp_stream_common* common) {
 
   common->ctrl_fd = AUDIO_SKT_DISCONNECTED;
   common->audio_fd = AUDIO_SKT_DISCONNECTED;
+  common->pcm_ring = new std::shared_ptr<A2dpPcmRing>;
+  common->use_pcm_ring = false;
   common->state = AUDIO_A2DP_STATE_STOPPED;
 
   /* manages max capacity of socket pipe */
@@ -828,6 +923,9 @@ static void a2dp_stream_common_destroy(struct a2dp_stream_common* common) {
 
   delete common->mutex;
   common->mutex = NULL;
+
+  delete common->pcm_ring;
+  common->pcm_ring = NULL;
 }
 
 static int start_audio_datapath(struct a2dp_stream_common* common) {
@@ -847,6 +945,9 @@ static int start_audio_datapath(struct a2dp_stream_common* common) {
 
   /* connect socket if not yet connected */
   if (common->audio_fd == AUDIO_SKT_DISCONNECTED) {
+    /* the ring must be set up before the stack sees the socket */
+    if (common->use_pcm_ring) a2dp_get_pcm_ring(common);
+
     common->audio_fd = skt_connect(A2DP_DATA_PATH, common->buffer_sz);
     if (common->audio_fd < 0) {
       ERROR("Audiopath start failed - error opening data socket");
@@ -885,6 +986,7 @@ static int stop_audio_datapath(struct a2dp_stream_common* common) {
   /* disconnect audio path */
   skt_disconnect(common->audio_fd);
   common->audio_fd = AUDIO_SKT_DISCONNECTED;
+  a2dp_release_pcm_ring(common);
 
   return 0;
 }
@@ -906,6 +1008,7 @@ static int suspend_audio_datapath(struct a2dp_stream_common* common,
   skt_disconnect(common->audio_fd);
 
   common->audio_fd = AUDIO_SKT_DISCONNECTED;
+  a2dp_release_pcm_ring(common);
 
   return 0;
 }
@@ -955,13 +1058,25 @@ static ssize_t out_write(struct audio_stream_out* stream, const void* buffer,
           out->common.audio_fd);
   }
 
-  lock.unlock();
-  sent = skt_write(out->common.audio_fd, buffer, write_bytes);
-  lock.lock();
+  if (*out->common.pcm_ring != nullptr) {
+    std::shared_ptr<A2dpPcmRing> ring = *out->common.pcm_ring;
+    lock.unlock();
+    sent = ring->Write(buffer, write_bytes, SOCK_SEND_TIMEOUT_MS);
+    if (sent != static_cast<int>(write_bytes)) {
+      WARN("PCM ring write timeout exceeded, sent %d bytes", sent);
+      sent = -1;
+    }
+    lock.lock();
+  } else {
+    lock.unlock();
+    sent = skt_write(out->common.audio_fd, buffer, write_bytes);
+    lock.lock();
+  }
 
   if (sent == -1) {
     skt_disconnect(out->common.audio_fd);
     out->common.audio_fd = AUDIO_SKT_DISCONNECTED;
+    a2dp_release_pcm_ring(&out->common);
     if ((out->common.state != AUDIO_A2DP_STATE_SUSPENDED) &&
         (out->common.state != AUDIO_A2DP_STATE_STOPPING)) {
       out->common.state = AUDIO_A2DP_STATE_STOPPED;
@@ -1608,6 +1723,7 @@ static int adev_open_output_stream(struct audio_hw_device* dev,
 
   /* initialize a2dp specifics */
   a2dp_stream_common_init(&out->common);
+  out->common.use_pcm_ring = true;
 
   // Make sure we always have the feeding parameters configured
   btav_a2dp_codec_config_t codec_config;
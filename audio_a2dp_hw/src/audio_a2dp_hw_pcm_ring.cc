@@ -0,0 +1,318 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#define LOG_TAG "bt_a2dp_pcm_ring"
+
+#include "audio_a2dp_hw_pcm_ring.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/memfd.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "osi/include/log.h"
+#include "osi/include/osi.h"
+
+#ifndef F_ADD_SEALS
+#define F_ADD_SEALS 1033
+#define F_SEAL_SHRINK 0x0002
+#define F_SEAL_GROW 0x0004
+#endif
+
+namespace {
+
+uint64_t NowNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void CloseFd(int fd) {
+  if (fd != INVALID_FD) close(fd);
+}
+
+}  // namespace
+
+constexpr uint32_t A2dpPcmRing::kMagic;
+constexpr uint32_t A2dpPcmRing::kVersion;
+
+A2dpPcmRing::A2dpPcmRing(int memfd, int data_event_fd, int space_event_fd)
+    : memfd_(memfd),
+      data_event_fd_(data_event_fd),
+      space_event_fd_(space_event_fd) {}
+
+A2dpPcmRing::~A2dpPcmRing() {
+  if (base_ != nullptr) munmap(base_, map_size_);
+  CloseFd(memfd_);
+  CloseFd(data_event_fd_);
+  CloseFd(space_event_fd_);
+}
+
+std::unique_ptr<A2dpPcmRing> A2dpPcmRing::Create(size_t data_size) {
+  size_t page_size = sysconf(_SC_PAGESIZE);
+  size_t size = page_size;
+  while (size < data_size) size <<= 1;
+
+  // memfd_create() is called through syscall() as not all C libraries we
+  // build against have it.
+  int memfd = syscall(__NR_memfd_create, "a2dp_pcm_ring",
+                      MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  int data_event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  int space_event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  std::unique_ptr<A2dpPcmRing> ring(
+      new A2dpPcmRing(memfd, data_event_fd, space_event_fd));
+  if (memfd < 0 || data_event_fd < 0 || space_event_fd < 0) {
+    LOG_ERROR(LOG_TAG, "%s: unable to create descriptors: %s", __func__,
+              strerror(errno));
+    return nullptr;
+  }
+
+  if (ftruncate(memfd, page_size + size) < 0) {
+    LOG_ERROR(LOG_TAG, "%s: unable to size ring: %s", __func__,
+              strerror(errno));
+    return nullptr;
+  }
+  // The peer must not be able to shrink the memfd under our mapping.
+  if (fcntl(memfd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW) < 0) {
+    LOG_ERROR(LOG_TAG, "%s: unable to seal ring: %s", __func__,
+              strerror(errno));
+    return nullptr;
+  }
+
+  if (!ring->Map(page_size, size)) return nullptr;
+
+  header_t* header = ring->header_;
+  header->magic = kMagic;
+  header->version = kVersion;
+  header->data_offset = page_size;
+  header->data_size = size;
+  ring->Reset();
+  return ring;
+}
+
+std::unique_ptr<A2dpPcmRing> A2dpPcmRing::Attach(int memfd, int data_event_fd,
+                                                 int space_event_fd) {
+  std::unique_ptr<A2dpPcmRing> ring(
+      new A2dpPcmRing(memfd, data_event_fd, space_event_fd));
+  if (memfd < 0 || data_event_fd < 0 || space_event_fd < 0) return nullptr;
+
+  // magic, version, data_offset and data_size
+  uint32_t fields[4];
+  ssize_t ret;
+  OSI_NO_INTR(ret = pread(memfd, fields, sizeof(fields), 0));
+  if (ret != sizeof(fields) || fields[0] != kMagic || fields[1] != kVersion) {
+    LOG_ERROR(LOG_TAG, "%s: not a PCM ring", __func__);
+    return nullptr;
+  }
+
+  uint32_t data_offset = fields[2];
+  uint32_t data_size = fields[3];
+  size_t page_size = sysconf(_SC_PAGESIZE);
+  struct stat st;
+  if (data_offset < sizeof(header_t) || data_offset % page_size != 0 ||
+      data_size == 0 || (data_size & (data_size - 1)) != 0 ||
+      data_size % page_size != 0 || fstat(memfd, &st) < 0 ||
+      (uint64_t)st.st_size < (uint64_t)data_offset + data_size) {
+    LOG_ERROR(LOG_TAG, "%s: bad PCM ring layout (offset %u size %u)",
+              __func__, data_offset, data_size);
+    return nullptr;
+  }
+
+  if (!ring->Map(data_offset, data_size)) return nullptr;
+  return ring;
+}
+
+bool A2dpPcmRing::Map(size_t data_offset, size_t data_size) {
+  // Reserve room for the header and two copies of the data, then map the
+  // memfd over it: header and data first, the data again right after.
+  size_t map_size = data_offset + 2 * data_size;
+  void* base =
+      mmap(nullptr, map_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (base == MAP_FAILED) {
+    LOG_ERROR(LOG_TAG, "%s: unable to reserve %zu bytes: %s", __func__,
+              map_size, strerror(errno));
+    return false;
+  }
+  base_ = static_cast<uint8_t*>(base);
+  map_size_ = map_size;
+
+  if (mmap(base_, data_offset + data_size, PROT_READ | PROT_WRITE,
+           MAP_SHARED | MAP_FIXED, memfd_, 0) == MAP_FAILED ||
+      mmap(base_ + data_offset + data_size, data_size, PROT_READ | PROT_WRITE,
+           MAP_SHARED | MAP_FIXED, memfd_, data_offset) == MAP_FAILED) {
+    LOG_ERROR(LOG_TAG, "%s: unable to map ring: %s", __func__,
+              strerror(errno));
+    return false;
+  }
+
+  header_ = reinterpret_cast<header_t*>(base_);
+  data_ = base_ + data_offset;
+  data_size_ = data_size;
+  return true;
+}
+
+uint8_t* A2dpPcmRing::WriteBegin(size_t* len) {
+  uint64_t write_pos = header_->write_pos.load(std::memory_order_relaxed);
+  uint64_t read_pos = header_->read_pos.load(std::memory_order_acquire);
+  uint64_t used = write_pos - read_pos;
+  *len = used < data_size_ ? data_size_ - used : 0;
+  return data_ + (write_pos & (data_size_ - 1));
+}
+
+void A2dpPcmRing::WriteCommit(size_t len) {
+  if (len == 0) return;
+  uint64_t write_pos = header_->write_pos.load(std::memory_order_relaxed);
+  header_->write_timestamp_ns.store(NowNs(), std::memory_order_relaxed);
+  header_->write_pos.store(write_pos + len, std::memory_order_release);
+
+  // Pairs with the fence in Read(): either the reader sees the new position,
+  // or we see it waiting.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (header_->reader_waiting.load(std::memory_order_relaxed))
+    Signal(data_event_fd_);
+}
+
+size_t A2dpPcmRing::Write(const void* p, size_t len, int timeout_ms) {
+  const uint8_t* src = static_cast<const uint8_t*>(p);
+  uint64_t deadline_ns = NowNs() + (uint64_t)timeout_ms * 1000000;
+  size_t written = 0;
+
+  while (written < len) {
+    size_t space;
+    uint8_t* dst = WriteBegin(&space);
+    if (space == 0) {
+      uint64_t now_ns = NowNs();
+      if (now_ns >= deadline_ns) break;
+
+      header_->writer_waiting.store(1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      WriteBegin(&space);
+      if (space == 0) {
+        Wait(space_event_fd_, (deadline_ns - now_ns + 999999) / 1000000,
+             INVALID_FD);
+      }
+      header_->writer_waiting.store(0, std::memory_order_relaxed);
+      continue;
+    }
+
+    size_t n = std::min(space, len - written);
+    memcpy(dst, src + written, n);
+    WriteCommit(n);
+    written += n;
+  }
+  return written;
+}
+
+const uint8_t* A2dpPcmRing::ReadBegin(size_t* len) {
+  *len = Readable();
+  return data_ +
+         (header_->read_pos.load(std::memory_order_relaxed) & (data_size_ - 1));
+}
+
+void A2dpPcmRing::ReadCommit(size_t len) {
+  if (len == 0) return;
+  uint64_t read_pos = header_->read_pos.load(std::memory_order_relaxed);
+  header_->read_timestamp_ns.store(NowNs(), std::memory_order_relaxed);
+  header_->read_pos.store(read_pos + len, std::memory_order_release);
+
+  // Pairs with the fence in Write().
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (header_->writer_waiting.load(std::memory_order_relaxed))
+    Signal(space_event_fd_);
+}
+
+ssize_t A2dpPcmRing::Read(void* p, size_t len, int timeout_ms,
+                          int hangup_fd) {
+  uint8_t* dst = static_cast<uint8_t*>(p);
+  size_t read = 0;
+
+  while (read < len) {
+    size_t available;
+    const uint8_t* src = ReadBegin(&available);
+    if (available == 0) {
+      header_->reader_waiting.store(1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      bool hung_up = false;
+      if (Readable() == 0)
+        hung_up = !Wait(data_event_fd_, timeout_ms, hangup_fd);
+      header_->reader_waiting.store(0, std::memory_order_relaxed);
+      if (hung_up) return -1;
+      if (Readable() == 0) break;
+      continue;
+    }
+
+    size_t n = std::min(available, len - read);
+    memcpy(dst + read, src, n);
+    ReadCommit(n);
+    read += n;
+  }
+  return read;
+}
+
+void A2dpPcmRing::Flush() { ReadCommit(Readable()); }
+
+size_t A2dpPcmRing::Readable() const {
+  uint64_t write_pos = header_->write_pos.load(std::memory_order_acquire);
+  uint64_t read_pos = header_->read_pos.load(std::memory_order_relaxed);
+  // The writer is another process: never trust it to stay in bounds.
+  return std::min<uint64_t>(write_pos - read_pos, data_size_);
+}
+
+void A2dpPcmRing::Reset() {
+  header_->write_pos.store(0, std::memory_order_relaxed);
+  header_->write_timestamp_ns.store(0, std::memory_order_relaxed);
+  header_->writer_waiting.store(0, std::memory_order_relaxed);
+  header_->read_pos.store(0, std::memory_order_relaxed);
+  header_->read_timestamp_ns.store(0, std::memory_order_relaxed);
+  header_->reader_waiting.store(0, std::memory_order_relaxed);
+
+  eventfd_t value;
+  eventfd_read(data_event_fd_, &value);
+  eventfd_read(space_event_fd_, &value);
+}
+
+bool A2dpPcmRing::Wait(int event_fd, int timeout_ms, int hangup_fd) {
+  struct pollfd pfds[2];
+  pfds[0].fd = event_fd;
+  pfds[0].events = POLLIN;
+  pfds[1].fd = hangup_fd;
+  pfds[1].events = POLLRDHUP;
+  nfds_t nfds = (hangup_fd != INVALID_FD) ? 2 : 1;
+
+  int ret;
+  OSI_NO_INTR(ret = poll(pfds, nfds, timeout_ms));
+  if (ret <= 0) return true;
+
+  if (nfds == 2 && (pfds[1].revents & (POLLRDHUP | POLLHUP | POLLNVAL)))
+    return false;
+
+  eventfd_t value;
+  eventfd_read(event_fd, &value);
+  return true;
+}
+
+void A2dpPcmRing::Signal(int event_fd) { eventfd_write(event_fd, 1); }
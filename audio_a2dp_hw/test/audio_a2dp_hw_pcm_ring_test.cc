@@ -0,0 +1,173 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "audio_a2dp_hw/include/audio_a2dp_hw_pcm_ring.h"
+
+#include <gtest/gtest.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Attaches to |ring| as the audio HAL does, through copies of its descriptors
+std::unique_ptr<A2dpPcmRing> AttachTo(const A2dpPcmRing& ring) {
+  return A2dpPcmRing::Attach(dup(ring.memfd()), dup(ring.data_event_fd()),
+                             dup(ring.space_event_fd()));
+}
+
+std::vector<uint8_t> Pattern(size_t len, size_t start) {
+  std::vector<uint8_t> data(len);
+  for (size_t i = 0; i < len; i++) data[i] = (uint8_t)((start + i) * 7);
+  return data;
+}
+
+}  // namespace
+
+TEST(A2dpPcmRingTest, create_rounds_up_to_power_of_two) {
+  std::unique_ptr<A2dpPcmRing> ring = A2dpPcmRing::Create(7680);
+  ASSERT_NE(nullptr, ring);
+  EXPECT_EQ(8192u, ring->data_size());
+  EXPECT_EQ(A2dpPcmRing::kMagic, ring->header()->magic);
+  EXPECT_EQ(0u, ring->Readable());
+}
+
+TEST(A2dpPcmRingTest, attach_shares_memory) {
+  std::unique_ptr<A2dpPcmRing> reader = A2dpPcmRing::Create(4096);
+  ASSERT_NE(nullptr, reader);
+  std::unique_ptr<A2dpPcmRing> writer = AttachTo(*reader);
+  ASSERT_NE(nullptr, writer);
+  EXPECT_EQ(reader->data_size(), writer->data_size());
+
+  std::vector<uint8_t> data = Pattern(1000, 0);
+  EXPECT_EQ(data.size(), writer->Write(data.data(), data.size(), 0));
+  EXPECT_EQ(data.size(), reader->Readable());
+  EXPECT_NE(0u, reader->header()->write_timestamp_ns.load());
+
+  std::vector<uint8_t> out(data.size());
+  EXPECT_EQ((ssize_t)out.size(), reader->Read(out.data(), out.size(), 0));
+  EXPECT_EQ(data, out);
+  EXPECT_EQ(0u, writer->Readable());
+}
+
+TEST(A2dpPcmRingTest, attach_rejects_other_files) {
+  int fds[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  std::unique_ptr<A2dpPcmRing> ring = A2dpPcmRing::Create(4096);
+  ASSERT_NE(nullptr, ring);
+  EXPECT_EQ(nullptr, A2dpPcmRing::Attach(fds[0], dup(ring->data_event_fd()),
+                                         dup(ring->space_event_fd())));
+  close(fds[1]);
+}
+
+TEST(A2dpPcmRingTest, spans_are_contiguous_across_the_end) {
+  std::unique_ptr<A2dpPcmRing> ring = A2dpPcmRing::Create(4096);
+  ASSERT_NE(nullptr, ring);
+  const size_t size = ring->data_size();
+
+  std::vector<uint8_t> skip(size - 100);
+  ASSERT_EQ(skip.size(), ring->Write(skip.data(), skip.size(), 0));
+  ring->Flush();
+
+  size_t len;
+  uint8_t* dst = ring->WriteBegin(&len);
+  ASSERT_EQ(size, len);
+  std::vector<uint8_t> data = Pattern(300, 5);
+  memcpy(dst, data.data(), data.size());
+  ring->WriteCommit(data.size());
+
+  const uint8_t* src = ring->ReadBegin(&len);
+  ASSERT_EQ(data.size(), len);
+  EXPECT_EQ(0, memcmp(src, data.data(), data.size()));
+  ring->ReadCommit(len);
+  EXPECT_EQ(0u, ring->Readable());
+}
+
+TEST(A2dpPcmRingTest, write_times_out_when_full) {
+  std::unique_ptr<A2dpPcmRing> ring = A2dpPcmRing::Create(4096);
+  ASSERT_NE(nullptr, ring);
+  std::vector<uint8_t> data(ring->data_size() + 10);
+  EXPECT_EQ(ring->data_size(), ring->Write(data.data(), data.size(), 20));
+  EXPECT_EQ(ring->data_size(), ring->Readable());
+}
+
+TEST(A2dpPcmRingTest, read_returns_what_it_has_on_timeout) {
+  std::unique_ptr<A2dpPcmRing> ring = A2dpPcmRing::Create(4096);
+  ASSERT_NE(nullptr, ring);
+  std::vector<uint8_t> data = Pattern(10, 0);
+  ring->Write(data.data(), data.size(), 0);
+
+  std::vector<uint8_t> out(100);
+  EXPECT_EQ(10, ring->Read(out.data(), out.size(), 10));
+  EXPECT_EQ(0, ring->Read(out.data(), out.size(), 10));
+}
+
+TEST(A2dpPcmRingTest, read_fails_on_hangup) {
+  std::unique_ptr<A2dpPcmRing> ring = A2dpPcmRing::Create(4096);
+  ASSERT_NE(nullptr, ring);
+  int fds[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+
+  uint8_t out[16];
+  EXPECT_EQ(0, ring->Read(out, sizeof(out), 10, fds[0]));
+  close(fds[1]);
+  EXPECT_EQ(-1, ring->Read(out, sizeof(out), 1000, fds[0]));
+  close(fds[0]);
+}
+
+TEST(A2dpPcmRingTest, reset) {
+  std::unique_ptr<A2dpPcmRing> ring = A2dpPcmRing::Create(4096);
+  ASSERT_NE(nullptr, ring);
+  std::vector<uint8_t> data(100);
+  ring->Write(data.data(), data.size(), 0);
+  ring->Reset();
+  EXPECT_EQ(0u, ring->Readable());
+  EXPECT_EQ(0u, ring->header()->write_pos.load());
+}
+
+TEST(A2dpPcmRingTest, streams_between_threads) {
+  std::unique_ptr<A2dpPcmRing> reader = A2dpPcmRing::Create(4096);
+  ASSERT_NE(nullptr, reader);
+  std::unique_ptr<A2dpPcmRing> writer = AttachTo(*reader);
+  ASSERT_NE(nullptr, writer);
+
+  // Odd sizes on both sides, so that positions drift across the end
+  const size_t kTotal = 1000000;
+  std::thread thread([&writer, kTotal]() {
+    for (size_t pos = 0; pos < kTotal;) {
+      size_t len = std::min<size_t>(1531, kTotal - pos);
+      std::vector<uint8_t> data = Pattern(len, pos);
+      ASSERT_EQ(len, writer->Write(data.data(), len, 1000));
+      pos += len;
+    }
+  });
+
+  std::vector<uint8_t> out(977);
+  for (size_t pos = 0; pos < kTotal;) {
+    size_t len = std::min(out.size(), kTotal - pos);
+    ASSERT_EQ((ssize_t)len, reader->Read(out.data(), len, 1000));
+    ASSERT_TRUE(std::equal(out.begin(), out.begin() + len,
+                           Pattern(len, pos).begin()))
+        << "at " << pos;
+    pos += len;
+  }
+  thread.join();
+}
@@ -2096,7 +2096,6 @@ void bta_av_reconfig(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data) {
 void bta_av_data_path(tBTA_AV_SCB* p_scb, UNUSED_ATTR tBTA_AV_DATA* p_data) {
   BT_HDR* p_buf = NULL;
   uint32_t timestamp;
-  bool new_buf = false;
   uint8_t m_pt = 0x60;
   tAVDT_DATA_OPT_MASK opt;
 
@@ -2116,7 +2115,6 @@ void bta_av_data_path(tBTA_AV_SCB* p_scb, UNUSED_ATTR tBTA_AV_DATA* p_data) {
     /* use q_info.a2dp data, read the timestamp */
     timestamp = *(uint32_t*)(p_buf + 1);
   } else {
-    new_buf = true;
     /* A2DP_list empty, call co_data, dup data to other channels */
     p_buf = p_scb->p_cos->data(p_scb->cfg.codec_info, &timestamp);
 
@@ -2130,81 +2128,61 @@ void bta_av_data_path(tBTA_AV_SCB* p_scb, UNUSED_ATTR tBTA_AV_DATA* p_data) {
   }
 
   if (p_buf) {
-    if (p_scb->l2c_bufs < (BTA_AV_QUEUE_DATA_CHK_NUM)) {
-      /* There's a buffer, just queue it to L2CAP.
-       * There's no need to increment it here, it is always read from
-       * L2CAP (see above).
-       */
+    /* Queue it to AVDTP, even when L2CAP does not seem to be moving data:
+     * AVDTP paces the writes on the congestion of the channel, and drops the
+     * packets that would be late.
+     */
 
-      /* opt is a bit mask, it could have several options set */
-      opt = AVDT_DATA_OPT_NONE;
-      if (p_scb->no_rtp_header) {
-        opt |= AVDT_DATA_OPT_NO_RTP;
-      }
+    /* opt is a bit mask, it could have several options set */
+    opt = AVDT_DATA_OPT_NONE;
+    if (p_scb->no_rtp_header) {
+      opt |= AVDT_DATA_OPT_NO_RTP;
+    }
 
-      //
-      // Fragment the payload if larger than the MTU.
-      // NOTE: The fragmentation is RTP-compatibie.
-      //
-      size_t extra_fragments_n = 0;
-      if (p_buf->len > 0) {
-        extra_fragments_n = (p_buf->len / p_scb->stream_mtu) +
-                            ((p_buf->len % p_scb->stream_mtu) ? 1 : 0) - 1;
-      }
-      std::vector<BT_HDR*> extra_fragments;
-      extra_fragments.reserve(extra_fragments_n);
-
-      uint8_t* data_begin = (uint8_t*)(p_buf + 1) + p_buf->offset;
-      uint8_t* data_end = (uint8_t*)(p_buf + 1) + p_buf->offset + p_buf->len;
-      while (extra_fragments_n-- > 0) {
-        data_begin += p_scb->stream_mtu;
-        size_t fragment_len = data_end - data_begin;
-        if (fragment_len > p_scb->stream_mtu) fragment_len = p_scb->stream_mtu;
-
-        BT_HDR* p_buf2 = (BT_HDR*)osi_malloc(BT_DEFAULT_BUFFER_SIZE);
-        p_buf2->offset = p_buf->offset;
-        p_buf2->len = 0;
-        p_buf2->layer_specific = 0;
-        uint8_t* packet2 =
-            (uint8_t*)(p_buf2 + 1) + p_buf2->offset + p_buf2->len;
-        memcpy(packet2, data_begin, fragment_len);
-        p_buf2->len += fragment_len;
-        extra_fragments.push_back(p_buf2);
-        p_buf->len -= fragment_len;
-      }
+    //
+    // Fragment the payload if larger than the MTU.
+    // NOTE: The fragmentation is RTP-compatibie.
+    //
+    size_t extra_fragments_n = 0;
+    if (p_buf->len > 0) {
+      extra_fragments_n = (p_buf->len / p_scb->stream_mtu) +
+                          ((p_buf->len % p_scb->stream_mtu) ? 1 : 0) - 1;
+    }
+    std::vector<BT_HDR*> extra_fragments;
+    extra_fragments.reserve(extra_fragments_n);
+
+    uint8_t* data_begin = (uint8_t*)(p_buf + 1) + p_buf->offset;
+    uint8_t* data_end = (uint8_t*)(p_buf + 1) + p_buf->offset + p_buf->len;
+    while (extra_fragments_n-- > 0) {
+      data_begin += p_scb->stream_mtu;
+      size_t fragment_len = data_end - data_begin;
+      if (fragment_len > p_scb->stream_mtu) fragment_len = p_scb->stream_mtu;
+
+      BT_HDR* p_buf2 = (BT_HDR*)osi_malloc(BT_DEFAULT_BUFFER_SIZE);
+      p_buf2->offset = p_buf->offset;
+      p_buf2->len = 0;
+      p_buf2->layer_specific = 0;
+      uint8_t* packet2 = (uint8_t*)(p_buf2 + 1) + p_buf2->offset + p_buf2->len;
+      memcpy(packet2, data_begin, fragment_len);
+      p_buf2->len += fragment_len;
+      extra_fragments.push_back(p_buf2);
+      p_buf->len -= fragment_len;
+    }
 
-      if (!extra_fragments.empty()) {
-        // Reset the RTP Marker bit for all fragments except the last one
-        m_pt &= ~AVDT_MARKER_SET;
-      }
-      AVDT_WriteReqOpt(p_scb->avdt_handle, p_buf, timestamp, m_pt, opt);
-      for (size_t i = 0; i < extra_fragments.size(); i++) {
-        if (i + 1 == extra_fragments.size()) {
-          // Set the RTP Marker bit for the last fragment
-          m_pt |= AVDT_MARKER_SET;
-        }
-        BT_HDR* p_buf2 = extra_fragments[i];
-        AVDT_WriteReqOpt(p_scb->avdt_handle, p_buf2, timestamp, m_pt, opt);
-      }
-      p_scb->cong = true;
-    } else {
-      /* there's a buffer, but L2CAP does not seem to be moving data */
-      if (new_buf) {
-        /* just got this buffer from co_data,
-         * put it in queue */
-        list_append(p_scb->a2dp_list, p_buf);
-      } else {
-        /* just dequeue it from the a2dp_list */
-        if (list_length(p_scb->a2dp_list) < 3) {
-          /* put it back to the queue */
-          list_prepend(p_scb->a2dp_list, p_buf);
-        } else {
-          /* too many buffers in a2dp_list, drop it. */
-          bta_av_co_audio_drop(p_scb->hndl, p_scb->PeerAddress());
-          osi_free(p_buf);
-        }
+    if (!extra_fragments.empty()) {
+      // Reset the RTP Marker bit for all fragments except the last one
+      m_pt &= ~AVDT_MARKER_SET;
+    }
+    AVDT_WriteReqOpt(p_scb->avdt_handle, p_buf, timestamp, m_pt, opt);
+    for (size_t i = 0; i < extra_fragments.size(); i++) {
+      if (i + 1 == extra_fragments.size()) {
+        // Set the RTP Marker bit for the last fragment
+        m_pt |= AVDT_MARKER_SET;
       }
+      BT_HDR* p_buf2 = extra_fragments[i];
+      AVDT_WriteReqOpt(p_scb->avdt_handle, p_buf2, timestamp, m_pt, opt);
     }
+    p_scb->cong = true;
   }
 }
 
@@ -298,6 +298,15 @@ int BTA_AvObtainPeerChannelIndex(const RawAddress& peer_address) {
   return -1;
 }
 
+bool BTA_AvGetMediaQueueStats(const RawAddress& peer_address,
+                              tAVDT_MEDIA_QUEUE_STATS* p_stats) {
+  tBTA_AV_SCB* p_scb = bta_av_addr_to_scb(peer_address);
+  if (p_scb == nullptr || p_scb->avdt_handle == 0) {
+    return false;
+  }
+  return AVDT_GetMediaQueueStats(p_scb->avdt_handle, p_stats) == AVDT_SUCCESS;
+}
+
 /*******************************************************************************
  *
  * Function         bta_av_hndl_to_scb
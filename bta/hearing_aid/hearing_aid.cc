@@ -22,9 +22,9 @@
 #include "bta_gatt_queue.h"
 #include "btm_int.h"
 #include "device/include/controller.h"
-#include "embdrv/g722/g722_enc_dec.h"
 #include "gap_api.h"
 #include "gatt_api.h"
+#include "hearing_aid_encoder.h"
 #include "osi/include/properties.h"
 
 #include <base/bind.h>
@@ -203,24 +203,23 @@ static void write_rpt_ctl_cfg_cb(uint16_t conn_id, tGATT_STATUS status,
   }
 }
 
-g722_encode_state_t* encoder_state_left = nullptr;
-g722_encode_state_t* encoder_state_right = nullptr;
+// Largest PCM buffer the audio source delivers: 20 ms at 24 kHz
+constexpr size_t kMaxPcmFrames = 24000 * HA_INTERVAL_20_MS / 1000;
+
+HearingAidEncoder* encoder = nullptr;
 
 inline void encoder_state_init() {
-  if (encoder_state_left != nullptr) {
+  if (encoder != nullptr) {
     LOG(WARNING) << __func__ << ": encoder already initialized";
     return;
   }
-  encoder_state_left = g722_encode_init(nullptr, 64000, G722_PACKED);
-  encoder_state_right = g722_encode_init(nullptr, 64000, G722_PACKED);
+  encoder = new HearingAidEncoder(kMaxPcmFrames);
 }
 
 inline void encoder_state_release() {
-  if (encoder_state_left != nullptr) {
-    g722_encode_release(encoder_state_left);
-    encoder_state_left = nullptr;
-    g722_encode_release(encoder_state_right);
-    encoder_state_right = nullptr;
+  if (encoder != nullptr) {
+    delete encoder;
+    encoder = nullptr;
   }
 }
 
@@ -978,7 +977,7 @@ class HearingAidImpl : public HearingAid {
   void StartSendingAudio(const HearingDevice& hearingDevice) {
     VLOG(0) << __func__ << ": device=" << hearingDevice.address;
 
-    if (encoder_state_left == nullptr) {
+    if (encoder == nullptr) {
       encoder_state_init();
       seq_counter = 0;
 
@@ -1047,9 +1046,11 @@ class HearingAidImpl : public HearingAid {
     }
     audio_running = true;
 
-    // TODO: shall we also reset the encoder ?
-    encoder_state_release();
-    encoder_state_init();
+    if (encoder == nullptr) {
+      encoder_state_init();
+    } else {
+      encoder->Reset();
+    }
     seq_counter = 0;
 
     for (auto& device : hearingDevices.devices) {
@@ -1154,51 +1155,14 @@ class HearingAidImpl : public HearingAid {
       return;
     }
 
-    std::vector<uint16_t> chan_left;
-    std::vector<uint16_t> chan_right;
-    if (left == nullptr || right == nullptr) {
-      for (int i = 0; i < num_samples; i++) {
-        const uint8_t* sample = data.data() + i * 4;
-
-        int16_t left = (int16_t)((*(sample + 1) << 8) + *sample) >> 1;
-
-        sample += 2;
-        int16_t right = (int16_t)((*(sample + 1) << 8) + *sample) >> 1;
-
-        uint16_t mono_data = (int16_t)(((uint32_t)left + (uint32_t)right) >> 1);
-        chan_left.push_back(mono_data);
-        chan_right.push_back(mono_data);
-      }
-    } else {
-      for (int i = 0; i < num_samples; i++) {
-        const uint8_t* sample = data.data() + i * 4;
-
-        uint16_t left = (int16_t)((*(sample + 1) << 8) + *sample) >> 1;
-        chan_left.push_back(left);
-
-        sample += 2;
-        uint16_t right = (int16_t)((*(sample + 1) << 8) + *sample) >> 1;
-        chan_right.push_back(right);
-      }
-    }
+    if (encoder == nullptr) encoder_state_init();
+    encoder->Encode(data.data(), num_samples, left != nullptr,
+                    right != nullptr);
 
     // TODO: monural, binarual check
 
     // divide encoded data into packets, add header, send.
-
-    // TODO: make those buffers static and global to prevent constant
-    // reallocations
-    // TODO: this should basically fit the encoded data, tune the size later
-    std::vector<uint8_t> encoded_data_left;
     if (left) {
-      // TODO: instead of a magic number, we need to figure out the correct
-      // buffer size
-      encoded_data_left.resize(4000);
-      int encoded_size =
-          g722_encode(encoder_state_left, encoded_data_left.data(),
-                      (const int16_t*)chan_left.data(), chan_left.size());
-      encoded_data_left.resize(encoded_size);
-
       uint16_t cid = GAP_ConnGetL2CAPCid(left->gap_handle);
       uint16_t packets_to_flush = L2CA_FlushChannel(cid, L2CAP_FLUSH_CHANS_GET);
       if (packets_to_flush) {
@@ -1213,16 +1177,7 @@ class HearingAidImpl : public HearingAid {
       check_and_do_rssi_read(left);
     }
 
-    std::vector<uint8_t> encoded_data_right;
     if (right) {
-      // TODO: instead of a magic number, we need to figure out the correct
-      // buffer size
-      encoded_data_right.resize(4000);
-      int encoded_size =
-          g722_encode(encoder_state_right, encoded_data_right.data(),
-                      (const int16_t*)chan_right.data(), chan_right.size());
-      encoded_data_right.resize(encoded_size);
-
       uint16_t cid = GAP_ConnGetL2CAPCid(right->gap_handle);
       uint16_t packets_to_flush = L2CA_FlushChannel(cid, L2CAP_FLUSH_CHANS_GET);
       if (packets_to_flush) {
@@ -1238,7 +1193,7 @@ class HearingAidImpl : public HearingAid {
     }
 
     size_t encoded_data_size =
-        std::max(encoded_data_left.size(), encoded_data_right.size());
+        std::max(encoder->left_size(), encoder->right_size());
 
     uint16_t packet_size =
         CalcCompressedAudioPacketSize(codec_in_use, default_data_interval_ms);
@@ -1246,11 +1201,11 @@ class HearingAidImpl : public HearingAid {
     for (size_t i = 0; i < encoded_data_size; i += packet_size) {
       if (left) {
         left->audio_stats.packet_send_count++;
-        SendAudio(encoded_data_left.data() + i, packet_size, left);
+        SendAudio(encoder->left_data() + i, packet_size, left);
       }
       if (right) {
         right->audio_stats.packet_send_count++;
-        SendAudio(encoded_data_right.data() + i, packet_size, right);
+        SendAudio(encoder->right_data() + i, packet_size, right);
       }
       seq_counter++;
     }
@@ -1258,7 +1213,7 @@ class HearingAidImpl : public HearingAid {
     if (right) right->audio_stats.frame_send_count++;
   }
 
-  void SendAudio(uint8_t* encoded_data, uint16_t packet_size,
+  void SendAudio(const uint8_t* encoded_data, uint16_t packet_size,
                  HearingDevice* hearingAid) {
     if (!hearingAid->playback_started || !hearingAid->command_acked) {
       VLOG(2) << __func__
@@ -1350,9 +1305,7 @@ class HearingAidImpl : public HearingAid {
         // TODO: make it into function
         HearingAidAudioSource::Stop();
         // TODO: kill the encoder only if all hearing aids are down.
-        // g722_encode_release(encoder_state);
-        // encoder_state_left = nulllptr;
-        // encoder_state_right = nulllptr;
+        // encoder_state_release();
         break;
       case GAP_EVT_CONN_UNCONGESTED:
         DVLOG(2) << "GAP_EVT_CONN_UNCONGESTED";
@@ -0,0 +1,88 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hearing_aid_encoder.h"
+
+namespace {
+
+/* One 16 bit little endian sample, scaled down to the 15 bits G.722 takes */
+inline int16_t PcmSample(const uint8_t* sample) {
+  return (int16_t)((sample[1] << 8) | sample[0]) >> 1;
+}
+
+/* The loops below have no branches nor dependencies between frames, so that
+ * the compiler vectorizes them. */
+
+void Deinterleave(const uint8_t* pcm, size_t num_frames, int16_t* left,
+                  int16_t* right) {
+  for (size_t i = 0; i < num_frames; i++) {
+    left[i] = PcmSample(pcm + i * 4);
+    right[i] = PcmSample(pcm + i * 4 + 2);
+  }
+}
+
+void Downmix(const uint8_t* pcm, size_t num_frames, int16_t* mono) {
+  for (size_t i = 0; i < num_frames; i++) {
+    int left = PcmSample(pcm + i * 4);
+    int right = PcmSample(pcm + i * 4 + 2);
+    mono[i] = (int16_t)((left + right) >> 1);
+  }
+}
+
+}  // namespace
+
+HearingAidEncoder::HearingAidEncoder(size_t max_frames) {
+  Reserve(max_frames);
+  Reset();
+}
+
+void HearingAidEncoder::Reset() {
+  for (int side = 0; side < kNumSides; side++) {
+    g722_encode_init(&state_[side], 64000, G722_PACKED);
+    encoded_size_[side] = 0;
+  }
+}
+
+void HearingAidEncoder::Encode(const uint8_t* pcm, size_t num_frames,
+                               bool left, bool right) {
+  encoded_size_[kLeft] = 0;
+  encoded_size_[kRight] = 0;
+  if (!left && !right) return;
+
+  Reserve(num_frames);
+  if (left && right) {
+    Deinterleave(pcm, num_frames, pcm_[kLeft].data(), pcm_[kRight].data());
+  } else {
+    Downmix(pcm, num_frames, pcm_[left ? kLeft : kRight].data());
+  }
+
+  const bool encode[kNumSides] = {left, right};
+  for (int side = 0; side < kNumSides; side++) {
+    if (!encode[side]) continue;
+    encoded_size_[side] =
+        g722_encode(&state_[side], encoded_[side].data(), pcm_[side].data(),
+                    num_frames);
+  }
+}
+
+void HearingAidEncoder::Reserve(size_t num_frames) {
+  if (pcm_[kLeft].size() >= num_frames) return;
+  for (int side = 0; side < kNumSides; side++) {
+    pcm_[side].resize(num_frames);
+    /* One 8 bit code per pair of samples, at 64 kbit/s */
+    encoded_[side].resize((num_frames + 1) / 2);
+  }
+}
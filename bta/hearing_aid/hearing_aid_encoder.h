@@ -0,0 +1,64 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "embdrv/g722/g722_enc_dec.h"
+
+/* HearingAidEncoder encodes the audio stream of one binaural pair of hearing
+ * aids to G.722, 64 kbit/s.
+ *
+ * It owns the codec state of both sides and the buffers the stream goes
+ * through, sized once for the largest PCM buffer: encoding does not
+ * allocate. Encoders share no state, so several pairs can be encoded at the
+ * same time, each from its own thread.
+ */
+class HearingAidEncoder {
+ public:
+  /* |max_frames| is the number of frames in the largest PCM buffer expected.
+   * A larger buffer grows the buffers once. */
+  explicit HearingAidEncoder(size_t max_frames);
+
+  /* Restarts both sides from the initial codec state. */
+  void Reset();
+
+  /* Encodes |num_frames| frames of 16 bit little endian stereo PCM for the
+   * sides that are set. When both are, each side is sent its own channel,
+   * otherwise the side is sent the downmix of both channels. |num_frames|
+   * must be even: G.722 encodes pairs of samples. */
+  void Encode(const uint8_t* pcm, size_t num_frames, bool left, bool right);
+
+  /* The G.722 data of the last Encode(), empty for a side not encoded. */
+  const uint8_t* left_data() const { return encoded_[kLeft].data(); }
+  size_t left_size() const { return encoded_size_[kLeft]; }
+  const uint8_t* right_data() const { return encoded_[kRight].data(); }
+  size_t right_size() const { return encoded_size_[kRight]; }
+
+ private:
+  enum { kLeft, kRight, kNumSides };
+
+  void Reserve(size_t num_frames);
+
+  g722_encode_state_t state_[kNumSides];
+  std::vector<int16_t> pcm_[kNumSides];
+  std::vector<uint8_t> encoded_[kNumSides];
+  size_t encoded_size_[kNumSides];
+};
@@ -709,6 +709,17 @@ void BTA_AvOffloadStartRsp(tBTA_AV_HNDL hndl, tBTA_AV_STATUS status);
  */
 int BTA_AvObtainPeerChannelIndex(const RawAddress& peer_address);
 
+/**
+ * Get the statistics of the AVDTP media transmit queue of the stream to a
+ * peer. Must be called on the main thread, which owns the queue.
+ *
+ * @param peer_address the peer address
+ * @param p_stats the statistics to fill in
+ * @return true if the peer has a stream, otherwise false
+ */
+bool BTA_AvGetMediaQueueStats(const RawAddress& peer_address,
+                              tAVDT_MEDIA_QUEUE_STATS* p_stats);
+
 /**
  * Dump debug-related information for the BTA AV module.
  *
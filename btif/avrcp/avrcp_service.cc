@@ -205,6 +205,36 @@ class MediaInterfaceWrapper : public MediaInterface {
                                bound_cb));
   }
 
+  void GetNowPlayingListRange(uint32_t start_item, uint32_t end_item,
+                              NowPlayingRangeCallback now_playing_cb) override {
+    auto cb_lambda = [](NowPlayingRangeCallback cb, std::string curr_media_id,
+                        std::vector<SongInfo> song_list) {
+      do_in_main_thread(FROM_HERE,
+                        base::Bind(cb, curr_media_id, std::move(song_list)));
+    };
+
+    auto bound_cb = base::Bind(cb_lambda, now_playing_cb);
+
+    do_in_avrcp_jni(base::Bind(&MediaInterface::GetNowPlayingListRange,
+                               base::Unretained(wrapped_), start_item,
+                               end_item, bound_cb));
+  }
+
+  void GetFolderItemsRange(uint16_t player_id, std::string media_id,
+                           uint32_t start_item, uint32_t end_item,
+                           FolderItemsRangeCallback folder_cb) override {
+    auto cb_lambda = [](FolderItemsRangeCallback cb,
+                        std::vector<ListItem> item_list) {
+      do_in_main_thread(FROM_HERE, base::Bind(cb, std::move(item_list)));
+    };
+
+    auto bound_cb = base::Bind(cb_lambda, folder_cb);
+
+    do_in_avrcp_jni(base::Bind(&MediaInterface::GetFolderItemsRange,
+                               base::Unretained(wrapped_), player_id, media_id,
+                               start_item, end_item, bound_cb));
+  }
+
   void SetBrowsedPlayer(uint16_t player_id,
                         SetBrowsedPlayerCallback browse_cb) override {
     auto cb_lambda = [](SetBrowsedPlayerCallback cb, bool success,
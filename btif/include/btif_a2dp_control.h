@@ -39,6 +39,17 @@ void btif_a2dp_command_ack(tA2DP_CTRL_ACK status);
 // |bytes_read| is the number of bytes to increment by.
 void btif_a2dp_control_log_bytes_read(uint32_t bytes_read);
 
+// Read up to |len| bytes of audio data from the shared memory PCM ring into
+// |p_buf|, waiting a little when the ring runs dry, and set |*p_bytes_read|
+// to the number of bytes read.
+// Returns false if the audio HAL does not stream through the ring, in which
+// case the audio data comes through the audio data socket.
+bool btif_a2dp_control_read_pcm_ring(uint8_t* p_buf, uint32_t len,
+                                     uint32_t* p_bytes_read);
+
+// Drop the audio data waiting in the shared memory PCM ring, if any.
+void btif_a2dp_control_flush_pcm_ring(void);
+
 // Set the audio delay reported to the audio HAL in uints of 1/10ms.
 // |delay| is the audio delay to set.
 void btif_a2dp_control_set_audio_delay(uint16_t delay);
@@ -0,0 +1,115 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "types/raw_address.h"
+
+/* A scan result, as handed to the scanner callbacks */
+struct ScanResult {
+  RawAddress bd_addr;
+  uint8_t device_type;
+  int8_t rssi;
+  uint8_t addr_type;
+  uint16_t ble_evt_type;
+  uint8_t ble_primary_phy;
+  uint8_t ble_secondary_phy;
+  uint8_t ble_advertising_sid;
+  int8_t ble_tx_power;
+  uint16_t ble_periodic_adv_int;
+};
+
+/* ScanResultBatch carries scan results from the stack thread to the JNI
+ * thread. The stack thread adds results as they come, and only schedules a
+ * delivery on the JNI thread when it adds to an empty batch; that delivery
+ * then hands over every result added until it runs. A burst of advertising
+ * reports so costs one task post rather than one per report.
+ *
+ * Results and their advertising data are copied into two buffers, which are
+ * swapped with the ones being delivered and keep their capacity, so once they
+ * have grown to the size of a batch, adding a result does not allocate.
+ */
+class ScanResultBatch {
+ public:
+  /* Queues |result|, with its |len| bytes of advertising data at |data|.
+   * Returns true if the batch was empty, in which case a Deliver() must be
+   * scheduled. */
+  bool Add(const ScanResult& result, const uint8_t* data, size_t len) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool was_empty = pending_.results.empty();
+    pending_.results.push_back(Entry{result, pending_.data.size(), len});
+    pending_.data.insert(pending_.data.end(), data, data + len);
+    return was_empty;
+  }
+
+  /* Calls |deliver(result, data, len)| for every queued result, in the order
+   * they were added. Must always be called on the same thread. Returns the
+   * number of results delivered. */
+  template <typename F>
+  size_t Deliver(F deliver) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      std::swap(pending_, delivering_);
+    }
+
+    for (const Entry& entry : delivering_.results) {
+      deliver(entry.result, delivering_.data.data() + entry.offset,
+              entry.len);
+    }
+
+    size_t delivered = delivering_.results.size();
+    delivering_.results.clear();
+    delivering_.data.clear();
+    return delivered;
+  }
+
+  /* Throws away the queued results, for when no Deliver() could be
+   * scheduled; the next Add() then returns true again. Unlike Deliver(), may
+   * be called on any thread. Returns the number of results dropped. */
+  size_t Drop() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t dropped = pending_.results.size();
+    pending_.results.clear();
+    pending_.data.clear();
+    return dropped;
+  }
+
+ private:
+  struct Entry {
+    ScanResult result;
+    /* where the advertising data is in Batch::data */
+    size_t offset;
+    size_t len;
+  };
+
+  struct Batch {
+    std::vector<Entry> results;
+    std::vector<uint8_t> data;
+  };
+
+  std::mutex mutex_;
+  Batch pending_;
+  /* only touched by Deliver() */
+  Batch delivering_;
+};
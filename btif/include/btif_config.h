@@ -25,34 +25,35 @@
 
 #include <list>
 #include <string>
+#include <string_view>
 #include "osi/include/config.h"
 
 static const char BTIF_CONFIG_MODULE[] = "btif_config_module";
 
 bool btif_config_has_section(const char* section);
-bool btif_config_exist(const std::string& section, const std::string& key);
-bool btif_config_get_int(const std::string& section, const std::string& key,
+bool btif_config_exist(std::string_view section, std::string_view key);
+bool btif_config_get_int(std::string_view section, std::string_view key,
                          int* value);
-bool btif_config_set_int(const std::string& section, const std::string& key,
+bool btif_config_set_int(std::string_view section, std::string_view key,
                          int value);
-bool btif_config_get_uint64(const std::string& section, const std::string& key,
+bool btif_config_get_uint64(std::string_view section, std::string_view key,
                             uint64_t* value);
-bool btif_config_set_uint64(const std::string& section, const std::string& key,
+bool btif_config_set_uint64(std::string_view section, std::string_view key,
                             uint64_t value);
-bool btif_config_get_str(const std::string& section, const std::string& key,
+bool btif_config_get_str(std::string_view section, std::string_view key,
                          char* value, int* size_bytes);
-bool btif_config_set_str(const std::string& section, const std::string& key,
+bool btif_config_set_str(std::string_view section, std::string_view key,
                          const std::string& value);
-bool btif_config_get_bin(const std::string& section, const std::string& key,
+bool btif_config_get_bin(std::string_view section, std::string_view key,
                          uint8_t* value, size_t* length);
-bool btif_config_set_bin(const std::string& section, const std::string& key,
+bool btif_config_set_bin(std::string_view section, std::string_view key,
                          const uint8_t* value, size_t length);
-bool btif_config_remove(const std::string& section, const std::string& key);
+bool btif_config_remove(std::string_view section, std::string_view key);
 
-size_t btif_config_get_bin_length(const std::string& section,
-                                  const std::string& key);
+size_t btif_config_get_bin_length(std::string_view section,
+                                  std::string_view key);
 
-std::list<section_t>& btif_config_sections();
+const std::list<section_t>& btif_config_sections();
 
 void btif_config_save(void);
 void btif_config_flush(void);
@@ -69,8 +69,11 @@
 #include "osi/include/allocation_tracker.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
+#include "osi/include/slab_allocator.h"
 #include "osi/include/wakelock.h"
 #include "stack/gatt/connection_manager.h"
+#include "stack/include/btm_ble_api.h"
+#include "stack/include/l2c_api.h"
 #include "stack_manager.h"
 
 using bluetooth::hearing_aid::HearingAidInterface;
@@ -142,6 +145,9 @@ static int init(bt_callbacks_t* callbacks, bool start_restricted,
 
 #ifdef BLUEDROID_DEBUG
   allocation_tracker_init();
+  slab_allocator_init(true);
+#else
+  slab_allocator_init(false);
 #endif
 
   bt_hal_cbacks = callbacks;
@@ -312,6 +318,8 @@ static void dump(int fd, const char** arguments) {
   btif_debug_av_dump(fd);
   bta_debug_av_dump(fd);
   stack_debug_avdtp_api_dump(fd);
+  stack_debug_btm_ble_dump(fd);
+  stack_debug_l2cap_dump(fd);
   bluetooth::avrcp::AvrcpService::DebugDump(fd);
   btif_debug_config_dump(fd);
   BTA_HfClientDumpStatistics(fd);
@@ -22,8 +22,12 @@
 #include <base/logging.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <unistd.h>
+
+#include <mutex>
 
 #include "audio_a2dp_hw/include/audio_a2dp_hw.h"
+#include "audio_a2dp_hw/include/audio_a2dp_hw_pcm_ring.h"
 #include "bt_common.h"
 #include "btif_a2dp.h"
 #include "btif_a2dp_control.h"
@@ -37,14 +41,31 @@
 
 #define A2DP_DATA_READ_POLL_MS 10
 
+/* Largest shared memory PCM ring the audio HAL may ask for */
+#define A2DP_PCM_RING_MAX_SZ (256 * 1024)
+
 struct {
   uint64_t total_bytes_read = 0;
   uint16_t audio_delay = 0;
   struct timespec timestamp = {};
 } delay_report_stats;
 
+/*
+ * The shared memory PCM ring, when the audio HAL streams through it instead of
+ * the audio data socket. The socket is still connected, to start and stop the
+ * stream, and |hangup_fd| is a copy of it to notice the audio HAL going away.
+ * Set up on the UIPC thread, read from on the A2DP source thread.
+ */
+static struct {
+  std::mutex mutex;
+  std::unique_ptr<A2dpPcmRing> ring;
+  int hangup_fd = -1;
+} pcm_ring_cb;
+
 static void btif_a2dp_data_cb(tUIPC_CH_ID ch_id, tUIPC_EVENT event);
 static void btif_a2dp_ctrl_cb(tUIPC_CH_ID ch_id, tUIPC_EVENT event);
+static void btif_a2dp_send_pcm_ring(uint32_t size);
+static void btif_a2dp_release_pcm_ring(void);
 
 /* We can have max one command pending */
 static tA2DP_CTRL_CMD a2dp_cmd_pending = A2DP_CTRL_CMD_NONE;
@@ -60,6 +81,7 @@ void btif_a2dp_control_cleanup(void) {
   if (a2dp_uipc != nullptr) {
     UIPC_Close(*a2dp_uipc, UIPC_CH_ID_ALL);
   }
+  btif_a2dp_release_pcm_ring();
 }
 
 static void btif_a2dp_recv_ctrl_data(void) {
@@ -302,6 +324,20 @@ static void btif_a2dp_recv_ctrl_data(void) {
                 sizeof(nsec));
       break;
     }
+    case A2DP_CTRL_GET_PCM_RING: {
+      uint32_t size = 0;
+
+      btif_a2dp_command_ack(A2DP_CTRL_ACK_SUCCESS);
+      if (UIPC_Read(*a2dp_uipc, UIPC_CH_ID_AV_CTRL, 0,
+                    reinterpret_cast<uint8_t*>(&size),
+                    sizeof(size)) != sizeof(size)) {
+        APPL_TRACE_ERROR("%s: Error reading PCM ring size from audio HAL",
+                         __func__);
+        break;
+      }
+      btif_a2dp_send_pcm_ring(size);
+      break;
+    }
     default:
       APPL_TRACE_ERROR("%s: UNSUPPORTED CMD (%d)", __func__, cmd);
       btif_a2dp_command_ack(A2DP_CTRL_ACK_FAILURE);
@@ -369,6 +405,15 @@ static void btif_a2dp_data_cb(UNUSED_ATTR tUIPC_CH_ID ch_id,
       UIPC_Ioctl(*a2dp_uipc, UIPC_CH_ID_AV_AUDIO, UIPC_SET_READ_POLL_TMO,
                  reinterpret_cast<void*>(A2DP_DATA_READ_POLL_MS));
 
+      {
+        std::lock_guard<std::mutex> lock(pcm_ring_cb.mutex);
+        if (pcm_ring_cb.ring != nullptr && pcm_ring_cb.hangup_fd == -1) {
+          int fd = -1;
+          UIPC_Ioctl(*a2dp_uipc, UIPC_CH_ID_AV_AUDIO, UIPC_GET_FD, &fd);
+          if (fd != -1) pcm_ring_cb.hangup_fd = dup(fd);
+        }
+      }
+
       if (btif_av_get_peer_sep() == AVDT_TSEP_SNK) {
         /* Start the media task to encode the audio */
         btif_a2dp_source_start_audio_req();
@@ -379,6 +424,7 @@ static void btif_a2dp_data_cb(UNUSED_ATTR tUIPC_CH_ID ch_id,
 
     case UIPC_CLOSE_EVT:
       APPL_TRACE_EVENT("%s: ## AUDIO PATH DETACHED ##", __func__);
+      btif_a2dp_release_pcm_ring();
       btif_a2dp_command_ack(A2DP_CTRL_ACK_SUCCESS);
       /*
        * Send stop request only if we are actively streaming and haven't
@@ -398,6 +444,76 @@ static void btif_a2dp_data_cb(UNUSED_ATTR tUIPC_CH_ID ch_id,
   }
 }
 
+static void btif_a2dp_send_pcm_ring(uint32_t size) {
+  std::lock_guard<std::mutex> lock(pcm_ring_cb.mutex);
+
+  // A new ring for every stream, so that nothing is left from the last one
+  pcm_ring_cb.ring.reset();
+  if (pcm_ring_cb.hangup_fd != -1) {
+    close(pcm_ring_cb.hangup_fd);
+    pcm_ring_cb.hangup_fd = -1;
+  }
+  if (size > 0 && size <= A2DP_PCM_RING_MAX_SZ) {
+    pcm_ring_cb.ring = A2dpPcmRing::Create(size);
+  }
+
+  uint32_t data_size = 0;
+  if (pcm_ring_cb.ring == nullptr) {
+    APPL_TRACE_WARNING("%s: no PCM ring of %u bytes, using the data socket",
+                       __func__, size);
+    UIPC_Send(*a2dp_uipc, UIPC_CH_ID_AV_CTRL, 0,
+              reinterpret_cast<uint8_t*>(&data_size), sizeof(data_size));
+    return;
+  }
+
+  data_size = pcm_ring_cb.ring->data_size();
+  const int fds[] = {pcm_ring_cb.ring->memfd(),
+                     pcm_ring_cb.ring->data_event_fd(),
+                     pcm_ring_cb.ring->space_event_fd()};
+  if (!UIPC_SendFds(*a2dp_uipc, UIPC_CH_ID_AV_CTRL,
+                    reinterpret_cast<uint8_t*>(&data_size), sizeof(data_size),
+                    fds, sizeof(fds) / sizeof(fds[0]))) {
+    pcm_ring_cb.ring.reset();
+    return;
+  }
+  APPL_TRACE_EVENT("%s: PCM ring of %u bytes", __func__, data_size);
+}
+
+static void btif_a2dp_release_pcm_ring(void) {
+  std::lock_guard<std::mutex> lock(pcm_ring_cb.mutex);
+  pcm_ring_cb.ring.reset();
+  if (pcm_ring_cb.hangup_fd != -1) {
+    close(pcm_ring_cb.hangup_fd);
+    pcm_ring_cb.hangup_fd = -1;
+  }
+}
+
+bool btif_a2dp_control_read_pcm_ring(uint8_t* p_buf, uint32_t len,
+                                     uint32_t* p_bytes_read) {
+  ssize_t n;
+  {
+    std::lock_guard<std::mutex> lock(pcm_ring_cb.mutex);
+    if (pcm_ring_cb.ring == nullptr) return false;
+
+    n = pcm_ring_cb.ring->Read(p_buf, len, A2DP_DATA_READ_POLL_MS,
+                               pcm_ring_cb.hangup_fd);
+  }
+
+  if (n < 0) {
+    // Same as a hang up seen by UIPC_Read() on the data socket
+    APPL_TRACE_WARNING("%s: audio HAL detached", __func__);
+    UIPC_Close(*a2dp_uipc, UIPC_CH_ID_AV_AUDIO);
+    n = 0;
+  }
+  *p_bytes_read = n;
+  return true;
+}
+
+void btif_a2dp_control_flush_pcm_ring(void) {
+  std::lock_guard<std::mutex> lock(pcm_ring_cb.mutex);
+  if (pcm_ring_cb.ring != nullptr) pcm_ring_cb.ring->Flush();
+}
+
 void btif_a2dp_command_ack(tA2DP_CTRL_ACK status) {
   uint8_t ack = status;
 
@@ -182,7 +182,8 @@ bool btif_a2dp_sink_init() {
     return false;
   }
 
-  btif_a2dp_sink_cb.rx_audio_queue = fixed_queue_new(SIZE_MAX);
+  btif_a2dp_sink_cb.rx_audio_queue = fixed_queue_new_with_mode(
+      MAX_INPUT_A2DP_FRAME_QUEUE_SZ, FIXED_QUEUE_MODE_MPSC);
 
   /* Schedule the rest of the operations */
   if (!btif_a2dp_sink_cb.worker_thread.EnableRealTimeScheduling()) {
@@ -28,7 +28,12 @@
 #include <limits.h>
 #include <string.h>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
 
+#include "a2dp_abr_controller.h"
 #include "audio_a2dp_hw/include/audio_a2dp_hw.h"
 #include "audio_hal_interface/a2dp_encoding.h"
 #include "bt_common.h"
@@ -40,6 +45,7 @@
 #include "btif_av.h"
 #include "btif_av_co.h"
 #include "btif_util.h"
+#include "btu.h"
 #include "common/message_loop_thread.h"
 #include "common/metrics.h"
 #include "common/repeating_timer.h"
@@ -63,6 +69,10 @@ extern std::unique_ptr<tUIPC_STATE> a2dp_uipc;
  */
 #define MAX_OUTPUT_A2DP_FRAME_QUEUE_SZ (MAX_PCM_FRAME_NUM_PER_TICK * 2)
 
+// How long a debug dump waits for the main thread to read the AVDTP media
+// queue stats
+#define A2DP_DUMP_MEDIA_QUEUE_STATS_TIMEOUT_MS 500
+
 class SchedulingStats {
  public:
   SchedulingStats() { Reset(); }
@@ -166,6 +176,42 @@ class BtifMediaStats {
   int codec_index = -1;
 };
 
+// The link metrics fed to the adaptive bit rate control. They are read on the
+// main thread, and passed to the media thread.
+class BtifA2dpLinkMetrics {
+ public:
+  BtifA2dpLinkMetrics() { Reset(); }
+  void Reset() {
+    peer_address = RawAddress::kEmpty;
+    media_queue_length = 0;
+    media_queue_dropped = 0;
+    congested_us = 0;
+    has_failed_contact_counter = false;
+    failed_contact_counter = 0;
+    has_rssi = false;
+    rssi = 0;
+    has_tx_power = false;
+    tx_power = 0;
+    has_automatic_flush_timeout = false;
+    automatic_flush_timeout = 0;
+  }
+
+  RawAddress peer_address;
+
+  size_t media_queue_length;     // AVDTP media packets waiting
+  uint64_t media_queue_dropped;  // AVDTP media packets dropped, not flushed
+  uint64_t congested_us;         // Time the media channel was congested
+
+  bool has_failed_contact_counter;
+  uint16_t failed_contact_counter;
+  bool has_rssi;
+  int8_t rssi;
+  bool has_tx_power;
+  int8_t tx_power;
+  bool has_automatic_flush_timeout;
+  uint16_t automatic_flush_timeout;
+};
+
 class BtifA2dpSource {
  public:
   enum RunState {
@@ -180,6 +226,10 @@ class BtifA2dpSource {
         tx_flush(false),
         encoder_interface(nullptr),
         encoder_interval_ms(0),
+        abr(A2DP_ABR_STEP_UP_INTERVALS),
+        abr_last_read_us(0),
+        abr_last_update_us(0),
+        abr_last_dropped_messages(0),
         state_(kStateOff) {}
 
   void Reset() {
@@ -192,9 +242,18 @@ class BtifA2dpSource {
     encoder_interval_ms = 0;
     stats.Reset();
     accumulated_stats.Reset();
+    ResetAbr();
     state_ = kStateOff;
   }
 
+  void ResetAbr() {
+    abr.Reset();
+    abr_link_metrics.Reset();
+    abr_last_read_us = 0;
+    abr_last_update_us = 0;
+    abr_last_dropped_messages = 0;
+  }
+
   BtifA2dpSource::RunState State() const { return state_; }
   std::string StateStr() const {
     switch (state_) {
@@ -219,6 +278,13 @@ class BtifA2dpSource {
   BtifMediaStats stats;
   BtifMediaStats accumulated_stats;
 
+  // Adaptive bit rate control, for the encoders without their own
+  A2dpAbrController abr;
+  BtifA2dpLinkMetrics abr_link_metrics;  // The last ones fed to |abr|
+  uint64_t abr_last_read_us;             // Last request of the link metrics
+  uint64_t abr_last_update_us;           // Last update of |abr|
+  size_t abr_last_dropped_messages;
+
  private:
   BtifA2dpSource::RunState state_;
 };
@@ -227,6 +293,15 @@ static bluetooth::common::MessageLoopThread btif_a2dp_source_thread(
     "bt_a2dp_source_worker_thread");
 static BtifA2dpSource btif_a2dp_source_cb;
 
+// The link metrics of the active peer: only used on the main thread
+static BtifA2dpLinkMetrics btif_a2dp_source_link_metrics;
+// Set while a read of the RSSI or of the Failed Contact Counter is in
+// flight, from either the ABR or a TX queue overflow. BTM runs one read of
+// each at a time, so the ABR skips its read rather than making the one on an
+// overflow fail.
+static std::atomic<bool> btif_a2dp_source_rssi_read_pending(false);
+static std::atomic<bool> btif_a2dp_source_fcc_read_pending(false);
+
 static void btif_a2dp_source_init_delayed(void);
 static void btif_a2dp_source_startup_delayed(void);
 static void btif_a2dp_source_start_session_delayed(
@@ -264,6 +339,18 @@ static void btm_read_rssi_cb(void* data);
 static void btm_read_failed_contact_counter_cb(void* data);
 static void btm_read_automatic_flush_timeout_cb(void* data);
 static void btm_read_tx_power_cb(void* data);
+static void btif_a2dp_source_abr_handle_timer(uint64_t timestamp_us);
+static void btif_a2dp_source_abr_read_link_metrics(
+    const RawAddress& peer_address);
+static void btif_a2dp_source_abr_update(BtifA2dpLinkMetrics link_metrics);
+static void btif_a2dp_source_abr_read_rssi_cb(void* data);
+static void btif_a2dp_source_abr_read_failed_contact_counter_cb(void* data);
+static void btif_a2dp_source_abr_read_automatic_flush_timeout_cb(void* data);
+static void btif_a2dp_source_abr_read_tx_power_cb(void* data);
+static void btif_a2dp_source_read_media_queue_stats(
+    const RawAddress& peer_address,
+    std::shared_ptr<tAVDT_MEDIA_QUEUE_STATS> media_queue_stats,
+    std::promise<bool> read_promise);
 
 void btif_a2dp_source_accumulate_scheduling_stats(SchedulingStats* src,
                                                   SchedulingStats* dst) {
@@ -341,7 +428,10 @@ bool btif_a2dp_source_startup(void) {
 
   btif_a2dp_source_cb.Reset();
   btif_a2dp_source_cb.SetState(BtifA2dpSource::kStateStartingUp);
-  btif_a2dp_source_cb.tx_audio_queue = fixed_queue_new(SIZE_MAX);
+  // The encoder thread is the only producer; the overflow handling below
+  // also drains the queue from that thread while the BTA thread reads it.
+  btif_a2dp_source_cb.tx_audio_queue = fixed_queue_new_with_mode(
+      MAX_OUTPUT_A2DP_FRAME_QUEUE_SZ * 2, FIXED_QUEUE_MODE_MPSC);
 
   // Schedule the rest of the operations
   btif_a2dp_source_thread.DoInThread(
@@ -779,6 +869,13 @@ static void btif_a2dp_source_audio_tx_start_event(void) {
   if (codec_config != nullptr) {
     btif_a2dp_source_cb.stats.codec_index = codec_config->codecIndex();
   }
+
+  // Start over at the full bit rate
+  btif_a2dp_source_cb.ResetAbr();
+  if (btif_a2dp_source_cb.encoder_interface->set_bitrate_percent != nullptr) {
+    btif_a2dp_source_cb.encoder_interface->set_bitrate_percent(
+        btif_a2dp_source_cb.abr.bitrate_percent());
+  }
 }
 
 static void btif_a2dp_source_audio_tx_stop_event(void) {
@@ -804,8 +901,12 @@ static void btif_a2dp_source_audio_tx_stop_event(void) {
     btif_a2dp_control_log_bytes_read(
         bluetooth::audio::a2dp::read(p_buf, sizeof(p_buf)));
   } else if (a2dp_uipc != nullptr) {
-    btif_a2dp_control_log_bytes_read(UIPC_Read(*a2dp_uipc, UIPC_CH_ID_AV_AUDIO,
-                                               &event, p_buf, sizeof(p_buf)));
+    uint32_t bytes_read;
+    if (!btif_a2dp_control_read_pcm_ring(p_buf, sizeof(p_buf), &bytes_read)) {
+      bytes_read = UIPC_Read(*a2dp_uipc, UIPC_CH_ID_AV_AUDIO, &event, p_buf,
+                             sizeof(p_buf));
+    }
+    btif_a2dp_control_log_bytes_read(bytes_read);
   }
 
   /* Stop the timer first */
@@ -868,6 +969,138 @@ static void btif_a2dp_source_audio_handle_timer(void) {
   update_scheduling_stats(&btif_a2dp_source_cb.stats.tx_queue_enqueue_stats,
                           timestamp_us,
                           btif_a2dp_source_cb.encoder_interval_ms * 1000);
+  btif_a2dp_source_abr_handle_timer(timestamp_us);
+}
+
+// Returns the increase of a counter, or 0 if it was reset in between.
+static uint64_t counter_delta(uint64_t value, uint64_t last_value) {
+  return (value >= last_value) ? value - last_value : 0;
+}
+
+static void btif_a2dp_source_abr_handle_timer(uint64_t timestamp_us) {
+  if (btif_a2dp_source_cb.encoder_interface->set_bitrate_percent == nullptr)
+    return;
+  if (timestamp_us - btif_a2dp_source_cb.abr_last_read_us <
+      A2DP_ABR_INTERVAL_MS * 1000) {
+    return;
+  }
+  btif_a2dp_source_cb.abr_last_read_us = timestamp_us;
+
+  // The link metrics are read on the main thread, which sends them back
+  do_in_main_thread(FROM_HERE,
+                    base::Bind(&btif_a2dp_source_abr_read_link_metrics,
+                               btif_av_source_active_peer()));
+}
+
+static void btif_a2dp_source_abr_read_link_metrics(
+    const RawAddress& peer_address) {
+  BtifA2dpLinkMetrics& link_metrics = btif_a2dp_source_link_metrics;
+  if (link_metrics.peer_address != peer_address) {
+    link_metrics.Reset();
+    link_metrics.peer_address = peer_address;
+  }
+
+  tAVDT_MEDIA_QUEUE_STATS media_queue_stats;
+  if (BTA_AvGetMediaQueueStats(peer_address, &media_queue_stats)) {
+    link_metrics.media_queue_length = media_queue_stats.depth;
+    link_metrics.media_queue_dropped =
+        media_queue_stats.dropped[AVDT_MEDIA_DROP_OVERFLOW] +
+        media_queue_stats.dropped[AVDT_MEDIA_DROP_EXPIRED];
+    link_metrics.congested_us = media_queue_stats.congested_us;
+  }
+  btif_a2dp_source_thread.DoInThread(
+      FROM_HERE, base::Bind(&btif_a2dp_source_abr_update, link_metrics));
+
+  // The results are sent with the next update. While a read is in flight,
+  // such as one sent on a TX queue overflow, its result is used instead.
+  if (!btif_a2dp_source_rssi_read_pending.exchange(true) &&
+      BTM_ReadRSSI(peer_address, btif_a2dp_source_abr_read_rssi_cb) !=
+          BTM_CMD_STARTED) {
+    LOG_VERBOSE(LOG_TAG, "%s: Cannot read RSSI", __func__);
+    btif_a2dp_source_rssi_read_pending = false;
+  }
+  if (!btif_a2dp_source_fcc_read_pending.exchange(true) &&
+      BTM_ReadFailedContactCounter(
+          peer_address, btif_a2dp_source_abr_read_failed_contact_counter_cb) !=
+          BTM_CMD_STARTED) {
+    LOG_VERBOSE(LOG_TAG, "%s: Cannot read Failed Contact Counter", __func__);
+    btif_a2dp_source_fcc_read_pending = false;
+  }
+  // The Tx Power and the flush timeout are only shown in the dump, so they
+  // are read once per peer rather than taking the BTM request slot from the
+  // reads on a TX queue overflow every interval.
+  if (!link_metrics.has_tx_power &&
+      BTM_ReadTxPower(peer_address, BT_TRANSPORT_BR_EDR,
+                      btif_a2dp_source_abr_read_tx_power_cb) !=
+          BTM_CMD_STARTED) {
+    LOG_VERBOSE(LOG_TAG, "%s: Cannot read Tx Power", __func__);
+  }
+  if (!link_metrics.has_automatic_flush_timeout &&
+      BTM_ReadAutomaticFlushTimeout(
+          peer_address, btif_a2dp_source_abr_read_automatic_flush_timeout_cb) !=
+          BTM_CMD_STARTED) {
+    LOG_VERBOSE(LOG_TAG, "%s: Cannot read Automatic Flush Timeout", __func__);
+  }
+}
+
+static void btif_a2dp_source_abr_update(BtifA2dpLinkMetrics link_metrics) {
+  if (!btif_a2dp_source_cb.media_alarm.IsScheduled() ||
+      btif_a2dp_source_cb.encoder_interface == nullptr ||
+      btif_a2dp_source_cb.encoder_interface->set_bitrate_percent == nullptr) {
+    return;
+  }
+
+  uint64_t now_us = bluetooth::common::time_get_os_boottime_us();
+  size_t dropped_messages =
+      btif_a2dp_source_cb.stats.tx_queue_total_dropped_messages;
+  const BtifA2dpLinkMetrics& last = btif_a2dp_source_cb.abr_link_metrics;
+
+  // The first metrics of the stream only serve as a base for the next ones
+  if (btif_a2dp_source_cb.abr_last_update_us != 0 &&
+      link_metrics.peer_address == last.peer_address) {
+    tA2DP_ABR_METRICS metrics;
+    memset(&metrics, 0, sizeof(metrics));
+    metrics.interval_ms =
+        (now_us - btif_a2dp_source_cb.abr_last_update_us) / 1000;
+    metrics.queue_length =
+        fixed_queue_length(btif_a2dp_source_cb.tx_audio_queue) +
+        link_metrics.media_queue_length;
+    metrics.queue_capacity =
+        MAX_OUTPUT_A2DP_FRAME_QUEUE_SZ + AVDT_MEDIA_QUEUE_SIZE;
+    metrics.dropped_packets =
+        counter_delta(dropped_messages,
+                      btif_a2dp_source_cb.abr_last_dropped_messages) +
+        counter_delta(link_metrics.media_queue_dropped,
+                      last.media_queue_dropped);
+    metrics.congested_ms =
+        counter_delta(link_metrics.congested_us, last.congested_us) / 1000;
+    if (link_metrics.has_failed_contact_counter &&
+        last.has_failed_contact_counter) {
+      metrics.failed_contacts =
+          counter_delta(link_metrics.failed_contact_counter,
+                        last.failed_contact_counter);
+    }
+    metrics.has_rssi = link_metrics.has_rssi;
+    metrics.rssi = link_metrics.rssi;
+
+    uint8_t last_bitrate_percent = btif_a2dp_source_cb.abr.bitrate_percent();
+    uint8_t bitrate_percent = btif_a2dp_source_cb.abr.Update(metrics);
+    if (bitrate_percent != last_bitrate_percent) {
+      LOG_INFO(LOG_TAG,
+               "%s: bit rate %d%% -> %d%%: queue %zu/%zu dropped %u "
+               "congested %u ms failed contacts %u rssi %d",
+               __func__, last_bitrate_percent, bitrate_percent,
+               metrics.queue_length, metrics.queue_capacity,
+               metrics.dropped_packets, metrics.congested_ms,
+               metrics.failed_contacts, metrics.rssi);
+      btif_a2dp_source_cb.encoder_interface->set_bitrate_percent(
+          bitrate_percent);
+    }
+  }
+
+  btif_a2dp_source_cb.abr_link_metrics = link_metrics;
+  btif_a2dp_source_cb.abr_last_update_us = now_us;
+  btif_a2dp_source_cb.abr_last_dropped_messages = dropped_messages;
 }
 
 static uint32_t btif_a2dp_source_read_callback(uint8_t* p_buf, uint32_t len) {
@@ -876,7 +1109,9 @@ static uint32_t btif_a2dp_source_read_callback(uint8_t* p_buf, uint32_t len) {
 
   if (bluetooth::audio::a2dp::is_hal_2_0_enabled()) {
     bytes_read = bluetooth::audio::a2dp::read(p_buf, len);
-  } else if (a2dp_uipc != nullptr) {
+  } else if (a2dp_uipc != nullptr &&
+             !btif_a2dp_control_read_pcm_ring(p_buf, len, &bytes_read)) {
+    // The audio HAL does not share a PCM ring: read from the data socket
     bytes_read = UIPC_Read(*a2dp_uipc, UIPC_CH_ID_AV_AUDIO, &event, p_buf, len);
   }
 
@@ -932,22 +1167,24 @@ static bool btif_a2dp_source_enqueue_callback(BT_HDR* p_buf, size_t frames_n,
     btif_a2dp_source_cb.stats.tx_queue_dropouts++;
     btif_a2dp_source_cb.stats.tx_queue_last_dropouts_us = now_us;
 
-    // Flush all queued buffers
-    size_t drop_n = fixed_queue_length(btif_a2dp_source_cb.tx_audio_queue);
+    // Drop the oldest buffers, just enough to make room: the ones queued
+    // last are the only ones that can still be played in time.
+    size_t queue_n = fixed_queue_length(btif_a2dp_source_cb.tx_audio_queue);
+    size_t drop_n =
+        std::min(queue_n, queue_n + frames_n - MAX_OUTPUT_A2DP_FRAME_QUEUE_SZ);
     btif_a2dp_source_cb.stats.tx_queue_max_dropped_messages = std::max(
         drop_n, btif_a2dp_source_cb.stats.tx_queue_max_dropped_messages);
     int num_dropped_encoded_bytes = 0;
     int num_dropped_encoded_frames = 0;
-    while (fixed_queue_length(btif_a2dp_source_cb.tx_audio_queue)) {
-      btif_a2dp_source_cb.stats.tx_queue_total_dropped_messages++;
+    for (size_t i = 0; i < drop_n; i++) {
       void* p_data =
           fixed_queue_try_dequeue(btif_a2dp_source_cb.tx_audio_queue);
-      if (p_data != nullptr) {
-        auto p_dropped_buf = static_cast<BT_HDR*>(p_data);
-        num_dropped_encoded_bytes += p_dropped_buf->len;
-        num_dropped_encoded_frames += p_dropped_buf->layer_specific;
-        osi_free(p_data);
-      }
+      if (p_data == nullptr) break;
+      btif_a2dp_source_cb.stats.tx_queue_total_dropped_messages++;
+      auto p_dropped_buf = static_cast<BT_HDR*>(p_data);
+      num_dropped_encoded_bytes += p_dropped_buf->len;
+      num_dropped_encoded_frames += p_dropped_buf->layer_specific;
+      osi_free(p_data);
     }
     bluetooth::common::LogA2dpAudioOverrunEvent(
         btif_av_source_active_peer(), drop_n,
@@ -956,15 +1193,19 @@ static bool btif_a2dp_source_enqueue_callback(BT_HDR* p_buf, size_t frames_n,
 
     // Request additional debug info if we had to flush buffers
     RawAddress peer_bda = btif_av_source_active_peer();
+    btif_a2dp_source_rssi_read_pending = true;
     tBTM_STATUS status = BTM_ReadRSSI(peer_bda, btm_read_rssi_cb);
     if (status != BTM_CMD_STARTED) {
       LOG_WARN(LOG_TAG, "%s: Cannot read RSSI: status %d", __func__, status);
+      btif_a2dp_source_rssi_read_pending = false;
     }
+    btif_a2dp_source_fcc_read_pending = true;
     status = BTM_ReadFailedContactCounter(peer_bda,
                                           btm_read_failed_contact_counter_cb);
     if (status != BTM_CMD_STARTED) {
       LOG_WARN(LOG_TAG, "%s: Cannot read Failed Contact Counter: status %d",
                __func__, status);
+      btif_a2dp_source_fcc_read_pending = false;
     }
     status = BTM_ReadAutomaticFlushTimeout(peer_bda,
                                            btm_read_automatic_flush_timeout_cb);
@@ -1007,6 +1248,7 @@ static void btif_a2dp_source_audio_tx_flush_event(void) {
   fixed_queue_flush(btif_a2dp_source_cb.tx_audio_queue, osi_free);
 
   if (!bluetooth::audio::a2dp::is_hal_2_0_enabled() && a2dp_uipc != nullptr) {
+    btif_a2dp_control_flush_pcm_ring();
     UIPC_Ioctl(*a2dp_uipc, UIPC_CH_ID_AV_AUDIO, UIPC_REQ_RX_FLUSH, nullptr);
   }
 }
@@ -1248,6 +1490,141 @@ void btif_a2dp_source_debug_dump(int fd) {
       (unsigned long long)dequeue_stats->max_premature_scheduling_delta_us /
           1000,
       (unsigned long long)ave_time_us / 1000);
+
+  //
+  // Adaptive bit rate stats
+  //
+  if (btif_a2dp_source_cb.encoder_interface != nullptr &&
+      btif_a2dp_source_cb.encoder_interface->set_bitrate_percent != nullptr) {
+    const tA2DP_ABR_STATS& abr_stats = btif_a2dp_source_cb.abr.stats();
+    const BtifA2dpLinkMetrics& link_metrics =
+        btif_a2dp_source_cb.abr_link_metrics;
+    dprintf(fd, "  Adaptive bit rate:\n");
+
+    dprintf(fd,
+            "  Bit rate in percent (now/min)                           : %u / "
+            "%u\n",
+            btif_a2dp_source_cb.abr.bitrate_percent(),
+            abr_stats.min_bitrate_percent);
+
+    dprintf(fd,
+            "  Steps (down/up)                                         : "
+            "%llu / %llu\n",
+            (unsigned long long)abr_stats.step_downs,
+            (unsigned long long)abr_stats.step_ups);
+
+    dprintf(fd,
+            "  Intervals (total/marginal/bad/critical)                 : "
+            "%llu / %llu / %llu / %llu\n",
+            (unsigned long long)abr_stats.intervals,
+            (unsigned long long)abr_stats.marginal_intervals,
+            (unsigned long long)abr_stats.bad_intervals,
+            (unsigned long long)abr_stats.critical_intervals);
+
+    if (link_metrics.has_rssi) {
+      dprintf(fd,
+              "  RSSI                                                    : "
+              "%d\n",
+              link_metrics.rssi);
+    }
+    if (link_metrics.has_tx_power) {
+      dprintf(fd,
+              "  Tx Power                                                : "
+              "%d\n",
+              link_metrics.tx_power);
+    }
+    if (link_metrics.has_failed_contact_counter) {
+      dprintf(fd,
+              "  Failed Contact Counter                                  : "
+              "%u\n",
+              link_metrics.failed_contact_counter);
+    }
+    if (link_metrics.has_automatic_flush_timeout) {
+      dprintf(fd,
+              "  Automatic Flush Timeout                                 : "
+              "%u\n",
+              link_metrics.automatic_flush_timeout);
+    }
+  }
+
+  //
+  // AVDTP media queue stats
+  //
+  // The media queue belongs to the main thread. The stats are shared with the
+  // read, so that it has somewhere to write them if the wait gives up.
+  auto media_queue_stats_ptr = std::make_shared<tAVDT_MEDIA_QUEUE_STATS>();
+  std::promise<bool> read_promise;
+  std::future<bool> read_future = read_promise.get_future();
+  if (do_in_main_thread(
+          FROM_HERE,
+          base::BindOnce(&btif_a2dp_source_read_media_queue_stats,
+                         btif_av_source_active_peer(), media_queue_stats_ptr,
+                         std::move(read_promise))) != BT_STATUS_SUCCESS ||
+      read_future.wait_for(std::chrono::milliseconds(
+          A2DP_DUMP_MEDIA_QUEUE_STATS_TIMEOUT_MS)) !=
+          std::future_status::ready ||
+      !read_future.get()) {
+    return;
+  }
+  const tAVDT_MEDIA_QUEUE_STATS& media_queue_stats = *media_queue_stats_ptr;
+  dprintf(fd, "  AVDTP media queue:\n");
+
+  dprintf(fd,
+          "  Queue depth in packets (now/max)                        : %u / "
+          "%u\n",
+          media_queue_stats.depth, media_queue_stats.max_depth);
+
+  dprintf(fd,
+          "  Queue depth in bytes (now)                              : %u\n",
+          media_queue_stats.depth_bytes);
+
+  dprintf(fd,
+          "  Counts (enqueued/sent)                                  : %llu / "
+          "%llu\n",
+          (unsigned long long)media_queue_stats.enqueued,
+          (unsigned long long)media_queue_stats.sent);
+
+  const uint64_t* dropped = media_queue_stats.dropped;
+  dprintf(fd,
+          "  Drop counts (overflow/expired/flushed)                  : %llu / "
+          "%llu / %llu\n",
+          (unsigned long long)dropped[AVDT_MEDIA_DROP_OVERFLOW],
+          (unsigned long long)dropped[AVDT_MEDIA_DROP_EXPIRED],
+          (unsigned long long)dropped[AVDT_MEDIA_DROP_FLUSHED]);
+
+  dprintf(fd,
+          "  Congestion (count/total time in ms)                     : %llu / "
+          "%llu\n",
+          (unsigned long long)media_queue_stats.congestion_count,
+          (unsigned long long)media_queue_stats.congested_us / 1000);
+
+  ave_time_us = 0;
+  if (media_queue_stats.sent != 0) {
+    ave_time_us = media_queue_stats.total_latency_us / media_queue_stats.sent;
+  }
+  dprintf(fd,
+          "  Queueing time in ms (max/ave)                           : %llu / "
+          "%llu\n",
+          (unsigned long long)media_queue_stats.max_latency_us / 1000,
+          (unsigned long long)ave_time_us / 1000);
+
+  static const char* const kLatencyBuckets[AVDT_MEDIA_LATENCY_BUCKETS] = {
+      "<1",    "1-2",    "2-5",     "5-10", "10-20",
+      "20-50", "50-100", "100-200", ">=200"};
+  dprintf(fd, "  Queueing time histogram in ms                           :");
+  for (size_t i = 0; i < AVDT_MEDIA_LATENCY_BUCKETS; i++) {
+    dprintf(fd, " %s:%llu", kLatencyBuckets[i],
+            (unsigned long long)media_queue_stats.latency_hist[i]);
+  }
+  dprintf(fd, "\n");
+}
+
+static void btif_a2dp_source_read_media_queue_stats(
+    const RawAddress& peer_address,
+    std::shared_ptr<tAVDT_MEDIA_QUEUE_STATS> media_queue_stats,
+    std::promise<bool> read_promise) {
+  read_promise.set_value(
+      BTA_AvGetMediaQueueStats(peer_address, media_queue_stats.get()));
 }
 
 static void btif_a2dp_source_update_metrics(void) {
@@ -1298,6 +1675,9 @@ static void btif_a2dp_source_update_metrics(void) {
 }
 
 static void btm_read_rssi_cb(void* data) {
+  // The ABR uses the result too
+  btif_a2dp_source_abr_read_rssi_cb(data);
+
   if (data == nullptr) {
     LOG_ERROR(LOG_TAG, "%s: Read RSSI request timed out", __func__);
     return;
@@ -1318,6 +1698,8 @@ static void btm_read_rssi_cb(void* data) {
 }
 
 static void btm_read_failed_contact_counter_cb(void* data) {
+  btif_a2dp_source_abr_read_failed_contact_counter_cb(data);
+
   if (data == nullptr) {
     LOG_ERROR(LOG_TAG, "%s: Read Failed Contact Counter request timed out",
               __func__);
@@ -1377,3 +1759,51 @@ static void btm_read_tx_power_cb(void* data) {
   LOG_WARN(LOG_TAG, "%s: device: %s, Tx Power: %d", __func__,
            result->rem_bda.ToString().c_str(), result->tx_power);
 }
+
+static void btif_a2dp_source_abr_read_rssi_cb(void* data) {
+  btif_a2dp_source_rssi_read_pending = false;
+  tBTM_RSSI_RESULT* result = (tBTM_RSSI_RESULT*)data;
+  BtifA2dpLinkMetrics& link_metrics = btif_a2dp_source_link_metrics;
+  if (result == nullptr || result->status != BTM_SUCCESS ||
+      result->rem_bda != link_metrics.peer_address) {
+    return;
+  }
+  link_metrics.has_rssi = true;
+  link_metrics.rssi = result->rssi;
+}
+
+static void btif_a2dp_source_abr_read_failed_contact_counter_cb(void* data) {
+  btif_a2dp_source_fcc_read_pending = false;
+  tBTM_FAILED_CONTACT_COUNTER_RESULT* result =
+      (tBTM_FAILED_CONTACT_COUNTER_RESULT*)data;
+  BtifA2dpLinkMetrics& link_metrics = btif_a2dp_source_link_metrics;
+  if (result == nullptr || result->status != BTM_SUCCESS ||
+      result->rem_bda != link_metrics.peer_address) {
+    return;
+  }
+  link_metrics.has_failed_contact_counter = true;
+  link_metrics.failed_contact_counter = result->failed_contact_counter;
+}
+
+static void btif_a2dp_source_abr_read_automatic_flush_timeout_cb(void* data) {
+  tBTM_AUTOMATIC_FLUSH_TIMEOUT_RESULT* result =
+      (tBTM_AUTOMATIC_FLUSH_TIMEOUT_RESULT*)data;
+  BtifA2dpLinkMetrics& link_metrics = btif_a2dp_source_link_metrics;
+  if (result == nullptr || result->status != BTM_SUCCESS ||
+      result->rem_bda != link_metrics.peer_address) {
+    return;
+  }
+  link_metrics.has_automatic_flush_timeout = true;
+  link_metrics.automatic_flush_timeout = result->automatic_flush_timeout;
+}
+
+static void btif_a2dp_source_abr_read_tx_power_cb(void* data) {
+  tBTM_TX_POWER_RESULT* result = (tBTM_TX_POWER_RESULT*)data;
+  BtifA2dpLinkMetrics& link_metrics = btif_a2dp_source_link_metrics;
+  if (result == nullptr || result->status != BTM_SUCCESS ||
+      result->rem_bda != link_metrics.peer_address) {
+    return;
+  }
+  link_metrics.has_tx_power = true;
+  link_metrics.tx_power = result->tx_power;
+}
@@ -36,6 +36,7 @@
 #include "advertise_data_parser.h"
 #include "bta_api.h"
 #include "bta_gatt_api.h"
+#include "btif_ble_scan_batch.h"
 #include "btif_config.h"
 #include "btif_dm.h"
 #include "btif_gatt.h"
@@ -157,6 +158,20 @@ void bta_scan_results_cb_impl(RawAddress bd_addr, tBT_DEVICE_TYPE device_type,
             ble_tx_power, rssi, ble_periodic_adv_int, std::move(value));
 }
 
+// Scan results on their way to the jni thread
+ScanResultBatch scan_results;
+
+void bta_scan_results_deliver() {
+  scan_results.Deliver(
+      [](const ScanResult& r, const uint8_t* data, size_t len) {
+        bta_scan_results_cb_impl(r.bd_addr, r.device_type, r.rssi, r.addr_type,
+                                 r.ble_evt_type, r.ble_primary_phy,
+                                 r.ble_secondary_phy, r.ble_advertising_sid,
+                                 r.ble_tx_power, r.ble_periodic_adv_int,
+                                 vector<uint8_t>(data, data + len));
+      });
+}
+
 void bta_scan_results_cb(tBTA_DM_SEARCH_EVT event, tBTA_DM_SEARCH* p_data) {
   uint8_t len;
 
@@ -171,23 +186,32 @@ void bta_scan_results_cb(tBTA_DM_SEARCH_EVT event, tBTA_DM_SEARCH* p_data) {
     return;
   }
 
-  vector<uint8_t> value;
-  if (p_data->inq_res.p_eir) {
-    value.insert(value.begin(), p_data->inq_res.p_eir,
-                 p_data->inq_res.p_eir + p_data->inq_res.eir_len);
+  tBTA_DM_INQ_RES* r = &p_data->inq_res;
+  uint16_t eir_len = 0;
+  if (r->p_eir) {
+    eir_len = r->eir_len;
 
     if (AdvertiseDataParser::GetFieldByType(
-            value, BTM_EIR_COMPLETE_LOCAL_NAME_TYPE, &len)) {
-      p_data->inq_res.remt_name_not_required = true;
+            r->p_eir, eir_len, BTM_EIR_COMPLETE_LOCAL_NAME_TYPE, &len)) {
+      r->remt_name_not_required = true;
     }
   }
 
-  tBTA_DM_INQ_RES* r = &p_data->inq_res;
-  do_in_jni_thread(Bind(bta_scan_results_cb_impl, r->bd_addr, r->device_type,
-                        r->rssi, r->ble_addr_type, r->ble_evt_type,
-                        r->ble_primary_phy, r->ble_secondary_phy,
-                        r->ble_advertising_sid, r->ble_tx_power,
-                        r->ble_periodic_adv_int, std::move(value)));
+  ScanResult result = {r->bd_addr,
+                       r->device_type,
+                       r->rssi,
+                       r->ble_addr_type,
+                       r->ble_evt_type,
+                       r->ble_primary_phy,
+                       r->ble_secondary_phy,
+                       r->ble_advertising_sid,
+                       r->ble_tx_power,
+                       r->ble_periodic_adv_int};
+  if (scan_results.Add(result, r->p_eir, eir_len) &&
+      do_in_jni_thread(Bind(bta_scan_results_deliver)) != BT_STATUS_SUCCESS) {
+    // Nothing would ever deliver the batch, and so schedule the next one
+    scan_results.Drop();
+  }
 }
 
 void bta_track_adv_event_cb(tBTM_BLE_TRACK_ADV_DATA* p_track_adv_data) {
@@ -20,8 +20,12 @@
 
 #include "btif_config.h"
 
+#include <base/files/file_util.h>
 #include <base/logging.h>
+#include <base/strings/string_number_conversions.h>
+#include <base/strings/string_split.h>
 #include <ctype.h>
+#include <errno.h>
 #include <openssl/rand.h>
 #include <openssl/sha.h>
 #include <private/android_filesystem_config.h>
@@ -29,6 +33,7 @@
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
+#include <algorithm>
 #include <mutex>
 #include <sstream>
 #include <string>
@@ -45,6 +50,7 @@
 #include "osi/include/allocator.h"
 #include "osi/include/compat.h"
 #include "osi/include/config.h"
+#include "osi/include/config_journal.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
 #include "osi/include/properties.h"
@@ -58,6 +64,11 @@
 #define DISABLED "disabled"
 static const char* TIME_STRING_FORMAT = "%Y-%m-%d %H:%M:%S";
 
+// A device section is only kept across restarts if it holds one of these
+static const char* PAIRING_KEYS[] = {"LinkKey",     "LE_KEY_PENC",
+                                     "LE_KEY_PID",  "LE_KEY_PCSRK",
+                                     "LE_KEY_LENC", "LE_KEY_LCSRK"};
+
 constexpr int kBufferSize = 400 * 10;  // initial file is ~400B
 
 static bool use_key_attestation() {
@@ -74,6 +85,7 @@ using bluetooth::common::AddressObfuscator;
 static const char* CONFIG_FILE_PATH = "bt_config.conf";
 static const char* CONFIG_BACKUP_PATH = "bt_config.bak";
 static const char* CONFIG_LEGACY_FILE_PATH = "bt_config.xml";
+static const char* CONFIG_JOURNAL_PATH = "bt_config.journal";
 #else   // !defined(OS_GENERIC)
 static const char* CONFIG_FILE_PATH = "/data/misc/bluedroid/bt_config.conf";
 static const char* CONFIG_BACKUP_PATH = "/data/misc/bluedroid/bt_config.bak";
@@ -81,19 +93,35 @@ static const char* CONFIG_FILE_CHECKSUM_PATH = "/data/misc/bluedroid/bt_config.c
 static const char* CONFIG_BACKUP_CHECKSUM_PATH = "/data/misc/bluedroid/bt_config.bak.encrypted-checksum";
 static const char* CONFIG_LEGACY_FILE_PATH =
     "/data/misc/bluedroid/bt_config.xml";
+static const char* CONFIG_JOURNAL_PATH = "/data/misc/bluedroid/bt_config.journal";
+static const char* CONFIG_JOURNAL_CHECKSUM_PATH = "/data/misc/bluedroid/bt_config.journal.encrypted-checksum";
 #endif  // defined(OS_GENERIC)
 static const uint64_t CONFIG_SETTLE_PERIOD_MS = 3000;
+// The journal is compacted into the config file once it is larger than the
+// config file, or than this, whichever is larger.
+static const size_t CONFIG_JOURNAL_MIN_COMPACT_SIZE = 16 * 1024;
 
 static void timer_config_save_cb(void* data);
 static void btif_config_write(uint16_t event, char* p_param);
 static bool is_factory_reset(void);
 static void delete_config_files(void);
 static void btif_config_remove_unpaired(config_t* config);
+static bool btif_config_is_unpaired(const config_t& config,
+                                    const std::string& section);
 static void btif_config_remove_restricted(config_t* config);
 static std::unique_ptr<config_t> btif_config_open(const char* filename, const char* checksum_filename);
+static void btif_config_replay_journal(config_t* config);
+static void btif_config_compact(void);
+static void btif_config_journal_set(std::string_view section,
+                                    std::string_view key,
+                                    const std::string& value);
 
 // Key attestation
 static std::string hash_file(const char* filename);
+static std::string hash_buffer(const std::string& buffer);
+static std::string hash_to_string(const uint8_t* hash);
+static std::string journal_checksum_slot(size_t length,
+                                         const SHA256_CTX& sha256);
 static std::string read_checksum_file(const char* filename);
 static void write_checksum_file(const char* filename, const std::string& hash);
 
@@ -176,6 +204,26 @@ static std::recursive_mutex config_lock;  // protects operations on |config|.
 static std::unique_ptr<config_t> config;
 static alarm_t* config_timer;
 
+// Changes to |config| since the last write, as journal records. Protected by
+// |config_lock|.
+static std::string config_journal_pending;
+// Set when a change was too long to journal, so that the next write saves
+// the whole config instead. Protected by |config_lock|.
+static bool config_journal_overflow;
+// Held while writing to the config file or the journal, so that writes from
+// the btif thread and from btif_config_flush() do not interleave.
+static std::mutex config_write_lock;
+// The rest is protected by |config_write_lock|.
+static bool config_compaction_needed;
+static size_t config_file_size;
+static size_t config_journal_size;
+// Running hash of the journal file, so that its checksum can be updated
+// without reading the file back
+static SHA256_CTX config_journal_sha256;
+// The checksum slot of the journal as it is now, kept in the checksum file
+// next to the one of the journal after the next append
+static std::string config_journal_slot;
+
 static BtifKeystore btif_keystore(new keystore::KeystoreClientImpl);
 
 // Module lifecycle functions
@@ -217,6 +265,10 @@ static future_t* init(void) {
     file_source = "Empty";
   }
 
+  // The journal holds the changes made since the config file was written,
+  // so it only applies on top of that file
+  if (btif_config_source == ORIGINAL) btif_config_replay_journal(config.get());
+
   if (!file_source.empty())
     config_set_string(config.get(), INFO_SECTION, FILE_SOURCE, file_source);
 
@@ -242,6 +294,12 @@ static future_t* init(void) {
   // Read or set metrics 256 bit hashing salt
   read_or_set_metrics_salt();
 
+  // The changes made above are not in the journal, and the journal may end
+  // with a record torn by a crash, so the first write is a full one.
+  config_journal_pending.clear();
+  config_journal_overflow = false;
+  config_compaction_needed = true;
+
   // TODO(sharvil): use a non-wake alarm for this once we have
   // API support for it. There's no need to wake the system to
   // write back to disk.
@@ -293,6 +351,63 @@ static std::unique_ptr<config_t> btif_config_open(const char* filename, const ch
   return config;
 }
 
+static void btif_config_replay_journal(config_t* config) {
+  std::string journal;
+  if (!base::ReadFileToString(base::FilePath(CONFIG_JOURNAL_PATH), &journal) ||
+      journal.empty()) {
+    return;
+  }
+
+  // START KEY ATTESTATION
+  // The checksum file holds two slots, each the length and hash of the
+  // journal: as it will be once the last append completes, then as it was
+  // before that append. Only the part of the journal that one of them
+  // matches is replayed; anything after it was never attested.
+  size_t attested = journal.size();
+  std::string checksum = read_checksum_file(CONFIG_JOURNAL_CHECKSUM_PATH);
+  if (checksum != DISABLED) {
+    attested = 0;
+    bool matched = false;
+    for (const std::string& slot : base::SplitString(
+             checksum, ";", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY)) {
+      size_t separator = slot.find(':');
+      size_t length;
+      if (separator != std::string::npos &&
+          base::StringToSizeT(slot.substr(0, separator), &length) &&
+          length <= journal.size() &&
+          hash_buffer(journal.substr(0, length)) ==
+              slot.substr(separator + 1)) {
+        attested = length;
+        matched = true;
+        break;
+      }
+    }
+    if (!matched) {
+      LOG(ERROR) << __func__ << ": journal does not match its checksum, "
+                 << "ignoring " << journal.size() << " bytes of changes";
+    }
+    if (attested < journal.size()) {
+      LOG(WARNING) << __func__ << ": dropping " << journal.size() - attested
+                   << " bytes of changes that were never checksummed";
+      journal.resize(attested);
+      if (truncate(CONFIG_JOURNAL_PATH, attested) < 0) {
+        LOG(ERROR) << __func__ << ": unable to truncate journal: "
+                   << strerror(errno);
+      }
+    }
+  }
+  // END KEY ATTESTATION
+
+  if (journal.empty()) return;
+
+  size_t replayed = config_journal_replay(journal, config);
+  if (replayed < journal.size()) {
+    LOG(ERROR) << __func__ << ": only replayed " << replayed << " of "
+               << journal.size() << " checksummed bytes of changes";
+  }
+  LOG(INFO) << __func__ << ": replayed " << replayed << " bytes of changes";
+}
+
 static future_t* shut_down(void) {
   btif_config_flush();
   return future_new_immediate(FUTURE_SUCCESS);
@@ -323,14 +438,14 @@ bool btif_config_has_section(const char* section) {
   return config_has_section(*config, section);
 }
 
-bool btif_config_exist(const std::string& section, const std::string& key) {
+bool btif_config_exist(std::string_view section, std::string_view key) {
   CHECK(config != NULL);
 
   std::unique_lock<std::recursive_mutex> lock(config_lock);
   return config_has_key(*config, section, key);
 }
 
-bool btif_config_get_int(const std::string& section, const std::string& key,
+bool btif_config_get_int(std::string_view section, std::string_view key,
                          int* value) {
   CHECK(config != NULL);
   CHECK(value != NULL);
@@ -342,17 +457,18 @@ bool btif_config_get_int(const std::string& section, const std::string& key,
   return ret;
 }
 
-bool btif_config_set_int(const std::string& section, const std::string& key,
+bool btif_config_set_int(std::string_view section, std::string_view key,
                          int value) {
   CHECK(config != NULL);
 
   std::unique_lock<std::recursive_mutex> lock(config_lock);
   config_set_int(config.get(), section, key, value);
+  btif_config_journal_set(section, key, std::to_string(value));
 
   return true;
 }
 
-bool btif_config_get_uint64(const std::string& section, const std::string& key,
+bool btif_config_get_uint64(std::string_view section, std::string_view key,
                             uint64_t* value) {
   CHECK(config != NULL);
   CHECK(value != NULL);
@@ -364,17 +480,18 @@ bool btif_config_get_uint64(const std::string& section, const std::string& key,
   return ret;
 }
 
-bool btif_config_set_uint64(const std::string& section, const std::string& key,
+bool btif_config_set_uint64(std::string_view section, std::string_view key,
                             uint64_t value) {
   CHECK(config != NULL);
 
   std::unique_lock<std::recursive_mutex> lock(config_lock);
   config_set_uint64(config.get(), section, key, value);
+  btif_config_journal_set(section, key, std::to_string(value));
 
   return true;
 }
 
-bool btif_config_get_str(const std::string& section, const std::string& key,
+bool btif_config_get_str(std::string_view section, std::string_view key,
                          char* value, int* size_bytes) {
   CHECK(config != NULL);
   CHECK(value != NULL);
@@ -392,16 +509,17 @@ bool btif_config_get_str(const std::string& section, const std::string& key,
   return true;
 }
 
-bool btif_config_set_str(const std::string& section, const std::string& key,
+bool btif_config_set_str(std::string_view section, std::string_view key,
                          const std::string& value) {
   CHECK(config != NULL);
 
   std::unique_lock<std::recursive_mutex> lock(config_lock);
   config_set_string(config.get(), section, key, value);
+  btif_config_journal_set(section, key, value);
   return true;
 }
 
-bool btif_config_get_bin(const std::string& section, const std::string& key,
+bool btif_config_get_bin(std::string_view section, std::string_view key,
                          uint8_t* value, size_t* length) {
   CHECK(config != NULL);
   CHECK(value != NULL);
@@ -435,8 +553,8 @@ bool btif_config_get_bin(const std::string& section, const std::string& key,
   return true;
 }
 
-size_t btif_config_get_bin_length(const std::string& section,
-                                  const std::string& key) {
+size_t btif_config_get_bin_length(std::string_view section,
+                                  std::string_view key) {
   CHECK(config != NULL);
 
   std::unique_lock<std::recursive_mutex> lock(config_lock);
@@ -447,7 +565,7 @@ size_t btif_config_get_bin_length(const std::string& section,
   return ((value_len % 2) != 0) ? 0 : (value_len / 2);
 }
 
-bool btif_config_set_bin(const std::string& section, const std::string& key,
+bool btif_config_set_bin(std::string_view section, std::string_view key,
                          const uint8_t* value, size_t length) {
   const char* lookup = "0123456789abcdef";
 
@@ -471,19 +589,23 @@ bool btif_config_set_bin(const std::string& section, const std::string& key,
   {
     std::unique_lock<std::recursive_mutex> lock(config_lock);
     config_set_string(config.get(), section, key, str);
+    btif_config_journal_set(section, key, str);
   }
 
   osi_free(str);
   return true;
 }
 
-std::list<section_t>& btif_config_sections() { return config->sections; }
+const std::list<section_t>& btif_config_sections() { return config->sections; }
 
-bool btif_config_remove(const std::string& section, const std::string& key) {
+bool btif_config_remove(std::string_view section, std::string_view key) {
   CHECK(config != NULL);
 
   std::unique_lock<std::recursive_mutex> lock(config_lock);
-  return config_remove_key(config.get(), section, key);
+  bool ret = config_remove_key(config.get(), section, key);
+  if (ret && !config_journal_remove(&config_journal_pending, section, key))
+    config_journal_overflow = true;
+  return ret;
 }
 
 void btif_config_save(void) {
@@ -507,15 +629,29 @@ bool btif_config_clear(void) {
 
   alarm_cancel(config_timer);
 
+  std::unique_lock<std::mutex> write_lock(config_write_lock);
   std::unique_lock<std::recursive_mutex> lock(config_lock);
 
   config = config_new_empty();
-
-  bool ret = config_save(*config, CONFIG_FILE_PATH);
+  config_journal_pending.clear();
+  config_journal_overflow = false;
+
+  // Drop the journal first, so that a crash part way through cannot replay
+  // it on top of the empty config
+  remove(CONFIG_JOURNAL_PATH);
+  remove(CONFIG_JOURNAL_CHECKSUM_PATH);
+  config_journal_size = 0;
+  SHA256_Init(&config_journal_sha256);
+  config_journal_slot = journal_checksum_slot(0, config_journal_sha256);
+  config_compaction_needed = false;
+
+  std::string serialized = config_serialize(*config);
+  bool ret = config_save_serialized(serialized, CONFIG_FILE_PATH);
+  config_file_size = serialized.size();
   btif_config_source = RESET;
 
   // Save encrypted hash
-  std::string current_hash = hash_file(CONFIG_FILE_PATH);
+  std::string current_hash = hash_buffer(serialized);
   if (!current_hash.empty()) {
     write_checksum_file(CONFIG_FILE_CHECKSUM_PATH, current_hash);
   }
@@ -535,17 +671,123 @@ static void btif_config_write(UNUSED_ATTR uint16_t event,
   CHECK(config != NULL);
   CHECK(config_timer != NULL);
 
-  std::unique_lock<std::recursive_mutex> lock(config_lock);
+  std::unique_lock<std::mutex> write_lock(config_write_lock);
+  std::string records;
+  {
+    std::unique_lock<std::recursive_mutex> lock(config_lock);
+    records.swap(config_journal_pending);
+    if (config_journal_overflow) config_compaction_needed = true;
+    config_journal_overflow = false;
+  }
+
+  if (!config_compaction_needed &&
+      config_journal_size + records.size() >
+          std::max(config_file_size, CONFIG_JOURNAL_MIN_COMPACT_SIZE)) {
+    config_compaction_needed = true;
+  }
+  if (config_compaction_needed) {
+    btif_config_compact();
+    return;
+  }
+  if (records.empty()) return;
+
+  // Save the length and hash of the journal as it will be after the append
+  // before appending, next to those of the journal as it is. Whichever of
+  // the two the journal on disk matches after a crash is replayed.
+  SHA256_CTX sha256 = config_journal_sha256;
+  SHA256_Update(&sha256, records.data(), records.size());
+  std::string slot =
+      journal_checksum_slot(config_journal_size + records.size(), sha256);
+  if (use_key_attestation()) {
+    write_checksum_file(CONFIG_JOURNAL_CHECKSUM_PATH,
+                        slot + ";" + config_journal_slot);
+  }
+
+  if (!config_journal_append(records, CONFIG_JOURNAL_PATH)) {
+    // The journal may now end with a partial record, which would hide any
+    // record appended after it
+    btif_config_compact();
+    return;
+  }
+  config_journal_size += records.size();
+  config_journal_sha256 = sha256;
+  config_journal_slot = slot;
+}
+
+// Writes the whole of |config| to the config file, which makes the journal
+// redundant. Must be called with |config_write_lock| held.
+static void btif_config_compact(void) {
+  std::string serialized;
+  {
+    std::unique_lock<std::recursive_mutex> lock(config_lock);
+    std::unique_ptr<config_t> config_paired = config_new_clone(*config);
+    btif_config_remove_unpaired(config_paired.get());
+    serialized = config_serialize(*config_paired);
+    // Everything changed so far is in |serialized|
+    config_journal_pending.clear();
+    config_journal_overflow = false;
+  }
+
   rename(CONFIG_FILE_PATH, CONFIG_BACKUP_PATH);
   rename(CONFIG_FILE_CHECKSUM_PATH, CONFIG_BACKUP_CHECKSUM_PATH);
-  std::unique_ptr<config_t> config_paired = config_new_clone(*config);
-  btif_config_remove_unpaired(config_paired.get());
-  config_save(*config_paired, CONFIG_FILE_PATH);
+  if (!config_save_serialized(serialized, CONFIG_FILE_PATH)) {
+    // Keep the journal, and try again on the next write
+    config_compaction_needed = true;
+    return;
+  }
+  config_file_size = serialized.size();
   // Save hash
-  std::string current_hash = hash_file(CONFIG_FILE_PATH);
+  std::string current_hash = hash_buffer(serialized);
   if (!current_hash.empty()) {
     write_checksum_file(CONFIG_FILE_CHECKSUM_PATH, current_hash);
   }
+
+  // Replaying the journal on top of the new file would not change it, so a
+  // crash before this point is harmless.
+  remove(CONFIG_JOURNAL_PATH);
+  remove(CONFIG_JOURNAL_CHECKSUM_PATH);
+  config_journal_size = 0;
+  SHA256_Init(&config_journal_sha256);
+  config_journal_slot = journal_checksum_slot(0, config_journal_sha256);
+  config_compaction_needed = false;
+}
+
+// Journals a change to |config|. Must be called with |config_lock| held.
+//
+// Devices that are not paired are dropped from the config when it is
+// loaded, so changes to their sections are not journaled. Setting a key
+// that pairs a device journals its whole section, including what was set
+// while it was not paired.
+static void btif_config_journal_set(std::string_view section,
+                                    std::string_view key,
+                                    const std::string& value) {
+  const std::string section_name(section);
+  if (btif_config_is_unpaired(*config, section_name)) return;
+
+  if (RawAddress::IsValidAddress(section_name) &&
+      std::find(std::begin(PAIRING_KEYS), std::end(PAIRING_KEYS), key) !=
+          std::end(PAIRING_KEYS)) {
+    for (const entry_t& entry : config->section_index.at(section)->entries) {
+      if (!config_journal_set(&config_journal_pending, section, entry.key,
+                              entry.value))
+        config_journal_overflow = true;
+    }
+    return;
+  }
+
+  if (!config_journal_set(&config_journal_pending, section, key, value))
+    config_journal_overflow = true;
+}
+
+// Returns true if |section| is a device that |config| holds no pairing key
+// for.
+static bool btif_config_is_unpaired(const config_t& config,
+                                    const std::string& section) {
+  if (!RawAddress::IsValidAddress(section)) return false;
+  for (const char* key : PAIRING_KEYS) {
+    if (config_has_key(config, section, key)) return false;
+  }
+  return true;
 }
 
 static void btif_config_remove_unpaired(config_t* conf) {
@@ -556,21 +798,13 @@ static void btif_config_remove_unpaired(config_t* conf) {
   // discovered devices during regular inquiry scans.
   // We remove these now and cache them in memory instead.
   for (auto it = conf->sections.begin(); it != conf->sections.end();) {
-    std::string& section = it->name;
-    if (RawAddress::IsValidAddress(section)) {
-      // TODO: config_has_key loop thorugh all data, maybe just make it so we
-      // loop just once ?
-      if (!config_has_key(*conf, section, "LinkKey") &&
-          !config_has_key(*conf, section, "LE_KEY_PENC") &&
-          !config_has_key(*conf, section, "LE_KEY_PID") &&
-          !config_has_key(*conf, section, "LE_KEY_PCSRK") &&
-          !config_has_key(*conf, section, "LE_KEY_LENC") &&
-          !config_has_key(*conf, section, "LE_KEY_LCSRK")) {
-        it = conf->sections.erase(it);
-        continue;
-      }
-      paired_devices++;
+    const std::string& section = it->name;
+    if (btif_config_is_unpaired(*conf, section)) {
+      std::string unpaired = (it++)->name;
+      config_remove_section(conf, unpaired);
+      continue;
     }
+    if (RawAddress::IsValidAddress(section)) paired_devices++;
     it++;
   }
 
@@ -610,6 +844,8 @@ void btif_debug_config_dump(int fd) {
   dprintf(fd, "  File source: %s\n",
           config_get_string(*config, INFO_SECTION, FILE_SOURCE, &original)
               ->c_str());
+  std::unique_lock<std::mutex> write_lock(config_write_lock);
+  dprintf(fd, "  Journal size: %zu bytes\n", config_journal_size);
 }
 
 static void btif_config_remove_restricted(config_t* config) {
@@ -621,7 +857,8 @@ static void btif_config_remove_restricted(config_t* config) {
         config_has_key(*config, section, "Restricted")) {
       BTIF_TRACE_DEBUG("%s: Removing restricted device %s", __func__,
                        section.c_str());
-      it = config->sections.erase(it);
+      std::string restricted = (it++)->name;
+      config_remove_section(config, restricted);
       continue;
     }
     it++;
@@ -639,6 +876,8 @@ static void delete_config_files(void) {
   remove(CONFIG_BACKUP_PATH);
   remove(CONFIG_FILE_CHECKSUM_PATH);
   remove(CONFIG_BACKUP_CHECKSUM_PATH);
+  remove(CONFIG_JOURNAL_PATH);
+  remove(CONFIG_JOURNAL_CHECKSUM_PATH);
   osi_property_set("persist.bluetooth.factoryreset", "false");
 }
 
@@ -662,11 +901,34 @@ static std::string hash_file(const char* filename) {
     SHA256_Update(&sha256, buffer.data(), bytes_read);
   }
   SHA256_Final(hash, &sha256);
+  fclose(fp);
+  return hash_to_string(hash);
+}
+
+static std::string hash_buffer(const std::string& buffer) {
+  if (!use_key_attestation()) {
+    LOG(INFO) << __func__ << ": Disabled for multi-user";
+    return DISABLED;
+  }
+  uint8_t hash[SHA256_DIGEST_LENGTH];
+  SHA256(reinterpret_cast<const uint8_t*>(buffer.data()), buffer.size(), hash);
+  return hash_to_string(hash);
+}
+
+// Returns the checksum slot of a journal of |length| bytes hashed by |sha256|
+static std::string journal_checksum_slot(size_t length,
+                                         const SHA256_CTX& sha256) {
+  SHA256_CTX final_sha256 = sha256;
+  uint8_t hash[SHA256_DIGEST_LENGTH];
+  SHA256_Final(hash, &final_sha256);
+  return std::to_string(length) + ":" + hash_to_string(hash);
+}
+
+static std::string hash_to_string(const uint8_t* hash) {
   std::stringstream ss;
   for (int i = 0; i < SHA256_DIGEST_LENGTH; i++) {
     ss << std::hex << std::setw(2) << std::setfill('0') << (int)hash[i];
   }
-  fclose(fp);
   return ss.str();
 }
 
@@ -0,0 +1,127 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "btif/include/btif_ble_scan_batch.h"
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+
+ScanResult result(int i) {
+  ScanResult r = {};
+  r.bd_addr = RawAddress({0xAA, 0xBB, 0xCC, 0xDD, (uint8_t)(i >> 8),
+                          (uint8_t)i});
+  r.rssi = -(i % 100);
+  r.ble_evt_type = 0x0013;
+  return r;
+}
+
+struct Delivered {
+  RawAddress bd_addr;
+  int8_t rssi;
+  std::vector<uint8_t> data;
+};
+
+std::vector<Delivered> deliver(ScanResultBatch& batch) {
+  std::vector<Delivered> delivered;
+  batch.Deliver([&](const ScanResult& r, const uint8_t* data, size_t len) {
+    delivered.push_back({r.bd_addr, r.rssi, {data, data + len}});
+  });
+  return delivered;
+}
+
+}  // namespace
+
+TEST(ScanResultBatchTest, delivers_results_in_order) {
+  ScanResultBatch batch;
+  const uint8_t data1[] = {0x02, 0x01, 0x06};
+  const uint8_t data3[] = {0x03, 0x03, 0x0F, 0x18};
+
+  EXPECT_TRUE(batch.Add(result(1), data1, sizeof(data1)));
+  EXPECT_FALSE(batch.Add(result(2), nullptr, 0));
+  EXPECT_FALSE(batch.Add(result(3), data3, sizeof(data3)));
+
+  std::vector<Delivered> delivered = deliver(batch);
+  ASSERT_EQ(3u, delivered.size());
+  EXPECT_EQ(result(1).bd_addr, delivered[0].bd_addr);
+  EXPECT_EQ(result(1).rssi, delivered[0].rssi);
+  EXPECT_EQ(std::vector<uint8_t>(data1, data1 + sizeof(data1)),
+            delivered[0].data);
+  EXPECT_EQ(result(2).bd_addr, delivered[1].bd_addr);
+  EXPECT_TRUE(delivered[1].data.empty());
+  EXPECT_EQ(result(3).bd_addr, delivered[2].bd_addr);
+  EXPECT_EQ(std::vector<uint8_t>(data3, data3 + sizeof(data3)),
+            delivered[2].data);
+
+  // Delivered results are gone, and the next one starts a new batch
+  EXPECT_TRUE(deliver(batch).empty());
+  EXPECT_TRUE(batch.Add(result(4), data1, sizeof(data1)));
+  EXPECT_EQ(1u, deliver(batch).size());
+}
+
+TEST(ScanResultBatchTest, drop_starts_a_new_batch) {
+  ScanResultBatch batch;
+  const uint8_t data[] = {0x02, 0x01, 0x06};
+
+  EXPECT_TRUE(batch.Add(result(1), data, sizeof(data)));
+  EXPECT_FALSE(batch.Add(result(2), data, sizeof(data)));
+  EXPECT_EQ(2u, batch.Drop());
+
+  // The dropped results are never delivered
+  EXPECT_TRUE(batch.Add(result(3), nullptr, 0));
+  std::vector<Delivered> delivered = deliver(batch);
+  ASSERT_EQ(1u, delivered.size());
+  EXPECT_EQ(result(3).bd_addr, delivered[0].bd_addr);
+  EXPECT_EQ(0u, batch.Drop());
+}
+
+TEST(ScanResultBatchTest, concurrent_add_and_deliver) {
+  const int kResults = 20000;
+  ScanResultBatch batch;
+  std::atomic<int> scheduled(0);
+  std::atomic<bool> done(false);
+
+  std::vector<Delivered> delivered;
+  std::thread jni_thread([&] {
+    while (true) {
+      bool last = done;
+      for (Delivered& d : deliver(batch)) delivered.push_back(std::move(d));
+      if (last) break;
+      std::this_thread::yield();
+    }
+  });
+
+  for (int i = 0; i < kResults; i++) {
+    uint8_t data[] = {0x02, 0xFF, (uint8_t)i};
+    if (batch.Add(result(i), data, sizeof(data))) scheduled++;
+  }
+  done = true;
+  jni_thread.join();
+
+  ASSERT_EQ((size_t)kResults, delivered.size());
+  for (int i = 0; i < kResults; i++) {
+    EXPECT_EQ(result(i).bd_addr, delivered[i].bd_addr);
+    EXPECT_EQ((std::vector<uint8_t>{0x02, 0xFF, (uint8_t)i}),
+              delivered[i].data);
+  }
+  EXPECT_GE(scheduled, 1);
+  EXPECT_LE(scheduled, kResults);
+}
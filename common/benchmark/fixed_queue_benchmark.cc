@@ -0,0 +1,115 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <base/logging.h>
+#include <benchmark/benchmark.h>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "osi/include/fixed_queue.h"
+#include "osi/include/thread.h"
+
+using ::benchmark::State;
+
+#define NUM_MESSAGES_TO_SEND 100000
+#define QUEUE_CAPACITY 1024
+
+static int g_message = 0;
+
+static void produce(fixed_queue_t* queue, int num_messages) {
+  for (int i = 0; i < num_messages; i++) {
+    fixed_queue_enqueue(queue, &g_message);
+  }
+}
+
+// Args: queue mode, number of producer threads.
+static void BM_FixedQueueThroughput(State& state) {
+  auto mode = static_cast<fixed_queue_mode_t>(state.range(0));
+  int num_producers = state.range(1);
+  int per_producer = NUM_MESSAGES_TO_SEND / num_producers;
+
+  fixed_queue_t* queue = fixed_queue_new_with_mode(QUEUE_CAPACITY, mode);
+  CHECK(queue != nullptr);
+
+  for (auto _ : state) {
+    std::vector<std::thread> producers;
+    for (int i = 0; i < num_producers; i++) {
+      producers.emplace_back(produce, queue, per_producer);
+    }
+    for (int i = 0; i < per_producer * num_producers; i++) {
+      benchmark::DoNotOptimize(fixed_queue_dequeue(queue));
+    }
+    for (auto& producer : producers) producer.join();
+  }
+
+  state.SetItemsProcessed(state.iterations() * per_producer * num_producers);
+  fixed_queue_free(queue, nullptr);
+}
+
+BENCHMARK(BM_FixedQueueThroughput)
+    ->Args({FIXED_QUEUE_MODE_LIST, 1})
+    ->Args({FIXED_QUEUE_MODE_SPSC, 1})
+    ->Args({FIXED_QUEUE_MODE_MPSC, 1})
+    ->Args({FIXED_QUEUE_MODE_LIST, 4})
+    ->Args({FIXED_QUEUE_MODE_MPSC, 4})
+    ->UseRealTime();
+
+static std::promise<void>* g_done_promise = nullptr;
+static int g_received = 0;
+static int g_expected = 0;
+
+static void reactor_dequeue_ready(fixed_queue_t* queue, void* context) {
+  // Drain everything that is ready per wakeup, as the A2DP and RFCOMM
+  // consumers do.
+  while (fixed_queue_try_dequeue(queue) != nullptr) {
+    if (++g_received == g_expected) g_done_promise->set_value();
+  }
+}
+
+// Same as above, but the consumer is a reactor driven osi thread that is only
+// woken up through the dequeue fd.
+static void BM_FixedQueueReactorThroughput(State& state) {
+  auto mode = static_cast<fixed_queue_mode_t>(state.range(0));
+
+  fixed_queue_t* queue = fixed_queue_new_with_mode(QUEUE_CAPACITY, mode);
+  CHECK(queue != nullptr);
+  thread_t* consumer = thread_new("BM_FixedQueueReactorThroughput thread");
+  fixed_queue_register_dequeue(queue, thread_get_reactor(consumer),
+                               reactor_dequeue_ready, nullptr);
+
+  for (auto _ : state) {
+    std::promise<void> done_promise;
+    std::future<void> done_future = done_promise.get_future();
+    g_done_promise = &done_promise;
+    g_received = 0;
+    g_expected = NUM_MESSAGES_TO_SEND;
+    produce(queue, NUM_MESSAGES_TO_SEND);
+    done_future.wait();
+  }
+
+  state.SetItemsProcessed(state.iterations() * NUM_MESSAGES_TO_SEND);
+  fixed_queue_unregister_dequeue(queue);
+  thread_free(consumer);
+  fixed_queue_free(queue, nullptr);
+  g_done_promise = nullptr;
+}
+
+BENCHMARK(BM_FixedQueueReactorThroughput)
+    ->Arg(FIXED_QUEUE_MODE_LIST)
+    ->Arg(FIXED_QUEUE_MODE_SPSC)
+    ->Arg(FIXED_QUEUE_MODE_MPSC)
+    ->UseRealTime();
@@ -18,7 +18,9 @@
 #include <base/run_loop.h>
 #include <base/threading/thread.h>
 #include <benchmark/benchmark.h>
+#include <atomic>
 #include <future>
+#include <vector>
 
 #include "common/message_loop_thread.h"
 #include "common/once_timer.h"
@@ -43,9 +45,14 @@ int g_scheduled_tasks;
 int g_task_length;
 int g_task_interval;
 int g_task_counter;
+std::atomic<int> g_alarms_remaining;
 
 void TimerFire(void*) { g_promise->set_value(); }
 
+void ConcurrentAlarmFire(void*) {
+  if (--g_alarms_remaining == 0) g_promise->set_value();
+}
+
 void AlarmSleepAndCountDelayedTime(void*) {
   auto end_time_us = time_get_os_boottime_us();
   auto time_after_start_ms = (end_time_us - g_start_time) / 1000;
@@ -268,6 +275,63 @@ BENCHMARK_REGISTER_F(BM_AlarmTaskPeriodicTimer, periodic_accuracy)
     ->Iterations(1)
     ->UseRealTime();
 
+class BM_OsiConcurrentAlarms : public ::benchmark::Fixture {
+ protected:
+  void SetUp(State& st) override {
+    ::benchmark::Fixture::SetUp(st);
+    for (int i = 0; i < st.range(0); i++) {
+      alarms_.push_back(alarm_new("osi_concurrent_alarm_test"));
+    }
+    g_promise = std::make_shared<std::promise<void>>();
+  }
+
+  void TearDown(State& st) override {
+    g_promise = nullptr;
+    for (auto alarm : alarms_) alarm_free(alarm);
+    alarms_.clear();
+    ::benchmark::Fixture::TearDown(st);
+  }
+
+  std::vector<alarm_t*> alarms_;
+};
+
+// Arms and then cancels |state.range(0)| alarms whose deadlines are spread
+// over several seconds, so that all of them are live at the same time.
+BENCHMARK_DEFINE_F(BM_OsiConcurrentAlarms, set_and_cancel)(State& state) {
+  for (auto _ : state) {
+    for (size_t i = 0; i < alarms_.size(); i++) {
+      alarm_set(alarms_[i], 5000 + (i * 7919) % 60000, &ConcurrentAlarmFire,
+                nullptr);
+    }
+    for (auto alarm : alarms_) alarm_cancel(alarm);
+  }
+  state.SetItemsProcessed(state.iterations() * alarms_.size() * 2);
+};
+
+BENCHMARK_REGISTER_F(BM_OsiConcurrentAlarms, set_and_cancel)
+    ->Arg(100)
+    ->Arg(1000)
+    ->Arg(10000);
+
+// Arms |state.range(0)| alarms expiring within the next 100ms and waits until
+// every callback has run.
+BENCHMARK_DEFINE_F(BM_OsiConcurrentAlarms, fire_all)(State& state) {
+  for (auto _ : state) {
+    g_promise = std::make_shared<std::promise<void>>();
+    g_alarms_remaining = alarms_.size();
+    for (size_t i = 0; i < alarms_.size(); i++) {
+      alarm_set(alarms_[i], (i * 7919) % 100, &ConcurrentAlarmFire, nullptr);
+    }
+    g_promise->get_future().get();
+  }
+  state.SetItemsProcessed(state.iterations() * alarms_.size());
+};
+
+BENCHMARK_REGISTER_F(BM_OsiConcurrentAlarms, fire_all)
+    ->Arg(10000)
+    ->Iterations(10)
+    ->UseRealTime();
+
 int main(int argc, char** argv) {
   // Disable LOG() output from libchrome
   logging::LoggingSettings log_settings;
@@ -32,6 +32,14 @@
 #include "g722_typedefs.h"
 #include "g722_enc_dec.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define G722_QMF_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define G722_QMF_NEON
+#endif
+
 #if !defined(FALSE)
 #define FALSE 0
 #endif
@@ -42,6 +50,11 @@
 #define PACKED_OUTPUT   (0)
 #define BITS_PER_SAMPLE (8)
 
+/* Pairs of input samples run through the transmit QMF at a time */
+#define QMF_BLOCK_PAIRS (64)
+/* Pairs of input samples kept from one block to the next by the QMF */
+#define QMF_HISTORY_PAIRS (11)
+
 #ifndef BUILD_FEATURE_G722_USE_INTRINSIC_SAT
 static __inline int16_t saturate(int32_t amp)
 {
@@ -211,36 +224,36 @@ int16_t limitValues (int16_t rl)
 /*- End of function --------------------------------------------------------*/
 #endif
 
-static int16_t q6[32] =
+static const int16_t q6[32] =
 {
        0,   35,   72,  110,  150,  190,  233,  276,
      323,  370,  422,  473,  530,  587,  650,  714,
      786,  858,  940, 1023, 1121, 1219, 1339, 1458,
     1612, 1765, 1980, 2195, 2557, 2919,    0,    0
 };
-static int16_t iln[32] =
+static const int16_t iln[32] =
 {
      0, 63, 62, 31, 30, 29, 28, 27,
     26, 25, 24, 23, 22, 21, 20, 19,
     18, 17, 16, 15, 14, 13, 12, 11,
     10,  9,  8,  7,  6,  5,  4,  0
 };
-static int16_t ilp[32] =
+static const int16_t ilp[32] =
 {
      0, 61, 60, 59, 58, 57, 56, 55,
     54, 53, 52, 51, 50, 49, 48, 47,
     46, 45, 44, 43, 42, 41, 40, 39,
     38, 37, 36, 35, 34, 33, 32,  0
 };
-static int16_t wl[8] =
+static const int16_t wl[8] =
 {
     -60, -30, 58, 172, 334, 538, 1198, 3042
 };
-static int16_t rl42[16] =
+static const int16_t rl42[16] =
 {
     0, 7, 6, 5, 4, 3, 2, 1, 7, 6, 5, 4, 3, 2, 1, 0
 };
-static int16_t ilb[32] =
+static const int16_t ilb[32] =
 {
     2048, 2093, 2139, 2186, 2233, 2282, 2332,
     2383, 2435, 2489, 2543, 2599, 2656, 2714,
@@ -248,28 +261,121 @@ static int16_t ilb[32] =
     3228, 3298, 3371, 3444, 3520, 3597, 3676,
     3756, 3838, 3922, 4008
 };
-static int16_t qm4[16] =
+static const int16_t qm4[16] =
 {
          0, -20456, -12896, -8968,
      -6288,  -4240,  -2584, -1200,
      20456,  12896,   8968,  6288,
       4240,   2584,   1200,     0
 };
-static int16_t qm2[4] =
+static const int16_t qm2[4] =
 {
     -7408,  -1616,   7408,   1616
 };
-static int16_t qmf_coeffs[12] =
+static const int16_t qmf_coeffs[12] =
 {
        3,  -11,   12,   32, -210,  951, 3876, -805,  362, -156,   53,  -11,
 };
-static int16_t ihn[3] = {0, 1, 0};
-static int16_t ihp[3] = {0, 3, 2};
-static int16_t wh[3] = {0, -214, 798};
-static int16_t rh2[4] = {2, 1, 2, 1};
+static const int16_t ihn[3] = {0, 1, 0};
+static const int16_t ihp[3] = {0, 3, 2};
+static const int16_t wh[3] = {0, -214, 798};
+static const int16_t rh2[4] = {2, 1, 2, 1};
+
+/* Apply the transmit QMF to |pairs| pairs of input samples, discarding
+   every other QMF output.
+   The window of pair k is even[k .. k + 11] and odd[k .. k + 11]: the even
+   and odd samples of x[] in the per sample form of the filter. The sums
+   are exact, so they do not depend on the order of the taps, and several
+   pairs are filtered at once when the CPU allows it. */
+static void qmf_analysis(const int16_t even[], const int16_t odd[],
+                         int pairs, int32_t xlow[], int32_t xhigh[])
+{
+    int k;
+    int i;
+    /* Even and odd tap accumulators */
+    int sumeven;
+    int sumodd;
 
-int g722_encode(g722_encode_state_t *s, uint8_t g722_data[],
-                       const int16_t amp[], int len)
+    k = 0;
+#if defined(G722_QMF_SSE2)
+    /* 8 pairs at a time: each 32 bit lane sums two taps of one pair */
+    for (  ;  k + 8 <= pairs;  k += 8)
+    {
+        __m128i odd_lo = _mm_setzero_si128();
+        __m128i odd_hi = _mm_setzero_si128();
+        __m128i even_lo = _mm_setzero_si128();
+        __m128i even_hi = _mm_setzero_si128();
+        __m128i a;
+        __m128i b;
+        __m128i c;
+
+        for (i = 0;  i < 12;  i += 2)
+        {
+            a = _mm_loadu_si128((const __m128i *) &even[k + i]);
+            b = _mm_loadu_si128((const __m128i *) &even[k + i + 1]);
+            c = _mm_set1_epi32((uint16_t) qmf_coeffs[i]
+                               | (uint32_t) (uint16_t) qmf_coeffs[i + 1] << 16);
+            odd_lo = _mm_add_epi32(odd_lo,
+                                   _mm_madd_epi16(_mm_unpacklo_epi16(a, b), c));
+            odd_hi = _mm_add_epi32(odd_hi,
+                                   _mm_madd_epi16(_mm_unpackhi_epi16(a, b), c));
+
+            a = _mm_loadu_si128((const __m128i *) &odd[k + i]);
+            b = _mm_loadu_si128((const __m128i *) &odd[k + i + 1]);
+            c = _mm_set1_epi32((uint16_t) qmf_coeffs[11 - i]
+                               | (uint32_t) (uint16_t) qmf_coeffs[10 - i] << 16);
+            even_lo = _mm_add_epi32(even_lo,
+                                    _mm_madd_epi16(_mm_unpacklo_epi16(a, b), c));
+            even_hi = _mm_add_epi32(even_hi,
+                                    _mm_madd_epi16(_mm_unpackhi_epi16(a, b), c));
+        }
+        _mm_storeu_si128((__m128i *) &xlow[k],
+                         _mm_srai_epi32(_mm_add_epi32(even_lo, odd_lo), 14));
+        _mm_storeu_si128((__m128i *) &xlow[k + 4],
+                         _mm_srai_epi32(_mm_add_epi32(even_hi, odd_hi), 14));
+        _mm_storeu_si128((__m128i *) &xhigh[k],
+                         _mm_srai_epi32(_mm_sub_epi32(even_lo, odd_lo), 14));
+        _mm_storeu_si128((__m128i *) &xhigh[k + 4],
+                         _mm_srai_epi32(_mm_sub_epi32(even_hi, odd_hi), 14));
+    }
+#elif defined(G722_QMF_NEON)
+    /* 4 pairs at a time */
+    for (  ;  k + 4 <= pairs;  k += 4)
+    {
+        int32x4_t odd_acc = vdupq_n_s32(0);
+        int32x4_t even_acc = vdupq_n_s32(0);
+
+        for (i = 0;  i < 12;  i++)
+        {
+            odd_acc = vmlal_n_s16(odd_acc, vld1_s16(&even[k + i]),
+                                  qmf_coeffs[i]);
+            even_acc = vmlal_n_s16(even_acc, vld1_s16(&odd[k + i]),
+                                   qmf_coeffs[11 - i]);
+        }
+        vst1q_s32(&xlow[k], vshrq_n_s32(vaddq_s32(even_acc, odd_acc), 14));
+        vst1q_s32(&xhigh[k], vshrq_n_s32(vsubq_s32(even_acc, odd_acc), 14));
+    }
+#endif
+    for (  ;  k < pairs;  k++)
+    {
+        sumeven = 0;
+        sumodd = 0;
+        for (i = 0;  i < 12;  i++)
+        {
+            sumodd += even[k + i]*qmf_coeffs[i];
+            sumeven += odd[k + i]*qmf_coeffs[11 - i];
+        }
+        /* We shift by 12 to allow for the QMF filters (DC gain = 4096), plus 1
+           to allow for us summing two filters, plus 1 to allow for the 15 bit
+           input to the G.722 algorithm. */
+        xlow[k] = (sumeven + sumodd) >> 14;
+        xhigh[k] = (sumeven - sumodd) >> 14;
+    }
+}
+/*- End of function --------------------------------------------------------*/
+
+/* Encode one low band and one high band sample into a G.722 code */
+static int encode_sample(g722_encode_state_t *s, int xlow, int xhigh)
 {
     int dlow;
     int dhigh;
@@ -284,153 +390,181 @@ int g722_encode(g722_encode_state_t *s, uint8_t g722_data[],
     int eh;
     int mih;
     int i;
-    int j;
-    /* Low and high band PCM from the QMF */
-    int xlow;
-    int xhigh;
-    int g722_bytes;
-    /* Even and odd tap accumulators */
-    int sumeven;
-    int sumodd;
     int ihigh;
     int ilow;
     int code;
 
-    g722_bytes = 0;
-    xhigh = 0;
-    for (j = 0;  j < len;  )
-    {
-        if (s->itu_test_mode)
-        {
-            xlow =
-            xhigh = amp[j++] >> 1;
-        }
-        else
-        {
-            {
-                /* Apply the transmit QMF */
-                /* Shuffle the buffer down */
-                for (i = 0;  i < 22;  i++)
-                    s->x[i] = s->x[i + 2];
-                //TODO: if len is odd, then this can be a buffer overrun
-                s->x[22] = amp[j++];
-                s->x[23] = amp[j++];
-    
-                /* Discard every other QMF output */
-                sumeven = 0;
-                sumodd = 0;
-                for (i = 0;  i < 12;  i++)
-                {
-                    sumodd += s->x[2*i]*qmf_coeffs[i];
-                    sumeven += s->x[2*i + 1]*qmf_coeffs[11 - i];
-                }
-                /* We shift by 12 to allow for the QMF filters (DC gain = 4096), plus 1
-                   to allow for us summing two filters, plus 1 to allow for the 15 bit
-                   input to the G.722 algorithm. */
-                xlow = (sumeven + sumodd) >> 14;
-                xhigh = (sumeven - sumodd) >> 14;
+    /* Block 1L, SUBTRA */
+    el = saturate(xlow - s->band[0].s);
 
-#ifdef RUN_LIKE_REFERENCE_G722
-                /* The following lines are only used to verify bit-exactness
-                 * with reference implementation of G.722. Higher precision
-                 * is achieved without limiting the values.
-                 */
-                xlow = limitValues(xlow);
-                xhigh = limitValues(xhigh);
-#endif
-            }
-        }
-        /* Block 1L, SUBTRA */
-        el = saturate(xlow - s->band[0].s);
+    /* Block 1L, QUANTL */
+    wd = (el >= 0)  ?  el  :  -(el + 1);
 
-        /* Block 1L, QUANTL */
-        wd = (el >= 0)  ?  el  :  -(el + 1);
-
-        for (i = 1;  i < 30;  i++)
-        {
-            wd1 = (q6[i]*s->band[0].det) >> 12;
-            if (wd < wd1)
-                break;
-        }
-        ilow = (el < 0)  ?  iln[i]  :  ilp[i];
-
-        /* Block 2L, INVQAL */
-        ril = ilow >> 2;
-        wd2 = qm4[ril];
-        dlow = (s->band[0].det*wd2) >> 15;
-
-        /* Block 3L, LOGSCL */
-        il4 = rl42[ril];
-        wd = (s->band[0].nb*127) >> 7;
-        s->band[0].nb = wd + wl[il4];
-        if (s->band[0].nb < 0)
-            s->band[0].nb = 0;
-        else if (s->band[0].nb > 18432)
-            s->band[0].nb = 18432;
-
-        /* Block 3L, SCALEL */
-        wd1 = (s->band[0].nb >> 6) & 31;
-        wd2 = 8 - (s->band[0].nb >> 11);
+    for (i = 1;  i < 30;  i++)
+    {
+        wd1 = (q6[i]*s->band[0].det) >> 12;
+        if (wd < wd1)
+            break;
+    }
+    ilow = (el < 0)  ?  iln[i]  :  ilp[i];
+
+    /* Block 2L, INVQAL */
+    ril = ilow >> 2;
+    wd2 = qm4[ril];
+    dlow = (s->band[0].det*wd2) >> 15;
+
+    /* Block 3L, LOGSCL */
+    il4 = rl42[ril];
+    wd = (s->band[0].nb*127) >> 7;
+    s->band[0].nb = wd + wl[il4];
+    if (s->band[0].nb < 0)
+        s->band[0].nb = 0;
+    else if (s->band[0].nb > 18432)
+        s->band[0].nb = 18432;
+
+    /* Block 3L, SCALEL */
+    wd1 = (s->band[0].nb >> 6) & 31;
+    wd2 = 8 - (s->band[0].nb >> 11);
+    wd3 = (wd2 < 0)  ?  (ilb[wd1] << -wd2)  :  (ilb[wd1] >> wd2);
+    s->band[0].det = wd3 << 2;
+
+    block4(&s->band[0], dlow);
+    {
+        int nb;
+
+        /* Block 1H, SUBTRA */
+        eh = saturate(xhigh - s->band[1].s);
+
+        /* Block 1H, QUANTH */
+        wd = (eh >= 0)  ?  eh  :  -(eh + 1);
+        wd1 = (564*s->band[1].det) >> 12;
+        mih = (wd >= wd1)  ?  2  :  1;
+        ihigh = (eh < 0)  ?  ihn[mih]  :  ihp[mih];
+
+        /* Block 2H, INVQAH */
+        wd2 = qm2[ihigh];
+        dhigh = (s->band[1].det*wd2) >> 15;
+
+        /* Block 3H, LOGSCH */
+        ih2 = rh2[ihigh];
+        wd = (s->band[1].nb*127) >> 7;
+
+        nb = wd + wh[ih2];
+        if (nb < 0)
+            nb = 0;
+        else if (nb > 22528)
+            nb = 22528;
+        s->band[1].nb = nb;
+
+        /* Block 3H, SCALEH */
+        wd1 = (s->band[1].nb >> 6) & 31;
+        wd2 = 10 - (s->band[1].nb >> 11);
         wd3 = (wd2 < 0)  ?  (ilb[wd1] << -wd2)  :  (ilb[wd1] >> wd2);
-        s->band[0].det = wd3 << 2;
+        s->band[1].det = wd3 << 2;
 
-        block4(&s->band[0], dlow);
-        {
-	    int nb;
-
-            /* Block 1H, SUBTRA */
-            eh = saturate(xhigh - s->band[1].s);
-
-            /* Block 1H, QUANTH */
-            wd = (eh >= 0)  ?  eh  :  -(eh + 1);
-            wd1 = (564*s->band[1].det) >> 12;
-            mih = (wd >= wd1)  ?  2  :  1;
-            ihigh = (eh < 0)  ?  ihn[mih]  :  ihp[mih];
-
-            /* Block 2H, INVQAH */
-            wd2 = qm2[ihigh];
-            dhigh = (s->band[1].det*wd2) >> 15;
-
-            /* Block 3H, LOGSCH */
-            ih2 = rh2[ihigh];
-            wd = (s->band[1].nb*127) >> 7;
-
-            nb = wd + wh[ih2];
-            if (nb < 0)
-                nb = 0;
-            else if (nb > 22528)
-                nb = 22528;
-	    s->band[1].nb = nb;
-
-            /* Block 3H, SCALEH */
-            wd1 = (s->band[1].nb >> 6) & 31;
-            wd2 = 10 - (s->band[1].nb >> 11);
-            wd3 = (wd2 < 0)  ?  (ilb[wd1] << -wd2)  :  (ilb[wd1] >> wd2);
-            s->band[1].det = wd3 << 2;
-
-            block4(&s->band[1], dhigh);
+        block4(&s->band[1], dhigh);
 #if   BITS_PER_SAMPLE == 8
-            code = ((ihigh << 6) | ilow);
+        code = ((ihigh << 6) | ilow);
 #elif BITS_PER_SAMPLE == 7
-            code = ((ihigh << 6) | ilow) >> 1;
+        code = ((ihigh << 6) | ilow) >> 1;
 #elif BITS_PER_SAMPLE == 6
-            code = ((ihigh << 6) | ilow) >> 2;
+        code = ((ihigh << 6) | ilow) >> 2;
 #endif
-        }
+    }
+    return code;
+}
+/*- End of function --------------------------------------------------------*/
 
+/* Append a G.722 code to the output */
+static int put_code(g722_encode_state_t *s, uint8_t g722_data[],
+                    int g722_bytes, int code)
+{
 #if PACKED_OUTPUT == 1
-            /* Pack the code bits */
-            s->out_buffer |= (code << s->out_bits);
-            s->out_bits += s->bits_per_sample;
-            if (s->out_bits >= 8)
-            {
-                g722_data[g722_bytes++] = (uint8_t) (s->out_buffer & 0xFF);
-                s->out_bits -= 8;
-                s->out_buffer >>= 8;
-            }
+    /* Pack the code bits */
+    s->out_buffer |= (code << s->out_bits);
+    s->out_bits += s->bits_per_sample;
+    if (s->out_bits >= 8)
+    {
+        g722_data[g722_bytes++] = (uint8_t) (s->out_buffer & 0xFF);
+        s->out_bits -= 8;
+        s->out_buffer >>= 8;
+    }
 #else
-            g722_data[g722_bytes++] = (uint8_t) code;
+    (void) s;
+    g722_data[g722_bytes++] = (uint8_t) code;
 #endif
+    return g722_bytes;
+}
+/*- End of function --------------------------------------------------------*/
+
+int g722_encode(g722_encode_state_t *s, uint8_t g722_data[],
+                       const int16_t amp[], int len)
+{
+    /* The even and odd samples of the QMF history and of one block */
+    int16_t even[QMF_HISTORY_PAIRS + QMF_BLOCK_PAIRS];
+    int16_t odd[QMF_HISTORY_PAIRS + QMF_BLOCK_PAIRS];
+    /* Low and high band PCM from the QMF */
+    int32_t xlow[QMF_BLOCK_PAIRS];
+    int32_t xhigh[QMF_BLOCK_PAIRS];
+    int g722_bytes;
+    int pairs;
+    int i;
+    int j;
+
+    g722_bytes = 0;
+    if (s->itu_test_mode)
+    {
+        for (j = 0;  j < len;  j++)
+        {
+            g722_bytes = put_code(s, g722_data, g722_bytes,
+                                  encode_sample(s, amp[j] >> 1, amp[j] >> 1));
+        }
+        return g722_bytes;
+    }
+
+    for (i = 0;  i < QMF_HISTORY_PAIRS;  i++)
+    {
+        even[i] = (int16_t) s->x[2*i + 2];
+        odd[i] = (int16_t) s->x[2*i + 3];
+    }
+    /* Only whole pairs of samples are encoded: an odd trailing sample is
+       dropped */
+    for (j = 0;  len - j >= 2;  j += 2*pairs)
+    {
+        pairs = (len - j) >> 1;
+        if (pairs > QMF_BLOCK_PAIRS)
+            pairs = QMF_BLOCK_PAIRS;
+        for (i = 0;  i < pairs;  i++)
+        {
+            even[QMF_HISTORY_PAIRS + i] = amp[j + 2*i];
+            odd[QMF_HISTORY_PAIRS + i] = amp[j + 2*i + 1];
+        }
+
+        qmf_analysis(even, odd, pairs, xlow, xhigh);
+        for (i = 0;  i < pairs;  i++)
+        {
+#ifdef RUN_LIKE_REFERENCE_G722
+            /* The following lines are only used to verify bit-exactness
+             * with reference implementation of G.722. Higher precision
+             * is achieved without limiting the values.
+             */
+            xlow[i] = limitValues(xlow[i]);
+            xhigh[i] = limitValues(xhigh[i]);
+#endif
+            g722_bytes = put_code(s, g722_data, g722_bytes,
+                                  encode_sample(s, xlow[i], xhigh[i]));
+        }
+
+        /* The window of the last pair is the new x[] */
+        s->x[0] = even[pairs - 1];
+        s->x[1] = odd[pairs - 1];
+        memmove(even, even + pairs, QMF_HISTORY_PAIRS*sizeof(even[0]));
+        memmove(odd, odd + pairs, QMF_HISTORY_PAIRS*sizeof(odd[0]));
+    }
+    for (i = 0;  i < QMF_HISTORY_PAIRS;  i++)
+    {
+        s->x[2*i + 2] = even[i];
+        s->x[2*i + 3] = odd[i];
     }
     return g722_bytes;
 }
@@ -0,0 +1,132 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "g722_enc_dec.h"
+
+namespace {
+
+// Long enough to span many QMF blocks, and the history carried between them
+constexpr int kNumSamples = 4000;
+
+// A sawtooth with noise on top, and full scale square waves every now and
+// then to exercise saturation. Integer only, so the samples are the same on
+// every platform.
+std::vector<int16_t> MakeSignal(int num_samples) {
+  std::vector<int16_t> pcm(num_samples);
+  uint32_t seed = 1;
+  for (int i = 0; i < num_samples; i++) {
+    seed = seed * 1103515245 + 12345;
+    int noise = static_cast<int16_t>(seed >> 16) >> 3;
+    int value = ((i * 397) % 40000) - 20000 + noise;
+    if ((i / 256) % 8 == 5) value = (i & 1) ? 32767 : -32768;
+    if (value > 32767) value = 32767;
+    if (value < -32768) value = -32768;
+    pcm[i] = static_cast<int16_t>(value);
+  }
+  return pcm;
+}
+
+// FNV-1a, to keep the golden output short
+uint32_t Digest(const std::vector<uint8_t>& data) {
+  uint32_t hash = 2166136261u;
+  for (uint8_t byte : data) hash = (hash ^ byte) * 16777619u;
+  return hash;
+}
+
+struct Golden {
+  bool itu_test_mode;
+  size_t size;
+  uint32_t digest;
+};
+
+// Output of the encoder as it was before the QMF was block processed, for
+// the first kNumSamples samples of MakeSignal(), encoded in a single call.
+// The rate and packing are fixed when the encoder is built, so the mode is
+// all there is to vary.
+const Golden kGolden[] = {
+    {false, 2000, 0x31fe2585},
+    {true, 4000, 0x8e498cd7},
+};
+
+std::vector<uint8_t> Encode(const Golden& golden,
+                            const std::vector<int>& chunks) {
+  std::vector<int16_t> pcm = MakeSignal(kNumSamples + 1);
+  g722_encode_state_t state;
+  g722_encode_init(&state, 64000, G722_PACKED);
+  state.itu_test_mode = golden.itu_test_mode;
+
+  std::vector<uint8_t> encoded(kNumSamples);
+  size_t size = 0;
+  size_t offset = 0;
+  for (int chunk : chunks) {
+    size += g722_encode(&state, encoded.data() + size, pcm.data() + offset,
+                        chunk);
+    offset += chunk;
+  }
+  encoded.resize(size);
+  return encoded;
+}
+
+}  // namespace
+
+TEST(G722EncodeTest, matches_golden) {
+  for (const Golden& golden : kGolden) {
+    std::vector<uint8_t> encoded = Encode(golden, {kNumSamples});
+    EXPECT_EQ(golden.size, encoded.size())
+        << "itu_test_mode " << golden.itu_test_mode;
+    EXPECT_EQ(golden.digest, Digest(encoded))
+        << "itu_test_mode " << golden.itu_test_mode;
+  }
+}
+
+TEST(G722EncodeTest, chunks_match_golden) {
+  // Chunks that end mid block, shorter than the QMF history, and longer than
+  // a block
+  const std::vector<int> chunks = {2,   20,  22, 126,  128,
+                                   130, 254, 2,  1316, 2000};
+  for (const Golden& golden : kGolden) {
+    std::vector<uint8_t> encoded = Encode(golden, chunks);
+    EXPECT_EQ(golden.size, encoded.size())
+        << "itu_test_mode " << golden.itu_test_mode;
+    EXPECT_EQ(golden.digest, Digest(encoded))
+        << "itu_test_mode " << golden.itu_test_mode;
+  }
+}
+
+TEST(G722EncodeTest, odd_length_drops_last_sample) {
+  // Out of ITU test mode a code is made from a pair of samples, so the last
+  // one of an odd length input is left out.
+  const Golden& golden = kGolden[0];
+  ASSERT_FALSE(golden.itu_test_mode);
+  std::vector<uint8_t> encoded = Encode(golden, {kNumSamples + 1});
+  EXPECT_EQ(golden.size, encoded.size());
+  EXPECT_EQ(golden.digest, Digest(encoded));
+}
+
+TEST(G722EncodeTest, odd_length_itu_test_mode) {
+  // In ITU test mode every sample is encoded on its own
+  const Golden& golden = kGolden[1];
+  ASSERT_TRUE(golden.itu_test_mode);
+  std::vector<uint8_t> encoded =
+      Encode(golden, {1, 3, 999, kNumSamples - 1003});
+  EXPECT_EQ(golden.size, encoded.size());
+  EXPECT_EQ(golden.digest, Digest(encoded));
+}
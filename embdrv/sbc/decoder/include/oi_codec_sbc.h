@@ -188,6 +188,13 @@ typedef struct {
   uint8_t cachedInfo; /**< Information about the previous frame */
 } OI_CODEC_SBC_FRAME_INFO;
 
+/** Instruction sets for the dequantizer and the synthesis filterbank, see
+ * OI_CODEC_SBC_COMMON_CONTEXT::simdLevel. Used internally. */
+#define OI_SBC_SIMD_NONE 0
+#define OI_SBC_SIMD_SSE4 1
+#define OI_SBC_SIMD_AVX2 2
+#define OI_SBC_SIMD_NEON 3
+
 /** Used internally. */
 typedef struct {
   const OI_CHAR* codecInfo;
@@ -208,6 +215,8 @@ typedef struct {
   OI_BYTE formatByte;
   uint8_t pcmStride;
   uint8_t maxChannels;
+  uint8_t simdLevel; /**< OI_SBC_SIMD_* kernels to decode with. Picked from
+                        the CPU features by OI_CODEC_SBC_DecoderReset(). */
 } OI_CODEC_SBC_COMMON_CONTEXT;
 
 /*
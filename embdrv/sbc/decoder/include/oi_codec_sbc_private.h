@@ -67,6 +67,14 @@ Function prototypes and macro definitions used internally by the codec.
 #define PRIVATE
 #endif
 
+/* The SIMD kernels in decoder-simd.c are bit-exact with the C code. They use
+ * the vector extensions of Clang, or of GCC 12 and later. Define SBC_NO_SIMD
+ * to leave them out. */
+#if !defined(SBC_NO_SIMD) && \
+    (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 12))
+#define SBC_SIMD
+#endif
+
 #ifndef INLINE
 #define INLINE
 #endif
@@ -127,6 +135,16 @@ typedef struct {
 
 #define DCT_SHIFT 15
 
+/* Constants of dct2_8(), also used by the SIMD version in decoder-simd.c */
+#define AAN_C4_FIX (759250125)  /* S1.30  759250125   0.707107*/
+#define AAN_C6_FIX (410903207)  /* S1.30  410903207   0.382683*/
+#define AAN_Q0_FIX (581104888)  /* S1.30  581104888   0.541196*/
+#define AAN_Q1_FIX (1402911301) /* S1.30 1402911301   1.306563*/
+
+#ifndef SBC_DEQUANT_LONG_SCALED_OFFSET
+#define SBC_DEQUANT_LONG_SCALED_OFFSET 1555931970
+#endif
+
 #define DCTIII_4_SHIFT_IN 2
 #define DCTIII_4_SHIFT_OUT 15
 
@@ -179,6 +197,7 @@ PRIVATE uint8_t OI_SBC_CalculateChecksum(OI_CODEC_SBC_FRAME_INFO* frame,
 /* Transform functions */
 PRIVATE void shift_buffer(SBC_BUFFER_T* dest, SBC_BUFFER_T* src,
                           OI_UINT wordCount);
+PRIVATE void dct2_8(SBC_BUFFER_T* RESTRICT out, int32_t const* RESTRICT x);
 PRIVATE void cosineModulateSynth4(SBC_BUFFER_T* RESTRICT out,
                                   int32_t const* RESTRICT in);
 PRIVATE void SynthWindow40_int32_int32_symmetry_with_sum(
@@ -214,6 +233,14 @@ PRIVATE void OI_SBC_ReadSamplesJoint(OI_CODEC_SBC_DECODER_CONTEXT* common,
 PRIVATE void OI_SBC_SynthFrame(OI_CODEC_SBC_DECODER_CONTEXT* context,
                                int16_t* pcm, OI_UINT start_block,
                                OI_UINT nrof_blocks);
+PRIVATE uint8_t OI_SBC_GetSimdLevel(void);
+#ifdef SBC_SIMD
+PRIVATE void OI_SBC_ReadSamplesSimd(OI_CODEC_SBC_DECODER_CONTEXT* context,
+                                    OI_BITSTREAM* global_bs);
+PRIVATE void OI_SBC_SynthFrame8SB_Simd(OI_CODEC_SBC_DECODER_CONTEXT* context,
+                                       int16_t* pcm, OI_UINT blkstart,
+                                       OI_UINT blkcount);
+#endif
 INLINE int32_t OI_SBC_Dequant(uint32_t raw, OI_UINT scale_factor, OI_UINT bits);
 PRIVATE OI_BOOL OI_SBC_ExamineCommandPacket(
     OI_CODEC_SBC_DECODER_CONTEXT* context, const OI_BYTE* data, uint32_t len);
@@ -72,6 +72,7 @@ INLINE OI_STATUS internal_DecoderReset(OI_CODEC_SBC_DECODER_CONTEXT* context,
 
   context->common.codecInfo = OI_Codec_Copyright;
   context->common.maxBitneed = 0;
+  context->common.simdLevel = OI_SBC_GetSimdLevel();
   context->limitFrameFormat = FALSE;
   OI_SBC_ExpandFrameFields(&context->common.frameInfo);
 
@@ -186,6 +187,14 @@ PRIVATE void OI_SBC_ReadSamples(OI_CODEC_SBC_DECODER_CONTEXT* context,
 
   const OI_UINT iter_count =
       common->frameInfo.nrof_channels * common->frameInfo.nrof_subbands / 4;
+
+#ifdef SBC_SIMD
+  if (common->simdLevel != OI_SBC_SIMD_NONE) {
+    OI_SBC_ReadSamplesSimd(context, global_bs);
+    return;
+  }
+#endif
+
   do {
     OI_UINT i;
     for (i = 0; i < iter_count; ++i) {
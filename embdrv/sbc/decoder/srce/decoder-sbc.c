@@ -465,6 +465,14 @@ PRIVATE void OI_SBC_ReadSamplesJoint(OI_CODEC_SBC_DECODER_CONTEXT* context,
                                      OI_BITSTREAM* global_bs) {
   OI_CODEC_SBC_COMMON_CONTEXT* common = &context->common;
   OI_UINT nrof_subbands = common->frameInfo.nrof_subbands;
+
+#ifdef SBC_SIMD
+  if (common->simdLevel != OI_SBC_SIMD_NONE) {
+    OI_SBC_ReadSamplesSimd(context, global_bs);
+    return;
+  }
+#endif
+
 #ifdef SPECIALIZE_READ_SAMPLES_JOINT
   OI_ASSERT((nrof_subbands >> 3u) <= 1u);
   SpecializedReadSamples[nrof_subbands >> 3](context, global_bs);
@@ -0,0 +1,334 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/**
+@file
+SIMD versions of the dequantizer and of the 8-subband synthesis filterbank,
+selected at runtime from the CPU features. See OI_CODEC_SBC_COMMON_CONTEXT
+simdLevel.
+
+The bitstream still has to be read one sample at a time, but the samples are
+now dequantized a whole frame at once. The DCT of synthesis-dct8.c runs on as
+many blocks at once as there are lanes: all blocks between two wraparounds of
+the filter buffer are independent of each other's windowing, so their DCTs
+can be computed before the first window is applied. The windowing of
+synthesis-8-generated.c computes the 8 output samples of a block in parallel.
+
+@ingroup codec_internal
+*/
+
+/**
+@addtogroup codec_internal
+@{
+*/
+
+#include <string.h>
+#include "oi_bitstream.h"
+#include "oi_codec_sbc_private.h"
+
+#ifdef SBC_SIMD
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SBC_SIMD_X86
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SBC_SIMD_ARM_NEON
+#endif
+
+/** Scales x by y bits to the right, adding a rounding factor.
+ */
+#ifndef SCALE
+#define SCALE(x, y) (((x) + (1 << ((y)-1))) >> (y))
+#endif
+
+typedef int32_t sbc_v4si __attribute__((vector_size(16)));
+typedef uint32_t sbc_v4su __attribute__((vector_size(16)));
+typedef int16_t sbc_v4hi __attribute__((vector_size(8)));
+typedef int32_t sbc_v8si __attribute__((vector_size(32)));
+typedef uint32_t sbc_v8su __attribute__((vector_size(32)));
+typedef int16_t sbc_v8hi __attribute__((vector_size(16)));
+typedef int16_t sbc_v16hi __attribute__((vector_size(32)));
+
+extern const uint32_t dequant_long_scaled[17];
+
+/* SynthWindow80_generated() as a matrix. Output sample j is the sum over rows
+ * r of (coef[r][j] * buffer[8 * r + k]) >> shift[r][j], with k taken from
+ * {4, 5, 6, 7, -, 7, 6, 5} for even rows and {4, 3, 2, 1, 0, 1, 2, 3} for odd
+ * rows. Left shifts of the generated code are folded into the coefficients. */
+static const int32_t synthWindow80Coef[10][8] = {
+    {0, -3263, -10385, -16457, 0, 16913, 11167, 9293},
+    {8235, 29293, 24995, 19083, 10445, -8443, -10337, -6087},
+    {-23167, -5229, -4944, -23641, 0, 7374, 7668, 9976},
+    {26479, 30835, 9161, -29015, -10594, -9632, -30605, -23144},
+    {-34794, -54042, -46126, -51556, 0, 61788, 66536, 94684},
+    {75192, 63266, 55122, 49160, 89196, 41020, 38212, 36110},
+    {34794, 34638, 18472, 24211, 0, -18233, 22117, 11537},
+    {26479, 26663, 12705, 23469, 10603, 9405, 16383, 3494},
+    {23167, 4555, 6239, 21223, 0, 1499, 7543, 1370},
+    {8235, 12419, 9251, 26913, 9539, 26189, 8603, 8721},
+};
+
+static const int32_t synthWindow80Shift[10][8] = {
+    {0, 5, 6, 6, 0, 5, 4, 3}, {3, 5, 5, 5, 4, 7, 4, 2},
+    {3, 0, 0, 2, 0, 0, 0, 0}, {2, 3, 3, 4, 0, 0, 1, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0}, {0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 1, 0, 3, 4, 1}, {2, 2, 1, 2, 0, 1, 2, 0},
+    {3, 1, 3, 8, 0, 1, 3, 0}, {3, 4, 4, 6, 4, 7, 6, 7},
+};
+
+#ifdef SBC_SIMD_X86
+#define SBC_SIMD_FN(name) name##Sse4
+#define SBC_SIMD_TARGET __attribute__((target("sse4.1")))
+#define SBC_SIMD_LANES 4
+#define SBC_SIMD_VEC sbc_v4si
+#define SBC_SIMD_UVEC sbc_v4su
+#define SBC_SIMD_VEC16 sbc_v4hi
+#include "decoder-simd.inc"
+#undef SBC_SIMD_FN
+#undef SBC_SIMD_TARGET
+#undef SBC_SIMD_LANES
+#undef SBC_SIMD_VEC
+#undef SBC_SIMD_UVEC
+#undef SBC_SIMD_VEC16
+
+#define SBC_SIMD_FN(name) name##Avx2
+#define SBC_SIMD_TARGET __attribute__((target("avx2")))
+#define SBC_SIMD_LANES 8
+#define SBC_SIMD_VEC sbc_v8si
+#define SBC_SIMD_UVEC sbc_v8su
+#define SBC_SIMD_VEC16 sbc_v8hi
+#include "decoder-simd.inc"
+#undef SBC_SIMD_FN
+#undef SBC_SIMD_TARGET
+#undef SBC_SIMD_LANES
+#undef SBC_SIMD_VEC
+#undef SBC_SIMD_UVEC
+#undef SBC_SIMD_VEC16
+#endif /* SBC_SIMD_X86 */
+
+#ifdef SBC_SIMD_ARM_NEON
+#define SBC_SIMD_FN(name) name##Neon
+#define SBC_SIMD_TARGET
+#define SBC_SIMD_LANES 4
+#define SBC_SIMD_VEC sbc_v4si
+#define SBC_SIMD_UVEC sbc_v4su
+#define SBC_SIMD_VEC16 sbc_v4hi
+#include "decoder-simd.inc"
+#undef SBC_SIMD_FN
+#undef SBC_SIMD_TARGET
+#undef SBC_SIMD_LANES
+#undef SBC_SIMD_VEC
+#undef SBC_SIMD_UVEC
+#undef SBC_SIMD_VEC16
+#endif /* SBC_SIMD_ARM_NEON */
+
+typedef struct {
+  void (*dequant)(int32_t* s, OI_UINT count, const uint32_t* mult,
+                  const int32_t* keep, const int32_t* shift);
+  OI_UINT (*dct2_8)(SBC_BUFFER_T* const* out, int32_t const* in,
+                    OI_UINT count);
+  void (*synthWindow80)(int16_t* pcm, SBC_BUFFER_T const* buffer);
+} SIMD_KERNELS;
+
+/* Indexed by OI_SBC_SIMD_* */
+static const SIMD_KERNELS SimdKernels[] = {
+    {NULL, NULL, NULL},
+#ifdef SBC_SIMD_X86
+    {DequantSse4, Dct2_8Sse4, SynthWindow80Sse4},
+    {DequantAvx2, Dct2_8Avx2, SynthWindow80Avx2},
+#else
+    {NULL, NULL, NULL},
+    {NULL, NULL, NULL},
+#endif
+#ifdef SBC_SIMD_ARM_NEON
+    {DequantNeon, Dct2_8Neon, SynthWindow80Neon},
+#else
+    {NULL, NULL, NULL},
+#endif
+};
+
+#endif /* SBC_SIMD */
+
+PRIVATE uint8_t OI_SBC_GetSimdLevel(void) {
+#if defined(SBC_SIMD) && defined(SBC_SIMD_X86)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) return OI_SBC_SIMD_AVX2;
+  if (__builtin_cpu_supports("sse4.1")) return OI_SBC_SIMD_SSE4;
+  return OI_SBC_SIMD_NONE;
+#elif defined(SBC_SIMD) && defined(SBC_SIMD_ARM_NEON)
+  return OI_SBC_SIMD_NEON;
+#else
+  return OI_SBC_SIMD_NONE;
+#endif
+}
+
+#ifdef SBC_SIMD
+
+/** Reads the quantized subband samples of a frame, then dequantizes them and
+ * undoes joint stereo coding. Same result as OI_SBC_ReadSamples() and
+ * OI_SBC_ReadSamplesJoint(). */
+PRIVATE void OI_SBC_ReadSamplesSimd(OI_CODEC_SBC_DECODER_CONTEXT* context,
+                                    OI_BITSTREAM* global_bs) {
+  OI_CODEC_SBC_COMMON_CONTEXT* common = &context->common;
+  const SIMD_KERNELS* kernels = &SimdKernels[common->simdLevel];
+  OI_UINT nrof_blocks = common->frameInfo.nrof_blocks;
+  OI_UINT nrof_subbands = common->frameInfo.nrof_subbands;
+  OI_UINT width = common->frameInfo.nrof_channels * nrof_subbands;
+  int32_t* RESTRICT s = common->subdata;
+  uint8_t* ptr = global_bs->ptr.w;
+  uint32_t value = global_bs->value;
+  OI_UINT bitPtr = global_bs->bitPtr;
+  uint32_t mult[16];
+  int32_t keep[16];
+  int32_t shift[16];
+  OI_UINT blk, i;
+
+  /* The frame is 16 values wide at most; narrower frames repeat the tables */
+  for (i = 0; i < 16; i++) {
+    uint8_t bits = common->bits.uint8[i % width];
+    mult[i] = bits > 1 ? dequant_long_scaled[bits] : 0;
+    keep[i] = bits > 1 ? -1 : 0;
+    shift[i] = 15 - common->scale_factor[i % width];
+  }
+
+  for (blk = 0; blk < nrof_blocks; blk++) {
+    for (i = 0; i < width; i++) {
+      uint8_t bits = common->bits.uint8[i];
+      uint32_t raw = 0;
+      if (bits) {
+        OI_BITSTREAM_READUINT(raw, bits, ptr, value, bitPtr);
+      }
+      *s++ = raw;
+    }
+  }
+
+  kernels->dequant(common->subdata, nrof_blocks * width, mult, keep, shift);
+
+  if (common->frameInfo.nrof_channels == 2 && common->frameInfo.join) {
+    uint8_t jmask = common->frameInfo.join << (8 - nrof_subbands);
+    sbc_v4si joint[SBC_MAX_BANDS / 4];
+    sbc_v4si left, right;
+    OI_UINT sb;
+
+    for (sb = 0; sb < nrof_subbands; sb++) {
+      joint[sb / 4][sb % 4] = ((jmask << sb) & 0x80) ? -1 : 0;
+    }
+    s = common->subdata;
+    for (blk = 0; blk < nrof_blocks; blk++) {
+      for (sb = 0; sb < nrof_subbands; sb += 4) {
+        memcpy(&left, &s[sb], sizeof(left));
+        memcpy(&right, &s[nrof_subbands + sb], sizeof(right));
+        /* mid/side to left/right where the joint bit is set */
+        sbc_v4si side = right & joint[sb / 4];
+        right = (right & ~joint[sb / 4]) | ((left - right) & joint[sb / 4]);
+        left += side;
+        memcpy(&s[sb], &left, sizeof(left));
+        memcpy(&s[nrof_subbands + sb], &right, sizeof(right));
+      }
+      s += width;
+    }
+  }
+}
+
+/** OI_SBC_SynthFrame_80() on top of the SIMD kernels. */
+PRIVATE void OI_SBC_SynthFrame8SB_Simd(OI_CODEC_SBC_DECODER_CONTEXT* context,
+                                       int16_t* pcm, OI_UINT blkstart,
+                                       OI_UINT blkcount) {
+  OI_CODEC_SBC_COMMON_CONTEXT* common = &context->common;
+  const SIMD_KERNELS* kernels = &SimdKernels[common->simdLevel];
+  OI_UINT nrof_channels = common->frameInfo.nrof_channels;
+  OI_UINT pcmStrideShift = common->pcmStride == 1 ? 0 : 1;
+  OI_UINT offset = common->filterBufferOffset;
+  int32_t* s = common->subdata + 8 * nrof_channels * blkstart;
+  OI_UINT blk = blkstart;
+  OI_UINT blkstop = blkstart + blkcount;
+  SBC_BUFFER_T* out[SBC_MAX_BLOCKS * SBC_MAX_CHANNELS];
+  int16_t samples[SBC_MAX_CHANNELS][8];
+
+  while (blk < blkstop) {
+    OI_UINT run, count, n, i, ch, j;
+
+    if (offset == 0) {
+      shift_buffer(common->filterBuffer[0] + common->filterBufferLen - 72,
+                   common->filterBuffer[0], 72);
+      if (nrof_channels == 2) {
+        shift_buffer(common->filterBuffer[1] + common->filterBufferLen - 72,
+                     common->filterBuffer[1], 72);
+      }
+      offset = common->filterBufferLen - 80;
+    } else {
+      offset -= 8;
+    }
+
+    /* Blocks up to the next wraparound of the filter buffer. Each one only
+     * reads what the DCT of the earlier blocks wrote above it. */
+    run = offset / 8 + 1;
+    if (run > blkstop - blk) {
+      run = blkstop - blk;
+    }
+    count = run * nrof_channels;
+    for (i = 0; i < count; i++) {
+      out[i] = common->filterBuffer[i % nrof_channels] + offset -
+               8 * (i / nrof_channels);
+    }
+    n = kernels->dct2_8(out, s, count);
+#ifdef SBC_SIMD_X86
+    if (common->simdLevel == OI_SBC_SIMD_AVX2) {
+      n += Dct2_8Sse4(&out[n], &s[8 * n], count - n);
+    }
+#endif
+    for (; n < count; n++) {
+      dct2_8(out[n], &s[8 * n]);
+    }
+
+    for (i = 0; i < run; i++) {
+      for (ch = 0; ch < nrof_channels; ch++) {
+        kernels->synthWindow80(samples[ch], out[i * nrof_channels + ch]);
+      }
+      if (nrof_channels == 2 && pcmStrideShift == 1) {
+        sbc_v8hi left, right;
+        sbc_v16hi interleaved;
+        memcpy(&left, samples[0], sizeof(left));
+        memcpy(&right, samples[1], sizeof(right));
+        interleaved = __builtin_shufflevector(left, right, 0, 8, 1, 9, 2, 10,
+                                              3, 11, 4, 12, 5, 13, 6, 14, 7,
+                                              15);
+        memcpy(pcm, &interleaved, sizeof(interleaved));
+      } else {
+        for (ch = 0; ch < nrof_channels; ch++) {
+          for (j = 0; j < 8; j++) {
+            pcm[ch + (j << pcmStrideShift)] = samples[ch][j];
+          }
+        }
+      }
+      pcm += (8 << pcmStrideShift);
+    }
+
+    offset -= 8 * (run - 1);
+    s += 8 * count;
+    blk += run;
+  }
+  common->filterBufferOffset = offset;
+}
+
+#endif /* SBC_SIMD */
+
+/**
+@}
+*/
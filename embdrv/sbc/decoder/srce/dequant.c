@@ -105,10 +105,6 @@
 
 #include <oi_codec_sbc_private.h>
 
-#ifndef SBC_DEQUANT_LONG_SCALED_OFFSET
-#define SBC_DEQUANT_LONG_SCALED_OFFSET 1555931970
-#endif
-
 #ifndef SBC_DEQUANT_LONG_UNSCALED_OFFSET
 #define SBC_DEQUANT_LONG_UNSCALED_OFFSET 2147483648
 #endif
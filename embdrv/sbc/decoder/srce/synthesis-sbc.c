@@ -249,7 +249,6 @@ PRIVATE void SynthWindow80_generated(int16_t* pcm,
 PRIVATE void SynthWindow112_generated(int16_t* pcm,
                                       SBC_BUFFER_T const* RESTRICT buffer,
                                       OI_UINT strideShift);
-PRIVATE void dct2_8(SBC_BUFFER_T* RESTRICT out, int32_t const* RESTRICT x);
 
 typedef void (*SYNTH_FRAME)(OI_CODEC_SBC_DECODER_CONTEXT* context, int16_t* pcm,
                             OI_UINT blkstart, OI_UINT blkcount);
@@ -424,6 +423,12 @@ PRIVATE void OI_SBC_SynthFrame(OI_CODEC_SBC_DECODER_CONTEXT* context,
     SynthFrameEnhanced[nrof_channels](context, pcm, start_block, nrof_blocks);
 #endif /* SBC_ENHANCED */
   } else {
+#ifdef SBC_SIMD
+    if (context->common.simdLevel != OI_SBC_SIMD_NONE) {
+      OI_SBC_SynthFrame8SB_Simd(context, pcm, start_block, nrof_blocks);
+      return;
+    }
+#endif
     SynthFrame8SB[nrof_channels](context, pcm, start_block, nrof_blocks);
   }
 }
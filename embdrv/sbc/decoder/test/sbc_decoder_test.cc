@@ -0,0 +1,193 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "oi_codec_sbc.h"
+#include "oi_status.h"
+#include "sbc_encoder.h"
+
+namespace {
+
+constexpr int kNumFrames = 200;
+constexpr int kMaxFrameSamples =
+    SBC_MAX_NUM_OF_BLOCKS * SBC_MAX_NUM_OF_SUBBANDS * SBC_MAX_NUM_OF_CHANNELS;
+constexpr int kMaxFrameBytes = 1024;
+
+struct Config {
+  int16_t subbands;
+  int16_t blocks;
+  int16_t channel_mode;
+};
+
+std::vector<Config> AllConfigs() {
+  std::vector<Config> configs;
+  for (int16_t subbands : {SUB_BANDS_4, SUB_BANDS_8}) {
+    for (int16_t blocks : {4, 8, 12, 16}) {
+      for (int16_t mode :
+           {SBC_MONO, SBC_DUAL, SBC_STEREO, SBC_JOINT_STEREO}) {
+        configs.push_back({subbands, blocks, mode});
+      }
+    }
+  }
+  return configs;
+}
+
+// Encodes a tone with noise on top, and full scale square waves every now
+// and then, so the decoder sees both small and saturating subband samples.
+std::vector<uint8_t> Encode(const Config& config, double frequency) {
+  SBC_ENC_PARAMS params;
+  memset(&params, 0, sizeof(params));
+  params.s16SamplingFreq = SBC_sf44100;
+  params.s16ChannelMode = config.channel_mode;
+  params.s16NumOfSubBands = config.subbands;
+  params.s16NumOfBlocks = config.blocks;
+  params.s16AllocationMethod = SBC_LOUDNESS;
+  params.u16BitRate = 328;
+  SBC_Encoder_Init(&params);
+
+  std::vector<uint8_t> encoded;
+  int16_t pcm[kMaxFrameSamples];
+  uint8_t frame[kMaxFrameBytes];
+  uint32_t seed = 1;
+  int sample = 0;
+  int num_samples = params.s16NumOfBlocks * params.s16NumOfSubBands *
+                    params.s16NumOfChannels;
+  for (int i = 0; i < kNumFrames; i++) {
+    for (int j = 0; j < num_samples; j++, sample++) {
+      seed = seed * 1103515245 + 12345;
+      int noise = static_cast<int16_t>(seed >> 16) >> 3;
+      int value = static_cast<int>(20000 * sin(sample * frequency)) + noise;
+      if ((sample / 1024) % 16 == 3) value = (j & 1) ? 32767 : -32768;
+      if (value > 32767) value = 32767;
+      if (value < -32768) value = -32768;
+      pcm[j] = static_cast<int16_t>(value);
+    }
+    uint32_t len = SBC_Encode(&params, pcm, frame);
+    encoded.insert(encoded.end(), frame, frame + len);
+  }
+  return encoded;
+}
+
+class Decoder {
+ public:
+  Decoder(uint8_t max_channels, uint8_t pcm_stride) {
+    OI_STATUS status = OI_CODEC_SBC_DecoderReset(
+        &context_, data_, sizeof(data_), max_channels, pcm_stride, false);
+    EXPECT_TRUE(OI_SUCCESS(status));
+  }
+
+  uint8_t simd_level() const { return context_.common.simdLevel; }
+  void set_simd_level(uint8_t level) { context_.common.simdLevel = level; }
+
+  // Decodes one frame from the front of data, appending it to decoded.
+  bool DecodeFrame(const OI_BYTE** data, uint32_t* size,
+                   std::vector<int16_t>* decoded) {
+    int16_t pcm[SBC_MAX_SAMPLES_PER_FRAME * SBC_MAX_CHANNELS] = {};
+    uint32_t pcm_bytes = sizeof(pcm);
+    OI_STATUS status =
+        OI_CODEC_SBC_DecodeFrame(&context_, data, size, pcm, &pcm_bytes);
+    EXPECT_TRUE(OI_SUCCESS(status)) << "status " << status;
+    if (!OI_SUCCESS(status)) return false;
+    decoded->insert(decoded->end(), pcm, pcm + pcm_bytes / sizeof(*pcm));
+    return true;
+  }
+
+  std::vector<int16_t> DecodeAll(const std::vector<uint8_t>& encoded) {
+    std::vector<int16_t> decoded;
+    const OI_BYTE* data = encoded.data();
+    uint32_t size = encoded.size();
+    while (size > 0 && DecodeFrame(&data, &size, &decoded)) {
+    }
+    return decoded;
+  }
+
+ private:
+  OI_CODEC_SBC_DECODER_CONTEXT context_ = {};
+  uint32_t data_[CODEC_DATA_WORDS(2, SBC_CODEC_FAST_FILTER_BUFFERS)] = {};
+};
+
+std::vector<uint8_t> SimdLevels() {
+  Decoder decoder(2, 2);
+  std::vector<uint8_t> levels;
+  if (decoder.simd_level() != OI_SBC_SIMD_NONE) {
+    levels.push_back(decoder.simd_level());
+  }
+  if (decoder.simd_level() == OI_SBC_SIMD_AVX2) {
+    levels.push_back(OI_SBC_SIMD_SSE4);
+  }
+  return levels;
+}
+
+std::vector<int16_t> Decode(const std::vector<uint8_t>& encoded,
+                            uint8_t max_channels, uint8_t pcm_stride,
+                            uint8_t simd_level) {
+  Decoder decoder(max_channels, pcm_stride);
+  decoder.set_simd_level(simd_level);
+  return decoder.DecodeAll(encoded);
+}
+
+}  // namespace
+
+TEST(SbcDecoderTest, simd_matches_scalar) {
+  for (const Config& config : AllConfigs()) {
+    std::vector<uint8_t> encoded = Encode(config, 0.01);
+    std::vector<int16_t> scalar = Decode(encoded, 2, 2, OI_SBC_SIMD_NONE);
+    ASSERT_FALSE(scalar.empty());
+    for (uint8_t level : SimdLevels()) {
+      EXPECT_EQ(scalar, Decode(encoded, 2, 2, level))
+          << "level " << +level << " subbands " << config.subbands
+          << " blocks " << config.blocks << " mode " << config.channel_mode;
+    }
+  }
+}
+
+TEST(SbcDecoderTest, simd_matches_scalar_mono_stride_1) {
+  for (const Config& config : AllConfigs()) {
+    if (config.channel_mode != SBC_MONO) continue;
+    std::vector<uint8_t> encoded = Encode(config, 0.03);
+    std::vector<int16_t> scalar = Decode(encoded, 1, 1, OI_SBC_SIMD_NONE);
+    ASSERT_FALSE(scalar.empty());
+    for (uint8_t level : SimdLevels()) {
+      EXPECT_EQ(scalar, Decode(encoded, 1, 1, level))
+          << "level " << +level << " subbands " << config.subbands
+          << " blocks " << config.blocks;
+    }
+  }
+}
+
+TEST(SbcDecoderTest, simd_level_switch_mid_stream) {
+  // The filter buffer is shared between both implementations, so switching
+  // between them on a frame boundary must not change the output.
+  Config config = {SUB_BANDS_8, 16, SBC_JOINT_STEREO};
+  std::vector<uint8_t> encoded = Encode(config, 0.05);
+  std::vector<int16_t> scalar = Decode(encoded, 2, 2, OI_SBC_SIMD_NONE);
+  for (uint8_t level : SimdLevels()) {
+    Decoder decoder(2, 2);
+    std::vector<int16_t> decoded;
+    const OI_BYTE* data = encoded.data();
+    uint32_t size = encoded.size();
+    for (int i = 0; size > 0; i++) {
+      decoder.set_simd_level(i % 3 == 0 ? OI_SBC_SIMD_NONE : level);
+      ASSERT_TRUE(decoder.DecodeFrame(&data, &size, &decoded));
+    }
+    EXPECT_EQ(scalar, decoded) << "level " << +level;
+  }
+}
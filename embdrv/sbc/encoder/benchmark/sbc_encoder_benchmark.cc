@@ -0,0 +1,83 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "sbc_encoder.h"
+
+using ::benchmark::State;
+
+// Number of different PCM frames cycled through, so the encoder does not see
+// the same input over and over.
+#define NUM_PCM_FRAMES 64
+
+static const int16_t kBestSimdLevel = -1;
+
+// Encodes joint stereo frames at 44.1 kHz. items_per_second is the number of
+// frames encoded per second on one core; every benchmark thread owns its own
+// encoder instance.
+// Args: subbands, blocks, SIMD level (kBestSimdLevel for what the CPU has).
+static void BM_SbcEncode(State& state) {
+  SBC_ENC_PARAMS params;
+  memset(&params, 0, sizeof(params));
+  params.s16SamplingFreq = SBC_sf44100;
+  params.s16ChannelMode = SBC_JOINT_STEREO;
+  params.s16NumOfSubBands = state.range(0);
+  params.s16NumOfBlocks = state.range(1);
+  params.s16AllocationMethod = SBC_LOUDNESS;
+  params.u16BitRate = 328;
+  SBC_Encoder_Init(&params);
+  if (state.range(2) != kBestSimdLevel) params.s16SimdLevel = state.range(2);
+
+  int frame_samples = params.s16NumOfSubBands * params.s16NumOfBlocks *
+                      params.s16NumOfChannels;
+  std::vector<int16_t> pcm(NUM_PCM_FRAMES * frame_samples);
+  for (size_t i = 0; i < pcm.size(); i++) {
+    pcm[i] = 16000 * sin(i * 0.013) + 4000 * sin(i * 0.171);
+  }
+
+  uint8_t output[1024];
+  int frame = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        SBC_Encode(&params, &pcm[frame * frame_samples], output));
+    frame = (frame + 1) % NUM_PCM_FRAMES;
+  }
+
+  state.SetItemsProcessed(state.iterations());
+  state.SetLabel(params.s16SimdLevel == SBC_SIMD_NONE ? "scalar" : "simd");
+}
+
+static void SbcEncodeConfigs(benchmark::internal::Benchmark* b) {
+  for (int subbands : {SUB_BANDS_4, SUB_BANDS_8}) {
+    for (int blocks : {4, 8, 12, 16}) {
+      b->Args({subbands, blocks, SBC_SIMD_NONE});
+      b->Args({subbands, blocks, kBestSimdLevel});
+    }
+  }
+}
+
+BENCHMARK(BM_SbcEncode)->Apply(SbcEncodeConfigs);
+
+// Independent encoders on several threads at once, as with two A2DP sinks
+BENCHMARK(BM_SbcEncode)
+    ->Args({SUB_BANDS_8, 16, kBestSimdLevel})
+    ->Threads(2)
+    ->Threads(4);
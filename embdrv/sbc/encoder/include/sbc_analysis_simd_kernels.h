@@ -0,0 +1,274 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  Windowing and DCT kernels of the analysis filter, written with the
+ *  GCC/Clang vector extensions. This file has no include guard: it is
+ *  included by sbc_analysis_simd.c once per instruction set, with
+ *
+ *    SBC_SIMD_FN(name)  suffixes |name| for that instruction set
+ *    SBC_SIMD_TARGET    function attribute selecting the instruction set
+ *    SBC_SIMD_VEC       vector of SBC_SIMD_LANES int32_t
+ *    SBC_SIMD_VEC16     vector of SBC_SIMD_LANES int16_t
+ *
+ *  All arithmetic is done on 32 bit lanes exactly as the scalar code does it,
+ *  so the output is bit-exact with SbcAnalysisFilter4/8 and SBC_FastIDCT8/4.
+ *  The DCT works on SBC_SIMD_LANES blocks at once, one block per lane; the
+ *  blocks are transposed in registers on the way in and out.
+ *
+ ******************************************************************************/
+
+static inline SBC_SIMD_TARGET SBC_SIMD_VEC
+SBC_SIMD_FN(Load16)(const int16_t* ps16In) {
+  SBC_SIMD_VEC16 v;
+  memcpy(&v, ps16In, sizeof(v));
+  return __builtin_convertvector(v, SBC_SIMD_VEC);
+}
+
+static inline SBC_SIMD_TARGET SBC_SIMD_VEC
+SBC_SIMD_FN(Load32)(const int32_t* ps32In) {
+  SBC_SIMD_VEC v;
+  memcpy(&v, ps32In, sizeof(v));
+  return v;
+}
+
+/* Transposes the SBC_SIMD_LANES x SBC_SIMD_LANES matrix held in |v| */
+static inline SBC_SIMD_TARGET void SBC_SIMD_FN(Transpose)(SBC_SIMD_VEC* v) {
+  SBC_SIMD_VEC t0, t1, t2, t3;
+#if (SBC_SIMD_LANES == 4)
+  t0 = __builtin_shufflevector(v[0], v[1], 0, 4, 1, 5);
+  t1 = __builtin_shufflevector(v[0], v[1], 2, 6, 3, 7);
+  t2 = __builtin_shufflevector(v[2], v[3], 0, 4, 1, 5);
+  t3 = __builtin_shufflevector(v[2], v[3], 2, 6, 3, 7);
+  v[0] = __builtin_shufflevector(t0, t2, 0, 1, 4, 5);
+  v[1] = __builtin_shufflevector(t0, t2, 2, 3, 6, 7);
+  v[2] = __builtin_shufflevector(t1, t3, 0, 1, 4, 5);
+  v[3] = __builtin_shufflevector(t1, t3, 2, 3, 6, 7);
+#elif (SBC_SIMD_LANES == 8)
+  SBC_SIMD_VEC t4, t5, t6, t7, u0, u1, u2, u3, u4, u5, u6, u7;
+  t0 = __builtin_shufflevector(v[0], v[1], 0, 8, 1, 9, 4, 12, 5, 13);
+  t1 = __builtin_shufflevector(v[0], v[1], 2, 10, 3, 11, 6, 14, 7, 15);
+  t2 = __builtin_shufflevector(v[2], v[3], 0, 8, 1, 9, 4, 12, 5, 13);
+  t3 = __builtin_shufflevector(v[2], v[3], 2, 10, 3, 11, 6, 14, 7, 15);
+  t4 = __builtin_shufflevector(v[4], v[5], 0, 8, 1, 9, 4, 12, 5, 13);
+  t5 = __builtin_shufflevector(v[4], v[5], 2, 10, 3, 11, 6, 14, 7, 15);
+  t6 = __builtin_shufflevector(v[6], v[7], 0, 8, 1, 9, 4, 12, 5, 13);
+  t7 = __builtin_shufflevector(v[6], v[7], 2, 10, 3, 11, 6, 14, 7, 15);
+  u0 = __builtin_shufflevector(t0, t2, 0, 1, 8, 9, 4, 5, 12, 13);
+  u1 = __builtin_shufflevector(t0, t2, 2, 3, 10, 11, 6, 7, 14, 15);
+  u2 = __builtin_shufflevector(t1, t3, 0, 1, 8, 9, 4, 5, 12, 13);
+  u3 = __builtin_shufflevector(t1, t3, 2, 3, 10, 11, 6, 7, 14, 15);
+  u4 = __builtin_shufflevector(t4, t6, 0, 1, 8, 9, 4, 5, 12, 13);
+  u5 = __builtin_shufflevector(t4, t6, 2, 3, 10, 11, 6, 7, 14, 15);
+  u6 = __builtin_shufflevector(t5, t7, 0, 1, 8, 9, 4, 5, 12, 13);
+  u7 = __builtin_shufflevector(t5, t7, 2, 3, 10, 11, 6, 7, 14, 15);
+  v[0] = __builtin_shufflevector(u0, u4, 0, 1, 2, 3, 8, 9, 10, 11);
+  v[1] = __builtin_shufflevector(u1, u5, 0, 1, 2, 3, 8, 9, 10, 11);
+  v[2] = __builtin_shufflevector(u2, u6, 0, 1, 2, 3, 8, 9, 10, 11);
+  v[3] = __builtin_shufflevector(u3, u7, 0, 1, 2, 3, 8, 9, 10, 11);
+  v[4] = __builtin_shufflevector(u0, u4, 4, 5, 6, 7, 12, 13, 14, 15);
+  v[5] = __builtin_shufflevector(u1, u5, 4, 5, 6, 7, 12, 13, 14, 15);
+  v[6] = __builtin_shufflevector(u2, u6, 4, 5, 6, 7, 12, 13, 14, 15);
+  v[7] = __builtin_shufflevector(u3, u7, 4, 5, 6, 7, 12, 13, 14, 15);
+#else
+#error "unsupported number of SIMD lanes"
+#endif
+}
+
+/* Loads element k of SBC_SIMD_LANES consecutive blocks of |s32Width|
+ * elements into lane l of y[k] */
+static inline SBC_SIMD_TARGET void SBC_SIMD_FN(LoadBlocks)(
+    const int32_t* ps32In, int32_t s32Width, SBC_SIMD_VEC* y) {
+  SBC_SIMD_VEC m[SBC_SIMD_LANES];
+  int32_t k, l;
+  for (k = 0; k < s32Width; k += SBC_SIMD_LANES) {
+    for (l = 0; l < SBC_SIMD_LANES; l++) {
+      m[l] = SBC_SIMD_FN(Load32)(&ps32In[l * s32Width + k]);
+    }
+    SBC_SIMD_FN(Transpose)(m);
+    for (l = 0; l < SBC_SIMD_LANES; l++) y[k + l] = m[l];
+  }
+}
+
+/* Stores lane l of o[i] to ps32Out[l * s32SubBands + i], the reverse of
+ * LoadBlocks(). s32SubBands may be smaller than the number of lanes. */
+static inline SBC_SIMD_TARGET void SBC_SIMD_FN(StoreBlocks)(
+    const SBC_SIMD_VEC* o, int32_t s32SubBands, int32_t* ps32Out) {
+  SBC_SIMD_VEC m[SBC_SIMD_LANES];
+  int32_t i, l, s32Count;
+  for (i = 0; i < s32SubBands; i += SBC_SIMD_LANES) {
+    s32Count = s32SubBands - i;
+    if (s32Count > SBC_SIMD_LANES) s32Count = SBC_SIMD_LANES;
+    for (l = 0; l < SBC_SIMD_LANES; l++) {
+      if (l < s32Count) {
+        m[l] = o[i + l];
+      } else {
+        m[l] = m[0] ^ m[0];
+      }
+    }
+    SBC_SIMD_FN(Transpose)(m);
+    for (l = 0; l < SBC_SIMD_LANES; l++) {
+      memcpy(&ps32Out[l * s32SubBands + i], &m[l], s32Count * sizeof(int32_t));
+    }
+  }
+}
+
+/* SBC_MULT_32_16_SIMPLIFIED without the 64 bit product:
+ * (c * x) >> 15 == c * (x >> 16) * 2 + ((c * (x & 0xFFFF)) >> 15)
+ * holds exactly, and neither term overflows, for 0 <= c < 0x8000. */
+static inline SBC_SIMD_TARGET SBC_SIMD_VEC
+SBC_SIMD_FN(MultCos)(int32_t s32Cos, SBC_SIMD_VEC x) {
+  return (x >> 16) * (s32Cos << 1) + (((x & 0xFFFF) * s32Cos) >> 15);
+}
+
+/* ps32Y[j] = sum of ps32Window[r][j] * ps16X[r * s32Width + j] for r = 0..4 */
+static inline SBC_SIMD_TARGET void SBC_SIMD_FN(Window)(
+    const int16_t* ps16X, const int32_t* ps32Window, int32_t s32Width,
+    int32_t* ps32Y) {
+  SBC_SIMD_VEC acc;
+  int32_t j, r;
+  for (j = 0; j < s32Width; j += SBC_SIMD_LANES) {
+    acc = SBC_SIMD_FN(Load32)(&ps32Window[j]) * SBC_SIMD_FN(Load16)(&ps16X[j]);
+    for (r = 1; r < 5; r++) {
+      acc += SBC_SIMD_FN(Load32)(&ps32Window[r * s32Width + j]) *
+             SBC_SIMD_FN(Load16)(&ps16X[r * s32Width + j]);
+    }
+    memcpy(&ps32Y[j], &acc, sizeof(acc));
+  }
+}
+
+static SBC_SIMD_TARGET void SBC_SIMD_FN(Window4)(const int16_t* ps16X,
+                                                 int32_t* ps32Y) {
+  SBC_SIMD_FN(Window)(ps16X, &gas32SimdWindowFor4SBs[0][0], 2 * SUB_BANDS_4,
+                      ps32Y);
+}
+
+static SBC_SIMD_TARGET void SBC_SIMD_FN(Window8)(const int16_t* ps16X,
+                                                 int32_t* ps32Y) {
+  SBC_SIMD_FN(Window)(ps16X, &gas32SimdWindowFor8SBs[0][0], 2 * SUB_BANDS_8,
+                      ps32Y);
+}
+
+/* SBC_FastIDCT4 on SBC_SIMD_LANES blocks at a time, one per lane. Returns the
+ * number of blocks processed, the caller handles the remainder. */
+static SBC_SIMD_TARGET int32_t SBC_SIMD_FN(FastIDCT4)(const int32_t* ps32Y,
+                                                      int32_t* ps32SbBuf,
+                                                      int32_t s32NumOfItems) {
+  SBC_SIMD_VEC y[2 * SUB_BANDS_4], o[SUB_BANDS_4];
+  SBC_SIMD_VEC x2, temp, t0, t1, t2, t3, t4, t5, t6, t7;
+  int32_t n;
+
+  for (n = 0; n + SBC_SIMD_LANES <= s32NumOfItems; n += SBC_SIMD_LANES) {
+    SBC_SIMD_FN(LoadBlocks)(&ps32Y[n * 2 * SUB_BANDS_4], 2 * SUB_BANDS_4, y);
+
+    x2 = y[2] >> 1;
+    temp = y[0] + y[4];
+    t0 = SBC_SIMD_FN(MultCos)(SBC_COS_PI_SUR_4 >> 1, temp);
+    t1 = x2 - t0;
+    t0 += x2;
+    temp = y[1] + y[3];
+    t3 = SBC_SIMD_FN(MultCos)(SBC_COS_3PI_SUR_8 >> 1, temp);
+    t2 = SBC_SIMD_FN(MultCos)(SBC_COS_PI_SUR_8 >> 1, temp);
+    temp = y[5] - y[7];
+    t5 = SBC_SIMD_FN(MultCos)(SBC_COS_3PI_SUR_8 >> 1, temp);
+    t4 = SBC_SIMD_FN(MultCos)(SBC_COS_PI_SUR_8 >> 1, temp);
+    t6 = t2 + t5;
+    t7 = t3 - t4;
+
+    o[0] = t0 + t6;
+    o[1] = t1 + t7;
+    o[2] = t1 - t7;
+    o[3] = t0 - t6;
+    SBC_SIMD_FN(StoreBlocks)(o, SUB_BANDS_4, &ps32SbBuf[n * SUB_BANDS_4]);
+  }
+  return n;
+}
+
+/* SBC_FastIDCT8 on SBC_SIMD_LANES blocks at a time, one per lane. Returns the
+ * number of blocks processed, the caller handles the remainder. */
+static SBC_SIMD_TARGET int32_t SBC_SIMD_FN(FastIDCT8)(const int32_t* ps32Y,
+                                                      int32_t* ps32SbBuf,
+                                                      int32_t s32NumOfItems) {
+  SBC_SIMD_VEC y[2 * SUB_BANDS_8], o[SUB_BANDS_8];
+  SBC_SIMD_VEC x0, x1, x2, x3, x4, x5, x6, x7, temp;
+  SBC_SIMD_VEC even0, even1, even2, even3, odd0, odd1, odd2, odd3;
+  int32_t n;
+
+  for (n = 0; n + SBC_SIMD_LANES <= s32NumOfItems; n += SBC_SIMD_LANES) {
+    SBC_SIMD_FN(LoadBlocks)(&ps32Y[n * 2 * SUB_BANDS_8], 2 * SUB_BANDS_8, y);
+
+    x0 = SBC_SIMD_FN(MultCos)(SBC_COS_PI_SUR_4, y[4]);
+    x1 = (y[3] + y[5]) >> 1;
+    x2 = (y[2] + y[6]) >> 1;
+    x3 = (y[1] + y[7]) >> 1;
+    x4 = (y[0] + y[8]) >> 1;
+    x5 = (y[9] - y[15]) >> 1;
+    x6 = (y[10] - y[14]) >> 1;
+    x7 = (y[11] - y[13]) >> 1;
+
+    temp = x0;
+    x0 = SBC_SIMD_FN(MultCos)(SBC_COS_PI_SUR_4, x0 + x4);
+    x4 = SBC_SIMD_FN(MultCos)(SBC_COS_PI_SUR_4, temp - x4);
+
+    x2 -= x6;
+    x6 += x6;
+    x6 = SBC_SIMD_FN(MultCos)(SBC_COS_PI_SUR_4, x6);
+    temp = x2;
+    x2 = SBC_SIMD_FN(MultCos)(SBC_COS_PI_SUR_8, x2 + x6);
+    x6 = SBC_SIMD_FN(MultCos)(SBC_COS_3PI_SUR_8, temp - x6);
+
+    even0 = x0 + x2;
+    even1 = x4 + x6;
+    even2 = x4 - x6;
+    even3 = x0 - x2;
+
+    x7 += x7;
+    x5 = (x5 + x5) - x7;
+    x3 = (x3 + x3) - x5;
+    x1 -= x3 >> 1;
+
+    x5 = SBC_SIMD_FN(MultCos)(SBC_COS_PI_SUR_4, x5);
+    temp = x1;
+    x1 = x1 + x5;
+    x5 = temp - x5;
+
+    x3 -= x7;
+    x7 += x7;
+    x7 = SBC_SIMD_FN(MultCos)(SBC_COS_PI_SUR_4, x7);
+    temp = x3;
+    x3 = SBC_SIMD_FN(MultCos)(SBC_COS_PI_SUR_8, x3 + x7);
+    x7 = SBC_SIMD_FN(MultCos)(SBC_COS_3PI_SUR_8, temp - x7);
+
+    odd0 = SBC_SIMD_FN(MultCos)(SBC_COS_PI_SUR_16, x1 + x3);
+    odd1 = SBC_SIMD_FN(MultCos)(SBC_COS_3PI_SUR_16, x5 + x7);
+    odd2 = SBC_SIMD_FN(MultCos)(SBC_COS_5PI_SUR_16, x5 - x7);
+    odd3 = SBC_SIMD_FN(MultCos)(SBC_COS_7PI_SUR_16, x1 - x3);
+
+    o[0] = even0 + odd0;
+    o[1] = even1 + odd1;
+    o[2] = even2 + odd2;
+    o[3] = even3 + odd3;
+    o[4] = even3 - odd3;
+    o[5] = even2 - odd2;
+    o[6] = even1 - odd1;
+    o[7] = even0 - odd0;
+    SBC_SIMD_FN(StoreBlocks)(o, SUB_BANDS_8, &ps32SbBuf[n * SUB_BANDS_8]);
+  }
+  return n;
+}
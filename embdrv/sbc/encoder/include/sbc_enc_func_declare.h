@@ -40,7 +40,7 @@ extern const int32_t gas32CoeffFor8SBs[];
 extern void sbc_enc_bit_alloc_mono(SBC_ENC_PARAMS* CodecParams);
 extern void sbc_enc_bit_alloc_ste(SBC_ENC_PARAMS* CodecParams);
 
-extern void SbcAnalysisInit(void);
+extern void SbcAnalysisInit(SBC_ENC_PARAMS* strEncParams);
 
 extern void SbcAnalysisFilter4(SBC_ENC_PARAMS* strEncParams, int16_t* input);
 extern void SbcAnalysisFilter8(SBC_ENC_PARAMS* strEncParams, int16_t* input);
@@ -48,6 +48,21 @@ extern void SbcAnalysisFilter8(SBC_ENC_PARAMS* strEncParams, int16_t* input);
 extern void SBC_FastIDCT8(int32_t* pInVect, int32_t* pOutVect);
 extern void SBC_FastIDCT4(int32_t* x0, int32_t* pOutVect);
 
+#if (SBC_SIMD_ANALYSIS == TRUE)
+extern const int32_t gas32SimdWindowFor4SBs[5][2 * SUB_BANDS_4];
+extern const int32_t gas32SimdWindowFor8SBs[5][2 * SUB_BANDS_8];
+
+extern int16_t SbcAnalysisGetSimdLevel(void);
+extern void SbcWindow4Simd(int16_t s16SimdLevel, const int16_t* ps16X,
+                           int32_t* ps32Y);
+extern void SbcWindow8Simd(int16_t s16SimdLevel, const int16_t* ps16X,
+                           int32_t* ps32Y);
+extern void SbcFastIDCT4Simd(int16_t s16SimdLevel, const int32_t* ps32Y,
+                             int32_t* ps32SbBuf, int32_t s32NumOfItems);
+extern void SbcFastIDCT8Simd(int16_t s16SimdLevel, const int32_t* ps32Y,
+                             int32_t* ps32SbBuf, int32_t s32NumOfItems);
+#endif
+
 extern uint32_t EncPacking(SBC_ENC_PARAMS* strEncParams, uint8_t* output);
 extern void EncQuantizer(SBC_ENC_PARAMS*);
 #if (SBC_DSP_OPT == TRUE)
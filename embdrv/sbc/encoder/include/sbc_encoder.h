@@ -138,6 +138,26 @@
 #define SBC_FAST_DCT TRUE
 #endif /*SBC_FAST_DCT */
 
+/* The SIMD analysis kernels reproduce the default fixed point configuration
+ * bit-exactly. Any other configuration always uses the scalar code. They
+ * need the vector extensions of Clang, or of GCC 12 and later. */
+#ifndef SBC_SIMD_ANALYSIS
+#if (SBC_ARM_ASM_OPT == FALSE) && (SBC_IPAQ_OPT == TRUE) &&       \
+    (SBC_IS_64_MULT_IN_WINDOW_ACCU == FALSE) &&                    \
+    (SBC_FAST_DCT == TRUE) && (SBC_IS_64_MULT_IN_IDCT == FALSE) && \
+    (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 12))
+#define SBC_SIMD_ANALYSIS TRUE
+#else
+#define SBC_SIMD_ANALYSIS FALSE
+#endif
+#endif
+
+/* Instruction sets for the analysis filter, see |s16SimdLevel| */
+#define SBC_SIMD_NONE 0
+#define SBC_SIMD_SSE4 1
+#define SBC_SIMD_AVX2 2
+#define SBC_SIMD_NEON 3
+
 /* In case we do not use joint stereo mode the flag save some RAM and ROM in
  * case it is set to FALSE */
 #ifndef SBC_JOINT_STE_INCLUDED
@@ -185,6 +205,18 @@ typedef struct SBC_ENC_PARAMS_TAG {
 
   uint16_t FrameHeader;
 
+  /* Analysis filter state. Everything the encoder keeps between frames lives
+   * here, so independent instances can encode concurrently. */
+  int32_t s32X[ENC_VX_BUFFER_SIZE / 2]; /* sample history, used as int16_t;
+                                           32 bits aligned cf SHIFTUP_X8_2 */
+  int16_t s16ShiftCounter;
+  int16_t s16MaxShiftCounter;
+
+  /* Instruction set used by the analysis filter. Set to the best one the CPU
+   * supports by SBC_Encoder_Init(); may be lowered afterwards, for example to
+   * SBC_SIMD_NONE to force the reference scalar code. */
+  int16_t s16SimdLevel;
+
 } SBC_ENC_PARAMS;
 
 #ifdef __cplusplus
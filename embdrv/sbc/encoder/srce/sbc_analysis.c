@@ -197,15 +197,56 @@
 #define WIND_8_SUBBANDS_8_2 (int16_t)0x12CF /* 40 = 0x12CF6C75 */
 #endif
 
-#if (SBC_USE_ARM_PRAGMA == TRUE)
-#pragma arm section zidata = "sbc_s32_analysis_section"
-#endif
-static int32_t s32DCTY[16] = {0};
-static int32_t s32X[ENC_VX_BUFFER_SIZE / 2];
-static int16_t* s16X =
-    (int16_t*)s32X; /* s16X must be 32 bits aligned cf  SHIFTUP_X8_2*/
-#if (SBC_USE_ARM_PRAGMA == TRUE)
-#pragma arm section zidata
+#if (SBC_SIMD_ANALYSIS == TRUE)
+/* Window coefficients for the SIMD kernels: row r holds the coefficient
+ * applied to s16X[ChOffset + r * 2 * SubBands + j] for output j, so that
+ * DCTY[j] is the sum over the 5 rows of row[j] * X[j]. */
+const int32_t gas32SimdWindowFor4SBs[5][2 * SUB_BANDS_4] = {
+    {0, WIND_4_SUBBANDS_1_0, WIND_4_SUBBANDS_2_0, WIND_4_SUBBANDS_3_0,
+     WIND_4_SUBBANDS_4_0, WIND_4_SUBBANDS_3_4, WIND_4_SUBBANDS_2_4,
+     WIND_4_SUBBANDS_1_4},
+    {WIND_4_SUBBANDS_0_1, WIND_4_SUBBANDS_1_1, WIND_4_SUBBANDS_2_1,
+     WIND_4_SUBBANDS_3_1, WIND_4_SUBBANDS_4_1, WIND_4_SUBBANDS_3_3,
+     WIND_4_SUBBANDS_2_3, WIND_4_SUBBANDS_1_3},
+    {WIND_4_SUBBANDS_0_2, WIND_4_SUBBANDS_1_2, WIND_4_SUBBANDS_2_2,
+     WIND_4_SUBBANDS_3_2, WIND_4_SUBBANDS_4_2, WIND_4_SUBBANDS_3_2,
+     WIND_4_SUBBANDS_2_2, WIND_4_SUBBANDS_1_2},
+    {-WIND_4_SUBBANDS_0_2, WIND_4_SUBBANDS_1_3, WIND_4_SUBBANDS_2_3,
+     WIND_4_SUBBANDS_3_3, WIND_4_SUBBANDS_4_1, WIND_4_SUBBANDS_3_1,
+     WIND_4_SUBBANDS_2_1, WIND_4_SUBBANDS_1_1},
+    {-WIND_4_SUBBANDS_0_1, WIND_4_SUBBANDS_1_4, WIND_4_SUBBANDS_2_4,
+     WIND_4_SUBBANDS_3_4, WIND_4_SUBBANDS_4_0, WIND_4_SUBBANDS_3_0,
+     WIND_4_SUBBANDS_2_0, WIND_4_SUBBANDS_1_0}};
+const int32_t gas32SimdWindowFor8SBs[5][2 * SUB_BANDS_8] = {
+    {0, WIND_8_SUBBANDS_1_0, WIND_8_SUBBANDS_2_0, WIND_8_SUBBANDS_3_0,
+     WIND_8_SUBBANDS_4_0, WIND_8_SUBBANDS_5_0, WIND_8_SUBBANDS_6_0,
+     WIND_8_SUBBANDS_7_0, WIND_8_SUBBANDS_8_0, WIND_8_SUBBANDS_7_4,
+     WIND_8_SUBBANDS_6_4, WIND_8_SUBBANDS_5_4, WIND_8_SUBBANDS_4_4,
+     WIND_8_SUBBANDS_3_4, WIND_8_SUBBANDS_2_4, WIND_8_SUBBANDS_1_4},
+    {WIND_8_SUBBANDS_0_1, WIND_8_SUBBANDS_1_1, WIND_8_SUBBANDS_2_1,
+     WIND_8_SUBBANDS_3_1, WIND_8_SUBBANDS_4_1, WIND_8_SUBBANDS_5_1,
+     WIND_8_SUBBANDS_6_1, WIND_8_SUBBANDS_7_1, WIND_8_SUBBANDS_8_1,
+     WIND_8_SUBBANDS_7_3, WIND_8_SUBBANDS_6_3, WIND_8_SUBBANDS_5_3,
+     WIND_8_SUBBANDS_4_3, WIND_8_SUBBANDS_3_3, WIND_8_SUBBANDS_2_3,
+     WIND_8_SUBBANDS_1_3},
+    {WIND_8_SUBBANDS_0_2, WIND_8_SUBBANDS_1_2, WIND_8_SUBBANDS_2_2,
+     WIND_8_SUBBANDS_3_2, WIND_8_SUBBANDS_4_2, WIND_8_SUBBANDS_5_2,
+     WIND_8_SUBBANDS_6_2, WIND_8_SUBBANDS_7_2, WIND_8_SUBBANDS_8_2,
+     WIND_8_SUBBANDS_7_2, WIND_8_SUBBANDS_6_2, WIND_8_SUBBANDS_5_2,
+     WIND_8_SUBBANDS_4_2, WIND_8_SUBBANDS_3_2, WIND_8_SUBBANDS_2_2,
+     WIND_8_SUBBANDS_1_2},
+    {-WIND_8_SUBBANDS_0_2, WIND_8_SUBBANDS_1_3, WIND_8_SUBBANDS_2_3,
+     WIND_8_SUBBANDS_3_3, WIND_8_SUBBANDS_4_3, WIND_8_SUBBANDS_5_3,
+     WIND_8_SUBBANDS_6_3, WIND_8_SUBBANDS_7_3, WIND_8_SUBBANDS_8_1,
+     WIND_8_SUBBANDS_7_1, WIND_8_SUBBANDS_6_1, WIND_8_SUBBANDS_5_1,
+     WIND_8_SUBBANDS_4_1, WIND_8_SUBBANDS_3_1, WIND_8_SUBBANDS_2_1,
+     WIND_8_SUBBANDS_1_1},
+    {-WIND_8_SUBBANDS_0_1, WIND_8_SUBBANDS_1_4, WIND_8_SUBBANDS_2_4,
+     WIND_8_SUBBANDS_3_4, WIND_8_SUBBANDS_4_4, WIND_8_SUBBANDS_5_4,
+     WIND_8_SUBBANDS_6_4, WIND_8_SUBBANDS_7_4, WIND_8_SUBBANDS_8_0,
+     WIND_8_SUBBANDS_7_0, WIND_8_SUBBANDS_6_0, WIND_8_SUBBANDS_5_0,
+     WIND_8_SUBBANDS_4_0, WIND_8_SUBBANDS_3_0, WIND_8_SUBBANDS_2_0,
+     WIND_8_SUBBANDS_1_0}};
 #endif
 
 /* This macro is for 4 subbands */
@@ -1185,8 +1226,6 @@ static int16_t* s16X =
 #endif
 #endif
 
-static int16_t ShiftCounter = 0;
-extern int16_t EncMaxShiftCounter;
 /****************************************************************************
 * SbcAnalysisFilter - performs Analysis of the input audio stream
 *
@@ -1217,6 +1256,17 @@ void SbcAnalysisFilter4(SBC_ENC_PARAMS* pstrEncParams, int16_t* input) {
 #endif
 #endif
 
+  int32_t s32DCTY[2 * SUB_BANDS_4];
+  int16_t* s16X = (int16_t*)pstrEncParams->s32X;
+  int16_t ShiftCounter = pstrEncParams->s16ShiftCounter;
+  int16_t EncMaxShiftCounter = pstrEncParams->s16MaxShiftCounter;
+#if (SBC_SIMD_ANALYSIS == TRUE)
+  int32_t as32Y[SBC_MAX_NUM_OF_BLOCKS * SBC_MAX_NUM_OF_CHANNELS * 2 *
+                SUB_BANDS_4];
+  int32_t* ps32Y = as32Y;
+  int16_t s16SimdLevel = pstrEncParams->s16SimdLevel;
+#endif
+
   s32NumOfChannels = pstrEncParams->s16NumOfChannels;
   s32NumOfBlocks = pstrEncParams->s16NumOfBlocks;
 
@@ -1257,6 +1307,15 @@ void SbcAnalysisFilter4(SBC_ENC_PARAMS* pstrEncParams, int16_t* input) {
     for (s32Ch = 0; s32Ch < s32NumOfChannels; s32Ch++) {
       ChOffset = s32Ch * Offset2 + Offset;
 
+#if (SBC_SIMD_ANALYSIS == TRUE)
+      if (s16SimdLevel != SBC_SIMD_NONE) {
+        /* The DCT runs on all blocks at once after the loop */
+        SbcWindow4Simd(s16SimdLevel, &s16X[ChOffset], ps32Y);
+        ps32Y += 2 * SUB_BANDS_4;
+        continue;
+      }
+#endif
+
       WINDOW_PARTIAL_4
 
       SBC_FastIDCT4(s32DCTY, ps32SbBuf);
@@ -1279,6 +1338,13 @@ void SbcAnalysisFilter4(SBC_ENC_PARAMS* pstrEncParams, int16_t* input) {
       }
     }
   }
+#if (SBC_SIMD_ANALYSIS == TRUE)
+  if (s16SimdLevel != SBC_SIMD_NONE) {
+    SbcFastIDCT4Simd(s16SimdLevel, as32Y, pstrEncParams->s32SbBuffer,
+                     s32NumOfBlocks * s32NumOfChannels);
+  }
+#endif
+  pstrEncParams->s16ShiftCounter = ShiftCounter;
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
@@ -1306,6 +1372,17 @@ void SbcAnalysisFilter8(SBC_ENC_PARAMS* pstrEncParams, int16_t* input) {
 #endif
 #endif
 
+  int32_t s32DCTY[2 * SUB_BANDS_8];
+  int16_t* s16X = (int16_t*)pstrEncParams->s32X;
+  int16_t ShiftCounter = pstrEncParams->s16ShiftCounter;
+  int16_t EncMaxShiftCounter = pstrEncParams->s16MaxShiftCounter;
+#if (SBC_SIMD_ANALYSIS == TRUE)
+  int32_t as32Y[SBC_MAX_NUM_OF_BLOCKS * SBC_MAX_NUM_OF_CHANNELS * 2 *
+                SUB_BANDS_8];
+  int32_t* ps32Y = as32Y;
+  int16_t s16SimdLevel = pstrEncParams->s16SimdLevel;
+#endif
+
   s32NumOfChannels = pstrEncParams->s16NumOfChannels;
   s32NumOfBlocks = pstrEncParams->s16NumOfBlocks;
 
@@ -1370,6 +1447,15 @@ void SbcAnalysisFilter8(SBC_ENC_PARAMS* pstrEncParams, int16_t* input) {
     for (s32Ch = 0; s32Ch < s32NumOfChannels; s32Ch++) {
       ChOffset = s32Ch * Offset2 + Offset;
 
+#if (SBC_SIMD_ANALYSIS == TRUE)
+      if (s16SimdLevel != SBC_SIMD_NONE) {
+        /* The DCT runs on all blocks at once after the loop */
+        SbcWindow8Simd(s16SimdLevel, &s16X[ChOffset], ps32Y);
+        ps32Y += 2 * SUB_BANDS_8;
+        continue;
+      }
+#endif
+
       WINDOW_PARTIAL_8
 
       SBC_FastIDCT8(s32DCTY, ps32SbBuf);
@@ -1392,9 +1478,21 @@ void SbcAnalysisFilter8(SBC_ENC_PARAMS* pstrEncParams, int16_t* input) {
       }
     }
   }
+#if (SBC_SIMD_ANALYSIS == TRUE)
+  if (s16SimdLevel != SBC_SIMD_NONE) {
+    SbcFastIDCT8Simd(s16SimdLevel, as32Y, pstrEncParams->s32SbBuffer,
+                     s32NumOfBlocks * s32NumOfChannels);
+  }
+#endif
+  pstrEncParams->s16ShiftCounter = ShiftCounter;
 }
 
-void SbcAnalysisInit(void) {
-  memset(s16X, 0, ENC_VX_BUFFER_SIZE * sizeof(int16_t));
-  ShiftCounter = 0;
+void SbcAnalysisInit(SBC_ENC_PARAMS* pstrEncParams) {
+  memset(pstrEncParams->s32X, 0, sizeof(pstrEncParams->s32X));
+  pstrEncParams->s16ShiftCounter = 0;
+#if (SBC_SIMD_ANALYSIS == TRUE)
+  pstrEncParams->s16SimdLevel = SbcAnalysisGetSimdLevel();
+#else
+  pstrEncParams->s16SimdLevel = SBC_SIMD_NONE;
+#endif
 }
@@ -0,0 +1,226 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file selects the SIMD windowing and DCT kernels of the analysis
+ *  filter for the instruction set in SBC_ENC_PARAMS::s16SimdLevel.
+ *
+ *  The windowing handles one block of one channel at a time. The DCT runs
+ *  once per frame on all blocks and channels: it transposes a group of
+ *  blocks in registers, one block per lane, so the butterflies of
+ *  SBC_FastIDCT8/4 map directly onto vector operations.
+ *
+ ******************************************************************************/
+#include <string.h>
+#include "sbc_dct.h"
+#include "sbc_enc_func_declare.h"
+#include "sbc_encoder.h"
+
+#if (SBC_SIMD_ANALYSIS == TRUE)
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SBC_SIMD_X86 TRUE
+#else
+#define SBC_SIMD_X86 FALSE
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SBC_SIMD_ARM_NEON TRUE
+#else
+#define SBC_SIMD_ARM_NEON FALSE
+#endif
+
+typedef int32_t sbc_v4si __attribute__((vector_size(16)));
+typedef int16_t sbc_v4hi __attribute__((vector_size(8)));
+typedef int32_t sbc_v8si __attribute__((vector_size(32)));
+typedef int16_t sbc_v8hi __attribute__((vector_size(16)));
+
+#if (SBC_SIMD_X86 == TRUE)
+#define SBC_SIMD_FN(name) Sbc##name##Sse4
+#define SBC_SIMD_TARGET __attribute__((target("sse4.1")))
+#define SBC_SIMD_LANES 4
+#define SBC_SIMD_VEC sbc_v4si
+#define SBC_SIMD_VEC16 sbc_v4hi
+#include "sbc_analysis_simd_kernels.h"
+#undef SBC_SIMD_FN
+#undef SBC_SIMD_TARGET
+#undef SBC_SIMD_LANES
+#undef SBC_SIMD_VEC
+#undef SBC_SIMD_VEC16
+
+#define SBC_SIMD_FN(name) Sbc##name##Avx2
+#define SBC_SIMD_TARGET __attribute__((target("avx2")))
+#define SBC_SIMD_LANES 8
+#define SBC_SIMD_VEC sbc_v8si
+#define SBC_SIMD_VEC16 sbc_v8hi
+#include "sbc_analysis_simd_kernels.h"
+#undef SBC_SIMD_FN
+#undef SBC_SIMD_TARGET
+#undef SBC_SIMD_LANES
+#undef SBC_SIMD_VEC
+#undef SBC_SIMD_VEC16
+#endif
+
+#if (SBC_SIMD_ARM_NEON == TRUE)
+#define SBC_SIMD_FN(name) Sbc##name##Neon
+#define SBC_SIMD_TARGET
+#define SBC_SIMD_LANES 4
+#define SBC_SIMD_VEC sbc_v4si
+#define SBC_SIMD_VEC16 sbc_v4hi
+#include "sbc_analysis_simd_kernels.h"
+#undef SBC_SIMD_FN
+#undef SBC_SIMD_TARGET
+#undef SBC_SIMD_LANES
+#undef SBC_SIMD_VEC
+#undef SBC_SIMD_VEC16
+#endif
+
+/* Portable version of the windowing, used for a level not built in */
+static void SbcWindowGeneric(const int16_t* ps16X, const int32_t* ps32Window,
+                             int32_t s32Width, int32_t* ps32Y) {
+  int32_t j, r, s32Acc;
+  for (j = 0; j < s32Width; j++) {
+    s32Acc = 0;
+    for (r = 0; r < 5; r++) {
+      s32Acc += ps32Window[r * s32Width + j] * ps16X[r * s32Width + j];
+    }
+    ps32Y[j] = s32Acc;
+  }
+}
+
+int16_t SbcAnalysisGetSimdLevel(void) {
+#if (SBC_SIMD_X86 == TRUE)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) return SBC_SIMD_AVX2;
+  if (__builtin_cpu_supports("sse4.1")) return SBC_SIMD_SSE4;
+  return SBC_SIMD_NONE;
+#elif (SBC_SIMD_ARM_NEON == TRUE)
+  return SBC_SIMD_NEON;
+#else
+  return SBC_SIMD_NONE;
+#endif
+}
+
+void SbcWindow4Simd(int16_t s16SimdLevel, const int16_t* ps16X,
+                    int32_t* ps32Y) {
+  switch (s16SimdLevel) {
+#if (SBC_SIMD_X86 == TRUE)
+    case SBC_SIMD_AVX2:
+      SbcWindow4Avx2(ps16X, ps32Y);
+      return;
+    case SBC_SIMD_SSE4:
+      SbcWindow4Sse4(ps16X, ps32Y);
+      return;
+#endif
+#if (SBC_SIMD_ARM_NEON == TRUE)
+    case SBC_SIMD_NEON:
+      SbcWindow4Neon(ps16X, ps32Y);
+      return;
+#endif
+    default:
+      SbcWindowGeneric(ps16X, &gas32SimdWindowFor4SBs[0][0], 2 * SUB_BANDS_4,
+                       ps32Y);
+      return;
+  }
+}
+
+void SbcWindow8Simd(int16_t s16SimdLevel, const int16_t* ps16X,
+                    int32_t* ps32Y) {
+  switch (s16SimdLevel) {
+#if (SBC_SIMD_X86 == TRUE)
+    case SBC_SIMD_AVX2:
+      SbcWindow8Avx2(ps16X, ps32Y);
+      return;
+    case SBC_SIMD_SSE4:
+      SbcWindow8Sse4(ps16X, ps32Y);
+      return;
+#endif
+#if (SBC_SIMD_ARM_NEON == TRUE)
+    case SBC_SIMD_NEON:
+      SbcWindow8Neon(ps16X, ps32Y);
+      return;
+#endif
+    default:
+      SbcWindowGeneric(ps16X, &gas32SimdWindowFor8SBs[0][0], 2 * SUB_BANDS_8,
+                       ps32Y);
+      return;
+  }
+}
+
+void SbcFastIDCT4Simd(int16_t s16SimdLevel, const int32_t* ps32Y,
+                      int32_t* ps32SbBuf, int32_t s32NumOfItems) {
+  int32_t n = 0;
+
+  switch (s16SimdLevel) {
+#if (SBC_SIMD_X86 == TRUE)
+    case SBC_SIMD_AVX2:
+      /* Blocks left over from the 8 lanes go through the 4 lane kernel */
+      n = SbcFastIDCT4Avx2(ps32Y, ps32SbBuf, s32NumOfItems);
+      n += SbcFastIDCT4Sse4(&ps32Y[n * 2 * SUB_BANDS_4],
+                            &ps32SbBuf[n * SUB_BANDS_4], s32NumOfItems - n);
+      break;
+    case SBC_SIMD_SSE4:
+      n = SbcFastIDCT4Sse4(ps32Y, ps32SbBuf, s32NumOfItems);
+      break;
+#endif
+#if (SBC_SIMD_ARM_NEON == TRUE)
+    case SBC_SIMD_NEON:
+      n = SbcFastIDCT4Neon(ps32Y, ps32SbBuf, s32NumOfItems);
+      break;
+#endif
+    default:
+      break;
+  }
+  for (; n < s32NumOfItems; n++) {
+    SBC_FastIDCT4((int32_t*)&ps32Y[n * 2 * SUB_BANDS_4],
+                  &ps32SbBuf[n * SUB_BANDS_4]);
+  }
+}
+
+void SbcFastIDCT8Simd(int16_t s16SimdLevel, const int32_t* ps32Y,
+                      int32_t* ps32SbBuf, int32_t s32NumOfItems) {
+  int32_t n = 0;
+
+  switch (s16SimdLevel) {
+#if (SBC_SIMD_X86 == TRUE)
+    case SBC_SIMD_AVX2:
+      /* Blocks left over from the 8 lanes go through the 4 lane kernel */
+      n = SbcFastIDCT8Avx2(ps32Y, ps32SbBuf, s32NumOfItems);
+      n += SbcFastIDCT8Sse4(&ps32Y[n * 2 * SUB_BANDS_8],
+                            &ps32SbBuf[n * SUB_BANDS_8], s32NumOfItems - n);
+      break;
+    case SBC_SIMD_SSE4:
+      n = SbcFastIDCT8Sse4(ps32Y, ps32SbBuf, s32NumOfItems);
+      break;
+#endif
+#if (SBC_SIMD_ARM_NEON == TRUE)
+    case SBC_SIMD_NEON:
+      n = SbcFastIDCT8Neon(ps32Y, ps32SbBuf, s32NumOfItems);
+      break;
+#endif
+    default:
+      break;
+  }
+  for (; n < s32NumOfItems; n++) {
+    SBC_FastIDCT8((int32_t*)&ps32Y[n * 2 * SUB_BANDS_8],
+                  &ps32SbBuf[n * SUB_BANDS_8]);
+  }
+}
+
+#endif /* SBC_SIMD_ANALYSIS == TRUE */
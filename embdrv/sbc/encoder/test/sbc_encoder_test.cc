@@ -0,0 +1,177 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "sbc_encoder.h"
+
+namespace {
+
+constexpr int kNumFrames = 200;
+constexpr int kMaxFrameSamples =
+    SBC_MAX_NUM_OF_BLOCKS * SBC_MAX_NUM_OF_SUBBANDS * SBC_MAX_NUM_OF_CHANNELS;
+constexpr int kMaxFrameBytes = 1024;
+
+struct Config {
+  int16_t subbands;
+  int16_t blocks;
+  int16_t channel_mode;
+};
+
+std::vector<Config> AllConfigs() {
+  std::vector<Config> configs;
+  for (int16_t subbands : {SUB_BANDS_4, SUB_BANDS_8}) {
+    for (int16_t blocks : {4, 8, 12, 16}) {
+      for (int16_t mode :
+           {SBC_MONO, SBC_DUAL, SBC_STEREO, SBC_JOINT_STEREO}) {
+        configs.push_back({subbands, blocks, mode});
+      }
+    }
+  }
+  return configs;
+}
+
+void InitEncoder(SBC_ENC_PARAMS* params, const Config& config) {
+  memset(params, 0, sizeof(*params));
+  params->s16SamplingFreq = SBC_sf44100;
+  params->s16ChannelMode = config.channel_mode;
+  params->s16NumOfSubBands = config.subbands;
+  params->s16NumOfBlocks = config.blocks;
+  params->s16AllocationMethod = SBC_LOUDNESS;
+  params->u16BitRate = 328;
+  SBC_Encoder_Init(params);
+}
+
+// A tone with noise on top, full scale square waves every now and then to
+// exercise the extremes of the fixed point arithmetic.
+class SignalGenerator {
+ public:
+  explicit SignalGenerator(double frequency) : frequency_(frequency) {}
+
+  void Fill(int16_t* pcm, int num_samples) {
+    for (int i = 0; i < num_samples; i++, sample_++) {
+      seed_ = seed_ * 1103515245 + 12345;
+      int noise = static_cast<int16_t>(seed_ >> 16) >> 3;
+      int value = static_cast<int>(20000 * sin(sample_ * frequency_)) + noise;
+      if ((sample_ / 1024) % 16 == 3) value = (i & 1) ? 32767 : -32768;
+      if (value > 32767) value = 32767;
+      if (value < -32768) value = -32768;
+      pcm[i] = static_cast<int16_t>(value);
+    }
+  }
+
+ private:
+  double frequency_;
+  uint32_t seed_ = 1;
+  int sample_ = 0;
+};
+
+int FrameSamples(const SBC_ENC_PARAMS& params) {
+  return params.s16NumOfBlocks * params.s16NumOfSubBands *
+         params.s16NumOfChannels;
+}
+
+std::vector<uint8_t> EncodeAll(const Config& config, int16_t simd_level,
+                               double frequency) {
+  SBC_ENC_PARAMS params;
+  InitEncoder(&params, config);
+  params.s16SimdLevel = simd_level;
+  SignalGenerator signal(frequency);
+  std::vector<uint8_t> encoded;
+  int16_t pcm[kMaxFrameSamples];
+  uint8_t frame[kMaxFrameBytes];
+  for (int i = 0; i < kNumFrames; i++) {
+    signal.Fill(pcm, FrameSamples(params));
+    uint32_t len = SBC_Encode(&params, pcm, frame);
+    encoded.insert(encoded.end(), frame, frame + len);
+  }
+  return encoded;
+}
+
+int16_t BestSimdLevel() {
+  SBC_ENC_PARAMS params;
+  InitEncoder(&params, {SUB_BANDS_8, 16, SBC_JOINT_STEREO});
+  return params.s16SimdLevel;
+}
+
+}  // namespace
+
+TEST(SbcEncoderTest, simd_matches_scalar) {
+  std::vector<int16_t> levels = {BestSimdLevel()};
+  if (levels[0] == SBC_SIMD_AVX2) levels.push_back(SBC_SIMD_SSE4);
+
+  for (const Config& config : AllConfigs()) {
+    std::vector<uint8_t> scalar = EncodeAll(config, SBC_SIMD_NONE, 0.01);
+    for (int16_t level : levels) {
+      EXPECT_EQ(scalar, EncodeAll(config, level, 0.01))
+          << "level " << level << " subbands " << config.subbands
+          << " blocks " << config.blocks << " mode " << config.channel_mode;
+    }
+  }
+}
+
+TEST(SbcEncoderTest, simd_matches_scalar_subband_samples) {
+  int16_t level = BestSimdLevel();
+  for (const Config& config : AllConfigs()) {
+    SBC_ENC_PARAMS scalar, simd;
+    InitEncoder(&scalar, config);
+    InitEncoder(&simd, config);
+    scalar.s16SimdLevel = SBC_SIMD_NONE;
+    simd.s16SimdLevel = level;
+    SignalGenerator signal(0.03);
+    int16_t pcm[kMaxFrameSamples];
+    uint8_t frame[kMaxFrameBytes];
+    int num_samples = FrameSamples(scalar);
+    for (int i = 0; i < kNumFrames; i++) {
+      signal.Fill(pcm, num_samples);
+      SBC_Encode(&scalar, pcm, frame);
+      SBC_Encode(&simd, pcm, frame);
+      ASSERT_EQ(0, memcmp(scalar.s32SbBuffer, simd.s32SbBuffer,
+                          num_samples * sizeof(int32_t)))
+          << "frame " << i << " subbands " << config.subbands << " blocks "
+          << config.blocks;
+    }
+  }
+}
+
+TEST(SbcEncoderTest, interleaved_instances_are_independent) {
+  Config config = {SUB_BANDS_8, 16, SBC_JOINT_STEREO};
+  std::vector<uint8_t> expected_a = EncodeAll(config, BestSimdLevel(), 0.01);
+  std::vector<uint8_t> expected_b = EncodeAll(config, BestSimdLevel(), 0.05);
+
+  SBC_ENC_PARAMS params_a, params_b;
+  InitEncoder(&params_a, config);
+  InitEncoder(&params_b, config);
+  SignalGenerator signal_a(0.01), signal_b(0.05);
+  std::vector<uint8_t> encoded_a, encoded_b;
+  int16_t pcm[kMaxFrameSamples];
+  uint8_t frame[kMaxFrameBytes];
+  for (int i = 0; i < kNumFrames; i++) {
+    signal_a.Fill(pcm, FrameSamples(params_a));
+    uint32_t len = SBC_Encode(&params_a, pcm, frame);
+    encoded_a.insert(encoded_a.end(), frame, frame + len);
+
+    signal_b.Fill(pcm, FrameSamples(params_b));
+    len = SBC_Encode(&params_b, pcm, frame);
+    encoded_b.insert(encoded_b.end(), frame, frame + len);
+  }
+  EXPECT_EQ(expected_a, encoded_a);
+  EXPECT_EQ(expected_b, encoded_b);
+}
@@ -16,10 +16,11 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <functional>
 #include <memory>
-#include <mutex>
-#include <queue>
 
 #include "os/thread.h"
 #include "os/utils.h"
@@ -46,13 +47,46 @@ class Handler {
   // Remove all pending events from the queue of this handler
   void Clear();
 
+  struct Stats {
+    // Number of closures posted but not yet run or discarded
+    size_t queue_depth;
+    size_t max_queue_depth;
+    uint64_t wakeups;
+    uint64_t tasks_executed;
+    size_t max_tasks_per_wakeup;
+    // Longest time a closure waited between Post() and the start of its execution
+    std::chrono::microseconds max_latency;
+  };
+
+  // Snapshot of the counters of this handler. May be called from any thread.
+  Stats GetStats() const;
+
  private:
-  std::queue<Closure> tasks_;
+  struct Task;
+
+  // Closures are kept in an intrusive multi-producer single-consumer queue: Post() only exchanges the head pointer,
+  // and the reactor thread pops from the tail and drains every pending closure on a single wakeup.
+  std::atomic<Task*> head_;
+  Task* tail_;
+  Task* stub_;
+  // Incremented by Clear(). Tasks posted under an older generation are discarded instead of run.
+  std::atomic<uint64_t> generation_;
+  // True while a wakeup has been signalled on |fd_| and not yet consumed by the reactor thread.
+  std::atomic<bool> wakeup_pending_;
+
+  std::atomic<size_t> queue_depth_;
+  std::atomic<size_t> max_queue_depth_;
+  std::atomic<uint64_t> wakeups_;
+  std::atomic<uint64_t> tasks_executed_;
+  std::atomic<size_t> max_tasks_per_wakeup_;
+  std::atomic<int64_t> max_latency_us_;
+
   Thread* thread_;
   int fd_;
   Reactor::Reactable* reactable_;
-  mutable std::mutex mutex_;
-  void handle_next_event();
+  void push(Task* task);
+  Task* pop();
+  void handle_events();
 };
 
 }  // namespace os
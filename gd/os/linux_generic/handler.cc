@@ -24,19 +24,46 @@
 #include "os/reactor.h"
 #include "os/utils.h"
 
-#ifndef EFD_SEMAPHORE
-#define EFD_SEMAPHORE 1
-#endif
-
 namespace bluetooth {
 namespace os {
 
+struct Handler::Task {
+  std::atomic<Task*> next{nullptr};
+  Closure closure;
+  uint64_t generation = 0;
+  std::chrono::steady_clock::time_point post_time;
+};
+
+namespace {
+
+template <typename T>
+void store_max(std::atomic<T>* max, T value) {
+  T current = max->load(std::memory_order_relaxed);
+  while (current < value && !max->compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+  }
+}
+
+}  // namespace
+
 Handler::Handler(Thread* thread)
-  : thread_(thread),
-    fd_(eventfd(0, EFD_SEMAPHORE | EFD_NONBLOCK)) {
+  : head_(nullptr),
+    tail_(nullptr),
+    stub_(new Task),
+    generation_(0),
+    wakeup_pending_(false),
+    queue_depth_(0),
+    max_queue_depth_(0),
+    wakeups_(0),
+    tasks_executed_(0),
+    max_tasks_per_wakeup_(0),
+    max_latency_us_(0),
+    thread_(thread),
+    fd_(eventfd(0, EFD_NONBLOCK)) {
   ASSERT(fd_ != -1);
+  head_ = stub_;
+  tail_ = stub_;
 
-  reactable_ = thread_->GetReactor()->Register(fd_, [this] { this->handle_next_event(); }, nullptr);
+  reactable_ = thread_->GetReactor()->Register(fd_, [this] { this->handle_events(); }, nullptr);
 }
 
 Handler::~Handler() {
@@ -46,47 +73,120 @@ Handler::~Handler() {
   int close_status;
   RUN_NO_INTR(close_status = close(fd_));
   ASSERT(close_status != -1);
+
+  // Unhandled events are discarded. No other thread may Post() at this point.
+  for (Task* task = pop(); task != nullptr; task = pop()) {
+    delete task;
+  }
+  delete stub_;
 }
 
 void Handler::Post(Closure closure) {
-  {
-    std::lock_guard<std::mutex> lock(mutex_);
-    tasks_.emplace(std::move(closure));
+  Task* task = new Task;
+  task->closure = std::move(closure);
+  task->generation = generation_.load(std::memory_order_acquire);
+  task->post_time = std::chrono::steady_clock::now();
+
+  store_max(&max_queue_depth_, queue_depth_.fetch_add(1, std::memory_order_relaxed) + 1);
+  push(task);
+
+  // Only the first Post() after the reactor thread consumed the previous wakeup needs to signal the eventfd.
+  if (!wakeup_pending_.exchange(true, std::memory_order_acq_rel)) {
+    auto write_result = eventfd_write(fd_, 1);
+    ASSERT(write_result != -1);
   }
-  uint64_t val = 1;
-  auto write_result = eventfd_write(fd_, val);
-  ASSERT(write_result != -1);
 }
 
 void Handler::Clear() {
-  std::lock_guard<std::mutex> lock(mutex_);
+  // Pending tasks are dropped by the reactor thread when it reaches them.
+  generation_.fetch_add(1, std::memory_order_acq_rel);
+}
 
-  std::queue<Closure> empty;
-  std::swap(tasks_, empty);
+Handler::Stats Handler::GetStats() const {
+  Stats stats;
+  stats.queue_depth = queue_depth_.load(std::memory_order_relaxed);
+  stats.max_queue_depth = max_queue_depth_.load(std::memory_order_relaxed);
+  stats.wakeups = wakeups_.load(std::memory_order_relaxed);
+  stats.tasks_executed = tasks_executed_.load(std::memory_order_relaxed);
+  stats.max_tasks_per_wakeup = max_tasks_per_wakeup_.load(std::memory_order_relaxed);
+  stats.max_latency = std::chrono::microseconds(max_latency_us_.load(std::memory_order_relaxed));
+  return stats;
+}
+
+void Handler::push(Task* task) {
+  task->next.store(nullptr, std::memory_order_relaxed);
+  Task* prev = head_.exchange(task, std::memory_order_acq_rel);
+  prev->next.store(task, std::memory_order_release);
+}
 
-  uint64_t val;
-  while (eventfd_read(fd_, &val) == 0) {
+// Returns nullptr if the queue is empty, or if a producer is in the middle of push(). In the latter case that producer
+// signals the eventfd afterwards, so the task is picked up on the next wakeup.
+Handler::Task* Handler::pop() {
+  Task* tail = tail_;
+  Task* next = tail->next.load(std::memory_order_acquire);
+  if (tail == stub_) {
+    if (next == nullptr) {
+      return nullptr;
+    }
+    tail_ = next;
+    tail = next;
+    next = next->next.load(std::memory_order_acquire);
+  }
+  if (next != nullptr) {
+    tail_ = next;
+    return tail;
+  }
+  if (tail != head_.load(std::memory_order_acquire)) {
+    return nullptr;
   }
+  push(stub_);
+  next = tail->next.load(std::memory_order_acquire);
+  if (next != nullptr) {
+    tail_ = next;
+    return tail;
+  }
+  return nullptr;
 }
 
-void Handler::handle_next_event() {
-  Closure closure;
+void Handler::handle_events() {
   uint64_t val = 0;
   auto read_result = eventfd_read(fd_, &val);
   if (read_result == -1 && errno == EAGAIN) {
-    // We were told there was an item, but it was removed before we got there
-    // (aka the queue was cleared). Not a fatal error, so just bail.
+    // A wakeup that raced with a previous drain; nothing was signalled since.
     return;
   }
-
   ASSERT(read_result != -1);
 
-  {
-    std::lock_guard<std::mutex> lock(mutex_);
-    closure = std::move(tasks_.front());
-    tasks_.pop();
+  // Consume the wakeup before draining, so that any Post() that we miss below signals the eventfd again.
+  wakeup_pending_.exchange(false, std::memory_order_acq_rel);
+  wakeups_.fetch_add(1, std::memory_order_relaxed);
+
+  // Only run what was pending at wakeup, so a handler being posted to continuously cannot starve the other
+  // reactables on this thread.
+  size_t budget = queue_depth_.load(std::memory_order_relaxed);
+  size_t executed = 0;
+  while (budget-- > 0) {
+    Task* task = pop();
+    if (task == nullptr) {
+      break;
+    }
+    queue_depth_.fetch_sub(1, std::memory_order_relaxed);
+    if (task->generation == generation_.load(std::memory_order_acquire)) {
+      auto latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() -
+                                                                           task->post_time);
+      store_max(&max_latency_us_, static_cast<int64_t>(latency.count()));
+      task->closure();
+      executed++;
+    }
+    delete task;
+  }
+  tasks_executed_.fetch_add(executed, std::memory_order_relaxed);
+  store_max(&max_tasks_per_wakeup_, executed);
+
+  if (queue_depth_.load(std::memory_order_relaxed) > 0 && !wakeup_pending_.exchange(true, std::memory_order_acq_rel)) {
+    auto write_result = eventfd_write(fd_, 1);
+    ASSERT(write_result != -1);
   }
-  closure();
 }
 
 }  // namespace os
@@ -17,7 +17,9 @@
 #include "os/handler.h"
 
 #include <sys/eventfd.h>
+#include <future>
 #include <thread>
+#include <vector>
 
 #include "gtest/gtest.h"
 
@@ -67,6 +69,62 @@ TEST_F(HandlerTest, post_task_cleared) {
   EXPECT_EQ(val, 1);
 }
 
+TEST_F(HandlerTest, post_from_multiple_threads) {
+  constexpr int kNumThreads = 4;
+  constexpr int kNumTasksPerThread = 1000;
+  int val = 0;
+  std::promise<void> promise;
+  auto future = promise.get_future();
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; i++) {
+    threads.emplace_back([this, &val, &promise]() {
+      for (int j = 0; j < kNumTasksPerThread; j++) {
+        handler_->Post([&val, &promise]() {
+          if (++val == kNumThreads * kNumTasksPerThread) {
+            promise.set_value();
+          }
+        });
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  future.wait();
+  EXPECT_EQ(val, kNumThreads * kNumTasksPerThread);
+}
+
+TEST_F(HandlerTest, stats) {
+  std::promise<void> started;
+  std::promise<void> release;
+  auto release_future = release.get_future();
+  handler_->Post([&started, &release_future]() {
+    started.set_value();
+    release_future.wait();
+  });
+  started.get_future().wait();
+
+  // Queued up while the handler thread is busy, so they are drained on a single wakeup
+  std::promise<void> done;
+  for (int i = 0; i < 9; i++) {
+    handler_->Post([]() {});
+  }
+  handler_->Post([&done]() { done.set_value(); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  release.set_value();
+  done.get_future().wait();
+  // Counters are published once the whole batch has been drained
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+  auto stats = handler_->GetStats();
+  EXPECT_EQ(stats.queue_depth, 0u);
+  EXPECT_GE(stats.max_queue_depth, 10u);
+  EXPECT_EQ(stats.tasks_executed, 11u);
+  EXPECT_EQ(stats.max_tasks_per_wakeup, 10u);
+  EXPECT_EQ(stats.wakeups, 2u);
+  EXPECT_GE(stats.max_latency, std::chrono::milliseconds(5));
+}
+
 }  // namespace
 }  // namespace os
 }  // namespace bluetooth
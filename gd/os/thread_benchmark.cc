@@ -17,6 +17,7 @@
 #include <future>
 #include <memory>
 #include <thread>
+#include <vector>
 
 #include "benchmark/benchmark.h"
 
@@ -112,3 +113,33 @@ BENCHMARK_REGISTER_F(BM_ReactorThread, sequential_execution)
     ->Arg(100000)
     ->Iterations(1)
     ->UseRealTime();
+
+BENCHMARK_DEFINE_F(BM_ReactorThread, multi_producer_batch)(State& state) {
+  for (auto _ : state) {
+    num_messages_to_send_ = state.range(0);
+    int num_producers = state.range(1);
+    counter_ = 0;
+    counter_promise_ = std::promise<void>();
+    std::future<void> counter_future = counter_promise_.get_future();
+    std::vector<std::thread> producers;
+    for (int p = 0; p < num_producers; p++) {
+      producers.emplace_back([this, num_producers]() {
+        for (int i = 0; i < num_messages_to_send_ / num_producers; i++) {
+          handler_->Post([this]() { callback_batch(); });
+        }
+      });
+    }
+    for (auto& producer : producers) {
+      producer.join();
+    }
+    counter_future.wait();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+};
+
+BENCHMARK_REGISTER_F(BM_ReactorThread, multi_producer_batch)
+    ->Args({NUM_MESSAGES_TO_SEND, 1})
+    ->Args({NUM_MESSAGES_TO_SEND, 4})
+    ->Args({NUM_MESSAGES_TO_SEND, 16})
+    ->Iterations(5)
+    ->UseRealTime();
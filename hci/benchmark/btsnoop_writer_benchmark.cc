@@ -0,0 +1,123 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <chrono>
+#include <thread>
+
+#include "hci/include/btsnoop_writer.h"
+
+using ::benchmark::State;
+
+namespace {
+
+// The btsnoop record header, and an A2DP sized ACL packet
+constexpr size_t kHeaderSize = 25;
+constexpr size_t kPacketSize = 260;
+
+// Packets are captured in bursts of 18 KB every 10 ms, which the slow file
+// below keeps up with on average.
+constexpr int kBurstSize = 64;
+constexpr auto kBurstInterval = std::chrono::milliseconds(10);
+constexpr int kBursts = 200;
+
+// A log file on a slow disk: a pipe with a single page of buffer, drained
+// 4 KB at a time, every millisecond.
+class SlowFile {
+ public:
+  SlowFile() {
+    pipe(fds_);
+    fcntl(fds_[1], F_SETPIPE_SZ, 4096);
+    drain_ = std::thread([this] {
+      uint8_t buffer[4096];
+      while (read(fds_[0], buffer, sizeof(buffer)) > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    });
+  }
+
+  ~SlowFile() {
+    if (fds_[1] != -1) close(fds_[1]);
+    drain_.join();
+    close(fds_[0]);
+  }
+
+  int fd() const { return fds_[1]; }
+
+  // Hands the write end over to a BtsnoopWriter, which closes it.
+  int Release() {
+    int fd = fds_[1];
+    fds_[1] = -1;
+    return fd;
+  }
+
+ private:
+  int fds_[2];
+  std::thread drain_;
+};
+
+}  // namespace
+
+// capture() before this change: a writev() per packet, on the calling thread
+static void BM_CaptureWritev(State& state) {
+  SlowFile file;
+  uint8_t header[kHeaderSize] = {};
+  uint8_t packet[kPacketSize] = {};
+  for (auto _ : state) {
+    for (int i = 0; i < kBurstSize; i++) {
+      iovec iov[] = {{header, sizeof(header)}, {packet, sizeof(packet)}};
+      benchmark::DoNotOptimize(writev(file.fd(), iov, 2));
+    }
+
+    state.PauseTiming();
+    std::this_thread::sleep_for(kBurstInterval);
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * kBurstSize);
+}
+
+BENCHMARK(BM_CaptureWritev)->Iterations(kBursts)->UseRealTime();
+
+// capture() through the snoop writer: a copy into the thread's ring
+static void BM_CaptureBtsnoopWriter(State& state) {
+  SlowFile file;
+  uint8_t header[kHeaderSize] = {};
+  uint8_t packet[kPacketSize] = {};
+  uint32_t dropped;
+  {
+    BtsnoopWriter writer([&file] { return file.Release(); }, INT32_MAX);
+    uint64_t timestamp_us = 0;
+    for (auto _ : state) {
+      for (int i = 0; i < kBurstSize; i++) {
+        writer.Write(timestamp_us++, header, sizeof(header), packet,
+                     sizeof(packet));
+      }
+
+      state.PauseTiming();
+      std::this_thread::sleep_for(kBurstInterval);
+      state.ResumeTiming();
+    }
+    dropped = writer.dropped_packets();
+  }
+  state.SetItemsProcessed(state.iterations() * kBurstSize);
+  state.counters["dropped"] = dropped;
+}
+
+BENCHMARK(BM_CaptureBtsnoopWriter)->Iterations(kBursts)->UseRealTime();
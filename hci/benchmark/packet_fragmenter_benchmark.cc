@@ -0,0 +1,114 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <base/logging.h>
+#include <benchmark/benchmark.h>
+
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include "device/include/controller.h"
+#include "hci_internals.h"
+#include "osi/include/allocator.h"
+#include "packet_fragmenter.h"
+
+using ::benchmark::State;
+
+namespace {
+
+constexpr uint16_t kHandle = 0x0042;
+constexpr uint16_t kL2capPayloadSize = 2048;
+constexpr int kPacketsPerBatch = 32;
+
+const packet_fragmenter_t* fragmenter;
+controller_t controller;
+int reassembled_count;
+
+void reassembled(BT_HDR* packet) {
+  reassembled_count++;
+  osi_free(packet);
+}
+
+void fragmented(BT_HDR* packet, bool send_transmit_finished) {}
+
+void transmit_finished(BT_HDR* packet, bool all_fragments_sent) {}
+
+const packet_fragmenter_callbacks_t callbacks = {fragmented, reassembled,
+                                                 transmit_finished};
+
+// Appends the ACL packets a controller with |acl_data_size| byte buffers
+// delivers for one L2CAP packet of kL2capPayloadSize bytes.
+void AddFragments(std::vector<BT_HDR*>* fragments, uint16_t acl_data_size) {
+  uint16_t total_length = kL2capPayloadSize + 4;  // L2CAP header
+  uint16_t sent = 0;
+  while (sent < total_length) {
+    uint16_t length = std::min<uint16_t>(acl_data_size, total_length - sent);
+    BT_HDR* packet = (BT_HDR*)osi_malloc(sizeof(BT_HDR) +
+                                         HCI_ACL_PREAMBLE_SIZE + length);
+    packet->event = MSG_HC_TO_STACK_HCI_ACL;
+    packet->len = HCI_ACL_PREAMBLE_SIZE + length;
+    packet->offset = 0;
+    packet->layer_specific = 0;
+
+    uint8_t* stream = packet->data;
+    UINT16_TO_STREAM(stream, kHandle | (sent == 0 ? 0x2000 : 0x1000));
+    UINT16_TO_STREAM(stream, length);
+    memset(stream, 0xa5, length);
+    if (sent == 0) {
+      UINT16_TO_STREAM(stream, kL2capPayloadSize);
+      UINT16_TO_STREAM(stream, 0x0040);  // CID
+    }
+
+    fragments->push_back(packet);
+    sent += length;
+  }
+}
+
+}  // namespace
+
+// The controller module is not linked in; the fragmenter only asks it for
+// buffer sizes on transmit.
+const controller_t* controller_get_interface() { return &controller; }
+
+// Reassembly of L2CAP packets from a controller with 1021 (BR/EDR) or 27
+// (LE, no data length extension) byte ACL buffers
+static void BM_Reassemble(State& state) {
+  uint16_t acl_data_size = state.range(0);
+  fragmenter = packet_fragmenter_get_test_interface(&controller,
+                                                    &allocator_malloc);
+  fragmenter->init(&callbacks);
+  reassembled_count = 0;
+
+  std::vector<BT_HDR*> fragments;
+  for (auto _ : state) {
+    state.PauseTiming();
+    fragments.clear();
+    for (int i = 0; i < kPacketsPerBatch; i++)
+      AddFragments(&fragments, acl_data_size);
+    state.ResumeTiming();
+
+    for (BT_HDR* fragment : fragments)
+      fragmenter->reassemble_and_dispatch(fragment);
+  }
+
+  CHECK(reassembled_count == state.iterations() * kPacketsPerBatch);
+  state.SetBytesProcessed(state.iterations() * kPacketsPerBatch *
+                          kL2capPayloadSize);
+  fragmenter->cleanup();
+}
+
+BENCHMARK(BM_Reassemble)->Arg(1021)->Arg(27);
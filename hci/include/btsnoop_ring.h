@@ -0,0 +1,98 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+// Keeps the most recent btsnoop records in a preallocated ring file, mapped
+// into memory. Writing a record is a copy into the mapping, with no system
+// call, and the records are in the page cache as soon as they are copied, so
+// they outlive an abort() of the process.
+//
+// The ring file is not a btsnoop file; Recover() turns it into one.
+//
+// File layout, in host byte order:
+//   file_header_t, padded to kDataOffset
+//   |data_size| bytes of frames, wrapping around. Each frame is a
+//   frame_header_t followed by one btsnoop record (record header and
+//   packet), padded to kFrameAlignment. A frame starts at its stream
+//   position modulo |data_size|.
+class BtsnoopRing {
+ public:
+  static constexpr char kMagic[8] = {'b', 't', 's', 'r', 'i', 'n', 'g', 0};
+  static constexpr uint32_t kVersion = 1;
+  static constexpr size_t kDataOffset = 4096;
+  static constexpr size_t kFrameAlignment = 16;
+
+  // Frame states. A frame is marked as being written before its record is
+  // copied, and as committed after.
+  static constexpr uint32_t kFrameWriting = 0x57524954;
+  static constexpr uint32_t kFrameCommitted = 0x434d4954;
+
+  typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t data_offset;
+    uint64_t data_size;
+  } file_header_t;
+
+  typedef struct {
+    uint64_t position;
+    uint32_t length;
+    uint32_t state;
+  } frame_header_t;
+
+  // Creates the ring file at |path|, holding |data_size| bytes of frames,
+  // and maps it. |data_size| is rounded down to kFrameAlignment. Returns
+  // nullptr if the file cannot be allocated or mapped.
+  static std::unique_ptr<BtsnoopRing> Create(const std::string& path,
+                                             size_t data_size);
+
+  // Writes the records recovered from the ring file |ring_fd| to |out_fd| as
+  // a btsnoop file, oldest first. Records that were being written, or were
+  // partly overwritten, when the ring was last written to are left out.
+  // Returns the number of records written, or -1 if |ring_fd| is not a ring
+  // file.
+  static int Recover(int ring_fd, int out_fd);
+
+  ~BtsnoopRing();
+
+  // Appends a record made of |header| followed by |packet|, overwriting the
+  // oldest records. May be called from any number of threads at once.
+  void Write(const void* header, size_t header_length, const void* packet,
+             size_t packet_length);
+
+ private:
+  BtsnoopRing(int fd, uint8_t* mapping, size_t data_size);
+
+  void CopyIn(uint64_t position, const void* src, size_t length);
+
+  const int fd_;
+  uint8_t* const mapping_;
+  uint8_t* const data_;
+  const size_t data_size_;
+
+  // Stream position of the next frame
+  std::atomic<uint64_t> next_position_{0};
+};
@@ -0,0 +1,102 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Writes btsnoop records to the log file from a background thread, so that
+// capturing a packet never waits for the disk.
+//
+// Each capturing thread copies its records into a ring of its own, without
+// taking a lock. The writer thread merges the rings in timestamp order,
+// batches the records into large writes, and moves on to the next log file
+// every |packets_per_file| records. A record that does not fit in its ring is
+// dropped and counted in dropped_packets().
+class BtsnoopWriter {
+ public:
+  // Opens the next log file, with the btsnoop file header already written,
+  // and returns its descriptor, or INVALID_FD. Called on the writer thread.
+  using OpenFileCallback = std::function<int()>;
+
+  // Per capturing thread; must be a power of two.
+  static constexpr size_t kDefaultRingSize = 256 * 1024;
+
+  BtsnoopWriter(OpenFileCallback open_file, int32_t packets_per_file,
+                size_t ring_size = kDefaultRingSize);
+
+  // Writes out every record queued so far, then closes the log file.
+  ~BtsnoopWriter();
+
+  // Queues a record made of |header| followed by |packet|, captured at
+  // |timestamp_us|. May be called from any number of threads at once, and
+  // never blocks.
+  void Write(uint64_t timestamp_us, const void* header, size_t header_length,
+             const void* packet, size_t packet_length);
+
+  // Blocks until every record queued before the call has been written.
+  void Flush();
+
+  // The number of records dropped so far because their ring was full.
+  uint32_t dropped_packets() const { return dropped_packets_.load(); }
+
+ private:
+  class Ring;
+
+  Ring* GetRing();
+  void Run();
+  void WriteQueuedRecords();
+  void WriteBatch();
+
+  const OpenFileCallback open_file_;
+  const int32_t packets_per_file_;
+  const size_t ring_size_;
+  const uint64_t id_;
+
+  std::atomic<uint32_t> dropped_packets_{0};
+
+  // Rings of the capturing threads. Only appended to, and only while holding
+  // |rings_mutex_|.
+  std::mutex rings_mutex_;
+  std::vector<std::unique_ptr<Ring>> rings_;
+
+  std::mutex wake_mutex_;
+  std::condition_variable wake_;
+  std::condition_variable flushed_;
+  std::atomic<bool> wake_requested_{false};
+  bool stop_ = false;
+  uint64_t flush_requested_ = 0;
+  uint64_t flush_completed_ = 0;
+
+  // Writer thread state
+  int fd_;
+  int32_t packet_counter_ = 0;
+  std::unique_ptr<uint8_t[]> batch_;
+  size_t batch_length_ = 0;
+
+  std::thread thread_;
+};
@@ -33,9 +33,10 @@
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/time.h>
-#include <sys/uio.h>
 #include <unistd.h>
+#include <memory>
 #include <mutex>
+#include <shared_mutex>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -43,6 +44,8 @@
 #include "common/time_util.h"
 #include "hci/include/btsnoop.h"
 #include "hci/include/btsnoop_mem.h"
+#include "hci/include/btsnoop_ring.h"
+#include "hci/include/btsnoop_writer.h"
 #include "hci_layer.h"
 #include "internal_include/bt_trace.h"
 #include "osi/include/log.h"
@@ -70,6 +73,10 @@
 #define DEFAULT_BTSNOOP_PATH "/data/misc/bluetooth/logs/btsnoop_hci.log"
 #define BTSNOOP_MAX_PACKETS_PROPERTY "persist.bluetooth.btsnoopsize"
 
+// When set, the snoop log is kept in a ring file of this many megabytes
+// instead of being rotated through two log files. See btsnoop_ring.h.
+#define BTSNOOP_RING_SIZE_PROPERTY "persist.bluetooth.btsnoopringsize"
+
 typedef enum {
   kCommandPacket = 1,
   kAclPacket = 2,
@@ -90,11 +97,18 @@ static const size_t RFC_EVENT_OFFSET = 9;
 // a filtered packet.
 static const uint32_t L2C_HEADER_SIZE = 9;
 
-static int logfile_fd = INVALID_FD;
 static std::mutex btsnoop_mutex;
 
-static int32_t packets_per_file;
-static int32_t packet_counter;
+// Protects |snoop_writer| and |snoop_ring|. The capturing threads only share
+// it, so that they can write at the same time; it is taken exclusively to set
+// them up and tear them down. Taken before |btsnoop_mutex|.
+static std::shared_mutex snoop_sink_mutex;
+
+// Writes the snoop log off the capturing threads, when it is enabled.
+static std::unique_ptr<BtsnoopWriter> snoop_writer;
+
+// Or, in ring mode, the ring file that the snoop log is kept in.
+static std::unique_ptr<BtsnoopRing> snoop_ring;
 
 // Channel tracking variables for filtering.
 
@@ -168,7 +182,9 @@ void btsnoop_net_write(const void* data, size_t length);
 static void delete_btsnoop_files(bool filtered);
 static std::string get_btsnoop_log_path(bool filtered);
 static std::string get_btsnoop_last_log_path(std::string log_path);
-static void open_next_snoop_file();
+static std::string get_btsnoop_ring_path(std::string log_path);
+static void open_snoop_ring(size_t size);
+static int open_next_snoop_file();
 static void btsnoop_write_packet(packet_type_t type, uint8_t* packet,
                                  bool is_received, uint64_t timestamp_us);
 
@@ -176,6 +192,7 @@ static void btsnoop_write_packet(packet_type_t type, uint8_t* packet,
 
 static future_t* start_up() {
   std::array<char, PROPERTY_VALUE_MAX> property = {};
+  std::unique_lock<std::shared_mutex> sink_lock(snoop_sink_mutex);
   std::lock_guard<std::mutex> lock(btsnoop_mutex);
 
   // Default mode is FILTERED on userdebug/eng build, DISABLED on user build.
@@ -212,9 +229,17 @@ static future_t* start_up() {
   }
 
   if (is_btsnoop_enabled) {
-    open_next_snoop_file();
-    packets_per_file = osi_property_get_int32(BTSNOOP_MAX_PACKETS_PROPERTY,
-                                              DEFAULT_BTSNOOP_SIZE);
+    int32_t ring_size_mb =
+        osi_property_get_int32(BTSNOOP_RING_SIZE_PROPERTY, 0);
+    if (ring_size_mb > 0) open_snoop_ring((size_t)ring_size_mb << 20);
+
+    // The rotated log files are the fallback if the ring cannot be set up
+    if (!snoop_ring) {
+      int32_t packets_per_file = osi_property_get_int32(
+          BTSNOOP_MAX_PACKETS_PROPERTY, DEFAULT_BTSNOOP_SIZE);
+      snoop_writer = std::make_unique<BtsnoopWriter>(open_next_snoop_file,
+                                                     packets_per_file);
+    }
     btsnoop_net_open();
   }
 
@@ -222,23 +247,34 @@ static future_t* start_up() {
 }
 
 static future_t* shut_down(void) {
-  std::lock_guard<std::mutex> lock(btsnoop_mutex);
-
-  if (is_btsnoop_enabled) {
-    if (is_btsnoop_filtered) {
-      delete_btsnoop_files(false);
+  std::unique_ptr<BtsnoopWriter> writer;
+  std::unique_ptr<BtsnoopRing> ring;
+  {
+    std::unique_lock<std::shared_mutex> sink_lock(snoop_sink_mutex);
+    std::lock_guard<std::mutex> lock(btsnoop_mutex);
+
+    if (is_btsnoop_enabled) {
+      if (is_btsnoop_filtered) {
+        delete_btsnoop_files(false);
+      } else {
+        delete_btsnoop_files(true);
+      }
     } else {
       delete_btsnoop_files(true);
+      delete_btsnoop_files(false);
     }
-  } else {
-    delete_btsnoop_files(true);
-    delete_btsnoop_files(false);
-  }
 
-  if (logfile_fd != INVALID_FD) close(logfile_fd);
-  logfile_fd = INVALID_FD;
+    // No capture is writing to them once the lock is held
+    writer = std::move(snoop_writer);
+    ring = std::move(snoop_ring);
 
-  if (is_btsnoop_enabled) btsnoop_net_close();
+    if (is_btsnoop_enabled) btsnoop_net_close();
+  }
+
+  // Writes out whatever is still queued before closing the log, without
+  // holding up the capturing threads
+  writer.reset();
+  ring.reset();
 
   return NULL;
 }
@@ -252,11 +288,14 @@ EXPORT_SYMBOL extern const module_t btsnoop_module = {
     .dependencies = {STACK_CONFIG_MODULE, NULL}};
 
 // Interface functions
+
+// Called on the HCI thread and on the HAL callback thread. Capture only shares
+// |snoop_sink_mutex|, and the snoop writer takes a per thread copy of the
+// packet without locking, so capture does not serialize the two or wait for
+// the log file.
 static void capture(const BT_HDR* buffer, bool is_received) {
   uint8_t* p = const_cast<uint8_t*>(buffer->data + buffer->offset);
 
-  std::lock_guard<std::mutex> lock(btsnoop_mutex);
-
   struct timespec ts_now = {};
   clock_gettime(CLOCK_REALTIME, &ts_now);
   uint64_t timestamp_us =
@@ -264,7 +303,8 @@ static void capture(const BT_HDR* buffer, bool is_received) {
 
   btsnoop_mem_capture(buffer, timestamp_us);
 
-  if (logfile_fd == INVALID_FD) return;
+  std::shared_lock<std::shared_mutex> lock(snoop_sink_mutex);
+  if (!snoop_writer && !snoop_ring) return;
 
   switch (buffer->event & MSG_EVT_MASK) {
     case MSG_HC_TO_STACK_HCI_EVT:
@@ -340,6 +380,9 @@ static void delete_btsnoop_files(bool filtered) {
   auto log_path = get_btsnoop_log_path(filtered);
   remove(log_path.c_str());
   remove(get_btsnoop_last_log_path(log_path).c_str());
+  auto ring_path = get_btsnoop_ring_path(log_path);
+  remove(ring_path.c_str());
+  remove(get_btsnoop_last_log_path(ring_path).c_str());
 }
 
 std::string get_btsnoop_log_path(bool filtered) {
@@ -355,14 +398,29 @@ std::string get_btsnoop_last_log_path(std::string btsnoop_path) {
   return btsnoop_path.append(".last");
 }
 
-static void open_next_snoop_file() {
-  packet_counter = 0;
+std::string get_btsnoop_ring_path(std::string btsnoop_path) {
+  return btsnoop_path.append(".ring");
+}
 
-  if (logfile_fd != INVALID_FD) {
-    close(logfile_fd);
-    logfile_fd = INVALID_FD;
-  }
+static void open_snoop_ring(size_t size) {
+  auto ring_path =
+      get_btsnoop_ring_path(get_btsnoop_log_path(is_btsnoop_filtered));
+  auto last_ring_path = get_btsnoop_last_log_path(ring_path);
+
+  // Keep the ring of the previous run, which may have ended in a crash
+  if (rename(ring_path.c_str(), last_ring_path.c_str()) != 0 &&
+      errno != ENOENT)
+    LOG(ERROR) << __func__ << ": unable to rename '" << ring_path << "' to '"
+               << last_ring_path << "' : " << strerror(errno);
+
+  snoop_ring = BtsnoopRing::Create(ring_path, size);
+  if (snoop_ring)
+    LOG(INFO) << __func__ << ": Snoop Logs kept in " << (size >> 20)
+              << " MB ring file " << ring_path;
+}
 
+// Called on the snoop writer thread, which closes the previous file.
+static int open_next_snoop_file() {
   auto log_path = get_btsnoop_log_path(is_btsnoop_filtered);
   auto last_log_path = get_btsnoop_last_log_path(log_path);
 
@@ -371,16 +429,17 @@ static void open_next_snoop_file() {
                << last_log_path << "' : " << strerror(errno);
 
   mode_t prevmask = umask(0);
-  logfile_fd = open(log_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC,
-                    S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH);
+  int logfile_fd = open(log_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC,
+                        S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH);
   umask(prevmask);
   if (logfile_fd == INVALID_FD) {
     LOG(ERROR) << __func__ << ": unable to open '" << log_path
                << "' : " << strerror(errno);
-    return;
+    return INVALID_FD;
   }
 
   write(logfile_fd, "btsnoop\0\0\0\0\1\0\0\x3\xea", 16);
+  return logfile_fd;
 }
 
 typedef struct {
@@ -427,6 +486,7 @@ static bool should_filter_log(bool is_received, uint8_t* packet) {
   return false;
 }
 
+// Called from capture(), with |snoop_sink_mutex| shared.
 static void btsnoop_write_packet(packet_type_t type, uint8_t* packet,
                                  bool is_received, uint64_t timestamp_us) {
   uint32_t length_he = 0;
@@ -463,21 +523,26 @@ static void btsnoop_write_packet(packet_type_t type, uint8_t* packet,
       blacklisted ? htonl(L2C_HEADER_SIZE) : header.length_original;
   if (blacklisted) length_he = L2C_HEADER_SIZE;
   header.flags = htonl(flags);
-  header.dropped_packets = 0;
+  // The ring overwrites old records rather than dropping new ones
+  header.dropped_packets =
+      snoop_writer ? htonl(snoop_writer->dropped_packets()) : 0;
   header.timestamp = htonll(timestamp_us + BTSNOOP_EPOCH_DELTA);
   header.type = type;
 
-  btsnoop_net_write(&header, sizeof(btsnoop_header_t));
-  btsnoop_net_write(packet, length_he - 1);
-
-  if (logfile_fd != INVALID_FD) {
-    packet_counter++;
-    if (packet_counter > packets_per_file) {
-      open_next_snoop_file();
-    }
+#if (BT_NET_DEBUG == TRUE)
+  {
+    // Keep the header and packet of one thread from interleaving with
+    // another's on the socket
+    std::lock_guard<std::mutex> lock(btsnoop_mutex);
+    btsnoop_net_write(&header, sizeof(btsnoop_header_t));
+    btsnoop_net_write(packet, length_he - 1);
+  }
+#endif
 
-    iovec iov[] = {{&header, sizeof(btsnoop_header_t)},
-                   {reinterpret_cast<void*>(packet), length_he - 1}};
-    TEMP_FAILURE_RETRY(writev(logfile_fd, iov, 2));
+  if (snoop_ring) {
+    snoop_ring->Write(&header, sizeof(btsnoop_header_t), packet, length_he - 1);
+  } else {
+    snoop_writer->Write(timestamp_us, &header, sizeof(btsnoop_header_t),
+                        packet, length_he - 1);
   }
 }
@@ -0,0 +1,204 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#define LOG_TAG "bt_snoop_ring"
+
+#include "hci/include/btsnoop_ring.h"
+
+#include <base/logging.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+
+#include "osi/include/osi.h"
+
+constexpr char BtsnoopRing::kMagic[8];
+
+static size_t frame_size(uint32_t length) {
+  size_t size = sizeof(BtsnoopRing::frame_header_t) + length;
+  return (size + BtsnoopRing::kFrameAlignment - 1) &
+         ~(BtsnoopRing::kFrameAlignment - 1);
+}
+
+static bool write_all(int fd, const void* data, size_t length) {
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  while (length > 0) {
+    ssize_t ret = TEMP_FAILURE_RETRY(write(fd, p, length));
+    if (ret <= 0) return false;
+    p += ret;
+    length -= ret;
+  }
+  return true;
+}
+
+std::unique_ptr<BtsnoopRing> BtsnoopRing::Create(const std::string& path,
+                                                 size_t data_size) {
+  data_size &= ~(kFrameAlignment - 1);
+  size_t file_size = kDataOffset + data_size;
+
+  mode_t prevmask = umask(0);
+  int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC,
+                S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH);
+  umask(prevmask);
+  if (fd == INVALID_FD) {
+    LOG(ERROR) << __func__ << ": unable to open '" << path
+               << "' : " << strerror(errno);
+    return nullptr;
+  }
+
+  // Allocate every block now: storing to a hole in a shared mapping raises
+  // SIGBUS once the disk is full.
+  int error = posix_fallocate(fd, 0, file_size);
+  if (error != 0) {
+    LOG(ERROR) << __func__ << ": unable to allocate " << file_size
+               << " bytes for '" << path << "' : " << strerror(error);
+    close(fd);
+    unlink(path.c_str());
+    return nullptr;
+  }
+
+  void* mapping =
+      mmap(nullptr, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (mapping == MAP_FAILED) {
+    LOG(ERROR) << __func__ << ": unable to map '" << path
+               << "' : " << strerror(errno);
+    close(fd);
+    unlink(path.c_str());
+    return nullptr;
+  }
+
+  file_header_t* header = static_cast<file_header_t*>(mapping);
+  memcpy(header->magic, kMagic, sizeof(kMagic));
+  header->version = kVersion;
+  header->data_offset = kDataOffset;
+  header->data_size = data_size;
+
+  return std::unique_ptr<BtsnoopRing>(
+      new BtsnoopRing(fd, static_cast<uint8_t*>(mapping), data_size));
+}
+
+BtsnoopRing::BtsnoopRing(int fd, uint8_t* mapping, size_t data_size)
+    : fd_(fd),
+      mapping_(mapping),
+      data_(mapping + kDataOffset),
+      data_size_(data_size) {}
+
+BtsnoopRing::~BtsnoopRing() {
+  munmap(mapping_, kDataOffset + data_size_);
+  close(fd_);
+}
+
+void BtsnoopRing::Write(const void* header, size_t header_length,
+                        const void* packet, size_t packet_length) {
+  uint32_t length = header_length + packet_length;
+  size_t size = frame_size(length);
+  if (size > data_size_ / 2) return;
+
+  uint64_t position =
+      next_position_.fetch_add(size, std::memory_order_relaxed);
+  frame_header_t* frame =
+      reinterpret_cast<frame_header_t*>(data_ + position % data_size_);
+  frame->position = position;
+  frame->length = length;
+  frame->state = kFrameWriting;
+
+  // Only the compiler can reorder these stores in a way that matters: if the
+  // process dies, whatever it had stored stays in the page cache. The frame
+  // is marked before any of the old frames under it are overwritten, and
+  // committed after its record is complete.
+  std::atomic_signal_fence(std::memory_order_seq_cst);
+  CopyIn(position + sizeof(frame_header_t), header, header_length);
+  CopyIn(position + sizeof(frame_header_t) + header_length, packet,
+         packet_length);
+  std::atomic_signal_fence(std::memory_order_seq_cst);
+
+  frame->state = kFrameCommitted;
+}
+
+void BtsnoopRing::CopyIn(uint64_t position, const void* src, size_t length) {
+  size_t offset = position % data_size_;
+  size_t first = std::min(length, data_size_ - offset);
+  memcpy(data_ + offset, src, first);
+  memcpy(data_, static_cast<const uint8_t*>(src) + first, length - first);
+}
+
+int BtsnoopRing::Recover(int ring_fd, int out_fd) {
+  file_header_t header;
+  if (pread(ring_fd, &header, sizeof(header), 0) != sizeof(header) ||
+      memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.version != kVersion || header.data_size == 0 ||
+      header.data_size % kFrameAlignment != 0) {
+    return -1;
+  }
+
+  const size_t data_size = header.data_size;
+  std::vector<uint8_t> data(data_size);
+  if (pread(ring_fd, data.data(), data_size, header.data_offset) !=
+      static_cast<ssize_t>(data_size)) {
+    return -1;
+  }
+
+  // Every frame header still in the ring, as long as it sits where its
+  // position says it should
+  std::vector<frame_header_t> frames;
+  uint64_t end = 0;
+  for (size_t offset = 0; offset < data_size; offset += kFrameAlignment) {
+    frame_header_t frame;
+    memcpy(&frame, data.data() + offset, sizeof(frame));
+    if ((frame.state != kFrameWriting && frame.state != kFrameCommitted) ||
+        frame.position % data_size != offset ||
+        frame_size(frame.length) > data_size / 2) {
+      continue;
+    }
+    frames.push_back(frame);
+    end = std::max<uint64_t>(end, frame.position + frame_size(frame.length));
+  }
+
+  // Frames that start before the last |data_size| bytes of the stream have
+  // been at least partly overwritten, even if their header survived.
+  uint64_t start = end > data_size ? end - data_size : 0;
+  frames.erase(std::remove_if(frames.begin(), frames.end(),
+                              [start](const frame_header_t& frame) {
+                                return frame.state != kFrameCommitted ||
+                                       frame.position < start;
+                              }),
+               frames.end());
+  std::sort(frames.begin(), frames.end(),
+            [](const frame_header_t& a, const frame_header_t& b) {
+              return a.position < b.position;
+            });
+
+  if (!write_all(out_fd, "btsnoop\0\0\0\0\1\0\0\x3\xea", 16)) return -1;
+
+  std::vector<uint8_t> record;
+  for (const frame_header_t& frame : frames) {
+    record.resize(frame.length);
+    size_t offset = (frame.position + sizeof(frame_header_t)) % data_size;
+    size_t first = std::min<size_t>(frame.length, data_size - offset);
+    memcpy(record.data(), data.data() + offset, first);
+    memcpy(record.data() + first, data.data(), frame.length - first);
+    if (!write_all(out_fd, record.data(), record.size())) return -1;
+  }
+
+  return frames.size();
+}
@@ -0,0 +1,278 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#define LOG_TAG "bt_snoop_writer"
+
+#include "hci/include/btsnoop_writer.h"
+
+#include <base/logging.h>
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+
+#include "osi/include/osi.h"
+
+// How long records may sit in the rings when traffic is light.
+static constexpr std::chrono::milliseconds kWriteInterval(100);
+
+// Records are gathered into writes of at least this many bytes.
+static constexpr size_t kBatchSize = 64 * 1024;
+
+// Room for the largest record: the btsnoop record header and an ACL packet
+// with a 16 bit length.
+static constexpr size_t kMaxRecordSize = 64 + 4 + 0xffff;
+
+static std::atomic<uint64_t> next_writer_id{1};
+
+// A single producer, single consumer ring of records. Each record is prefixed
+// with its length and timestamp, and may wrap around the end of the buffer.
+class BtsnoopWriter::Ring {
+ public:
+  Ring(size_t size, std::thread::id owner)
+      : buffer_(new uint8_t[size]), mask_(size - 1), owner_(owner) {}
+
+  std::thread::id owner() const { return owner_; }
+
+  size_t used() const {
+    return tail_.load(std::memory_order_relaxed) -
+           head_.load(std::memory_order_relaxed);
+  }
+
+  // Called on the owning thread only.
+  bool Push(uint64_t timestamp_us, const void* header, size_t header_length,
+            const void* packet, size_t packet_length) {
+    prefix_t prefix = {static_cast<uint32_t>(header_length + packet_length),
+                       timestamp_us};
+    size_t record_length = sizeof(prefix) + prefix.length;
+
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    uint64_t head = head_.load(std::memory_order_acquire);
+    if (record_length > mask_ + 1 - (tail - head)) return false;
+
+    CopyIn(tail, &prefix, sizeof(prefix));
+    CopyIn(tail + sizeof(prefix), header, header_length);
+    CopyIn(tail + sizeof(prefix) + header_length, packet, packet_length);
+    tail_.store(tail + record_length, std::memory_order_release);
+    return true;
+  }
+
+  // Called on the writer thread only. Returns false if the ring is empty.
+  bool PeekTimestamp(uint64_t* timestamp_us) const {
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) return false;
+
+    prefix_t prefix;
+    CopyOut(head, &prefix, sizeof(prefix));
+    *timestamp_us = prefix.timestamp_us;
+    return true;
+  }
+
+  // Called on the writer thread only, after PeekTimestamp() found a record.
+  // Copies the record, without its prefix, to |dst| and returns its length.
+  size_t Pop(uint8_t* dst) {
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    prefix_t prefix;
+    CopyOut(head, &prefix, sizeof(prefix));
+    CopyOut(head + sizeof(prefix), dst, prefix.length);
+    head_.store(head + sizeof(prefix) + prefix.length,
+                std::memory_order_release);
+    return prefix.length;
+  }
+
+ private:
+  typedef struct {
+    uint32_t length;
+    uint64_t timestamp_us;
+  } prefix_t;
+
+  void CopyIn(uint64_t position, const void* src, size_t length) {
+    size_t offset = position & mask_;
+    size_t first = std::min(length, mask_ + 1 - offset);
+    memcpy(buffer_.get() + offset, src, first);
+    memcpy(buffer_.get(), static_cast<const uint8_t*>(src) + first,
+           length - first);
+  }
+
+  void CopyOut(uint64_t position, void* dst, size_t length) const {
+    size_t offset = position & mask_;
+    size_t first = std::min(length, mask_ + 1 - offset);
+    memcpy(dst, buffer_.get() + offset, first);
+    memcpy(static_cast<uint8_t*>(dst) + first, buffer_.get(), length - first);
+  }
+
+  std::unique_ptr<uint8_t[]> buffer_;
+  const size_t mask_;
+  const std::thread::id owner_;
+
+  // Free running byte counts; the consumer owns |head_| and the producer
+  // owns |tail_|.
+  std::atomic<uint64_t> head_{0};
+  std::atomic<uint64_t> tail_{0};
+};
+
+BtsnoopWriter::BtsnoopWriter(OpenFileCallback open_file,
+                             int32_t packets_per_file, size_t ring_size)
+    : open_file_(std::move(open_file)),
+      packets_per_file_(packets_per_file),
+      ring_size_(ring_size),
+      id_(next_writer_id++),
+      fd_(INVALID_FD),
+      batch_(new uint8_t[kBatchSize + kMaxRecordSize]) {
+  CHECK(ring_size_ > 0 && (ring_size_ & (ring_size_ - 1)) == 0);
+  thread_ = std::thread(&BtsnoopWriter::Run, this);
+}
+
+BtsnoopWriter::~BtsnoopWriter() {
+  {
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+    stop_ = true;
+  }
+  wake_.notify_one();
+  thread_.join();
+}
+
+BtsnoopWriter::Ring* BtsnoopWriter::GetRing() {
+  // The ring of the calling thread, cached for the writer it belongs to.
+  // Writers are told apart by |id_| rather than by address, as a new writer
+  // may be constructed where an old one was.
+  static thread_local uint64_t cached_writer_id = 0;
+  static thread_local Ring* cached_ring = nullptr;
+  if (cached_writer_id == id_) return cached_ring;
+
+  std::thread::id self = std::this_thread::get_id();
+  std::lock_guard<std::mutex> lock(rings_mutex_);
+  Ring* ring = nullptr;
+  for (const auto& r : rings_) {
+    if (r->owner() == self) ring = r.get();
+  }
+  if (ring == nullptr) {
+    rings_.emplace_back(new Ring(ring_size_, self));
+    ring = rings_.back().get();
+  }
+
+  cached_writer_id = id_;
+  cached_ring = ring;
+  return ring;
+}
+
+void BtsnoopWriter::Write(uint64_t timestamp_us, const void* header,
+                          size_t header_length, const void* packet,
+                          size_t packet_length) {
+  Ring* ring = GetRing();
+  if (header_length + packet_length > kMaxRecordSize ||
+      !ring->Push(timestamp_us, header, header_length, packet,
+                  packet_length)) {
+    dropped_packets_++;
+    return;
+  }
+
+  // Wake the writer early when the ring fills up; otherwise it comes around
+  // every kWriteInterval. A wakeup lost to a race is only a delay.
+  if (ring->used() > ring_size_ / 2 && !wake_requested_.exchange(true))
+    wake_.notify_one();
+}
+
+void BtsnoopWriter::Flush() {
+  std::unique_lock<std::mutex> lock(wake_mutex_);
+  uint64_t ticket = ++flush_requested_;
+  wake_.notify_one();
+  flushed_.wait(lock, [&] { return flush_completed_ >= ticket; });
+}
+
+void BtsnoopWriter::Run() {
+  pthread_setname_np(pthread_self(), "bt_snoop_writer");
+
+  fd_ = open_file_();
+
+  std::unique_lock<std::mutex> lock(wake_mutex_);
+  while (true) {
+    bool stopping = stop_;
+    uint64_t ticket = flush_requested_;
+    wake_requested_ = false;
+    lock.unlock();
+
+    WriteQueuedRecords();
+
+    lock.lock();
+    flush_completed_ = ticket;
+    flushed_.notify_all();
+    if (stopping) break;
+
+    wake_.wait_for(lock, kWriteInterval, [this] {
+      return stop_ || flush_requested_ != flush_completed_ ||
+             wake_requested_.load();
+    });
+  }
+
+  if (fd_ != INVALID_FD) close(fd_);
+  fd_ = INVALID_FD;
+}
+
+void BtsnoopWriter::WriteQueuedRecords() {
+  std::vector<Ring*> rings;
+  {
+    std::lock_guard<std::mutex> lock(rings_mutex_);
+    for (const auto& ring : rings_) rings.push_back(ring.get());
+  }
+
+  // Merge the rings, oldest record first, so the log stays in capture order
+  // across threads.
+  while (true) {
+    Ring* oldest = nullptr;
+    uint64_t oldest_timestamp_us = 0;
+    for (Ring* ring : rings) {
+      uint64_t timestamp_us;
+      if (ring->PeekTimestamp(&timestamp_us) &&
+          (oldest == nullptr || timestamp_us < oldest_timestamp_us)) {
+        oldest = ring;
+        oldest_timestamp_us = timestamp_us;
+      }
+    }
+    if (oldest == nullptr) break;
+
+    if (++packet_counter_ > packets_per_file_) {
+      WriteBatch();
+      if (fd_ != INVALID_FD) close(fd_);
+      fd_ = open_file_();
+      packet_counter_ = 0;
+    }
+
+    batch_length_ += oldest->Pop(batch_.get() + batch_length_);
+    if (batch_length_ >= kBatchSize) WriteBatch();
+  }
+
+  WriteBatch();
+}
+
+void BtsnoopWriter::WriteBatch() {
+  size_t written = 0;
+  while (fd_ != INVALID_FD && written < batch_length_) {
+    ssize_t ret = TEMP_FAILURE_RETRY(
+        write(fd_, batch_.get() + written, batch_length_ - written));
+    if (ret <= 0) {
+      LOG(ERROR) << __func__ << ": unable to write snoop log: "
+                 << strerror(errno);
+      break;
+    }
+    written += ret;
+  }
+  batch_length_ = 0;
+}
@@ -22,7 +22,7 @@
 
 #include <base/logging.h>
 #include <string.h>
-#include <unordered_map>
+#include <vector>
 
 #include "bt_target.h"
 #include "buffer_allocator.h"
@@ -49,13 +49,102 @@ static const allocator_t* buffer_allocator;
 static const controller_t* controller;
 static const packet_fragmenter_callbacks_t* callbacks;
 
-static std::unordered_map<uint16_t /* handle */, BT_HDR*> partial_packets;
+// A partially reassembled L2CAP packet. The start fragment and the
+// continuation fragments are held as received, chained in arrival order, and
+// only copied out once the packet is complete.
+typedef struct {
+  uint16_t handle;
+  uint16_t expected_length;  // Full length, including the ACL preamble
+  uint16_t received_length;
+  uint32_t started;  // Start order, to evict the oldest when out of slots
+  std::vector<BT_HDR*> fragments;  // Empty when the slot is free
+} partial_packet_t;
+
+#define PARTIAL_PACKET_NONE 0xFF
+
+static partial_packet_t partial_packets[MAX_L2CAP_LINKS];
+static uint32_t partial_packets_started;
+
+// Slot in |partial_packets| for each connection handle, or PARTIAL_PACKET_NONE
+static uint8_t partial_packet_index[HANDLE_MASK + 1];
+
+static_assert(MAX_L2CAP_LINKS < PARTIAL_PACKET_NONE,
+              "partial_packet_index entries must fit a slot number");
+
+static void partial_packet_free(uint16_t handle) {
+  uint8_t index = partial_packet_index[handle];
+  if (index == PARTIAL_PACKET_NONE) return;
+
+  partial_packet_t* partial_packet = &partial_packets[index];
+  for (BT_HDR* fragment : partial_packet->fragments)
+    buffer_allocator->free(fragment);
+  // clear() keeps the capacity, so a busy link does not reallocate the chain
+  partial_packet->fragments.clear();
+  partial_packet_index[handle] = PARTIAL_PACKET_NONE;
+}
+
+static partial_packet_t* partial_packet_new(uint16_t handle) {
+  partial_packet_t* oldest = NULL;
+  for (partial_packet_t& slot : partial_packets) {
+    if (slot.fragments.empty()) {
+      oldest = &slot;
+      break;
+    }
+    if (oldest == NULL || (int32_t)(slot.started - oldest->started) < 0)
+      oldest = &slot;
+  }
+
+  if (!oldest->fragments.empty()) {
+    LOG_WARN(LOG_TAG,
+             "%s no free slot for handle 0x%04x. Dropping the oldest "
+             "unfinished packet, for handle 0x%04x.",
+             __func__, handle, oldest->handle);
+    partial_packet_free(oldest->handle);
+  }
+
+  oldest->handle = handle;
+  oldest->started = partial_packets_started++;
+  partial_packet_index[handle] = oldest - partial_packets;
+  return oldest;
+}
+
+// Copies the chained fragments of a complete |partial_packet| into a single
+// buffer, which is what L2CAP consumes, and releases the slot.
+static BT_HDR* partial_packet_flatten(partial_packet_t* partial_packet) {
+  BT_HDR* packet = (BT_HDR*)buffer_allocator->alloc(
+      partial_packet->expected_length + sizeof(BT_HDR));
+  packet->event = partial_packet->fragments[0]->event;
+  packet->len = partial_packet->expected_length;
+  packet->offset = 0;
+  packet->layer_specific = 0;
+
+  uint8_t* dst = packet->data;
+  for (const BT_HDR* fragment : partial_packet->fragments) {
+    memcpy(dst, fragment->data + fragment->offset, fragment->len);
+    dst += fragment->len;
+  }
+
+  // Update the ACL data size to indicate the full length
+  uint8_t* stream = packet->data;
+  STREAM_SKIP_UINT16(stream);  // skip the handle
+  UINT16_TO_STREAM(stream, packet->len - HCI_ACL_PREAMBLE_SIZE);
+
+  partial_packet_free(partial_packet->handle);
+  return packet;
+}
 
 static void init(const packet_fragmenter_callbacks_t* result_callbacks) {
   callbacks = result_callbacks;
+  memset(partial_packet_index, PARTIAL_PACKET_NONE,
+         sizeof(partial_packet_index));
 }
 
-static void cleanup() { partial_packets.clear(); }
+static void cleanup() {
+  for (partial_packet_t& partial_packet : partial_packets) {
+    if (!partial_packet.fragments.empty())
+      partial_packet_free(partial_packet.handle);
+  }
+}
 
 static void fragment_and_dispatch(BT_HDR* packet) {
   CHECK(packet != NULL);
@@ -81,6 +170,9 @@ static void fragment_and_dispatch(BT_HDR* packet) {
   STREAM_TO_UINT16(continuation_handle, stream);
   continuation_handle = APPLY_CONTINUATION_FLAG(continuation_handle);
 
+  // Every fragment is a window onto |packet| itself: the ACL header of the
+  // next fragment is written over the tail of the one just handed off, so
+  // nothing is copied.
   while (remaining_length > max_packet_size) {
     // Make sure we use the right ACL packet size
     stream = packet->data + packet->offset;
@@ -141,16 +233,12 @@ static void reassemble_and_dispatch(UNUSED_ATTR BT_HDR* packet) {
       }
       uint16_t l2cap_length;
       STREAM_TO_UINT16(l2cap_length, stream);
-      auto map_iter = partial_packets.find(handle);
-      if (map_iter != partial_packets.end()) {
+      if (partial_packet_index[handle] != PARTIAL_PACKET_NONE) {
         LOG_WARN(LOG_TAG,
                  "%s found unfinished packet for handle with start packet. "
                  "Dropping old.",
                  __func__);
-
-        BT_HDR* hdl = map_iter->second;
-        partial_packets.erase(map_iter);
-        buffer_allocator->free(hdl);
+        partial_packet_free(handle);
       }
 
       if (acl_length < L2CAP_HEADER_PDU_LEN_SIZE) {
@@ -184,59 +272,41 @@ static void reassemble_and_dispatch(UNUSED_ATTR BT_HDR* packet) {
         return;
       }
 
-      BT_HDR* partial_packet =
-          (BT_HDR*)buffer_allocator->alloc(full_length + sizeof(BT_HDR));
-      partial_packet->event = packet->event;
-      partial_packet->len = full_length;
-      partial_packet->offset = packet->len;
-
-      memcpy(partial_packet->data, packet->data, packet->len);
-
-      // Update the ACL data size to indicate the full expected length
-      stream = partial_packet->data;
-      STREAM_SKIP_UINT16(stream);  // skip the handle
-      UINT16_TO_STREAM(stream, full_length - HCI_ACL_PREAMBLE_SIZE);
-
-      partial_packets[handle] = partial_packet;
-
-      // Free the old packet buffer, since we don't need it anymore
-      buffer_allocator->free(packet);
+      // Hold on to the start fragment as the head of the chain; the ACL
+      // preamble and the L2CAP header are both kept from it.
+      partial_packet_t* partial_packet = partial_packet_new(handle);
+      partial_packet->expected_length = full_length;
+      partial_packet->received_length = packet->len;
+      partial_packet->fragments.push_back(packet);
     } else {
-      auto map_iter = partial_packets.find(handle);
-      if (map_iter == partial_packets.end()) {
+      uint8_t index = partial_packet_index[handle];
+      if (index == PARTIAL_PACKET_NONE) {
         LOG_WARN(LOG_TAG,
                  "%s got continuation for unknown packet. Dropping it.",
                  __func__);
         buffer_allocator->free(packet);
         return;
       }
-      BT_HDR* partial_packet = map_iter->second;
+      partial_packet_t* partial_packet = &partial_packets[index];
 
+      // Only the payload of a continuation fragment is chained
       packet->offset = HCI_ACL_PREAMBLE_SIZE;
-      uint16_t projected_offset =
-          partial_packet->offset + (packet->len - HCI_ACL_PREAMBLE_SIZE);
-      if (projected_offset >
-          partial_packet->len) {  // len stores the expected length
+      packet->len -= HCI_ACL_PREAMBLE_SIZE;
+      if (partial_packet->received_length + packet->len >
+          partial_packet->expected_length) {
         LOG_WARN(LOG_TAG,
                  "%s got packet which would exceed expected length of %d. "
                  "Truncating.",
-                 __func__, partial_packet->len);
-        packet->len = partial_packet->len - partial_packet->offset;
-        projected_offset = partial_packet->len;
+                 __func__, partial_packet->expected_length);
+        packet->len =
+            partial_packet->expected_length - partial_packet->received_length;
       }
 
-      memcpy(partial_packet->data + partial_packet->offset,
-             packet->data + packet->offset, packet->len - packet->offset);
+      partial_packet->received_length += packet->len;
+      partial_packet->fragments.push_back(packet);
 
-      // Free the old packet buffer, since we don't need it anymore
-      buffer_allocator->free(packet);
-      partial_packet->offset = projected_offset;
-
-      if (partial_packet->offset == partial_packet->len) {
-        partial_packets.erase(handle);
-        partial_packet->offset = 0;
-        callbacks->reassembled(partial_packet);
-      }
+      if (partial_packet->received_length == partial_packet->expected_length)
+        callbacks->reassembled(partial_packet_flatten(partial_packet));
     }
   } else {
     callbacks->reassembled(packet);
@@ -0,0 +1,185 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+#include "hci/include/btsnoop_ring.h"
+
+namespace {
+
+constexpr size_t kDataSize = 4096;
+
+// The records these tests write: a "header" holding the record's index and
+// payload length, then a payload of that many copies of the index.
+typedef struct {
+  uint32_t index;
+  uint32_t length;
+} test_header_t;
+
+size_t payload_length(uint32_t index) { return 20 + (index * 7) % 90; }
+
+size_t frame_size(uint32_t index) {
+  size_t size = sizeof(BtsnoopRing::frame_header_t) + sizeof(test_header_t) +
+                payload_length(index);
+  return (size + BtsnoopRing::kFrameAlignment - 1) &
+         ~(BtsnoopRing::kFrameAlignment - 1);
+}
+
+void WriteRecord(BtsnoopRing* ring, uint32_t index) {
+  test_header_t header = {index, static_cast<uint32_t>(payload_length(index))};
+  std::vector<uint8_t> payload(header.length, index & 0xff);
+  ring->Write(&header, sizeof(header), payload.data(), payload.size());
+}
+
+class BtsnoopRingTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    char dir[] = "/tmp/btsnoop_ring_test_XXXXXX";
+    ASSERT_NE(nullptr, mkdtemp(dir));
+    dir_ = dir;
+    ring_path_ = dir_ + "/ring";
+  }
+
+  void TearDown() override {
+    unlink(ring_path_.c_str());
+    rmdir(dir_.c_str());
+  }
+
+  // Recovers |ring_path_| and returns the indices of the records, checking
+  // that each is intact.
+  std::vector<uint32_t> Recover() {
+    std::string out_path = dir_ + "/btsnoop";
+    int ring_fd = open(ring_path_.c_str(), O_RDONLY);
+    int out_fd = open(out_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+    int records = BtsnoopRing::Recover(ring_fd, out_fd);
+    close(ring_fd);
+
+    std::vector<uint32_t> indices;
+    uint8_t file_header[16];
+    EXPECT_EQ(16, pread(out_fd, file_header, sizeof(file_header), 0));
+    EXPECT_EQ(0, memcmp(file_header, "btsnoop\0\0\0\0\1\0\0\x3\xea", 16));
+
+    off_t offset = sizeof(file_header);
+    test_header_t header;
+    while (pread(out_fd, &header, sizeof(header), offset) == sizeof(header)) {
+      EXPECT_EQ(payload_length(header.index), header.length);
+      std::vector<uint8_t> payload(header.length);
+      EXPECT_EQ(static_cast<ssize_t>(header.length),
+                pread(out_fd, payload.data(), header.length,
+                      offset + sizeof(header)));
+      for (uint8_t byte : payload) EXPECT_EQ(header.index & 0xff, byte);
+      indices.push_back(header.index);
+      offset += sizeof(header) + header.length;
+    }
+
+    close(out_fd);
+    unlink(out_path.c_str());
+    EXPECT_EQ(records, static_cast<int>(indices.size()));
+    return indices;
+  }
+
+  std::string dir_;
+  std::string ring_path_;
+};
+
+}  // namespace
+
+TEST_F(BtsnoopRingTest, recovers_newest_records_in_order) {
+  auto ring = BtsnoopRing::Create(ring_path_, kDataSize);
+  ASSERT_NE(nullptr, ring);
+  for (uint32_t i = 0; i < 500; i++) WriteRecord(ring.get(), i);
+
+  // The records that fit in the ring, ending with the last one written
+  std::vector<uint32_t> indices = Recover();
+  ASSERT_FALSE(indices.empty());
+  size_t size = 0;
+  for (size_t i = 0; i < indices.size(); i++) {
+    EXPECT_EQ(500 - indices.size() + i, indices[i]);
+    size += frame_size(indices[i]);
+  }
+  EXPECT_LE(size, kDataSize);
+  EXPECT_GT(size + frame_size(indices[0] - 1), kDataSize);
+}
+
+TEST_F(BtsnoopRingTest, skips_frames_being_written) {
+  auto ring = BtsnoopRing::Create(ring_path_, kDataSize);
+  ASSERT_NE(nullptr, ring);
+  std::vector<uint64_t> positions;
+  uint64_t end = 0;
+  for (uint32_t i = 0; i < 100; i++) {
+    WriteRecord(ring.get(), i);
+    positions.push_back(end);
+    end += frame_size(i);
+  }
+  std::vector<uint32_t> before = Recover();
+
+  // Leave the ring as a crash during two concurrent Write() calls would: the
+  // first has reserved its frame and not written anything yet, the second
+  // has marked its frame and copied part of its record. The second frame
+  // starts right after the header of the oldest frame that begins under the
+  // first, so that the old frame's header survives but its record does not.
+  uint32_t oldest = 0;
+  while (positions[oldest] < end - kDataSize) oldest++;
+  uint64_t position = positions[oldest] + kDataSize + 16;
+  BtsnoopRing::frame_header_t frame = {position, 200,
+                                       BtsnoopRing::kFrameWriting};
+  int fd = open(ring_path_.c_str(), O_RDWR);
+  off_t offset = BtsnoopRing::kDataOffset + position % kDataSize;
+  ASSERT_EQ(static_cast<ssize_t>(sizeof(frame)),
+            pwrite(fd, &frame, sizeof(frame), offset));
+  std::vector<uint8_t> garbage(100, 0xee);
+  ASSERT_EQ(static_cast<ssize_t>(garbage.size()),
+            pwrite(fd, garbage.data(), garbage.size(), offset + sizeof(frame)));
+  close(fd);
+
+  // Neither new frame is recovered, nor the old frames under them
+  std::vector<uint32_t> after = Recover();
+  ASSERT_FALSE(after.empty());
+  EXPECT_EQ(99u, after.back());
+  EXPECT_GT(after.front(), oldest);
+  EXPECT_TRUE(std::equal(after.begin(), after.end(),
+                         before.end() - after.size()));
+}
+
+TEST_F(BtsnoopRingTest, survives_abort) {
+  ASSERT_DEATH(
+      {
+        auto ring = BtsnoopRing::Create(ring_path_, kDataSize);
+        for (uint32_t i = 0; i < 30; i++) WriteRecord(ring.get(), i);
+        abort();
+      },
+      "");
+
+  std::vector<uint32_t> indices = Recover();
+  ASSERT_FALSE(indices.empty());
+  EXPECT_EQ(29u, indices.back());
+}
+
+TEST_F(BtsnoopRingTest, rejects_other_files) {
+  int fd = open(ring_path_.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+  ASSERT_EQ(16, write(fd, "btsnoop\0\0\0\0\1\0\0\x3\xea", 16));
+  EXPECT_EQ(-1, BtsnoopRing::Recover(fd, fd));
+  close(fd);
+}
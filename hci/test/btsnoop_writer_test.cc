@@ -0,0 +1,164 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "hci/include/btsnoop_writer.h"
+
+namespace {
+
+// A record as these tests write it: an 8 byte timestamp "header" and a
+// payload of |length| copies of |fill|.
+typedef struct {
+  uint64_t timestamp_us;
+  uint8_t fill;
+  uint8_t length;
+} test_record_t;
+
+class BtsnoopWriterTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    char path[] = "/tmp/btsnoop_writer_test_XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_NE(-1, fd);
+    close(fd);
+    path_ = path;
+  }
+
+  void TearDown() override { unlink(path_.c_str()); }
+
+  int OpenFile() {
+    files_opened_++;
+    return open(path_.c_str(), O_WRONLY | O_TRUNC);
+  }
+
+  static void WriteRecord(BtsnoopWriter* writer, uint64_t timestamp_us,
+                          uint8_t fill, uint8_t length) {
+    std::vector<uint8_t> payload(length, fill);
+    writer->Write(timestamp_us, &timestamp_us, sizeof(timestamp_us),
+                  payload.data(), payload.size());
+  }
+
+  std::vector<test_record_t> ReadRecords(uint8_t length) {
+    std::vector<test_record_t> records;
+    int fd = open(path_.c_str(), O_RDONLY);
+    std::vector<uint8_t> buffer(sizeof(uint64_t) + length);
+    while (read(fd, buffer.data(), buffer.size()) ==
+           static_cast<ssize_t>(buffer.size())) {
+      test_record_t record;
+      memcpy(&record.timestamp_us, buffer.data(), sizeof(uint64_t));
+      record.fill = buffer[sizeof(uint64_t)];
+      record.length = length;
+      for (uint8_t i = 0; i < length; i++)
+        EXPECT_EQ(record.fill, buffer[sizeof(uint64_t) + i]);
+      records.push_back(record);
+    }
+    close(fd);
+    return records;
+  }
+
+  std::string path_;
+  int files_opened_ = 0;
+};
+
+}  // namespace
+
+TEST_F(BtsnoopWriterTest, merges_threads_in_timestamp_order) {
+  // Hold the writer thread in its first open until both threads are done, so
+  // that it sees all the records at once
+  std::promise<void> release;
+  std::shared_future<void> released = release.get_future().share();
+  BtsnoopWriter writer(
+      [this, released] {
+        released.wait();
+        return OpenFile();
+      },
+      1000);
+
+  // Even timestamps from this thread, odd ones from another
+  std::thread other([&writer] {
+    for (uint64_t t = 1; t < 200; t += 2) WriteRecord(&writer, t, 0xbb, 40);
+  });
+  for (uint64_t t = 0; t < 200; t += 2) WriteRecord(&writer, t, 0xaa, 40);
+  other.join();
+  release.set_value();
+  writer.Flush();
+
+  std::vector<test_record_t> records = ReadRecords(40);
+  ASSERT_EQ(200u, records.size());
+  for (uint64_t t = 0; t < 200; t++) {
+    EXPECT_EQ(t, records[t].timestamp_us);
+    EXPECT_EQ(t % 2 ? 0xbb : 0xaa, records[t].fill);
+  }
+  EXPECT_EQ(0u, writer.dropped_packets());
+  EXPECT_EQ(1, files_opened_);
+}
+
+TEST_F(BtsnoopWriterTest, moves_to_next_file) {
+  BtsnoopWriter writer([this] { return OpenFile(); }, 3);
+  for (uint64_t t = 0; t < 10; t++) WriteRecord(&writer, t, t, 8);
+  writer.Flush();
+
+  // Files of 3, 4 and 3 records, counting the one that triggers the move
+  EXPECT_EQ(3, files_opened_);
+  std::vector<test_record_t> records = ReadRecords(8);
+  ASSERT_EQ(3u, records.size());
+  EXPECT_EQ(7u, records[0].timestamp_us);
+  EXPECT_EQ(9u, records[2].timestamp_us);
+}
+
+TEST_F(BtsnoopWriterTest, counts_dropped_records) {
+  // Hold the writer thread in its first open until the ring has overflowed
+  std::promise<void> release;
+  std::shared_future<void> released = release.get_future().share();
+  BtsnoopWriter writer(
+      [this, released] {
+        released.wait();
+        return OpenFile();
+      },
+      1000, 256);
+
+  // 8 + 40 bytes of record and 16 of ring framing: 4 fit in 256 bytes
+  for (uint64_t t = 0; t < 10; t++) WriteRecord(&writer, t, t, 40);
+  EXPECT_EQ(6u, writer.dropped_packets());
+
+  release.set_value();
+  writer.Flush();
+  std::vector<test_record_t> records = ReadRecords(40);
+  ASSERT_EQ(4u, records.size());
+  for (uint64_t t = 0; t < 4; t++) EXPECT_EQ(t, records[t].timestamp_us);
+}
+
+TEST_F(BtsnoopWriterTest, writes_out_queue_when_destroyed) {
+  {
+    BtsnoopWriter writer([this] { return OpenFile(); }, 1000);
+    for (uint64_t t = 0; t < 50; t++) WriteRecord(&writer, t, t, 16);
+  }
+
+  std::vector<test_record_t> records = ReadRecords(16);
+  ASSERT_EQ(50u, records.size());
+  EXPECT_EQ(49u, records[49].timestamp_us);
+}
@@ -21,6 +21,7 @@
 #include "AllocationTestHarness.h"
 
 #include <stdint.h>
+#include <vector>
 
 #include "device/include/controller.h"
 #include "hci_internals.h"
@@ -32,7 +33,8 @@
 DECLARE_TEST_MODES(init, set_data_sizes, no_fragmentation, fragmentation,
                    ble_no_fragmentation, ble_fragmentation,
                    non_acl_passthrough_fragmentation, no_reassembly, reassembly,
-                   non_acl_passthrough_reassembly);
+                   non_acl_passthrough_reassembly, interleaved_reassembly,
+                   restarted_reassembly);
 
 #define LOCAL_BLE_CONTROLLER_ID 1
 
@@ -54,6 +56,8 @@ static const char* sample_data =
 static const char* small_sample_data = "\"What giants?\" said Sancho Panza.";
 static const uint16_t test_handle_start = (0x1992 & 0xCFFF) | 0x2000;
 static const uint16_t test_handle_continuation = (0x1992 & 0xCFFF) | 0x1000;
+static const uint16_t other_handle_start = (0x0001 & 0xCFFF) | 0x2000;
+static const uint16_t other_handle_continuation = (0x0001 & 0xCFFF) | 0x1000;
 static int packet_index;
 static unsigned int data_size_sum;
 
@@ -127,43 +131,59 @@ static void expect_packet_fragmented(uint16_t event, int max_acl_data_size,
   if (send_complete) osi_free(packet);
 }
 
+// Splits |data| into ACL packets of at most |acl_size| bytes, the way a
+// controller would deliver it, headed with |start_handle| and then
+// |continuation_handle|.
+static std::vector<BT_HDR*> manufacture_acl_fragments(
+    uint16_t start_handle, uint16_t continuation_handle, uint16_t acl_size,
+    const char* data) {
+  std::vector<BT_HDR*> fragments;
+  uint16_t data_length = strlen(data);
+  uint16_t total_length = data_length + 2;  // 2 for l2cap length;
+  uint16_t length_sent = 0;
+  uint16_t l2cap_length = data_length - 2;  // l2cap length field, 2 for the
+                                            // pretend channel id borrowed
+                                            // from the data
+
+  do {
+    int length_to_send = (length_sent + (acl_size - 4) < total_length)
+                             ? (acl_size - 4)
+                             : (total_length - length_sent);
+    BT_HDR* packet = (BT_HDR*)osi_malloc(length_to_send + 4 + sizeof(BT_HDR));
+    packet->len = length_to_send + 4;
+    packet->offset = 0;
+    packet->event = MSG_HC_TO_STACK_HCI_ACL;
+    packet->layer_specific = 0;
+
+    uint8_t* packet_data = packet->data;
+    if (length_sent == 0) {  // first packet
+      UINT16_TO_STREAM(packet_data, start_handle);
+      UINT16_TO_STREAM(packet_data, length_to_send);
+      UINT16_TO_STREAM(packet_data, l2cap_length);
+      memcpy(packet_data, data, length_to_send - 2);
+    } else {
+      UINT16_TO_STREAM(packet_data, continuation_handle);
+      UINT16_TO_STREAM(packet_data, length_to_send);
+      memcpy(packet_data, data + length_sent - 2, length_to_send);
+    }
+
+    length_sent += length_to_send;
+    fragments.push_back(packet);
+  } while (length_sent < total_length);
+
+  return fragments;
+}
+
 static void manufacture_packet_and_then_reassemble(uint16_t event,
                                                    uint16_t acl_size,
                                                    const char* data) {
   uint16_t data_length = strlen(data);
 
   if (event == MSG_HC_TO_STACK_HCI_ACL) {
-    uint16_t total_length = data_length + 2;  // 2 for l2cap length;
-    uint16_t length_sent = 0;
-    uint16_t l2cap_length = data_length - 2;  // l2cap length field, 2 for the
-                                              // pretend channel id borrowed
-                                              // from the data
-
-    do {
-      int length_to_send = (length_sent + (acl_size - 4) < total_length)
-                               ? (acl_size - 4)
-                               : (total_length - length_sent);
-      BT_HDR* packet = (BT_HDR*)osi_malloc(length_to_send + 4 + sizeof(BT_HDR));
-      packet->len = length_to_send + 4;
-      packet->offset = 0;
-      packet->event = event;
-      packet->layer_specific = 0;
-
-      uint8_t* packet_data = packet->data;
-      if (length_sent == 0) {  // first packet
-        UINT16_TO_STREAM(packet_data, test_handle_start);
-        UINT16_TO_STREAM(packet_data, length_to_send);
-        UINT16_TO_STREAM(packet_data, l2cap_length);
-        memcpy(packet_data, data, length_to_send - 2);
-      } else {
-        UINT16_TO_STREAM(packet_data, test_handle_continuation);
-        UINT16_TO_STREAM(packet_data, length_to_send);
-        memcpy(packet_data, data + length_sent - 2, length_to_send);
-      }
-
-      length_sent += length_to_send;
+    for (BT_HDR* packet : manufacture_acl_fragments(
+             test_handle_start, test_handle_continuation, acl_size, data)) {
       fragmenter->reassemble_and_dispatch(packet);
-    } while (length_sent < total_length);
+    }
   } else {
     BT_HDR* packet = (BT_HDR*)osi_malloc(data_length + sizeof(BT_HDR));
     packet->len = data_length;
@@ -176,8 +196,9 @@ static void manufacture_packet_and_then_reassemble(uint16_t event,
   }
 }
 
-static void expect_packet_reassembled(uint16_t event, BT_HDR* packet,
-                                      const char* expected_data) {
+static void expect_packet_reassembled(
+    uint16_t event, BT_HDR* packet, const char* expected_data,
+    uint16_t expected_handle = test_handle_start) {
   uint16_t expected_data_length = strlen(expected_data);
   uint8_t* data = packet->data + packet->offset;
 
@@ -189,7 +210,7 @@ static void expect_packet_reassembled(uint16_t event, BT_HDR* packet,
     STREAM_TO_UINT16(length, data);
     STREAM_TO_UINT16(l2cap_length, data);
 
-    EXPECT_EQ(test_handle_start, handle);
+    EXPECT_EQ(expected_handle, handle);
     EXPECT_EQ(expected_data_length + 2, length);
     EXPECT_EQ(expected_data_length - 2,
               l2cap_length);  // -2 for the pretend channel id
@@ -253,6 +274,24 @@ DURING(non_acl_passthrough_reassembly) AT_CALL(0) {
   return;
 }
 
+DURING(interleaved_reassembly) {
+  AT_CALL(0) {
+    expect_packet_reassembled(MSG_HC_TO_STACK_HCI_ACL, packet,
+                              small_sample_data, other_handle_start);
+    return;
+  }
+  AT_CALL(1) {
+    expect_packet_reassembled(MSG_HC_TO_STACK_HCI_ACL, packet, sample_data);
+    return;
+  }
+}
+
+DURING(restarted_reassembly) AT_CALL(0) {
+  expect_packet_reassembled(MSG_HC_TO_STACK_HCI_ACL, packet,
+                            small_sample_data);
+  return;
+}
+
 UNEXPECTED_CALL;
 }
 
@@ -394,3 +433,35 @@ TEST_F(PacketFragmenterTest, test_non_acl_passthrough_reasseembly) {
   EXPECT_EQ(strlen(sample_data), data_size_sum);
   EXPECT_CALL_COUNT(reassembled_callback, 1);
 }
+
+TEST_F(PacketFragmenterTest, test_interleaved_reassembly) {
+  reset_for(interleaved_reassembly);
+  std::vector<BT_HDR*> first = manufacture_acl_fragments(
+      test_handle_start, test_handle_continuation, 27, sample_data);
+  std::vector<BT_HDR*> second = manufacture_acl_fragments(
+      other_handle_start, other_handle_continuation, 27, small_sample_data);
+
+  for (size_t i = 0; i < first.size() || i < second.size(); i++) {
+    if (i < first.size()) fragmenter->reassemble_and_dispatch(first[i]);
+    if (i < second.size()) fragmenter->reassemble_and_dispatch(second[i]);
+  }
+
+  EXPECT_EQ(strlen(sample_data) + strlen(small_sample_data), data_size_sum);
+  EXPECT_CALL_COUNT(reassembled_callback, 2);
+}
+
+TEST_F(PacketFragmenterTest, test_restarted_reassembly) {
+  reset_for(restarted_reassembly);
+  std::vector<BT_HDR*> abandoned = manufacture_acl_fragments(
+      test_handle_start, test_handle_continuation, 42, sample_data);
+  fragmenter->reassemble_and_dispatch(abandoned[0]);
+  fragmenter->reassemble_and_dispatch(abandoned[1]);
+  for (size_t i = 2; i < abandoned.size(); i++) osi_free(abandoned[i]);
+
+  // A new start packet drops the unfinished one, and its chained fragments
+  manufacture_packet_and_then_reassemble(MSG_HC_TO_STACK_HCI_ACL, 20,
+                                         small_sample_data);
+
+  EXPECT_EQ(strlen(small_sample_data), data_size_sum);
+  EXPECT_CALL_COUNT(reassembled_callback, 1);
+}
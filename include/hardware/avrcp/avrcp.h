@@ -16,10 +16,14 @@
 
 #pragma once
 
+#include <algorithm>
+#include <iterator>
 #include <set>
 #include <string>
+#include <vector>
 
-#include <base/callback_forward.h>
+#include <base/bind.h>
+#include <base/callback.h>
 
 #include "avrcp_common.h"
 #include "raw_address.h"
@@ -82,7 +86,8 @@ class MediaCallbacks {
 
 // The classes below are used by the JNI and are loaded dynamically with the
 // Bluetooth library. All classes must be pure virtual otherwise a compiler
-// error occurs when trying to link the function implementation.
+// error occurs when trying to link the function implementation. The few
+// default bodies are inline in this header for the same reason.
 
 // MediaInterface defines the class that the AVRCP Service uses in order
 // communicate with the media layer. The media layer will define its own
@@ -127,6 +132,44 @@ class MediaInterface {
   virtual void GetFolderItems(uint16_t player_id, std::string media_id,
                               FolderItemsCallback folder_cb) = 0;
 
+  // Browsing a window of a list: |start_item| and |end_item| are the
+  // inclusive bounds, as the remote device requested them. The callback
+  // gets only the items in the window, the first one being |start_item|.
+  // There are fewer of them when the list ends before |end_item|, and none
+  // when it ends before |start_item|.
+  //
+  // By default these fetch the whole list and slice it, so that media layers
+  // built before they were added keep working. Override them to avoid
+  // building the items outside the window.
+  using NowPlayingRangeCallback =
+      base::Callback<void(std::string, std::vector<SongInfo>)>;
+  virtual void GetNowPlayingListRange(uint32_t start_item, uint32_t end_item,
+                                      NowPlayingRangeCallback now_playing_cb) {
+    auto cb_lambda = [](uint32_t start_item, uint32_t end_item,
+                        NowPlayingRangeCallback cb, std::string curr_media_id,
+                        std::vector<SongInfo> song_list) {
+      cb.Run(curr_media_id, SliceRange(std::move(song_list), start_item,
+                                       end_item));
+    };
+
+    GetNowPlayingList(
+        base::Bind(cb_lambda, start_item, end_item, now_playing_cb));
+  }
+
+  using FolderItemsRangeCallback = base::Callback<void(std::vector<ListItem>)>;
+  virtual void GetFolderItemsRange(uint16_t player_id, std::string media_id,
+                                   uint32_t start_item, uint32_t end_item,
+                                   FolderItemsRangeCallback folder_cb) {
+    auto cb_lambda = [](uint32_t start_item, uint32_t end_item,
+                        FolderItemsRangeCallback cb,
+                        std::vector<ListItem> item_list) {
+      cb.Run(SliceRange(std::move(item_list), start_item, end_item));
+    };
+
+    GetFolderItems(player_id, media_id,
+                   base::Bind(cb_lambda, start_item, end_item, folder_cb));
+  }
+
   using SetBrowsedPlayerCallback = base::Callback<void(
       bool success, std::string root_id, uint32_t num_items)>;
   virtual void SetBrowsedPlayer(uint16_t player_id,
@@ -143,6 +186,17 @@ class MediaInterface {
 
   MediaInterface() = default;
   virtual ~MediaInterface() = default;
+
+ private:
+  // Returns the items of |items| from |start_item| to |end_item| inclusive
+  template <typename T>
+  static std::vector<T> SliceRange(std::vector<T> items, uint32_t start_item,
+                                   uint32_t end_item) {
+    if (start_item >= items.size() || end_item < start_item) return {};
+    size_t last = std::min<size_t>(end_item, items.size() - 1);
+    return std::vector<T>(std::make_move_iterator(items.begin() + start_item),
+                          std::make_move_iterator(items.begin() + last + 1));
+  }
 };
 
 class VolumeInterface {
@@ -305,6 +305,18 @@
 #define BTM_INQ_DB_SIZE 40
 #endif
 
+/* The number of LE devices whose advertising data can be held while waiting
+ * for their scan response or chained packets. */
+#ifndef BTM_BLE_ADV_CACHE_SIZE
+#define BTM_BLE_ADV_CACHE_SIZE 64
+#endif
+
+/* How long, in milliseconds, the advertising data of an LE device is held
+ * waiting for its scan response or chained packets. */
+#ifndef BTM_BLE_ADV_CACHE_TIMEOUT_MS
+#define BTM_BLE_ADV_CACHE_TIMEOUT_MS 2000
+#endif
+
 /* The default scan mode */
 #ifndef BTM_DEFAULT_SCAN_TYPE
 #define BTM_DEFAULT_SCAN_TYPE BTM_SCAN_TYPE_INTERLACED
@@ -580,6 +592,17 @@
 #define L2CAP_ROUND_ROBIN_CHANNEL_SERVICE TRUE
 #endif
 
+/* Bytes a channel of weight 1 sends per round robin turn */
+#ifndef L2CAP_SCHED_QUANTUM
+#define L2CAP_SCHED_QUANTUM 1024
+#endif
+
+/* High priority PDUs sent in a row on a link before a waiting lower priority
+ * channel gets one. 0 for strict priority. */
+#ifndef L2CAP_SCHED_STRICT_BURST
+#define L2CAP_SCHED_STRICT_BURST 15
+#endif
+
 /* used for monitoring eL2CAP data flow */
 #ifndef L2CAP_ERTM_STATS
 #define L2CAP_ERTM_STATS FALSE
@@ -632,6 +655,24 @@
 #define BLE_VND_INCLUDED FALSE
 #endif
 
+/*
+ * Runs advertising packet content filtering and batch scan on the host when
+ * the controller does not offer them through vendor specific extensions.
+ */
+#ifndef BTM_BLE_HOST_SCAN_OFFLOAD
+#define BTM_BLE_HOST_SCAN_OFFLOAD TRUE
+#endif
+
+/* The number of advertising packet content filters run on the host. */
+#ifndef BTM_BLE_HOST_MAX_FILTER
+#define BTM_BLE_HOST_MAX_FILTER 16
+#endif
+
+/* The size in bytes of the batch scan results storage on the host. */
+#ifndef BTM_BLE_HOST_SCAN_RESULTS_STORAGE
+#define BTM_BLE_HOST_SCAN_RESULTS_STORAGE 8192
+#endif
+
 /* The maximum number of simultaneous applications that can register with LE
  * L2CAP. */
 #ifndef BLE_MAX_L2CAP_CLIENTS
@@ -852,6 +893,17 @@
 #define PORT_TX_BUF_CRITICAL_WM 15
 #endif
 
+/* The capacity of the port transmit and receive queues, in number of buffers.
+ * The queues are lock-free rings, so they must hold at least as many buffers
+ * as the critical watermarks above allow. */
+#ifndef PORT_TX_BUF_CAPACITY
+#define PORT_TX_BUF_CAPACITY (2 * PORT_TX_BUF_CRITICAL_WM)
+#endif
+
+#ifndef PORT_RX_BUF_CAPACITY
+#define PORT_RX_BUF_CAPACITY (2 * PORT_RX_BUF_CRITICAL_WM)
+#endif
+
 /* The RFCOMM multiplexer preferred flow control mechanism. */
 #ifndef PORT_FC_DEFAULT
 #define PORT_FC_DEFAULT PORT_FC_CREDIT
@@ -1018,6 +1070,42 @@
 #define AVDT_PROTECT_SIZE 90
 #endif
 
+/* Maximum number of media packets queued per stream while the media channel
+ * is congested. */
+#ifndef AVDT_MEDIA_QUEUE_SIZE
+#define AVDT_MEDIA_QUEUE_SIZE 32
+#endif
+
+/* Media packets queued for longer than this (in ms) would reach the peer
+ * after their play time, and are dropped instead of sent. */
+#ifndef AVDT_MEDIA_QUEUE_MAX_DELAY_MS
+#define AVDT_MEDIA_QUEUE_MAX_DELAY_MS 200
+#endif
+
+/* While the media channel is congested, write confirms are held back once
+ * this many packets are queued, to slow down the application. */
+#ifndef AVDT_MEDIA_QUEUE_PACING_DEPTH
+#define AVDT_MEDIA_QUEUE_PACING_DEPTH (AVDT_MEDIA_QUEUE_SIZE / 2)
+#endif
+
+/******************************************************************************
+ *
+ * A2DP
+ *
+ *****************************************************************************/
+
+/* Length (in ms) of the adaptive bit rate control interval of the A2DP
+ * encoders that do not have their own (SBC and AAC). */
+#ifndef A2DP_ABR_INTERVAL_MS
+#define A2DP_ABR_INTERVAL_MS 1000
+#endif
+
+/* Number of clean control intervals in a row needed to raise the A2DP
+ * encoder bit rate by one step. */
+#ifndef A2DP_ABR_STEP_UP_INTERVALS
+#define A2DP_ABR_STEP_UP_INTERVALS 5
+#endif
+
 /******************************************************************************
  *
  * PAN
@@ -0,0 +1,122 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <base/files/file_util.h>
+#include <base/logging.h>
+#include <benchmark/benchmark.h>
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include "osi/include/config.h"
+
+using ::benchmark::State;
+
+// Bonded devices in the config, each in its own section
+#define NUM_DEVICES 500
+
+namespace {
+
+// A bt_config.conf as btif_storage leaves it: an adapter section, then one
+// section per bonded device with the keys a paired BR/EDR device has.
+class ConfigFile {
+ public:
+  ConfigFile() {
+    CHECK(base::CreateTemporaryFile(&path_));
+    std::string contents =
+        "[Adapter]\nAddress = 00:11:22:33:44:55\nName = phone\n\n";
+    char section[18];
+    for (int i = 0; i < NUM_DEVICES; i++) {
+      snprintf(section, sizeof(section), "aa:bb:cc:dd:%02x:%02x", i >> 8,
+               i & 0xff);
+      sections_.push_back(section);
+      contents += "[" + sections_.back() + "]\n";
+      contents += "Timestamp = 1546300800\n";
+      contents += "DevClass = 2360324\n";
+      contents += "DevType = 1\n";
+      contents += "AddrType = 0\n";
+      contents += "Name = Headset " + std::to_string(i) + "\n";
+      contents += "Manufacturer = 15\n";
+      contents += "LmpVer = 8\n";
+      contents += "LmpSubVer = 4386\n";
+      contents += "Service = 0000110b-0000-1000-8000-00805f9b34fb "
+                  "0000110e-0000-1000-8000-00805f9b34fb\n";
+      contents += "LinkKeyType = 5\n";
+      contents += "PinLength = 0\n";
+      contents += "LinkKey = 0123456789abcdef0123456789abcdef\n\n";
+    }
+    CHECK(base::WriteFile(path_, contents.data(), contents.size()) ==
+          static_cast<int>(contents.size()));
+  }
+
+  ~ConfigFile() { base::DeleteFile(path_, false); }
+
+  std::string path() const { return path_.value(); }
+  const std::vector<std::string>& sections() const { return sections_; }
+
+ private:
+  base::FilePath path_;
+  std::vector<std::string> sections_;
+};
+
+ConfigFile& GetConfigFile() {
+  static ConfigFile* file = new ConfigFile();
+  return *file;
+}
+
+}  // namespace
+
+static void BM_ConfigLoad(State& state) {
+  std::string path = GetConfigFile().path();
+  for (auto _ : state) {
+    std::unique_ptr<config_t> config = config_new(path.c_str());
+    benchmark::DoNotOptimize(config.get());
+  }
+  state.SetItemsProcessed(state.iterations() * NUM_DEVICES);
+}
+
+BENCHMARK(BM_ConfigLoad);
+
+// The lookups btif_storage_load_bonded_devices() makes for each device
+static void BM_ConfigQueryBondedDevices(State& state) {
+  ConfigFile& file = GetConfigFile();
+  std::unique_ptr<config_t> config = config_new(file.path().c_str());
+  std::vector<const char*> sections;
+  for (const std::string& section : file.sections())
+    sections.push_back(section.c_str());
+
+  for (auto _ : state) {
+    int found = 0;
+    for (const char* name : sections) {
+      if (!config_has_key(*config, name, "LinkKey")) continue;
+      found += config_get_int(*config, name, "LinkKeyType", -1);
+      found += config_get_int(*config, name, "DevClass", 0);
+      found += config_get_int(*config, name, "PinLength", 0);
+      found += config_get_int(*config, name, "DevType", 0);
+      found += config_get_int(*config, name, "AddrType", 0);
+      found += config_get_string(*config, name, "LinkKey", nullptr)->size();
+      found += config_get_string(*config, name, "Name", nullptr)->size();
+      found += config_get_string(*config, name, "Service", nullptr)->size();
+      found += config_has_key(*config, name, "LE_KEY_PENC");
+      found += config_has_key(*config, name, "LE_KEY_PID");
+    }
+    benchmark::DoNotOptimize(found);
+  }
+  state.SetItemsProcessed(state.iterations() * NUM_DEVICES);
+}
+
+BENCHMARK(BM_ConfigQueryBondedDevices);
@@ -15,18 +15,28 @@
 //   empty sections.
 // - Duplicate keys in a section will overwrite previous values.
 // - All strings are case sensitive.
+// - Sections and keys are found through hash indexes, so lookups do not
+//   depend on the size of the config. Sections and entries are kept in the
+//   order they were added, which is the order |config_save| writes them in.
+// - Lookups take |std::string_view|, so callers passing string literals do
+//   not build a |std::string| for each lookup.
 
 #include <stdbool.h>
+#include <forward_list>
 #include <list>
 #include <memory>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
 
 // The default section name to use if a key/value pair is not defined within
 // a section.
 #define CONFIG_DEFAULT_SECTION "Global"
 
 struct entry_t {
-  std::string key;
+  // Interned in the config_t that holds the entry
+  std::string_view key;
   std::string value;
 };
 
@@ -35,8 +45,44 @@ struct section_t {
   std::list<entry_t> entries;
 };
 
+// Identifies an entry in config_t::entry_index: its section and its key.
+struct config_entry_id_t {
+  const section_t* section;
+  std::string_view key;
+
+  bool operator==(const config_entry_id_t& other) const {
+    return section == other.section && key == other.key;
+  }
+};
+
+struct config_entry_id_hash_t {
+  size_t operator()(const config_entry_id_t& id) const {
+    return std::hash<std::string_view>()(id.key) ^
+           (std::hash<const section_t*>()(id.section) * 31);
+  }
+};
+
 struct config_t {
+  config_t() = default;
+  // The indexes point into |sections|, so a copy would point into the
+  // original; use |config_new_clone| instead.
+  config_t(const config_t&) = delete;
+  config_t& operator=(const config_t&) = delete;
+
+  // Read-only outside of this module: sections and entries must be added and
+  // removed through the functions below, which keep the indexes up to date.
   std::list<section_t> sections;
+
+  std::unordered_map<std::string_view, std::list<section_t>::iterator>
+      section_index;
+  std::unordered_map<config_entry_id_t, std::list<entry_t>::iterator,
+                     config_entry_id_hash_t>
+      entry_index;
+
+  // Every key used in this config, once. Most keys are repeated in every
+  // device section.
+  std::unordered_set<std::string_view> keys;
+  std::forward_list<std::string> key_storage;
 };
 
 // Creates a new config object with no entries (i.e. not backed by a file).
@@ -61,73 +107,73 @@ std::unique_ptr<config_t> config_new_clone(const config_t& src);
 
 // Returns true if the config file contains a section named |section|. If
 // the section has no key/value pairs in it, this function will return false.
-bool config_has_section(const config_t& config, const std::string& section);
+bool config_has_section(const config_t& config, std::string_view section);
 
 // Returns true if the config file has a key named |key| under |section|.
 // Returns false otherwise.
-bool config_has_key(const config_t& config, const std::string& section,
-                    const std::string& key);
+bool config_has_key(const config_t& config, std::string_view section,
+                    std::string_view key);
 
 // Returns the integral value for a given |key| in |section|. If |section|
 // or |key| do not exist, or the value cannot be fully converted to an integer,
 // this function returns |def_value|.
-int config_get_int(const config_t& config, const std::string& section,
-                   const std::string& key, int def_value);
+int config_get_int(const config_t& config, std::string_view section,
+                   std::string_view key, int def_value);
 
 // Returns the uint64_t value for a given |key| in |section|. If |section|
 // or |key| do not exist, or the value cannot be fully converted to an integer,
 // this function returns |def_value|.
-uint64_t config_get_uint64(const config_t& config, const std::string& section,
-                           const std::string& key, uint64_t def_value);
+uint64_t config_get_uint64(const config_t& config, std::string_view section,
+                           std::string_view key, uint64_t def_value);
 
 // Returns the boolean value for a given |key| in |section|. If |section|
 // or |key| do not exist, or the value cannot be converted to a boolean, this
 // function returns |def_value|.
-bool config_get_bool(const config_t& config, const std::string& section,
-                     const std::string& key, bool def_value);
+bool config_get_bool(const config_t& config, std::string_view section,
+                     std::string_view key, bool def_value);
 
 // Returns the string value for a given |key| in |section|. If |section| or
 // |key| do not exist, this function returns |def_value|. The returned string
 // is owned by the config module and must not be freed or modified. |def_value|
 // may be NULL.
 const std::string* config_get_string(const config_t& config,
-                                     const std::string& section,
-                                     const std::string& key,
+                                     std::string_view section,
+                                     std::string_view key,
                                      const std::string* def_value);
 
 // Sets an integral value for the |key| in |section|. If |key| or |section| do
 // not already exist, this function creates them. |config| must not be NULL.
-void config_set_int(config_t* config, const std::string& section,
-                    const std::string& key, int value);
+void config_set_int(config_t* config, std::string_view section,
+                    std::string_view key, int value);
 
 // Sets a uint64_t value for the |key| in |section|. If |key| or |section| do
 // not already exist, this function creates them. |config| must not be NULL.
-void config_set_uint64(config_t* config, const std::string& section,
-                       const std::string& key, uint64_t value);
+void config_set_uint64(config_t* config, std::string_view section,
+                       std::string_view key, uint64_t value);
 
 // Sets a boolean value for the |key| in |section|. If |key| or |section| do
 // not already exist, this function creates them. |config| must not be NULL.
-void config_set_bool(config_t* config, const std::string& section,
-                     const std::string& key, bool value);
+void config_set_bool(config_t* config, std::string_view section,
+                     std::string_view key, bool value);
 
 // Sets a string value for the |key| in |section|. If |key| or |section| do
 // not already exist, this function creates them. |config| must not be NULL.
-void config_set_string(config_t* config, const std::string& section,
-                       const std::string& key, const std::string& value);
+void config_set_string(config_t* config, std::string_view section,
+                       std::string_view key, const std::string& value);
 
 // Removes |section| from the |config| (and, as a result, all keys in the
 // section).
 // Returns true if |section| was found and removed from |config|, false
 // otherwise.
 // |config| may be NULL.
-bool config_remove_section(config_t* config, const std::string& section);
+bool config_remove_section(config_t* config, std::string_view section);
 
 // Removes one specific |key| residing in |section| of the |config|. Returns
 // true
 // if the section and key were found and the key was removed, false otherwise.
 // |config|may not be NULL.
-bool config_remove_key(config_t* config, const std::string& section,
-                       const std::string& key);
+bool config_remove_key(config_t* config, std::string_view section,
+                       std::string_view key);
 
 // Saves |config| to a file given by |filename|. Note that this could be a
 // destructive operation: if |filename| already exists, it will be overwritten.
@@ -137,6 +183,16 @@ bool config_remove_key(config_t* config, const std::string& section,
 // be lost. Neither |config| nor |filename| may be NULL.
 bool config_save(const config_t& config, const std::string& filename);
 
+// Returns |config| in the format that |config_save| writes.
+std::string config_serialize(const config_t& config);
+
+// Saves |serialized|, as returned by |config_serialize|, to a file given by
+// |filename|, in the same way as |config_save|. This lets a caller that
+// needs the file's contents, e.g. to checksum them, serialize |config| only
+// once.
+bool config_save_serialized(const std::string& serialized,
+                            const std::string& filename);
+
 // Saves the encrypted |checksum| of config file to a given |filename| Note
 // that this could be a destructive operation: if |filename| already exists,
 // it will be overwritten.
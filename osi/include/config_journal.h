@@ -0,0 +1,68 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+// This module implements an append-only journal of changes to a config_t.
+// Persisting a change is an append of a few bytes to the journal file,
+// rather than a rewrite of the whole config file; the journal is replayed
+// on top of the config file it was started from when the config is next
+// loaded.
+//
+// Each record carries its own checksum, so a record torn by a crash during
+// an append is detected and it, and anything after it, is ignored.
+//
+// Record layout, in host byte order:
+//   uint32_t  length of the body
+//   uint32_t  CRC-32 of the body
+//   body:
+//     uint8_t   CONFIG_JOURNAL_SET or CONFIG_JOURNAL_REMOVE
+//     uint16_t  section length, then the section
+//     uint16_t  key length, then the key
+//     uint32_t  value length, then the value (CONFIG_JOURNAL_SET only)
+
+#include <stddef.h>
+#include <string>
+#include <string_view>
+
+#include "osi/include/config.h"
+
+#define CONFIG_JOURNAL_SET 'S'
+#define CONFIG_JOURNAL_REMOVE 'R'
+
+// Appends to |journal| a record that sets |key| in |section| to |value|.
+// Returns false, and appends nothing, if the record would be too long to
+// replay; the change then has to be saved some other way.
+bool config_journal_set(std::string* journal, std::string_view section,
+                        std::string_view key, const std::string& value);
+
+// Appends to |journal| a record that removes |key| from |section|. Returns
+// false, and appends nothing, if the record would be too long to replay.
+bool config_journal_remove(std::string* journal, std::string_view section,
+                           std::string_view key);
+
+// Applies the records in |journal| to |config|, oldest first. Stops at the
+// first record that is incomplete or does not match its checksum, and
+// returns the length of |journal| up to that record.
+size_t config_journal_replay(const std::string& journal, config_t* config);
+
+// Appends |records| to the journal file |filename|, creating it if needed,
+// and syncs it to disk, along with the directory entry of a new file.
+// Returns false if the records could not all be written.
+bool config_journal_append(const std::string& records,
+                           const std::string& filename);
@@ -30,12 +30,42 @@ typedef struct reactor_t reactor_t;
 typedef void (*fixed_queue_free_cb)(void* data);
 typedef void (*fixed_queue_cb)(fixed_queue_t* queue, void* context);
 
+// Storage backend of a fixed queue, selected when the queue is created.
+typedef enum {
+  // Mutex-protected |list_t| with a pair of counting semaphores. Supports the
+  // whole API and any number of producers and consumers.
+  FIXED_QUEUE_MODE_LIST,
+  // Bounded lock-free ring for exactly one producer thread and one consumer
+  // thread.
+  FIXED_QUEUE_MODE_SPSC,
+  // Bounded lock-free ring for any number of producer threads. Only one
+  // thread may block in |fixed_queue_dequeue| or be registered with a
+  // reactor, but non-blocking dequeues (e.g. flushes) are safe from any
+  // thread.
+  FIXED_QUEUE_MODE_MPSC,
+} fixed_queue_mode_t;
+
+// Largest |capacity| accepted for the ring backed modes.
+#define FIXED_QUEUE_RING_MAX_CAPACITY (1u << 20)
+
 // Creates a new fixed queue with the given |capacity|. If more elements than
 // |capacity| are added to the queue, the caller is blocked until space is
 // made available in the queue. Returns NULL on failure. The caller must free
 // the returned queue with |fixed_queue_free|.
 fixed_queue_t* fixed_queue_new(size_t capacity);
 
+// Creates a new fixed queue with the given |capacity| and storage |mode|.
+// For the ring backed modes (|FIXED_QUEUE_MODE_SPSC| and
+// |FIXED_QUEUE_MODE_MPSC|) |capacity| must be between 1 and
+// |FIXED_QUEUE_RING_MAX_CAPACITY|, enqueue and dequeue take no lock and make
+// no allocation, and the dequeue file descriptor is only signalled when the
+// queue goes from empty to non-empty. Ring backed queues do not support
+// |fixed_queue_try_remove_from_queue|, |fixed_queue_get_list| or
+// |fixed_queue_get_enqueue_fd|. Returns NULL on failure. The caller must free
+// the returned queue with |fixed_queue_free|.
+fixed_queue_t* fixed_queue_new_with_mode(size_t capacity,
+                                         fixed_queue_mode_t mode);
+
 // Frees a queue and (optionally) the enqueued elements.
 // |queue| is the queue to free. If the |free_cb| callback is not null,
 // it is called on each queue element to free it.
@@ -83,12 +113,14 @@ void* fixed_queue_try_dequeue(fixed_queue_t* queue);
 
 // Returns the first element from |queue|, if present, without dequeuing it.
 // This function will never block the caller. Returns NULL if there are no
-// elements in the queue or |queue| is NULL.
+// elements in the queue or |queue| is NULL. For ring backed queues this must
+// be called from the consumer side.
 void* fixed_queue_try_peek_first(fixed_queue_t* queue);
 
 // Returns the last element from |queue|, if present, without dequeuing it.
 // This function will never block the caller. Returns NULL if there are no
-// elements in the queue or |queue| is NULL.
+// elements in the queue or |queue| is NULL. For ring backed queues this must
+// be called from the producer side.
 void* fixed_queue_try_peek_last(fixed_queue_t* queue);
 
 // Tries to remove a |data| element from the middle of the |queue|. This
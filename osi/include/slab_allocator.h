@@ -0,0 +1,56 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Slab allocator backing |osi_malloc| and |osi_calloc| for packet sized
+// buffers. Blocks are carved from one reserved region per size class, and
+// every thread keeps a small magazine of free blocks per size class so that
+// the common allocate/free cycle takes no lock. The size classes follow the
+// buffer sizes in bt_target.h (BT_SMALL_BUFFER_SIZE, BT_DEFAULT_BUFFER_SIZE
+// and the L2CAP FCR buffer sizes).
+
+// Initializes the slab allocator and starts serving |osi_malloc| and
+// |osi_calloc| requests that fit a size class. If |canary_mode| is true, each
+// block is guarded by canaries that are checked when it is freed. Unlike the
+// allocation tracker this does not take a global lock. This function is
+// idempotent; |canary_mode| is only taken into account on the first call.
+void slab_allocator_init(bool canary_mode);
+
+// Stops serving new allocations from the slab allocator. Blocks that are
+// still allocated remain valid and can be freed with |osi_free|. Test
+// function only. Do not call in the normal course of operations.
+void slab_allocator_uninit(void);
+
+// Allocates a block of at least |size| bytes, zeroed if |zero| is true.
+// Returns NULL if the slab allocator is not initialized, |size| does not fit
+// any size class, or the size class is exhausted. The caller should then
+// fall back to the regular heap.
+void* slab_allocator_alloc(size_t size, bool zero);
+
+// Returns true if |ptr| was returned by |slab_allocator_alloc|.
+bool slab_allocator_owns(const void* ptr);
+
+// Frees a block returned by |slab_allocator_alloc|. |ptr| may not be NULL.
+void slab_allocator_free(void* ptr);
+
+// Dumps per size class statistics to the |fd| file descriptor.
+void slab_allocator_debug_dump(int fd);
@@ -36,11 +36,13 @@
 
 #include <hardware/bluetooth.h>
 
+#include <algorithm>
+#include <atomic>
 #include <mutex>
+#include <vector>
 
 #include "osi/include/allocator.h"
 #include "osi/include/fixed_queue.h"
-#include "osi/include/list.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
 #include "osi/include/semaphore.h"
@@ -105,8 +107,47 @@ struct alarm_t {
 
   bool for_msg_loop;  // True, if the alarm should be processed on message loop
   CancelableClosureInStruct closure;  // posted to message loop for processing
+
+  // Timer wheel linkage, protected by the mutex of the alarm's shard.
+  alarm_t* wheel_prev;
+  alarm_t* wheel_next;
+  int wheel_level;     // TIMER_WHEEL_NONE if the alarm is not in the wheel
+  int wheel_slot;
+  uint64_t wheel_key;  // Deadline used for wheel placement
+  uint64_t sequence;   // Orders alarms with equal deadlines by set order
 };
 
+// Pending alarms are kept in a hierarchical timing wheel so that setting and
+// cancelling an alarm is O(1) regardless of how many alarms are live. Level L
+// has |TIMER_WHEEL_SLOTS| slots of 64^L ms each; an alarm sits at the lowest
+// level whose next-higher block it shares with the wheel's base time.
+// Deadlines too far out for the top level go on the overflow list. Entries
+// cascade down to lower levels as the base time advances.
+static const int TIMER_WHEEL_BITS = 6;
+static const int TIMER_WHEEL_SLOTS = 1 << TIMER_WHEEL_BITS;
+static const int TIMER_WHEEL_LEVELS = 4;
+static const int TIMER_WHEEL_OVERFLOW = TIMER_WHEEL_LEVELS;
+static const int TIMER_WHEEL_NONE = -1;
+static const uint64_t NO_DEADLINE = UINT64_MAX;
+
+// Alarms are spread across |ALARM_SHARD_COUNT| independently locked wheels,
+// chosen by the alarm's address, so that setting or cancelling one alarm does
+// not contend with callbacks for alarms on other shards.
+static const int ALARM_SHARD_BITS = 3;
+static const int ALARM_SHARD_COUNT = 1 << ALARM_SHARD_BITS;
+
+typedef struct {
+  std::mutex mutex;
+  uint64_t base_ms;  // All alarms in the wheel have |wheel_key| > |base_ms|
+  uint64_t occupied[TIMER_WHEEL_LEVELS];  // Bitmap of non-empty slots
+  alarm_t* slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+  alarm_t* overflow;
+  size_t count;
+  // Earliest wheel key in this shard, or |NO_DEADLINE|. Written with |mutex|
+  // held, read without it by |reschedule_root_alarm|.
+  std::atomic<uint64_t> next_deadline_ms;
+} alarm_shard_t;
+
 // If the next wakeup time is less than this threshold, we should acquire
 // a wakelock instead of setting a wake alarm so we're not bouncing in
 // and out of suspend frequently. This value is externally visible to allow
@@ -114,11 +155,15 @@ struct alarm_t {
 int64_t TIMER_INTERVAL_FOR_WAKELOCK_IN_MS = 3000;
 static const clockid_t CLOCK_ID = CLOCK_BOOTTIME;
 
-// This mutex ensures that the |alarm_set|, |alarm_cancel|, and alarm callback
-// functions execute serially and not concurrently. As a result, this mutex
-// also protects the |alarms| list.
-static std::mutex alarms_mutex;
-static list_t* alarms;
+// Each shard mutex ensures that |alarm_set|, |alarm_cancel|, and the alarm
+// callback functions execute serially for the alarms on that shard. The
+// dispatcher thread holds all of them while it collects expired alarms.
+static alarm_shard_t* shards;
+static std::atomic<uint64_t> alarm_sequence;
+
+// Protects |timer|, |wakeup_timer|, |timer_set| and the wakelock. Never
+// acquired while holding a shard mutex.
+static std::mutex timer_mutex;
 static timer_t timer;
 static timer_t wakeup_timer;
 static bool timer_set;
@@ -138,9 +183,9 @@ static uint64_t now_ms(void);
 static void alarm_set_internal(alarm_t* alarm, uint64_t period_ms,
                                alarm_callback_t cb, void* data,
                                fixed_queue_t* queue, bool for_msg_loop);
-static void alarm_cancel_internal(alarm_t* alarm);
-static void remove_pending_alarm(alarm_t* alarm);
-static void schedule_next_instance(alarm_t* alarm);
+static bool alarm_cancel_internal(alarm_shard_t* shard, alarm_t* alarm);
+static void remove_pending_alarm(alarm_shard_t* shard, alarm_t* alarm);
+static void schedule_next_instance(alarm_shard_t* shard, alarm_t* alarm);
 static void reschedule_root_alarm(void);
 static void alarm_queue_ready(fixed_queue_t* queue, void* context);
 static void timer_callback(void* data);
@@ -153,6 +198,167 @@ static void update_scheduling_stats(alarm_stats_t* stats, uint64_t now_ms,
 static void alarm_register_processing_queue(fixed_queue_t* queue,
                                             thread_t* thread);
 
+static alarm_shard_t* shard_for(const alarm_t* alarm) {
+  // Fibonacci hashing; allocator size classes leave the low bits constant.
+  uint64_t hash = reinterpret_cast<uintptr_t>(alarm) * 0x9E3779B97F4A7C15ULL;
+  return &shards[hash >> (64 - ALARM_SHARD_BITS)];
+}
+
+static void wheel_link(alarm_shard_t* shard, alarm_t* alarm) {
+  uint64_t key = std::max(alarm->deadline_ms, shard->base_ms + 1);
+  alarm_t** head = &shard->overflow;
+
+  alarm->wheel_key = key;
+  alarm->wheel_level = TIMER_WHEEL_OVERFLOW;
+  for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+    int shift = TIMER_WHEEL_BITS * (level + 1);
+    if ((key >> shift) != (shard->base_ms >> shift)) continue;
+
+    int slot = (key >> (shift - TIMER_WHEEL_BITS)) & (TIMER_WHEEL_SLOTS - 1);
+    alarm->wheel_level = level;
+    alarm->wheel_slot = slot;
+    shard->occupied[level] |= 1ULL << slot;
+    head = &shard->slots[level][slot];
+    break;
+  }
+
+  alarm->wheel_prev = NULL;
+  alarm->wheel_next = *head;
+  if (*head) (*head)->wheel_prev = alarm;
+  *head = alarm;
+  shard->count++;
+}
+
+static void wheel_unlink(alarm_shard_t* shard, alarm_t* alarm) {
+  if (alarm->wheel_level == TIMER_WHEEL_NONE) return;
+
+  int level = alarm->wheel_level;
+  alarm_t** head = (level == TIMER_WHEEL_OVERFLOW)
+                       ? &shard->overflow
+                       : &shard->slots[level][alarm->wheel_slot];
+
+  if (alarm->wheel_prev)
+    alarm->wheel_prev->wheel_next = alarm->wheel_next;
+  else
+    *head = alarm->wheel_next;
+  if (alarm->wheel_next) alarm->wheel_next->wheel_prev = alarm->wheel_prev;
+
+  if (*head == NULL && level != TIMER_WHEEL_OVERFLOW)
+    shard->occupied[level] &= ~(1ULL << alarm->wheel_slot);
+
+  alarm->wheel_prev = NULL;
+  alarm->wheel_next = NULL;
+  alarm->wheel_level = TIMER_WHEEL_NONE;
+  shard->count--;
+}
+
+// Unlinks every alarm in the slots of |level| selected by |mask| and appends
+// it to |out|.
+static void wheel_take_slots(alarm_shard_t* shard, int level, uint64_t mask,
+                             std::vector<alarm_t*>* out) {
+  mask &= shard->occupied[level];
+  while (mask) {
+    int slot = __builtin_ctzll(mask);
+    mask &= mask - 1;
+    while (shard->slots[level][slot]) {
+      alarm_t* alarm = shard->slots[level][slot];
+      wheel_unlink(shard, alarm);
+      out->push_back(alarm);
+    }
+  }
+}
+
+// Moves the base time of |shard| forward to |now|. Alarms whose key is at or
+// before |now| are removed and appended to |expired|; alarms in slots that
+// |now| has moved into are cascaded down to the level they now belong to.
+static void wheel_advance(alarm_shard_t* shard, uint64_t now,
+                          std::vector<alarm_t*>* expired) {
+  if (now <= shard->base_ms) return;
+
+  uint64_t old_base = shard->base_ms;
+  std::vector<alarm_t*> stale;
+
+  for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+    if (shard->occupied[level] == 0) continue;
+
+    int shift = TIMER_WHEEL_BITS * level;
+    if ((now >> (shift + TIMER_WHEEL_BITS)) !=
+        (old_base >> (shift + TIMER_WHEEL_BITS))) {
+      wheel_take_slots(shard, level, ~0ULL, &stale);
+      continue;
+    }
+
+    int first = ((old_base >> shift) & (TIMER_WHEEL_SLOTS - 1)) + 1;
+    int last = (now >> shift) & (TIMER_WHEEL_SLOTS - 1);
+    if (first > last) continue;
+
+    uint64_t mask = (last == TIMER_WHEEL_SLOTS - 1) ? ~0ULL
+                                                    : (1ULL << (last + 1)) - 1;
+    mask &= ~((1ULL << first) - 1);
+    wheel_take_slots(shard, level, mask, &stale);
+  }
+
+  const int overflow_shift = TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS;
+  if ((now >> overflow_shift) != (old_base >> overflow_shift)) {
+    while (shard->overflow) {
+      alarm_t* alarm = shard->overflow;
+      wheel_unlink(shard, alarm);
+      stale.push_back(alarm);
+    }
+  }
+
+  shard->base_ms = now;
+  for (alarm_t* alarm : stale) {
+    if (alarm->wheel_key <= now)
+      expired->push_back(alarm);
+    else
+      wheel_link(shard, alarm);
+  }
+}
+
+// Returns the earliest wheel key in |shard|, or |NO_DEADLINE| if it is empty.
+static uint64_t wheel_next_key(const alarm_shard_t* shard) {
+  const alarm_t* list = shard->overflow;
+
+  for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+    if (shard->occupied[level] == 0) continue;
+
+    int slot = __builtin_ctzll(shard->occupied[level]);
+    if (level == 0) {
+      return ((shard->base_ms >> TIMER_WHEEL_BITS) << TIMER_WHEEL_BITS) | slot;
+    }
+    list = shard->slots[level][slot];
+    break;
+  }
+
+  uint64_t next = NO_DEADLINE;
+  for (; list != NULL; list = list->wheel_next)
+    next = std::min(next, list->wheel_key);
+  return next;
+}
+
+static void wheel_collect(const alarm_shard_t* shard,
+                          std::vector<alarm_t*>* out) {
+  for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+    for (int slot = 0; slot < TIMER_WHEEL_SLOTS; slot++) {
+      for (alarm_t* alarm = shard->slots[level][slot]; alarm != NULL;
+           alarm = alarm->wheel_next)
+        out->push_back(alarm);
+    }
+  }
+  for (alarm_t* alarm = shard->overflow; alarm != NULL;
+       alarm = alarm->wheel_next)
+    out->push_back(alarm);
+}
+
+// Recomputes the earliest deadline of |shard|. Returns true if it changed, in
+// which case the caller must call |reschedule_root_alarm| once it has
+// released the shard mutex.
+static bool shard_update_next_deadline(alarm_shard_t* shard) {
+  uint64_t next = wheel_next_key(shard);
+  return shard->next_deadline_ms.exchange(next) != next;
+}
+
 static void update_stat(stat_t* stat, uint64_t delta_ms) {
   if (stat->max_ms < delta_ms) stat->max_ms = delta_ms;
   stat->total_ms += delta_ms;
@@ -166,8 +372,8 @@ alarm_t* alarm_new_periodic(const char* name) {
 }
 
 static alarm_t* alarm_new_internal(const char* name, bool is_periodic) {
-  // Make sure we have a list we can insert alarms into.
-  if (!alarms && !lazy_initialize()) {
+  // Make sure we have a wheel we can insert alarms into.
+  if (!shards && !lazy_initialize()) {
     CHECK(false);  // if initialization failed, we should not continue
     return NULL;
   }
@@ -182,6 +388,7 @@ static alarm_t* alarm_new_internal(const char* name, bool is_periodic) {
   ret->for_msg_loop = false;
   // placement new
   new (&ret->closure) CancelableClosureInStruct();
+  ret->wheel_level = TIMER_WHEEL_NONE;
 
   // NOTE: The stats were reset by osi_calloc() above
 
@@ -203,7 +410,7 @@ uint64_t alarm_get_remaining_ms(const alarm_t* alarm) {
   uint64_t remaining_ms = 0;
   uint64_t just_now_ms = now_ms();
 
-  std::lock_guard<std::mutex> lock(alarms_mutex);
+  std::lock_guard<std::mutex> lock(shard_for(alarm)->mutex);
   if (alarm->deadline_ms > just_now_ms)
     remaining_ms = alarm->deadline_ms - just_now_ms;
 
@@ -221,49 +428,59 @@ void alarm_set_on_mloop(alarm_t* alarm, uint64_t interval_ms,
   alarm_set_internal(alarm, interval_ms, cb, data, NULL, true);
 }
 
-// Runs in exclusion with alarm_cancel and timer_callback.
+// Runs in exclusion with alarm_cancel and timer_callback for alarms on the
+// same shard.
 static void alarm_set_internal(alarm_t* alarm, uint64_t period_ms,
                                alarm_callback_t cb, void* data,
                                fixed_queue_t* queue, bool for_msg_loop) {
-  CHECK(alarms != NULL);
+  CHECK(shards != NULL);
   CHECK(alarm != NULL);
   CHECK(cb != NULL);
 
-  std::lock_guard<std::mutex> lock(alarms_mutex);
-
-  alarm->creation_time_ms = now_ms();
-  alarm->period_ms = period_ms;
-  alarm->queue = queue;
-  alarm->callback = cb;
-  alarm->data = data;
-  alarm->for_msg_loop = for_msg_loop;
+  alarm_shard_t* shard = shard_for(alarm);
+  bool needs_reschedule;
+  {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+
+    alarm->creation_time_ms = now_ms();
+    alarm->period_ms = period_ms;
+    alarm->queue = queue;
+    alarm->callback = cb;
+    alarm->data = data;
+    alarm->for_msg_loop = for_msg_loop;
+
+    schedule_next_instance(shard, alarm);
+    alarm->stats.scheduled_count++;
+    needs_reschedule = shard_update_next_deadline(shard);
+  }
 
-  schedule_next_instance(alarm);
-  alarm->stats.scheduled_count++;
+  if (needs_reschedule) reschedule_root_alarm();
 }
 
 void alarm_cancel(alarm_t* alarm) {
-  CHECK(alarms != NULL);
+  CHECK(shards != NULL);
   if (!alarm) return;
 
+  alarm_shard_t* shard = shard_for(alarm);
   std::shared_ptr<std::recursive_mutex> local_mutex_ref;
+  bool needs_reschedule;
   {
-    std::lock_guard<std::mutex> lock(alarms_mutex);
+    std::lock_guard<std::mutex> lock(shard->mutex);
     local_mutex_ref = alarm->callback_mutex;
-    alarm_cancel_internal(alarm);
+    needs_reschedule = alarm_cancel_internal(shard, alarm);
   }
 
+  if (needs_reschedule) reschedule_root_alarm();
+
   // If the callback for |alarm| is in progress, wait here until it completes.
   std::lock_guard<std::recursive_mutex> lock(*local_mutex_ref);
 }
 
-// Internal implementation of canceling an alarm.
-// The caller must hold the |alarms_mutex|
-static void alarm_cancel_internal(alarm_t* alarm) {
-  bool needs_reschedule =
-      (!list_is_empty(alarms) && list_front(alarms) == alarm);
-
-  remove_pending_alarm(alarm);
+// Internal implementation of canceling an alarm. Returns true if the root
+// alarm needs to be rescheduled.
+// The caller must hold the mutex of |shard|
+static bool alarm_cancel_internal(alarm_shard_t* shard, alarm_t* alarm) {
+  remove_pending_alarm(shard, alarm);
 
   alarm->deadline_ms = 0;
   alarm->prev_deadline_ms = 0;
@@ -272,24 +489,24 @@ static void alarm_cancel_internal(alarm_t* alarm) {
   alarm->stats.canceled_count++;
   alarm->queue = NULL;
 
-  if (needs_reschedule) reschedule_root_alarm();
+  return shard_update_next_deadline(shard);
 }
 
 bool alarm_is_scheduled(const alarm_t* alarm) {
-  if ((alarms == NULL) || (alarm == NULL)) return false;
+  if ((shards == NULL) || (alarm == NULL)) return false;
   return (alarm->callback != NULL);
 }
 
 void alarm_cleanup(void) {
   // If lazy_initialize never ran there is nothing else to do
-  if (!alarms) return;
+  if (!shards) return;
 
   dispatcher_thread_active = false;
   semaphore_post(alarm_expired);
   thread_free(dispatcher_thread);
   dispatcher_thread = NULL;
 
-  std::lock_guard<std::mutex> lock(alarms_mutex);
+  std::lock_guard<std::mutex> lock(timer_mutex);
 
   fixed_queue_free(default_callback_queue, NULL);
   default_callback_queue = NULL;
@@ -301,24 +518,24 @@ void alarm_cleanup(void) {
   semaphore_free(alarm_expired);
   alarm_expired = NULL;
 
-  list_free(alarms);
-  alarms = NULL;
+  delete[] shards;
+  shards = NULL;
 }
 
 static bool lazy_initialize(void) {
-  CHECK(alarms == NULL);
+  CHECK(shards == NULL);
 
   // timer_t doesn't have an invalid value so we must track whether
   // the |timer| variable is valid ourselves.
   bool timer_initialized = false;
   bool wakeup_timer_initialized = false;
 
-  std::lock_guard<std::mutex> lock(alarms_mutex);
+  std::lock_guard<std::mutex> lock(timer_mutex);
 
-  alarms = list_new(NULL);
-  if (!alarms) {
-    LOG_ERROR(LOG_TAG, "%s unable to allocate alarm list.", __func__);
-    goto error;
+  shards = new alarm_shard_t[ALARM_SHARD_COUNT]();
+  for (int i = 0; i < ALARM_SHARD_COUNT; i++) {
+    shards[i].base_ms = now_ms();
+    shards[i].next_deadline_ms = NO_DEADLINE;
   }
 
   if (!timer_create_internal(CLOCK_ID, &timer)) goto error;
@@ -382,15 +599,13 @@ error:
 
   if (timer_initialized) timer_delete(timer);
 
-  list_free(alarms);
-  alarms = NULL;
+  delete[] shards;
+  shards = NULL;
 
   return false;
 }
 
 static uint64_t now_ms(void) {
-  CHECK(alarms != NULL);
-
   struct timespec ts;
   if (clock_gettime(CLOCK_ID, &ts) == -1) {
     LOG_ERROR(LOG_TAG, "%s unable to get current time: %s", __func__,
@@ -401,10 +616,10 @@ static uint64_t now_ms(void) {
   return (ts.tv_sec * 1000LL) + (ts.tv_nsec / 1000000LL);
 }
 
-// Remove alarm from internal alarm list and the processing queue
-// The caller must hold the |alarms_mutex|
-static void remove_pending_alarm(alarm_t* alarm) {
-  list_remove(alarms, alarm);
+// Remove alarm from the timer wheel and the processing queue
+// The caller must hold the mutex of |shard|
+static void remove_pending_alarm(alarm_shard_t* shard, alarm_t* alarm) {
+  wheel_unlink(shard, alarm);
 
   if (alarm->for_msg_loop) {
     alarm->closure.i.Cancel();
@@ -417,13 +632,10 @@ static void remove_pending_alarm(alarm_t* alarm) {
   }
 }
 
-// Must be called with |alarms_mutex| held
-static void schedule_next_instance(alarm_t* alarm) {
-  // If the alarm is currently set and it's at the start of the list,
-  // we'll need to re-schedule since we've adjusted the earliest deadline.
-  bool needs_reschedule =
-      (!list_is_empty(alarms) && list_front(alarms) == alarm);
-  if (alarm->callback) remove_pending_alarm(alarm);
+// Must be called with the mutex of |shard| held. The caller is responsible
+// for updating the shard's next deadline afterwards.
+static void schedule_next_instance(alarm_shard_t* shard, alarm_t* alarm) {
+  if (alarm->callback) remove_pending_alarm(shard, alarm);
 
   // Calculate the next deadline for this alarm
   uint64_t just_now_ms = now_ms();
@@ -432,47 +644,36 @@ static void schedule_next_instance(alarm_t* alarm) {
     ms_into_period =
         ((just_now_ms - alarm->creation_time_ms) % alarm->period_ms);
   alarm->deadline_ms = just_now_ms + (alarm->period_ms - ms_into_period);
+  alarm->sequence = alarm_sequence.fetch_add(1, std::memory_order_relaxed);
 
-  // Add it into the timer list sorted by deadline (earliest deadline first).
-  if (list_is_empty(alarms) ||
-      ((alarm_t*)list_front(alarms))->deadline_ms > alarm->deadline_ms) {
-    list_prepend(alarms, alarm);
-  } else {
-    for (list_node_t* node = list_begin(alarms); node != list_end(alarms);
-         node = list_next(node)) {
-      list_node_t* next = list_next(node);
-      if (next == list_end(alarms) ||
-          ((alarm_t*)list_node(next))->deadline_ms > alarm->deadline_ms) {
-        list_insert_after(alarms, node, alarm);
-        break;
-      }
-    }
-  }
-
-  // If the new alarm has the earliest deadline, we need to re-evaluate our
-  // schedule.
-  if (needs_reschedule ||
-      (!list_is_empty(alarms) && list_front(alarms) == alarm)) {
-    reschedule_root_alarm();
-  }
+  // An empty wheel can be rebased for free, which keeps new alarms out of the
+  // overflow list after long idle periods.
+  if (shard->count == 0) shard->base_ms = std::max(shard->base_ms, just_now_ms);
+  wheel_link(shard, alarm);
 }
 
-// NOTE: must be called with |alarms_mutex| held
+// NOTE: must NOT be called with any shard mutex held
 static void reschedule_root_alarm(void) {
-  CHECK(alarms != NULL);
+  CHECK(shards != NULL);
+
+  std::lock_guard<std::mutex> lock(timer_mutex);
 
   const bool timer_was_set = timer_set;
-  alarm_t* next;
+  uint64_t next_deadline_ms = NO_DEADLINE;
   int64_t next_expiration;
 
+  for (int i = 0; i < ALARM_SHARD_COUNT; i++) {
+    next_deadline_ms =
+        std::min(next_deadline_ms, shards[i].next_deadline_ms.load());
+  }
+
   // If used in a zeroed state, disarms the timer.
   struct itimerspec timer_time;
   memset(&timer_time, 0, sizeof(timer_time));
 
-  if (list_is_empty(alarms)) goto done;
+  if (next_deadline_ms == NO_DEADLINE) goto done;
 
-  next = static_cast<alarm_t*>(list_front(alarms));
-  next_expiration = next->deadline_ms - now_ms();
+  next_expiration = next_deadline_ms - now_ms();
   if (next_expiration < TIMER_INTERVAL_FOR_WAKELOCK_IN_MS) {
     if (!timer_set) {
       if (!wakelock_acquire()) {
@@ -481,8 +682,8 @@ static void reschedule_root_alarm(void) {
       }
     }
 
-    timer_time.it_value.tv_sec = (next->deadline_ms / 1000);
-    timer_time.it_value.tv_nsec = (next->deadline_ms % 1000) * 1000000LL;
+    timer_time.it_value.tv_sec = (next_deadline_ms / 1000);
+    timer_time.it_value.tv_nsec = (next_deadline_ms % 1000) * 1000000LL;
 
     // It is entirely unsafe to call timer_settime(2) with a zeroed timerspec
     // for timers with *_ALARM clock IDs. Although the man page states that the
@@ -507,8 +708,8 @@ static void reschedule_root_alarm(void) {
     struct itimerspec wakeup_time;
     memset(&wakeup_time, 0, sizeof(wakeup_time));
 
-    wakeup_time.it_value.tv_sec = (next->deadline_ms / 1000);
-    wakeup_time.it_value.tv_nsec = (next->deadline_ms % 1000) * 1000000LL;
+    wakeup_time.it_value.tv_sec = (next_deadline_ms / 1000);
+    wakeup_time.it_value.tv_nsec = (next_deadline_ms % 1000) * 1000000LL;
     if (timer_settime(wakeup_timer, TIMER_ABSTIME, &wakeup_time, NULL) == -1)
       LOG_ERROR(LOG_TAG, "%s unable to set wakeup timer: %s", __func__,
                 strerror(errno));
@@ -532,8 +733,7 @@ done:
   // milliseconds) and the timer expired normally before we called
   // |timer_gettime|. Worst case, |alarm_expired| is signaled twice for that
   // alarm. Nothing bad should happen in that case though since the callback
-  // dispatch function checks to make sure the timer at the head of the list
-  // actually expired.
+  // dispatch function only collects alarms whose deadline actually passed.
   if (timer_set) {
     struct itimerspec time_to_expire;
     timer_gettime(timer, &time_to_expire);
@@ -601,15 +801,21 @@ static void alarm_ready_generic(alarm_t* alarm,
 }
 
 static void alarm_ready_mloop(alarm_t* alarm) {
-  std::unique_lock<std::mutex> lock(alarms_mutex);
+  std::unique_lock<std::mutex> lock(shard_for(alarm)->mutex);
   alarm_ready_generic(alarm, lock);
 }
 
 static void alarm_queue_ready(fixed_queue_t* queue, UNUSED_ATTR void* context) {
   CHECK(queue != NULL);
 
-  std::unique_lock<std::mutex> lock(alarms_mutex);
-  alarm_t* alarm = (alarm_t*)fixed_queue_try_dequeue(queue);
+  // The shard is picked by address, so peek at the alarm first and only take
+  // it off the queue once its shard mutex is held. If |alarm_cancel| removed
+  // it in the meantime there is nothing to do.
+  alarm_t* alarm = (alarm_t*)fixed_queue_try_peek_first(queue);
+  if (alarm == NULL) return;
+
+  std::unique_lock<std::mutex> lock(shard_for(alarm)->mutex);
+  if (fixed_queue_try_remove_from_queue(queue, alarm) == NULL) return;
   alarm_ready_generic(alarm, lock);
 }
 
@@ -623,46 +829,63 @@ static void timer_callback(UNUSED_ATTR void* ptr) {
 //   (2) Dispatches the alarm callback for processing by the corresponding
 // thread for that alarm.
 static void callback_dispatch(UNUSED_ATTR void* context) {
+  std::vector<alarm_t*> expired;
+
   while (true) {
     semaphore_wait(alarm_expired);
     if (!dispatcher_thread_active) break;
 
-    std::lock_guard<std::mutex> lock(alarms_mutex);
-    alarm_t* alarm;
+    {
+      // Alarms set back-to-back with the same interval must fire in the order
+      // they were set, whichever shards they live on, so every shard is held
+      // while expired alarms are collected and handed off. This is the only
+      // place that takes more than one shard mutex; it does so in index order.
+      std::unique_lock<std::mutex> locks[ALARM_SHARD_COUNT];
+      for (int i = 0; i < ALARM_SHARD_COUNT; i++)
+        locks[i] = std::unique_lock<std::mutex>(shards[i].mutex);
+
+      // Take into account that alarms may get cancelled before we get to
+      // them; only what is still in the wheel is collected.
+      uint64_t just_now_ms = now_ms();
+      expired.clear();
+      for (int i = 0; i < ALARM_SHARD_COUNT; i++)
+        wheel_advance(&shards[i], just_now_ms, &expired);
+
+      std::sort(expired.begin(), expired.end(),
+                [](const alarm_t* a, const alarm_t* b) {
+                  if (a->deadline_ms != b->deadline_ms)
+                    return a->deadline_ms < b->deadline_ms;
+                  return a->sequence < b->sequence;
+                });
+
+      for (alarm_t* alarm : expired) {
+        if (alarm->is_periodic) {
+          alarm->prev_deadline_ms = alarm->deadline_ms;
+          schedule_next_instance(shard_for(alarm), alarm);
+          alarm->stats.rescheduled_count++;
+        }
+
+        // Enqueue the alarm for processing
+        if (alarm->for_msg_loop) {
+          if (!get_main_message_loop()) {
+            LOG_ERROR(LOG_TAG, "%s: message loop already NULL. Alarm: %s",
+                      __func__, alarm->stats.name);
+            continue;
+          }
+
+          alarm->closure.i.Reset(Bind(alarm_ready_mloop, alarm));
+          get_main_message_loop()->task_runner()->PostTask(
+              FROM_HERE, alarm->closure.i.callback());
+        } else {
+          fixed_queue_enqueue(alarm->queue, alarm);
+        }
+      }
 
-    // Take into account that the alarm may get cancelled before we get to it.
-    // We're done here if there are no alarms or the alarm at the front is in
-    // the future. Exit right away since there's nothing left to do.
-    if (list_is_empty(alarms) ||
-        (alarm = static_cast<alarm_t*>(list_front(alarms)))->deadline_ms >
-            now_ms()) {
-      reschedule_root_alarm();
-      continue;
+      for (int i = 0; i < ALARM_SHARD_COUNT; i++)
+        shard_update_next_deadline(&shards[i]);
     }
 
-    list_remove(alarms, alarm);
-
-    if (alarm->is_periodic) {
-      alarm->prev_deadline_ms = alarm->deadline_ms;
-      schedule_next_instance(alarm);
-      alarm->stats.rescheduled_count++;
-    }
     reschedule_root_alarm();
-
-    // Enqueue the alarm for processing
-    if (alarm->for_msg_loop) {
-      if (!get_main_message_loop()) {
-        LOG_ERROR(LOG_TAG, "%s: message loop already NULL. Alarm: %s", __func__,
-                  alarm->stats.name);
-        continue;
-      }
-
-      alarm->closure.i.Reset(Bind(alarm_ready_mloop, alarm));
-      get_main_message_loop()->task_runner()->PostTask(
-          FROM_HERE, alarm->closure.i.callback());
-    } else {
-      fixed_queue_enqueue(alarm->queue, alarm);
-    }
   }
 
   LOG_DEBUG(LOG_TAG, "%s Callback thread exited", __func__);
@@ -731,21 +954,28 @@ static void dump_stat(int fd, stat_t* stat, const char* description) {
 void alarm_debug_dump(int fd) {
   dprintf(fd, "\nBluetooth Alarms Statistics:\n");
 
-  std::lock_guard<std::mutex> lock(alarms_mutex);
-
-  if (alarms == NULL) {
+  if (shards == NULL) {
     dprintf(fd, "  None\n");
     return;
   }
 
+  std::unique_lock<std::mutex> locks[ALARM_SHARD_COUNT];
+  std::vector<alarm_t*> alarms;
+  for (int i = 0; i < ALARM_SHARD_COUNT; i++) {
+    locks[i] = std::unique_lock<std::mutex>(shards[i].mutex);
+    wheel_collect(&shards[i], &alarms);
+  }
+  std::sort(alarms.begin(), alarms.end(),
+            [](const alarm_t* a, const alarm_t* b) {
+              return a->deadline_ms < b->deadline_ms;
+            });
+
   uint64_t just_now_ms = now_ms();
 
-  dprintf(fd, "  Total Alarms: %zu\n\n", list_length(alarms));
+  dprintf(fd, "  Total Alarms: %zu\n\n", alarms.size());
 
   // Dump info for each alarm
-  for (list_node_t* node = list_begin(alarms); node != list_end(alarms);
-       node = list_next(node)) {
-    alarm_t* alarm = (alarm_t*)list_node(node);
+  for (alarm_t* alarm : alarms) {
     alarm_stats_t* stats = &alarm->stats;
 
     dprintf(fd, "  Alarm : %s (%s)\n", stats->name,
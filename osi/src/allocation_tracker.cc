@@ -29,6 +29,7 @@
 #include "osi/include/allocator.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
+#include "osi/include/slab_allocator.h"
 
 typedef struct {
   uint8_t allocator_id;
@@ -177,11 +178,15 @@ size_t allocation_tracker_resize_for_canary(size_t size) {
 void osi_allocator_debug_dump(int fd) {
   dprintf(fd, "\nBluetooth Memory Allocation Statistics:\n");
 
-  std::unique_lock<std::mutex> lock(tracker_lock);
+  {
+    std::unique_lock<std::mutex> lock(tracker_lock);
+
+    dprintf(fd, "  Total allocated/free/used counts : %zu / %zu / %zu\n",
+            alloc_counter, free_counter, alloc_counter - free_counter);
+    dprintf(fd, "  Total allocated/free/used octets : %zu / %zu / %zu\n",
+            alloc_total_size, free_total_size,
+            alloc_total_size - free_total_size);
+  }
 
-  dprintf(fd, "  Total allocated/free/used counts : %zu / %zu / %zu\n",
-          alloc_counter, free_counter, alloc_counter - free_counter);
-  dprintf(fd, "  Total allocated/free/used octets : %zu / %zu / %zu\n",
-          alloc_total_size, free_total_size,
-          alloc_total_size - free_total_size);
+  slab_allocator_debug_dump(fd);
 }
@@ -21,6 +21,7 @@
 
 #include "osi/include/allocation_tracker.h"
 #include "osi/include/allocator.h"
+#include "osi/include/slab_allocator.h"
 
 static const allocator_id_t alloc_allocator_id = 42;
 
@@ -56,6 +57,9 @@ char* osi_strndup(const char* str, size_t len) {
 }
 
 void* osi_malloc(size_t size) {
+  void* slab_ptr = slab_allocator_alloc(size, false);
+  if (slab_ptr) return slab_ptr;
+
   size_t real_size = allocation_tracker_resize_for_canary(size);
   void* ptr = malloc(real_size);
   CHECK(ptr);
@@ -63,6 +67,9 @@ void* osi_malloc(size_t size) {
 }
 
 void* osi_calloc(size_t size) {
+  void* slab_ptr = slab_allocator_alloc(size, true);
+  if (slab_ptr) return slab_ptr;
+
   size_t real_size = allocation_tracker_resize_for_canary(size);
   void* ptr = calloc(1, real_size);
   CHECK(ptr);
@@ -70,6 +77,10 @@ void* osi_calloc(size_t size) {
 }
 
 void osi_free(void* ptr) {
+  if (slab_allocator_owns(ptr)) {
+    slab_allocator_free(ptr);
+    return;
+  }
   free(allocation_tracker_notify_free(alloc_allocator_id, ptr));
 }
 
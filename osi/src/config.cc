@@ -31,33 +31,37 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <sstream>
-#include <type_traits>
 
 // Empty definition; this type is aliased to list_node_t.
 struct config_section_iter_t {};
 
 static bool config_parse(FILE* fp, config_t* config);
 
-template <typename T,
-          class = typename std::enable_if<std::is_same<
-              config_t, typename std::remove_const<T>::type>::value>>
-static auto section_find(T& config, const std::string& section) {
-  return std::find_if(
-      config.sections.begin(), config.sections.end(),
-      [&section](const section_t& sec) { return sec.name == section; });
+static section_t* section_find(const config_t& config,
+                               std::string_view section) {
+  auto it = config.section_index.find(section);
+  if (it == config.section_index.end()) return nullptr;
+  return &*it->second;
 }
 
 static const entry_t* entry_find(const config_t& config,
-                                 const std::string& section,
-                                 const std::string& key) {
-  auto sec = section_find(config, section);
-  if (sec == config.sections.end()) return nullptr;
+                                 std::string_view section,
+                                 std::string_view key) {
+  const section_t* sec = section_find(config, section);
+  if (!sec) return nullptr;
+
+  auto it = config.entry_index.find(config_entry_id_t{sec, key});
+  if (it == config.entry_index.end()) return nullptr;
+  return &*it->second;
+}
 
-  for (const entry_t& entry : sec->entries) {
-    if (entry.key == key) return &entry;
-  }
+// Returns the copy of |key| owned by |config|, adding it if needed.
+static std::string_view key_intern(config_t* config, std::string_view key) {
+  auto it = config->keys.find(key);
+  if (it != config->keys.end()) return *it;
 
-  return nullptr;
+  config->key_storage.emplace_front(key);
+  return *config->keys.insert(config->key_storage.front()).first;
 }
 
 std::unique_ptr<config_t> config_new_empty(void) {
@@ -109,17 +113,17 @@ std::unique_ptr<config_t> config_new_clone(const config_t& src) {
   return ret;
 }
 
-bool config_has_section(const config_t& config, const std::string& section) {
-  return (section_find(config, section) != config.sections.end());
+bool config_has_section(const config_t& config, std::string_view section) {
+  return (section_find(config, section) != nullptr);
 }
 
-bool config_has_key(const config_t& config, const std::string& section,
-                    const std::string& key) {
+bool config_has_key(const config_t& config, std::string_view section,
+                    std::string_view key) {
   return (entry_find(config, section, key) != nullptr);
 }
 
-int config_get_int(const config_t& config, const std::string& section,
-                   const std::string& key, int def_value) {
+int config_get_int(const config_t& config, std::string_view section,
+                   std::string_view key, int def_value) {
   const entry_t* entry = entry_find(config, section, key);
   if (!entry) return def_value;
 
@@ -128,8 +132,8 @@ int config_get_int(const config_t& config, const std::string& section,
   return (*endptr == '\0') ? ret : def_value;
 }
 
-uint64_t config_get_uint64(const config_t& config, const std::string& section,
-                           const std::string& key, uint64_t def_value) {
+uint64_t config_get_uint64(const config_t& config, std::string_view section,
+                           std::string_view key, uint64_t def_value) {
   const entry_t* entry = entry_find(config, section, key);
   if (!entry) return def_value;
 
@@ -138,8 +142,8 @@ uint64_t config_get_uint64(const config_t& config, const std::string& section,
   return (*endptr == '\0') ? ret : def_value;
 }
 
-bool config_get_bool(const config_t& config, const std::string& section,
-                     const std::string& key, bool def_value) {
+bool config_get_bool(const config_t& config, std::string_view section,
+                     std::string_view key, bool def_value) {
   const entry_t* entry = entry_find(config, section, key);
   if (!entry) return def_value;
 
@@ -150,8 +154,8 @@ bool config_get_bool(const config_t& config, const std::string& section,
 }
 
 const std::string* config_get_string(const config_t& config,
-                                     const std::string& section,
-                                     const std::string& key,
+                                     std::string_view section,
+                                     std::string_view key,
                                      const std::string* def_value) {
   const entry_t* entry = entry_find(config, section, key);
   if (!entry) return def_value;
@@ -159,29 +163,31 @@ const std::string* config_get_string(const config_t& config,
   return &entry->value;
 }
 
-void config_set_int(config_t* config, const std::string& section,
-                    const std::string& key, int value) {
+void config_set_int(config_t* config, std::string_view section,
+                    std::string_view key, int value) {
   config_set_string(config, section, key, std::to_string(value));
 }
 
-void config_set_uint64(config_t* config, const std::string& section,
-                       const std::string& key, uint64_t value) {
+void config_set_uint64(config_t* config, std::string_view section,
+                       std::string_view key, uint64_t value) {
   config_set_string(config, section, key, std::to_string(value));
 }
 
-void config_set_bool(config_t* config, const std::string& section,
-                     const std::string& key, bool value) {
+void config_set_bool(config_t* config, std::string_view section,
+                     std::string_view key, bool value) {
   config_set_string(config, section, key, value ? "true" : "false");
 }
 
-void config_set_string(config_t* config, const std::string& section,
-                       const std::string& key, const std::string& value) {
+void config_set_string(config_t* config, std::string_view section,
+                       std::string_view key, const std::string& value) {
   CHECK(config);
 
-  auto sec = section_find(*config, section);
-  if (sec == config->sections.end()) {
-    config->sections.emplace_back(section_t{.name = section});
-    sec = std::prev(config->sections.end());
+  section_t* sec = section_find(*config, section);
+  if (!sec) {
+    config->sections.emplace_back(section_t{.name = std::string(section)});
+    auto it = std::prev(config->sections.end());
+    config->section_index.emplace(it->name, it);
+    sec = &*it;
   }
 
   std::string value_no_newline;
@@ -193,44 +199,66 @@ void config_set_string(config_t* config, const std::string& section,
     value_no_newline = value;
   }
 
-  for (entry_t& entry : sec->entries) {
-    if (entry.key == key) {
-      entry.value = value_no_newline;
-      return;
-    }
+  auto it = config->entry_index.find(config_entry_id_t{sec, key});
+  if (it != config->entry_index.end()) {
+    it->second->value = std::move(value_no_newline);
+    return;
   }
 
-  sec->entries.emplace_back(entry_t{.key = key, .value = value_no_newline});
+  std::string_view interned_key = key_intern(config, key);
+  sec->entries.emplace_back(
+      entry_t{.key = interned_key, .value = std::move(value_no_newline)});
+  config->entry_index.emplace(config_entry_id_t{sec, interned_key},
+                              std::prev(sec->entries.end()));
 }
 
-bool config_remove_section(config_t* config, const std::string& section) {
+bool config_remove_section(config_t* config, std::string_view section) {
   CHECK(config);
 
-  auto sec = section_find(*config, section);
-  if (sec == config->sections.end()) return false;
+  auto it = config->section_index.find(section);
+  if (it == config->section_index.end()) return false;
 
+  auto sec = it->second;
+  for (const entry_t& entry : sec->entries)
+    config->entry_index.erase(config_entry_id_t{&*sec, entry.key});
+  config->section_index.erase(it);
   config->sections.erase(sec);
   return true;
 }
 
-bool config_remove_key(config_t* config, const std::string& section,
-                       const std::string& key) {
+bool config_remove_key(config_t* config, std::string_view section,
+                       std::string_view key) {
   CHECK(config);
-  auto sec = section_find(*config, section);
-  if (sec == config->sections.end()) return false;
-
-  for (auto entry = sec->entries.begin(); entry != sec->entries.end();
-       ++entry) {
-    if (entry->key == key) {
-      sec->entries.erase(entry);
-      return true;
-    }
-  }
+  section_t* sec = section_find(*config, section);
+  if (!sec) return false;
 
-  return false;
+  auto it = config->entry_index.find(config_entry_id_t{sec, key});
+  if (it == config->entry_index.end()) return false;
+
+  sec->entries.erase(it->second);
+  config->entry_index.erase(it);
+  return true;
+}
+
+std::string config_serialize(const config_t& config) {
+  std::stringstream serialized;
+  for (const section_t& section : config.sections) {
+    serialized << "[" << section.name << "]" << std::endl;
+
+    for (const entry_t& entry : section.entries)
+      serialized << entry.key << " = " << entry.value << std::endl;
+
+    serialized << std::endl;
+  }
+  return serialized.str();
 }
 
 bool config_save(const config_t& config, const std::string& filename) {
+  return config_save_serialized(config_serialize(config), filename);
+}
+
+bool config_save_serialized(const std::string& serialized,
+                            const std::string& filename) {
   CHECK(!filename.empty());
 
   // Steps to ensure content of config file gets to disk:
@@ -244,7 +272,6 @@ bool config_save(const config_t& config, const std::string& filename) {
   //    This ensures directory entries are up-to-date.
   int dir_fd = -1;
   FILE* fp = nullptr;
-  std::stringstream serialized;
 
   // Build temp config file based on config file (e.g. bt_config.conf.new).
   const std::string temp_filename = filename + ".new";
@@ -271,16 +298,8 @@ bool config_save(const config_t& config, const std::string& filename) {
     goto error;
   }
 
-  for (const section_t& section : config.sections) {
-    serialized << "[" << section.name << "]" << std::endl;
-
-    for (const entry_t& entry : section.entries)
-      serialized << entry.key << " = " << entry.value << std::endl;
-
-    serialized << std::endl;
-  }
-
-  if (fprintf(fp, "%s", serialized.str().c_str()) < 0) {
+  if (fwrite(serialized.data(), 1, serialized.size(), fp) !=
+      serialized.size()) {
     LOG(ERROR) << __func__ << ": unable to write to file '" << temp_filename
                << "': " << strerror(errno);
     goto error;
@@ -0,0 +1,278 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "osi/include/config_journal.h"
+
+#include <base/files/file_path.h>
+#include <base/logging.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <array>
+
+#include "osi/include/osi.h"
+
+// Record header: body length and body checksum
+static const size_t RECORD_HEADER_SIZE = 2 * sizeof(uint32_t);
+
+// Bounds the length of a record body, so that a corrupt length cannot make
+// replay run off into the rest of the journal
+static const uint32_t RECORD_MAX_BODY_SIZE = 64 * 1024;
+
+// CRC-32 (IEEE 802.3), reflected, one table lookup per byte
+static constexpr std::array<uint32_t, 256> make_crc32_table() {
+  std::array<uint32_t, 256> table = {};
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t crc = i;
+    for (int bit = 0; bit < 8; bit++)
+      crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320 : 0);
+    table[i] = crc;
+  }
+  return table;
+}
+
+static constexpr std::array<uint32_t, 256> crc32_table = make_crc32_table();
+
+static uint32_t crc32(const uint8_t* data, size_t length) {
+  uint32_t crc = 0xFFFFFFFF;
+  for (size_t i = 0; i < length; i++)
+    crc = (crc >> 8) ^ crc32_table[(crc ^ data[i]) & 0xFF];
+  return crc ^ 0xFFFFFFFF;
+}
+
+template <typename T>
+static void append_value(std::string* out, T value) {
+  out->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+static void append_string(std::string* out, std::string_view str) {
+  append_value<T>(out, str.size());
+  out->append(str);
+}
+
+// Appends a record with the body that |fill_body| appends to |journal|.
+// Returns false, leaving |journal| as it was, if the body is too long for
+// replay to accept.
+template <typename F>
+static bool append_record(std::string* journal, F fill_body) {
+  size_t header = journal->size();
+  journal->append(RECORD_HEADER_SIZE, '\0');
+  fill_body(journal);
+
+  if (journal->size() - header - RECORD_HEADER_SIZE > RECORD_MAX_BODY_SIZE) {
+    LOG(WARNING) << __func__ << ": record of "
+                 << journal->size() - header - RECORD_HEADER_SIZE
+                 << " bytes is too long to journal";
+    journal->resize(header);
+    return false;
+  }
+
+  const uint8_t* body =
+      reinterpret_cast<const uint8_t*>(journal->data()) + header +
+      RECORD_HEADER_SIZE;
+  uint32_t length = journal->size() - header - RECORD_HEADER_SIZE;
+  uint32_t checksum = crc32(body, length);
+  journal->replace(header, sizeof(length),
+                   reinterpret_cast<const char*>(&length), sizeof(length));
+  journal->replace(header + sizeof(length), sizeof(checksum),
+                   reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+  return true;
+}
+
+bool config_journal_set(std::string* journal, std::string_view section,
+                        std::string_view key, const std::string& value) {
+  CHECK(journal != nullptr);
+  CHECK(section.size() <= UINT16_MAX && key.size() <= UINT16_MAX);
+
+  return append_record(journal, [&](std::string* body) {
+    append_value<uint8_t>(body, CONFIG_JOURNAL_SET);
+    append_string<uint16_t>(body, section);
+    append_string<uint16_t>(body, key);
+    append_string<uint32_t>(body, value);
+  });
+}
+
+bool config_journal_remove(std::string* journal, std::string_view section,
+                           std::string_view key) {
+  CHECK(journal != nullptr);
+  CHECK(section.size() <= UINT16_MAX && key.size() <= UINT16_MAX);
+
+  return append_record(journal, [&](std::string* body) {
+    append_value<uint8_t>(body, CONFIG_JOURNAL_REMOVE);
+    append_string<uint16_t>(body, section);
+    append_string<uint16_t>(body, key);
+  });
+}
+
+// Reads fields out of a record body, remembering whether any of them ran
+// past its end.
+class BodyReader {
+ public:
+  BodyReader(const uint8_t* data, size_t length)
+      : data_(data), remaining_(length) {}
+
+  template <typename T>
+  T Value() {
+    T value = 0;
+    if (remaining_ < sizeof(value)) {
+      failed_ = true;
+      return value;
+    }
+    memcpy(&value, data_, sizeof(value));
+    data_ += sizeof(value);
+    remaining_ -= sizeof(value);
+    return value;
+  }
+
+  template <typename T>
+  std::string String() {
+    T length = Value<T>();
+    if (failed_ || remaining_ < length) {
+      failed_ = true;
+      return std::string();
+    }
+    std::string str(reinterpret_cast<const char*>(data_), length);
+    data_ += length;
+    remaining_ -= length;
+    return str;
+  }
+
+  // True if every field was read in full and nothing is left over
+  bool Complete() const { return !failed_ && remaining_ == 0; }
+
+ private:
+  const uint8_t* data_;
+  size_t remaining_;
+  bool failed_ = false;
+};
+
+size_t config_journal_replay(const std::string& journal, config_t* config) {
+  CHECK(config != nullptr);
+
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(journal.data());
+  size_t offset = 0;
+  while (journal.size() - offset >= RECORD_HEADER_SIZE) {
+    uint32_t length;
+    uint32_t checksum;
+    memcpy(&length, data + offset, sizeof(length));
+    memcpy(&checksum, data + offset + sizeof(length), sizeof(checksum));
+    const uint8_t* body = data + offset + RECORD_HEADER_SIZE;
+    if (length > RECORD_MAX_BODY_SIZE ||
+        journal.size() - offset - RECORD_HEADER_SIZE < length ||
+        crc32(body, length) != checksum) {
+      break;
+    }
+
+    BodyReader reader(body, length);
+    uint8_t type = reader.Value<uint8_t>();
+    std::string section = reader.String<uint16_t>();
+    std::string key = reader.String<uint16_t>();
+    if (type == CONFIG_JOURNAL_SET) {
+      std::string value = reader.String<uint32_t>();
+      if (!reader.Complete()) break;
+      config_set_string(config, section, key, value);
+    } else if (type == CONFIG_JOURNAL_REMOVE) {
+      if (!reader.Complete()) break;
+      config_remove_key(config, section, key);
+    } else {
+      break;
+    }
+
+    offset += RECORD_HEADER_SIZE + length;
+  }
+
+  if (offset != journal.size()) {
+    LOG(WARNING) << __func__ << ": ignoring " << journal.size() - offset
+                 << " bytes after the last complete record";
+  }
+  return offset;
+}
+
+// Syncs the directory that holds |filename|, so that its entry for the file
+// is on disk.
+static bool sync_directory(const std::string& filename) {
+  const std::string directoryname = base::FilePath(filename).DirName().value();
+  int dir_fd = TEMP_FAILURE_RETRY(
+      open(directoryname.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+  if (dir_fd == INVALID_FD) {
+    LOG(ERROR) << __func__ << ": unable to open dir '" << directoryname
+               << "': " << strerror(errno);
+    return false;
+  }
+
+  if (fsync(dir_fd) < 0) {
+    LOG(WARNING) << __func__ << ": unable to fsync dir '" << directoryname
+                 << "': " << strerror(errno);
+  }
+
+  close(dir_fd);
+  return true;
+}
+
+bool config_journal_append(const std::string& records,
+                           const std::string& filename) {
+  CHECK(!filename.empty());
+
+  if (records.empty()) return true;
+
+  // A new journal is only there after a crash once its directory entry is
+  // synced too.
+  bool created = false;
+  int fd = TEMP_FAILURE_RETRY(
+      open(filename.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC));
+  if (fd == INVALID_FD && errno == ENOENT) {
+    fd = TEMP_FAILURE_RETRY(
+        open(filename.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC,
+             S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP));
+    created = true;
+  }
+  if (fd == INVALID_FD) {
+    LOG(ERROR) << __func__ << ": unable to open file '" << filename
+               << "': " << strerror(errno);
+    return false;
+  }
+
+  const char* p = records.data();
+  size_t remaining = records.size();
+  while (remaining > 0) {
+    ssize_t ret = TEMP_FAILURE_RETRY(write(fd, p, remaining));
+    if (ret <= 0) {
+      LOG(ERROR) << __func__ << ": unable to write to file '" << filename
+                 << "': " << strerror(errno);
+      close(fd);
+      return false;
+    }
+    p += ret;
+    remaining -= ret;
+  }
+
+  // fdatasync() also syncs the new length of the file.
+  if (fdatasync(fd) < 0) {
+    LOG(WARNING) << __func__ << ": unable to sync file '" << filename
+                 << "': " << strerror(errno);
+  }
+
+  close(fd);
+
+  if (created && !sync_directory(filename)) return false;
+  return true;
+}
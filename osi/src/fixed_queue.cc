@@ -16,23 +16,72 @@
  *
  ******************************************************************************/
 
+#define LOG_TAG "bt_osi_fixed_queue"
+
 #include <base/logging.h>
+#include <errno.h>
+#include <poll.h>
+#include <sched.h>
 #include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
 
+#include <atomic>
 #include <mutex>
 
 #include "osi/include/allocator.h"
 #include "osi/include/fixed_queue.h"
 #include "osi/include/list.h"
+#include "osi/include/log.h"
 #include "osi/include/osi.h"
 #include "osi/include/reactor.h"
 #include "osi/include/semaphore.h"
 
+// Large enough to keep the producer and consumer indices of a ring on
+// separate cache lines on all supported CPUs.
+#define CACHE_LINE_SIZE 64
+
+typedef struct {
+  std::atomic<size_t> sequence;
+  void* data;
+} ring_cell_t;
+
+// Bounded ring used by the SPSC and MPSC modes. |slots| is a power of two no
+// smaller than the queue capacity. The MPSC ring stamps every cell with a
+// sequence number so that producers can claim cells with a single CAS; the
+// SPSC ring only needs the head and tail indices.
+typedef struct {
+  ring_cell_t* cells;
+  size_t mask;
+
+  char pad0[CACHE_LINE_SIZE];
+  std::atomic<size_t> tail;  // Next position to enqueue
+  char pad1[CACHE_LINE_SIZE];
+  std::atomic<size_t> head;  // Next position to dequeue
+  char pad2[CACHE_LINE_SIZE];
+  // Number of reserved elements, used for capacity accounting and to detect
+  // the empty to non-empty transition.
+  std::atomic<size_t> count;
+  char pad3[CACHE_LINE_SIZE];
+  // Number of producers blocked in |fixed_queue_enqueue|.
+  std::atomic<size_t> enqueue_waiters;
+  char pad4[CACHE_LINE_SIZE];
+} ring_t;
+
 typedef struct fixed_queue_t {
+  fixed_queue_mode_t mode;
+
+  // FIXED_QUEUE_MODE_LIST
   list_t* list;
   semaphore_t* enqueue_sem;
   semaphore_t* dequeue_sem;
   std::mutex* mutex;
+
+  // FIXED_QUEUE_MODE_SPSC and FIXED_QUEUE_MODE_MPSC
+  ring_t* ring;
+  int enqueue_fd;
+  int dequeue_fd;
+
   size_t capacity;
 
   reactor_object_t* dequeue_object;
@@ -42,12 +91,202 @@ typedef struct fixed_queue_t {
 
 static void internal_dequeue_ready(void* context);
 
+static bool is_ring(const fixed_queue_t* queue) {
+  return queue->mode != FIXED_QUEUE_MODE_LIST;
+}
+
+static bool ring_push(fixed_queue_t* queue, void* data) {
+  ring_t* ring = queue->ring;
+
+  if (queue->mode == FIXED_QUEUE_MODE_SPSC) {
+    size_t tail = ring->tail.load(std::memory_order_relaxed);
+    if (tail - ring->head.load(std::memory_order_acquire) > ring->mask)
+      return false;
+    ring->cells[tail & ring->mask].data = data;
+    ring->tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  ring_cell_t* cell;
+  size_t pos = ring->tail.load(std::memory_order_relaxed);
+  for (;;) {
+    cell = &ring->cells[pos & ring->mask];
+    size_t seq = cell->sequence.load(std::memory_order_acquire);
+    intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+    if (diff == 0) {
+      if (ring->tail.compare_exchange_weak(pos, pos + 1,
+                                           std::memory_order_relaxed))
+        break;
+    } else if (diff < 0) {
+      return false;
+    } else {
+      pos = ring->tail.load(std::memory_order_relaxed);
+    }
+  }
+  cell->data = data;
+  cell->sequence.store(pos + 1, std::memory_order_release);
+  return true;
+}
+
+static void* ring_pop(fixed_queue_t* queue) {
+  ring_t* ring = queue->ring;
+
+  if (queue->mode == FIXED_QUEUE_MODE_SPSC) {
+    size_t head = ring->head.load(std::memory_order_relaxed);
+    if (head == ring->tail.load(std::memory_order_acquire)) return NULL;
+    void* data = ring->cells[head & ring->mask].data;
+    ring->head.store(head + 1, std::memory_order_release);
+    return data;
+  }
+
+  ring_cell_t* cell;
+  size_t pos = ring->head.load(std::memory_order_relaxed);
+  for (;;) {
+    cell = &ring->cells[pos & ring->mask];
+    size_t seq = cell->sequence.load(std::memory_order_acquire);
+    intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+    if (diff == 0) {
+      if (ring->head.compare_exchange_weak(pos, pos + 1,
+                                           std::memory_order_relaxed))
+        break;
+    } else if (diff < 0) {
+      // Empty, or the producer that claimed this cell has not published yet.
+      return NULL;
+    } else {
+      pos = ring->head.load(std::memory_order_relaxed);
+    }
+  }
+  void* data = cell->data;
+  cell->sequence.store(pos + ring->mask + 1, std::memory_order_release);
+  return data;
+}
+
+static void* ring_peek(const fixed_queue_t* queue, bool first) {
+  ring_t* ring = queue->ring;
+  size_t head = ring->head.load(std::memory_order_acquire);
+  size_t tail = ring->tail.load(std::memory_order_acquire);
+  if (head == tail) return NULL;
+
+  size_t pos = first ? head : tail - 1;
+  ring_cell_t* cell = &ring->cells[pos & ring->mask];
+  if (queue->mode == FIXED_QUEUE_MODE_MPSC &&
+      cell->sequence.load(std::memory_order_acquire) != pos + 1)
+    return NULL;
+  return cell->data;
+}
+
+static void signal_fd(int fd) {
+  if (eventfd_write(fd, 1ULL) == -1)
+    LOG_ERROR(LOG_TAG, "%s unable to signal fd %d: %s", __func__, fd,
+              strerror(errno));
+}
+
+// Resets the counter of the non-blocking eventfd |fd|.
+static void drain_fd(int fd) {
+  eventfd_t value;
+  eventfd_read(fd, &value);
+}
+
+static void wait_fd(int fd) {
+  struct pollfd pfd;
+  pfd.fd = fd;
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+
+  int ret;
+  OSI_NO_INTR(ret = poll(&pfd, 1, -1));
+  if (ret == -1)
+    LOG_ERROR(LOG_TAG, "%s unable to poll fd %d: %s", __func__, fd,
+              strerror(errno));
+  drain_fd(fd);
+}
+
+static bool ring_try_enqueue(fixed_queue_t* queue, void* data) {
+  ring_t* ring = queue->ring;
+
+  size_t count = ring->count.fetch_add(1);
+  if (count >= queue->capacity) {
+    ring->count.fetch_sub(1);
+    return false;
+  }
+
+  // The slot was reserved above, so the push can only fail transiently while
+  // a consumer is still releasing the cell.
+  while (!ring_push(queue, data)) sched_yield();
+
+  // Wake up the consumer only on the empty to non-empty transition.
+  if (count == 0) signal_fd(queue->dequeue_fd);
+  return true;
+}
+
+static void* ring_try_dequeue(fixed_queue_t* queue) {
+  ring_t* ring = queue->ring;
+
+  void* ret = ring_pop(queue);
+  if (ret == NULL) return NULL;
+
+  if (ring->count.fetch_sub(1) == 1) {
+    // The queue is now empty: clear the wakeup, then re-arm it if a producer
+    // raced with us and its signal was consumed by the drain.
+    drain_fd(queue->dequeue_fd);
+    if (ring->count.load() > 0) signal_fd(queue->dequeue_fd);
+  }
+
+  if (ring->enqueue_waiters.load() > 0) signal_fd(queue->enqueue_fd);
+  return ret;
+}
+
+static void ring_free(fixed_queue_t* queue) {
+  if (queue->ring) {
+    delete[] queue->ring->cells;
+    delete queue->ring;
+    queue->ring = NULL;
+  }
+  if (queue->enqueue_fd != INVALID_FD) close(queue->enqueue_fd);
+  if (queue->dequeue_fd != INVALID_FD) close(queue->dequeue_fd);
+}
+
 fixed_queue_t* fixed_queue_new(size_t capacity) {
+  return fixed_queue_new_with_mode(capacity, FIXED_QUEUE_MODE_LIST);
+}
+
+fixed_queue_t* fixed_queue_new_with_mode(size_t capacity,
+                                         fixed_queue_mode_t mode) {
   fixed_queue_t* ret =
       static_cast<fixed_queue_t*>(osi_calloc(sizeof(fixed_queue_t)));
 
-  ret->mutex = new std::mutex;
+  ret->mode = mode;
   ret->capacity = capacity;
+  ret->enqueue_fd = INVALID_FD;
+  ret->dequeue_fd = INVALID_FD;
+
+  if (is_ring(ret)) {
+    if (capacity == 0 || capacity > FIXED_QUEUE_RING_MAX_CAPACITY) {
+      LOG_ERROR(LOG_TAG, "%s invalid ring capacity %zu", __func__, capacity);
+      goto error;
+    }
+
+    size_t slots = 1;
+    while (slots < capacity) slots <<= 1;
+
+    ret->ring = new ring_t();
+    ret->ring->cells = new ring_cell_t[slots];
+    ret->ring->mask = slots - 1;
+    for (size_t i = 0; i < slots; i++) {
+      ret->ring->cells[i].sequence.store(i, std::memory_order_relaxed);
+      ret->ring->cells[i].data = NULL;
+    }
+
+    ret->enqueue_fd = eventfd(0, EFD_NONBLOCK);
+    if (ret->enqueue_fd == INVALID_FD) goto error;
+
+    ret->dequeue_fd = eventfd(0, EFD_NONBLOCK);
+    if (ret->dequeue_fd == INVALID_FD) goto error;
+
+    return ret;
+  }
+
+  ret->mutex = new std::mutex;
 
   ret->list = list_new(NULL);
   if (!ret->list) goto error;
@@ -70,6 +309,17 @@ void fixed_queue_free(fixed_queue_t* queue, fixed_queue_free_cb free_cb) {
 
   fixed_queue_unregister_dequeue(queue);
 
+  if (is_ring(queue)) {
+    if (queue->ring) {
+      void* data;
+      while ((data = ring_pop(queue)) != NULL)
+        if (free_cb) free_cb(data);
+    }
+    ring_free(queue);
+    osi_free(queue);
+    return;
+  }
+
   if (free_cb)
     for (const list_node_t* node = list_begin(queue->list);
          node != list_end(queue->list); node = list_next(node))
@@ -87,7 +337,7 @@ void fixed_queue_flush(fixed_queue_t* queue, fixed_queue_free_cb free_cb) {
 
   while (!fixed_queue_is_empty(queue)) {
     void* data = fixed_queue_try_dequeue(queue);
-    if (free_cb != NULL) {
+    if (free_cb != NULL && data != NULL) {
       free_cb(data);
     }
   }
@@ -96,6 +346,8 @@ void fixed_queue_flush(fixed_queue_t* queue, fixed_queue_free_cb free_cb) {
 bool fixed_queue_is_empty(fixed_queue_t* queue) {
   if (queue == NULL) return true;
 
+  if (is_ring(queue)) return queue->ring->count.load() == 0;
+
   std::lock_guard<std::mutex> lock(*queue->mutex);
   return list_is_empty(queue->list);
 }
@@ -103,6 +355,8 @@ bool fixed_queue_is_empty(fixed_queue_t* queue) {
 size_t fixed_queue_length(fixed_queue_t* queue) {
   if (queue == NULL) return 0;
 
+  if (is_ring(queue)) return queue->ring->count.load();
+
   std::lock_guard<std::mutex> lock(*queue->mutex);
   return list_length(queue->list);
 }
@@ -117,6 +371,22 @@ void fixed_queue_enqueue(fixed_queue_t* queue, void* data) {
   CHECK(queue != NULL);
   CHECK(data != NULL);
 
+  if (is_ring(queue)) {
+    if (ring_try_enqueue(queue, data)) return;
+
+    // Slow path: the queue is full. Announce ourselves before retrying so
+    // that a consumer freeing a slot either sees us or we see the free slot.
+    queue->ring->enqueue_waiters.fetch_add(1);
+    while (!ring_try_enqueue(queue, data)) wait_fd(queue->enqueue_fd);
+    queue->ring->enqueue_waiters.fetch_sub(1);
+
+    // Pass the wakeup on to other blocked producers if there is still room.
+    if (queue->ring->enqueue_waiters.load() > 0 &&
+        queue->ring->count.load() < queue->capacity)
+      signal_fd(queue->enqueue_fd);
+    return;
+  }
+
   semaphore_wait(queue->enqueue_sem);
 
   {
@@ -130,6 +400,19 @@ void fixed_queue_enqueue(fixed_queue_t* queue, void* data) {
 void* fixed_queue_dequeue(fixed_queue_t* queue) {
   CHECK(queue != NULL);
 
+  if (is_ring(queue)) {
+    for (;;) {
+      void* ret = ring_try_dequeue(queue);
+      if (ret != NULL) return ret;
+      // An element is reserved but not yet published: it will be shortly.
+      if (queue->ring->count.load() > 0) {
+        sched_yield();
+        continue;
+      }
+      wait_fd(queue->dequeue_fd);
+    }
+  }
+
   semaphore_wait(queue->dequeue_sem);
 
   void* ret = NULL;
@@ -148,6 +431,8 @@ bool fixed_queue_try_enqueue(fixed_queue_t* queue, void* data) {
   CHECK(queue != NULL);
   CHECK(data != NULL);
 
+  if (is_ring(queue)) return ring_try_enqueue(queue, data);
+
   if (!semaphore_try_wait(queue->enqueue_sem)) return false;
 
   {
@@ -162,6 +447,8 @@ bool fixed_queue_try_enqueue(fixed_queue_t* queue, void* data) {
 void* fixed_queue_try_dequeue(fixed_queue_t* queue) {
   if (queue == NULL) return NULL;
 
+  if (is_ring(queue)) return ring_try_dequeue(queue);
+
   if (!semaphore_try_wait(queue->dequeue_sem)) return NULL;
 
   void* ret = NULL;
@@ -179,6 +466,8 @@ void* fixed_queue_try_dequeue(fixed_queue_t* queue) {
 void* fixed_queue_try_peek_first(fixed_queue_t* queue) {
   if (queue == NULL) return NULL;
 
+  if (is_ring(queue)) return ring_peek(queue, true);
+
   std::lock_guard<std::mutex> lock(*queue->mutex);
   return list_is_empty(queue->list) ? NULL : list_front(queue->list);
 }
@@ -186,6 +475,8 @@ void* fixed_queue_try_peek_first(fixed_queue_t* queue) {
 void* fixed_queue_try_peek_last(fixed_queue_t* queue) {
   if (queue == NULL) return NULL;
 
+  if (is_ring(queue)) return ring_peek(queue, false);
+
   std::lock_guard<std::mutex> lock(*queue->mutex);
   return list_is_empty(queue->list) ? NULL : list_back(queue->list);
 }
@@ -193,6 +484,8 @@ void* fixed_queue_try_peek_last(fixed_queue_t* queue) {
 void* fixed_queue_try_remove_from_queue(fixed_queue_t* queue, void* data) {
   if (queue == NULL) return NULL;
 
+  CHECK(!is_ring(queue)) << __func__ << ": not supported by ring queues";
+
   bool removed = false;
   {
     std::lock_guard<std::mutex> lock(*queue->mutex);
@@ -212,6 +505,7 @@ void* fixed_queue_try_remove_from_queue(fixed_queue_t* queue, void* data) {
 
 list_t* fixed_queue_get_list(fixed_queue_t* queue) {
   CHECK(queue != NULL);
+  CHECK(!is_ring(queue)) << __func__ << ": not supported by ring queues";
 
   // NOTE: Using the list in this way is not thread-safe.
   // Using this list in any context where threads can call other functions
@@ -221,11 +515,13 @@ list_t* fixed_queue_get_list(fixed_queue_t* queue) {
 
 int fixed_queue_get_dequeue_fd(const fixed_queue_t* queue) {
   CHECK(queue != NULL);
+  if (is_ring(queue)) return queue->dequeue_fd;
   return semaphore_get_fd(queue->dequeue_sem);
 }
 
 int fixed_queue_get_enqueue_fd(const fixed_queue_t* queue) {
   CHECK(queue != NULL);
+  CHECK(!is_ring(queue)) << __func__ << ": not supported by ring queues";
   return semaphore_get_fd(queue->enqueue_sem);
 }
 
@@ -258,5 +554,14 @@ static void internal_dequeue_ready(void* context) {
   CHECK(context != NULL);
 
   fixed_queue_t* queue = static_cast<fixed_queue_t*>(context);
+
+  // Ring queues may see a stale wakeup from a producer that lost the race
+  // with the consumer. Swallow it instead of calling back on an empty queue.
+  if (is_ring(queue) && queue->ring->count.load() == 0) {
+    drain_fd(queue->dequeue_fd);
+    if (queue->ring->count.load() == 0) return;
+    signal_fd(queue->dequeue_fd);
+  }
+
   queue->dequeue_ready(queue, queue->dequeue_context);
 }
@@ -0,0 +1,378 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#define LOG_TAG "bt_osi_slab_allocator"
+
+#include "osi/include/slab_allocator.h"
+
+#include <base/logging.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+
+#include "bt_target.h"
+#include "osi/include/log.h"
+#include "osi/include/osi.h"
+
+// Size classes, smallest first. The FCR buffer sizes default to
+// BT_DEFAULT_BUFFER_SIZE (as does the A2DP SBC buffer size); duplicates are
+// merged when the allocator is initialized.
+static const size_t class_sizes[] = {
+    64,   128,  256, BT_SMALL_BUFFER_SIZE, 1024, 2048, L2CAP_FCR_TX_BUF_SIZE,
+    L2CAP_FCR_RX_BUF_SIZE, BT_DEFAULT_BUFFER_SIZE};
+#define MAX_SIZE_CLASSES ARRAY_SIZE(class_sizes)
+
+// Virtual address space reserved per size class. Pages are only committed
+// when blocks are carved from them.
+static const size_t region_size = 8 * 1024 * 1024;
+
+// Number of free blocks a thread caches per size class, and the number of
+// blocks moved between a magazine and the shared depot at once.
+static const size_t magazine_size = 64;
+static const size_t magazine_batch = magazine_size / 2;
+
+static const uint32_t block_in_use = 0x51ab0001;
+static const uint32_t block_free = 0x51ab0002;
+
+static const size_t canary_size = 8;
+
+typedef struct {
+  uint32_t state;
+  uint32_t requested_size;
+  uint8_t canary[canary_size];
+} block_header_t;
+
+static_assert(sizeof(block_header_t) == 16,
+              "block header must keep blocks 16 byte aligned");
+
+typedef struct {
+  size_t size;
+  size_t block_size;
+  char* region;
+
+  // Depot shared by all threads, protected by |lock|.
+  std::mutex lock;
+  void* free_list;
+  size_t free_blocks;
+  char* bump;
+  size_t carved;
+  size_t high_watermark;
+
+  // Statistics folded in from the thread magazines.
+  std::atomic<size_t> allocs;
+  std::atomic<size_t> frees;
+  std::atomic<size_t> exhausted;
+} size_class_t;
+
+typedef struct {
+  void* head;
+  size_t count;
+  size_t allocs;
+  size_t frees;
+} magazine_t;
+
+// Allocated once and never released, so that blocks freed during process
+// teardown still find their size class.
+static size_class_t* classes = nullptr;
+static size_t num_classes = 0;
+static std::atomic<uintptr_t> region_base(0);
+static std::atomic<bool> enabled(false);
+static bool canary_mode = false;
+static uint8_t canary[canary_size];
+static std::mutex init_lock;
+
+static thread_local magazine_t magazines[MAX_SIZE_CLASSES];
+static thread_local bool magazines_released = false;
+
+static void magazines_release(void);
+
+// Returns the thread magazines to the depot when the thread exits.
+class MagazineReleaser {
+ public:
+  ~MagazineReleaser() { magazines_release(); }
+  bool armed = false;
+};
+static thread_local MagazineReleaser magazine_releaser;
+
+static inline block_header_t* header_of(void* ptr) {
+  return reinterpret_cast<block_header_t*>(static_cast<char*>(ptr) -
+                                           sizeof(block_header_t));
+}
+
+static inline void* next_of(void* ptr) { return *static_cast<void**>(ptr); }
+
+static inline void set_next(void* ptr, void* next) {
+  *static_cast<void**>(ptr) = next;
+}
+
+static size_t class_index(size_t size) {
+  for (size_t i = 0; i < num_classes; i++)
+    if (size <= classes[i].size) return i;
+  return num_classes;
+}
+
+// Must be called with |sc->lock| held.
+static void* depot_pop_locked(size_class_t* sc) {
+  void* ptr = sc->free_list;
+  if (ptr != nullptr) {
+    sc->free_list = next_of(ptr);
+    sc->free_blocks--;
+  } else if (sc->bump + sc->block_size <= sc->region + region_size) {
+    ptr = sc->bump + sizeof(block_header_t);
+    header_of(ptr)->state = block_free;
+    sc->bump += sc->block_size;
+    sc->carved++;
+  } else {
+    return nullptr;
+  }
+
+  sc->high_watermark =
+      std::max(sc->high_watermark, sc->carved - sc->free_blocks);
+  return ptr;
+}
+
+static void depot_push_list(size_class_t* sc, void* head, void* tail,
+                            size_t count) {
+  std::lock_guard<std::mutex> lock(sc->lock);
+  set_next(tail, sc->free_list);
+  sc->free_list = head;
+  sc->free_blocks += count;
+}
+
+static void magazine_fold_stats(size_class_t* sc, magazine_t* mag) {
+  sc->allocs.fetch_add(mag->allocs, std::memory_order_relaxed);
+  sc->frees.fetch_add(mag->frees, std::memory_order_relaxed);
+  mag->allocs = 0;
+  mag->frees = 0;
+}
+
+static void* block_get(size_t index) {
+  size_class_t* sc = &classes[index];
+
+  if (magazines_released) {
+    std::lock_guard<std::mutex> lock(sc->lock);
+    void* ptr = depot_pop_locked(sc);
+    if (ptr != nullptr) sc->allocs.fetch_add(1, std::memory_order_relaxed);
+    return ptr;
+  }
+
+  magazine_t* mag = &magazines[index];
+  if (mag->count == 0) {
+    magazine_releaser.armed = true;
+    magazine_fold_stats(sc, mag);
+
+    std::lock_guard<std::mutex> lock(sc->lock);
+    while (mag->count < magazine_batch) {
+      void* ptr = depot_pop_locked(sc);
+      if (ptr == nullptr) break;
+      set_next(ptr, mag->head);
+      mag->head = ptr;
+      mag->count++;
+    }
+    if (mag->count == 0) return nullptr;
+  }
+
+  void* ptr = mag->head;
+  mag->head = next_of(ptr);
+  mag->count--;
+  mag->allocs++;
+  return ptr;
+}
+
+static void block_put(size_t index, void* ptr) {
+  size_class_t* sc = &classes[index];
+
+  if (magazines_released) {
+    sc->frees.fetch_add(1, std::memory_order_relaxed);
+    depot_push_list(sc, ptr, ptr, 1);
+    return;
+  }
+
+  magazine_t* mag = &magazines[index];
+  set_next(ptr, mag->head);
+  mag->head = ptr;
+  mag->count++;
+  mag->frees++;
+  if (mag->count <= magazine_size) return;
+
+  // Hand a batch back to the depot, keeping the most recently freed (and
+  // most likely cache hot) blocks in the magazine.
+  void* tail = mag->head;
+  for (size_t i = 1; i < magazine_size - magazine_batch; i++)
+    tail = next_of(tail);
+  void* head = next_of(tail);
+  set_next(tail, nullptr);
+
+  size_t count = mag->count - (magazine_size - magazine_batch);
+  void* last = head;
+  while (next_of(last) != nullptr) last = next_of(last);
+  mag->count -= count;
+
+  magazine_fold_stats(sc, mag);
+  depot_push_list(sc, head, last, count);
+}
+
+static void magazines_release(void) {
+  if (classes == nullptr) return;
+
+  for (size_t i = 0; i < num_classes; i++) {
+    magazine_t* mag = &magazines[i];
+    magazine_fold_stats(&classes[i], mag);
+    if (mag->count == 0) continue;
+
+    void* last = mag->head;
+    while (next_of(last) != nullptr) last = next_of(last);
+    depot_push_list(&classes[i], mag->head, last, mag->count);
+    mag->head = nullptr;
+    mag->count = 0;
+  }
+  magazines_released = true;
+}
+
+void slab_allocator_init(bool canaries) {
+  std::lock_guard<std::mutex> lock(init_lock);
+  if (enabled) return;
+
+  if (classes == nullptr) {
+    size_t sizes[MAX_SIZE_CLASSES];
+    memcpy(sizes, class_sizes, sizeof(sizes));
+    std::sort(sizes, sizes + MAX_SIZE_CLASSES);
+    size_t count = std::unique(sizes, sizes + MAX_SIZE_CLASSES) - sizes;
+
+    void* region = mmap(nullptr, count * region_size, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (region == MAP_FAILED) {
+      LOG_ERROR(LOG_TAG, "%s unable to reserve slab regions: %s", __func__,
+                strerror(errno));
+      return;
+    }
+
+    classes = new size_class_t[count]();
+    for (size_t i = 0; i < count; i++) {
+      size_class_t* sc = &classes[i];
+      sc->size = sizes[i];
+      sc->block_size =
+          (sizeof(block_header_t) + sizes[i] + canary_size + 15) & ~15;
+      sc->region = static_cast<char*>(region) + i * region_size;
+      sc->free_list = nullptr;
+      sc->free_blocks = 0;
+      sc->bump = sc->region;
+      sc->carved = 0;
+      sc->high_watermark = 0;
+    }
+    num_classes = count;
+
+    canary_mode = canaries;
+    for (size_t i = 0; i < canary_size; i++) canary[i] = (uint8_t)osi_rand();
+
+    region_base.store(reinterpret_cast<uintptr_t>(region));
+  }
+
+  enabled = true;
+}
+
+void slab_allocator_uninit(void) {
+  std::lock_guard<std::mutex> lock(init_lock);
+  enabled = false;
+}
+
+void* slab_allocator_alloc(size_t size, bool zero) {
+  if (!enabled.load(std::memory_order_relaxed)) return nullptr;
+
+  size_t index = class_index(size);
+  if (index == num_classes) return nullptr;
+
+  void* ptr = block_get(index);
+  if (ptr == nullptr) {
+    classes[index].exhausted.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+
+  block_header_t* header = header_of(ptr);
+  CHECK(header->state == block_free)
+      << __func__ << ": corrupted free block " << ptr;
+  header->state = block_in_use;
+  header->requested_size = size;
+
+  if (canary_mode) {
+    memcpy(header->canary, canary, canary_size);
+    memcpy(static_cast<char*>(ptr) + size, canary, canary_size);
+  }
+
+  if (zero) memset(ptr, 0, size);
+  return ptr;
+}
+
+bool slab_allocator_owns(const void* ptr) {
+  uintptr_t base = region_base.load(std::memory_order_acquire);
+  if (base == 0) return false;
+  return reinterpret_cast<uintptr_t>(ptr) - base < num_classes * region_size;
+}
+
+void slab_allocator_free(void* ptr) {
+  CHECK(ptr != nullptr);
+
+  size_t index =
+      (reinterpret_cast<uintptr_t>(ptr) - region_base.load()) / region_size;
+  block_header_t* header = header_of(ptr);
+  CHECK(header->state == block_in_use)
+      << __func__ << ": double free or corruption of " << ptr;
+
+  if (canary_mode) {
+    CHECK(memcmp(header->canary, canary, canary_size) == 0)
+        << __func__ << ": buffer underrun detected at " << ptr;
+    CHECK(memcmp(static_cast<char*>(ptr) + header->requested_size, canary,
+                 canary_size) == 0)
+        << __func__ << ": buffer overrun detected at " << ptr;
+  }
+
+  header->state = block_free;
+  block_put(index, ptr);
+}
+
+void slab_allocator_debug_dump(int fd) {
+  if (classes == nullptr) return;
+
+  dprintf(fd, "  Slab allocator (%s%s):\n", enabled ? "enabled" : "disabled",
+          canary_mode ? ", canary mode" : "");
+  dprintf(fd, "    %8s %10s %10s %8s %8s %8s %9s\n", "Size", "Allocs",
+          "Frees", "Out", "Peak", "Carved", "Exhausted");
+  for (size_t i = 0; i < num_classes; i++) {
+    size_class_t* sc = &classes[i];
+    size_t outstanding, high_watermark, carved;
+    {
+      std::lock_guard<std::mutex> lock(sc->lock);
+      outstanding = sc->carved - sc->free_blocks;
+      high_watermark = sc->high_watermark;
+      carved = sc->carved;
+    }
+    dprintf(fd, "    %8zu %10zu %10zu %8zu %8zu %8zu %9zu\n", sc->size,
+            sc->allocs.load(std::memory_order_relaxed),
+            sc->frees.load(std::memory_order_relaxed), outstanding,
+            high_watermark, carved,
+            sc->exhausted.load(std::memory_order_relaxed));
+  }
+  dprintf(fd,
+          "    (Out and Peak count blocks held by threads, including their "
+          "magazines)\n");
+}
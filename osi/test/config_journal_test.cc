@@ -0,0 +1,132 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <base/files/file_util.h>
+#include <gtest/gtest.h>
+
+#include "AllocationTestHarness.h"
+
+#include "osi/include/config_journal.h"
+
+static const char JOURNAL_FILE[] = "/data/local/tmp/config_journal_test";
+
+class ConfigJournalTest : public AllocationTestHarness {
+ protected:
+  virtual void SetUp() {
+    AllocationTestHarness::SetUp();
+    unlink(JOURNAL_FILE);
+  }
+
+  virtual void TearDown() {
+    unlink(JOURNAL_FILE);
+    AllocationTestHarness::TearDown();
+  }
+};
+
+TEST_F(ConfigJournalTest, replay_applies_records_in_order) {
+  std::string journal;
+  config_journal_set(&journal, "Adapter", "Name", "first");
+  config_journal_set(&journal, "Adapter", "Name", "second");
+  config_journal_set(&journal, "aa:bb:cc:dd:ee:ff", "LinkKey", "0123");
+  config_journal_set(&journal, "aa:bb:cc:dd:ee:ff", "Name", "headset");
+  config_journal_remove(&journal, "aa:bb:cc:dd:ee:ff", "Name");
+
+  std::unique_ptr<config_t> config = config_new_empty();
+  config_set_string(config.get(), "Adapter", "Address", "11:22:33:44:55:66");
+  EXPECT_EQ(journal.size(), config_journal_replay(journal, config.get()));
+
+  EXPECT_EQ("second", *config_get_string(*config, "Adapter", "Name", nullptr));
+  EXPECT_EQ("11:22:33:44:55:66",
+            *config_get_string(*config, "Adapter", "Address", nullptr));
+  EXPECT_EQ("0123", *config_get_string(*config, "aa:bb:cc:dd:ee:ff",
+                                       "LinkKey", nullptr));
+  EXPECT_FALSE(config_has_key(*config, "aa:bb:cc:dd:ee:ff", "Name"));
+}
+
+TEST_F(ConfigJournalTest, replay_matches_config_set_string) {
+  std::string journal;
+  config_journal_set(&journal, "Adapter", "Name", "one\ntwo");
+  config_journal_set(&journal, "Adapter", "Empty", "");
+
+  std::unique_ptr<config_t> config = config_new_empty();
+  config_journal_replay(journal, config.get());
+  EXPECT_EQ("one", *config_get_string(*config, "Adapter", "Name", nullptr));
+  EXPECT_EQ("", *config_get_string(*config, "Adapter", "Empty", nullptr));
+}
+
+TEST_F(ConfigJournalTest, replay_stops_at_torn_record) {
+  std::string journal;
+  config_journal_set(&journal, "Adapter", "Name", "first");
+  size_t first = journal.size();
+  config_journal_set(&journal, "Adapter", "Name", "second");
+
+  // Every prefix that cuts the second record short replays only the first
+  for (size_t length = first; length < journal.size(); length++) {
+    std::unique_ptr<config_t> config = config_new_empty();
+    EXPECT_EQ(first,
+              config_journal_replay(journal.substr(0, length), config.get()));
+    EXPECT_EQ("first",
+              *config_get_string(*config, "Adapter", "Name", nullptr));
+  }
+}
+
+TEST_F(ConfigJournalTest, replay_stops_at_corrupt_record) {
+  std::string journal;
+  config_journal_set(&journal, "Adapter", "Name", "first");
+  size_t first = journal.size();
+  config_journal_set(&journal, "Adapter", "Name", "second");
+  config_journal_set(&journal, "Adapter", "Name", "third");
+
+  // A flipped bit in the second record hides it and the third
+  journal[first + 12] ^= 0x01;
+  std::unique_ptr<config_t> config = config_new_empty();
+  EXPECT_EQ(first, config_journal_replay(journal, config.get()));
+  EXPECT_EQ("first", *config_get_string(*config, "Adapter", "Name", nullptr));
+}
+
+TEST_F(ConfigJournalTest, set_rejects_oversized_record) {
+  std::string journal;
+  EXPECT_TRUE(config_journal_set(&journal, "Adapter", "Name", "first"));
+  size_t first = journal.size();
+
+  // Too long for replay to accept, so it is not journaled at all
+  EXPECT_FALSE(config_journal_set(&journal, "Adapter", "Blob",
+                                  std::string(64 * 1024, 'x')));
+  EXPECT_EQ(first, journal.size());
+
+  EXPECT_TRUE(config_journal_set(&journal, "Adapter", "Name", "second"));
+  std::unique_ptr<config_t> config = config_new_empty();
+  EXPECT_EQ(journal.size(), config_journal_replay(journal, config.get()));
+  EXPECT_EQ("second", *config_get_string(*config, "Adapter", "Name", nullptr));
+  EXPECT_FALSE(config_has_key(*config, "Adapter", "Blob"));
+}
+
+TEST_F(ConfigJournalTest, append_adds_to_file) {
+  std::string first;
+  config_journal_set(&first, "Adapter", "Name", "first");
+  std::string second;
+  config_journal_set(&second, "Adapter", "Name", "second");
+  config_journal_remove(&second, "Adapter", "Address");
+
+  EXPECT_TRUE(config_journal_append(first, JOURNAL_FILE));
+  EXPECT_TRUE(config_journal_append(second, JOURNAL_FILE));
+
+  std::string journal;
+  EXPECT_TRUE(base::ReadFileToString(base::FilePath(JOURNAL_FILE), &journal));
+  EXPECT_EQ(first + second, journal);
+}
@@ -170,6 +170,30 @@ TEST_F(ConfigTest, config_remove_key_missing) {
   EXPECT_EQ(config_get_int(*config, "DID", "productId", 999), 999);
 }
 
+TEST_F(ConfigTest, config_remove_section_then_set) {
+  std::unique_ptr<config_t> config = config_new(CONFIG_FILE);
+  EXPECT_TRUE(config_remove_section(config.get(), "DID"));
+  config_set_string(config.get(), "DID", "version", "0x1437");
+  EXPECT_TRUE(config_has_section(*config, "DID"));
+  EXPECT_EQ(config_get_int(*config, "DID", "version", 0), 0x1437);
+  EXPECT_FALSE(config_has_key(*config, "DID", "productId"));
+}
+
+TEST_F(ConfigTest, config_serialize_keeps_order) {
+  std::unique_ptr<config_t> config = config_new_empty();
+  config_set_string(config.get(), "b", "key2", "1");
+  config_set_string(config.get(), "a", "key1", "2");
+  config_set_string(config.get(), "b", "key1", "3");
+  config_set_string(config.get(), "b", "key2", "4");
+  config_remove_key(config.get(), "a", "key1");
+  config_set_string(config.get(), "a", "key1", "5");
+
+  EXPECT_EQ("[b]\nkey2 = 4\nkey1 = 3\n\n[a]\nkey1 = 5\n\n",
+            config_serialize(*config));
+  EXPECT_EQ(config_serialize(*config),
+            config_serialize(*config_new_clone(*config)));
+}
+
 TEST_F(ConfigTest, config_save_basic) {
   std::unique_ptr<config_t> config = config_new(CONFIG_FILE);
   EXPECT_TRUE(config_save(*config, CONFIG_FILE));
@@ -348,3 +348,139 @@ TEST_F(FixedQueueTest, test_fixed_queue_register_dequeue) {
   thread_free(worker_thread);
   fixed_queue_free(queue, NULL);
 }
+
+TEST_F(FixedQueueTest, test_fixed_queue_ring_new_free) {
+  // Ring backed queues must be bounded
+  EXPECT_EQ(NULL, fixed_queue_new_with_mode(0, FIXED_QUEUE_MODE_SPSC));
+  EXPECT_EQ(NULL, fixed_queue_new_with_mode(SIZE_MAX, FIXED_QUEUE_MODE_MPSC));
+
+  fixed_queue_t* queue =
+      fixed_queue_new_with_mode(TEST_QUEUE_SIZE, FIXED_QUEUE_MODE_SPSC);
+  ASSERT_TRUE(queue != NULL);
+  EXPECT_EQ(TEST_QUEUE_SIZE, fixed_queue_capacity(queue));
+  fixed_queue_free(queue, NULL);
+
+  // Remaining entries are passed to the free callback
+  test_queue_entry_free_counter = 0;
+  queue = fixed_queue_new_with_mode(TEST_QUEUE_SIZE, FIXED_QUEUE_MODE_MPSC);
+  ASSERT_TRUE(queue != NULL);
+  fixed_queue_enqueue(queue, (void*)DUMMY_DATA_STRING1);
+  fixed_queue_enqueue(queue, (void*)DUMMY_DATA_STRING2);
+  fixed_queue_free(queue, test_queue_entry_free_cb);
+  EXPECT_EQ(2, test_queue_entry_free_counter);
+}
+
+TEST_F(FixedQueueTest, test_fixed_queue_ring_enqueue_dequeue) {
+  for (fixed_queue_mode_t mode :
+       {FIXED_QUEUE_MODE_SPSC, FIXED_QUEUE_MODE_MPSC}) {
+    fixed_queue_t* queue = fixed_queue_new_with_mode(TEST_QUEUE_SIZE, mode);
+    ASSERT_TRUE(queue != NULL);
+
+    fixed_queue_enqueue(queue, (void*)DUMMY_DATA_STRING);
+    EXPECT_EQ((size_t)1, fixed_queue_length(queue));
+    EXPECT_EQ(DUMMY_DATA_STRING, fixed_queue_dequeue(queue));
+    EXPECT_TRUE(fixed_queue_is_empty(queue));
+
+    // The capacity is honoured even though the ring is rounded up to a power
+    // of two
+    for (size_t i = 0; i < TEST_QUEUE_SIZE; i++) {
+      EXPECT_TRUE(fixed_queue_try_enqueue(queue, (void*)DUMMY_DATA_STRING));
+    }
+    EXPECT_FALSE(fixed_queue_try_enqueue(queue, (void*)DUMMY_DATA_STRING));
+    EXPECT_EQ(TEST_QUEUE_SIZE, fixed_queue_length(queue));
+    for (size_t i = 0; i < TEST_QUEUE_SIZE; i++) {
+      EXPECT_EQ(DUMMY_DATA_STRING, fixed_queue_try_dequeue(queue));
+    }
+    EXPECT_EQ(NULL, fixed_queue_try_dequeue(queue));
+
+    // Wrap around the ring a few times and check FIFO order
+    for (size_t i = 0; i < 4 * TEST_QUEUE_SIZE; i++) {
+      fixed_queue_enqueue(queue, (void*)DUMMY_DATA_STRING1);
+      fixed_queue_enqueue(queue, (void*)DUMMY_DATA_STRING2);
+      EXPECT_EQ(DUMMY_DATA_STRING1, fixed_queue_try_peek_first(queue));
+      EXPECT_EQ(DUMMY_DATA_STRING2, fixed_queue_try_peek_last(queue));
+      EXPECT_EQ(DUMMY_DATA_STRING1, fixed_queue_dequeue(queue));
+      EXPECT_EQ(DUMMY_DATA_STRING2, fixed_queue_dequeue(queue));
+    }
+    EXPECT_EQ(NULL, fixed_queue_try_peek_first(queue));
+    EXPECT_EQ(NULL, fixed_queue_try_peek_last(queue));
+
+    fixed_queue_free(queue, NULL);
+  }
+}
+
+TEST_F(FixedQueueTest, test_fixed_queue_ring_dequeue_fd) {
+  fixed_queue_t* queue =
+      fixed_queue_new_with_mode(TEST_QUEUE_SIZE, FIXED_QUEUE_MODE_MPSC);
+  ASSERT_TRUE(queue != NULL);
+
+  int dequeue_fd = fixed_queue_get_dequeue_fd(queue);
+  EXPECT_TRUE(dequeue_fd >= 0);
+  EXPECT_FALSE(is_fd_readable(dequeue_fd));
+
+  // The fd stays readable until the queue has been drained
+  fixed_queue_enqueue(queue, (void*)DUMMY_DATA_STRING1);
+  fixed_queue_enqueue(queue, (void*)DUMMY_DATA_STRING2);
+  EXPECT_TRUE(is_fd_readable(dequeue_fd));
+  fixed_queue_try_dequeue(queue);
+  EXPECT_TRUE(is_fd_readable(dequeue_fd));
+  fixed_queue_try_dequeue(queue);
+  EXPECT_FALSE(is_fd_readable(dequeue_fd));
+
+  fixed_queue_free(queue, NULL);
+}
+
+TEST_F(FixedQueueTest, test_fixed_queue_ring_register_dequeue) {
+  fixed_queue_t* queue =
+      fixed_queue_new_with_mode(TEST_QUEUE_SIZE, FIXED_QUEUE_MODE_SPSC);
+  ASSERT_TRUE(queue != NULL);
+
+  received_message_future = future_new();
+  ASSERT_TRUE(received_message_future != NULL);
+
+  thread_t* worker_thread = thread_new("test_fixed_queue_worker_thread");
+  ASSERT_TRUE(worker_thread != NULL);
+
+  fixed_queue_register_dequeue(queue, thread_get_reactor(worker_thread),
+                               fixed_queue_ready, NULL);
+
+  fixed_queue_enqueue(queue, (void*)DUMMY_DATA_STRING);
+  const char* msg = (const char*)future_await(received_message_future);
+  EXPECT_EQ(DUMMY_DATA_STRING, msg);
+
+  fixed_queue_unregister_dequeue(queue);
+  thread_free(worker_thread);
+  fixed_queue_free(queue, NULL);
+}
+
+static const size_t RING_TEST_MESSAGES = 10000;
+
+static void ring_test_producer(void* context) {
+  fixed_queue_t* queue = static_cast<fixed_queue_t*>(context);
+  for (size_t i = 0; i < RING_TEST_MESSAGES; i++) {
+    fixed_queue_enqueue(queue, (void*)DUMMY_DATA_STRING);
+  }
+}
+
+TEST_F(FixedQueueTest, test_fixed_queue_ring_multiple_producers) {
+  static const int NUM_PRODUCERS = 4;
+
+  // A small capacity forces the producers through the blocking path
+  fixed_queue_t* queue = fixed_queue_new_with_mode(4, FIXED_QUEUE_MODE_MPSC);
+  ASSERT_TRUE(queue != NULL);
+
+  thread_t* producers[NUM_PRODUCERS];
+  for (int i = 0; i < NUM_PRODUCERS; i++) {
+    producers[i] = thread_new("test_fixed_queue_producer_thread");
+    ASSERT_TRUE(producers[i] != NULL);
+    thread_post(producers[i], ring_test_producer, queue);
+  }
+
+  for (size_t i = 0; i < NUM_PRODUCERS * RING_TEST_MESSAGES; i++) {
+    EXPECT_EQ(DUMMY_DATA_STRING, fixed_queue_dequeue(queue));
+  }
+
+  for (int i = 0; i < NUM_PRODUCERS; i++) thread_free(producers[i]);
+  EXPECT_TRUE(fixed_queue_is_empty(queue));
+  fixed_queue_free(queue, NULL);
+}
@@ -0,0 +1,112 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#include "AllocationTestHarness.h"
+
+#include "bt_target.h"
+#include "osi/include/allocator.h"
+#include "osi/include/slab_allocator.h"
+
+class SlabAllocatorTest : public AllocationTestHarness {
+ protected:
+  void SetUp() override {
+    AllocationTestHarness::SetUp();
+    slab_allocator_init(true);
+  }
+
+  void TearDown() override {
+    slab_allocator_uninit();
+    AllocationTestHarness::TearDown();
+  }
+};
+
+TEST_F(SlabAllocatorTest, test_packet_buffers_come_from_slabs) {
+  void* small = osi_malloc(BT_SMALL_BUFFER_SIZE);
+  void* large = osi_malloc(BT_DEFAULT_BUFFER_SIZE);
+  EXPECT_TRUE(slab_allocator_owns(small));
+  EXPECT_TRUE(slab_allocator_owns(large));
+
+  // The whole requested size must be usable
+  memset(small, 0xa5, BT_SMALL_BUFFER_SIZE);
+  memset(large, 0x5a, BT_DEFAULT_BUFFER_SIZE);
+
+  osi_free(small);
+  osi_free(large);
+}
+
+TEST_F(SlabAllocatorTest, test_oversized_buffers_fall_back_to_heap) {
+  void* ptr = osi_malloc(BT_DEFAULT_BUFFER_SIZE + 1);
+  EXPECT_FALSE(slab_allocator_owns(ptr));
+  osi_free(ptr);
+}
+
+TEST_F(SlabAllocatorTest, test_calloc_zeroes_recycled_blocks) {
+  uint8_t* ptr = static_cast<uint8_t*>(osi_malloc(100));
+  memset(ptr, 0xff, 100);
+  osi_free(ptr);
+
+  ptr = static_cast<uint8_t*>(osi_calloc(100));
+  for (int i = 0; i < 100; i++) EXPECT_EQ(0, ptr[i]);
+  osi_free(ptr);
+}
+
+TEST_F(SlabAllocatorTest, test_blocks_are_recycled_per_thread) {
+  void* first = osi_malloc(BT_DEFAULT_BUFFER_SIZE);
+  osi_free(first);
+  void* second = osi_malloc(BT_DEFAULT_BUFFER_SIZE);
+  EXPECT_EQ(first, second);
+  osi_free(second);
+}
+
+TEST_F(SlabAllocatorTest, test_cross_thread_free) {
+  static const int kNumBuffers = 1000;
+
+  // Allocate on one thread and free on another, as the HCI and A2DP paths do,
+  // enough to overflow the magazines in both directions.
+  std::vector<void*> buffers;
+  std::thread producer([&buffers]() {
+    for (int i = 0; i < kNumBuffers; i++)
+      buffers.push_back(osi_malloc(BT_DEFAULT_BUFFER_SIZE));
+  });
+  producer.join();
+
+  for (void* ptr : buffers) {
+    EXPECT_TRUE(slab_allocator_owns(ptr));
+    osi_free(ptr);
+  }
+}
+
+TEST_F(SlabAllocatorTest, test_double_free_is_detected) {
+  void* ptr = osi_malloc(64);
+  osi_free(ptr);
+  EXPECT_DEATH(osi_free(ptr), "");
+}
+
+TEST_F(SlabAllocatorTest, test_overrun_is_detected_in_canary_mode) {
+  uint8_t* ptr = static_cast<uint8_t*>(osi_malloc(10));
+  ptr[10] ^= 0xff;
+  EXPECT_DEATH(osi_free(ptr), "");
+  ptr[10] ^= 0xff;
+  osi_free(ptr);
+}
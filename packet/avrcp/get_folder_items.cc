@@ -19,6 +19,24 @@
 namespace bluetooth {
 namespace avrcp {
 
+// The items are serialized as they are added, so that the builder does not
+// keep a copy of their names and attributes until the response is sent.
+namespace {
+
+// Big endian, as everything in AVRCP
+void PushOctets(std::vector<uint8_t>* data, size_t octets, uint64_t value) {
+  for (size_t i = octets; i > 0; i--) {
+    data->push_back((value >> ((i - 1) * 8)) & 0xff);
+  }
+}
+
+void PushString(std::vector<uint8_t>* data, const std::string& value) {
+  PushOctets(data, 2, (uint16_t)value.size());
+  data->insert(data->end(), value.begin(), value.end());
+}
+
+}  // namespace
+
 std::unique_ptr<GetFolderItemsResponseBuilder>
 GetFolderItemsResponseBuilder::MakePlayerListBuilder(Status status,
                                                      uint16_t uid_counter,
@@ -57,13 +75,11 @@ size_t GetFolderItemsResponseBuilder::size() const {
 
   // There is nothing other than the status in the packet if the status isn't
   // NO_ERROR
-  if (status_ != Status::NO_ERROR || items_.size() == 0) return len;
+  if (status_ != Status::NO_ERROR || num_items_ == 0) return len;
 
   len += 2;  // UID Counter
   len += 2;  // Number of Items;
-  for (const auto& item : items_) {
-    len += item.size();
-  }
+  len += items_data_.size();
 
   return len;
 }
@@ -74,7 +90,7 @@ bool GetFolderItemsResponseBuilder::Serialize(
 
   BrowsePacketBuilder::PushHeader(pkt, size() - BrowsePacket::kMinSize());
 
-  if (status_ == Status::NO_ERROR && items_.size() == 0) {
+  if (status_ == Status::NO_ERROR && num_items_ == 0) {
     // Return range out of bounds if there are zero items in the folder
     status_ = Status::RANGE_OUT_OF_BOUNDS;
   }
@@ -83,150 +99,117 @@ bool GetFolderItemsResponseBuilder::Serialize(
   if (status_ != Status::NO_ERROR) return true;
 
   AddPayloadOctets2(pkt, base::ByteSwap(uid_counter_));
-  uint16_t num_items = items_.size();
-  AddPayloadOctets2(pkt, base::ByteSwap(num_items));
-
-  for (const auto& item : items_) {
-    PushMediaListItem(pkt, item);
-  }
+  AddPayloadOctets2(pkt, base::ByteSwap(num_items_));
+  AddPayloadBytes(pkt, items_data_);
 
   return true;
 }
 
-bool GetFolderItemsResponseBuilder::AddMediaPlayer(MediaPlayerItem item) {
+bool GetFolderItemsResponseBuilder::AddMediaPlayer(
+    const MediaPlayerItem& item) {
   CHECK(scope_ == Scope::MEDIA_PLAYER_LIST);
 
   if (size() + item.size() > mtu_) return false;
 
-  items_.push_back(MediaListItem(item));
+  PushMediaPlayerItem(item);
   return true;
 }
 
-bool GetFolderItemsResponseBuilder::AddSong(MediaElementItem item) {
+bool GetFolderItemsResponseBuilder::AddSong(const MediaElementItem& item) {
   CHECK(scope_ == Scope::VFS || scope_ == Scope::NOW_PLAYING);
 
   if (size() + item.size() > mtu_) return false;
 
-  items_.push_back(MediaListItem(item));
+  PushMediaElementItem(item);
   return true;
 }
 
-bool GetFolderItemsResponseBuilder::AddFolder(FolderItem item) {
+bool GetFolderItemsResponseBuilder::AddFolder(const FolderItem& item) {
   CHECK(scope_ == Scope::VFS);
 
   if (size() + item.size() > mtu_) return false;
 
-  items_.push_back(MediaListItem(item));
+  PushFolderItem(item);
   return true;
 }
 
-void GetFolderItemsResponseBuilder::PushMediaListItem(
-    const std::shared_ptr<::bluetooth::Packet>& pkt,
-    const MediaListItem& item) {
-  switch (item.type_) {
-    case MediaListItem::PLAYER:
-      PushMediaPlayerItem(pkt, item.player_);
-      break;
-    case MediaListItem::FOLDER:
-      PushFolderItem(pkt, item.folder_);
-      break;
-    case MediaListItem::SONG:
-      PushMediaElementItem(pkt, item.song_);
-      break;
-  }
-}
-
 void GetFolderItemsResponseBuilder::PushMediaPlayerItem(
-    const std::shared_ptr<::bluetooth::Packet>& pkt,
     const MediaPlayerItem& item) {
-  AddPayloadOctets1(pkt, 0x01);  // Media Player Item
+  std::vector<uint8_t>* data = &items_data_;
+  data->reserve(data->size() + item.size());
+
+  PushOctets(data, 1, 0x01);  // Media Player Item
   uint16_t item_len = item.size() - 3;
-  AddPayloadOctets2(pkt, base::ByteSwap(item_len));  // Item length
-  AddPayloadOctets2(pkt, base::ByteSwap(item.id_));  // Player ID
-  AddPayloadOctets1(pkt, 0x01);                      // Player Type
-  AddPayloadOctets4(pkt, 0x00000000);                // Player Subtype
-  AddPayloadOctets1(
-      pkt, 0x02);  // Player Play Status // TODO: Add this as a passed field
+  PushOctets(data, 2, item_len);    // Item length
+  PushOctets(data, 2, item.id_);    // Player ID
+  PushOctets(data, 1, 0x01);        // Player Type
+  PushOctets(data, 4, 0x00000000);  // Player Subtype
+  PushOctets(data, 1,
+             0x02);  // Player Play Status // TODO: Add this as a passed field
 
   // Features
-  AddPayloadOctets1(pkt, 0x00);
-  AddPayloadOctets1(pkt, 0x00);
-  AddPayloadOctets1(pkt, 0x00);
-  AddPayloadOctets1(pkt, 0x00);
-  AddPayloadOctets1(pkt, 0x00);
-  AddPayloadOctets1(pkt, 0xb7);
-  AddPayloadOctets1(pkt, 0x01);
+  PushOctets(data, 1, 0x00);
+  PushOctets(data, 1, 0x00);
+  PushOctets(data, 1, 0x00);
+  PushOctets(data, 1, 0x00);
+  PushOctets(data, 1, 0x00);
+  PushOctets(data, 1, 0xb7);
+  PushOctets(data, 1, 0x01);
   if (item.browsable_) {
-    AddPayloadOctets1(pkt, 0x0C);
-    AddPayloadOctets1(pkt, 0x0a);
+    PushOctets(data, 1, 0x0C);
+    PushOctets(data, 1, 0x0a);
   } else {
-    AddPayloadOctets1(pkt, 0x04);
-    AddPayloadOctets1(pkt, 0x00);
-  }
-  AddPayloadOctets1(pkt, 0x00);
-  AddPayloadOctets1(pkt, 0x00);
-  AddPayloadOctets1(pkt, 0x00);
-  AddPayloadOctets1(pkt, 0x00);
-  AddPayloadOctets1(pkt, 0x00);
-  AddPayloadOctets1(pkt, 0x00);
-  AddPayloadOctets1(pkt, 0x00);
-
-  AddPayloadOctets2(pkt, base::ByteSwap((uint16_t)0x006a));
-  uint16_t name_len = item.name_.size();
-  AddPayloadOctets2(pkt, base::ByteSwap(name_len));
-
-  for (const uint8_t& byte : item.name_) {
-    AddPayloadOctets1(pkt, byte);
+    PushOctets(data, 1, 0x04);
+    PushOctets(data, 1, 0x00);
   }
+  PushOctets(data, 1, 0x00);
+  PushOctets(data, 1, 0x00);
+  PushOctets(data, 1, 0x00);
+  PushOctets(data, 1, 0x00);
+  PushOctets(data, 1, 0x00);
+  PushOctets(data, 1, 0x00);
+  PushOctets(data, 1, 0x00);
+
+  PushOctets(data, 2, 0x006a);  // UTF-8 Character Set
+  PushString(data, item.name_);
+  num_items_++;
 }
 
-void GetFolderItemsResponseBuilder::PushFolderItem(
-    const std::shared_ptr<::bluetooth::Packet>& pkt, const FolderItem& item) {
-  AddPayloadOctets1(pkt, 0x02);  // Folder Item
+void GetFolderItemsResponseBuilder::PushFolderItem(const FolderItem& item) {
+  std::vector<uint8_t>* data = &items_data_;
+  data->reserve(data->size() + item.size());
+
+  PushOctets(data, 1, 0x02);  // Folder Item
   uint16_t item_len = item.size() - 3;
-  AddPayloadOctets2(pkt, base::ByteSwap(item_len));
-  AddPayloadOctets8(pkt, base::ByteSwap(item.uid_));
-  AddPayloadOctets1(pkt, item.folder_type_);
-  AddPayloadOctets1(pkt, item.is_playable_ ? 0x01 : 0x00);
-  AddPayloadOctets2(pkt,
-                    base::ByteSwap((uint16_t)0x006a));  // UTF-8 Character Set
-  uint16_t name_len = item.name_.size();
-  AddPayloadOctets2(pkt, base::ByteSwap(name_len));
-  for (const uint8_t& byte : item.name_) {
-    AddPayloadOctets1(pkt, byte);
-  }
+  PushOctets(data, 2, item_len);
+  PushOctets(data, 8, item.uid_);
+  PushOctets(data, 1, item.folder_type_);
+  PushOctets(data, 1, item.is_playable_ ? 0x01 : 0x00);
+  PushOctets(data, 2, 0x006a);  // UTF-8 Character Set
+  PushString(data, item.name_);
+  num_items_++;
 }
 
 void GetFolderItemsResponseBuilder::PushMediaElementItem(
-    const std::shared_ptr<::bluetooth::Packet>& pkt,
     const MediaElementItem& item) {
-  AddPayloadOctets1(pkt, 0x03);  // Media Element Item
+  std::vector<uint8_t>* data = &items_data_;
+  data->reserve(data->size() + item.size());
+
+  PushOctets(data, 1, 0x03);  // Media Element Item
   uint16_t item_len = item.size() - 3;
-  AddPayloadOctets2(pkt, base::ByteSwap(item_len));
-  AddPayloadOctets8(pkt, base::ByteSwap(item.uid_));
-  AddPayloadOctets1(pkt, 0x00);  // Media Type Audio
-  AddPayloadOctets2(pkt,
-                    base::ByteSwap((uint16_t)0x006a));  // UTF-8 Character Set
-  uint16_t name_len = item.name_.size();
-  AddPayloadOctets2(pkt, base::ByteSwap(name_len));
-  for (const uint8_t& byte : item.name_) {
-    AddPayloadOctets1(pkt, byte);
-  }
+  PushOctets(data, 2, item_len);
+  PushOctets(data, 8, item.uid_);
+  PushOctets(data, 1, 0x00);    // Media Type Audio
+  PushOctets(data, 2, 0x006a);  // UTF-8 Character Set
+  PushString(data, item.name_);
 
-  AddPayloadOctets1(pkt, (uint8_t)item.attributes_.size());
+  PushOctets(data, 1, (uint8_t)item.attributes_.size());
   for (const auto& entry : item.attributes_) {
-    AddPayloadOctets4(pkt, base::ByteSwap((uint32_t)entry.attribute()));
-    AddPayloadOctets2(pkt,
-                      base::ByteSwap((uint16_t)0x006a));  // UTF-8 Character Set
-
-    std::string attr_val = entry.value();
-    uint16_t attr_len = attr_val.size();
-
-    AddPayloadOctets2(pkt, base::ByteSwap(attr_len));
-    for (const uint8_t& byte : attr_val) {
-      AddPayloadOctets1(pkt, byte);
-    }
+    PushOctets(data, 4, (uint32_t)entry.attribute());
+    PushOctets(data, 2, 0x006a);  // UTF-8 Character Set
+    PushString(data, entry.value());
   }
+  num_items_++;
 }
 
 Scope GetFolderItemsRequest::GetScope() const {
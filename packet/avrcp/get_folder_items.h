@@ -36,13 +36,15 @@ class GetFolderItemsResponseBuilder : public BrowsePacketBuilder {
       const std::shared_ptr<::bluetooth::Packet>& pkt) override;
 
   // Returns false if adding an item would exceed the MTU
-  bool AddMediaPlayer(MediaPlayerItem item);
-  bool AddSong(MediaElementItem item);
-  bool AddFolder(FolderItem item);
+  bool AddMediaPlayer(const MediaPlayerItem& item);
+  bool AddSong(const MediaElementItem& item);
+  bool AddFolder(const FolderItem& item);
 
  protected:
   Scope scope_;
-  std::vector<MediaListItem> items_;
+  // The items added so far, already serialized, and how many there are
+  std::vector<uint8_t> items_data_;
+  uint16_t num_items_ = 0;
   Status status_;
   uint16_t uid_counter_;
   size_t mtu_;
@@ -56,14 +58,9 @@ class GetFolderItemsResponseBuilder : public BrowsePacketBuilder {
         mtu_(mtu){};
 
  private:
-  void PushMediaListItem(const std::shared_ptr<::bluetooth::Packet>& pkt,
-                         const MediaListItem& item);
-  void PushMediaPlayerItem(const std::shared_ptr<::bluetooth::Packet>& pkt,
-                           const MediaPlayerItem& item);
-  void PushMediaElementItem(const std::shared_ptr<::bluetooth::Packet>& pkt,
-                            const MediaElementItem& item);
-  void PushFolderItem(const std::shared_ptr<::bluetooth::Packet>& pkt,
-                      const FolderItem& item);
+  void PushMediaPlayerItem(const MediaPlayerItem& item);
+  void PushMediaElementItem(const MediaElementItem& item);
+  void PushFolderItem(const FolderItem& item);
 };
 
 class GetFolderItemsRequest : public BrowsePacket {
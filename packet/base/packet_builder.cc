@@ -40,4 +40,12 @@ bool PacketBuilder::AddPayloadOctets(const std::shared_ptr<Packet>& pkt,
   return true;
 }
 
+bool PacketBuilder::AddPayloadBytes(const std::shared_ptr<Packet>& pkt,
+                                    const std::vector<uint8_t>& bytes) {
+  pkt->data_->insert(pkt->data_->end(), bytes.begin(), bytes.end());
+  pkt->packet_end_index_ += bytes.size();
+
+  return true;
+}
+
 }  // namespace bluetooth
\ No newline at end of file
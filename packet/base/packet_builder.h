@@ -17,6 +17,7 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 
 namespace bluetooth {
 
@@ -50,6 +51,9 @@ class PacketBuilder {
   bool AddPayloadOctets8(const std::shared_ptr<Packet>& pkt, uint64_t value) {
     return AddPayloadOctets(pkt, 8, value);
   }
+  // Add |bytes| to the payload as they are, for payloads serialized ahead
+  bool AddPayloadBytes(const std::shared_ptr<Packet>& pkt,
+                       const std::vector<uint8_t>& bytes);
 
  private:
   // Add |octets| bytes to the payload.  Return true if:
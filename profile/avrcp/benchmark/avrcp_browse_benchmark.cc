@@ -0,0 +1,199 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <base/bind.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "avrcp_message_converter.h"
+#include "device.h"
+#include "packet/avrcp/get_folder_items.h"
+#include "stack_config.h"
+#include "tests/packet_test_helper.h"
+
+using ::benchmark::State;
+using namespace bluetooth::avrcp;
+
+// Songs in the synthetic library, all in the root folder
+#define LIBRARY_SIZE 50000
+
+namespace {
+
+using TestBrowsePacket = ::bluetooth::TestPacketType<BrowsePacket>;
+
+bool get_pts_avrcp_test(void) { return false; }
+
+const stack_config_t interface = {
+    nullptr, get_pts_avrcp_test, nullptr, nullptr, nullptr, nullptr, nullptr,
+    nullptr};
+
+// A media player holding a library of LIBRARY_SIZE songs, each with the
+// attributes a typical player sends. The library is both the root folder and
+// the now playing list. Callbacks are run right away, as the media layer does
+// once the service has switched threads.
+class SyntheticLibrary : public MediaInterface {
+ public:
+  SyntheticLibrary() {
+    for (int i = 0; i < LIBRARY_SIZE; i++) {
+      std::string n = std::to_string(i);
+      SongInfo song = {
+          "media_id_" + n,
+          {AttributeEntry(Attribute::TITLE, "Song title " + n),
+           AttributeEntry(Attribute::ARTIST_NAME, "Artist " + n),
+           AttributeEntry(Attribute::ALBUM_NAME, "Album " + n),
+           AttributeEntry(Attribute::TRACK_NUMBER, n),
+           AttributeEntry(Attribute::TOTAL_NUMBER_OF_TRACKS, "50000"),
+           AttributeEntry(Attribute::GENRE, "Genre"),
+           AttributeEntry(Attribute::PLAYING_TIME, "215000")}};
+      songs_.push_back(song);
+      items_.push_back({ListItem::SONG, FolderInfo(), song});
+    }
+  }
+
+  void SendKeyEvent(uint8_t key, KeyState state) override {}
+  void GetSongInfo(SongInfoCallback info_cb) override {}
+  void GetPlayStatus(PlayStatusCallback status_cb) override {}
+
+  void GetNowPlayingList(NowPlayingCallback now_playing_cb) override {
+    now_playing_cb.Run(songs_[0].media_id, songs_);
+  }
+
+  void GetMediaPlayerList(MediaListCallback list_cb) override {}
+
+  void GetFolderItems(uint16_t player_id, std::string media_id,
+                      FolderItemsCallback folder_cb) override {
+    folder_cb.Run(items_);
+  }
+
+  void GetNowPlayingListRange(uint32_t start_item, uint32_t end_item,
+                              NowPlayingRangeCallback now_playing_cb) override {
+    now_playing_cb.Run(songs_[0].media_id, Window(songs_, start_item, end_item));
+  }
+
+  void GetFolderItemsRange(uint16_t player_id, std::string media_id,
+                           uint32_t start_item, uint32_t end_item,
+                           FolderItemsRangeCallback folder_cb) override {
+    folder_cb.Run(Window(items_, start_item, end_item));
+  }
+
+  void SetBrowsedPlayer(uint16_t player_id,
+                        SetBrowsedPlayerCallback browse_cb) override {}
+  void PlayItem(uint16_t player_id, bool now_playing,
+                std::string media_id) override {}
+  void SetActiveDevice(const RawAddress& address) override {}
+  void RegisterUpdateCallback(MediaCallbacks* callback) override {}
+  void UnregisterUpdateCallback(MediaCallbacks* callback) override {}
+
+ private:
+  template <class T>
+  static std::vector<T> Window(const std::vector<T>& list, uint32_t start_item,
+                               uint32_t end_item) {
+    if (start_item >= list.size() || end_item < start_item) return {};
+    size_t end = std::min((size_t)end_item + 1, list.size());
+    return std::vector<T>(list.begin() + start_item, list.begin() + end);
+  }
+
+  std::vector<SongInfo> songs_;
+  std::vector<ListItem> items_;
+};
+
+SyntheticLibrary& GetLibrary() {
+  static SyntheticLibrary* library = new SyntheticLibrary();
+  return *library;
+}
+
+class NoA2dp : public A2dpInterface {
+ public:
+  RawAddress active_peer() override { return RawAddress::kEmpty; }
+  bool is_peer_in_silence_mode(const RawAddress& peer_address) override {
+    return false;
+  }
+};
+
+size_t response_bytes;
+
+// Serializes the response, as ConnectionHandler::SendMessage() does
+void SendMessage(uint8_t label, bool browse,
+                 std::unique_ptr<::bluetooth::PacketBuilder> message) {
+  auto packet = VectorPacket::Make();
+  message->Serialize(packet);
+  response_bytes += packet->size();
+}
+
+// Browses the whole library page by page, |page_size| items per Get Folder
+// Items request with all the attributes, wrapping around at the end. One
+// iteration is one request; items_per_second counts the items browsed.
+void BrowseLibrary(State& state, Scope scope) {
+  const uint32_t page_size = state.range(0);
+  NoA2dp a2dp;
+  Device device(RawAddress::kAny, true, base::Bind(&SendMessage), 0xFFFF,
+                0xFFFF);
+  device.RegisterInterfaces(&GetLibrary(), &a2dp, nullptr);
+
+  response_bytes = 0;
+  uint32_t start_item = 0;
+  for (auto _ : state) {
+    auto request = TestBrowsePacket::Make();
+    GetFolderItemsRequestBuilder::MakeBuilder(scope, start_item,
+                                              start_item + page_size - 1, {})
+        ->Serialize(request);
+    device.BrowseMessageReceived(1, request);
+
+    start_item += page_size;
+    if (start_item >= LIBRARY_SIZE) start_item = 0;
+  }
+
+  state.SetItemsProcessed(state.iterations() * page_size);
+  state.SetBytesProcessed(response_bytes);
+}
+
+}  // namespace
+
+const stack_config_t* stack_config_get_interface(void) { return &interface; }
+
+// Args: items per page
+static void BM_AvrcpBrowseVFS(State& state) { BrowseLibrary(state, Scope::VFS); }
+
+BENCHMARK(BM_AvrcpBrowseVFS)->Arg(10)->Arg(50);
+
+static void BM_AvrcpBrowseNowPlaying(State& state) {
+  BrowseLibrary(state, Scope::NOW_PLAYING);
+}
+
+BENCHMARK(BM_AvrcpBrowseNowPlaying)->Arg(10)->Arg(50);
+
+// What a page cost the media layer before the range API: a copy of the
+// whole folder, handed over by value. One iteration is one page.
+static void BM_AvrcpCopyWholeFolder(State& state) {
+  SyntheticLibrary& library = GetLibrary();
+  size_t num_items = 0;
+  for (auto _ : state) {
+    library.GetFolderItems(
+        0, "", base::Bind(
+                   [](size_t* num_items, std::vector<ListItem> items) {
+                     *num_items = items.size();
+                   },
+                   &num_items));
+  }
+
+  state.SetItemsProcessed(state.iterations() * num_items);
+}
+
+BENCHMARK(BM_AvrcpCopyWholeFolder);
@@ -798,13 +798,15 @@ void Device::HandleGetFolderItems(uint8_t label,
                      weak_ptr_factory_.GetWeakPtr(), label, pkt));
       break;
     case Scope::VFS:
-      media_interface_->GetFolderItems(
-          curr_browsed_player_id_, CurrentFolder(),
+      media_interface_->GetFolderItemsRange(
+          curr_browsed_player_id_, CurrentFolder(), pkt->GetStartItem(),
+          pkt->GetEndItem(),
           base::Bind(&Device::GetVFSListResponse,
                      weak_ptr_factory_.GetWeakPtr(), label, pkt));
       break;
     case Scope::NOW_PLAYING:
-      media_interface_->GetNowPlayingList(
+      media_interface_->GetNowPlayingListRange(
+          pkt->GetStartItem(), pkt->GetEndItem(),
           base::Bind(&Device::GetNowPlayingListResponse,
                      weak_ptr_factory_.GetWeakPtr(), label, pkt));
       break;
@@ -1125,6 +1127,14 @@ std::set<AttributeEntry> filter_attributes_requested(
   return result;
 }
 
+// The number of items returned for the window of |pkt| to send. The media
+// layer shouldn't return more than the window, but don't rely on it.
+size_t items_in_window(const GetFolderItemsRequest& pkt, size_t num_items) {
+  if (pkt.GetEndItem() < pkt.GetStartItem()) return 0;
+  size_t window = (size_t)pkt.GetEndItem() - pkt.GetStartItem() + 1;
+  return num_items < window ? num_items : window;
+}
+
 void Device::GetVFSListResponse(uint8_t label,
                                 std::shared_ptr<GetFolderItemsRequest> pkt,
                                 std::vector<ListItem> items) {
@@ -1135,43 +1145,36 @@ void Device::GetVFSListResponse(uint8_t label,
   auto builder = GetFolderItemsResponseBuilder::MakeVFSBuilder(
       Status::NO_ERROR, 0x0000, browse_mtu_);
 
+  // The items are the window requested, starting at start_item. Map them to
+  // UIDs as they are sent: the maps will be cleared every time a directory
+  // change happens, and these items do not need to correspond with the now
+  // playing list as the UID's only need to be unique in the context of the
+  // current scope and the current folder.
   // TODO (apanicke): Add test that checks if vfs_ids_ is the correct size after
   // an operation.
-  for (const auto& item : items) {
-    if (item.type == ListItem::FOLDER) {
-      vfs_ids_.insert(item.folder.media_id);
-    } else if (item.type == ListItem::SONG) {
-      vfs_ids_.insert(item.song.media_id);
-    }
-  }
-
-  // Add the elements retrieved in the last get folder items request and map
-  // them to UIDs The maps will be cleared every time a directory change
-  // happens. These items do not need to correspond with the now playing list as
-  // the UID's only need to be unique in the context of the current scope and
-  // the current folder
-  for (auto i = pkt->GetStartItem(); i <= pkt->GetEndItem() && i < items.size();
-       i++) {
+  size_t num_items = items_in_window(*pkt, items.size());
+  auto attributes_requested = pkt->GetAttributesRequested();
+  for (size_t i = 0; i < num_items; i++) {
     if (items[i].type == ListItem::FOLDER) {
-      auto folder = items[i].folder;
+      const auto& folder = items[i].folder;
       // right now we always use folders of mixed type
-      FolderItem folder_item(vfs_ids_.get_uid(folder.media_id), 0x00,
+      FolderItem folder_item(vfs_ids_.insert(folder.media_id), 0x00,
                              folder.is_playable, folder.name);
       if (!builder->AddFolder(folder_item)) break;
     } else if (items[i].type == ListItem::SONG) {
-      auto song = items[i].song;
+      auto& song = items[i].song;
       auto title =
           song.attributes.find(Attribute::TITLE) != song.attributes.end()
               ? song.attributes.find(Attribute::TITLE)->value()
               : "No Song Info";
-      MediaElementItem song_item(vfs_ids_.get_uid(song.media_id), title,
+      MediaElementItem song_item(vfs_ids_.insert(song.media_id), title,
                                  std::set<AttributeEntry>());
 
       if (pkt->GetNumAttributes() == 0x00) {  // All attributes requested
         song_item.attributes_ = std::move(song.attributes);
       } else {
         song_item.attributes_ =
-            filter_attributes_requested(song, pkt->GetAttributesRequested());
+            filter_attributes_requested(song, attributes_requested);
       }
 
       // If we fail to add a song, don't accidentally add one later that might
@@ -1186,28 +1189,47 @@ void Device::GetVFSListResponse(uint8_t label,
 void Device::GetNowPlayingListResponse(
     uint8_t label, std::shared_ptr<GetFolderItemsRequest> pkt,
     std::string /* unused curr_song_id */, std::vector<SongInfo> song_list) {
-  DEVICE_VLOG(2) << __func__;
+  DEVICE_VLOG(2) << __func__ << ": start_item=" << pkt->GetStartItem()
+                 << " end_item=" << pkt->GetEndItem();
   auto builder = GetFolderItemsResponseBuilder::MakeNowPlayingBuilder(
       Status::NO_ERROR, 0x0000, browse_mtu_);
 
-  now_playing_ids_.clear();
-  for (const SongInfo& song : song_list) {
-    now_playing_ids_.insert(song.media_id);
+  // The songs are the window requested, starting at start_item. Now playing
+  // UIDs are the position of the song in the list, so only the window needs
+  // to be updated in the map, unless the window shows that the list changed
+  // since it was last browsed.
+  size_t num_songs = items_in_window(*pkt, song_list.size());
+  uint64_t first_uid = (uint64_t)pkt->GetStartItem() + 1;
+  for (size_t i = 0; i < num_songs; i++) {
+    std::string media_id = now_playing_ids_.get_media_id(first_uid + i);
+    if (!media_id.empty() && media_id != song_list[i].media_id) {
+      // A different song at a known position: the rest of what is known
+      // about the list may be stale too
+      now_playing_ids_.clear();
+      break;
+    }
+  }
+  if (num_songs < items_in_window(*pkt, SIZE_MAX)) {
+    // The list ends in the window, so there is nothing past it
+    now_playing_ids_.erase_from(first_uid + num_songs);
   }
 
-  for (size_t i = pkt->GetStartItem();
-       i <= pkt->GetEndItem() && i < song_list.size(); i++) {
-    auto song = song_list[i];
+  auto attributes_requested = pkt->GetAttributesRequested();
+  for (size_t i = 0; i < num_songs; i++) {
+    auto& song = song_list[i];
+    uint64_t uid = first_uid + i;
+    now_playing_ids_.set(uid, song.media_id);
+
     auto title = song.attributes.find(Attribute::TITLE) != song.attributes.end()
                      ? song.attributes.find(Attribute::TITLE)->value()
                      : "No Song Info";
 
-    MediaElementItem item(i + 1, title, std::set<AttributeEntry>());
+    MediaElementItem item(uid, title, std::set<AttributeEntry>());
     if (pkt->GetNumAttributes() == 0x00) {
       item.attributes_ = std::move(song.attributes);
     } else {
       item.attributes_ =
-          filter_attributes_requested(song, pkt->GetAttributesRequested());
+          filter_attributes_requested(song, attributes_requested);
     }
 
     // If we fail to add a song, don't accidentally add one later that might
@@ -16,7 +16,8 @@
 
 #pragma once
 
-#include <map>
+#include <string>
+#include <unordered_map>
 
 namespace bluetooth {
 namespace avrcp {
@@ -24,39 +25,86 @@ namespace avrcp {
 // A helper class to convert Media ID's (represented as strings) that are
 // received from the AVRCP Media Interface layer into UID's to be used
 // with connected devices.
+//
+// UID's are assigned lazily: only the items that are sent to a device are
+// ever inserted, so browsing one page of a large folder maps only that page.
 class MediaIdMap {
  public:
   void clear() {
     media_id_to_uid_.clear();
     uid_to_media_id_.clear();
+    next_uid_ = 1;
   }
 
-  std::string get_media_id(uint64_t uid) {
+  std::string get_media_id(uint64_t uid) const {
     const auto& uid_it = uid_to_media_id_.find(uid);
     if (uid_it == uid_to_media_id_.end()) return "";
     return uid_it->second;
   }
 
-  uint64_t get_uid(std::string media_id) {
+  uint64_t get_uid(const std::string& media_id) const {
     const auto& media_id_it = media_id_to_uid_.find(media_id);
     if (media_id_it == media_id_to_uid_.end()) return 0;
     return media_id_it->second;
   }
 
-  uint64_t insert(std::string media_id) {
-    if (media_id_to_uid_.find(media_id) != media_id_to_uid_.end()) {
-      return media_id_to_uid_[media_id];
-    }
+  // Returns the UID of |media_id|, giving it the next free one the first
+  // time it is seen.
+  uint64_t insert(const std::string& media_id) {
+    const auto& media_id_it = media_id_to_uid_.find(media_id);
+    if (media_id_it != media_id_to_uid_.end()) return media_id_it->second;
 
-    uint64_t uid = media_id_to_uid_.size() + 1;
-    media_id_to_uid_.insert(std::pair<std::string, uint64_t>(media_id, uid));
-    uid_to_media_id_.insert(std::pair<uint64_t, std::string>(uid, media_id));
+    uint64_t uid = next_uid_++;
+    media_id_to_uid_.emplace(media_id, uid);
+    uid_to_media_id_.emplace(uid, media_id);
     return uid;
   }
 
+  // Maps |uid| to |media_id|, replacing whatever |uid| was mapped to. Used
+  // for lists whose UID's are the position of the items, such as the now
+  // playing list, when only a window of the list is known. The same media ID
+  // can be at several positions: each of their UID's maps to it, while
+  // get_uid() only knows the first of them that was set.
+  void set(uint64_t uid, const std::string& media_id) {
+    const auto& uid_it = uid_to_media_id_.find(uid);
+    if (uid_it != uid_to_media_id_.end()) {
+      if (uid_it->second == media_id) return;
+      const auto& old_it = media_id_to_uid_.find(uid_it->second);
+      if (old_it != media_id_to_uid_.end() && old_it->second == uid) {
+        media_id_to_uid_.erase(old_it);
+      }
+      uid_it->second = media_id;
+    } else {
+      uid_to_media_id_.emplace(uid, media_id);
+    }
+
+    // Keeps the UID the media ID already has, if any
+    media_id_to_uid_.emplace(media_id, uid);
+    if (uid >= next_uid_) next_uid_ = uid + 1;
+  }
+
+  // Removes the UID's from |first_uid| on. Used when a list whose UID's are
+  // positions turns out to end before them.
+  void erase_from(uint64_t first_uid) {
+    for (auto uid_it = uid_to_media_id_.begin();
+         uid_it != uid_to_media_id_.end();) {
+      if (uid_it->first < first_uid) {
+        uid_it++;
+        continue;
+      }
+      const auto& media_id_it = media_id_to_uid_.find(uid_it->second);
+      if (media_id_it != media_id_to_uid_.end() &&
+          media_id_it->second == uid_it->first) {
+        media_id_to_uid_.erase(media_id_it);
+      }
+      uid_it = uid_to_media_id_.erase(uid_it);
+    }
+  }
+
  private:
-  std::map<std::string, uint64_t> media_id_to_uid_;
-  std::map<uint64_t, std::string> uid_to_media_id_;
+  std::unordered_map<std::string, uint64_t> media_id_to_uid_;
+  std::unordered_map<uint64_t, std::string> uid_to_media_id_;
+  uint64_t next_uid_ = 1;
 };
 
 }  // namespace avrcp
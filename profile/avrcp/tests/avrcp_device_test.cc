@@ -762,8 +762,8 @@ TEST_F(AvrcpDeviceTest, getNowPlayingListTest) {
                     AttributeEntry(Attribute::PLAYING_TIME, "1000")}};
   std::vector<SongInfo> list = {info};
 
-  EXPECT_CALL(interface, GetNowPlayingList(_))
-      .WillRepeatedly(InvokeCb<0>("test_id", list));
+  EXPECT_CALL(interface, GetNowPlayingListRange(0, 5, _))
+      .WillRepeatedly(InvokeCb<2>("test_id", list));
 
   auto expected_response = GetFolderItemsResponseBuilder::MakeNowPlayingBuilder(
       Status::NO_ERROR, 0x0000, 0xFFFF);
@@ -776,6 +776,128 @@ TEST_F(AvrcpDeviceTest, getNowPlayingListTest) {
   SendBrowseMessage(1, request);
 }
 
+TEST_F(AvrcpDeviceTest, getNowPlayingListWindowTest) {
+  MockMediaInterface interface;
+  NiceMock<MockA2dpInterface> a2dp_interface;
+
+  test_device->RegisterInterfaces(&interface, &a2dp_interface, nullptr);
+
+  // Only the window is returned, and the UIDs stay the position of the songs
+  // in the whole list
+  std::vector<SongInfo> window = {
+      {"test_id3", {AttributeEntry(Attribute::TITLE, "Test Song3")}},
+      {"test_id4", {AttributeEntry(Attribute::TITLE, "Test Song4")}},
+  };
+  EXPECT_CALL(interface, GetNowPlayingListRange(2, 3, _))
+      .WillOnce(InvokeCb<2>("test_id1", window));
+
+  auto expected_response = GetFolderItemsResponseBuilder::MakeNowPlayingBuilder(
+      Status::NO_ERROR, 0x0000, 0xFFFF);
+  expected_response->AddSong(
+      MediaElementItem(3, "Test Song3", window[0].attributes));
+  expected_response->AddSong(
+      MediaElementItem(4, "Test Song4", window[1].attributes));
+  EXPECT_CALL(response_cb,
+              Call(1, true, matchPacket(std::move(expected_response))))
+      .Times(1);
+
+  auto request_builder =
+      GetFolderItemsRequestBuilder::MakeBuilder(Scope::NOW_PLAYING, 2, 3, {});
+  auto request = TestBrowsePacket::Make();
+  request_builder->Serialize(request);
+  SendBrowseMessage(1, request);
+}
+
+TEST_F(AvrcpDeviceTest, getNowPlayingListDuplicateTest) {
+  MockMediaInterface interface;
+  NiceMock<MockA2dpInterface> a2dp_interface;
+
+  test_device->RegisterInterfaces(&interface, &a2dp_interface, nullptr);
+
+  // The same song is queued twice, and each position keeps its own UID
+  std::vector<SongInfo> window = {
+      {"test_id", {AttributeEntry(Attribute::TITLE, "Test Song")}},
+      {"test_id", {AttributeEntry(Attribute::TITLE, "Test Song")}},
+  };
+  EXPECT_CALL(interface, GetNowPlayingListRange(2, 3, _))
+      .WillOnce(InvokeCb<2>("test_id", window));
+
+  auto expected_response = GetFolderItemsResponseBuilder::MakeNowPlayingBuilder(
+      Status::NO_ERROR, 0x0000, 0xFFFF);
+  expected_response->AddSong(
+      MediaElementItem(3, "Test Song", window[0].attributes));
+  expected_response->AddSong(
+      MediaElementItem(4, "Test Song", window[1].attributes));
+  EXPECT_CALL(response_cb,
+              Call(1, true, matchPacket(std::move(expected_response))))
+      .Times(1);
+
+  auto request_builder =
+      GetFolderItemsRequestBuilder::MakeBuilder(Scope::NOW_PLAYING, 2, 3, {});
+  auto request = TestBrowsePacket::Make();
+  request_builder->Serialize(request);
+  SendBrowseMessage(1, request);
+
+  // Playing the first of the two positions still finds the song
+  EXPECT_CALL(interface, PlayItem(_, true, "test_id")).Times(1);
+  auto play_item_response =
+      PlayItemResponseBuilder::MakeBuilder(Status::NO_ERROR);
+  EXPECT_CALL(response_cb,
+              Call(2, false, matchPacket(std::move(play_item_response))))
+      .Times(1);
+
+  auto play_item = TestAvrcpPacket::Make(play_item_request);
+  SendMessage(2, play_item);
+}
+
+TEST_F(AvrcpDeviceTest, getNowPlayingListChangedTest) {
+  MockMediaInterface interface;
+  NiceMock<MockA2dpInterface> a2dp_interface;
+
+  test_device->RegisterInterfaces(&interface, &a2dp_interface, nullptr);
+
+  // The third and fourth songs of a first list are browsed
+  std::vector<SongInfo> first_window = {
+      {"test_id3", {AttributeEntry(Attribute::TITLE, "Test Song3")}},
+      {"test_id4", {AttributeEntry(Attribute::TITLE, "Test Song4")}},
+  };
+  EXPECT_CALL(interface, GetNowPlayingListRange(2, 3, _))
+      .WillOnce(InvokeCb<2>("test_id3", first_window));
+  EXPECT_CALL(response_cb, Call(1, true, _)).Times(1);
+
+  auto request_builder =
+      GetFolderItemsRequestBuilder::MakeBuilder(Scope::NOW_PLAYING, 2, 3, {});
+  auto request = TestBrowsePacket::Make();
+  request_builder->Serialize(request);
+  SendBrowseMessage(1, request);
+
+  // Then the list changes to one of two songs
+  std::vector<SongInfo> second_window = {
+      {"other_id1", {AttributeEntry(Attribute::TITLE, "Other Song1")}},
+      {"other_id2", {AttributeEntry(Attribute::TITLE, "Other Song2")}},
+  };
+  EXPECT_CALL(interface, GetNowPlayingListRange(0, 3, _))
+      .WillOnce(InvokeCb<2>("other_id1", second_window));
+  EXPECT_CALL(response_cb, Call(2, true, _)).Times(1);
+
+  request_builder =
+      GetFolderItemsRequestBuilder::MakeBuilder(Scope::NOW_PLAYING, 0, 3, {});
+  request = TestBrowsePacket::Make();
+  request_builder->Serialize(request);
+  SendBrowseMessage(2, request);
+
+  // The third song of the first list is no longer there to play
+  EXPECT_CALL(interface, PlayItem(_, _, _)).Times(0);
+  auto play_item_response = RejectBuilder::MakeBuilder(CommandPdu::PLAY_ITEM,
+                                                       Status::DOES_NOT_EXIST);
+  EXPECT_CALL(response_cb,
+              Call(3, false, matchPacket(std::move(play_item_response))))
+      .Times(1);
+
+  auto play_item = TestAvrcpPacket::Make(play_item_request);
+  SendMessage(3, play_item);
+}
+
 TEST_F(AvrcpDeviceTest, getVFSFolderTest) {
   MockMediaInterface interface;
   NiceMock<MockA2dpInterface> a2dp_interface;
@@ -786,9 +908,9 @@ TEST_F(AvrcpDeviceTest, getVFSFolderTest) {
   ListItem item = {ListItem::FOLDER, info, SongInfo()};
   std::vector<ListItem> list = {item};
 
-  EXPECT_CALL(interface, GetFolderItems(_, "", _))
+  EXPECT_CALL(interface, GetFolderItemsRange(_, "", 0, 5, _))
       .Times(1)
-      .WillOnce(InvokeCb<2>(list));
+      .WillOnce(InvokeCb<4>(list));
 
   auto expected_response = GetFolderItemsResponseBuilder::MakeVFSBuilder(
       Status::NO_ERROR, 0x0000, 0xFFFF);
@@ -831,8 +953,8 @@ TEST_F(AvrcpDeviceTest, getFolderItemsMtuTest) {
   ListItem item3 = {ListItem::FOLDER, small_info, SongInfo()};
 
   std::vector<ListItem> list0 = {item0, item1, item2, item3};
-  EXPECT_CALL(interface, GetFolderItems(_, "", _))
-      .WillRepeatedly(InvokeCb<2>(list0));
+  EXPECT_CALL(interface, GetFolderItemsRange(_, "", 0, 5, _))
+      .WillRepeatedly(InvokeCb<4>(list0));
 
   EXPECT_CALL(response_cb,
               Call(1, true, matchPacket(std::move(truncated_packet))))
@@ -852,9 +974,9 @@ TEST_F(AvrcpDeviceTest, changePathTest) {
   ListItem item0 = {ListItem::FOLDER, info0, SongInfo()};
   ListItem item1 = {ListItem::FOLDER, info1, SongInfo()};
   std::vector<ListItem> list0 = {item0, item1};
-  EXPECT_CALL(interface, GetFolderItems(_, "", _))
+  EXPECT_CALL(interface, GetFolderItemsRange(_, "", 0, 3, _))
       .Times(1)
-      .WillRepeatedly(InvokeCb<2>(list0));
+      .WillRepeatedly(InvokeCb<4>(list0));
 
   FolderInfo info2 = {"test_id2", true, "Test Folder2"};
   FolderInfo info3 = {"test_id3", true, "Test Folder3"};
@@ -864,8 +986,11 @@ TEST_F(AvrcpDeviceTest, changePathTest) {
   ListItem item4 = {ListItem::FOLDER, info4, SongInfo()};
   std::vector<ListItem> list1 = {item2, item3, item4};
   EXPECT_CALL(interface, GetFolderItems(_, "test_id1", _))
-      .Times(3)
+      .Times(2)
       .WillRepeatedly(InvokeCb<2>(list1));
+  EXPECT_CALL(interface, GetFolderItemsRange(_, "test_id1", 0, 3, _))
+      .Times(1)
+      .WillOnce(InvokeCb<4>(list1));
 
   std::vector<ListItem> list2 = {};
   EXPECT_CALL(interface, GetFolderItems(_, "test_id3", _))
@@ -40,6 +40,12 @@ class MockMediaInterface : public MediaInterface {
   MOCK_METHOD1(GetMediaPlayerList, void(MediaInterface::MediaListCallback));
   MOCK_METHOD3(GetFolderItems, void(uint16_t, std::string,
                                     MediaInterface::FolderItemsCallback));
+  MOCK_METHOD3(GetNowPlayingListRange,
+               void(uint32_t, uint32_t,
+                    MediaInterface::NowPlayingRangeCallback));
+  MOCK_METHOD5(GetFolderItemsRange,
+               void(uint16_t, std::string, uint32_t, uint32_t,
+                    MediaInterface::FolderItemsRangeCallback));
   MOCK_METHOD2(SetBrowsedPlayer,
                void(uint16_t, MediaInterface::SetBrowsedPlayerCallback));
   MOCK_METHOD3(PlayItem, void(uint16_t, bool, std::string));
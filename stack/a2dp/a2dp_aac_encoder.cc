@@ -84,7 +84,9 @@ typedef struct {
   uint32_t timestamp;        // Timestamp for the A2DP frames
 
   HANDLE_AACENCODER aac_handle;
-  bool has_aac_handle;  // True if aac_handle is valid
+  bool has_aac_handle;      // True if aac_handle is valid
+  int config_bit_rate;      // Bit rate picked for the codec configuration
+  uint8_t bitrate_percent;  // Bit rate in percent of the configured one
 
   tA2DP_FEEDING_PARAMS feeding_params;
   tA2DP_AAC_ENCODER_PARAMS aac_encoder_params;
@@ -135,6 +137,7 @@ void a2dp_aac_encoder_init(const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params,
   a2dp_aac_encoder_cb.peer_supports_3mbps = p_peer_params->peer_supports_3mbps;
   a2dp_aac_encoder_cb.peer_mtu = p_peer_params->peer_mtu;
   a2dp_aac_encoder_cb.timestamp = 0;
+  a2dp_aac_encoder_cb.bitrate_percent = 100;
 
   a2dp_aac_encoder_cb.use_SCMS_T = false;  // TODO: should be a parameter
 #if (BTA_AV_CO_CP_SCMS_T == TRUE)
@@ -343,6 +346,9 @@ static void a2dp_aac_encoder_update(uint16_t peer_mtu,
               __func__);
     return;  // TODO: Return an error?
   }
+  // Keep the bit rate set by the adaptive bit rate control
+  a2dp_aac_encoder_cb.config_bit_rate = aac_param_value;
+  aac_param_value = aac_param_value * a2dp_aac_encoder_cb.bitrate_percent / 100;
   aac_error = aacEncoder_SetParam(a2dp_aac_encoder_cb.aac_handle,
                                   AACENC_BITRATE, aac_param_value);
   if (aac_error != AACENC_OK) {
@@ -453,6 +459,29 @@ static void a2dp_aac_encoder_update(uint16_t peer_mtu,
             p_encoder_params->max_encoded_buffer_bytes);
 }
 
+void a2dp_aac_set_bitrate_percent(uint8_t bitrate_percent) {
+  if (a2dp_aac_encoder_cb.bitrate_percent == bitrate_percent) return;
+  a2dp_aac_encoder_cb.bitrate_percent = bitrate_percent;
+  if (!a2dp_aac_encoder_cb.has_aac_handle ||
+      a2dp_aac_encoder_cb.config_bit_rate <= 0) {
+    return;
+  }
+
+  // The encoder applies the new bit rate from the next frame it encodes
+  int bit_rate = a2dp_aac_encoder_cb.config_bit_rate * bitrate_percent / 100;
+  AACENC_ERROR aac_error = aacEncoder_SetParam(a2dp_aac_encoder_cb.aac_handle,
+                                               AACENC_BITRATE, bit_rate);
+  if (aac_error != AACENC_OK) {
+    LOG_ERROR(LOG_TAG,
+              "%s: Cannot set AAC parameter AACENC_BITRATE to %d: "
+              "AAC error 0x%x",
+              __func__, bit_rate, aac_error);
+    return;
+  }
+  LOG_INFO(LOG_TAG, "%s: %d%% of the bit rate: %d bps", __func__,
+           bitrate_percent, bit_rate);
+}
+
 void a2dp_aac_encoder_cleanup(void) {
   if (a2dp_aac_encoder_cb.has_aac_handle)
     aacEncClose(&a2dp_aac_encoder_cb.aac_handle);
@@ -0,0 +1,165 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "a2dp_abr_controller.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+namespace {
+
+// The bit rate steps, in percent of the configured bit rate
+constexpr uint8_t kBitratePercent[] = {100, 85, 70, 55, 40};
+constexpr size_t kNumLevels = sizeof(kBitratePercent) / sizeof(uint8_t);
+
+// Transmit queue fill (in percent) from which an interval is marginal, bad
+// or critical.
+constexpr size_t kMarginalQueueFillPercent = 25;
+constexpr size_t kBadQueueFillPercent = 50;
+constexpr size_t kCriticalQueueFillPercent = 75;
+
+// Part of the interval (in percent) the media channel was congested from
+// which an interval is bad.
+constexpr uint32_t kBadCongestedPercent = 25;
+
+// Failed contacts in one interval from which an interval is bad.
+constexpr uint32_t kBadFailedContacts = 5;
+
+// RSSI below the Golden Receive Power Range (in dB) from which the link is
+// considered weak.
+constexpr int8_t kWeakRssi = -5;
+
+// Upper bound of the clean intervals needed to step up, in multiples of the
+// configured number.
+constexpr size_t kMaxStepUpBackoff = 8;
+
+}  // namespace
+
+A2dpAbrController::A2dpAbrController(size_t step_up_intervals)
+    : step_up_intervals_(std::max<size_t>(step_up_intervals, 1)) {
+  Reset();
+}
+
+A2dpAbrController::Rating A2dpAbrController::Rate(
+    const tA2DP_ABR_METRICS& metrics) {
+  size_t queue_fill_percent = 0;
+  if (metrics.queue_capacity != 0) {
+    queue_fill_percent = metrics.queue_length * 100 / metrics.queue_capacity;
+  }
+  uint32_t congested_percent = 0;
+  if (metrics.interval_ms != 0) {
+    congested_percent =
+        std::min<uint64_t>(metrics.congested_ms, metrics.interval_ms) * 100 /
+        metrics.interval_ms;
+  }
+
+  if (metrics.dropped_packets != 0 ||
+      queue_fill_percent >= kCriticalQueueFillPercent) {
+    return kCritical;
+  }
+  if (queue_fill_percent >= kBadQueueFillPercent ||
+      congested_percent >= kBadCongestedPercent ||
+      metrics.failed_contacts >= kBadFailedContacts) {
+    return kBad;
+  }
+  if (queue_fill_percent >= kMarginalQueueFillPercent ||
+      metrics.congested_ms != 0 || metrics.failed_contacts != 0 ||
+      (metrics.has_rssi && metrics.rssi <= kWeakRssi)) {
+    return kMarginal;
+  }
+  return kClean;
+}
+
+uint8_t A2dpAbrController::Update(const tA2DP_ABR_METRICS& metrics) {
+  stats_.intervals++;
+  if (stepped_up_) intervals_since_step_up_++;
+
+  switch (Rate(metrics)) {
+    case kCritical:
+      stats_.critical_intervals++;
+      clean_intervals_ = 0;
+      StepDown(2);
+      break;
+    case kBad:
+      stats_.bad_intervals++;
+      clean_intervals_ = 0;
+      // The queues filled before the last step down: give them time to drain
+      if (hold_) {
+        hold_ = false;
+      } else {
+        StepDown(1);
+      }
+      break;
+    case kMarginal:
+      stats_.marginal_intervals++;
+      clean_intervals_ = 0;
+      hold_ = false;
+      break;
+    case kClean:
+      hold_ = false;
+      clean_intervals_++;
+      if (clean_intervals_ >= required_clean_intervals_ && level_ > 0) {
+        level_--;
+        stats_.step_ups++;
+        clean_intervals_ = 0;
+        stepped_up_ = true;
+        intervals_since_step_up_ = 0;
+      }
+      break;
+  }
+
+  // The raised bit rate held for as long as it took to earn it
+  if (stepped_up_ && intervals_since_step_up_ >= required_clean_intervals_) {
+    stepped_up_ = false;
+    required_clean_intervals_ = step_up_intervals_;
+  }
+
+  return bitrate_percent();
+}
+
+uint8_t A2dpAbrController::bitrate_percent() const {
+  return kBitratePercent[level_];
+}
+
+void A2dpAbrController::Reset() {
+  level_ = 0;
+  clean_intervals_ = 0;
+  required_clean_intervals_ = step_up_intervals_;
+  intervals_since_step_up_ = 0;
+  stepped_up_ = false;
+  hold_ = false;
+  memset(&stats_, 0, sizeof(stats_));
+  stats_.min_bitrate_percent = kBitratePercent[0];
+}
+
+void A2dpAbrController::StepDown(size_t steps) {
+  if (stepped_up_) {
+    // The link could not carry the raised bit rate: probe it less often
+    stepped_up_ = false;
+    required_clean_intervals_ =
+        std::min(required_clean_intervals_ * 2,
+                 step_up_intervals_ * kMaxStepUpBackoff);
+  }
+  hold_ = true;
+
+  size_t level = std::min(level_ + steps, kNumLevels - 1);
+  if (level == level_) return;
+  level_ = level;
+  stats_.step_downs++;
+  stats_.min_bitrate_percent =
+      std::min(stats_.min_bitrate_percent, kBitratePercent[level_]);
+}
@@ -99,6 +99,9 @@ typedef struct {
   bool peer_supports_3mbps; /* True if the peer device supports 3Mbps EDR */
   uint16_t peer_mtu;        /* MTU of the A2DP peer */
   uint32_t timestamp;       /* Timestamp for the A2DP frames */
+  int16_t config_bitpool;   /* Bitpool picked for the codec configuration */
+  int16_t min_bitpool;      /* Lowest bitpool the peer accepts */
+  uint8_t bitrate_percent;  /* Bit rate in percent of the configured one */
   SBC_ENC_PARAMS sbc_encoder_params;
   tA2DP_FEEDING_PARAMS feeding_params;
   tA2DP_SBC_FEEDING_STATE feeding_state;
@@ -147,6 +150,7 @@ void a2dp_sbc_encoder_init(const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params,
   a2dp_sbc_encoder_cb.peer_supports_3mbps = p_peer_params->peer_supports_3mbps;
   a2dp_sbc_encoder_cb.peer_mtu = p_peer_params->peer_mtu;
   a2dp_sbc_encoder_cb.timestamp = 0;
+  a2dp_sbc_encoder_cb.bitrate_percent = 100;
 
   // NOTE: Ignore the restart_input / restart_output flags - this initization
   // happens when the connection is (re)started.
@@ -369,6 +373,39 @@ static void a2dp_sbc_encoder_update(uint16_t peer_mtu,
   /* Reset the SBC encoder */
   SBC_Encoder_Init(&a2dp_sbc_encoder_cb.sbc_encoder_params);
   a2dp_sbc_encoder_cb.tx_sbc_frames = calculate_max_frames_per_packet();
+
+  /* Keep the bit rate set by the adaptive bit rate control */
+  a2dp_sbc_encoder_cb.config_bitpool = p_encoder_params->s16BitPool;
+  a2dp_sbc_encoder_cb.min_bitpool = min_bitpool;
+  a2dp_sbc_set_bitrate_percent(a2dp_sbc_encoder_cb.bitrate_percent);
+}
+
+void a2dp_sbc_set_bitrate_percent(uint8_t bitrate_percent) {
+  SBC_ENC_PARAMS* p_encoder_params = &a2dp_sbc_encoder_cb.sbc_encoder_params;
+  int16_t config_bitpool = a2dp_sbc_encoder_cb.config_bitpool;
+
+  a2dp_sbc_encoder_cb.bitrate_percent = bitrate_percent;
+  if (config_bitpool == 0) return;
+
+  int16_t bitpool = config_bitpool * bitrate_percent / 100;
+  if (bitpool < a2dp_sbc_encoder_cb.min_bitpool)
+    bitpool = a2dp_sbc_encoder_cb.min_bitpool;
+  if (bitpool > config_bitpool) bitpool = config_bitpool;
+  if (bitpool == p_encoder_params->s16BitPool) return;
+
+  /* Each frame header carries its bitpool: the encoder needs no reset, and
+   * the peer picks up the new bitpool from the next frame. */
+  p_encoder_params->s16BitPool = bitpool;
+  p_encoder_params->u16BitRate =
+      (8 * a2dp_sbc_frame_length() *
+       a2dp_sbc_encoder_cb.feeding_params.sample_rate) /
+      (p_encoder_params->s16NumOfSubBands * p_encoder_params->s16NumOfBlocks *
+       1000);
+  a2dp_sbc_encoder_cb.tx_sbc_frames = calculate_max_frames_per_packet();
+
+  LOG_INFO(LOG_TAG, "%s: %d%% of the bit rate: bit pool %d (%d kbps)",
+           __func__, bitrate_percent, p_encoder_params->s16BitPool,
+           p_encoder_params->u16BitRate);
 }
 
 void a2dp_sbc_encoder_cleanup(void) {
@@ -31,6 +31,7 @@
 #include "bt_types.h"
 #include "btm_api.h"
 #include "btu.h"
+#include "common/time_util.h"
 #include "l2c_api.h"
 #include "stack/include/a2dp_codec_api.h"
 
@@ -1059,6 +1060,27 @@ uint16_t AVDT_GetL2CapChannel(uint8_t handle) {
   return (lcid);
 }
 
+/*******************************************************************************
+ *
+ * Function         AVDT_GetMediaQueueStats
+ *
+ * Description      Get the media transmit queue statistics of the stream
+ *                  with the given handle.
+ *
+ * Returns          AVDT_SUCCESS if successful, otherwise error.
+ *
+ ******************************************************************************/
+uint16_t AVDT_GetMediaQueueStats(uint8_t handle,
+                                 tAVDT_MEDIA_QUEUE_STATS* p_stats) {
+  /* map handle to scb */
+  AvdtpScb* p_scb = avdt_scb_by_hdl(handle);
+  if (p_scb == NULL) return AVDT_BAD_HANDLE;
+
+  *p_stats =
+      p_scb->media_q.GetStats(bluetooth::common::time_get_os_boottime_us());
+  return AVDT_SUCCESS;
+}
+
 /*******************************************************************************
  *
  * Function         AVDT_GetSignalChannel
@@ -26,6 +26,7 @@
 
 #include "avdt_api.h"
 #include "avdt_defs.h"
+#include "avdt_media_queue.h"
 #include "avdtc_api.h"
 #include "bt_common.h"
 #include "btm_api.h"
@@ -418,7 +419,9 @@ class AvdtpScb {
  public:
   AvdtpScb()
       : transport_channel_timer(nullptr),
-        p_pkt(nullptr),
+        media_q(AVDT_MEDIA_QUEUE_SIZE, AVDT_MEDIA_QUEUE_MAX_DELAY_MS * 1000,
+                osi_free),
+        write_cfm_pending(false),
         p_ccb(nullptr),
         media_seq(0),
         allocated(false),
@@ -467,7 +470,8 @@ class AvdtpScb {
     alarm_free(transport_channel_timer);
     transport_channel_timer = nullptr;
 
-    p_pkt = nullptr;
+    media_q.Reset();
+    write_cfm_pending = false;
     p_ccb = nullptr;
     media_seq = 0;
     allocated = false;
@@ -491,7 +495,8 @@ class AvdtpScb {
   AvdtpSepConfig curr_cfg;           // Current configuration
   AvdtpSepConfig req_cfg;            // Requested configuration
   alarm_t* transport_channel_timer;  // Transport channel connect timer
-  BT_HDR* p_pkt;                     // Packet waiting to be sent
+  AvdtMediaQueue media_q;            // Media packets waiting to be sent
+  bool write_cfm_pending;            // True if a write awaits its confirm
   AvdtpCcb* p_ccb;                   // CCB associated with this SCB
   uint16_t media_seq;                // Media packet sequence number
   bool allocated;                    // True if the SCB is allocated
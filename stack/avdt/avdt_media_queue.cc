@@ -0,0 +1,151 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "avdt_media_queue.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+namespace {
+
+/* Upper bounds of the latency histogram buckets, but the last one */
+constexpr uint64_t kLatencyBucketUs[AVDT_MEDIA_LATENCY_BUCKETS - 1] = {
+    1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000};
+
+size_t LatencyBucket(uint64_t latency_us) {
+  size_t i = 0;
+  while (i < AVDT_MEDIA_LATENCY_BUCKETS - 1 &&
+         latency_us >= kLatencyBucketUs[i]) {
+    i++;
+  }
+  return i;
+}
+
+}  // namespace
+
+AvdtMediaQueue::AvdtMediaQueue(size_t capacity, uint64_t max_delay_us,
+                               FreeFn free_fn)
+    : entries_(std::max<size_t>(capacity, 1)),
+      head_(0),
+      count_(0),
+      max_delay_us_(max_delay_us),
+      free_fn_(free_fn),
+      congested_(false),
+      congested_since_us_(0) {
+  ResetStats(0);
+}
+
+AvdtMediaQueue::~AvdtMediaQueue() {
+  while (!empty()) free_fn_(Take());
+}
+
+void AvdtMediaQueue::Push(BT_HDR* p_pkt, uint64_t now_us) {
+  if (count_ == entries_.size()) Drop(AVDT_MEDIA_DROP_OVERFLOW);
+
+  Entry& entry = entries_[(head_ + count_) % entries_.size()];
+  entry.p_pkt = p_pkt;
+  entry.queued_us = now_us;
+  count_++;
+
+  stats_.enqueued++;
+  stats_.depth_bytes += p_pkt->len;
+  stats_.max_depth = std::max<uint16_t>(stats_.max_depth, count_);
+}
+
+BT_HDR* AvdtMediaQueue::Pop(uint64_t now_us) {
+  if (empty()) return nullptr;
+
+  uint64_t queued_us = entries_[head_].queued_us;
+  uint64_t latency_us = now_us > queued_us ? now_us - queued_us : 0;
+  stats_.sent++;
+  stats_.total_latency_us += latency_us;
+  stats_.max_latency_us = std::max(stats_.max_latency_us, latency_us);
+  stats_.latency_hist[LatencyBucket(latency_us)]++;
+  return Take();
+}
+
+size_t AvdtMediaQueue::DropExpired(uint64_t now_us) {
+  size_t dropped = 0;
+  while (!empty() && now_us - entries_[head_].queued_us > max_delay_us_) {
+    Drop(AVDT_MEDIA_DROP_EXPIRED);
+    dropped++;
+  }
+  return dropped;
+}
+
+size_t AvdtMediaQueue::Flush() {
+  size_t dropped = count_;
+  while (!empty()) Drop(AVDT_MEDIA_DROP_FLUSHED);
+  return dropped;
+}
+
+void AvdtMediaQueue::SetCongested(bool congested, uint64_t now_us) {
+  if (congested == congested_) return;
+  congested_ = congested;
+  if (congested) {
+    stats_.congestion_count++;
+    congested_since_us_ = now_us;
+  } else {
+    stats_.congested_us += now_us - congested_since_us_;
+  }
+}
+
+tAVDT_MEDIA_QUEUE_STATS AvdtMediaQueue::GetStats(uint64_t now_us) const {
+  tAVDT_MEDIA_QUEUE_STATS stats = stats_;
+  stats.depth = count_;
+  if (congested_ && now_us > congested_since_us_)
+    stats.congested_us += now_us - congested_since_us_;
+  return stats;
+}
+
+void AvdtMediaQueue::Reset() {
+  while (!empty()) free_fn_(Take());
+  head_ = 0;
+  congested_ = false;
+  congested_since_us_ = 0;
+  ResetStats(0);
+}
+
+void AvdtMediaQueue::ResetStats(uint64_t now_us) {
+  memset(&stats_, 0, sizeof(stats_));
+  for (size_t i = 0; i < count_; i++)
+    stats_.depth_bytes += entries_[(head_ + i) % entries_.size()].p_pkt->len;
+  stats_.max_depth = count_;
+  // An ongoing congestion only counts from now on
+  if (congested_) {
+    stats_.congestion_count = 1;
+    congested_since_us_ = now_us;
+  } else {
+    congested_since_us_ = 0;
+  }
+}
+
+BT_HDR* AvdtMediaQueue::Take() {
+  BT_HDR* p_pkt = entries_[head_].p_pkt;
+  entries_[head_].p_pkt = nullptr;
+  head_ = (head_ + 1) % entries_.size();
+  count_--;
+  stats_.depth_bytes -= std::min<uint32_t>(stats_.depth_bytes, p_pkt->len);
+  return p_pkt;
+}
+
+void AvdtMediaQueue::Drop(int reason) {
+  stats_.dropped[reason]++;
+  free_fn_(Take());
+}
@@ -0,0 +1,86 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "avdt_api.h"
+
+/* AvdtMediaQueue holds the media packets of a stream waiting for the media
+ * channel to take them.
+ *
+ * The queue is a fixed ring of packets, oldest first, with the time each was
+ * queued. A packet queued for longer than the delay budget would reach the
+ * peer after its play time: it is dropped rather than sent. When the ring is
+ * full, the oldest packet makes room for the new one.
+ *
+ * The queue is only used from the stack thread, and takes no lock. It owns
+ * the packets it holds, and frees the ones it drops with |free_fn|.
+ */
+class AvdtMediaQueue {
+ public:
+  using FreeFn = void (*)(void*);
+
+  AvdtMediaQueue(size_t capacity, uint64_t max_delay_us, FreeFn free_fn);
+  ~AvdtMediaQueue();
+
+  /* Queues |p_pkt| at |now_us|, dropping the oldest packet if full */
+  void Push(BT_HDR* p_pkt, uint64_t now_us);
+  /* Takes the oldest packet to send it, or returns nullptr if empty */
+  BT_HDR* Pop(uint64_t now_us);
+  /* Drops the packets past their deadline at |now_us|. Returns their count. */
+  size_t DropExpired(uint64_t now_us);
+  /* Drops all the packets. Returns their count. */
+  size_t Flush();
+
+  /* Tracks the congestion state of the media channel */
+  void SetCongested(bool congested, uint64_t now_us);
+
+  size_t size() const { return count_; }
+  bool empty() const { return count_ == 0; }
+  size_t capacity() const { return entries_.size(); }
+
+  /* Drops all the packets without counting them, and starts over */
+  void Reset();
+
+  /* Returns the statistics, counting the current congestion up to |now_us| */
+  tAVDT_MEDIA_QUEUE_STATS GetStats(uint64_t now_us) const;
+  /* Starts the statistics over at |now_us|, keeping the current state */
+  void ResetStats(uint64_t now_us);
+
+ private:
+  struct Entry {
+    BT_HDR* p_pkt;
+    uint64_t queued_us;
+  };
+
+  BT_HDR* Take();
+  void Drop(int reason);
+
+  std::vector<Entry> entries_;
+  size_t head_;
+  size_t count_;
+  uint64_t max_delay_us_;
+  FreeFn free_fn_;
+  bool congested_;
+  uint64_t congested_since_us_;
+  tAVDT_MEDIA_QUEUE_STATS stats_;
+};
@@ -34,6 +34,7 @@
 #include "bt_types.h"
 #include "bt_utils.h"
 #include "btu.h"
+#include "common/time_util.h"
 #include "osi/include/osi.h"
 
 /* This table is used to lookup the callback event that matches a particular
@@ -771,8 +772,11 @@ void avdt_scb_hdl_tc_close(AvdtpScb* p_scb, tAVDT_SCB_EVT* p_data) {
   p_scb->media_seq = 0;
   p_scb->cong = false;
 
-  /* free pkt we're holding, if any */
-  osi_free_and_reset((void**)&p_scb->p_pkt);
+  /* free pkts we're holding, if any */
+  p_scb->media_q.Flush();
+  p_scb->media_q.SetCongested(false,
+                              bluetooth::common::time_get_os_boottime_us());
+  p_scb->write_cfm_pending = false;
 
   alarm_cancel(p_scb->transport_channel_timer);
 
@@ -949,9 +953,9 @@ void avdt_scb_hdl_tc_open_sto(AvdtpScb* p_scb, tAVDT_SCB_EVT* p_data) {
  *
  * Function         avdt_scb_hdl_write_req
  *
- * Description      This function frees the media packet currently stored in
- *                  the SCB, if any.  Then it builds a new media packet from
- *                  with the passed in buffer and stores it in the SCB.
+ * Description      This function builds a new media packet from the passed
+ *                  in buffer and queues it in the SCB.  If the queue is full,
+ *                  the oldest packet is dropped.
  *
  * Returns          Nothing.
  *
@@ -961,13 +965,6 @@ void avdt_scb_hdl_write_req(AvdtpScb* p_scb, tAVDT_SCB_EVT* p_data) {
   uint32_t ssrc;
   bool add_rtp_header = !(p_data->apiwrite.opt & AVDT_DATA_OPT_NO_RTP);
 
-  /* free packet we're holding, if any; to be replaced with new */
-  if (p_scb->p_pkt != NULL) {
-    /* this shouldn't be happening */
-    AVDT_TRACE_WARNING("Dropped media packet; congested");
-  }
-  osi_free_and_reset((void**)&p_scb->p_pkt);
-
   /* Recompute only if the RTP header wasn't disabled by the API */
   if (add_rtp_header) {
     bool is_content_protection = (p_scb->curr_cfg.num_protect > 0);
@@ -991,8 +988,14 @@ void avdt_scb_hdl_write_req(AvdtpScb* p_scb, tAVDT_SCB_EVT* p_data) {
     UINT32_TO_BE_STREAM(p, ssrc);
   }
 
-  /* store it */
-  p_scb->p_pkt = p_data->apiwrite.p_buf;
+  /* queue it */
+  if (p_scb->media_q.size() == p_scb->media_q.capacity()) {
+    AVDT_TRACE_WARNING("%s: Dropped oldest media packet; congested",
+                       __func__);
+  }
+  p_scb->media_q.Push(p_data->apiwrite.p_buf,
+                      bluetooth::common::time_get_os_boottime_us());
+  p_scb->write_cfm_pending = true;
 }
 
 /*******************************************************************************
@@ -1068,7 +1071,8 @@ void avdt_scb_snd_close_req(AvdtpScb* p_scb,
  *
  ******************************************************************************/
 void avdt_scb_snd_stream_close(AvdtpScb* p_scb, tAVDT_SCB_EVT* p_data) {
-  osi_free_and_reset((void**)&p_scb->p_pkt);
+  p_scb->media_q.Flush();
+  p_scb->write_cfm_pending = false;
   avdt_scb_snd_close_req(p_scb, p_data);
 }
 
@@ -1379,6 +1383,8 @@ void avdt_scb_cb_err(AvdtpScb* p_scb, UNUSED_ATTR tAVDT_SCB_EVT* p_data) {
  ******************************************************************************/
 void avdt_scb_cong_state(AvdtpScb* p_scb, tAVDT_SCB_EVT* p_data) {
   p_scb->cong = p_data->llcong;
+  p_scb->media_q.SetCongested(p_scb->cong,
+                              bluetooth::common::time_get_os_boottime_us());
 }
 
 /*******************************************************************************
@@ -1476,7 +1482,7 @@ void avdt_scb_free_pkt(AvdtpScb* p_scb, tAVDT_SCB_EVT* p_data) {
  *
  * Function         avdt_scb_clr_pkt
  *
- * Description      This function frees the media packet stored in the SCB.
+ * Description      This function frees the media packets stored in the SCB.
  *
  * Returns          Nothing.
  *
@@ -1500,10 +1506,11 @@ void avdt_scb_clr_pkt(AvdtpScb* p_scb, UNUSED_ATTR tAVDT_SCB_EVT* p_data) {
     L2CA_FlushChannel(lcid, L2CAP_FLUSH_CHANS_ALL);
   }
 
-  if (p_scb->p_pkt != NULL) {
-    osi_free_and_reset((void**)&p_scb->p_pkt);
+  if (!p_scb->media_q.empty()) {
+    size_t dropped = p_scb->media_q.Flush();
+    p_scb->write_cfm_pending = false;
 
-    AVDT_TRACE_DEBUG("Dropped stored media packet");
+    AVDT_TRACE_DEBUG("Dropped %zu stored media packets", dropped);
 
     /* we need to call callback to keep data flow going */
     (*p_scb->stream_config.p_avdt_ctrl_cback)(
@@ -1516,10 +1523,12 @@ void avdt_scb_clr_pkt(AvdtpScb* p_scb, UNUSED_ATTR tAVDT_SCB_EVT* p_data) {
  *
  * Function         avdt_scb_chk_snd_pkt
  *
- * Description      This function checks if the SCB is congested, and if not
- *                  congested it sends a stored media packet, if any.  After it
- *                  sends the packet it calls the application callback function
- *                  with a write confirm.
+ * Description      This function drops the stored media packets past their
+ *                  deadline, then sends the others until the SCB is
+ *                  congested.  It calls the application callback function
+ *                  with a write confirm for the pending write, unless the
+ *                  SCB is congested and the queue is already deep: the
+ *                  confirm then waits for the congestion to clear.
  *
  * Returns          Nothing.
  *
@@ -1527,20 +1536,33 @@ void avdt_scb_clr_pkt(AvdtpScb* p_scb, UNUSED_ATTR tAVDT_SCB_EVT* p_data) {
 void avdt_scb_chk_snd_pkt(AvdtpScb* p_scb, UNUSED_ATTR tAVDT_SCB_EVT* p_data) {
   tAVDT_CTRL avdt_ctrl;
   BT_HDR* p_pkt;
+  uint64_t now_us = bluetooth::common::time_get_os_boottime_us();
 
   avdt_ctrl.hdr.err_code = 0;
 
-  if (!p_scb->cong) {
-    if (p_scb->p_pkt != NULL) {
-      p_pkt = p_scb->p_pkt;
-      p_scb->p_pkt = NULL;
-      avdt_ad_write_req(AVDT_CHAN_MEDIA, p_scb->p_ccb, p_scb, p_pkt);
+  size_t expired = p_scb->media_q.DropExpired(now_us);
+  if (expired > 0) {
+    AVDT_TRACE_WARNING("%s: Dropped %zu expired media packets", __func__,
+                       expired);
+  }
 
-      (*p_scb->stream_config.p_avdt_ctrl_cback)(
-          avdt_scb_to_hdl(p_scb), RawAddress::kEmpty, AVDT_WRITE_CFM_EVT,
-          &avdt_ctrl, p_scb->stream_config.scb_index);
+  /* writing may report the congestion, and bring us back here */
+  while (!p_scb->cong && (p_pkt = p_scb->media_q.Pop(now_us)) != NULL) {
+    if (avdt_ad_write_req(AVDT_CHAN_MEDIA, p_scb->p_ccb, p_scb, p_pkt) ==
+        AVDT_AD_CONGESTED) {
+      p_scb->cong = true;
+      p_scb->media_q.SetCongested(true, now_us);
     }
   }
+
+  if (p_scb->write_cfm_pending &&
+      (!p_scb->cong ||
+       p_scb->media_q.size() < AVDT_MEDIA_QUEUE_PACING_DEPTH)) {
+    p_scb->write_cfm_pending = false;
+    (*p_scb->stream_config.p_avdt_ctrl_cback)(
+        avdt_scb_to_hdl(p_scb), RawAddress::kEmpty, AVDT_WRITE_CFM_EVT,
+        &avdt_ctrl, p_scb->stream_config.scb_index);
+  }
 }
 
 /*******************************************************************************
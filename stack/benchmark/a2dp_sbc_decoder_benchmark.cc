@@ -0,0 +1,179 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "a2dp_sbc_decoder.h"
+#include "bt_types.h"
+#include "embdrv/sbc/decoder/include/oi_codec_sbc.h"
+#include "embdrv/sbc/decoder/include/oi_status.h"
+#include "embdrv/sbc/encoder/include/sbc_encoder.h"
+
+using ::benchmark::State;
+
+// Seconds of audio in the stream, looped over by the benchmarks
+#define STREAM_SECONDS 2
+// SBC frames per A2DP media packet, as most sources send them over 2-DH5
+#define FRAMES_PER_PACKET 5
+
+static const int kBestSimdLevel = -1;
+
+namespace {
+
+// A recorded A2DP stream: BT_HDR media packets holding the 1 byte media
+// payload header followed by the SBC frames, as the sink passes them to
+// a2dp_sbc_decoder_decode_packet(). It is encoded once with the default high
+// quality A2DP configuration: 44.1 kHz joint stereo, 16 blocks, 8 subbands,
+// loudness allocation, bitpool 53.
+class RecordedStream {
+ public:
+  RecordedStream() {
+    SBC_ENC_PARAMS params;
+    memset(&params, 0, sizeof(params));
+    params.s16SamplingFreq = SBC_sf44100;
+    params.s16ChannelMode = SBC_JOINT_STEREO;
+    params.s16NumOfSubBands = SUB_BANDS_8;
+    params.s16NumOfBlocks = 16;
+    params.s16AllocationMethod = SBC_LOUDNESS;
+    params.u16BitRate = 328;
+    SBC_Encoder_Init(&params);
+
+    int frame_samples = params.s16NumOfSubBands * params.s16NumOfBlocks *
+                        params.s16NumOfChannels;
+    int num_packets = STREAM_SECONDS * 44100 * params.s16NumOfChannels /
+                      (frame_samples * FRAMES_PER_PACKET);
+    std::vector<int16_t> pcm(frame_samples);
+    uint8_t frame[1024];
+    int sample = 0;
+    for (int i = 0; i < num_packets; i++) {
+      std::vector<uint8_t> payload = {FRAMES_PER_PACKET};
+      for (int j = 0; j < FRAMES_PER_PACKET; j++) {
+        for (int k = 0; k < frame_samples; k++, sample++) {
+          pcm[k] = 16000 * sin(sample * 0.013) + 4000 * sin(sample * 0.171);
+        }
+        uint32_t len = SBC_Encode(&params, pcm.data(), frame);
+        payload.insert(payload.end(), frame, frame + len);
+        frames_.emplace_back(frame, frame + len);
+      }
+
+      std::vector<uint8_t> packet(sizeof(BT_HDR) + payload.size());
+      BT_HDR* p_buf = reinterpret_cast<BT_HDR*>(packet.data());
+      p_buf->len = payload.size();
+      p_buf->offset = 0;
+      memcpy(p_buf->data, payload.data(), payload.size());
+      packets_.push_back(std::move(packet));
+    }
+  }
+
+  size_t num_packets() const { return packets_.size(); }
+  BT_HDR* packet(size_t i) {
+    return reinterpret_cast<BT_HDR*>(packets_[i].data());
+  }
+
+  // The SBC frames of all packets, without the media payload headers
+  const std::vector<std::vector<uint8_t>>& frames() const { return frames_; }
+
+ private:
+  std::vector<std::vector<uint8_t>> packets_;
+  std::vector<std::vector<uint8_t>> frames_;
+};
+
+RecordedStream& GetRecordedStream() {
+  static RecordedStream* stream = new RecordedStream();
+  return *stream;
+}
+
+size_t decoded_bytes;
+
+void OnDecodedData(uint8_t* /* buf */, uint32_t len) { decoded_bytes += len; }
+
+}  // namespace
+
+// The A2DP sink decode path, one media packet per iteration. items_per_second
+// is the number of SBC frames decoded per second; bytes_per_second counts the
+// PCM produced.
+static void BM_A2dpSbcDecodePacket(State& state) {
+  RecordedStream& stream = GetRecordedStream();
+  if (!a2dp_sbc_decoder_init(OnDecodedData)) {
+    state.SkipWithError("a2dp_sbc_decoder_init failed");
+    return;
+  }
+
+  decoded_bytes = 0;
+  size_t i = 0;
+  for (auto _ : state) {
+    if (!a2dp_sbc_decoder_decode_packet(stream.packet(i))) {
+      state.SkipWithError("a2dp_sbc_decoder_decode_packet failed");
+      break;
+    }
+    i = (i + 1) % stream.num_packets();
+  }
+
+  state.SetItemsProcessed(state.iterations() * FRAMES_PER_PACKET);
+  state.SetBytesProcessed(decoded_bytes);
+  a2dp_sbc_decoder_cleanup();
+}
+
+BENCHMARK(BM_A2dpSbcDecodePacket);
+
+// The same stream straight through OI_CODEC_SBC_DecodeFrame(), one SBC frame
+// per iteration, to compare the scalar and SIMD synthesis. Every benchmark
+// thread owns its own decoder, as with several A2DP sinks streaming at once.
+// Args: SIMD level (kBestSimdLevel for what the CPU has).
+static void BM_SbcDecodeFrame(State& state) {
+  const std::vector<std::vector<uint8_t>>& frames =
+      GetRecordedStream().frames();
+  OI_CODEC_SBC_DECODER_CONTEXT context = {};
+  std::vector<uint32_t> context_data(
+      CODEC_DATA_WORDS(2, SBC_CODEC_FAST_FILTER_BUFFERS));
+  OI_STATUS status = OI_CODEC_SBC_DecoderReset(
+      &context, context_data.data(), context_data.size() * sizeof(uint32_t),
+      2, 2, false);
+  if (!OI_SUCCESS(status)) {
+    state.SkipWithError("OI_CODEC_SBC_DecoderReset failed");
+    return;
+  }
+  if (state.range(0) != kBestSimdLevel) {
+    context.common.simdLevel = state.range(0);
+  }
+
+  int16_t pcm[SBC_MAX_SAMPLES_PER_FRAME * SBC_MAX_CHANNELS];
+  size_t i = 0;
+  for (auto _ : state) {
+    const OI_BYTE* data = frames[i].data();
+    uint32_t data_size = frames[i].size();
+    uint32_t pcm_bytes = sizeof(pcm);
+    status = OI_CODEC_SBC_DecodeFrame(&context, &data, &data_size, pcm,
+                                      &pcm_bytes);
+    if (!OI_SUCCESS(status)) {
+      state.SkipWithError("OI_CODEC_SBC_DecodeFrame failed");
+      break;
+    }
+    i = (i + 1) % frames.size();
+  }
+
+  state.SetItemsProcessed(state.iterations());
+  state.SetLabel(context.common.simdLevel == OI_SBC_SIMD_NONE ? "scalar"
+                                                              : "simd");
+}
+
+BENCHMARK(BM_SbcDecodeFrame)->Arg(OI_SBC_SIMD_NONE)->Arg(kBestSimdLevel);
+
+BENCHMARK(BM_SbcDecodeFrame)->Arg(kBestSimdLevel)->Threads(2)->Threads(4);
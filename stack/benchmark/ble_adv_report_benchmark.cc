@@ -0,0 +1,338 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <string.h>
+
+#include <functional>
+#include <list>
+#include <random>
+#include <vector>
+
+#include "btif/include/btif_ble_scan_batch.h"
+#include "stack/btm/btm_ble_adv_cache.h"
+#include "stack/btm/btm_inq_db_index.h"
+#include "stack/include/advertise_data_parser.h"
+
+using ::benchmark::State;
+
+// Advertising reports per replayed trace
+#define NUM_EVENTS 4096
+// Reports the jni thread takes in one go when batched; a burst of reports
+// arrives while it is busy with the previous ones
+#define JNI_BATCH 64
+
+namespace {
+
+// Event types, as btm_ble_process_adv_pkt() maps the legacy ones
+const uint16_t kAdvInd = 0x0013;
+const uint16_t kAdvNonconnInd = 0x0010;
+const uint16_t kScanRspToAdvInd = 0x001B;
+const uint16_t kExtAdv = 0x0000;
+const uint16_t kExtAdvMoreData = 0x0020;
+
+// An advertising report, as found in an LE (Extended) Advertising Report event
+struct Report {
+  uint16_t evt_type;
+  uint8_t addr_type;
+  RawAddress bda;
+  int8_t rssi;
+  uint8_t data_len;
+  uint8_t data[229];
+};
+
+// Dense scan trace: |num_devices| advertisers around, of which a third send
+// connectable advertisements followed by scan responses, a third
+// non-connectable beacons padded with zeros, and a third extended
+// advertisements chained over two reports. Replayed in order.
+std::vector<Report> DenseScanTrace(int num_devices) {
+  std::mt19937 rng(num_devices);
+  std::vector<Report> trace;
+  while (trace.size() < NUM_EVENTS) {
+    int device = rng() % num_devices;
+    Report r = {};
+    r.addr_type = 0x01;
+    r.bda = RawAddress({0xC0, 0x00, 0x00, (uint8_t)(device >> 16),
+                        (uint8_t)(device >> 8), (uint8_t)device});
+    r.rssi = -40 - (int8_t)(rng() % 50);
+
+    // Flags, then manufacturer specific data
+    uint8_t ad[] = {0x02, 0x01, 0x06, 0x1B, 0xFF, 0x4C, 0x00};
+    switch (device % 3) {
+      case 0:
+        r.evt_type = kAdvInd;
+        r.data_len = 31;
+        memcpy(r.data, ad, sizeof(ad));
+        r.data[3] = 31 - 4;
+        trace.push_back(r);
+        r.evt_type = kScanRspToAdvInd;
+        r.data_len = 31;
+        memset(r.data, 0, sizeof(r.data));
+        r.data[0] = 12;
+        r.data[1] = 0x09;  // Complete local name
+        memcpy(r.data + 2, "Dense scan", 10);
+        trace.push_back(r);
+        break;
+      case 1:
+        r.evt_type = kAdvNonconnInd;
+        r.data_len = 31;
+        memcpy(r.data, ad, sizeof(ad));
+        r.data[3] = 20;
+        trace.push_back(r);
+        break;
+      case 2:
+        r.evt_type = kExtAdvMoreData;
+        r.data_len = 229;
+        memcpy(r.data, ad, sizeof(ad));
+        r.data[3] = 254;
+        trace.push_back(r);
+        r.evt_type = kExtAdv;
+        r.data_len = 30;
+        trace.push_back(r);
+        break;
+    }
+  }
+  return trace;
+}
+
+// The advertising cache btm_ble_gap.cc used to keep: up to 8 devices in a
+// list, looked up linearly, data moved in as a new vector per report
+class ListCache {
+ public:
+  const std::vector<uint8_t>& Set(uint8_t addr_type, const RawAddress& addr,
+                                  std::vector<uint8_t> data) {
+    auto it = Find(addr_type, addr);
+    if (it != items.end()) {
+      it->data = std::move(data);
+      return it->data;
+    }
+    if (items.size() > 7) items.pop_back();
+    items.push_front({addr_type, addr, std::move(data)});
+    return items.front().data;
+  }
+
+  const std::vector<uint8_t>& Append(uint8_t addr_type, const RawAddress& addr,
+                                     std::vector<uint8_t> data) {
+    auto it = Find(addr_type, addr);
+    if (it != items.end()) {
+      it->data.insert(it->data.end(), data.begin(), data.end());
+      return it->data;
+    }
+    if (items.size() > 7) items.pop_back();
+    items.push_front({addr_type, addr, std::move(data)});
+    return items.front().data;
+  }
+
+  void Clear(uint8_t addr_type, const RawAddress& addr) {
+    auto it = Find(addr_type, addr);
+    if (it != items.end()) items.erase(it);
+  }
+
+ private:
+  struct Item {
+    uint8_t addr_type;
+    RawAddress addr;
+    std::vector<uint8_t> data;
+  };
+
+  std::list<Item>::iterator Find(uint8_t addr_type, const RawAddress& addr) {
+    for (auto it = items.begin(); it != items.end(); it++) {
+      if (it->addr_type == addr_type && it->addr == addr) return it;
+    }
+    return items.end();
+  }
+
+  std::list<Item> items;
+};
+
+bool is_legacy(uint16_t evt_type) { return evt_type & (1 << 4); }
+bool is_scannable(uint16_t evt_type) { return evt_type & (1 << 1); }
+bool is_scan_resp(uint16_t evt_type) { return evt_type & (1 << 3); }
+bool is_complete(uint16_t evt_type) { return ((evt_type >> 5) & 3) != 0x01; }
+
+// The inquiry database both pipelines keep the reported devices in
+class InquiryDb {
+ public:
+  InquiryDb() : index_(db_, BTM_INQ_DB_SIZE) {}
+
+  tINQ_DB_ENT* LinearFind(const RawAddress& bda) {
+    for (tINQ_DB_ENT& ent : db_) {
+      if (ent.in_use && ent.inq_info.results.remote_bd_addr == bda)
+        return &ent;
+    }
+    return nullptr;
+  }
+
+  tINQ_DB_ENT* IndexFind(const RawAddress& bda) { return index_.Find(bda); }
+
+  // As btm_inq_db_new(): a free entry, or else the oldest
+  tINQ_DB_ENT* New(const RawAddress& bda, bool indexed) {
+    tINQ_DB_ENT* p_old = &db_[0];
+    for (tINQ_DB_ENT& ent : db_) {
+      if (!ent.in_use) {
+        p_old = &ent;
+        break;
+      }
+      if (ent.time_of_resp < p_old->time_of_resp) p_old = &ent;
+    }
+    if (indexed && p_old->in_use) index_.Remove(p_old);
+    memset(p_old, 0, sizeof(tINQ_DB_ENT));
+    p_old->inq_info.results.remote_bd_addr = bda;
+    p_old->in_use = true;
+    p_old->time_of_resp = ++now_;
+    if (indexed) index_.Add(p_old);
+    return p_old;
+  }
+
+ private:
+  tINQ_DB_ENT db_[BTM_INQ_DB_SIZE] = {};
+  InquiryDbIndex index_;
+  uint64_t now_ = 0;
+};
+
+void ScanResultCallback(const RawAddress& bda, int8_t rssi,
+                        std::vector<uint8_t> data) {
+  benchmark::DoNotOptimize(bda);
+  benchmark::DoNotOptimize(rssi);
+  benchmark::DoNotOptimize(data.data());
+}
+
+// The report pipeline before: copy out of the event, into the list cache, a
+// linear inquiry database lookup, and one task per report to the jni thread
+// carrying its own copy of the data
+class CopyingPipeline {
+ public:
+  void Process(const Report& r) {
+    std::vector<uint8_t> tmp(r.data, r.data + r.data_len);
+    bool is_start = is_legacy(r.evt_type) && is_scannable(r.evt_type) &&
+                    !is_scan_resp(r.evt_type);
+    if (is_legacy(r.evt_type)) AdvertiseDataParser::RemoveTrailingZeros(tmp);
+
+    const std::vector<uint8_t>& adv_data =
+        is_start ? cache_.Set(r.addr_type, r.bda, std::move(tmp))
+                 : cache_.Append(r.addr_type, r.bda, std::move(tmp));
+    if (!is_complete(r.evt_type)) return;
+    if (is_start) return;
+    if (!AdvertiseDataParser::IsValid(adv_data)) return;
+
+    tINQ_DB_ENT* p_i = db_.LinearFind(r.bda);
+    if (p_i == nullptr) p_i = db_.New(r.bda, false);
+    p_i->inq_info.results.rssi = r.rssi;
+
+    std::vector<uint8_t> value(adv_data.begin(), adv_data.end());
+    jni_tasks_.push_back(std::bind(ScanResultCallback, r.bda, r.rssi,
+                                   std::move(value)));
+    if (jni_tasks_.size() == JNI_BATCH) RunJniThread();
+
+    cache_.Clear(r.addr_type, r.bda);
+  }
+
+  void RunJniThread() {
+    for (auto& task : jni_tasks_) task();
+    jni_tasks_.clear();
+  }
+
+ private:
+  ListCache cache_;
+  InquiryDb db_;
+  std::vector<std::function<void()>> jni_tasks_;
+};
+
+// The report pipeline now: complete reports are read in place, the rest is
+// reassembled in the hashed cache, the inquiry database is indexed, and
+// results go to the jni thread in batches
+class BatchedPipeline {
+ public:
+  BatchedPipeline() : cache_(64, 2000) {}
+
+  void Process(const Report& r, uint64_t now_ms) {
+    bool is_start = is_legacy(r.evt_type) && is_scannable(r.evt_type) &&
+                    !is_scan_resp(r.evt_type);
+    size_t len = r.data_len;
+    if (is_legacy(r.evt_type))
+      len = AdvertiseDataParser::LengthWithoutTrailingZeros(r.data, len);
+    bool complete = is_complete(r.evt_type);
+
+    const uint8_t* adv_data = r.data;
+    size_t adv_data_len = len;
+    if (!complete || is_start || cache_.Contains(r.addr_type, r.bda)) {
+      const std::vector<uint8_t>* p_cached =
+          is_start ? cache_.Set(r.addr_type, r.bda, r.data, len, !complete,
+                                now_ms)
+                   : cache_.Append(r.addr_type, r.bda, r.data, len, !complete,
+                                   now_ms);
+      if (p_cached == nullptr || !complete || is_start) return;
+      adv_data = p_cached->data();
+      adv_data_len = p_cached->size();
+    }
+    if (!AdvertiseDataParser::IsValid(adv_data, adv_data_len)) return;
+
+    tINQ_DB_ENT* p_i = db_.IndexFind(r.bda);
+    if (p_i == nullptr) p_i = db_.New(r.bda, true);
+    p_i->inq_info.results.rssi = r.rssi;
+
+    ScanResult result = {};
+    result.bd_addr = r.bda;
+    result.rssi = r.rssi;
+    batch_.Add(result, adv_data, adv_data_len);
+    if (++pending_ == JNI_BATCH) RunJniThread();
+
+    cache_.Clear(r.addr_type, r.bda);
+  }
+
+  void RunJniThread() {
+    batch_.Deliver([](const ScanResult& r, const uint8_t* data, size_t len) {
+      ScanResultCallback(r.bd_addr, r.rssi,
+                         std::vector<uint8_t>(data, data + len));
+    });
+    pending_ = 0;
+  }
+
+ private:
+  AdvertisingCache cache_;
+  InquiryDb db_;
+  ScanResultBatch batch_;
+  int pending_ = 0;
+};
+
+}  // namespace
+
+// Replays a dense scan trace through the report pipeline, from advertising
+// report to scan result callback. Args: advertisers around.
+static void BM_ReplayDenseScanCopying(State& state) {
+  std::vector<Report> trace = DenseScanTrace(state.range(0));
+  CopyingPipeline pipeline;
+  for (auto _ : state) {
+    for (const Report& r : trace) pipeline.Process(r);
+    pipeline.RunJniThread();
+  }
+  state.SetItemsProcessed(state.iterations() * trace.size());
+}
+
+BENCHMARK(BM_ReplayDenseScanCopying)->Arg(50)->Arg(200)->Arg(1000);
+
+static void BM_ReplayDenseScanBatched(State& state) {
+  std::vector<Report> trace = DenseScanTrace(state.range(0));
+  BatchedPipeline pipeline;
+  uint64_t now_ms = 0;
+  for (auto _ : state) {
+    for (const Report& r : trace) pipeline.Process(r, now_ms++);
+    pipeline.RunJniThread();
+  }
+  state.SetItemsProcessed(state.iterations() * trace.size());
+}
+
+BENCHMARK(BM_ReplayDenseScanBatched)->Arg(50)->Arg(200)->Arg(1000);
@@ -0,0 +1,201 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "stack/btm/btm_dev_index.h"
+#include "stack/crypto_toolbox/crypto_toolbox.h"
+
+using ::benchmark::State;
+
+// Bonded LE devices, each with its own IRK
+#define NUM_BONDS 200
+// Advertising reports carrying an RPA in one scan, resolved per iteration
+#define NUM_REPORTS 10000
+// Percentage of the reports coming from devices that are not bonded
+#define STRANGER_PERCENT 20
+
+namespace {
+
+// Same construction as generate_rpa_from_irk_and_rand() in btm_ble_addr.cc
+RawAddress make_rpa(const Octet16& irk, uint32_t prand) {
+  uint8_t rand[3] = {static_cast<uint8_t>(prand),
+                     static_cast<uint8_t>(prand >> 8),
+                     static_cast<uint8_t>(((prand >> 16) & 0x3f) | 0x40)};
+  RawAddress rpa;
+  rpa.address[2] = rand[0];
+  rpa.address[1] = rand[1];
+  rpa.address[0] = rand[2];
+  Octet16 hash = crypto_toolbox::aes_128(irk, rand, 3);
+  rpa.address[5] = hash[0];
+  rpa.address[4] = hash[1];
+  rpa.address[3] = hash[2];
+  return rpa;
+}
+
+// NUM_BONDS bonded LE devices, as btm_cb.sec_dev_rec holds them after
+// btif_storage restored the bonds.
+class Bonds {
+ public:
+  Bonds() {
+    std::mt19937 rng(7);
+    for (int i = 0; i < NUM_BONDS; i++) {
+      records_.emplace_back(new tBTM_SEC_DEV_REC());
+      tBTM_SEC_DEV_REC* p_dev_rec = records_.back().get();
+      for (uint8_t& b : p_dev_rec->bd_addr.address) b = rng();
+      for (uint8_t& b : p_dev_rec->ble.keys.irk) b = rng();
+      p_dev_rec->ble.identity_addr = p_dev_rec->bd_addr;
+      p_dev_rec->ble.pseudo_addr = p_dev_rec->bd_addr;
+      p_dev_rec->device_type = BT_DEVICE_TYPE_BLE;
+      p_dev_rec->ble.key_type = BTM_LE_KEY_PENC | BTM_LE_KEY_PID;
+      p_dev_rec->hci_handle = BTM_SEC_INVALID_HANDLE;
+      p_dev_rec->ble_hci_handle = BTM_SEC_INVALID_HANDLE;
+    }
+  }
+
+  const std::vector<std::unique_ptr<tBTM_SEC_DEV_REC>>& records() const {
+    return records_;
+  }
+
+  // NUM_REPORTS reports drawn from |num_rpas| distinct RPAs. Bonded devices
+  // advertise with RPAs derived from their IRK; strangers with RPAs no bond
+  // resolves.
+  std::vector<RawAddress> Reports(int num_rpas) const {
+    std::mt19937 rng(num_rpas);
+    std::vector<RawAddress> rpas;
+    Octet16 stranger_irk{};
+    for (int i = 0; i < num_rpas; i++) {
+      if (static_cast<int>(rng() % 100) < STRANGER_PERCENT) {
+        for (uint8_t& b : stranger_irk) b = rng();
+        rpas.push_back(make_rpa(stranger_irk, rng()));
+      } else {
+        rpas.push_back(
+            make_rpa(records_[rng() % records_.size()]->ble.keys.irk, rng()));
+      }
+    }
+
+    std::vector<RawAddress> reports;
+    for (int i = 0; i < NUM_REPORTS; i++) {
+      reports.push_back(i < num_rpas ? rpas[i] : rpas[rng() % num_rpas]);
+    }
+    return reports;
+  }
+
+ private:
+  std::vector<std::unique_ptr<tBTM_SEC_DEV_REC>> records_;
+};
+
+Bonds& GetBonds() {
+  static Bonds* bonds = new Bonds();
+  return *bonds;
+}
+
+}  // namespace
+
+// The record walk btm_ble_resolve_random_addr() used to do: one AES-128 per
+// bonded LE device until an IRK matches. Args: distinct RPAs in the scan.
+static void BM_ResolveRpaListWalk(State& state) {
+  Bonds& bonds = GetBonds();
+  std::vector<RawAddress> reports = bonds.Reports(state.range(0));
+
+  int resolved = 0;
+  for (auto _ : state) {
+    for (const RawAddress& rpa : reports) {
+      for (const auto& p_dev_rec : bonds.records()) {
+        if ((p_dev_rec->device_type & BT_DEVICE_TYPE_BLE) &&
+            (p_dev_rec->ble.key_type & BTM_LE_KEY_PID) &&
+            rpa_matches_irk(rpa, p_dev_rec->ble.keys.irk)) {
+          resolved++;
+          break;
+        }
+      }
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * reports.size());
+  state.counters["resolved"] = resolved / state.iterations();
+}
+
+BENCHMARK(BM_ResolveRpaListWalk)->Arg(64)->Arg(512)->Arg(NUM_REPORTS);
+
+// DeviceRecordIndex::Resolve() as btm_ble_resolve_random_addr() now calls it.
+// The cache starts cold every iteration, so the first report of every RPA
+// still pays for the walk. Args: distinct RPAs in the scan, RPA cache size.
+static void BM_ResolveRpaIndex(State& state) {
+  Bonds& bonds = GetBonds();
+  std::vector<RawAddress> reports = bonds.Reports(state.range(0));
+
+  int resolved = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    DeviceRecordIndex index(state.range(1));
+    for (const auto& p_dev_rec : bonds.records()) index.Add(p_dev_rec.get());
+    state.ResumeTiming();
+
+    for (const RawAddress& rpa : reports) {
+      if (index.Resolve(rpa) != nullptr) resolved++;
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * reports.size());
+  state.counters["resolved"] = resolved / state.iterations();
+}
+
+BENCHMARK(BM_ResolveRpaIndex)
+    ->Args({64, 0})
+    ->Args({64, DeviceRecordIndex::kDefaultRpaCacheSize})
+    ->Args({512, DeviceRecordIndex::kDefaultRpaCacheSize})
+    ->Args({NUM_REPORTS, DeviceRecordIndex::kDefaultRpaCacheSize});
+
+// btm_find_dev() for an identity address, walking the records as
+// list_foreach() did against a hash lookup. Resolvable addresses are left
+// out, so neither side runs AES.
+static void BM_FindByAddressListWalk(State& state) {
+  Bonds& bonds = GetBonds();
+  size_t i = 0;
+  for (auto _ : state) {
+    const RawAddress& bd_addr = bonds.records()[i]->bd_addr;
+    for (const auto& p_dev_rec : bonds.records()) {
+      if (p_dev_rec->bd_addr == bd_addr ||
+          p_dev_rec->ble.pseudo_addr == bd_addr) {
+        benchmark::DoNotOptimize(p_dev_rec.get());
+        break;
+      }
+    }
+    i = (i + 1) % bonds.records().size();
+  }
+}
+
+BENCHMARK(BM_FindByAddressListWalk);
+
+static void BM_FindByAddressIndex(State& state) {
+  Bonds& bonds = GetBonds();
+  DeviceRecordIndex index;
+  for (const auto& p_dev_rec : bonds.records()) index.Add(p_dev_rec.get());
+
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        index.FindByAddress(bonds.records()[i]->bd_addr));
+    i = (i + 1) % bonds.records().size();
+  }
+}
+
+BENCHMARK(BM_FindByAddressIndex);
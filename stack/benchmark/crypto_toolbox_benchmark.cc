@@ -0,0 +1,151 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include "stack/crypto_toolbox/crypto_toolbox.h"
+
+using ::benchmark::State;
+using crypto_toolbox::AesImpl;
+
+// Bonded devices whose IRKs a resolvable private address is checked against
+#define NUM_IRKS 200
+
+namespace {
+
+const char* ImplName(AesImpl impl) {
+  switch (impl) {
+    case AesImpl::BYTE:
+      return "byte";
+    case AesImpl::TTABLE:
+      return "ttable";
+    case AesImpl::AESNI:
+      return "aesni";
+  }
+  return "unknown";
+}
+
+// Switches to the implementation in Arg 0 for the lifetime of the benchmark
+class ScopedAesImpl {
+ public:
+  explicit ScopedAesImpl(State& state)
+      : saved_(crypto_toolbox::aes_get_impl()) {
+    AesImpl impl = static_cast<AesImpl>(state.range(0));
+    supported_ = crypto_toolbox::aes_set_impl(impl);
+    if (!supported_) state.SkipWithError("not supported by this CPU");
+    state.SetLabel(ImplName(impl));
+  }
+  ~ScopedAesImpl() { crypto_toolbox::aes_set_impl(saved_); }
+
+  bool supported() const { return supported_; }
+
+ private:
+  AesImpl saved_;
+  bool supported_;
+};
+
+Octet16 Pattern(uint8_t seed) {
+  Octet16 x;
+  for (uint8_t& b : x) b = seed += 0x3b;
+  return x;
+}
+
+void AllImpls(benchmark::internal::Benchmark* b) {
+  for (AesImpl impl : {AesImpl::BYTE, AesImpl::TTABLE, AesImpl::AESNI}) {
+    b->Arg(static_cast<int>(impl));
+  }
+}
+
+}  // namespace
+
+// One block under a new key, as aes_128() does for every call
+static void BM_Aes128(State& state) {
+  ScopedAesImpl scoped_impl(state);
+  if (!scoped_impl.supported()) return;
+
+  Octet16 key = Pattern(1);
+  Octet16 message = Pattern(2);
+  for (auto _ : state) {
+    message = crypto_toolbox::aes_128(key, message);
+  }
+  benchmark::DoNotOptimize(message);
+  state.SetBytesProcessed(state.iterations() * OCTET16_LEN);
+}
+
+BENCHMARK(BM_Aes128)->Apply(AllImpls);
+
+// Args: implementation, message length. 12 bytes is a signed ATT write
+// without its signature, 65 bytes the f4() message of LE Secure Connections.
+static void BM_AesCmac(State& state) {
+  ScopedAesImpl scoped_impl(state);
+  if (!scoped_impl.supported()) return;
+
+  Octet16 key = Pattern(3);
+  std::vector<uint8_t> message(state.range(1), 0x5a);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        crypto_toolbox::aes_cmac(key, message.data(), message.size()));
+  }
+  state.SetBytesProcessed(state.iterations() * message.size());
+}
+
+BENCHMARK(BM_AesCmac)->Apply([](benchmark::internal::Benchmark* b) {
+  for (AesImpl impl : {AesImpl::BYTE, AesImpl::TTABLE, AesImpl::AESNI}) {
+    for (int length : {12, 65, 256}) b->Args({static_cast<int>(impl), length});
+  }
+});
+
+// Hashing one RPA's prand under NUM_IRKS keys, one aes_128() call per IRK as
+// rpa_matches_irk() does. items_per_second counts blocks.
+static void BM_Aes128PerIrk(State& state) {
+  ScopedAesImpl scoped_impl(state);
+  if (!scoped_impl.supported()) return;
+
+  std::vector<Octet16> irks;
+  for (int i = 0; i < NUM_IRKS; i++) irks.push_back(Pattern(i));
+  Octet16 prand{0x94, 0x81, 0x70};
+  std::vector<Octet16> hashes(NUM_IRKS);
+  for (auto _ : state) {
+    for (int i = 0; i < NUM_IRKS; i++) {
+      hashes[i] = crypto_toolbox::aes_128(irks[i], prand);
+    }
+    benchmark::DoNotOptimize(hashes.data());
+  }
+  state.SetItemsProcessed(state.iterations() * NUM_IRKS);
+}
+
+BENCHMARK(BM_Aes128PerIrk)->Apply(AllImpls);
+
+// The same blocks through aes_128_batch(), as DeviceRecordIndex does
+static void BM_Aes128Batch(State& state) {
+  ScopedAesImpl scoped_impl(state);
+  if (!scoped_impl.supported()) return;
+
+  std::vector<Octet16> irks;
+  for (int i = 0; i < NUM_IRKS; i++) irks.push_back(Pattern(i));
+  std::vector<Octet16> prands(NUM_IRKS, Octet16{0x94, 0x81, 0x70});
+  std::vector<Octet16> hashes(NUM_IRKS);
+  for (auto _ : state) {
+    crypto_toolbox::aes_128_batch(irks.data(), prands.data(), hashes.data(),
+                                  NUM_IRKS);
+    benchmark::DoNotOptimize(hashes.data());
+  }
+  state.SetItemsProcessed(state.iterations() * NUM_IRKS);
+}
+
+BENCHMARK(BM_Aes128Batch)->Apply(AllImpls);
@@ -0,0 +1,230 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <list>
+#include <random>
+#include <vector>
+
+#include "stack/gatt/gatt_db_index.h"
+
+using ::benchmark::State;
+using bluetooth::Uuid;
+
+// Characteristics per service, each with a declaration, a value and a CCCD
+#define NUM_CHARS 5
+// Attribute handles per service
+#define SERVICE_SIZE (1 + 3 * NUM_CHARS)
+// Read By Type results that fit the default LE MTU of 23: 7 bytes each
+#define READ_BY_TYPE_RESULTS 3
+// Handle lookups per iteration
+#define NUM_REQUESTS 1000
+
+namespace {
+
+const Uuid kPrimaryService = Uuid::From16Bit(GATT_UUID_PRI_SERVICE);
+const Uuid kCharDecl = Uuid::From16Bit(GATT_UUID_CHAR_DECLARE);
+const Uuid kCccd = Uuid::From16Bit(GATT_UUID_CHAR_CLIENT_CONFIG);
+
+// A server database of |num_services| services, started one after another
+// from GATT_APP_START_HANDLE as GATTS_AddService() assigns them.
+class ServerDb {
+ public:
+  explicit ServerDb(int num_services) {
+    uint16_t handle = GATT_APP_START_HANDLE;
+    for (int i = 0; i < num_services; i++) {
+      dbs_.emplace_back();
+      tGATT_SVC_DB& db = dbs_.back();
+      services_.emplace_back();
+      tGATT_SRV_LIST_ELEM& el = services_.back();
+      el.s_hdl = handle;
+      el.p_db = &db;
+      el.type = GATT_UUID_PRI_SERVICE;
+
+      AddAttr(db, handle++, kPrimaryService);
+      for (int c = 0; c < NUM_CHARS; c++) {
+        AddAttr(db, handle++, kCharDecl);
+        AddAttr(db, handle++, Uuid::From16Bit(0x2A00 + i * NUM_CHARS + c));
+        AddAttr(db, handle++, kCccd);
+      }
+      el.e_hdl = handle - 1;
+    }
+
+    for (auto it = services_.begin(); it != services_.end(); it++)
+      index_.AddService(it);
+  }
+
+  // The service and attribute walk gatts_process_attribute_req() used to do
+  tGATT_ATTR* ListWalkFind(uint16_t handle) {
+    for (tGATT_SRV_LIST_ELEM& el : services_) {
+      if (el.s_hdl <= handle && el.e_hdl >= handle) {
+        for (tGATT_ATTR& attr : el.p_db->attr_list) {
+          if (attr.handle == handle) return &attr;
+        }
+        return nullptr;
+      }
+    }
+    return nullptr;
+  }
+
+  // The walk gatts_process_read_by_type_req() used to do over every service
+  // overlapping the request, then over every attribute of each. Returns the
+  // last handle put in the response, or 0 if none.
+  uint16_t ListWalkReadByType(const Uuid& type, uint16_t s_hdl,
+                              uint16_t e_hdl) {
+    uint16_t last = 0;
+    int results = 0;
+    for (tGATT_SRV_LIST_ELEM& el : services_) {
+      if (el.s_hdl > e_hdl || el.e_hdl < s_hdl) continue;
+      for (tGATT_ATTR& attr : el.p_db->attr_list) {
+        if (attr.handle >= s_hdl && type == attr.uuid) {
+          if (results == READ_BY_TYPE_RESULTS) return last;
+          last = attr.handle;
+          results++;
+        }
+      }
+    }
+    return last;
+  }
+
+  uint16_t IndexReadByType(const Uuid& type, uint16_t s_hdl, uint16_t e_hdl) {
+    uint16_t last = 0;
+    int results = 0;
+    for (const GattDbIndex::Entry& entry :
+         index_.FindByType(type, s_hdl, e_hdl)) {
+      if (results == READ_BY_TYPE_RESULTS) break;
+      last = entry.handle;
+      results++;
+    }
+    return last;
+  }
+
+  // Handles of every attribute but the service declarations, at random
+  std::vector<uint16_t> Requests() const {
+    std::mt19937 rng(services_.size());
+    std::vector<uint16_t> requests;
+    uint16_t first = GATT_APP_START_HANDLE;
+    uint16_t last = services_.back().e_hdl;
+    while (requests.size() < NUM_REQUESTS) {
+      uint16_t handle = first + rng() % (last - first + 1);
+      if ((handle - first) % SERVICE_SIZE != 0) requests.push_back(handle);
+    }
+    return requests;
+  }
+
+  GattDbIndex index_;
+
+ private:
+  static void AddAttr(tGATT_SVC_DB& db, uint16_t handle, const Uuid& uuid) {
+    db.attr_list.emplace_back();
+    db.attr_list.back().handle = handle;
+    db.attr_list.back().uuid = uuid;
+  }
+
+  std::list<tGATT_SVC_DB> dbs_;
+  std::list<tGATT_SRV_LIST_ELEM> services_;
+};
+
+}  // namespace
+
+// Read and Write Requests: finding the attribute behind a handle.
+// Args: services in the database.
+static void BM_FindAttrListWalk(State& state) {
+  ServerDb db(state.range(0));
+  std::vector<uint16_t> requests = db.Requests();
+  for (auto _ : state) {
+    for (uint16_t handle : requests)
+      benchmark::DoNotOptimize(db.ListWalkFind(handle));
+  }
+  state.SetItemsProcessed(state.iterations() * requests.size());
+}
+
+BENCHMARK(BM_FindAttrListWalk)->Arg(10)->Arg(40)->Arg(100);
+
+static void BM_FindAttrIndex(State& state) {
+  ServerDb db(state.range(0));
+  std::vector<uint16_t> requests = db.Requests();
+  for (auto _ : state) {
+    for (uint16_t handle : requests)
+      benchmark::DoNotOptimize(db.index_.Find(handle));
+  }
+  state.SetItemsProcessed(state.iterations() * requests.size());
+}
+
+BENCHMARK(BM_FindAttrIndex)->Arg(10)->Arg(40)->Arg(100);
+
+// Discover All Characteristics of the whole database: Read By Type Requests
+// for the characteristic declaration, each starting after the last handle
+// of the previous response. Args: services in the database.
+static void BM_DiscoverCharsListWalk(State& state) {
+  ServerDb db(state.range(0));
+  int requests = 0;
+  for (auto _ : state) {
+    uint16_t s_hdl = 1;
+    uint16_t last;
+    do {
+      last = db.ListWalkReadByType(kCharDecl, s_hdl, 0xFFFF);
+      s_hdl = last + 1;
+      requests++;
+    } while (last != 0 && last != 0xFFFF);
+  }
+  state.SetItemsProcessed(requests);
+}
+
+BENCHMARK(BM_DiscoverCharsListWalk)->Arg(10)->Arg(40)->Arg(100);
+
+static void BM_DiscoverCharsIndex(State& state) {
+  ServerDb db(state.range(0));
+  int requests = 0;
+  for (auto _ : state) {
+    uint16_t s_hdl = 1;
+    uint16_t last;
+    do {
+      last = db.IndexReadByType(kCharDecl, s_hdl, 0xFFFF);
+      s_hdl = last + 1;
+      requests++;
+    } while (last != 0 && last != 0xFFFF);
+  }
+  state.SetItemsProcessed(requests);
+}
+
+BENCHMARK(BM_DiscoverCharsIndex)->Arg(10)->Arg(40)->Arg(100);
+
+// Starting and stopping one service in a full database, as an app
+// registering its GATT server does. Args: services in the database.
+static void BM_RestartService(State& state) {
+  ServerDb db(state.range(0));
+  std::list<tGATT_SRV_LIST_ELEM> services;
+  tGATT_SVC_DB svc_db;
+  uint16_t s_hdl = 0xF000;
+  for (int i = 0; i < SERVICE_SIZE; i++) {
+    svc_db.attr_list.emplace_back();
+    svc_db.attr_list.back().handle = s_hdl + i;
+    svc_db.attr_list.back().uuid = i % 3 == 1 ? kCharDecl : kCccd;
+  }
+  services.emplace_back();
+  services.back().s_hdl = s_hdl;
+  services.back().e_hdl = s_hdl + SERVICE_SIZE - 1;
+  services.back().p_db = &svc_db;
+
+  for (auto _ : state) {
+    db.index_.AddService(services.begin());
+    db.index_.RemoveService(services.begin());
+  }
+}
+
+BENCHMARK(BM_RestartService)->Arg(10)->Arg(40)->Arg(100);
@@ -0,0 +1,110 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <string.h>
+#include <random>
+
+#include "stack/smp/p_256_ecc_pp.h"
+
+using ::benchmark::State;
+
+namespace {
+
+// Random private keys, as smp_create_private_key() draws them
+void RandomKey(std::mt19937* rng, uint32_t* key) {
+  for (int i = 0; i < KEY_LENGTH_DWORDS_P256; i++) key[i] = (*rng)();
+}
+
+}  // namespace
+
+// smp_process_private_key(): the local public key, before this change
+static void BM_PublicKeyBinNaf(State& state) {
+  p_256_init_curve(KEY_LENGTH_DWORDS_P256);
+  std::mt19937 rng(1);
+  uint32_t key[KEY_LENGTH_DWORDS_P256];
+  Point public_key;
+  for (auto _ : state) {
+    state.PauseTiming();
+    RandomKey(&rng, key);
+    Point base = curve_p256.G;
+    state.ResumeTiming();
+    ECC_PointMult_Bin_NAF(&public_key, &base, key, KEY_LENGTH_DWORDS_P256);
+    benchmark::DoNotOptimize(public_key);
+  }
+}
+
+BENCHMARK(BM_PublicKeyBinNaf)->Unit(benchmark::kMicrosecond);
+
+// smp_process_private_key(): the local public key, through the fixed base comb
+static void BM_PublicKeyComb(State& state) {
+  std::mt19937 rng(1);
+  uint32_t key[KEY_LENGTH_DWORDS_P256];
+  Point public_key;
+  for (auto _ : state) {
+    state.PauseTiming();
+    RandomKey(&rng, key);
+    state.ResumeTiming();
+    ECC_PointMult_Base(&public_key, key);
+    benchmark::DoNotOptimize(public_key);
+  }
+}
+
+BENCHMARK(BM_PublicKeyComb)->Unit(benchmark::kMicrosecond);
+
+// smp_compute_dhkey(): the shared key from the peer's public key, before this
+// change
+static void BM_DhKeyBinNaf(State& state) {
+  p_256_init_curve(KEY_LENGTH_DWORDS_P256);
+  std::mt19937 rng(2);
+  uint32_t key[KEY_LENGTH_DWORDS_P256];
+  Point peer_key;
+  RandomKey(&rng, key);
+  ECC_PointMult_Base(&peer_key, key);
+
+  Point dhkey;
+  for (auto _ : state) {
+    state.PauseTiming();
+    RandomKey(&rng, key);
+    Point peer = peer_key;
+    state.ResumeTiming();
+    ECC_PointMult_Bin_NAF(&dhkey, &peer, key, KEY_LENGTH_DWORDS_P256);
+    benchmark::DoNotOptimize(dhkey);
+  }
+}
+
+BENCHMARK(BM_DhKeyBinNaf)->Unit(benchmark::kMicrosecond);
+
+// smp_compute_dhkey(): the shared key, through the Montgomery ladder
+static void BM_DhKeyLadder(State& state) {
+  std::mt19937 rng(2);
+  uint32_t key[KEY_LENGTH_DWORDS_P256];
+  Point peer_key;
+  RandomKey(&rng, key);
+  ECC_PointMult_Base(&peer_key, key);
+
+  Point dhkey;
+  for (auto _ : state) {
+    state.PauseTiming();
+    RandomKey(&rng, key);
+    state.ResumeTiming();
+    ECC_PointMult_Ladder(&dhkey, peer_key, key);
+    benchmark::DoNotOptimize(dhkey);
+  }
+}
+
+BENCHMARK(BM_DhKeyLadder)->Unit(benchmark::kMicrosecond);
@@ -33,6 +33,7 @@
 #include "hcimsgs.h"
 
 #include "btm_ble_int.h"
+#include "btm_dev_index.h"
 #include "stack/crypto_toolbox/crypto_toolbox.h"
 
 /* This function generates Resolvable Private Address (RPA) from Identity
@@ -162,36 +163,13 @@ bool btm_ble_init_pseudo_addr(tBTM_SEC_DEV_REC* p_dev_rec,
                               const RawAddress& new_pseudo_addr) {
   if (p_dev_rec->ble.pseudo_addr.IsEmpty()) {
     p_dev_rec->ble.pseudo_addr = new_pseudo_addr;
+    btm_update_dev_index(p_dev_rec);
     return true;
   }
 
   return false;
 }
 
-/* Return true if given Resolvable Privae Address |rpa| matches Identity
- * Resolving Key |irk| */
-static bool rpa_matches_irk(const RawAddress& rpa, const Octet16& irk) {
-  /* use the 3 MSB of bd address as prand */
-  uint8_t rand[3];
-  rand[0] = rpa.address[2];
-  rand[1] = rpa.address[1];
-  rand[2] = rpa.address[0];
-
-  /* generate X = E irk(R0, R1, R2) and R is random address 3 LSO */
-  Octet16 x = crypto_toolbox::aes_128(irk, &rand[0], 3);
-
-  rand[0] = rpa.address[5];
-  rand[1] = rpa.address[4];
-  rand[2] = rpa.address[3];
-
-  if (memcmp(x.data(), &rand[0], 3) == 0) {
-    // match
-    return true;
-  }
-  // not a match
-  return false;
-}
-
 /** This function checks if a RPA is resolvable by the device key.
  *  Returns true is resolvable; false otherwise.
  */
@@ -211,32 +189,6 @@ bool btm_ble_addr_resolvable(const RawAddress& rpa,
   return false;
 }
 
-/** This function match the random address to the appointed device record,
- * starting from calculating IRK. If the record index exceeds the maximum record
- * number, matching failed and send a callback. */
-static bool btm_ble_match_random_bda(void* data, void* context) {
-  BTM_TRACE_EVENT("%s next iteration", __func__);
-  RawAddress* random_bda = (RawAddress*)context;
-
-  tBTM_SEC_DEV_REC* p_dev_rec = static_cast<tBTM_SEC_DEV_REC*>(data);
-
-  BTM_TRACE_DEBUG("sec_flags = %02x device_type = %d", p_dev_rec->sec_flags,
-                  p_dev_rec->device_type);
-
-  if (!(p_dev_rec->device_type & BT_DEVICE_TYPE_BLE) ||
-      !(p_dev_rec->ble.key_type & BTM_LE_KEY_PID))
-    return true;
-
-  if (rpa_matches_irk(*random_bda, p_dev_rec->ble.keys.irk)) {
-    BTM_TRACE_EVENT("match is found");
-    // if it was match, finish iteration, otherwise continue
-    return false;
-  }
-
-  // not a match, continue iteration
-  return true;
-}
-
 /** This function is called to resolve a random address.
  * Returns pointer to the security record of the device whom a random address is
  * matched to.
@@ -244,13 +196,8 @@ static bool btm_ble_match_random_bda(void* data, void* context) {
 tBTM_SEC_DEV_REC* btm_ble_resolve_random_addr(const RawAddress& random_bda) {
   BTM_TRACE_EVENT("%s", __func__);
 
-  /* start to resolve random address */
-  /* check for next security record */
-
-  list_node_t* n = list_foreach(btm_cb.sec_dev_rec, btm_ble_match_random_bda,
-                                (void*)&random_bda);
-  tBTM_SEC_DEV_REC* p_dev_rec = nullptr;
-  if (n != nullptr) p_dev_rec = static_cast<tBTM_SEC_DEV_REC*>(list_node(n));
+  /* resolve against the IRK of every bonded LE device, or a cached result */
+  tBTM_SEC_DEV_REC* p_dev_rec = btm_cb.sec_dev_index->Resolve(random_bda);
 
   BTM_TRACE_EVENT("%s:  %sresolved", __func__,
                   (p_dev_rec == nullptr ? "not " : ""));
@@ -264,21 +211,17 @@ tBTM_SEC_DEV_REC* btm_ble_resolve_random_addr(const RawAddress& random_bda) {
 tBTM_SEC_DEV_REC* btm_find_dev_by_identity_addr(const RawAddress& bd_addr,
                                                 uint8_t addr_type) {
 #if (BLE_PRIVACY_SPT == TRUE)
-  list_node_t* end = list_end(btm_cb.sec_dev_rec);
-  for (list_node_t* node = list_begin(btm_cb.sec_dev_rec); node != end;
-       node = list_next(node)) {
-    tBTM_SEC_DEV_REC* p_dev_rec =
-        static_cast<tBTM_SEC_DEV_REC*>(list_node(node));
-    if (p_dev_rec->ble.identity_addr == bd_addr) {
-      if ((p_dev_rec->ble.identity_addr_type & (~BLE_ADDR_TYPE_ID_BIT)) !=
-          (addr_type & (~BLE_ADDR_TYPE_ID_BIT)))
-        BTM_TRACE_WARNING(
-            "%s find pseudo->random match with diff addr type: %d vs %d",
-            __func__, p_dev_rec->ble.identity_addr_type, addr_type);
-
-      /* found the match */
-      return p_dev_rec;
-    }
+  tBTM_SEC_DEV_REC* p_dev_rec =
+      btm_cb.sec_dev_index->FindByIdentityAddress(bd_addr);
+  if (p_dev_rec != NULL) {
+    if ((p_dev_rec->ble.identity_addr_type & (~BLE_ADDR_TYPE_ID_BIT)) !=
+        (addr_type & (~BLE_ADDR_TYPE_ID_BIT)))
+      BTM_TRACE_WARNING(
+          "%s find pseudo->random match with diff addr type: %d vs %d",
+          __func__, p_dev_rec->ble.identity_addr_type, addr_type);
+
+    /* found the match */
+    return p_dev_rec;
   }
 #endif
 
@@ -0,0 +1,221 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "btm_ble_adv_cache.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+
+namespace {
+
+/* Legacy advertising data followed by its scan response, the most that most
+ * devices ever store */
+constexpr size_t kInitialDataLen = 2 * 31;
+
+}  // namespace
+
+AdvertisingCache::AdvertisingCache(size_t capacity, uint64_t expiry_ms)
+    : expiry_ms_(expiry_ms) {
+  Configure(capacity, expiry_ms);
+}
+
+void AdvertisingCache::Configure(size_t capacity, uint64_t expiry_ms) {
+  if (capacity == 0) capacity = 1;
+
+  slots_.clear();
+  slots_.resize(capacity);
+  for (size_t i = 0; i < capacity; i++) {
+    slots_[i].data.reserve(kInitialDataLen);
+    slots_[i].next = (i + 1 < capacity) ? i + 1 : kNone;
+  }
+
+  size_t num_buckets = 1;
+  while (num_buckets < 2 * capacity) num_buckets <<= 1;
+  buckets_.assign(num_buckets, kNone);
+  mask_ = num_buckets - 1;
+
+  head_ = tail_ = kNone;
+  free_ = 0;
+  size_ = 0;
+  expiry_ms_ = expiry_ms;
+}
+
+size_t AdvertisingCache::Bucket(uint8_t addr_type,
+                                const RawAddress& addr) const {
+  uint64_t key = addr_type;
+  for (uint8_t b : addr.address) key = (key << 8) | b;
+  return ((key * 0x9E3779B97F4A7C15ull) >> 32) & mask_;
+}
+
+size_t AdvertisingCache::Probe(uint8_t addr_type,
+                               const RawAddress& addr) const {
+  size_t bucket = Bucket(addr_type, addr);
+  while (buckets_[bucket] != kNone) {
+    const Slot& slot = slots_[buckets_[bucket]];
+    if (slot.addr_type == addr_type && slot.addr == addr) break;
+    bucket = (bucket + 1) & mask_;
+  }
+  return bucket;
+}
+
+int32_t AdvertisingCache::Lookup(uint8_t addr_type,
+                                 const RawAddress& addr) const {
+  return buckets_[Probe(addr_type, addr)];
+}
+
+void AdvertisingCache::Unlink(int32_t slot) {
+  Slot& s = slots_[slot];
+  if (s.prev != kNone) {
+    slots_[s.prev].next = s.next;
+  } else {
+    head_ = s.next;
+  }
+  if (s.next != kNone) {
+    slots_[s.next].prev = s.prev;
+  } else {
+    tail_ = s.prev;
+  }
+}
+
+void AdvertisingCache::PushFront(int32_t slot) {
+  Slot& s = slots_[slot];
+  s.prev = kNone;
+  s.next = head_;
+  if (head_ != kNone) slots_[head_].prev = slot;
+  head_ = slot;
+  if (tail_ == kNone) tail_ = slot;
+}
+
+int32_t AdvertisingCache::Insert(uint8_t addr_type, const RawAddress& addr) {
+  if (size_ == slots_.size()) {
+    stats_.evicted++;
+    if (slots_[tail_].more_data) stats_.incomplete_chains++;
+    Remove(tail_);
+  }
+
+  int32_t slot = free_;
+  Slot& s = slots_[slot];
+  free_ = s.next;
+  s.addr_type = addr_type;
+  s.addr = addr;
+  s.data.clear();
+  buckets_[Probe(addr_type, addr)] = slot;
+  PushFront(slot);
+  size_++;
+  stats_.inserted++;
+  return slot;
+}
+
+void AdvertisingCache::Remove(int32_t slot) {
+  Slot& s = slots_[slot];
+  size_t hole = Probe(s.addr_type, s.addr);
+  buckets_[hole] = kNone;
+
+  // Shift back the devices that probed past the freed bucket, so that no
+  // probe stops short of them
+  size_t bucket = hole;
+  while (true) {
+    bucket = (bucket + 1) & mask_;
+    int32_t moved = buckets_[bucket];
+    if (moved == kNone) break;
+
+    size_t home = Bucket(slots_[moved].addr_type, slots_[moved].addr);
+    if (((bucket - home) & mask_) >= ((bucket - hole) & mask_)) {
+      buckets_[hole] = moved;
+      buckets_[bucket] = kNone;
+      hole = bucket;
+    }
+  }
+
+  Unlink(slot);
+  s.next = free_;
+  free_ = slot;
+  size_--;
+}
+
+void AdvertisingCache::DropExpired(uint64_t now_ms) {
+  if (expiry_ms_ == 0) return;
+
+  // The list is in update order, so expired devices are all at its tail
+  while (tail_ != kNone && now_ms > slots_[tail_].updated_ms &&
+         now_ms - slots_[tail_].updated_ms > expiry_ms_) {
+    stats_.expired++;
+    if (slots_[tail_].more_data) stats_.incomplete_chains++;
+    Remove(tail_);
+  }
+}
+
+const std::vector<uint8_t>* AdvertisingCache::Store(
+    uint8_t addr_type, const RawAddress& addr, const uint8_t* data, size_t len,
+    bool append, bool more_data, uint64_t now_ms) {
+  DropExpired(now_ms);
+
+  int32_t slot = Lookup(addr_type, addr);
+  if (slot == kNone) {
+    slot = Insert(addr_type, addr);
+  } else {
+    Unlink(slot);
+    PushFront(slot);
+    if (!append) slots_[slot].data.clear();
+  }
+
+  Slot& s = slots_[slot];
+  if (s.data.size() + len > kMaxDataLen) {
+    stats_.overflowed++;
+    Remove(slot);
+    return nullptr;
+  }
+
+  s.data.insert(s.data.end(), data, data + len);
+  s.updated_ms = now_ms;
+  s.more_data = more_data;
+  return &s.data;
+}
+
+const std::vector<uint8_t>* AdvertisingCache::Set(uint8_t addr_type,
+                                                  const RawAddress& addr,
+                                                  const uint8_t* data,
+                                                  size_t len, bool more_data,
+                                                  uint64_t now_ms) {
+  return Store(addr_type, addr, data, len, false, more_data, now_ms);
+}
+
+const std::vector<uint8_t>* AdvertisingCache::Append(uint8_t addr_type,
+                                                     const RawAddress& addr,
+                                                     const uint8_t* data,
+                                                     size_t len, bool more_data,
+                                                     uint64_t now_ms) {
+  return Store(addr_type, addr, data, len, true, more_data, now_ms);
+}
+
+void AdvertisingCache::Clear(uint8_t addr_type, const RawAddress& addr) {
+  int32_t slot = Lookup(addr_type, addr);
+  if (slot != kNone) Remove(slot);
+}
+
+void AdvertisingCache::Dump(int fd) const {
+  dprintf(fd, "\nLE advertising data cache:\n");
+  dprintf(fd, "  Devices: %zu of %zu, expiring after %" PRIu64 " ms\n", size_,
+          slots_.size(), expiry_ms_);
+  dprintf(fd, "  Stored: %" PRIu64 "\n", stats_.inserted);
+  dprintf(fd, "  Evicted: %" PRIu64 "\n", stats_.evicted);
+  dprintf(fd, "  Expired: %" PRIu64 "\n", stats_.expired);
+  dprintf(fd, "  Incomplete chains dropped: %" PRIu64 "\n",
+          stats_.incomplete_chains);
+  dprintf(fd, "  Too long, dropped: %" PRIu64 "\n", stats_.overflowed);
+}
@@ -0,0 +1,138 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "types/raw_address.h"
+
+/* AdvertisingCache holds the advertising data of the devices that are waiting
+ * for either a scan response, or chained packets on the secondary channel,
+ * until the data is complete and can be reported.
+ *
+ * Devices are looked up through an open addressing hash table keyed by address
+ * type and address. When the cache is full, the least recently updated device
+ * is evicted. Devices that were not updated for longer than the expiry time
+ * are dropped, as the rest of their data is not coming anymore.
+ *
+ * Every slot keeps its data buffer when it is reused, so once the buffers have
+ * grown to the size of the data seen, storing data does not allocate.
+ */
+class AdvertisingCache {
+ public:
+  /* Advertising data is at most 1650 bytes long, Core 5.0 Vol 6, Part B, 2.3.4.
+   * Longer chains are malformed and dropped. */
+  static constexpr size_t kMaxDataLen = 1650;
+
+  struct Stats {
+    /* devices stored */
+    uint64_t inserted;
+    /* devices pushed out by newer ones while waiting for more data */
+    uint64_t evicted;
+    /* devices dropped after waiting for more data for too long */
+    uint64_t expired;
+    /* evicted or expired devices whose chained packets were incomplete */
+    uint64_t incomplete_chains;
+    /* devices whose data grew over kMaxDataLen */
+    uint64_t overflowed;
+  };
+
+  /* Holds up to |capacity| devices, each for up to |expiry_ms| after its last
+   * update; 0 means no expiry */
+  AdvertisingCache(size_t capacity, uint64_t expiry_ms);
+
+  /* Drops every device, then holds up to |capacity| devices for up to
+   * |expiry_ms| each from now on */
+  void Configure(size_t capacity, uint64_t expiry_ms);
+
+  /* Set the data to |data| for device |addr_type, addr|, at time |now_ms|.
+   * |more_data| tells whether chained packets carrying the rest of the data
+   * are to follow. Returns the data now cached for the device, valid until the
+   * next call, or nullptr if it was dropped for being too long. */
+  const std::vector<uint8_t>* Set(uint8_t addr_type, const RawAddress& addr,
+                                  const uint8_t* data, size_t len,
+                                  bool more_data, uint64_t now_ms);
+
+  /* Append |data| for device |addr_type, addr|, like Set() */
+  const std::vector<uint8_t>* Append(uint8_t addr_type, const RawAddress& addr,
+                                     const uint8_t* data, size_t len,
+                                     bool more_data, uint64_t now_ms);
+
+  /* Clear data for device |addr_type, addr| */
+  void Clear(uint8_t addr_type, const RawAddress& addr);
+
+  /* Returns true if data is cached for device |addr_type, addr| */
+  bool Contains(uint8_t addr_type, const RawAddress& addr) const {
+    return Lookup(addr_type, addr) != kNone;
+  }
+
+  size_t size() const { return size_; }
+  size_t capacity() const { return slots_.size(); }
+  uint64_t expiry_ms() const { return expiry_ms_; }
+  const Stats& stats() const { return stats_; }
+
+  /* Writes the cache state and counters to |fd| */
+  void Dump(int fd) const;
+
+ private:
+  static constexpr int32_t kNone = -1;
+
+  struct Slot {
+    uint8_t addr_type;
+    RawAddress addr;
+    std::vector<uint8_t> data;
+    uint64_t updated_ms;
+    bool more_data;
+    /* neighbours in the LRU list, or the next free slot */
+    int32_t prev;
+    int32_t next;
+  };
+
+  const std::vector<uint8_t>* Store(uint8_t addr_type, const RawAddress& addr,
+                                    const uint8_t* data, size_t len,
+                                    bool append, bool more_data,
+                                    uint64_t now_ms);
+
+  size_t Bucket(uint8_t addr_type, const RawAddress& addr) const;
+  /* Returns the bucket holding |addr_type, addr|, or the empty bucket where it
+   * would go */
+  size_t Probe(uint8_t addr_type, const RawAddress& addr) const;
+  int32_t Lookup(uint8_t addr_type, const RawAddress& addr) const;
+  int32_t Insert(uint8_t addr_type, const RawAddress& addr);
+  void Remove(int32_t slot);
+  void DropExpired(uint64_t now_ms);
+
+  void Unlink(int32_t slot);
+  void PushFront(int32_t slot);
+
+  std::vector<Slot> slots_;
+  /* slot indexes, kNone for empty buckets; a power of two at least twice the
+   * capacity long */
+  std::vector<int32_t> buckets_;
+  size_t mask_ = 0;
+  /* most and least recently updated devices */
+  int32_t head_ = kNone;
+  int32_t tail_ = kNone;
+  int32_t free_ = kNone;
+  size_t size_ = 0;
+  uint64_t expiry_ms_;
+  Stats stats_ = {};
+};
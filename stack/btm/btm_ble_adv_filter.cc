@@ -23,6 +23,7 @@
 #include "bt_types.h"
 #include "bt_utils.h"
 #include "btm_ble_api.h"
+#include "btm_ble_scan_filter.h"
 #include "btm_int.h"
 #include "btu.h"
 #include "device/include/controller.h"
@@ -31,6 +32,7 @@
 
 #include <string.h>
 #include <algorithm>
+#include <memory>
 #include <vector>
 
 #include <base/bind.h>
@@ -58,6 +60,9 @@ using bluetooth::Uuid;
 tBTM_BLE_ADV_FILTER_CB btm_ble_adv_filt_cb;
 tBTM_BLE_VSC_CB cmn_ble_vsc_cb;
 
+/* Filters run on the host, when the controller has none */
+static std::unique_ptr<HostScanFilter> host_scan_filter;
+
 static uint8_t btm_ble_cs_update_pf_counter(tBTM_BLE_SCAN_COND_OP action,
                                             uint8_t cond_type,
                                             tBLE_BD_ADDR* p_bd_addr,
@@ -604,6 +609,16 @@ void BTM_LE_PF_set(tBTM_BLE_PF_FILT_INDEX filt_index,
     return;
   }
 
+  if (host_scan_filter) {
+    for (const ApcfCommand& cmd : commands) {
+      if (!host_scan_filter->AddCondition(filt_index, cmd))
+        LOG(ERROR) << __func__ << ": Invalid filter condition, type: "
+                   << +cmd.type;
+    }
+    cb.Run(0, 0, 0);
+    return;
+  }
+
   int action = BTM_BLE_SCAN_COND_ADD;
   for (const ApcfCommand& cmd : commands) {
     /* If data is passed, both mask and data have to be the same length */
@@ -672,6 +687,12 @@ void BTM_LE_PF_clear(tBTM_BLE_PF_FILT_INDEX filt_index,
     return;
   }
 
+  if (host_scan_filter) {
+    host_scan_filter->ClearFilter(filt_index);
+    cb.Run(host_scan_filter->available(), BTM_BLE_SCAN_COND_CLEAR, 0);
+    return;
+  }
+
   /* clear the general filter entry */
   {
     tBTM_BLE_PF_CFG_CBACK fDoNothing;
@@ -749,6 +770,21 @@ void BTM_BleAdvFilterParamSetup(
     return;
   }
 
+  if (host_scan_filter) {
+    if (BTM_BLE_SCAN_COND_ADD == action) {
+      if (!host_scan_filter->SetParams(filt_index, *p_filt_params)) {
+        cb.Run(0, BTM_BLE_PF_ENABLE, 1 /* BTA_FAILURE */);
+        return;
+      }
+    } else if (BTM_BLE_SCAN_COND_DELETE == action) {
+      host_scan_filter->DeleteParams(filt_index);
+    } else if (BTM_BLE_SCAN_COND_CLEAR == action) {
+      host_scan_filter->ClearParams();
+    }
+    cb.Run(host_scan_filter->available(), action, 0);
+    return;
+  }
+
   p = param;
   memset(param, 0, len);
   BTM_TRACE_EVENT("%s", __func__);
@@ -867,6 +903,12 @@ void BTM_BleEnableDisableFilterFeature(uint8_t enable,
     return;
   }
 
+  if (host_scan_filter) {
+    host_scan_filter->Enable(enable);
+    if (p_stat_cback) p_stat_cback.Run(enable, 0);
+    return;
+  }
+
   uint8_t param[20];
   memset(param, 0, 20);
 
@@ -895,8 +937,15 @@ void btm_ble_adv_filter_init(void) {
 
   BTM_BleGetVendorCapabilities(&cmn_ble_vsc_cb);
 
+  host_scan_filter.reset();
   if (!is_filtering_supported()) return;
 
+  if (cmn_ble_vsc_cb.host_scan_offload) {
+    host_scan_filter =
+        std::make_unique<HostScanFilter>(cmn_ble_vsc_cb.max_filter);
+    return;
+  }
+
   if (cmn_ble_vsc_cb.max_filter > 0) {
     btm_ble_adv_filt_cb.p_addr_filter_count = (tBTM_BLE_PF_COUNT*)osi_malloc(
         sizeof(tBTM_BLE_PF_COUNT) * cmn_ble_vsc_cb.max_filter);
@@ -916,4 +965,41 @@ void btm_ble_adv_filter_init(void) {
  ******************************************************************************/
 void btm_ble_adv_filter_cleanup(void) {
   osi_free_and_reset((void**)&btm_ble_adv_filt_cb.p_addr_filter_count);
+  host_scan_filter.reset();
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_ble_host_scan_filter_may_match
+ *
+ * Description      This function checks whether the filters run on the host
+ *                  can take any report from a device, before its advertising
+ *                  data is reassembled.
+ *
+ * Parameters       bda - address of the device
+ *
+ * Returns          false if every report from the device is dropped
+ *
+ ******************************************************************************/
+bool btm_ble_host_scan_filter_may_match(const RawAddress& bda) {
+  return !host_scan_filter || host_scan_filter->MayMatch(bda);
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_ble_host_scan_filter_match
+ *
+ * Description      This function runs the filters on the host over a report.
+ *
+ * Parameters       bda - address of the device
+ *                  rssi - RSSI of the report
+ *                  data, len - advertising data of the report
+ *
+ * Returns          HostScanFilter delivery flags, 0 to drop the report
+ *
+ ******************************************************************************/
+uint8_t btm_ble_host_scan_filter_match(const RawAddress& bda, int8_t rssi,
+                                       const uint8_t* data, size_t len) {
+  if (!host_scan_filter) return HostScanFilter::kReportNow;
+  return host_scan_filter->Match(bda, rssi, data, len);
 }
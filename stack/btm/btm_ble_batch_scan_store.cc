@@ -0,0 +1,184 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "btm_ble_batch_scan_store.h"
+
+#include <string.h>
+#include <algorithm>
+
+#include "btm_api_types.h"
+#include "btm_ble_api_types.h"
+
+namespace {
+
+/* The advertising data of a full result is split in an advertising packet and
+ * a scan response of up to this length each; longer data is truncated */
+constexpr size_t kMaxPacketLen = 255;
+
+/* Unit of the result age, in milliseconds */
+constexpr uint64_t kTimeUnitMs = 50;
+
+}  // namespace
+
+BatchScanStore::BatchScanStore(size_t capacity) : capacity_(capacity) {
+  Configure(50, 50, 0);
+}
+
+void BatchScanStore::Configure(uint8_t full_max, uint8_t trunc_max,
+                               uint8_t notify_threshold) {
+  full_.capacity = capacity_ * full_max / 100;
+  truncated_.capacity = capacity_ * trunc_max / 100;
+  notify_threshold_ = notify_threshold;
+
+  full_.results.reserve(kMaxResults);
+  truncated_.results.reserve(kMaxResults);
+  full_.data.reserve(full_.capacity);
+  Clear();
+}
+
+void BatchScanStore::SetMode(uint8_t scan_mode, uint8_t discard_rule) {
+  scan_mode_ = scan_mode;
+  discard_rule_ = discard_rule;
+}
+
+size_t BatchScanStore::ResultLen(uint8_t format, size_t data_len) {
+  if (format == kTruncated) return kTruncatedResultLen;
+  /* both packet lengths, then the data */
+  return kTruncatedResultLen + 2 + data_len;
+}
+
+bool BatchScanStore::Add(const RawAddress& bda, uint8_t addr_type,
+                         int8_t tx_power, int8_t rssi, const uint8_t* data,
+                         size_t len, uint64_t now_ms) {
+  Result result = {};
+  result.bda = bda;
+  result.addr_type = addr_type;
+  result.tx_power = tx_power;
+  result.rssi = rssi;
+  result.time_ms = now_ms;
+  result.len = std::min(len, 2 * kMaxPacketLen);
+
+  bool notify = false;
+  if (scan_mode_ & BTM_BLE_BATCH_SCAN_MODE_PASS)
+    notify |= Store(kTruncated, result, data);
+  if (scan_mode_ & BTM_BLE_BATCH_SCAN_MODE_ACTI)
+    notify |= Store(kFull, result, data);
+  return notify;
+}
+
+bool BatchScanStore::Store(uint8_t format, const Result& new_result,
+                           const uint8_t* data) {
+  Part& part = GetPart(format);
+  Result result = new_result;
+  if (format == kTruncated) result.len = 0;
+
+  size_t len = ResultLen(format, result.len);
+  if (len > part.capacity) return false;
+
+  while (part.used + len > part.capacity ||
+         part.results.size() == kMaxResults) {
+    size_t victim = 0;
+    if (discard_rule_ == BTM_BLE_DISCARD_LOWER_RSSI_ITEMS) {
+      for (size_t i = 1; i < part.results.size(); i++) {
+        if (part.results[i].rssi < part.results[victim].rssi) victim = i;
+      }
+      /* The new result is the weakest one */
+      if (result.rssi < part.results[victim].rssi) return false;
+    }
+    Discard(part, victim);
+  }
+
+  if (result.len != 0) {
+    if (part.data.size() + result.len > part.data.capacity()) Compact(part);
+    result.offset = part.data.size();
+    part.data.insert(part.data.end(), data, data + result.len);
+  }
+  part.results.push_back(result);
+  part.used += len;
+
+  if (notify_threshold_ == 0 || part.notified ||
+      part.used * 100 < part.capacity * notify_threshold_)
+    return false;
+  part.notified = true;
+  return true;
+}
+
+void BatchScanStore::Discard(Part& part, size_t i) {
+  part.used -= ResultLen(&part == &full_ ? kFull : kTruncated,
+                         part.results[i].len);
+  part.results.erase(part.results.begin() + i);
+  if (part.results.empty()) part.data.clear();
+}
+
+void BatchScanStore::Compact(Part& part) {
+  size_t position = 0;
+  for (Result& result : part.results) {
+    memmove(part.data.data() + position, part.data.data() + result.offset,
+            result.len);
+    result.offset = position;
+    position += result.len;
+  }
+  part.data.resize(position);
+}
+
+uint8_t BatchScanStore::Read(uint8_t format, uint64_t now_ms,
+                             std::vector<uint8_t>* out) {
+  Part& part = GetPart(format);
+  out->clear();
+  out->reserve(part.used);
+
+  for (const Result& result : part.results) {
+    for (size_t i = 0; i < RawAddress::kLength; i++)
+      out->push_back(result.bda.address[RawAddress::kLength - 1 - i]);
+    out->push_back(result.addr_type);
+    out->push_back(result.tx_power);
+    out->push_back(result.rssi);
+
+    uint64_t age = now_ms > result.time_ms
+                       ? (now_ms - result.time_ms) / kTimeUnitMs
+                       : 0;
+    uint16_t timestamp = std::min(age, (uint64_t)UINT16_MAX);
+    out->push_back(timestamp & 0xff);
+    out->push_back(timestamp >> 8);
+
+    if (format == kTruncated) continue;
+
+    const uint8_t* data = part.data.data() + result.offset;
+    size_t adv_len = std::min((size_t)result.len, kMaxPacketLen);
+    out->push_back(adv_len);
+    out->insert(out->end(), data, data + adv_len);
+    out->push_back(result.len - adv_len);
+    out->insert(out->end(), data + adv_len, data + result.len);
+  }
+
+  uint8_t count = part.results.size();
+  part.results.clear();
+  part.data.clear();
+  part.used = 0;
+  part.notified = false;
+  return count;
+}
+
+void BatchScanStore::Clear() {
+  for (Part* part : {&full_, &truncated_}) {
+    part->results.clear();
+    part->data.clear();
+    part->used = 0;
+    part->notified = false;
+  }
+}
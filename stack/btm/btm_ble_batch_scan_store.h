@@ -0,0 +1,118 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "types/raw_address.h"
+
+/* BatchScanStore keeps the batch scan results on the host, for controllers
+ * that cannot store them, and hands them out in the format the controller
+ * reads them in.
+ *
+ * Like the controller storage, it holds a fixed number of bytes, split between
+ * truncated results (address, RSSI, time) and full results (with advertising
+ * data) by the storage configuration. When a part is full, the oldest result,
+ * or the one with the lowest RSSI, is discarded for the new one. The data of
+ * the full results is kept in one buffer, reserved up front, so storing a
+ * result does not allocate.
+ */
+class BatchScanStore {
+ public:
+  /* Result formats, as the scan modes that store them */
+  static constexpr uint8_t kTruncated = 1;
+  static constexpr uint8_t kFull = 2;
+
+  /* Size of a truncated result: address, address type, TX power, RSSI, time */
+  static constexpr size_t kTruncatedResultLen = 11;
+  /* Results of one format handed out by one read, as it counts them in a
+   * byte */
+  static constexpr size_t kMaxResults = 255;
+
+  /* Holds up to |capacity| bytes of results */
+  explicit BatchScanStore(size_t capacity);
+
+  /* Gives |full_max| and |trunc_max| percent of the storage to full and
+   * truncated results, and asks to be notified when either part is
+   * |notify_threshold| percent full, 0 for never. Drops every result. */
+  void Configure(uint8_t full_max, uint8_t trunc_max,
+                 uint8_t notify_threshold);
+
+  /* Stores results in the formats |scan_mode| asks for, discarding by
+   * |discard_rule| when full */
+  void SetMode(uint8_t scan_mode, uint8_t discard_rule);
+
+  /* Stores a result with |len| bytes of advertising data at |data|, received
+   * at |now_ms|. Returns true if this brought a part to the notify threshold;
+   * the notification is not repeated until that part is read. */
+  bool Add(const RawAddress& bda, uint8_t addr_type, int8_t tx_power,
+           int8_t rssi, const uint8_t* data, size_t len, uint64_t now_ms);
+
+  /* Moves the results in |format| to |out|, in the controller format, with
+   * their age at |now_ms|. Returns the number of results. */
+  uint8_t Read(uint8_t format, uint64_t now_ms, std::vector<uint8_t>* out);
+
+  /* Drops every result */
+  void Clear();
+
+  /* Bytes of results in |format| */
+  size_t used(uint8_t format) const { return GetPart(format).used; }
+
+ private:
+  struct Result {
+    RawAddress bda;
+    uint8_t addr_type;
+    int8_t tx_power;
+    int8_t rssi;
+    uint64_t time_ms;
+    /* advertising data, in |Part::data| */
+    size_t offset;
+    uint16_t len;
+  };
+
+  struct Part {
+    size_t capacity;
+    size_t used;
+    bool notified;
+    std::vector<Result> results;
+    std::vector<uint8_t> data;
+  };
+
+  static size_t ResultLen(uint8_t format, size_t data_len);
+
+  Part& GetPart(uint8_t format) {
+    return format == kFull ? full_ : truncated_;
+  }
+  const Part& GetPart(uint8_t format) const {
+    return format == kFull ? full_ : truncated_;
+  }
+
+  bool Store(uint8_t format, const Result& result, const uint8_t* data);
+  void Discard(Part& part, size_t i);
+  void Compact(Part& part);
+
+  size_t capacity_;
+  uint8_t notify_threshold_ = 0;
+  uint8_t scan_mode_ = 0;
+  uint8_t discard_rule_ = 0;
+  Part full_ = {};
+  Part truncated_ = {};
+};
@@ -19,14 +19,17 @@
 #include <stddef.h>
 #include <stdio.h>
 #include <string.h>
+#include <memory>
 #include <vector>
 #include "bt_target.h"
 
 #include "bt_types.h"
 #include "bt_utils.h"
 #include "btm_ble_api.h"
+#include "btm_ble_batch_scan_store.h"
 #include "btm_int.h"
 #include "btu.h"
+#include "common/time_util.h"
 #include "device/include/controller.h"
 #include "hcimsgs.h"
 
@@ -46,6 +49,10 @@ tBTM_BLE_ADV_TRACK_CB ble_advtrack_cb;
 
 namespace {
 
+/* Results of the batch scan run on the host, when the controller has no
+ * storage for them */
+std::unique_ptr<BatchScanStore> host_batch_scan_store;
+
 bool can_do_batch_scan() {
   if (!controller_get_interface()->supports_ble()) return false;
 
@@ -395,6 +402,13 @@ void BTM_BleSetStorageConfig(uint8_t batch_scan_full_max,
     return;
   }
 
+  if (host_batch_scan_store) {
+    host_batch_scan_store->Configure(batch_scan_full_max, batch_scan_trunc_max,
+                                     batch_scan_notify_threshold);
+    cb.Run(BTM_SUCCESS);
+    return;
+  }
+
   if (BTM_BLE_SCAN_INVALID_STATE == ble_batchscan_cb.cur_state ||
       BTM_BLE_SCAN_DISABLED_STATE == ble_batchscan_cb.cur_state ||
       BTM_BLE_SCAN_DISABLE_CALLED == ble_batchscan_cb.cur_state) {
@@ -443,6 +457,22 @@ void BTM_BleEnableBatchScan(tBTM_BLE_BATCH_SCAN_MODE scan_mode,
     return;
   }
 
+  if (host_batch_scan_store) {
+    ble_batchscan_cb.scan_mode = scan_mode;
+    host_batch_scan_store->SetMode(scan_mode, discard_rule);
+    if (btm_ble_start_host_batch_scan(
+            scan_interval, scan_window,
+            scan_mode & BTM_BLE_BATCH_SCAN_MODE_ACTI) != BTM_CMD_STARTED) {
+      host_batch_scan_store->SetMode(BTM_BLE_BATCH_SCAN_MODE_DISABLE,
+                                     discard_rule);
+      cb.Run(BTM_ERR_PROCESSING);
+      return;
+    }
+    ble_batchscan_cb.cur_state = BTM_BLE_SCAN_ENABLED_STATE;
+    cb.Run(BTM_SUCCESS);
+    return;
+  }
+
   if (BTM_BLE_SCAN_INVALID_STATE == ble_batchscan_cb.cur_state ||
       BTM_BLE_SCAN_DISABLED_STATE == ble_batchscan_cb.cur_state ||
       BTM_BLE_SCAN_DISABLE_CALLED == ble_batchscan_cb.cur_state) {
@@ -469,6 +499,16 @@ void BTM_BleDisableBatchScan(base::Callback<void(uint8_t /* status */)> cb) {
     return;
   }
 
+  if (host_batch_scan_store) {
+    /* the results stored are still read after the scan is disabled */
+    host_batch_scan_store->SetMode(BTM_BLE_BATCH_SCAN_MODE_DISABLE,
+                                   BTM_BLE_DISCARD_OLD_ITEMS);
+    btm_ble_stop_host_batch_scan();
+    ble_batchscan_cb.cur_state = BTM_BLE_SCAN_DISABLED_STATE;
+    cb.Run(BTM_SUCCESS);
+    return;
+  }
+
   btm_ble_set_batchscan_param(
       BTM_BLE_BATCH_SCAN_MODE_DISABLE, ble_batchscan_cb.scan_interval,
       ble_batchscan_cb.scan_window, ble_batchscan_cb.addr_type,
@@ -504,6 +544,14 @@ void BTM_BleReadScanReports(tBTM_BLE_BATCH_SCAN_MODE scan_mode,
     return;
   }
 
+  if (host_batch_scan_store) {
+    std::vector<uint8_t> data;
+    uint8_t num_records = host_batch_scan_store->Read(
+        scan_mode, bluetooth::common::time_get_os_boottime_ms(), &data);
+    cb.Run(BTM_SUCCESS, scan_mode, num_records, std::move(data));
+    return;
+  }
+
   btm_ble_read_batchscan_reports(
       scan_mode, base::Bind(&read_reports_cb, std::vector<uint8_t>(), 0, cb));
   return;
@@ -538,6 +586,14 @@ void btm_ble_batchscan_init(void) {
   BTM_TRACE_EVENT(" btm_ble_batchscan_init");
   memset(&ble_batchscan_cb, 0, sizeof(tBTM_BLE_BATCH_SCAN_CB));
   memset(&ble_advtrack_cb, 0, sizeof(tBTM_BLE_ADV_TRACK_CB));
+
+  host_batch_scan_store.reset();
+  if (btm_cb.cmn_ble_vsc_cb.host_scan_offload) {
+    host_batch_scan_store = std::make_unique<BatchScanStore>(
+        btm_cb.cmn_ble_vsc_cb.tot_scan_results_strg);
+    return;
+  }
+
   BTM_RegisterForVSEvents(btm_ble_batchscan_filter_track_adv_vse_cback, true);
 }
 
@@ -549,4 +605,21 @@ void btm_ble_batchscan_cleanup(void) {
 
   memset(&ble_batchscan_cb, 0, sizeof(tBTM_BLE_BATCH_SCAN_CB));
   memset(&ble_advtrack_cb, 0, sizeof(tBTM_BLE_ADV_TRACK_CB));
+  host_batch_scan_store.reset();
+}
+
+/**
+ * This function stores a report in the batch scan run on the host, and
+ * notifies the threshold callback when the storage fills up to the threshold.
+ **/
+void btm_ble_host_batch_scan_store(const RawAddress& bda, uint8_t addr_type,
+                                   int8_t tx_power, int8_t rssi,
+                                   const uint8_t* data, size_t len) {
+  if (!host_batch_scan_store) return;
+
+  bool notify = host_batch_scan_store->Add(
+      bda, addr_type, tx_power, rssi, data, len,
+      bluetooth::common::time_get_os_boottime_ms());
+  if (notify && ble_batchscan_cb.p_thres_cback != NULL)
+    ble_batchscan_cb.p_thres_cback(ble_batchscan_cb.ref_value);
 }
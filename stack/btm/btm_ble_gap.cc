@@ -30,7 +30,6 @@
 #include <stddef.h>
 #include <stdio.h>
 #include <string.h>
-#include <list>
 #include <vector>
 
 #include "bt_types.h"
@@ -38,13 +37,17 @@
 #include "btm_ble_api.h"
 #include "btm_int.h"
 #include "btu.h"
+#include "common/time_util.h"
 #include "device/include/controller.h"
 #include "gap_api.h"
 #include "hcimsgs.h"
 #include "osi/include/osi.h"
+#include "osi/include/properties.h"
 
 #include "advertise_data_parser.h"
+#include "btm_ble_adv_cache.h"
 #include "btm_ble_int.h"
+#include "btm_ble_scan_filter.h"
 #include "gatt_int.h"
 #include "gattdefs.h"
 #include "l2c_int.h"
@@ -63,79 +66,14 @@
   BTM_VSC_CHIP_CAPABILITY_RSP_LEN
 #define BTM_VSC_CHIP_CAPABILITY_RSP_LEN_M_RELEASE 15
 
-namespace {
-
-class AdvertisingCache {
- public:
-  /* Set the data to |data| for device |addr_type, addr| */
-  const std::vector<uint8_t>& Set(uint8_t addr_type, const RawAddress& addr,
-                                  std::vector<uint8_t> data) {
-    auto it = Find(addr_type, addr);
-    if (it != items.end()) {
-      it->data = std::move(data);
-      return it->data;
-    }
-
-    if (items.size() > cache_max) {
-      items.pop_back();
-    }
-
-    items.emplace_front(addr_type, addr, std::move(data));
-    return items.front().data;
-  }
-
-  /* Append |data| for device |addr_type, addr| */
-  const std::vector<uint8_t>& Append(uint8_t addr_type, const RawAddress& addr,
-                                     std::vector<uint8_t> data) {
-    auto it = Find(addr_type, addr);
-    if (it != items.end()) {
-      it->data.insert(it->data.end(), data.begin(), data.end());
-      return it->data;
-    }
-
-    if (items.size() > cache_max) {
-      items.pop_back();
-    }
-
-    items.emplace_front(addr_type, addr, std::move(data));
-    return items.front().data;
-  }
-
-  /* Clear data for device |addr_type, addr| */
-  void Clear(uint8_t addr_type, const RawAddress& addr) {
-    auto it = Find(addr_type, addr);
-    if (it != items.end()) {
-      items.erase(it);
-    }
-  }
-
- private:
-  struct Item {
-    uint8_t addr_type;
-    RawAddress addr;
-    std::vector<uint8_t> data;
-
-    Item(uint8_t addr_type, const RawAddress& addr, std::vector<uint8_t> data)
-        : addr_type(addr_type), addr(addr), data(data) {}
-  };
-
-  std::list<Item>::iterator Find(uint8_t addr_type, const RawAddress& addr) {
-    for (auto it = items.begin(); it != items.end(); it++) {
-      if (it->addr_type == addr_type && it->addr == addr) {
-        return it;
-      }
-    }
-    return items.end();
-  }
+/* Overrides BTM_BLE_ADV_CACHE_SIZE */
+#define BTM_BLE_ADV_CACHE_SIZE_PROPERTY "persist.bluetooth.advcachesize"
 
-  /* we keep maximum 7 devices in the cache */
-  const size_t cache_max = 7;
-  std::list<Item> items;
-};
+namespace {
 
 /* Devices in this cache are waiting for eiter scan response, or chained packets
  * on secondary channel */
-AdvertisingCache cache;
+AdvertisingCache cache(BTM_BLE_ADV_CACHE_SIZE, BTM_BLE_ADV_CACHE_TIMEOUT_MS);
 
 }  // namespace
 
@@ -470,6 +408,29 @@ tBTM_STATUS BTM_BleObserve(bool start, uint8_t duration,
   return status;
 }
 
+/*******************************************************************************
+ *
+ * Function         btm_ble_host_scan_offload_init
+ *
+ * Description      Runs filtering and batch scan on the host when the
+ *                  controller offers neither.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void btm_ble_host_scan_offload_init(void) {
+#if (BTM_BLE_HOST_SCAN_OFFLOAD == TRUE)
+  tBTM_BLE_VSC_CB* p_vsc_cb = &btm_cb.cmn_ble_vsc_cb;
+  if (p_vsc_cb->max_filter > 0 || p_vsc_cb->tot_scan_results_strg > 0) return;
+
+  BTM_TRACE_DEBUG("%s: filtering and batch scan run on the host", __func__);
+  p_vsc_cb->host_scan_offload = true;
+  p_vsc_cb->filter_support = 1;
+  p_vsc_cb->max_filter = BTM_BLE_HOST_MAX_FILTER;
+  p_vsc_cb->tot_scan_results_strg = BTM_BLE_HOST_SCAN_RESULTS_STORAGE;
+#endif
+}
+
 #if (BLE_VND_INCLUDED == TRUE)
 /*******************************************************************************
  *
@@ -496,6 +457,13 @@ static void btm_ble_vendor_capability_vsc_cmpl_cback(
 
   if (status != HCI_SUCCESS) {
     BTM_TRACE_DEBUG("%s: Status = 0x%02x (0 is success)", __func__, status);
+#if (BTM_BLE_HOST_SCAN_OFFLOAD == TRUE)
+    btm_ble_host_scan_offload_init();
+    btm_ble_adv_filter_init();
+    btm_ble_batchscan_init();
+    if (p_ctrl_le_feature_rd_cmpl_cback != NULL)
+      p_ctrl_le_feature_rd_cmpl_cback(BTM_SUCCESS);
+#endif
     return;
   }
   CHECK(p_vcs_cplt_params->param_len >= BTM_VSC_CHIP_CAPABILITY_RSP_LEN);
@@ -532,6 +500,8 @@ static void btm_ble_vendor_capability_vsc_cmpl_cback(
 
   btm_ble_adv_init();
 
+  btm_ble_host_scan_offload_init();
+
   if (btm_cb.cmn_ble_vsc_cb.max_filter > 0) btm_ble_adv_filter_init();
 
 #if (BLE_PRIVACY_SPT == TRUE)
@@ -1458,8 +1428,8 @@ static void btm_ble_update_adv_flag(uint8_t flag) {
  * Check ADV flag to make sure device is discoverable and match the search
  * condition
  */
-uint8_t btm_ble_is_discoverable(const RawAddress& bda,
-                                std::vector<uint8_t> const& adv_data) {
+uint8_t btm_ble_is_discoverable(const RawAddress& bda, const uint8_t* adv_data,
+                                size_t adv_data_len) {
   uint8_t flag = 0, rt = 0;
   uint8_t data_len;
   tBTM_INQ_PARMS* p_cond = &btm_cb.btm_inq_vars.inqparms;
@@ -1475,9 +1445,9 @@ uint8_t btm_ble_is_discoverable(const RawAddress& bda,
     return rt;
   }
 
-  if (!adv_data.empty()) {
+  if (adv_data_len != 0) {
     const uint8_t* p_flag = AdvertiseDataParser::GetFieldByType(
-        adv_data, BTM_BLE_AD_TYPE_FLAG, &data_len);
+        adv_data, adv_data_len, BTM_BLE_AD_TYPE_FLAG, &data_len);
     if (p_flag != NULL && data_len != 0) {
       flag = *p_flag;
 
@@ -1630,7 +1600,7 @@ void btm_ble_update_inq_result(tINQ_DB_ENT* p_i, uint8_t addr_type,
                                uint8_t primary_phy, uint8_t secondary_phy,
                                uint8_t advertising_sid, int8_t tx_power,
                                int8_t rssi, uint16_t periodic_adv_int,
-                               std::vector<uint8_t> const& data) {
+                               const uint8_t* data, size_t data_len) {
   tBTM_INQ_RESULTS* p_cur = &p_i->inq_info.results;
   uint8_t len;
   tBTM_INQUIRY_VAR_ST* p_inq = &btm_cb.btm_inq_vars;
@@ -1661,13 +1631,13 @@ void btm_ble_update_inq_result(tINQ_DB_ENT* p_i, uint8_t addr_type,
 
   p_i->inq_count = p_inq->inq_counter; /* Mark entry for current inquiry */
 
-  if (!data.empty()) {
-    const uint8_t* p_flag =
-        AdvertiseDataParser::GetFieldByType(data, BTM_BLE_AD_TYPE_FLAG, &len);
+  if (data_len != 0) {
+    const uint8_t* p_flag = AdvertiseDataParser::GetFieldByType(
+        data, data_len, BTM_BLE_AD_TYPE_FLAG, &len);
     if (p_flag != NULL && len != 0) p_cur->flag = *p_flag;
   }
 
-  if (!data.empty()) {
+  if (data_len != 0) {
     /* Check to see the BLE device has the Appearance UUID in the advertising
      * data.  If it does
      * then try to convert the appearance value to a class of device value
@@ -1676,13 +1646,13 @@ void btm_ble_update_inq_result(tINQ_DB_ENT* p_i, uint8_t addr_type,
      * service class.
      */
     const uint8_t* p_uuid16 = AdvertiseDataParser::GetFieldByType(
-        data, BTM_BLE_AD_TYPE_APPEARANCE, &len);
+        data, data_len, BTM_BLE_AD_TYPE_APPEARANCE, &len);
     if (p_uuid16 && len == 2) {
       btm_ble_appearance_to_cod((uint16_t)p_uuid16[0] | (p_uuid16[1] << 8),
                                 p_cur->dev_class);
     } else {
       p_uuid16 = AdvertiseDataParser::GetFieldByType(
-          data, BTM_BLE_AD_TYPE_16SRV_CMPL, &len);
+          data, data_len, BTM_BLE_AD_TYPE_16SRV_CMPL, &len);
       if (p_uuid16 != NULL) {
         uint8_t i;
         for (i = 0; i + 2 <= len; i = i + 2) {
@@ -1733,7 +1703,7 @@ void btm_clear_all_pending_le_entry(void) {
     if ((p_ent->in_use) &&
         (p_ent->inq_info.results.device_type == BT_DEVICE_TYPE_BLE) &&
         !p_ent->scan_rsp)
-      p_ent->in_use = false;
+      btm_inq_db_free(p_ent);
   }
 }
 
@@ -1911,8 +1881,8 @@ static void btm_ble_process_adv_pkt_cont(
   tBTM_INQUIRY_VAR_ST* p_inq = &btm_cb.btm_inq_vars;
   bool update = true;
 
-  std::vector<uint8_t> tmp;
-  if (data_len != 0) tmp.insert(tmp.begin(), data, data + data_len);
+  /* no filter on the host takes reports from this device */
+  if (!btm_ble_host_scan_filter_may_match(bda)) return;
 
   bool is_scannable = ble_evt_type_is_scannable(evt_type);
   bool is_scan_resp = ble_evt_type_is_scan_resp(evt_type);
@@ -1920,35 +1890,69 @@ static void btm_ble_process_adv_pkt_cont(
   bool is_start =
       ble_evt_type_is_legacy(evt_type) && is_scannable && !is_scan_resp;
 
+  size_t len = data_len;
   if (ble_evt_type_is_legacy(evt_type))
-    AdvertiseDataParser::RemoveTrailingZeros(tmp);
-
-  // We might have send scan request to this device before, but didn't get the
-  // response. In such case make sure data is put at start, not appended to
-  // already existing data.
-  std::vector<uint8_t> const& adv_data =
-      is_start ? cache.Set(addr_type, bda, std::move(tmp))
-               : cache.Append(addr_type, bda, std::move(tmp));
+    len = AdvertiseDataParser::LengthWithoutTrailingZeros(data, data_len);
 
   bool data_complete = (ble_evt_type_data_status(evt_type) != 0x01);
 
-  if (!data_complete) {
-    // If we didn't receive whole adv data yet, don't report the device.
-    DVLOG(1) << "Data not complete yet, waiting for more " << bda;
-    return;
-  }
-
   bool is_active_scan =
       btm_cb.ble_ctr_cb.inq_var.scan_type == BTM_BLE_SCAN_MODE_ACTI;
-  if (is_active_scan && is_scannable && !is_scan_resp) {
-    // If we didn't receive scan response yet, don't report the device.
-    DVLOG(1) << " Waiting for scan response " << bda;
-    return;
+  bool wait_scan_resp = is_active_scan && is_scannable && !is_scan_resp;
+
+  const uint8_t* adv_data;
+  size_t adv_data_len;
+  if (data_complete && !wait_scan_resp &&
+      (is_start || !cache.Contains(addr_type, bda))) {
+    // The report holds all of the data, so it is reported straight out of the
+    // HCI event
+    if (is_start) cache.Clear(addr_type, bda);
+    adv_data = data;
+    adv_data_len = len;
+  } else {
+    // We might have send scan request to this device before, but didn't get
+    // the response. In such case make sure data is put at start, not appended
+    // to already existing data.
+    uint64_t now_ms = bluetooth::common::time_get_os_boottime_ms();
+    const std::vector<uint8_t>* p_cached =
+        is_start
+            ? cache.Set(addr_type, bda, data, len, !data_complete, now_ms)
+            : cache.Append(addr_type, bda, data, len, !data_complete, now_ms);
+    if (p_cached == nullptr) {
+      DVLOG(1) << __func__ << ": Dropping too long advertising data " << bda;
+      return;
+    }
+
+    if (!data_complete) {
+      // If we didn't receive whole adv data yet, don't report the device.
+      DVLOG(1) << "Data not complete yet, waiting for more " << bda;
+      return;
+    }
+
+    if (wait_scan_resp) {
+      // If we didn't receive scan response yet, don't report the device.
+      DVLOG(1) << " Waiting for scan response " << bda;
+      return;
+    }
+
+    adv_data = p_cached->data();
+    adv_data_len = p_cached->size();
   }
 
-  if (!AdvertiseDataParser::IsValid(adv_data)) {
+  if (!AdvertiseDataParser::IsValid(adv_data, adv_data_len)) {
     DVLOG(1) << __func__ << "Dropping bad advertisement packet: "
-             << base::HexEncode(adv_data.data(), adv_data.size());
+             << base::HexEncode(adv_data, adv_data_len);
+    cache.Clear(addr_type, bda);
+    return;
+  }
+
+  uint8_t delivery =
+      btm_ble_host_scan_filter_match(bda, rssi, adv_data, adv_data_len);
+  if (delivery & HostScanFilter::kBatch)
+    btm_ble_host_batch_scan_store(bda, addr_type, tx_power, rssi, adv_data,
+                                  adv_data_len);
+  if (!(delivery & HostScanFilter::kReportNow)) {
+    cache.Clear(addr_type, bda);
     return;
   }
 
@@ -1965,6 +1969,7 @@ static void btm_ble_process_adv_pkt_cont(
       update = false;
     } else {
       /* if yes, skip it */
+      cache.Clear(addr_type, bda);
       return; /* assumption: one result per event */
     }
   }
@@ -1985,9 +1990,9 @@ static void btm_ble_process_adv_pkt_cont(
   /* update the LE device information in inquiry database */
   btm_ble_update_inq_result(p_i, addr_type, bda, evt_type, primary_phy,
                             secondary_phy, advertising_sid, tx_power, rssi,
-                            periodic_adv_int, adv_data);
+                            periodic_adv_int, adv_data, adv_data_len);
 
-  uint8_t result = btm_ble_is_discoverable(bda, adv_data);
+  uint8_t result = btm_ble_is_discoverable(bda, adv_data, adv_data_len);
   if (result == 0) {
     cache.Clear(addr_type, bda);
     LOG_WARN(LOG_TAG,
@@ -2024,18 +2029,20 @@ static void btm_ble_process_adv_pkt_cont(
   tBTM_INQ_RESULTS_CB* p_inq_results_cb = p_inq->p_inq_results_cb;
   if (p_inq_results_cb && (result & BTM_BLE_INQ_RESULT)) {
     (p_inq_results_cb)((tBTM_INQ_RESULTS*)&p_i->inq_info.results,
-                       const_cast<uint8_t*>(adv_data.data()), adv_data.size());
+                       const_cast<uint8_t*>(adv_data), adv_data_len);
   }
 
   tBTM_INQ_RESULTS_CB* p_obs_results_cb = btm_cb.ble_ctr_cb.p_obs_results_cb;
   if (p_obs_results_cb && (result & BTM_BLE_OBS_RESULT)) {
     (p_obs_results_cb)((tBTM_INQ_RESULTS*)&p_i->inq_info.results,
-                       const_cast<uint8_t*>(adv_data.data()), adv_data.size());
+                       const_cast<uint8_t*>(adv_data), adv_data_len);
   }
 
   cache.Clear(addr_type, bda);
 }
 
+void stack_debug_btm_ble_dump(int fd) { cache.Dump(fd); }
+
 void btm_ble_process_phy_update_pkt(uint8_t len, uint8_t* data) {
   uint8_t status, tx_phy, rx_phy;
   uint16_t handle;
@@ -2157,6 +2164,70 @@ static void btm_ble_stop_observe(void) {
 
   if (p_obs_cb) (p_obs_cb)(&btm_cb.btm_inq_vars.inq_cmpl_info);
 }
+
+/*******************************************************************************
+ *
+ * Function         btm_ble_start_host_batch_scan
+ *
+ * Description      Keeps the LE scan running for a batch scan run on the host.
+ *                  The scan parameters are only applied if no other scan is
+ *                  in progress.
+ *
+ * Returns          BTM_CMD_STARTED if the scan is running.
+ *
+ ******************************************************************************/
+tBTM_STATUS btm_ble_start_host_batch_scan(uint16_t scan_interval,
+                                          uint16_t scan_window, bool active) {
+  tBTM_BLE_CB* p_ble_cb = &btm_cb.ble_ctr_cb;
+  tBTM_BLE_INQ_CB* p_inq = &p_ble_cb->inq_var;
+
+  if (!controller_get_interface()->supports_ble()) return BTM_ILLEGAL_VALUE;
+
+  /* the batch scan is the only one, restart it with the new parameters */
+  if (p_ble_cb->scan_activity == BTM_LE_BATCH_SCAN_ACTIVE) btm_ble_stop_scan();
+
+  if (BTM_BLE_IS_SCAN_ACTIVE(p_ble_cb->scan_activity &
+                             ~BTM_LE_BATCH_SCAN_ACTIVE)) {
+    p_ble_cb->scan_activity |= BTM_LE_BATCH_SCAN_ACTIVE;
+    return BTM_CMD_STARTED;
+  }
+
+  p_inq->scan_type = active ? BTM_BLE_SCAN_MODE_ACTI : BTM_BLE_SCAN_MODE_PASS;
+#if (defined BLE_PRIVACY_SPT && BLE_PRIVACY_SPT == TRUE)
+  /* enable resolving list */
+  btm_ble_enable_resolving_list_for_platform(BTM_BLE_RL_SCAN);
+#endif
+
+  btm_send_hci_set_scan_params(p_inq->scan_type, scan_interval, scan_window,
+                               p_ble_cb->addr_mgnt_cb.own_addr_type,
+                               BTM_BLE_DEFAULT_SFP);
+
+  p_inq->scan_duplicate_filter = BTM_BLE_DUPLICATE_DISABLE;
+  tBTM_STATUS status = btm_ble_start_scan();
+  if (status == BTM_CMD_STARTED)
+    p_ble_cb->scan_activity |= BTM_LE_BATCH_SCAN_ACTIVE;
+  return status;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_ble_stop_host_batch_scan
+ *
+ * Description      Stops the LE scan of a batch scan run on the host, unless
+ *                  another scan still needs it.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btm_ble_stop_host_batch_scan(void) {
+  tBTM_BLE_CB* p_ble_cb = &btm_cb.ble_ctr_cb;
+
+  if (!(p_ble_cb->scan_activity & BTM_LE_BATCH_SCAN_ACTIVE)) return;
+
+  p_ble_cb->scan_activity &= ~BTM_LE_BATCH_SCAN_ACTIVE;
+
+  if (!BTM_BLE_IS_SCAN_ACTIVE(p_ble_cb->scan_activity)) btm_ble_stop_scan();
+}
 /*******************************************************************************
  *
  * Function         btm_ble_adv_states_operation
@@ -2513,6 +2584,11 @@ void btm_ble_init(void) {
   p_cb->observer_timer = alarm_new("btm_ble.observer_timer");
   p_cb->cur_states = 0;
 
+  int32_t adv_cache_size = osi_property_get_int32(
+      BTM_BLE_ADV_CACHE_SIZE_PROPERTY, BTM_BLE_ADV_CACHE_SIZE);
+  if (adv_cache_size <= 0) adv_cache_size = BTM_BLE_ADV_CACHE_SIZE;
+  cache.Configure(adv_cache_size, BTM_BLE_ADV_CACHE_TIMEOUT_MS);
+
   p_cb->inq_var.adv_mode = BTM_BLE_ADV_DISABLE;
   p_cb->inq_var.scan_type = BTM_BLE_SCAN_MODE_NONE;
   p_cb->inq_var.adv_chnl_map = BTM_BLE_DEFAULT_ADV_CHNL_MAP;
@@ -2532,7 +2608,9 @@ void btm_ble_init(void) {
       alarm_new("btm_ble_addr.refresh_raddr_timer");
 
 #if (BLE_VND_INCLUDED == FALSE)
+  btm_ble_host_scan_offload_init();
   btm_ble_adv_filter_init();
+  if (btm_cb.cmn_ble_vsc_cb.host_scan_offload) btm_ble_batchscan_init();
 #endif
 }
 
@@ -175,6 +175,18 @@ extern void btm_ble_batchscan_init(void);
 extern void btm_ble_batchscan_cleanup(void);
 extern void btm_ble_adv_filter_init(void);
 extern void btm_ble_adv_filter_cleanup(void);
+extern bool btm_ble_host_scan_filter_may_match(const RawAddress& bda);
+extern uint8_t btm_ble_host_scan_filter_match(const RawAddress& bda,
+                                              int8_t rssi, const uint8_t* data,
+                                              size_t len);
+extern void btm_ble_host_batch_scan_store(const RawAddress& bda,
+                                          uint8_t addr_type, int8_t tx_power,
+                                          int8_t rssi, const uint8_t* data,
+                                          size_t len);
+extern tBTM_STATUS btm_ble_start_host_batch_scan(uint16_t scan_interval,
+                                                 uint16_t scan_window,
+                                                 bool active);
+extern void btm_ble_stop_host_batch_scan(void);
 extern bool btm_ble_topology_check(tBTM_BLE_STATE_MASK request);
 extern bool btm_ble_clear_topology_mask(tBTM_BLE_STATE_MASK request_state);
 extern bool btm_ble_set_topology_mask(tBTM_BLE_STATE_MASK request_state);
@@ -88,6 +88,8 @@ inline bool BTM_BLE_IS_RESOLVE_BDA(const RawAddress& x) {
 /* LE scan activity bit mask, continue with LE inquiry bits */
 /* observe is in progress */
 #define BTM_LE_OBSERVE_ACTIVE 0x80
+/* batch scan run on the host is in progress */
+#define BTM_LE_BATCH_SCAN_ACTIVE 0x40
 
 /* BLE scan activity mask checking */
 #define BTM_BLE_IS_SCAN_ACTIVE(x) ((x)&BTM_BLE_SCAN_ACTIVE_MASK)
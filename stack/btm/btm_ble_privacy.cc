@@ -728,6 +728,7 @@ bool btm_ble_resolving_list_load_dev(tBTM_SEC_DEV_REC* p_dev_rec) {
     if (p_dev_rec->ble.identity_addr.IsEmpty()) {
       p_dev_rec->ble.identity_addr = p_dev_rec->bd_addr;
       p_dev_rec->ble.identity_addr_type = p_dev_rec->ble.ble_addr_type;
+      btm_update_dev_index(p_dev_rec);
     }
 
     BTM_TRACE_DEBUG("%s: adding device %s to controller resolving list",
@@ -0,0 +1,445 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "btm_ble_scan_filter.h"
+
+#include <string.h>
+#include <algorithm>
+
+#include "bt_types.h"
+#include "btm_api_types.h"
+#include "btm_ble_api_types.h"
+
+using bluetooth::Uuid;
+
+namespace {
+
+/* Service solicitation AD types, Core Specification Supplement, Part A, 1.10 */
+constexpr uint8_t kSol16BitsUuidType = 0x14;
+constexpr uint8_t kSol32BitsUuidType = 0x1F;
+constexpr uint8_t kSol128BitsUuidType = 0x15;
+
+/* Fields of one kind kept while parsing; further ones are ignored */
+constexpr size_t kMaxFields = 4;
+
+/* Lengths of the UUIDs in the 16, 32 and 128 bits UUID lists */
+constexpr size_t kUuidLens[] = {Uuid::kNumBytes16, Uuid::kNumBytes32,
+                                Uuid::kNumBytes128};
+
+/* Bit of |feature| in the feature selection and the list logic type */
+constexpr uint16_t FeatureBit(uint8_t feature) { return 1 << feature; }
+
+struct Field {
+  const uint8_t* data;
+  uint8_t len;
+};
+
+/* Up to kMaxFields fields of one kind */
+struct Fields {
+  Field field[kMaxFields];
+  size_t count;
+
+  void Add(const uint8_t* data, uint8_t len) {
+    if (count < kMaxFields) field[count++] = {data, len};
+  }
+};
+
+/* Writes |uuid| in its |len| bytes long little endian form to |out| */
+void UuidToLE(const Uuid& uuid, size_t len, uint8_t* out) {
+  if (len == Uuid::kNumBytes16) {
+    uint16_t u = uuid.As16Bit();
+    out[0] = u & 0xff;
+    out[1] = u >> 8;
+  } else if (len == Uuid::kNumBytes32) {
+    uint32_t u = uuid.As32Bit();
+    for (size_t i = 0; i < 4; i++) out[i] = (u >> (8 * i)) & 0xff;
+  } else {
+    Uuid::UUID128Bit u = uuid.To128BitLE();
+    memcpy(out, u.data(), Uuid::kNumBytes128);
+  }
+}
+
+bool MaskedEquals(const uint8_t* a, const uint8_t* b, const uint8_t* mask,
+                  size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    if ((a[i] & mask[i]) != (b[i] & mask[i])) return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+/* The fields of the advertising data the filters look into */
+struct HostScanFilter::ParsedData {
+  /* by length of the UUIDs: 16, 32 and 128 bits */
+  Fields srvc_uuids[3] = {};
+  Fields sol_uuids[3] = {};
+  Fields names = {};
+  Fields manu_data = {};
+  Fields srvc_data = {};
+
+  ParsedData(const uint8_t* data, size_t len) {
+    size_t position = 0;
+    while (position < len) {
+      uint8_t field_len = data[position];
+      if (field_len == 0 || position + 1 + field_len > len) break;
+      uint8_t type = data[position + 1];
+      const uint8_t* value = data + position + 2;
+      uint8_t value_len = field_len - 1;
+      switch (type) {
+        case BT_EIR_MORE_16BITS_UUID_TYPE:
+        case BT_EIR_COMPLETE_16BITS_UUID_TYPE:
+          srvc_uuids[0].Add(value, value_len);
+          break;
+        case BT_EIR_MORE_32BITS_UUID_TYPE:
+        case BT_EIR_COMPLETE_32BITS_UUID_TYPE:
+          srvc_uuids[1].Add(value, value_len);
+          break;
+        case BT_EIR_MORE_128BITS_UUID_TYPE:
+        case BT_EIR_COMPLETE_128BITS_UUID_TYPE:
+          srvc_uuids[2].Add(value, value_len);
+          break;
+        case kSol16BitsUuidType:
+          sol_uuids[0].Add(value, value_len);
+          break;
+        case kSol32BitsUuidType:
+          sol_uuids[1].Add(value, value_len);
+          break;
+        case kSol128BitsUuidType:
+          sol_uuids[2].Add(value, value_len);
+          break;
+        case BT_EIR_SHORTENED_LOCAL_NAME_TYPE:
+        case BT_EIR_COMPLETE_LOCAL_NAME_TYPE:
+          names.Add(value, value_len);
+          break;
+        case BT_EIR_MANUFACTURER_SPECIFIC_TYPE:
+          manu_data.Add(value, value_len);
+          break;
+        case BT_EIR_SERVICE_DATA_16BITS_UUID_TYPE:
+        case BT_EIR_SERVICE_DATA_32BITS_UUID_TYPE:
+        case BT_EIR_SERVICE_DATA_128BITS_UUID_TYPE:
+          srvc_data.Add(value, value_len);
+          break;
+      }
+      position += 1 + field_len;
+    }
+  }
+};
+
+HostScanFilter::HostScanFilter(size_t max_filters) : filters_(max_filters) {}
+
+bool HostScanFilter::AddCondition(uint8_t filt_index, const ApcfCommand& cmd) {
+  if (filt_index >= filters_.size()) return false;
+  Filter& filter = filters_[filt_index];
+
+  switch (cmd.type) {
+    case BTM_BLE_PF_ADDR_FILTER:
+      filter.addresses.push_back(cmd.address);
+      break;
+
+    case BTM_BLE_PF_SRVC_DATA:
+      /* nothing to match beyond the presence of service data */
+      break;
+
+    case BTM_BLE_PF_SRVC_UUID:
+    case BTM_BLE_PF_SRVC_SOL_UUID: {
+      UuidCondition cond;
+      cond.len = cmd.uuid.GetShortestRepresentationSize();
+      UuidToLE(cmd.uuid, cond.len, cond.uuid);
+      if (cmd.uuid_mask.IsEmpty())
+        memset(cond.mask, 0xff, cond.len);
+      else
+        UuidToLE(cmd.uuid_mask, cond.len, cond.mask);
+      if (cmd.type == BTM_BLE_PF_SRVC_UUID)
+        filter.srvc_uuids.push_back(cond);
+      else
+        filter.sol_uuids.push_back(cond);
+      break;
+    }
+
+    case BTM_BLE_PF_LOCAL_NAME: {
+      size_t size = std::min(cmd.name.size(), (size_t)BTM_BLE_PF_STR_LEN_MAX);
+      filter.names.emplace_back(cmd.name.begin(), cmd.name.begin() + size);
+      break;
+    }
+
+    case BTM_BLE_PF_MANU_DATA:
+    case BTM_BLE_PF_SRVC_DATA_PATTERN: {
+      /* If data is passed, both mask and data have to be the same length */
+      if (cmd.data.size() != cmd.data_mask.size() && cmd.data.size() != 0 &&
+          cmd.data_mask.size() != 0)
+        return false;
+
+      PatternCondition cond;
+      cond.company = cmd.company;
+      cond.company_mask = cmd.company_mask != 0 ? cmd.company_mask : 0xFFFF;
+      size_t max_size = cmd.type == BTM_BLE_PF_MANU_DATA
+                            ? BTM_BLE_PF_STR_LEN_MAX - 2
+                            : BTM_BLE_PF_STR_LEN_MAX;
+      size_t size = std::min(cmd.data.size(), max_size);
+      /* data without a mask matches anything, as the controller ignores it */
+      if (cmd.type == BTM_BLE_PF_MANU_DATA && cmd.data_mask.empty()) size = 0;
+      cond.data.assign(cmd.data.begin(), cmd.data.begin() + size);
+      if (cmd.data_mask.empty())
+        cond.mask.assign(size, 0xff);
+      else
+        cond.mask.assign(cmd.data_mask.begin(), cmd.data_mask.begin() + size);
+      if (cmd.type == BTM_BLE_PF_MANU_DATA)
+        filter.manu_data.push_back(std::move(cond));
+      else
+        filter.srvc_data.push_back(std::move(cond));
+      break;
+    }
+
+    default:
+      return false;
+  }
+
+  Compile();
+  return true;
+}
+
+void HostScanFilter::ClearFilter(uint8_t filt_index) {
+  if (filt_index >= filters_.size()) return;
+  filters_[filt_index] = Filter();
+  Compile();
+}
+
+bool HostScanFilter::SetParams(uint8_t filt_index,
+                               const btgatt_filt_param_setup_t& params) {
+  if (filt_index >= filters_.size()) return false;
+  Filter& filter = filters_[filt_index];
+  filter.active = true;
+  filter.feat_seln = params.feat_seln;
+  filter.list_logic_type = params.list_logic_type;
+  filter.filt_logic_type = params.filt_logic_type;
+  filter.rssi_high_thres = (int8_t)params.rssi_high_thres;
+  /* there is no tracking of found and lost advertisers on the host, the
+   * matching reports are delivered right away instead */
+  filter.delivery = params.dely_mode == kDeliveryBatched ? kBatch : kReportNow;
+  Compile();
+  return true;
+}
+
+void HostScanFilter::DeleteParams(uint8_t filt_index) {
+  if (filt_index >= filters_.size()) return;
+  filters_[filt_index].active = false;
+  Compile();
+}
+
+void HostScanFilter::ClearParams() {
+  for (Filter& filter : filters_) filter.active = false;
+  Compile();
+}
+
+void HostScanFilter::Enable(bool enable) { enabled_ = enable; }
+
+void HostScanFilter::Compile() {
+  const uint16_t kDataFeatures =
+      FeatureBit(BTM_BLE_PF_SRVC_DATA) |
+      FeatureBit(BTM_BLE_PF_SRVC_UUID) |
+      FeatureBit(BTM_BLE_PF_SRVC_SOL_UUID) |
+      FeatureBit(BTM_BLE_PF_LOCAL_NAME) |
+      FeatureBit(BTM_BLE_PF_MANU_DATA) |
+      FeatureBit(BTM_BLE_PF_SRVC_DATA_PATTERN);
+  const uint16_t kAddrFeature = FeatureBit(BTM_BLE_PF_ADDR_FILTER);
+
+  active_.clear();
+  needs_data_ = false;
+  address_gated_ = true;
+  gate_addresses_.clear();
+
+  for (size_t i = 0; i < filters_.size(); i++) {
+    const Filter& filter = filters_[i];
+    if (!filter.active) continue;
+    active_.push_back(i);
+
+    uint16_t features = filter.feat_seln & (kDataFeatures | kAddrFeature);
+    if (features & kDataFeatures) needs_data_ = true;
+
+    /* The address is required if it is selected, and either the only feature
+     * selected, or all of them are required */
+    bool address_required =
+        (features & kAddrFeature) &&
+        (features == kAddrFeature ||
+         filter.filt_logic_type == BTM_BLE_PF_LOGIC_AND);
+    if (!address_required) {
+      address_gated_ = false;
+      continue;
+    }
+    gate_addresses_.insert(gate_addresses_.end(), filter.addresses.begin(),
+                           filter.addresses.end());
+  }
+
+  if (!address_gated_) gate_addresses_.clear();
+  std::sort(gate_addresses_.begin(), gate_addresses_.end());
+}
+
+bool HostScanFilter::MayMatch(const RawAddress& bda) const {
+  if (!enabled_ || !address_gated_) return true;
+  return std::binary_search(gate_addresses_.begin(), gate_addresses_.end(),
+                            bda);
+}
+
+uint8_t HostScanFilter::Match(const RawAddress& bda, int8_t rssi,
+                              const uint8_t* data, size_t len) const {
+  if (!enabled_) return kReportNow | kBatch;
+  if (!MayMatch(bda)) return 0;
+
+  /* Parse only if some filter looks into the data */
+  ParsedData parsed(data, needs_data_ ? len : 0);
+
+  uint8_t delivery = 0;
+  for (uint8_t i : active_) {
+    const Filter& filter = filters_[i];
+    /* Skip filters that cannot add to the delivery anymore */
+    if ((delivery & filter.delivery) == filter.delivery) continue;
+    if (rssi < filter.rssi_high_thres) continue;
+    if (MatchFilter(filter, bda, parsed)) delivery |= filter.delivery;
+    if (delivery == (kReportNow | kBatch)) break;
+  }
+  return delivery;
+}
+
+bool HostScanFilter::MatchFilter(const Filter& filter, const RawAddress& bda,
+                                 const ParsedData& parsed) const {
+  /* Matches one condition of a feature list against the report */
+  auto match_uuid = [](const UuidCondition& cond, const Fields* by_len) {
+    for (size_t l = 0; l < 3; l++) {
+      const Fields& fields = by_len[l];
+      for (size_t f = 0; f < fields.count; f++) {
+        const Field& field = fields.field[f];
+        for (size_t i = 0; i + kUuidLens[l] <= field.len; i += kUuidLens[l]) {
+          const uint8_t* p = field.data + i;
+          Uuid uuid = l == 0 ? Uuid::From16Bit(p[0] | (p[1] << 8))
+                             : l == 1 ? Uuid::From32Bit(p[0] | (p[1] << 8) |
+                                                        (p[2] << 16) |
+                                                        ((uint32_t)p[3] << 24))
+                                      : Uuid::From128BitLE(p);
+          if (uuid.GetShortestRepresentationSize() > cond.len) continue;
+          uint8_t le[16];
+          UuidToLE(uuid, cond.len, le);
+          if (MaskedEquals(le, cond.uuid, cond.mask, cond.len)) return true;
+        }
+      }
+    }
+    return false;
+  };
+
+  auto match_pattern = [](const PatternCondition& cond, const Field& field,
+                          size_t skip) {
+    if (field.len < skip + cond.data.size()) return false;
+    return MaskedEquals(field.data + skip, cond.data.data(), cond.mask.data(),
+                        cond.data.size());
+  };
+
+  /* Evaluates the list of conditions of one feature, with |match| telling
+   * whether a condition matches */
+  auto match_list = [&filter](uint8_t feature, const auto& conds,
+                              auto match) {
+    if (conds.empty()) return false;
+    bool all = filter.list_logic_type & FeatureBit(feature);
+    for (const auto& cond : conds) {
+      bool matched = match(cond);
+      if (all && !matched) return false;
+      if (!all && matched) return true;
+    }
+    return all;
+  };
+
+  bool all = filter.filt_logic_type == BTM_BLE_PF_LOGIC_AND;
+  for (uint8_t feature = BTM_BLE_PF_ADDR_FILTER;
+       feature <= BTM_BLE_PF_SRVC_DATA_PATTERN; feature++) {
+    if (!(filter.feat_seln & FeatureBit(feature))) continue;
+
+    bool matched = false;
+    switch (feature) {
+      case BTM_BLE_PF_ADDR_FILTER:
+        matched = match_list(feature, filter.addresses,
+                             [&bda](const RawAddress& a) { return a == bda; });
+        break;
+
+      case BTM_BLE_PF_SRVC_DATA:
+        matched = parsed.srvc_data.count != 0;
+        break;
+
+      case BTM_BLE_PF_SRVC_UUID:
+        matched = match_list(feature, filter.srvc_uuids,
+                             [&](const UuidCondition& cond) {
+                               return match_uuid(cond, parsed.srvc_uuids);
+                             });
+        break;
+
+      case BTM_BLE_PF_SRVC_SOL_UUID:
+        matched = match_list(feature, filter.sol_uuids,
+                             [&](const UuidCondition& cond) {
+                               return match_uuid(cond, parsed.sol_uuids);
+                             });
+        break;
+
+      case BTM_BLE_PF_LOCAL_NAME:
+        /* The name starts with the one of the condition */
+        matched = match_list(
+            feature, filter.names, [&](const std::vector<uint8_t>& name) {
+              for (size_t f = 0; f < parsed.names.count; f++) {
+                const Field& field = parsed.names.field[f];
+                if (field.len >= name.size() &&
+                    memcmp(field.data, name.data(), name.size()) == 0)
+                  return true;
+              }
+              return false;
+            });
+        break;
+
+      case BTM_BLE_PF_MANU_DATA:
+        /* Company identifier first, then the data */
+        matched = match_list(
+            feature, filter.manu_data, [&](const PatternCondition& cond) {
+              for (size_t f = 0; f < parsed.manu_data.count; f++) {
+                const Field& field = parsed.manu_data.field[f];
+                if (field.len < 2) continue;
+                uint16_t company = field.data[0] | (field.data[1] << 8);
+                if ((company & cond.company_mask) !=
+                    (cond.company & cond.company_mask))
+                  continue;
+                if (match_pattern(cond, field, 2)) return true;
+              }
+              return false;
+            });
+        break;
+
+      case BTM_BLE_PF_SRVC_DATA_PATTERN:
+        /* The pattern starts with the service UUID */
+        matched = match_list(
+            feature, filter.srvc_data, [&](const PatternCondition& cond) {
+              for (size_t f = 0; f < parsed.srvc_data.count; f++) {
+                if (match_pattern(cond, parsed.srvc_data.field[f], 0))
+                  return true;
+              }
+              return false;
+            });
+        break;
+    }
+
+    if (all && !matched) return false;
+    if (!all && matched) return true;
+  }
+
+  /* No feature selected matches every report */
+  return all || (filter.feat_seln & 0x7F) == 0;
+}
@@ -0,0 +1,141 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <hardware/bt_common_types.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "types/raw_address.h"
+
+/* HostScanFilter evaluates the advertising packet content filters (APCF) on
+ * the host, for controllers that do not offer them.
+ *
+ * Filters are configured the way the controller ones are: conditions are
+ * added to a filter index, and the index takes effect once its parameters
+ * (feature selection, logic, RSSI threshold, delivery mode) are set. Every
+ * change compiles the filters into the list of active ones, and a summary of
+ * what they need from a report, so that matching a report parses its
+ * advertising data at most once, and not at all for filters on address or
+ * RSSI only.
+ */
+class HostScanFilter {
+ public:
+  /* How a report matching a filter is delivered */
+  enum : uint8_t {
+    /* reported to the host right away */
+    kReportNow = 0x01,
+    /* stored for batch scan */
+    kBatch = 0x02,
+  };
+
+  /* Delivery modes of the filter parameters */
+  static constexpr uint8_t kDeliveryImmediate = 0;
+  static constexpr uint8_t kDeliveryOnFound = 1;
+  static constexpr uint8_t kDeliveryBatched = 2;
+
+  /* Filter indexes go from 0 to |max_filters| - 1 */
+  explicit HostScanFilter(size_t max_filters);
+
+  /* Adds |cmd| to the conditions of filter |filt_index|. Returns false if the
+   * index or the condition is invalid. */
+  bool AddCondition(uint8_t filt_index, const ApcfCommand& cmd);
+
+  /* Removes every condition, and the parameters, of filter |filt_index| */
+  void ClearFilter(uint8_t filt_index);
+
+  /* Sets the parameters of filter |filt_index|, which takes effect. Returns
+   * false if the index is invalid. */
+  bool SetParams(uint8_t filt_index, const btgatt_filt_param_setup_t& params);
+
+  /* Removes the parameters of filter |filt_index|, which takes no effect
+   * anymore */
+  void DeleteParams(uint8_t filt_index);
+
+  /* Removes the parameters of every filter */
+  void ClearParams();
+
+  /* Disabled filters let every report through, to both deliveries */
+  void Enable(bool enable);
+  bool enabled() const { return enabled_; }
+
+  size_t max_filters() const { return filters_.size(); }
+  /* Number of filter indexes without parameters */
+  size_t available() const { return filters_.size() - active_.size(); }
+
+  /* Returns false if no filter can match a report from |bda|, whatever its
+   * content; this is decided on a lookup of the address alone. */
+  bool MayMatch(const RawAddress& bda) const;
+
+  /* Returns how a report from |bda| at |rssi|, carrying |len| bytes of
+   * advertising data at |data|, is delivered, or 0 if it is to be dropped */
+  uint8_t Match(const RawAddress& bda, int8_t rssi, const uint8_t* data,
+                size_t len) const;
+
+ private:
+  struct UuidCondition {
+    /* 2, 4 or 16 bytes, little endian */
+    uint8_t len;
+    uint8_t uuid[16];
+    uint8_t mask[16];
+  };
+
+  struct PatternCondition {
+    /* for manufacturer data only */
+    uint16_t company;
+    uint16_t company_mask;
+    std::vector<uint8_t> data;
+    std::vector<uint8_t> mask;
+  };
+
+  struct Filter {
+    bool active;
+    uint16_t feat_seln;
+    uint16_t list_logic_type;
+    uint8_t filt_logic_type;
+    int8_t rssi_high_thres;
+    uint8_t delivery;
+    std::vector<RawAddress> addresses;
+    std::vector<UuidCondition> srvc_uuids;
+    std::vector<UuidCondition> sol_uuids;
+    std::vector<std::vector<uint8_t>> names;
+    std::vector<PatternCondition> manu_data;
+    std::vector<PatternCondition> srvc_data;
+  };
+
+  struct ParsedData;
+
+  void Compile();
+  bool MatchFilter(const Filter& filter, const RawAddress& bda,
+                   const ParsedData& parsed) const;
+
+  std::vector<Filter> filters_;
+  bool enabled_ = false;
+
+  /* Compiled from |filters_| */
+  std::vector<uint8_t> active_;
+  /* some active filter looks into the advertising data */
+  bool needs_data_ = false;
+  /* every active filter requires a match of |gate_addresses_| */
+  bool address_gated_ = false;
+  /* sorted */
+  std::vector<RawAddress> gate_addresses_;
+};
@@ -30,6 +30,7 @@
 #include "bt_common.h"
 #include "bt_types.h"
 #include "btm_api.h"
+#include "btm_dev_index.h"
 #include "btm_int.h"
 #include "btu.h"
 #include "device/include/controller.h"
@@ -145,6 +146,7 @@ bool BTM_SecAddDevice(const RawAddress& bd_addr, DEV_CLASS dev_class,
 
   p_dev_rec->rmt_io_caps = io_cap;
   p_dev_rec->device_type |= BT_DEVICE_TYPE_BREDR;
+  btm_update_dev_index(p_dev_rec);
 
   return true;
 }
@@ -152,6 +154,7 @@ bool BTM_SecAddDevice(const RawAddress& bd_addr, DEV_CLASS dev_class,
 void wipe_secrets_and_remove(tBTM_SEC_DEV_REC* p_dev_rec) {
   p_dev_rec->link_key.fill(0);
   memset(&p_dev_rec->ble.keys, 0, sizeof(tBTM_SEC_BLE_KEYS));
+  btm_cb.sec_dev_index->Remove(p_dev_rec);
   list_remove(btm_cb.sec_dev_rec, p_dev_rec);
 }
 
@@ -260,6 +263,7 @@ tBTM_SEC_DEV_REC* btm_sec_alloc_dev(const RawAddress& bd_addr) {
 
   p_dev_rec->ble_hci_handle = BTM_GetHCIConnHandle(bd_addr, BT_TRANSPORT_LE);
   p_dev_rec->hci_handle = BTM_GetHCIConnHandle(bd_addr, BT_TRANSPORT_BR_EDR);
+  btm_update_dev_index(p_dev_rec);
 
   return (p_dev_rec);
 }
@@ -310,16 +314,6 @@ bool btm_dev_support_switch(const RawAddress& bd_addr) {
   return (false);
 }
 
-bool is_handle_equal(void* data, void* context) {
-  tBTM_SEC_DEV_REC* p_dev_rec = static_cast<tBTM_SEC_DEV_REC*>(data);
-  uint16_t* handle = static_cast<uint16_t*>(context);
-
-  if (p_dev_rec->hci_handle == *handle || p_dev_rec->ble_hci_handle == *handle)
-    return false;
-
-  return true;
-}
-
 /*******************************************************************************
  *
  * Function         btm_find_dev_by_handle
@@ -331,22 +325,7 @@ bool is_handle_equal(void* data, void* context) {
  *
  ******************************************************************************/
 tBTM_SEC_DEV_REC* btm_find_dev_by_handle(uint16_t handle) {
-  list_node_t* n = list_foreach(btm_cb.sec_dev_rec, is_handle_equal, &handle);
-  if (n) return static_cast<tBTM_SEC_DEV_REC*>(list_node(n));
-
-  return NULL;
-}
-
-bool is_address_equal(void* data, void* context) {
-  tBTM_SEC_DEV_REC* p_dev_rec = static_cast<tBTM_SEC_DEV_REC*>(data);
-  const RawAddress* bd_addr = ((RawAddress*)context);
-
-  if (p_dev_rec->bd_addr == *bd_addr) return false;
-  // If a LE random address is looking for device record
-  if (p_dev_rec->ble.pseudo_addr == *bd_addr) return false;
-
-  if (btm_ble_addr_resolvable(*bd_addr, p_dev_rec)) return false;
-  return true;
+  return btm_cb.sec_dev_index->FindByHandle(handle);
 }
 
 /*******************************************************************************
@@ -360,11 +339,37 @@ bool is_address_equal(void* data, void* context) {
  *
  ******************************************************************************/
 tBTM_SEC_DEV_REC* btm_find_dev(const RawAddress& bd_addr) {
-  list_node_t* n =
-      list_foreach(btm_cb.sec_dev_rec, is_address_equal, (void*)&bd_addr);
-  if (n) return static_cast<tBTM_SEC_DEV_REC*>(list_node(n));
+  DeviceRecordIndex* index = btm_cb.sec_dev_index;
+  tBTM_SEC_DEV_REC* p_dev_rec = index->FindByAddress(bd_addr);
+
+  /* A LE random address may also resolve to a record allocated earlier than
+   * the one matching it verbatim; the oldest record wins either way. */
+  if (BTM_BLE_IS_RESOLVE_BDA(bd_addr)) {
+    tBTM_SEC_DEV_REC* p_resolved = index->Resolve(bd_addr);
+    if (p_resolved != NULL &&
+        (p_dev_rec == NULL || index->AddedBefore(p_resolved, p_dev_rec))) {
+      btm_ble_init_pseudo_addr(p_resolved, bd_addr);
+      return p_resolved;
+    }
+  }
+
+  return p_dev_rec;
+}
 
-  return NULL;
+/*******************************************************************************
+ *
+ * Function         btm_update_dev_index
+ *
+ * Description      Re-indexes the record after its addresses, connection
+ *                  handles, device type or LE keys were written. Must be
+ *                  called by whoever changes any of them, or the lookups
+ *                  above will miss the record.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btm_update_dev_index(tBTM_SEC_DEV_REC* p_dev_rec) {
+  btm_cb.sec_dev_index->Update(p_dev_rec);
 }
 
 /*******************************************************************************
@@ -405,6 +410,7 @@ void btm_consolidate_dev(tBTM_SEC_DEV_REC* p_target_rec) {
           temp_rec.new_encryption_key_is_p256;
       p_target_rec->no_smp_on_br = temp_rec.no_smp_on_br;
       p_target_rec->bond_type = temp_rec.bond_type;
+      btm_update_dev_index(p_target_rec);
 
       /* remove the combined record */
       wipe_secrets_and_remove(p_dev_rec);
@@ -417,6 +423,7 @@ void btm_consolidate_dev(tBTM_SEC_DEV_REC* p_target_rec) {
       if (p_target_rec->ble.pseudo_addr == p_dev_rec->bd_addr) {
         p_target_rec->ble.ble_addr_type = p_dev_rec->ble.ble_addr_type;
         p_target_rec->device_type |= p_dev_rec->device_type;
+        btm_update_dev_index(p_target_rec);
 
         /* remove the combined record */
         wipe_secrets_and_remove(p_dev_rec);
@@ -514,6 +521,7 @@ tBTM_SEC_DEV_REC* btm_sec_allocate_dev_rec(void) {
   p_dev_rec =
       static_cast<tBTM_SEC_DEV_REC*>(osi_calloc(sizeof(tBTM_SEC_DEV_REC)));
   list_append(btm_cb.sec_dev_rec, p_dev_rec);
+  btm_cb.sec_dev_index->Add(p_dev_rec);
 
   // Initialize defaults
   p_dev_rec->sec_flags = BTM_SEC_IN_USE;
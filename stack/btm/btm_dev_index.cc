@@ -0,0 +1,245 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "btm_dev_index.h"
+
+#include <string.h>
+#include <algorithm>
+
+#include "stack/crypto_toolbox/crypto_toolbox.h"
+
+bool rpa_matches_irk(const RawAddress& rpa, const Octet16& irk) {
+  /* use the 3 MSB of bd address as prand */
+  uint8_t rand[3];
+  rand[0] = rpa.address[2];
+  rand[1] = rpa.address[1];
+  rand[2] = rpa.address[0];
+
+  /* generate X = E irk(R0, R1, R2) and R is random address 3 LSO */
+  Octet16 x = crypto_toolbox::aes_128(irk, &rand[0], 3);
+
+  rand[0] = rpa.address[5];
+  rand[1] = rpa.address[4];
+  rand[2] = rpa.address[3];
+
+  return memcmp(x.data(), &rand[0], 3) == 0;
+}
+
+namespace {
+
+/* Same test as btm_ble_addr_resolvable() */
+bool can_resolve_rpa(const tBTM_SEC_DEV_REC* p_dev_rec) {
+  return (p_dev_rec->device_type & BT_DEVICE_TYPE_BLE) &&
+         (p_dev_rec->ble.key_type & BTM_LE_KEY_PID);
+}
+
+}  // namespace
+
+DeviceRecordIndex::DeviceRecordIndex(size_t rpa_cache_size)
+    : rpa_cache_capacity_(rpa_cache_size) {}
+
+DeviceRecordIndex::Entry DeviceRecordIndex::ReadEntry(
+    const tBTM_SEC_DEV_REC* p_dev_rec, uint64_t seq) {
+  Entry entry = {};
+  entry.seq = seq;
+  entry.bd_addr = p_dev_rec->bd_addr;
+  entry.pseudo_addr = p_dev_rec->ble.pseudo_addr;
+  entry.identity_addr = p_dev_rec->ble.identity_addr;
+  entry.hci_handle = p_dev_rec->hci_handle;
+  entry.ble_hci_handle = p_dev_rec->ble_hci_handle;
+  entry.resolves_rpa = can_resolve_rpa(p_dev_rec);
+  if (entry.resolves_rpa) entry.irk = p_dev_rec->ble.keys.irk;
+  return entry;
+}
+
+template <typename Map, typename Key>
+void DeviceRecordIndex::Insert(Map& map, const Key& key,
+                               tBTM_SEC_DEV_REC* p_dev_rec) {
+  Bucket& bucket = map[key];
+  uint64_t seq = entries_.at(p_dev_rec).seq;
+  auto it = std::find_if(bucket.begin(), bucket.end(),
+                         [this, seq](const tBTM_SEC_DEV_REC* p) {
+                           return entries_.at(p).seq > seq;
+                         });
+  bucket.insert(it, p_dev_rec);
+}
+
+template <typename Map, typename Key>
+void DeviceRecordIndex::Erase(Map& map, const Key& key,
+                              tBTM_SEC_DEV_REC* p_dev_rec) {
+  auto map_it = map.find(key);
+  if (map_it == map.end()) return;
+
+  Bucket& bucket = map_it->second;
+  bucket.erase(std::remove(bucket.begin(), bucket.end(), p_dev_rec),
+               bucket.end());
+  if (bucket.empty()) map.erase(map_it);
+}
+
+void DeviceRecordIndex::IndexEntry(tBTM_SEC_DEV_REC* p_dev_rec,
+                                   const Entry& entry) {
+  Insert(by_address_, entry.bd_addr, p_dev_rec);
+  if (entry.pseudo_addr != entry.bd_addr)
+    Insert(by_address_, entry.pseudo_addr, p_dev_rec);
+  Insert(by_identity_addr_, entry.identity_addr, p_dev_rec);
+  Insert(by_handle_, entry.hci_handle, p_dev_rec);
+  if (entry.ble_hci_handle != entry.hci_handle)
+    Insert(by_handle_, entry.ble_hci_handle, p_dev_rec);
+  if (entry.resolves_rpa) {
+    auto it = std::find_if(resolving_.begin(), resolving_.end(),
+                           [this, &entry](const tBTM_SEC_DEV_REC* p) {
+                             return entries_.at(p).seq > entry.seq;
+                           });
+    resolving_irks_.insert(
+        resolving_irks_.begin() + (it - resolving_.begin()), entry.irk);
+    resolving_.insert(it, p_dev_rec);
+  }
+}
+
+void DeviceRecordIndex::UnindexEntry(tBTM_SEC_DEV_REC* p_dev_rec,
+                                     const Entry& entry) {
+  Erase(by_address_, entry.bd_addr, p_dev_rec);
+  Erase(by_address_, entry.pseudo_addr, p_dev_rec);
+  Erase(by_identity_addr_, entry.identity_addr, p_dev_rec);
+  Erase(by_handle_, entry.hci_handle, p_dev_rec);
+  Erase(by_handle_, entry.ble_hci_handle, p_dev_rec);
+  if (entry.resolves_rpa) {
+    auto it = std::find(resolving_.begin(), resolving_.end(), p_dev_rec);
+    if (it != resolving_.end()) {
+      resolving_irks_.erase(resolving_irks_.begin() +
+                            (it - resolving_.begin()));
+      resolving_.erase(it);
+    }
+  }
+}
+
+void DeviceRecordIndex::Add(tBTM_SEC_DEV_REC* p_dev_rec) {
+  if (entries_.count(p_dev_rec) != 0) {
+    Update(p_dev_rec);
+    return;
+  }
+
+  Entry entry = ReadEntry(p_dev_rec, next_seq_++);
+  if (entry.resolves_rpa) InvalidateRpaCache();
+  entries_[p_dev_rec] = entry;
+  IndexEntry(p_dev_rec, entry);
+}
+
+void DeviceRecordIndex::Remove(tBTM_SEC_DEV_REC* p_dev_rec) {
+  auto it = entries_.find(p_dev_rec);
+  if (it == entries_.end()) return;
+
+  if (it->second.resolves_rpa) InvalidateRpaCache();
+  UnindexEntry(p_dev_rec, it->second);
+  entries_.erase(it);
+}
+
+void DeviceRecordIndex::Update(tBTM_SEC_DEV_REC* p_dev_rec) {
+  auto it = entries_.find(p_dev_rec);
+  if (it == entries_.end()) return;
+
+  Entry& entry = it->second;
+  Entry updated = ReadEntry(p_dev_rec, entry.seq);
+  if (updated.resolves_rpa != entry.resolves_rpa || updated.irk != entry.irk)
+    InvalidateRpaCache();
+
+  UnindexEntry(p_dev_rec, entry);
+  entry = updated;
+  IndexEntry(p_dev_rec, entry);
+}
+
+void DeviceRecordIndex::Clear() {
+  entries_.clear();
+  by_address_.clear();
+  by_identity_addr_.clear();
+  by_handle_.clear();
+  resolving_.clear();
+  resolving_irks_.clear();
+  InvalidateRpaCache();
+}
+
+tBTM_SEC_DEV_REC* DeviceRecordIndex::FindByAddress(
+    const RawAddress& bd_addr) const {
+  auto it = by_address_.find(bd_addr);
+  if (it == by_address_.end()) return nullptr;
+  return it->second.front();
+}
+
+tBTM_SEC_DEV_REC* DeviceRecordIndex::FindByIdentityAddress(
+    const RawAddress& bd_addr) const {
+  auto it = by_identity_addr_.find(bd_addr);
+  if (it == by_identity_addr_.end()) return nullptr;
+  return it->second.front();
+}
+
+tBTM_SEC_DEV_REC* DeviceRecordIndex::FindByHandle(uint16_t handle) const {
+  auto it = by_handle_.find(handle);
+  if (it == by_handle_.end()) return nullptr;
+  return it->second.front();
+}
+
+tBTM_SEC_DEV_REC* DeviceRecordIndex::Resolve(const RawAddress& rpa) {
+  auto cached = rpa_cache_.find(rpa);
+  if (cached != rpa_cache_.end()) {
+    rpa_lru_.splice(rpa_lru_.begin(), rpa_lru_, cached->second);
+    return cached->second->second;
+  }
+
+  /* Same computation as rpa_matches_irk(), for several IRKs at a time */
+  constexpr size_t kBatchSize = 8;
+  Octet16 prand{};
+  prand[0] = rpa.address[2];
+  prand[1] = rpa.address[1];
+  prand[2] = rpa.address[0];
+  Octet16 messages[kBatchSize];
+  std::fill(std::begin(messages), std::end(messages), prand);
+  Octet16 hashes[kBatchSize];
+
+  tBTM_SEC_DEV_REC* p_match = nullptr;
+  for (size_t i = 0; i < resolving_.size() && p_match == nullptr;
+       i += kBatchSize) {
+    size_t n = std::min(kBatchSize, resolving_.size() - i);
+    crypto_toolbox::aes_128_batch(&resolving_irks_[i], messages, hashes, n);
+    for (size_t j = 0; j < n; j++) {
+      if (hashes[j][0] == rpa.address[5] && hashes[j][1] == rpa.address[4] &&
+          hashes[j][2] == rpa.address[3]) {
+        p_match = resolving_[i + j];
+        break;
+      }
+    }
+  }
+
+  if (rpa_cache_capacity_ == 0) return p_match;
+  if (rpa_cache_.size() >= rpa_cache_capacity_) {
+    rpa_cache_.erase(rpa_lru_.back().first);
+    rpa_lru_.pop_back();
+  }
+  rpa_lru_.emplace_front(rpa, p_match);
+  rpa_cache_[rpa] = rpa_lru_.begin();
+  return p_match;
+}
+
+bool DeviceRecordIndex::AddedBefore(const tBTM_SEC_DEV_REC* a,
+                                    const tBTM_SEC_DEV_REC* b) const {
+  return entries_.at(a).seq < entries_.at(b).seq;
+}
+
+void DeviceRecordIndex::InvalidateRpaCache() {
+  rpa_cache_.clear();
+  rpa_lru_.clear();
+}
@@ -0,0 +1,135 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include "btm_int_types.h"
+
+/* Returns true if Resolvable Private Address |rpa| matches Identity Resolving
+ * Key |irk| */
+bool rpa_matches_irk(const RawAddress& rpa, const Octet16& irk);
+
+/* DeviceRecordIndex keeps hash indexes over the security device records of
+ * btm_cb.sec_dev_rec, so that looking a record up by address or connection
+ * handle no longer walks the whole list.
+ *
+ * The records stay owned by btm_cb.sec_dev_rec. Their fields are still written
+ * directly all over BTM, so whoever changes an indexed field (bd_addr,
+ * ble.pseudo_addr, ble.identity_addr, hci_handle, ble_hci_handle, or the IRK,
+ * key_type and device_type that decide whether the record resolves RPAs) must
+ * call Update() afterwards; see btm_update_dev_index().
+ *
+ * Several records may share a key, for example before btm_consolidate_dev()
+ * merges them. Lookups then return the record allocated first, which is the
+ * one a walk of btm_cb.sec_dev_rec would have found.
+ *
+ * Resolving a random address runs AES-128 against the IRK of every bonded LE
+ * device, so the results are kept in an LRU cache keyed by RPA, unresolvable
+ * RPAs included. The cache is dropped whenever the set of IRKs changes.
+ */
+class DeviceRecordIndex {
+ public:
+  static constexpr size_t kDefaultRpaCacheSize = 512;
+
+  explicit DeviceRecordIndex(size_t rpa_cache_size = kDefaultRpaCacheSize);
+
+  /* Indexes a new record. It counts as allocated after all records already
+   * in the index. */
+  void Add(tBTM_SEC_DEV_REC* p_dev_rec);
+  /* Removes a record before it is freed */
+  void Remove(tBTM_SEC_DEV_REC* p_dev_rec);
+  /* Re-indexes a record after its addresses, handles or keys changed */
+  void Update(tBTM_SEC_DEV_REC* p_dev_rec);
+  /* Drops every record */
+  void Clear();
+
+  /* Returns the record whose bd_addr or ble.pseudo_addr is |bd_addr| */
+  tBTM_SEC_DEV_REC* FindByAddress(const RawAddress& bd_addr) const;
+  /* Returns the record whose ble.identity_addr is |bd_addr| */
+  tBTM_SEC_DEV_REC* FindByIdentityAddress(const RawAddress& bd_addr) const;
+  /* Returns the record whose hci_handle or ble_hci_handle is |handle| */
+  tBTM_SEC_DEV_REC* FindByHandle(uint16_t handle) const;
+
+  /* Returns the first LE record with an IRK resolving |rpa|, or nullptr */
+  tBTM_SEC_DEV_REC* Resolve(const RawAddress& rpa);
+
+  /* Returns true if |a| was added to the index before |b| */
+  bool AddedBefore(const tBTM_SEC_DEV_REC* a,
+                   const tBTM_SEC_DEV_REC* b) const;
+
+  size_t size() const { return entries_.size(); }
+  size_t rpa_cache_size() const { return rpa_cache_.size(); }
+
+ private:
+  struct AddressHash {
+    size_t operator()(const RawAddress& x) const {
+      const uint8_t* a = x.address;
+      return a[0] ^ (a[1] << 8) ^ (a[2] << 16) ^ (a[3] << 24) ^ a[4] ^
+             (a[5] << 8);
+    }
+  };
+
+  /* The keys a record is currently indexed under */
+  struct Entry {
+    uint64_t seq;
+    RawAddress bd_addr;
+    RawAddress pseudo_addr;
+    RawAddress identity_addr;
+    uint16_t hci_handle;
+    uint16_t ble_hci_handle;
+    bool resolves_rpa;
+    Octet16 irk;
+  };
+
+  /* Records sharing a key, in the order they were added */
+  using Bucket = std::vector<tBTM_SEC_DEV_REC*>;
+
+  static Entry ReadEntry(const tBTM_SEC_DEV_REC* p_dev_rec, uint64_t seq);
+
+  template <typename Map, typename Key>
+  void Insert(Map& map, const Key& key, tBTM_SEC_DEV_REC* p_dev_rec);
+  template <typename Map, typename Key>
+  void Erase(Map& map, const Key& key, tBTM_SEC_DEV_REC* p_dev_rec);
+
+  void IndexEntry(tBTM_SEC_DEV_REC* p_dev_rec, const Entry& entry);
+  void UnindexEntry(tBTM_SEC_DEV_REC* p_dev_rec, const Entry& entry);
+  void InvalidateRpaCache();
+
+  uint64_t next_seq_ = 0;
+  std::unordered_map<const tBTM_SEC_DEV_REC*, Entry> entries_;
+  std::unordered_map<RawAddress, Bucket, AddressHash> by_address_;
+  std::unordered_map<RawAddress, Bucket, AddressHash> by_identity_addr_;
+  std::unordered_map<uint16_t, Bucket> by_handle_;
+  /* Records with an LE IRK, in the order they were added, and their IRKs
+   * laid out for crypto_toolbox::aes_128_batch() */
+  Bucket resolving_;
+  std::vector<Octet16> resolving_irks_;
+
+  /* Most recently used first. A null record marks an unresolvable RPA. */
+  using RpaCacheList = std::list<std::pair<RawAddress, tBTM_SEC_DEV_REC*>>;
+  size_t rpa_cache_capacity_;
+  RpaCacheList rpa_lru_;
+  std::unordered_map<RawAddress, RpaCacheList::iterator, AddressHash>
+      rpa_cache_;
+};
@@ -38,6 +38,7 @@
 #include "bt_common.h"
 #include "bt_types.h"
 #include "btm_api.h"
+#include "btm_inq_db_index.h"
 #include "btm_int.h"
 #include "btu.h"
 #include "hcidefs.h"
@@ -1224,7 +1225,7 @@ void btm_clr_inq_db(const RawAddress* p_bda) {
     if (p_ent->in_use) {
       /* If this is the specified BD_ADDR or clearing all devices */
       if (p_bda == NULL || (p_ent->inq_info.results.remote_bd_addr == *p_bda)) {
-        p_ent->in_use = false;
+        btm_inq_db_free(p_ent);
       }
     }
   }
@@ -1297,16 +1298,7 @@ bool btm_inq_find_bdaddr(const RawAddress& p_bda) {
  *
  ******************************************************************************/
 tINQ_DB_ENT* btm_inq_db_find(const RawAddress& p_bda) {
-  uint16_t xx;
-  tINQ_DB_ENT* p_ent = btm_cb.btm_inq_vars.inq_db;
-
-  for (xx = 0; xx < BTM_INQ_DB_SIZE; xx++, p_ent++) {
-    if (p_ent->in_use && p_ent->inq_info.results.remote_bd_addr == p_bda)
-      return (p_ent);
-  }
-
-  /* If here, not found */
-  return (NULL);
+  return btm_cb.btm_inq_vars.inq_db_index->Find(p_bda);
 }
 
 /*******************************************************************************
@@ -1331,6 +1323,7 @@ tINQ_DB_ENT* btm_inq_db_new(const RawAddress& p_bda) {
       memset(p_ent, 0, sizeof(tINQ_DB_ENT));
       p_ent->inq_info.results.remote_bd_addr = p_bda;
       p_ent->in_use = true;
+      btm_cb.btm_inq_vars.inq_db_index->Add(p_ent);
 
       return (p_ent);
     }
@@ -1343,13 +1336,29 @@ tINQ_DB_ENT* btm_inq_db_new(const RawAddress& p_bda) {
 
   /* If here, no free entry found. Return the oldest. */
 
+  btm_cb.btm_inq_vars.inq_db_index->Remove(p_old);
   memset(p_old, 0, sizeof(tINQ_DB_ENT));
   p_old->inq_info.results.remote_bd_addr = p_bda;
   p_old->in_use = true;
+  btm_cb.btm_inq_vars.inq_db_index->Add(p_old);
 
   return (p_old);
 }
 
+/*******************************************************************************
+ *
+ * Function         btm_inq_db_free
+ *
+ * Description      This function frees an entry of the inquiry database.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btm_inq_db_free(tINQ_DB_ENT* p_ent) {
+  btm_cb.btm_inq_vars.inq_db_index->Remove(p_ent);
+  p_ent->in_use = false;
+}
+
 /*******************************************************************************
  *
  * Function         btm_set_inq_event_filter
@@ -1823,6 +1832,7 @@ void btm_sort_inq_result(void) {
   }
 
   osi_free(p_tmp);
+  btm_cb.btm_inq_vars.inq_db_index->Rebuild();
 }
 
 /*******************************************************************************
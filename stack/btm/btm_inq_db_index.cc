@@ -0,0 +1,83 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "btm_inq_db_index.h"
+
+#include <base/logging.h>
+
+InquiryDbIndex::InquiryDbIndex(tINQ_DB_ENT* inq_db, size_t size)
+    : inq_db_(inq_db), size_(size), next_(size, kNone) {
+  CHECK(size < kNone);
+
+  size_t num_buckets = 1;
+  while (num_buckets < 2 * size) num_buckets <<= 1;
+  buckets_.assign(num_buckets, kNone);
+  mask_ = num_buckets - 1;
+
+  Rebuild();
+}
+
+size_t InquiryDbIndex::Bucket(const RawAddress& bda) const {
+  uint64_t key = 0;
+  for (uint8_t b : bda.address) key = (key << 8) | b;
+  return ((key * 0x9E3779B97F4A7C15ull) >> 32) & mask_;
+}
+
+tINQ_DB_ENT* InquiryDbIndex::Find(const RawAddress& bda) const {
+  for (uint16_t i = buckets_[Bucket(bda)]; i != kNone; i = next_[i]) {
+    tINQ_DB_ENT* p_ent = &inq_db_[i];
+    if (p_ent->in_use && p_ent->inq_info.results.remote_bd_addr == bda)
+      return p_ent;
+  }
+  return nullptr;
+}
+
+void InquiryDbIndex::Add(tINQ_DB_ENT* p_ent) {
+  uint16_t i = p_ent - inq_db_;
+  CHECK(i < size_);
+
+  uint16_t& head = buckets_[Bucket(p_ent->inq_info.results.remote_bd_addr)];
+  next_[i] = head;
+  head = i;
+}
+
+void InquiryDbIndex::Remove(tINQ_DB_ENT* p_ent) {
+  uint16_t i = p_ent - inq_db_;
+  CHECK(i < size_);
+
+  uint16_t* link = &buckets_[Bucket(p_ent->inq_info.results.remote_bd_addr)];
+  while (*link != kNone) {
+    if (*link == i) {
+      *link = next_[i];
+      next_[i] = kNone;
+      return;
+    }
+    link = &next_[*link];
+  }
+}
+
+void InquiryDbIndex::Rebuild() {
+  buckets_.assign(buckets_.size(), kNone);
+  next_.assign(size_, kNone);
+
+  // Added in reverse, so that Find() returns the first of duplicate entries,
+  // as a walk of the database would
+  for (size_t i = size_; i-- > 0;) {
+    if (inq_db_[i].in_use) Add(&inq_db_[i]);
+  }
+}
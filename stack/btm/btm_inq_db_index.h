@@ -0,0 +1,63 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "btm_int_types.h"
+
+/* InquiryDbIndex hashes the in use entries of an inquiry database, such as
+ * btm_cb.btm_inq_vars.inq_db, by device address, so that looking up the entry
+ * of the device behind every advertising report no longer walks the whole
+ * database.
+ *
+ * The entries stay in the database. An entry must be added once it is in use
+ * with its address set, and removed before it is freed or reused; see
+ * btm_inq_db_new() and btm_inq_db_free(). Whoever moves entries around must
+ * call Rebuild() afterwards.
+ */
+class InquiryDbIndex {
+ public:
+  InquiryDbIndex(tINQ_DB_ENT* inq_db, size_t size);
+
+  /* Returns the in use entry for |bda|, or nullptr */
+  tINQ_DB_ENT* Find(const RawAddress& bda) const;
+
+  /* Indexes an entry that was just taken into use */
+  void Add(tINQ_DB_ENT* p_ent);
+  /* Removes an entry before it is freed or reused */
+  void Remove(tINQ_DB_ENT* p_ent);
+  /* Indexes every in use entry from scratch */
+  void Rebuild();
+
+ private:
+  static constexpr uint16_t kNone = UINT16_MAX;
+
+  size_t Bucket(const RawAddress& bda) const;
+
+  tINQ_DB_ENT* inq_db_;
+  size_t size_;
+  /* first entry of every bucket, and the next entry in the same bucket for
+   * every entry */
+  std::vector<uint16_t> buckets_;
+  std::vector<uint16_t> next_;
+  size_t mask_;
+};
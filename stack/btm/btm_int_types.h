@@ -29,6 +29,9 @@
 
 typedef char tBTM_LOC_BD_NAME[BTM_MAX_LOC_BD_NAME_LEN + 1];
 
+class DeviceRecordIndex;
+class InquiryDbIndex;
+
 #define BTM_ACL_IS_CONNECTED(bda) \
   (btm_bda_to_acl(bda, BT_TRANSPORT_BR_EDR) != NULL)
 
@@ -265,6 +268,7 @@ typedef struct {
   uint16_t num_bd_entries; /* Number of entries in database */
   uint16_t max_bd_entries; /* Maximum number of entries that can be stored */
   tINQ_DB_ENT inq_db[BTM_INQ_DB_SIZE];
+  InquiryDbIndex* inq_db_index; /* lookups into inq_db */
   tBTM_INQ_PARMS inqparms; /* Contains the parameters for the current inquiry */
   tBTM_INQUIRY_CMPL
       inq_cmpl_info; /* Status and number of responses from the last inquiry */
@@ -814,6 +818,7 @@ typedef struct {
   uint8_t disc_reason;              /* for legacy devices */
   tBTM_SEC_SERV_REC sec_serv_rec[BTM_SEC_MAX_SERVICE_RECORDS];
   list_t* sec_dev_rec; /* list of tBTM_SEC_DEV_REC */
+  DeviceRecordIndex* sec_dev_index; /* lookups into sec_dev_rec */
   tBTM_SEC_SERV_REC* p_out_serv;
   tBTM_MKEY_CALLBACK* mkey_cback;
 
@@ -25,6 +25,8 @@
 #include <string.h>
 #include "bt_target.h"
 #include "bt_types.h"
+#include "btm_dev_index.h"
+#include "btm_inq_db_index.h"
 #include "btm_int.h"
 #include "stack_config.h"
 
@@ -69,6 +71,9 @@ void btm_init(void) {
   btm_sco_init(); /* SCO Database and Structures (If included) */
 
   btm_cb.sec_dev_rec = list_new(osi_free);
+  btm_cb.sec_dev_index = new DeviceRecordIndex();
+  btm_cb.btm_inq_vars.inq_db_index =
+      new InquiryDbIndex(btm_cb.btm_inq_vars.inq_db, BTM_INQ_DB_SIZE);
 
   btm_dev_init(); /* Device Manager Structures & HCI_Reset */
 }
@@ -93,6 +98,10 @@ void btm_free(void) {
 
   list_free(btm_cb.sec_dev_rec);
   btm_cb.sec_dev_rec = NULL;
+  delete btm_cb.sec_dev_index;
+  btm_cb.sec_dev_index = NULL;
+  delete btm_cb.btm_inq_vars.inq_db_index;
+  btm_cb.btm_inq_vars.inq_db_index = NULL;
 
   alarm_free(btm_cb.sec_collision_timer);
   btm_cb.sec_collision_timer = NULL;
@@ -22,7 +22,7 @@
  *
  ******************************************************************************/
 
-#include "stack/crypto_toolbox/aes.h"
+#include "stack/crypto_toolbox/aes_impl.h"
 #include "stack/crypto_toolbox/crypto_toolbox.h"
 
 #include <base/logging.h>
@@ -36,10 +36,9 @@ typedef struct {
   uint8_t* text;
   uint16_t len;
   uint16_t round;
+  aes_impl::KeySchedule key;
 } tCMAC_CB;
 
-tCMAC_CB cmac_cb;
-
 /* Rb for AES-128 as block cipher, LSB as [0] */
 Octet16 const_Rb{0x87, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
                  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
@@ -60,19 +59,14 @@ static void xor_128(Octet16* a, const Octet16& b) {
 
 /* This function computes AES_128(key, message) */
 Octet16 aes_128(const Octet16& key, const Octet16& message) {
-  Octet16 key_reversed;
-  Octet16 message_reversed;
-  Octet16 output;
-
-  std::reverse_copy(key.begin(), key.end(), key_reversed.begin());
-  std::reverse_copy(message.begin(), message.end(), message_reversed.begin());
-
-  aes_context ctx;
-  aes_set_key(key_reversed.data(), key_reversed.size(), &ctx);
-  aes_encrypt(message_reversed.data(), output.data(), &ctx);
+  aes_impl::KeySchedule ks;
+  aes_impl::expand_key(aes_get_impl(), key, &ks);
+  return aes_impl::encrypt(ks, message);
+}
 
-  std::reverse(output.begin(), output.end());
-  return output;
+void aes_128_batch(const Octet16* keys, const Octet16* messages,
+                   Octet16* outputs, size_t n) {
+  aes_impl::encrypt_batch(aes_get_impl(), keys, messages, outputs, n);
 }
 
 /** utility function to padding the given text to be a 128 bits data. The
@@ -99,19 +93,19 @@ static void leftshift_onebit(uint8_t* input, uint8_t* output) {
 }
 
 /** This function is the calculation of block cipher using AES-128. */
-static Octet16 cmac_aes_k_calculate(const Octet16& key) {
+static Octet16 cmac_aes_k_calculate(tCMAC_CB* p_cb) {
   Octet16 output;
   Octet16 x{0};  // zero initialized
 
   DVLOG(2) << __func__;
 
-  uint8_t i = 1;
-  while (i <= cmac_cb.round) {
+  uint16_t i = 1;
+  while (i <= p_cb->round) {
+    Octet16* p_block = (Octet16*)&p_cb->text[(p_cb->round - i) * OCTET16_LEN];
     /* Mi' := Mi (+) X  */
-    xor_128((Octet16*)&cmac_cb.text[(cmac_cb.round - i) * OCTET16_LEN], x);
+    xor_128(p_block, x);
 
-    output = aes_128(key, &cmac_cb.text[(cmac_cb.round - i) * OCTET16_LEN],
-                     OCTET16_LEN);
+    output = aes_impl::encrypt(p_cb->key, *p_block);
     x = output;
     i++;
   }
@@ -122,34 +116,35 @@ static Octet16 cmac_aes_k_calculate(const Octet16& key) {
 /** This function proceeed to prepare the last block of message Mn depending on
  * the size of the message.
  */
-static void cmac_prepare_last_block(const Octet16& k1, const Octet16& k2) {
+static void cmac_prepare_last_block(tCMAC_CB* p_cb, const Octet16& k1,
+                                    const Octet16& k2) {
   //    uint8_t     x[16] = {0};
   bool flag;
 
   DVLOG(2) << __func__;
   /* last block is a complete block set flag to 1 */
-  flag = ((cmac_cb.len % OCTET16_LEN) == 0 && cmac_cb.len != 0) ? true : false;
+  flag = ((p_cb->len % OCTET16_LEN) == 0 && p_cb->len != 0) ? true : false;
 
-  DVLOG(2) << "flag=" << flag << " round=" << cmac_cb.round;
+  DVLOG(2) << "flag=" << flag << " round=" << p_cb->round;
 
   if (flag) { /* last block is complete block */
-    xor_128((Octet16*)&cmac_cb.text[0], k1);
+    xor_128((Octet16*)&p_cb->text[0], k1);
   } else /* padding then xor with k2 */
   {
-    padding((Octet16*)&cmac_cb.text[0], (uint8_t)(cmac_cb.len % 16));
+    padding((Octet16*)&p_cb->text[0], (uint8_t)(p_cb->len % 16));
 
-    xor_128((Octet16*)&cmac_cb.text[0], k2);
+    xor_128((Octet16*)&p_cb->text[0], k2);
   }
 }
 
 /** This is the function to generate the two subkeys.
  * |key| is CMAC key, expect SRK when used by SMP.
  */
-static void cmac_generate_subkey(const Octet16& key) {
+static void cmac_generate_subkey(tCMAC_CB* p_cb) {
   DVLOG(2) << __func__;
 
   Octet16 zero{};
-  Octet16 p = aes_128(key, zero.data(), OCTET16_LEN);
+  Octet16 p = aes_impl::encrypt(p_cb->key, zero);
 
   Octet16 k1, k2;
   uint8_t* pp = p.data();
@@ -172,7 +167,7 @@ static void cmac_generate_subkey(const Octet16& key) {
     leftshift_onebit(k1.data(), k2.data());
   }
 
-  cmac_prepare_last_block(k1, k2);
+  cmac_prepare_last_block(p_cb, k1, k2);
 }
 
 /** key - CMAC key in little endian order
@@ -180,6 +175,7 @@ static void cmac_generate_subkey(const Octet16& key) {
  *  length - length of the input in byte.
  */
 Octet16 aes_cmac(const Octet16& key, const uint8_t* input, uint16_t length) {
+  tCMAC_CB cmac_cb;
   uint16_t len, diff;
   /* n is number of rounds */
   uint16_t n = (length + OCTET16_LEN - 1) / OCTET16_LEN;
@@ -202,10 +198,13 @@ Octet16 aes_cmac(const Octet16& key, const uint8_t* input, uint16_t length) {
     cmac_cb.len = 0;
   }
 
+  /* the key is expanded once for the subkeys and all the blocks */
+  aes_impl::expand_key(aes_get_impl(), key, &cmac_cb.key);
+
   /* prepare calculation for subkey s and last block of data */
-  cmac_generate_subkey(key);
+  cmac_generate_subkey(&cmac_cb);
   /* start calculation */
-  Octet16 signature = cmac_aes_k_calculate(key);
+  Octet16 signature = cmac_aes_k_calculate(&cmac_cb);
 
   /* clean up */
   memset(&cmac_cb, 0, sizeof(tCMAC_CB));
@@ -0,0 +1,396 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/******************************************************************************
+ *
+ *  AES-128 encryption with 32 bit T-tables, and with the x86 AES-NI
+ *  instructions where the CPU has them. The byte oriented implementation of
+ *  aes.cc stays available as AesImpl::BYTE.
+ *
+ *  crypto_toolbox keeps its keys and blocks in little endian byte order, the
+ *  reverse of FIPS-197. The implementations below read and write them in that
+ *  order directly instead of reversing copies.
+ *
+ ******************************************************************************/
+
+#include "stack/crypto_toolbox/aes_impl.h"
+
+#include <algorithm>
+#include <atomic>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define AES_HAS_AESNI
+#endif
+
+namespace crypto_toolbox {
+namespace aes_impl {
+
+namespace {
+
+/******************************************************************************
+ * AesImpl::BYTE
+ ******************************************************************************/
+
+void byte_expand_key(const Octet16& key, KeySchedule* ks) {
+  Octet16 key_reversed;
+  std::reverse_copy(key.begin(), key.end(), key_reversed.begin());
+  aes_set_key(key_reversed.data(), key_reversed.size(), &ks->byte_ctx);
+}
+
+Octet16 byte_encrypt(const KeySchedule& ks, const Octet16& message) {
+  Octet16 message_reversed;
+  Octet16 output;
+  std::reverse_copy(message.begin(), message.end(), message_reversed.begin());
+  aes_encrypt(message_reversed.data(), output.data(), &ks.byte_ctx);
+  std::reverse(output.begin(), output.end());
+  return output;
+}
+
+/******************************************************************************
+ * AesImpl::TTABLE
+ ******************************************************************************/
+
+constexpr uint8_t kSbox[256] = {
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5,
+    0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+    0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0,
+    0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+    0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc,
+    0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a,
+    0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+    0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0,
+    0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+    0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b,
+    0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85,
+    0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+    0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5,
+    0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+    0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17,
+    0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88,
+    0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+    0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c,
+    0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+    0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9,
+    0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6,
+    0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+    0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e,
+    0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+    0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94,
+    0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68,
+    0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16,
+};
+
+constexpr uint8_t kRcon[10] = {0x01, 0x02, 0x04, 0x08, 0x10,
+                               0x20, 0x40, 0x80, 0x1b, 0x36};
+
+constexpr uint8_t xtime(uint8_t x) {
+  return static_cast<uint8_t>((x << 1) ^ ((x & 0x80) ? 0x1b : 0x00));
+}
+
+/* te[0][x] is the MixColumns column {2, 1, 1, 3} times S(x); te[1..3] are its
+ * byte rotations, so a round is 16 lookups and XORs. */
+struct TeTables {
+  uint32_t te[4][256];
+};
+
+constexpr TeTables make_te_tables() {
+  TeTables t{};
+  for (int i = 0; i < 256; i++) {
+    uint8_t s = kSbox[i];
+    uint32_t w = static_cast<uint32_t>(xtime(s)) << 24 |
+                 static_cast<uint32_t>(s) << 16 |
+                 static_cast<uint32_t>(s) << 8 | (xtime(s) ^ s);
+    t.te[0][i] = w;
+    t.te[1][i] = w >> 8 | w << 24;
+    t.te[2][i] = w >> 16 | w << 16;
+    t.te[3][i] = w >> 24 | w << 8;
+  }
+  return t;
+}
+
+constexpr TeTables kTe = make_te_tables();
+
+/* Column |i| of the FIPS-197 state, from little endian |le| */
+inline uint32_t load_column(const uint8_t* le, int i) {
+  const uint8_t* p = le + OCTET16_LEN - 4 * i;
+  return static_cast<uint32_t>(p[-1]) << 24 |
+         static_cast<uint32_t>(p[-2]) << 16 |
+         static_cast<uint32_t>(p[-3]) << 8 | p[-4];
+}
+
+inline void store_column(uint8_t* le, int i, uint32_t w) {
+  uint8_t* p = le + OCTET16_LEN - 4 * i;
+  p[-1] = w >> 24;
+  p[-2] = w >> 16;
+  p[-3] = w >> 8;
+  p[-4] = w;
+}
+
+inline uint32_t sub_word(uint32_t w) {
+  return static_cast<uint32_t>(kSbox[w >> 24]) << 24 |
+         static_cast<uint32_t>(kSbox[(w >> 16) & 0xff]) << 16 |
+         static_cast<uint32_t>(kSbox[(w >> 8) & 0xff]) << 8 |
+         kSbox[w & 0xff];
+}
+
+void ttable_expand_key(const Octet16& key, KeySchedule* ks) {
+  uint32_t* w = ks->words;
+  for (int i = 0; i < 4; i++) w[i] = load_column(key.data(), i);
+  for (int i = 4; i < 44; i++) {
+    uint32_t t = w[i - 1];
+    if (i % 4 == 0) {
+      t = sub_word(t << 8 | t >> 24) ^ static_cast<uint32_t>(kRcon[i / 4 - 1])
+                                           << 24;
+    }
+    w[i] = w[i - 4] ^ t;
+  }
+}
+
+Octet16 ttable_encrypt(const KeySchedule& ks, const Octet16& message) {
+  const uint32_t(*te)[256] = kTe.te;
+  const uint32_t* rk = ks.words;
+  uint32_t s0 = load_column(message.data(), 0) ^ rk[0];
+  uint32_t s1 = load_column(message.data(), 1) ^ rk[1];
+  uint32_t s2 = load_column(message.data(), 2) ^ rk[2];
+  uint32_t s3 = load_column(message.data(), 3) ^ rk[3];
+
+  for (int round = 1; round < 10; round++) {
+    rk += 4;
+    uint32_t t0 = te[0][s0 >> 24] ^ te[1][(s1 >> 16) & 0xff] ^
+                  te[2][(s2 >> 8) & 0xff] ^ te[3][s3 & 0xff] ^ rk[0];
+    uint32_t t1 = te[0][s1 >> 24] ^ te[1][(s2 >> 16) & 0xff] ^
+                  te[2][(s3 >> 8) & 0xff] ^ te[3][s0 & 0xff] ^ rk[1];
+    uint32_t t2 = te[0][s2 >> 24] ^ te[1][(s3 >> 16) & 0xff] ^
+                  te[2][(s0 >> 8) & 0xff] ^ te[3][s1 & 0xff] ^ rk[2];
+    uint32_t t3 = te[0][s3 >> 24] ^ te[1][(s0 >> 16) & 0xff] ^
+                  te[2][(s1 >> 8) & 0xff] ^ te[3][s2 & 0xff] ^ rk[3];
+    s0 = t0;
+    s1 = t1;
+    s2 = t2;
+    s3 = t3;
+  }
+
+  /* last round: SubBytes and ShiftRows, no MixColumns */
+  rk += 4;
+  Octet16 output;
+  store_column(output.data(), 0,
+               (static_cast<uint32_t>(kSbox[s0 >> 24]) << 24 |
+                static_cast<uint32_t>(kSbox[(s1 >> 16) & 0xff]) << 16 |
+                static_cast<uint32_t>(kSbox[(s2 >> 8) & 0xff]) << 8 |
+                kSbox[s3 & 0xff]) ^
+                   rk[0]);
+  store_column(output.data(), 1,
+               (static_cast<uint32_t>(kSbox[s1 >> 24]) << 24 |
+                static_cast<uint32_t>(kSbox[(s2 >> 16) & 0xff]) << 16 |
+                static_cast<uint32_t>(kSbox[(s3 >> 8) & 0xff]) << 8 |
+                kSbox[s0 & 0xff]) ^
+                   rk[1]);
+  store_column(output.data(), 2,
+               (static_cast<uint32_t>(kSbox[s2 >> 24]) << 24 |
+                static_cast<uint32_t>(kSbox[(s3 >> 16) & 0xff]) << 16 |
+                static_cast<uint32_t>(kSbox[(s0 >> 8) & 0xff]) << 8 |
+                kSbox[s1 & 0xff]) ^
+                   rk[2]);
+  store_column(output.data(), 3,
+               (static_cast<uint32_t>(kSbox[s3 >> 24]) << 24 |
+                static_cast<uint32_t>(kSbox[(s0 >> 16) & 0xff]) << 16 |
+                static_cast<uint32_t>(kSbox[(s1 >> 8) & 0xff]) << 8 |
+                kSbox[s2 & 0xff]) ^
+                   rk[3]);
+  return output;
+}
+
+/******************************************************************************
+ * AesImpl::AESNI
+ ******************************************************************************/
+
+#if defined(AES_HAS_AESNI)
+
+#define AESNI_TARGET __attribute__((target("aes,ssse3")))
+
+/* Number of blocks encrypt_batch() keeps in flight. AESENC has a latency of
+ * about four cycles and a throughput of one per cycle. */
+#define AESNI_BATCH_LANES 4
+
+AESNI_TARGET inline __m128i aesni_load(const Octet16& x) {
+  const __m128i reverse =
+      _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  return _mm_shuffle_epi8(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(x.data())), reverse);
+}
+
+AESNI_TARGET inline void aesni_store(__m128i x, Octet16* out) {
+  const __m128i reverse =
+      _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out->data()),
+                   _mm_shuffle_epi8(x, reverse));
+}
+
+/* Returns the round key following |key|. SubWord(RotWord()) comes from
+ * AESENCLAST on the last word broadcast to all columns, where ShiftRows has no
+ * effect; that is several times the throughput of AESKEYGENASSIST. */
+AESNI_TARGET inline __m128i aesni_next_key(__m128i key, uint8_t rcon) {
+  const __m128i rot_word = _mm_set1_epi32(0x0c0f0e0d);
+  __m128i t = _mm_aesenclast_si128(_mm_shuffle_epi8(key, rot_word),
+                                   _mm_set1_epi32(rcon));
+  key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+  key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+  key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+  return _mm_xor_si128(key, t);
+}
+
+AESNI_TARGET void aesni_expand_key(const Octet16& key, KeySchedule* ks) {
+  __m128i* rk = reinterpret_cast<__m128i*>(ks->round_keys);
+  rk[0] = aesni_load(key);
+  for (int round = 1; round <= 10; round++) {
+    rk[round] = aesni_next_key(rk[round - 1], kRcon[round - 1]);
+  }
+}
+
+AESNI_TARGET Octet16 aesni_encrypt(const KeySchedule& ks,
+                                   const Octet16& message) {
+  const __m128i* rk = reinterpret_cast<const __m128i*>(ks.round_keys);
+  __m128i s = _mm_xor_si128(aesni_load(message), rk[0]);
+  for (int round = 1; round < 10; round++) s = _mm_aesenc_si128(s, rk[round]);
+  s = _mm_aesenclast_si128(s, rk[10]);
+
+  Octet16 output;
+  aesni_store(s, &output);
+  return output;
+}
+
+AESNI_TARGET void aesni_encrypt_batch(const Octet16* keys,
+                                      const Octet16* messages,
+                                      Octet16* outputs, size_t n) {
+  size_t i = 0;
+  for (; i + AESNI_BATCH_LANES <= n; i += AESNI_BATCH_LANES) {
+    __m128i k[AESNI_BATCH_LANES];
+    __m128i s[AESNI_BATCH_LANES];
+    for (int j = 0; j < AESNI_BATCH_LANES; j++) {
+      k[j] = aesni_load(keys[i + j]);
+      s[j] = _mm_xor_si128(aesni_load(messages[i + j]), k[j]);
+    }
+    /* every lane's key is expanded on the fly, one round ahead of its block */
+    for (int round = 1; round < 10; round++) {
+      for (int j = 0; j < AESNI_BATCH_LANES; j++) {
+        k[j] = aesni_next_key(k[j], kRcon[round - 1]);
+        s[j] = _mm_aesenc_si128(s[j], k[j]);
+      }
+    }
+    for (int j = 0; j < AESNI_BATCH_LANES; j++) {
+      k[j] = aesni_next_key(k[j], kRcon[9]);
+      aesni_store(_mm_aesenclast_si128(s[j], k[j]), &outputs[i + j]);
+    }
+  }
+
+  for (; i < n; i++) {
+    KeySchedule ks;
+    aesni_expand_key(keys[i], &ks);
+    outputs[i] = aesni_encrypt(ks, messages[i]);
+  }
+}
+
+bool cpu_has_aesni() {
+  return __builtin_cpu_supports("aes") && __builtin_cpu_supports("ssse3");
+}
+
+#else
+
+bool cpu_has_aesni() { return false; }
+
+#endif  // AES_HAS_AESNI
+
+}  // namespace
+
+AesImpl best() {
+  static const AesImpl impl =
+      cpu_has_aesni() ? AesImpl::AESNI : AesImpl::TTABLE;
+  return impl;
+}
+
+void expand_key(AesImpl impl, const Octet16& key, KeySchedule* ks) {
+  ks->impl = impl;
+  switch (impl) {
+    case AesImpl::BYTE:
+      byte_expand_key(key, ks);
+      break;
+    case AesImpl::TTABLE:
+      ttable_expand_key(key, ks);
+      break;
+    case AesImpl::AESNI:
+#if defined(AES_HAS_AESNI)
+      aesni_expand_key(key, ks);
+#endif
+      break;
+  }
+}
+
+Octet16 encrypt(const KeySchedule& ks, const Octet16& message) {
+  switch (ks.impl) {
+    case AesImpl::BYTE:
+      return byte_encrypt(ks, message);
+    case AesImpl::TTABLE:
+      return ttable_encrypt(ks, message);
+    case AesImpl::AESNI:
+#if defined(AES_HAS_AESNI)
+      return aesni_encrypt(ks, message);
+#endif
+      break;
+  }
+  return Octet16{};
+}
+
+void encrypt_batch(AesImpl impl, const Octet16* keys, const Octet16* messages,
+                   Octet16* outputs, size_t n) {
+#if defined(AES_HAS_AESNI)
+  if (impl == AesImpl::AESNI) {
+    aesni_encrypt_batch(keys, messages, outputs, n);
+    return;
+  }
+#endif
+
+  KeySchedule ks;
+  for (size_t i = 0; i < n; i++) {
+    expand_key(impl, keys[i], &ks);
+    outputs[i] = encrypt(ks, messages[i]);
+  }
+}
+
+}  // namespace aes_impl
+
+namespace {
+std::atomic<AesImpl> current_impl(aes_impl::best());
+}  // namespace
+
+bool aes_impl_supported(AesImpl impl) {
+  return impl != AesImpl::AESNI || aes_impl::best() == AesImpl::AESNI;
+}
+
+AesImpl aes_get_impl() { return current_impl.load(std::memory_order_relaxed); }
+
+bool aes_set_impl(AesImpl impl) {
+  if (!aes_impl_supported(impl)) return false;
+  current_impl.store(impl, std::memory_order_relaxed);
+  return true;
+}
+
+}  // namespace crypto_toolbox
@@ -0,0 +1,51 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "stack/crypto_toolbox/aes.h"
+#include "stack/crypto_toolbox/crypto_toolbox.h"
+
+namespace crypto_toolbox {
+namespace aes_impl {
+
+/* An AES-128 key expanded for one of the implementations. Expanding the key
+ * costs about as much as encrypting a block, so aes_cmac() expands it once
+ * per message instead of once per block. */
+struct KeySchedule {
+  AesImpl impl;
+  union {
+    aes_context byte_ctx;                    /* AesImpl::BYTE */
+    uint32_t words[44];                      /* AesImpl::TTABLE */
+    alignas(16) uint8_t round_keys[11 * 16]; /* AesImpl::AESNI */
+  };
+};
+
+/* The implementation aes_128() starts with */
+AesImpl best();
+
+/* All of these take and return keys and blocks in the little endian byte
+ * order of aes_128() */
+void expand_key(AesImpl impl, const Octet16& key, KeySchedule* ks);
+Octet16 encrypt(const KeySchedule& ks, const Octet16& message);
+void encrypt_batch(AesImpl impl, const Octet16* keys, const Octet16* messages,
+                   Octet16* outputs, size_t n);
+
+}  // namespace aes_impl
+}  // namespace crypto_toolbox
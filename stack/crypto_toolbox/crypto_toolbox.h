@@ -20,7 +20,26 @@
 
 namespace crypto_toolbox {
 
+/* AES-128 block cipher implementations. aes_128() and aes_cmac() use the
+ * fastest one the CPU supports. */
+enum class AesImpl : uint8_t {
+  BYTE,   /* byte oriented, see aes.h */
+  TTABLE, /* 32 bit words and T-tables */
+  AESNI,  /* x86 AES-NI instructions */
+};
+
+extern bool aes_impl_supported(AesImpl impl);
+extern AesImpl aes_get_impl();
+/* Switches the implementation used from now on, for tests and benchmarks.
+ * Returns false, and changes nothing, if the CPU does not support |impl| */
+extern bool aes_set_impl(AesImpl impl);
+
 extern Octet16 aes_128(const Octet16& key, const Octet16& message);
+/* Computes outputs[i] = AES_128(keys[i], messages[i]) for all |n| blocks. The
+ * blocks are interleaved, which beats |n| calls to aes_128() where the CPU
+ * pipelines AES rounds. */
+extern void aes_128_batch(const Octet16* keys, const Octet16* messages,
+                          Octet16* outputs, size_t n);
 extern Octet16 aes_cmac(const Octet16& key, const uint8_t* message,
                         uint16_t length);
 extern Octet16 f4(uint8_t* u, uint8_t* v, const Octet16& x, uint8_t z);
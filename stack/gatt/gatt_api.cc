@@ -30,6 +30,7 @@
 #include "btm_int.h"
 #include "device/include/controller.h"
 #include "gatt_api.h"
+#include "gatt_db_index.h"
 #include "gatt_int.h"
 #include "l2c_api.h"
 #include "stack/gatt/connection_manager.h"
@@ -291,6 +292,7 @@ uint16_t GATTS_AddService(tGATT_IF gatt_if, btgatt_db_element_t* service,
     elem.sdp_handle = 0;
   }
 
+  gatt_cb.srv_index->AddService(rit);
   gatt_update_last_srv_info();
 
   VLOG(1) << __func__ << ": allocated el s_hdl=" << loghex(elem.s_hdl)
@@ -389,6 +391,7 @@ void GATTS_StopService(uint16_t service_handle) {
     SDP_DeleteRecord(it->sdp_handle);
   }
 
+  gatt_cb.srv_index->RemoveService(it);
   gatt_cb.srv_list_info->erase(it);
   gatt_update_last_srv_info();
 }
@@ -0,0 +1,175 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "gatt_db_index.h"
+
+#include <algorithm>
+
+using bluetooth::Uuid;
+
+namespace {
+
+bool entry_before(const GattDbIndex::Entry& entry, uint16_t handle) {
+  return entry.handle < handle;
+}
+
+bool before_entry(uint16_t handle, const GattDbIndex::Entry& entry) {
+  return handle < entry.handle;
+}
+
+}  // namespace
+
+GattDbIndex::Range GattDbIndex::Slice(const Entries& entries, uint16_t s_hdl,
+                                      uint16_t e_hdl) {
+  const Entry* first = entries.data();
+  const Entry* last = first + entries.size();
+  if (s_hdl > e_hdl) return Range(last, last);
+
+  first = std::lower_bound(first, last, s_hdl, entry_before);
+  last = std::upper_bound(first, last, e_hdl, before_entry);
+  return Range(first, last);
+}
+
+const GattDbIndex::Service* GattDbIndex::LookupService(uint16_t handle) const {
+  // The last service starting at or before |handle|
+  auto it = std::upper_bound(
+      services_.begin(), services_.end(), handle,
+      [](uint16_t handle, const Service& s) { return handle < s.s_hdl; });
+  if (it == services_.begin()) return nullptr;
+
+  --it;
+  if (it->e_hdl < handle) return nullptr;
+  return &*it;
+}
+
+void GattDbIndex::UpdateAttrOffsets() {
+  // Services do not overlap, so their attributes follow each other in
+  // |attrs_| in the same order as the services.
+  size_t first_attr = 0;
+  for (Service& s : services_) {
+    s.first_attr = first_attr;
+    first_attr += s.num_attrs;
+  }
+}
+
+void GattDbIndex::AddService(ServiceIterator service) {
+  tGATT_SRV_LIST_ELEM& el = *service;
+  size_t num_attrs = el.p_db ? el.p_db->attr_list.size() : 0;
+  auto svc_it = std::upper_bound(
+      services_.begin(), services_.end(), el.s_hdl,
+      [](uint16_t s_hdl, const Service& s) { return s_hdl < s.s_hdl; });
+  services_.insert(svc_it, Service{el.s_hdl, el.e_hdl, service, 0, num_attrs});
+
+  if (num_attrs == 0) {
+    UpdateAttrOffsets();
+    return;
+  }
+
+  // The attributes of a service have consecutive handles, allocated in order,
+  // and no other service's handles fall between them, so they go in as one
+  // block.
+  Entries block;
+  block.reserve(el.p_db->attr_list.size());
+  for (tGATT_ATTR& attr : el.p_db->attr_list) {
+    Entry entry{attr.handle, &attr, &el};
+    block.push_back(entry);
+
+    Entries& of_type = by_type_[attr.uuid];
+    of_type.insert(std::upper_bound(of_type.begin(), of_type.end(),
+                                    attr.handle, before_entry),
+                   entry);
+  }
+
+  auto attr_it = std::lower_bound(attrs_.begin(), attrs_.end(),
+                                  block.front().handle, entry_before);
+  attrs_.insert(attr_it, block.begin(), block.end());
+  UpdateAttrOffsets();
+}
+
+void GattDbIndex::RemoveService(ServiceIterator service) {
+  tGATT_SRV_LIST_ELEM* p_service = &*service;
+  services_.erase(std::remove_if(services_.begin(), services_.end(),
+                                 [p_service](const Service& s) {
+                                   return &*s.it == p_service;
+                                 }),
+                  services_.end());
+
+  auto first = std::lower_bound(attrs_.begin(), attrs_.end(),
+                                p_service->s_hdl, entry_before);
+  auto last = std::upper_bound(first, attrs_.end(), p_service->e_hdl,
+                               before_entry);
+  for (auto it = first; it != last; it++) {
+    if (it->p_service != p_service) continue;
+
+    auto type_it = by_type_.find(it->p_attr->uuid);
+    if (type_it == by_type_.end()) continue;
+
+    Entries& of_type = type_it->second;
+    auto pos = std::lower_bound(of_type.begin(), of_type.end(), it->handle,
+                                entry_before);
+    if (pos != of_type.end() && pos->handle == it->handle) of_type.erase(pos);
+    if (of_type.empty()) by_type_.erase(type_it);
+  }
+
+  attrs_.erase(std::remove_if(first, last,
+                              [p_service](const Entry& entry) {
+                                return entry.p_service == p_service;
+                              }),
+               last);
+  UpdateAttrOffsets();
+}
+
+void GattDbIndex::Clear() {
+  services_.clear();
+  attrs_.clear();
+  by_type_.clear();
+}
+
+const GattDbIndex::ServiceIterator* GattDbIndex::FindService(
+    uint16_t handle) const {
+  const Service* service = LookupService(handle);
+  return service ? &service->it : nullptr;
+}
+
+const GattDbIndex::Entry* GattDbIndex::Find(uint16_t handle) const {
+  const Service* service = LookupService(handle);
+  if (!service) return nullptr;
+
+  // Attributes are allocated consecutive handles from the start of their
+  // service, so the handle is usually the offset into the service's run.
+  const Entry* first = attrs_.data() + service->first_attr;
+  const Entry* last = first + service->num_attrs;
+  size_t offset = handle - service->s_hdl;
+  if (offset < service->num_attrs && first[offset].handle == handle)
+    return &first[offset];
+
+  const Entry* it = std::lower_bound(first, last, handle, entry_before);
+  if (it == last || it->handle != handle) return nullptr;
+  return it;
+}
+
+GattDbIndex::Range GattDbIndex::Find(uint16_t s_hdl, uint16_t e_hdl) const {
+  return Slice(attrs_, s_hdl, e_hdl);
+}
+
+GattDbIndex::Range GattDbIndex::FindByType(const Uuid& type, uint16_t s_hdl,
+                                           uint16_t e_hdl) const {
+  auto it = by_type_.find(type);
+  if (it == by_type_.end()) return Range(nullptr, nullptr);
+  return Slice(it->second, s_hdl, e_hdl);
+}
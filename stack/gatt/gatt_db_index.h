@@ -0,0 +1,120 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include "gatt_int.h"
+
+/* GattDbIndex indexes the attributes of the started services, as kept in
+ * gatt_cb.srv_list_info, so that serving an ATT request no longer walks every
+ * service and then every attribute of the one owning the handle.
+ *
+ * It holds, all sorted by handle:
+ *  - the handle range of every service,
+ *  - every attribute of every service, as one flat vector,
+ *  - for every attribute type, the attributes of that type ("posting lists"),
+ *    for Read By Type and Read By Group Type range scans.
+ *
+ * The services and their attribute databases stay owned by gatt_cb. A service
+ * must be added once its database is complete, and removed before it is
+ * erased from gatt_cb.srv_list_info; see GATTS_AddService() and
+ * GATTS_StopService(). Service handle ranges must not overlap.
+ */
+class GattDbIndex {
+ public:
+  using ServiceIterator = std::list<tGATT_SRV_LIST_ELEM>::iterator;
+
+  struct Entry {
+    uint16_t handle;
+    tGATT_ATTR* p_attr;
+    tGATT_SRV_LIST_ELEM* p_service;
+  };
+
+  /* A run of entries, in handle order */
+  class Range {
+   public:
+    Range(const Entry* first, const Entry* last) : first_(first), last_(last) {}
+    const Entry* begin() const { return first_; }
+    const Entry* end() const { return last_; }
+    bool empty() const { return first_ == last_; }
+    size_t size() const { return last_ - first_; }
+
+   private:
+    const Entry* first_;
+    const Entry* last_;
+  };
+
+  /* Indexes a started service and every attribute in its database */
+  void AddService(ServiceIterator service);
+  /* Removes a service before it is erased from gatt_cb.srv_list_info */
+  void RemoveService(ServiceIterator service);
+  /* Drops every service */
+  void Clear();
+
+  /* Returns the service whose handle range holds |handle|, or nullptr */
+  const ServiceIterator* FindService(uint16_t handle) const;
+  /* Returns the attribute with handle |handle|, or nullptr */
+  const Entry* Find(uint16_t handle) const;
+  /* Returns the attributes with handles in [s_hdl, e_hdl] */
+  Range Find(uint16_t s_hdl, uint16_t e_hdl) const;
+  /* Returns the attributes of type |type| with handles in [s_hdl, e_hdl] */
+  Range FindByType(const bluetooth::Uuid& type, uint16_t s_hdl,
+                   uint16_t e_hdl) const;
+
+  size_t num_services() const { return services_.size(); }
+  size_t num_attributes() const { return attrs_.size(); }
+  size_t num_types() const { return by_type_.size(); }
+
+ private:
+  struct Service {
+    uint16_t s_hdl;
+    uint16_t e_hdl;
+    ServiceIterator it;
+    /* where the attributes of the service start in |attrs_|, and how many */
+    size_t first_attr;
+    size_t num_attrs;
+  };
+
+  struct UuidHash {
+    size_t operator()(const bluetooth::Uuid& uuid) const {
+      const uint8_t* p = uuid.To128BitBE().data();
+      uint64_t high, low;
+      memcpy(&high, p, sizeof(high));
+      memcpy(&low, p + sizeof(high), sizeof(low));
+      return high ^ (low * 0x9E3779B97F4A7C15ull);
+    }
+  };
+
+  using Entries = std::vector<Entry>;
+
+  static Range Slice(const Entries& entries, uint16_t s_hdl, uint16_t e_hdl);
+
+  const Service* LookupService(uint16_t handle) const;
+  void UpdateAttrOffsets();
+
+  std::vector<Service> services_;
+  Entries attrs_;
+  std::unordered_map<bluetooth::Uuid, Entries, UuidHash> by_type_;
+};
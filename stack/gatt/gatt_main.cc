@@ -31,6 +31,7 @@
 #include "btm_int.h"
 #include "connection_manager.h"
 #include "device/include/interop.h"
+#include "gatt_db_index.h"
 #include "gatt_int.h"
 #include "l2c_api.h"
 #include "osi/include/osi.h"
@@ -140,6 +141,7 @@ void gatt_init(void) {
 
   gatt_cb.hdl_list_info = new std::list<tGATT_HDL_LIST_ELEM>();
   gatt_cb.srv_list_info = new std::list<tGATT_SRV_LIST_ELEM>();
+  gatt_cb.srv_index = new GattDbIndex();
   gatt_profile_db_init();
 }
 
@@ -180,6 +182,8 @@ void gatt_free(void) {
   gatt_cb.hdl_list_info = nullptr;
   gatt_cb.srv_list_info->clear();
   gatt_cb.srv_list_info = nullptr;
+  delete gatt_cb.srv_index;
+  gatt_cb.srv_index = nullptr;
 }
 
 /*******************************************************************************
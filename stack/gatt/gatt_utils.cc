@@ -32,6 +32,7 @@
 #include "btm_int.h"
 #include "connection_manager.h"
 #include "gatt_api.h"
+#include "gatt_db_index.h"
 #include "gatt_int.h"
 #include "gattdefs.h"
 #include "l2cdefs.h"
@@ -656,21 +657,17 @@ void gatt_ind_ack_timeout(void* data) {
  *
  * Description      Search for a service that owns a specific handle.
  *
- * Returns          GATT_MAX_SR_PROFILES if not found. Otherwise the index of
- *                  the service.
+ * Returns          gatt_cb.srv_list_info->end() if not found. Otherwise the
+ *                  service.
  *
  ******************************************************************************/
 std::list<tGATT_SRV_LIST_ELEM>::iterator gatt_sr_find_i_rcb_by_handle(
     uint16_t handle) {
-  auto it = gatt_cb.srv_list_info->begin();
+  const GattDbIndex::ServiceIterator* it =
+      gatt_cb.srv_index->FindService(handle);
+  if (it == nullptr) return gatt_cb.srv_list_info->end();
 
-  for (; it != gatt_cb.srv_list_info->end(); it++) {
-    if (it->s_hdl <= handle && it->e_hdl >= handle) {
-      return it;
-    }
-  }
-
-  return it;
+  return *it;
 }
 
 /*******************************************************************************
@@ -56,4 +56,7 @@ uint64_t a2dp_aac_get_encoder_interval_ms(void);
 // |timestamp_us| is the current timestamp (in microseconds).
 void a2dp_aac_send_frames(uint64_t timestamp_us);
 
+// Set the A2DP AAC encoder bit rate, in percent of the configured one.
+void a2dp_aac_set_bitrate_percent(uint8_t bitrate_percent);
+
 #endif  // A2DP_AAC_ENCODER_H
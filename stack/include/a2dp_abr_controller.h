@@ -0,0 +1,106 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// A2DP Source adaptive bit rate controller, for the codecs that do not have
+// their own (SBC and AAC).
+//
+
+#ifndef A2DP_ABR_CONTROLLER_H
+#define A2DP_ABR_CONTROLLER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The link metrics collected over one control interval.
+typedef struct {
+  uint32_t interval_ms;      // Length of the interval
+  size_t queue_length;       // Encoded packets waiting at the end
+  size_t queue_capacity;     // Packets that can wait before being dropped
+  uint32_t dropped_packets;  // Encoded packets dropped during the interval
+  uint32_t congested_ms;     // Time the media channel was congested
+  uint32_t failed_contacts;  // Increase of the Failed Contact Counter
+  bool has_rssi;             // True if |rssi| was read
+  int8_t rssi;               // Relative to the Golden Receive Power Range
+} tA2DP_ABR_METRICS;
+
+typedef struct {
+  uint64_t intervals;           // Intervals fed to the controller
+  uint64_t marginal_intervals;  // Intervals that held the bit rate
+  uint64_t bad_intervals;       // Intervals that lowered the bit rate
+  uint64_t critical_intervals;  // Intervals with dropped packets
+  uint64_t step_downs;          // Times the bit rate was lowered
+  uint64_t step_ups;            // Times the bit rate was raised
+  uint8_t min_bitrate_percent;  // Lowest bit rate used
+} tA2DP_ABR_STATS;
+
+// A2dpAbrController picks the encoder bit rate, as a percentage of the
+// configured one, from the link metrics of each control interval.
+//
+// Each interval is rated from the fill of the transmit queues, the packets
+// dropped, the time the media channel was congested, the failed contacts and
+// the RSSI:
+//  - critical: packets were dropped, or the queues are nearly full. The bit
+//    rate is lowered by two steps.
+//  - bad: the link can't keep up. The bit rate is lowered by one step, but
+//    not in the interval right after another step down, to give the queues
+//    time to drain.
+//  - marginal: the link keeps up, without margin. The bit rate is held.
+//  - clean: otherwise.
+// The bit rate is raised by one step only after a run of clean intervals.
+// When a raised bit rate has to be lowered again before as many intervals
+// have passed, the run needed for the next raise is doubled, so a link that
+// can't carry the higher bit rate is not probed again too often.
+//
+// The controller does not read the metrics, nor set the bit rate: it is
+// only fed the metrics, from the encoder thread.
+class A2dpAbrController {
+ public:
+  enum Rating { kClean, kMarginal, kBad, kCritical };
+
+  // |step_up_intervals| is the number of clean intervals needed to raise the
+  // bit rate by one step.
+  explicit A2dpAbrController(size_t step_up_intervals);
+
+  // Feeds the metrics of one interval.
+  // Returns the bit rate to use, in percent of the configured one.
+  uint8_t Update(const tA2DP_ABR_METRICS& metrics);
+
+  // Returns the current bit rate, in percent of the configured one.
+  uint8_t bitrate_percent() const;
+
+  // Restarts at the full bit rate, and clears the statistics.
+  void Reset();
+
+  const tA2DP_ABR_STATS& stats() const { return stats_; }
+
+  // Rates the metrics of one interval.
+  static Rating Rate(const tA2DP_ABR_METRICS& metrics);
+
+ private:
+  void StepDown(size_t steps);
+
+  size_t step_up_intervals_;
+  size_t level_;                     // Index in the bit rate steps
+  size_t clean_intervals_;           // Clean intervals in a row
+  size_t required_clean_intervals_;  // Clean intervals needed to step up
+  size_t intervals_since_step_up_;   // Intervals since the last step up
+  bool stepped_up_;                  // True until the step up is confirmed
+  bool hold_;                        // True right after a step down
+  tA2DP_ABR_STATS stats_;
+};
+
+#endif  // A2DP_ABR_CONTROLLER_H
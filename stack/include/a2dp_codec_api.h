@@ -538,6 +538,11 @@ typedef struct {
 
   // Set transmit queue length for the A2DP encoder.
   void (*set_transmit_queue_length)(size_t transmit_queue_length);
+
+  // Set the bit rate of the A2DP encoder, in percent of the bit rate picked
+  // for the codec configuration.
+  // Only for the encoders without their own adaptive bit rate.
+  void (*set_bitrate_percent)(uint8_t bitrate_percent);
 } tA2DP_ENCODER_INTERFACE;
 
 // Prototype for a callback to receive decoded audio data from a
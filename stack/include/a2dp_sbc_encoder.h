@@ -59,6 +59,11 @@ uint64_t a2dp_sbc_get_encoder_interval_ms(void);
 // |timestamp_us| is the current timestamp (in microseconds).
 void a2dp_sbc_send_frames(uint64_t timestamp_us);
 
+// Set the A2DP SBC encoder bit rate, in percent of the configured one.
+// The bit pool is lowered accordingly, down to the lowest one the peer
+// accepts.
+void a2dp_sbc_set_bitrate_percent(uint8_t bitrate_percent);
+
 // Get SBC bitrate
 // Returns |uint32_t| bitrate in bits per second
 uint32_t a2dp_sbc_get_bitrate();
@@ -506,6 +506,31 @@ class AvdtpStreamConfig {
 
 typedef uint8_t tAVDT_DATA_OPT_MASK;
 
+/* Reasons a media packet is dropped from the transmit queue of a stream */
+#define AVDT_MEDIA_DROP_OVERFLOW 0 /* Queue full, the oldest packet dropped */
+#define AVDT_MEDIA_DROP_EXPIRED 1  /* Queued for longer than the delay budget */
+#define AVDT_MEDIA_DROP_FLUSHED 2  /* Stream stopped or closed */
+#define AVDT_MEDIA_DROP_NUM 3
+
+/* Buckets of the media queueing latency histogram: under 1, 2, 5, 10, 20,
+ * 50, 100 and 200 ms, then 200 ms or more. */
+#define AVDT_MEDIA_LATENCY_BUCKETS 9
+
+/* Media transmit queue statistics of a stream */
+typedef struct {
+  uint16_t depth;       /* Packets queued now */
+  uint16_t max_depth;   /* Most packets queued at once */
+  uint32_t depth_bytes; /* Bytes queued now */
+  uint64_t enqueued;    /* Packets queued */
+  uint64_t sent;        /* Packets handed to L2CAP */
+  uint64_t dropped[AVDT_MEDIA_DROP_NUM]; /* Packets dropped, by reason */
+  uint64_t congestion_count; /* Times the media channel became congested */
+  uint64_t congested_us;     /* Time spent congested */
+  uint64_t total_latency_us; /* Queueing time of the packets sent */
+  uint64_t max_latency_us;
+  uint64_t latency_hist[AVDT_MEDIA_LATENCY_BUCKETS];
+} tAVDT_MEDIA_QUEUE_STATS;
+
 /*****************************************************************************
  *  External Function Declarations
  ****************************************************************************/
@@ -929,6 +954,19 @@ extern uint16_t AVDT_DisconnectReq(const RawAddress& bd_addr,
  ******************************************************************************/
 extern uint16_t AVDT_GetL2CapChannel(uint8_t handle);
 
+/*******************************************************************************
+ *
+ * Function         AVDT_GetMediaQueueStats
+ *
+ * Description      Get the media transmit queue statistics of the stream
+ *                  with the given handle.
+ *
+ * Returns          AVDT_SUCCESS if successful, otherwise error.
+ *
+ ******************************************************************************/
+extern uint16_t AVDT_GetMediaQueueStats(uint8_t handle,
+                                        tAVDT_MEDIA_QUEUE_STATS* p_stats);
+
 /*******************************************************************************
  *
  * Function         AVDT_GetSignalChannel
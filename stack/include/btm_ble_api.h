@@ -779,4 +779,12 @@ extern void BTM_BleSetPhy(const RawAddress& bd_addr, uint8_t tx_phys,
 
 extern void btm_ble_multi_adv_cleanup(void);
 
+/**
+ * Dump debug-related information for the Stack BTM LE module.
+ *
+ * @param fd the file descriptor to use for writing the ASCII formatted
+ * information
+ */
+extern void stack_debug_btm_ble_dump(int fd);
+
 #endif
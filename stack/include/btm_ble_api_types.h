@@ -345,6 +345,8 @@ typedef struct {
   uint16_t total_trackable_advertisers;
   uint8_t extended_scan_support;
   uint8_t debug_logging_supported;
+  /* filtering and batch scan are run on the host */
+  bool host_scan_offload;
 } tBTM_BLE_VSC_CB;
 
 typedef void(tBTM_BLE_ADV_DATA_CMPL_CBACK)(tBTM_STATUS status);
@@ -790,6 +790,20 @@ extern bool L2CA_SendTestSFrame(uint16_t cid, uint8_t sup_type,
  ******************************************************************************/
 extern bool L2CA_SetTxPriority(uint16_t cid, tL2CAP_CHNL_PRIORITY priority);
 
+/*******************************************************************************
+ *
+ * Function         L2CA_SetTxWeight
+ *
+ * Description      Sets the share of the link of a channel against the other
+ *                  channels of its priority: the channel sends up to |weight|
+ *                  times L2CAP_SCHED_QUANTUM bytes per round robin turn.
+ *                  0 restores the default weight of the priority.
+ *
+ * Returns          true if a valid channel, else false
+ *
+ ******************************************************************************/
+extern bool L2CA_SetTxWeight(uint16_t cid, uint8_t weight);
+
 /*******************************************************************************
  *
  * Function         L2CA_RegForNoCPEvt
@@ -1284,4 +1298,13 @@ extern uint16_t L2CA_GetDisconnectReason(const RawAddress& remote_bda,
 extern void L2CA_AdjustConnectionIntervals(uint16_t* min_interval,
                                            uint16_t* max_interval,
                                            uint16_t floor_interval);
+
+/**
+ * Dump debug-related information for the Stack L2CAP module.
+ *
+ * @param fd the file descriptor to use for writing the ASCII formatted
+ * information
+ */
+extern void stack_debug_l2cap_dump(int fd);
+
 #endif /* L2C_API_H */
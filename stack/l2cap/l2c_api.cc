@@ -1403,6 +1403,32 @@ bool L2CA_SetTxPriority(uint16_t cid, tL2CAP_CHNL_PRIORITY priority) {
   return (true);
 }
 
+/*******************************************************************************
+ *
+ * Function         L2CA_SetTxWeight
+ *
+ * Description      Sets the share of the link of a channel against the other
+ *                  channels of its priority.
+ *
+ * Returns          true if a valid channel, else false
+ *
+ ******************************************************************************/
+bool L2CA_SetTxWeight(uint16_t cid, uint8_t weight) {
+  tL2C_CCB* p_ccb;
+
+  L2CAP_TRACE_API("L2CA_SetTxWeight()  CID: 0x%04x, weight:%d", cid, weight);
+
+  p_ccb = l2cu_find_ccb_by_cid(NULL, cid);
+  if (p_ccb == NULL) {
+    L2CAP_TRACE_WARNING("L2CAP - no CCB for L2CA_SetTxWeight, CID: %d", cid);
+    return (false);
+  }
+
+  l2cu_change_tx_weight_ccb(p_ccb, weight);
+
+  return (true);
+}
+
 /*******************************************************************************
  *
  * Function         L2CA_SetChnlDataRate
@@ -37,6 +37,7 @@
 #include "common/time_util.h"
 #include "hcimsgs.h"
 #include "l2c_api.h"
+#include "l2c_fcs.h"
 #include "l2c_int.h"
 #include "l2cdefs.h"
 
@@ -51,39 +52,6 @@ static const char* SAR_types[] = {"Unsegmented", "Start", "End",
                                   "Continuation"};
 static const char* SUP_types[] = {"RR", "REJ", "RNR", "SREJ"};
 
-/* Look-up table for the CRC calculation */
-static const unsigned short crctab[256] = {
-    0x0000, 0xc0c1, 0xc181, 0x0140, 0xc301, 0x03c0, 0x0280, 0xc241, 0xc601,
-    0x06c0, 0x0780, 0xc741, 0x0500, 0xc5c1, 0xc481, 0x0440, 0xcc01, 0x0cc0,
-    0x0d80, 0xcd41, 0x0f00, 0xcfc1, 0xce81, 0x0e40, 0x0a00, 0xcac1, 0xcb81,
-    0x0b40, 0xc901, 0x09c0, 0x0880, 0xc841, 0xd801, 0x18c0, 0x1980, 0xd941,
-    0x1b00, 0xdbc1, 0xda81, 0x1a40, 0x1e00, 0xdec1, 0xdf81, 0x1f40, 0xdd01,
-    0x1dc0, 0x1c80, 0xdc41, 0x1400, 0xd4c1, 0xd581, 0x1540, 0xd701, 0x17c0,
-    0x1680, 0xd641, 0xd201, 0x12c0, 0x1380, 0xd341, 0x1100, 0xd1c1, 0xd081,
-    0x1040, 0xf001, 0x30c0, 0x3180, 0xf141, 0x3300, 0xf3c1, 0xf281, 0x3240,
-    0x3600, 0xf6c1, 0xf781, 0x3740, 0xf501, 0x35c0, 0x3480, 0xf441, 0x3c00,
-    0xfcc1, 0xfd81, 0x3d40, 0xff01, 0x3fc0, 0x3e80, 0xfe41, 0xfa01, 0x3ac0,
-    0x3b80, 0xfb41, 0x3900, 0xf9c1, 0xf881, 0x3840, 0x2800, 0xe8c1, 0xe981,
-    0x2940, 0xeb01, 0x2bc0, 0x2a80, 0xea41, 0xee01, 0x2ec0, 0x2f80, 0xef41,
-    0x2d00, 0xedc1, 0xec81, 0x2c40, 0xe401, 0x24c0, 0x2580, 0xe541, 0x2700,
-    0xe7c1, 0xe681, 0x2640, 0x2200, 0xe2c1, 0xe381, 0x2340, 0xe101, 0x21c0,
-    0x2080, 0xe041, 0xa001, 0x60c0, 0x6180, 0xa141, 0x6300, 0xa3c1, 0xa281,
-    0x6240, 0x6600, 0xa6c1, 0xa781, 0x6740, 0xa501, 0x65c0, 0x6480, 0xa441,
-    0x6c00, 0xacc1, 0xad81, 0x6d40, 0xaf01, 0x6fc0, 0x6e80, 0xae41, 0xaa01,
-    0x6ac0, 0x6b80, 0xab41, 0x6900, 0xa9c1, 0xa881, 0x6840, 0x7800, 0xb8c1,
-    0xb981, 0x7940, 0xbb01, 0x7bc0, 0x7a80, 0xba41, 0xbe01, 0x7ec0, 0x7f80,
-    0xbf41, 0x7d00, 0xbdc1, 0xbc81, 0x7c40, 0xb401, 0x74c0, 0x7580, 0xb541,
-    0x7700, 0xb7c1, 0xb681, 0x7640, 0x7200, 0xb2c1, 0xb381, 0x7340, 0xb101,
-    0x71c0, 0x7080, 0xb041, 0x5000, 0x90c1, 0x9181, 0x5140, 0x9301, 0x53c0,
-    0x5280, 0x9241, 0x9601, 0x56c0, 0x5780, 0x9741, 0x5500, 0x95c1, 0x9481,
-    0x5440, 0x9c01, 0x5cc0, 0x5d80, 0x9d41, 0x5f00, 0x9fc1, 0x9e81, 0x5e40,
-    0x5a00, 0x9ac1, 0x9b81, 0x5b40, 0x9901, 0x59c0, 0x5880, 0x9841, 0x8801,
-    0x48c0, 0x4980, 0x8941, 0x4b00, 0x8bc1, 0x8a81, 0x4a40, 0x4e00, 0x8ec1,
-    0x8f81, 0x4f40, 0x8d01, 0x4dc0, 0x4c80, 0x8c41, 0x4400, 0x84c1, 0x8581,
-    0x4540, 0x8701, 0x47c0, 0x4680, 0x8641, 0x8201, 0x42c0, 0x4380, 0x8341,
-    0x4100, 0x81c1, 0x8081, 0x4040,
-};
-
 /*******************************************************************************
  *  Static local functions
 */
@@ -93,7 +61,8 @@ static void process_i_frame(tL2C_CCB* p_ccb, BT_HDR* p_buf, uint16_t ctrl_word,
                             bool delay_ack);
 static bool retransmit_i_frames(tL2C_CCB* p_ccb, uint8_t tx_seq);
 static void prepare_I_frame(tL2C_CCB* p_ccb, BT_HDR* p_buf,
-                            bool is_retransmission);
+                            bool is_retransmission, uint16_t tail_len,
+                            uint16_t tail_fcs);
 static void process_stream_frame(tL2C_CCB* p_ccb, BT_HDR* p_buf);
 static bool do_sar_reassembly(tL2C_CCB* p_ccb, BT_HDR* p_buf,
                               uint16_t ctrl_word);
@@ -102,41 +71,25 @@ static bool do_sar_reassembly(tL2C_CCB* p_ccb, BT_HDR* p_buf,
 static void l2c_fcr_collect_ack_delay(tL2C_CCB* p_ccb, uint8_t num_bufs_acked);
 #endif
 
-/*******************************************************************************
- *
- * Function         l2c_fcr_updcrc
- *
- * Description      This function computes the CRC using the look-up table.
- *
- * Returns          CRC
- *
- ******************************************************************************/
-static unsigned short l2c_fcr_updcrc(unsigned short icrc, unsigned char* icp,
-                                     int icnt) {
-  unsigned short crc = icrc;
-  unsigned char* cp = icp;
-  int cnt = icnt;
-
-  while (cnt--) {
-    crc = ((crc >> 8) & 0xff) ^ crctab[(crc & 0xff) ^ *cp++];
-  }
-
-  return (crc);
-}
-
 /*******************************************************************************
  *
  * Function         l2c_fcr_tx_get_fcs
  *
  * Description      This function computes the CRC for a frame to be TXed.
+ *                  If |tail_len| is not 0, |tail_fcs| is the CRC of the last
+ *                  |tail_len| bytes of the frame, computed from 0 as they were
+ *                  copied, and they are not read again.
  *
  * Returns          CRC
  *
  ******************************************************************************/
-static uint16_t l2c_fcr_tx_get_fcs(BT_HDR* p_buf) {
+static uint16_t l2c_fcr_tx_get_fcs(BT_HDR* p_buf, uint16_t tail_len,
+                                   uint16_t tail_fcs) {
   uint8_t* p = ((uint8_t*)(p_buf + 1)) + p_buf->offset;
+  uint16_t fcs = l2c_fcs_update(L2CAP_FCR_INIT_CRC, p, p_buf->len - tail_len);
 
-  return (l2c_fcr_updcrc(L2CAP_FCR_INIT_CRC, p, p_buf->len));
+  if (tail_len == 0) return (fcs);
+  return (l2c_fcs_combine(fcs, tail_fcs, tail_len));
 }
 
 /*******************************************************************************
@@ -155,7 +108,7 @@ static uint16_t l2c_fcr_rx_get_fcs(BT_HDR* p_buf) {
   p -= L2CAP_PKT_OVERHEAD;
 
   return (
-      l2c_fcr_updcrc(L2CAP_FCR_INIT_CRC, p, p_buf->len + L2CAP_PKT_OVERHEAD));
+      l2c_fcs_update(L2CAP_FCR_INIT_CRC, p, p_buf->len + L2CAP_PKT_OVERHEAD));
 }
 
 /*******************************************************************************
@@ -332,22 +285,20 @@ void l2c_fcr_cleanup(tL2C_CCB* p_ccb) {
 
 /*******************************************************************************
  *
- * Function         l2c_fcr_clone_buf
+ * Function         l2c_fcr_alloc_buf
  *
- * Description      This function allocates and copies requested part of a
- *                  buffer at a new-offset.
+ * Description      This function allocates a buffer for a frame of
+ *                  |no_of_bytes| at |offset|.
  *
  * Returns          pointer to new buffer
  *
  ******************************************************************************/
-BT_HDR* l2c_fcr_clone_buf(BT_HDR* p_buf, uint16_t new_offset,
-                          uint16_t no_of_bytes) {
-  CHECK(p_buf != NULL);
+static BT_HDR* l2c_fcr_alloc_buf(uint16_t offset, uint16_t no_of_bytes) {
   /*
    * NOTE: We allocate extra L2CAP_FCS_LEN octets, in case we need to put
    * the FCS (Frame Check Sequence) at the end of the buffer.
    */
-  uint16_t buf_size = no_of_bytes + sizeof(BT_HDR) + new_offset + L2CAP_FCS_LEN;
+  uint16_t buf_size = no_of_bytes + sizeof(BT_HDR) + offset + L2CAP_FCS_LEN;
 #if (L2CAP_ERTM_STATS == TRUE)
   /*
    * NOTE: If L2CAP_ERTM_STATS is enabled, we need 4 extra octets at the
@@ -355,10 +306,29 @@ BT_HDR* l2c_fcr_clone_buf(BT_HDR* p_buf, uint16_t new_offset,
    */
   buf_size += sizeof(uint32_t);
 #endif
-  BT_HDR* p_buf2 = (BT_HDR*)osi_malloc(buf_size);
+  BT_HDR* p_buf = (BT_HDR*)osi_malloc(buf_size);
+
+  p_buf->offset = offset;
+  p_buf->len = no_of_bytes;
+
+  return (p_buf);
+}
+
+/*******************************************************************************
+ *
+ * Function         l2c_fcr_clone_buf
+ *
+ * Description      This function allocates and copies requested part of a
+ *                  buffer at a new-offset.
+ *
+ * Returns          pointer to new buffer
+ *
+ ******************************************************************************/
+BT_HDR* l2c_fcr_clone_buf(BT_HDR* p_buf, uint16_t new_offset,
+                          uint16_t no_of_bytes) {
+  CHECK(p_buf != NULL);
+  BT_HDR* p_buf2 = l2c_fcr_alloc_buf(new_offset, no_of_bytes);
 
-  p_buf2->offset = new_offset;
-  p_buf2->len = no_of_bytes;
   memcpy(((uint8_t*)(p_buf2 + 1)) + p_buf2->offset,
          ((uint8_t*)(p_buf + 1)) + p_buf->offset, no_of_bytes);
 
@@ -402,13 +372,16 @@ bool l2c_fcr_is_flow_controlled(tL2C_CCB* p_ccb) {
  *
  * Description      This function sets the FCR variables in an I-frame that is
  *                  about to be sent to HCI for transmission. This may be the
- *                  first time the I-frame is sent, or a retransmission
+ *                  first time the I-frame is sent, or a retransmission.
+ *                  |tail_len| and |tail_fcs| are passed to
+ *                  l2c_fcr_tx_get_fcs().
  *
  * Returns          -
  *
  ******************************************************************************/
 static void prepare_I_frame(tL2C_CCB* p_ccb, BT_HDR* p_buf,
-                            bool is_retransmission) {
+                            bool is_retransmission, uint16_t tail_len,
+                            uint16_t tail_fcs) {
   CHECK(p_ccb != NULL);
   CHECK(p_buf != NULL);
   tL2C_FCRB* p_fcrb = &p_ccb->fcrb;
@@ -457,7 +430,7 @@ static void prepare_I_frame(tL2C_CCB* p_ccb, BT_HDR* p_buf,
     UINT16_TO_STREAM(p, p_buf->len + L2CAP_FCS_LEN - L2CAP_PKT_OVERHEAD);
 
     /* Calculate the FCS */
-    fcs = l2c_fcr_tx_get_fcs(p_buf);
+    fcs = l2c_fcr_tx_get_fcs(p_buf, tail_len, tail_fcs);
 
     /* Point to the end of the buffer and put the FCS there */
     /*
@@ -544,7 +517,7 @@ void l2c_fcr_send_S_frame(tL2C_CCB* p_ccb, uint16_t function_code,
 
   /* Compute the FCS and add to the end of the buffer if not bypassed */
   if (p_ccb->bypass_fcs != L2CAP_BYPASS_FCS) {
-    fcs = l2c_fcr_tx_get_fcs(p_buf);
+    fcs = l2c_fcr_tx_get_fcs(p_buf, 0, 0);
 
     UINT16_TO_STREAM(p, fcs);
     p_buf->len += L2CAP_FCS_LEN;
@@ -1648,6 +1621,7 @@ static bool retransmit_i_frames(tL2C_CCB* p_ccb, uint8_t tx_seq) {
     }
   }
 
+  l2cu_sched_wake(p_ccb);
   l2c_link_check_send_pkts(p_ccb->p_lcb, NULL, NULL);
 
   if (fixed_queue_length(p_ccb->fcrb.waiting_for_ack_q)) {
@@ -1678,6 +1652,8 @@ BT_HDR* l2c_fcr_get_next_xmit_sdu_seg(tL2C_CCB* p_ccb,
   BT_HDR *p_buf, *p_xmit;
   uint8_t* p;
   uint16_t max_pdu = p_ccb->tx_mps /* Needed? - L2CAP_MAX_HEADER_FCS*/;
+  /* FCS of the payload of a segment, computed while copying it */
+  uint16_t payload_len = 0, payload_fcs = 0;
 
   /* If there is anything in the retransmit queue, that goes first
   */
@@ -1685,7 +1661,7 @@ BT_HDR* l2c_fcr_get_next_xmit_sdu_seg(tL2C_CCB* p_ccb,
   if (p_buf != NULL) {
     /* Update Rx Seq and FCS if we acked some packets while this one was queued
      */
-    prepare_I_frame(p_ccb, p_buf, true);
+    prepare_I_frame(p_ccb, p_buf, true, 0, 0);
 
     p_buf->event = p_ccb->local_cid;
 
@@ -1717,10 +1693,19 @@ BT_HDR* l2c_fcr_get_next_xmit_sdu_seg(tL2C_CCB* p_ccb,
       mid_seg = true;
 
     /* Get a new buffer and copy the data that can be sent in a PDU */
-    p_xmit = l2c_fcr_clone_buf(p_buf, L2CAP_MIN_OFFSET + L2CAP_SDU_LEN_OFFSET,
-                               max_pdu);
+    p_xmit =
+        l2c_fcr_alloc_buf(L2CAP_MIN_OFFSET + L2CAP_SDU_LEN_OFFSET, max_pdu);
 
     if (p_xmit != NULL) {
+      uint8_t* p_src = ((uint8_t*)(p_buf + 1)) + p_buf->offset;
+      uint8_t* p_dst = ((uint8_t*)(p_xmit + 1)) + p_xmit->offset;
+      if (p_ccb->bypass_fcs != L2CAP_BYPASS_FCS) {
+        payload_fcs = l2c_fcs_update_copy(0, p_dst, p_src, max_pdu);
+        payload_len = max_pdu;
+      } else {
+        memcpy(p_dst, p_src, max_pdu);
+      }
+
       p_buf->event = p_ccb->local_cid;
       p_xmit->event = p_ccb->local_cid;
 
@@ -1781,7 +1766,7 @@ BT_HDR* l2c_fcr_get_next_xmit_sdu_seg(tL2C_CCB* p_ccb,
   else
     p_xmit->layer_specific |= L2CAP_FCR_UNSEG_SDU;
 
-  prepare_I_frame(p_ccb, p_xmit, false);
+  prepare_I_frame(p_ccb, p_xmit, false, payload_len, payload_fcs);
 
   if (p_ccb->peer_cfg.fcr.mode == L2CAP_FCR_ERTM_MODE) {
     BT_HDR* p_wack =
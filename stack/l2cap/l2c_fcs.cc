@@ -0,0 +1,111 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "l2c_fcs.h"
+
+#include <string.h>
+
+namespace {
+
+/* x^16 + x^15 + x^2 + 1, bit reversed */
+constexpr uint16_t kPoly = 0xa001;
+
+/* Number of x^(2^k) powers kept, enough for any size_t length in bits */
+constexpr size_t kNumPowers = sizeof(size_t) * 8 + 3;
+
+/* a * b modulo the polynomial, both bit reversed */
+constexpr uint16_t MultModPoly(uint16_t a, uint16_t b) {
+  uint16_t product = 0;
+  for (uint16_t m = 0x8000; m != 0; m >>= 1) {
+    if (a & m) product ^= b;
+    b = (b & 1) ? (b >> 1) ^ kPoly : b >> 1;
+  }
+  return product;
+}
+
+struct Tables {
+  /* slice[0] is the classic byte table, slice[k] adds k zero bytes after */
+  uint16_t slice[8][256];
+  /* x^(2^k) modulo the polynomial, bit reversed */
+  uint16_t powers[kNumPowers];
+};
+
+constexpr Tables MakeTables() {
+  Tables tables = {};
+  for (int i = 0; i < 256; i++) {
+    uint16_t crc = i;
+    for (int bit = 0; bit < 8; bit++)
+      crc = (crc & 1) ? (crc >> 1) ^ kPoly : crc >> 1;
+    tables.slice[0][i] = crc;
+  }
+  for (int k = 1; k < 8; k++) {
+    for (int i = 0; i < 256; i++) {
+      uint16_t crc = tables.slice[k - 1][i];
+      tables.slice[k][i] = (crc >> 8) ^ tables.slice[0][crc & 0xff];
+    }
+  }
+
+  /* x^1 */
+  tables.powers[0] = 0x4000;
+  for (size_t k = 1; k < kNumPowers; k++)
+    tables.powers[k] = MultModPoly(tables.powers[k - 1], tables.powers[k - 1]);
+  return tables;
+}
+
+constexpr Tables kTables = MakeTables();
+
+inline uint16_t UpdateByte(uint16_t fcs, uint8_t byte) {
+  return (fcs >> 8) ^ kTables.slice[0][(fcs ^ byte) & 0xff];
+}
+
+inline uint16_t Update8(uint16_t fcs, const uint8_t* p) {
+  const auto& t = kTables.slice;
+  return t[7][(fcs ^ p[0]) & 0xff] ^ t[6][((fcs >> 8) ^ p[1]) & 0xff] ^
+         t[5][p[2]] ^ t[4][p[3]] ^ t[3][p[4]] ^ t[2][p[5]] ^ t[1][p[6]] ^
+         t[0][p[7]];
+}
+
+}  // namespace
+
+uint16_t l2c_fcs_update(uint16_t fcs, const uint8_t* p, size_t len) {
+  for (; len >= 8; len -= 8, p += 8) fcs = Update8(fcs, p);
+  while (len--) fcs = UpdateByte(fcs, *p++);
+  return fcs;
+}
+
+uint16_t l2c_fcs_update_copy(uint16_t fcs, uint8_t* dst, const uint8_t* src,
+                             size_t len) {
+  for (; len >= 8; len -= 8, src += 8, dst += 8) {
+    memcpy(dst, src, 8);
+    fcs = Update8(fcs, src);
+  }
+  while (len--) {
+    *dst++ = *src;
+    fcs = UpdateByte(fcs, *src++);
+  }
+  return fcs;
+}
+
+uint16_t l2c_fcs_combine(uint16_t fcs_a, uint16_t fcs_b, size_t len_b) {
+  /* Running A through |len_b| zero bytes multiplies it by x^(8 * len_b) */
+  uint16_t shift = 0x8000;
+  for (size_t k = 3; len_b != 0; len_b >>= 1, k++) {
+    if (len_b & 1) shift = MultModPoly(kTables.powers[k], shift);
+  }
+  return MultModPoly(shift, fcs_a) ^ fcs_b;
+}
@@ -0,0 +1,70 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  The L2CAP Frame Check Sequence: CRC-16 with polynomial
+ *  x^16 + x^15 + x^2 + 1, least significant bit first, no final inversion.
+ *
+ *  The CRC is computed 8 bytes at a time, through 8 look-up tables
+ *  (slice-by-8).
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/*******************************************************************************
+ *
+ * Function         l2c_fcs_update
+ *
+ * Description      Adds |len| bytes at |p| to the FCS |fcs|.
+ *
+ * Returns          FCS
+ *
+ ******************************************************************************/
+extern uint16_t l2c_fcs_update(uint16_t fcs, const uint8_t* p, size_t len);
+
+/*******************************************************************************
+ *
+ * Function         l2c_fcs_update_copy
+ *
+ * Description      Copies |len| bytes from |src| to |dst|, and adds them to
+ *                  the FCS |fcs| on the way.
+ *
+ * Returns          FCS
+ *
+ ******************************************************************************/
+extern uint16_t l2c_fcs_update_copy(uint16_t fcs, uint8_t* dst,
+                                    const uint8_t* src, size_t len);
+
+/*******************************************************************************
+ *
+ * Function         l2c_fcs_combine
+ *
+ * Description      Given |fcs_a|, the FCS of data A, and |fcs_b|, the FCS of
+ *                  |len_b| bytes of data B from an initial value of 0,
+ *                  computes the FCS of A followed by B. It takes a few dozen
+ *                  operations whatever |len_b|.
+ *
+ * Returns          FCS
+ *
+ ******************************************************************************/
+extern uint16_t l2c_fcs_combine(uint16_t fcs_a, uint16_t fcs_b, size_t len_b);
@@ -314,6 +314,7 @@ typedef struct t_l2c_ccb {
   uint16_t buff_quota;        /* Buffer quota before sending congestion */
 
   tL2CAP_CHNL_PRIORITY ccb_priority;  /* Channel priority */
+  uint8_t tx_weight;                  /* Round robin weight, 0 for default */
   tL2CAP_CHNL_DATA_RATE tx_data_rate; /* Channel Tx data rate */
   tL2CAP_CHNL_DATA_RATE rx_data_rate; /* Channel Rx data rate */
 
@@ -354,30 +355,15 @@ typedef struct {
   tL2C_CCB* p_last_ccb;  /* The last  channel in this queue */
 } tL2C_CCB_Q;
 
-#if (L2CAP_ROUND_ROBIN_CHANNEL_SERVICE == TRUE)
-
-/* Round-Robin service for the same priority channels */
-#define L2CAP_NUM_CHNL_PRIORITY \
-  3 /* Total number of priority group (high, medium, low)*/
-#define L2CAP_CHNL_PRIORITY_WEIGHT \
-  5 /* weight per priority for burst transmission quota */
-#define L2CAP_GET_PRIORITY_QUOTA(pri) \
-  ((L2CAP_NUM_CHNL_PRIORITY - (pri)) * L2CAP_CHNL_PRIORITY_WEIGHT)
-
-/* CCBs within the same LCB are served in round robin with priority It will make
- * sure that low priority channel (for example, HF signaling on RFCOMM) can be
- * sent to the headset even if higher priority channel (for example, AV media
- * channel) is congested.
+/* Total number of channel priorities (high, medium, low). With
+ * L2CAP_ROUND_ROBIN_CHANNEL_SERVICE, the channels of a link are served by
+ * l2c_scheduler: high priority channels (AV media) first, and the others in
+ * deficit round robin, by a weight of L2CAP_NUM_CHNL_PRIORITY - priority
+ * unless set with L2CA_SetTxWeight. It makes sure that a low priority channel
+ * (for example, HF signaling on RFCOMM) can be sent to the headset even if a
+ * bulk channel is congested.
  */
-
-typedef struct {
-  tL2C_CCB* p_serve_ccb; /* current serving ccb within priority group */
-  tL2C_CCB* p_first_ccb; /* first ccb of priority group */
-  uint8_t num_ccb;       /* number of channels in priority group */
-  uint8_t quota;         /* burst transmission quota */
-} tL2C_RR_SERV;
-
-#endif /* (L2CAP_ROUND_ROBIN_CHANNEL_SERVICE == TRUE) */
+#define L2CAP_NUM_CHNL_PRIORITY 3
 
 /* Define a link control block. There is one link control block between
  * this device and any other device (i.e. BD ADDR).
@@ -450,13 +436,6 @@ typedef struct t_l2c_linkcb {
   uint16_t min_ce_len;
   uint16_t max_ce_len;
 
-#if (L2CAP_ROUND_ROBIN_CHANNEL_SERVICE == TRUE)
-  /* each priority group is limited burst transmission */
-  /* round robin service for the same priority channels */
-  tL2C_RR_SERV rr_serv[L2CAP_NUM_CHNL_PRIORITY];
-  uint8_t rr_pri; /* current serving priority group */
-#endif
-
 } tL2C_LCB;
 
 /* Define the L2CAP control structure
@@ -604,6 +583,13 @@ extern bool l2cu_set_acl_priority(const RawAddress& bd_addr, uint8_t priority,
 extern void l2cu_enqueue_ccb(tL2C_CCB* p_ccb);
 extern void l2cu_dequeue_ccb(tL2C_CCB* p_ccb);
 extern void l2cu_change_pri_ccb(tL2C_CCB* p_ccb, tL2CAP_CHNL_PRIORITY priority);
+extern void l2cu_change_tx_weight_ccb(tL2C_CCB* p_ccb, uint8_t weight);
+
+extern void l2cu_sched_init(void);
+extern void l2cu_sched_wake(tL2C_CCB* p_ccb);
+extern void l2cu_sched_credits_used(tL2C_LCB* p_lcb, uint16_t count);
+extern void l2cu_sched_credits_returned(tL2C_LCB* p_lcb, uint16_t count);
+extern void l2cu_sched_stalled(tL2C_LCB* p_lcb);
 
 extern tL2C_CCB* l2cu_allocate_ccb(tL2C_LCB* p_lcb, uint16_t cid);
 extern void l2cu_release_ccb(tL2C_CCB* p_ccb);
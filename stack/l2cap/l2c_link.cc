@@ -1080,6 +1080,14 @@ void l2c_link_check_send_pkts(tL2C_LCB* p_lcb, tL2C_CCB* p_ccb, BT_HDR* p_buf) {
 
         if (!l2c_link_send_to_lower(p_lcb, p_buf, &cbi)) break;
       }
+
+      /* Out of controller buffers with data left to send */
+      uint16_t xmit_window = (p_lcb->transport == BT_TRANSPORT_LE)
+                                 ? l2cb.controller_le_xmit_window
+                                 : l2cb.controller_xmit_window;
+      if ((xmit_window == 0) ||
+          (p_lcb->sent_not_acked >= p_lcb->link_xmit_quota))
+        l2cu_sched_stalled(p_lcb);
     }
 
     /* There is a special case where we have readjusted the link quotas and  */
@@ -1120,6 +1128,7 @@ static bool l2c_link_send_to_lower(tL2C_LCB* p_lcb, BT_HDR* p_buf,
         l2cb.round_robin_unacked++;
     }
     p_lcb->sent_not_acked++;
+    l2cu_sched_credits_used(p_lcb, 1);
     p_buf->layer_specific = 0;
 
     if (p_lcb->transport == BT_TRANSPORT_LE) {
@@ -1170,6 +1179,7 @@ static bool l2c_link_send_to_lower(tL2C_LCB* p_lcb, BT_HDR* p_buf,
     }
 
     p_lcb->sent_not_acked += num_segs;
+    l2cu_sched_credits_used(p_lcb, num_segs);
     if (p_lcb->transport == BT_TRANSPORT_LE) {
       bte_main_hci_send(
           p_buf, (uint16_t)(BT_EVT_TO_LM_HCI_ACL | LOCAL_BLE_CONTROLLER_ID));
@@ -1255,6 +1265,8 @@ void l2c_link_process_num_completed_pkts(uint8_t* p) {
         }
       }
 
+      l2cu_sched_credits_returned(p_lcb, num_sent);
+
       /* Don't go negative */
       if (p_lcb->sent_not_acked > num_sent)
         p_lcb->sent_not_acked -= num_sent;
@@ -863,6 +863,7 @@ void l2c_init(void) {
   int16_t xx;
 
   memset(&l2cb, 0, sizeof(tL2C_CB));
+  l2cu_sched_init();
   /* the psm is increased by 2 before being used */
   l2cb.dyn_psm = 0xFFF;
 
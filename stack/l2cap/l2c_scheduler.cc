@@ -0,0 +1,233 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "l2c_scheduler.h"
+
+#include <string.h>
+#include <algorithm>
+
+L2cScheduler::L2cScheduler(size_t num_links, size_t num_channels,
+                           uint32_t quantum, uint32_t strict_burst)
+    : quantum_(quantum),
+      strict_burst_(strict_burst),
+      channels_(num_channels),
+      links_(num_links) {
+  for (Channel& channel : channels_) {
+    memset(&channel, 0, sizeof(channel));
+    channel.link = kNone;
+  }
+  for (Link& link : links_) {
+    memset(&link, 0, sizeof(link));
+    for (size_t c = 0; c < kNumClasses; c++) link.head[c] = kNone;
+  }
+}
+
+void L2cScheduler::Attach(size_t link, size_t channel, Class service_class,
+                          uint8_t weight) {
+  Detach(channel);
+
+  Channel& p = channels_[channel];
+  p.link = link;
+  p.service_class = service_class;
+  p.weight = std::max<uint8_t>(weight, 1);
+}
+
+void L2cScheduler::Detach(size_t channel) {
+  Channel& p = channels_[channel];
+  if (p.link == kNone) return;
+
+  if (p.ready) Remove(channel);
+  p.link = kNone;
+  p.deficit = 0;
+  p.in_turn = false;
+}
+
+void L2cScheduler::Configure(size_t channel, Class service_class,
+                             uint8_t weight) {
+  Channel& p = channels_[channel];
+  bool ready = p.ready;
+  if (ready) Remove(channel);
+
+  p.service_class = service_class;
+  p.weight = std::max<uint8_t>(weight, 1);
+
+  if (ready) Insert(channel);
+}
+
+void L2cScheduler::Wake(size_t channel) {
+  Channel& p = channels_[channel];
+  if (p.link == kNone || p.ready) return;
+  Insert(channel);
+}
+
+int L2cScheduler::Next(size_t link, StateFn state) {
+  Link& l = links_[link];
+
+  /* Let a weighted channel through a long strict burst */
+  if (strict_burst_ != 0 && l.strict_run >= strict_burst_ &&
+      l.count[kWeighted] != 0) {
+    int channel = NextInClass(link, kWeighted, state);
+    if (channel != kNone) {
+      l.strict_run = 0;
+      l.stats.burst_breaks++;
+      return channel;
+    }
+  }
+
+  int channel = NextInClass(link, kStrict, state);
+  if (channel != kNone) {
+    l.strict_run++;
+    return channel;
+  }
+
+  l.strict_run = 0;
+  return NextInClass(link, kWeighted, state);
+}
+
+int L2cScheduler::NextInClass(size_t link, Class service_class,
+                              StateFn state) {
+  Link& l = links_[link];
+
+  /* Stop once every channel of the class was found blocked in a row */
+  size_t blocked = 0;
+  while (l.head[service_class] != kNone && blocked < l.count[service_class]) {
+    size_t channel = l.head[service_class];
+    Channel& p = channels_[channel];
+
+    switch (state(channel)) {
+      case kEmpty:
+        Remove(channel);
+        p.deficit = 0;
+        p.in_turn = false;
+        continue;
+
+      case kBlocked:
+        EndTurn(channel);
+        l.head[service_class] = p.next;
+        blocked++;
+        continue;
+
+      case kReady:
+        break;
+    }
+
+    blocked = 0;
+    if (!p.in_turn) {
+      p.deficit += quantum_ * p.weight;
+      p.in_turn = true;
+    }
+    if (p.deficit > 0) return channel;
+
+    /* Turn used up, on to the next channel */
+    p.in_turn = false;
+    l.head[service_class] = p.next;
+  }
+
+  return kNone;
+}
+
+void L2cScheduler::Charge(size_t channel, size_t bytes) {
+  Channel& p = channels_[channel];
+  p.deficit -= bytes;
+  if (p.link == kNone) return;
+
+  LinkStats& stats = links_[p.link].stats;
+  stats.pdus++;
+  stats.bytes += bytes;
+  if (p.service_class == kStrict) stats.strict_bytes += bytes;
+}
+
+void L2cScheduler::Yield(size_t channel) {
+  Channel& p = channels_[channel];
+  if (!p.ready) return;
+
+  EndTurn(channel);
+  Link& l = links_[p.link];
+  if (l.head[p.service_class] == (int32_t)channel)
+    l.head[p.service_class] = p.next;
+}
+
+void L2cScheduler::CreditsUsed(size_t link, uint16_t count) {
+  LinkStats& stats = links_[link].stats;
+  stats.credits_used += count;
+  stats.credits_in_use += count;
+  stats.max_credits_in_use =
+      std::max(stats.max_credits_in_use, stats.credits_in_use);
+}
+
+void L2cScheduler::CreditsReturned(size_t link, uint16_t count) {
+  LinkStats& stats = links_[link].stats;
+  stats.credits_returned += count;
+  stats.credits_in_use -= std::min(count, stats.credits_in_use);
+}
+
+void L2cScheduler::Stalled(size_t link) { links_[link].stats.stalls++; }
+
+void L2cScheduler::ResetStats(size_t link) {
+  memset(&links_[link].stats, 0, sizeof(LinkStats));
+  links_[link].strict_run = 0;
+}
+
+size_t L2cScheduler::ready(size_t link) const {
+  size_t count = 0;
+  for (size_t c = 0; c < kNumClasses; c++) count += links_[link].count[c];
+  return count;
+}
+
+void L2cScheduler::Insert(size_t channel) {
+  Channel& p = channels_[channel];
+  Link& l = links_[p.link];
+  int32_t& head = l.head[p.service_class];
+
+  /* at the tail, served last */
+  if (head == kNone) {
+    head = channel;
+    p.prev = p.next = channel;
+  } else {
+    Channel& first = channels_[head];
+    size_t last = first.prev;
+    p.prev = last;
+    p.next = head;
+    channels_[last].next = channel;
+    first.prev = channel;
+  }
+  l.count[p.service_class]++;
+  p.ready = true;
+}
+
+void L2cScheduler::Remove(size_t channel) {
+  Channel& p = channels_[channel];
+  Link& l = links_[p.link];
+  int32_t& head = l.head[p.service_class];
+
+  if (--l.count[p.service_class] == 0) {
+    head = kNone;
+  } else {
+    channels_[p.prev].next = p.next;
+    channels_[p.next].prev = p.prev;
+    if (head == (int32_t)channel) head = p.next;
+  }
+  p.ready = false;
+}
+
+void L2cScheduler::EndTurn(size_t channel) {
+  Channel& p = channels_[channel];
+  p.in_turn = false;
+  /* Unused quanta are not saved up for later */
+  if (p.deficit > 0) p.deficit = 0;
+}
@@ -0,0 +1,142 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/* L2cScheduler picks the channel of a link that sends next.
+ *
+ * Links and channels are known by their index in the L2CAP pools. Each link
+ * keeps a ready list per service class, holding the channels that have data
+ * queued, so that picking a channel never walks the idle channels of the link.
+ *
+ * Channels of the strict class (media) are served before the others, up to a
+ * burst limit while weighted channels wait. Within a class, channels share the
+ * link by deficit round robin: each turn a channel earns |weight| quanta of
+ * bytes, and keeps sending while it has some left, so the bytes sent follow
+ * the weights whatever the size of the packets.
+ *
+ * The scheduler also keeps the controller credit use of each link.
+ */
+class L2cScheduler {
+ public:
+  static constexpr int kNone = -1;
+
+  /* Service classes, in the order they are served */
+  enum Class : uint8_t {
+    kStrict = 0,
+    kWeighted = 1,
+  };
+  static constexpr size_t kNumClasses = 2;
+
+  /* What a ready channel can do right now */
+  enum State : uint8_t {
+    /* nothing queued, it leaves the ready list until woken again */
+    kEmpty,
+    /* data queued but flow controlled, it loses its turn */
+    kBlocked,
+    kReady,
+  };
+  using StateFn = State (*)(size_t channel);
+
+  struct LinkStats {
+    /* PDUs and bytes sent from the channels of the link */
+    uint64_t pdus;
+    uint64_t bytes;
+    uint64_t strict_bytes;
+    /* controller buffers taken and given back */
+    uint64_t credits_used;
+    uint64_t credits_returned;
+    uint16_t credits_in_use;
+    uint16_t max_credits_in_use;
+    /* times the link had ready channels but no controller buffer */
+    uint64_t stalls;
+    /* times a weighted channel was served to end a strict burst */
+    uint64_t burst_breaks;
+  };
+
+  /* |quantum| is the bytes a channel of weight 1 earns per turn. With
+   * |strict_burst| non zero, one weighted channel is served after that many
+   * strict PDUs in a row. */
+  L2cScheduler(size_t num_links, size_t num_channels, uint32_t quantum,
+               uint32_t strict_burst);
+
+  /* Makes |channel| one of the channels of |link| */
+  void Attach(size_t link, size_t channel, Class service_class,
+              uint8_t weight);
+  /* Removes |channel| from its link */
+  void Detach(size_t channel);
+  /* Changes the class and weight of |channel| */
+  void Configure(size_t channel, Class service_class, uint8_t weight);
+
+  /* Puts |channel| in the ready list of its link, after data was queued */
+  void Wake(size_t channel);
+
+  /* Returns the channel of |link| that sends next, or kNone. |state| tells
+   * what each ready channel looked at can do. */
+  int Next(size_t link, StateFn state);
+  /* Charges |bytes| sent to |channel| */
+  void Charge(size_t channel, size_t bytes);
+  /* Ends the turn of |channel|, which had nothing to send after all */
+  void Yield(size_t channel);
+
+  void CreditsUsed(size_t link, uint16_t count);
+  void CreditsReturned(size_t link, uint16_t count);
+  void Stalled(size_t link);
+  /* Forgets the statistics of |link|, when it is connected */
+  void ResetStats(size_t link);
+
+  const LinkStats& stats(size_t link) const { return links_[link].stats; }
+  /* Number of channels of |link| in its ready lists */
+  size_t ready(size_t link) const;
+
+ private:
+  struct Channel {
+    int16_t link;
+    uint8_t service_class;
+    uint8_t weight;
+    bool ready;
+    /* the channel earned its quanta for the current turn */
+    bool in_turn;
+    int32_t deficit;
+    /* circular ready list */
+    uint16_t prev;
+    uint16_t next;
+  };
+
+  struct Link {
+    /* channel served next in each class, kNone if the list is empty */
+    int32_t head[kNumClasses];
+    uint16_t count[kNumClasses];
+    uint32_t strict_run;
+    LinkStats stats;
+  };
+
+  void Insert(size_t channel);
+  void Remove(size_t channel);
+  void EndTurn(size_t channel);
+  int NextInClass(size_t link, Class service_class, StateFn state);
+
+  uint32_t quantum_;
+  uint32_t strict_burst_;
+  std::vector<Channel> channels_;
+  std::vector<Link> links_;
+};
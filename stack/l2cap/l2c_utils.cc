@@ -22,6 +22,7 @@
  *
  ******************************************************************************/
 
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -37,9 +38,14 @@
 #include "hcidefs.h"
 #include "hcimsgs.h"
 #include "l2c_int.h"
+#include "l2c_scheduler.h"
 #include "l2cdefs.h"
 #include "osi/include/allocator.h"
 
+/* Picks the channel that sends next on each link */
+static L2cScheduler l2c_sched(MAX_L2CAP_LINKS, MAX_L2CAP_CHANNELS,
+                              L2CAP_SCHED_QUANTUM, L2CAP_SCHED_STRICT_BURST);
+
 /*******************************************************************************
  *
  * Function         l2cu_can_allocate_lcb
@@ -91,6 +97,7 @@ tL2C_LCB* l2cu_allocate_lcb(const RawAddress& p_bd_addr, bool is_bonding,
       p_lcb->tx_data_len =
           controller_get_interface()->get_ble_default_data_packet_length();
       p_lcb->le_sec_pending_q = fixed_queue_new(SIZE_MAX);
+      l2c_sched.ResetStats(xx);
 
       if (transport == BT_TRANSPORT_LE) {
         l2cb.num_ble_links_active++;
@@ -1160,6 +1167,36 @@ void l2cu_send_peer_info_rsp(tL2C_LCB* p_lcb, uint8_t remote_id,
   l2c_link_check_send_pkts(p_lcb, NULL, p_buf);
 }
 
+/******************************************************************************
+ *
+ * Function         l2cu_sched_class
+ *
+ * Description      High priority channels are served before the others
+ *
+ * Returns          scheduler class of the channel
+ *
+ ******************************************************************************/
+static L2cScheduler::Class l2cu_sched_class(const tL2C_CCB* p_ccb) {
+  if (p_ccb->ccb_priority == L2CAP_CHNL_PRIORITY_HIGH)
+    return L2cScheduler::kStrict;
+  return L2cScheduler::kWeighted;
+}
+
+/******************************************************************************
+ *
+ * Function         l2cu_sched_weight
+ *
+ * Description      Share of the link of a channel against the channels of its
+ *                  class
+ *
+ * Returns          round robin weight of the channel
+ *
+ ******************************************************************************/
+static uint8_t l2cu_sched_weight(const tL2C_CCB* p_ccb) {
+  if (p_ccb->tx_weight != 0) return p_ccb->tx_weight;
+  return L2CAP_NUM_CHNL_PRIORITY - p_ccb->ccb_priority;
+}
+
 /******************************************************************************
  *
  * Function         l2cu_enqueue_ccb
@@ -1224,23 +1261,10 @@ void l2cu_enqueue_ccb(tL2C_CCB* p_ccb) {
     }
   }
 
-#if (L2CAP_ROUND_ROBIN_CHANNEL_SERVICE == TRUE)
-  /* Adding CCB into round robin service table of its LCB */
-  if (p_ccb->p_lcb != NULL) {
-    /* if this is the first channel in this priority group */
-    if (p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].num_ccb == 0) {
-      /* Set the first channel to this CCB */
-      p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].p_first_ccb = p_ccb;
-      /* Set the next serving channel in this group to this CCB */
-      p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].p_serve_ccb = p_ccb;
-      /* Initialize quota of this priority group based on its priority */
-      p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].quota =
-          L2CAP_GET_PRIORITY_QUOTA(p_ccb->ccb_priority);
-    }
-    /* increase number of channels in this group */
-    p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].num_ccb++;
-  }
-#endif
+  /* Adding CCB into the scheduler of its LCB, data queued before is sent */
+  l2c_sched.Attach(p_ccb->p_lcb - l2cb.lcb_pool, p_ccb - l2cb.ccb_pool,
+                   l2cu_sched_class(p_ccb), l2cu_sched_weight(p_ccb));
+  l2cu_sched_wake(p_ccb);
 }
 
 /******************************************************************************
@@ -1270,31 +1294,8 @@ void l2cu_dequeue_ccb(tL2C_CCB* p_ccb) {
     return;
   }
 
-#if (L2CAP_ROUND_ROBIN_CHANNEL_SERVICE == TRUE)
-  /* Removing CCB from round robin service table of its LCB */
-  if (p_ccb->p_lcb != NULL) {
-    /* decrease number of channels in this priority group */
-    p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].num_ccb--;
-
-    /* if it was the last channel in the priority group */
-    if (p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].num_ccb == 0) {
-      p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].p_first_ccb = NULL;
-      p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].p_serve_ccb = NULL;
-    } else {
-      /* if it is the first channel of this group */
-      if (p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].p_first_ccb == p_ccb) {
-        p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].p_first_ccb =
-            p_ccb->p_next_ccb;
-      }
-      /* if it is the next serving channel of this group */
-      if (p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].p_serve_ccb == p_ccb) {
-        /* simply, start serving from the first channel */
-        p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].p_serve_ccb =
-            p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].p_first_ccb;
-      }
-    }
-  }
-#endif
+  /* Removing CCB from the scheduler of its LCB */
+  l2c_sched.Detach(p_ccb - l2cb.ccb_pool);
 
   if (p_ccb == p_q->p_first_ccb) {
     /* We are removing the first in a queue */
@@ -1337,27 +1338,31 @@ void l2cu_change_pri_ccb(tL2C_CCB* p_ccb, tL2CAP_CHNL_PRIORITY priority) {
 
       p_ccb->ccb_priority = priority;
       l2cu_enqueue_ccb(p_ccb);
-    }
-#if (L2CAP_ROUND_ROBIN_CHANNEL_SERVICE == TRUE)
-    else {
+    } else {
       /* If CCB is the only guy on the queue, no need to re-enqueue */
-      /* update only round robin service data */
-      p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].num_ccb = 0;
-      p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].p_first_ccb = NULL;
-      p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].p_serve_ccb = NULL;
-
       p_ccb->ccb_priority = priority;
-
-      p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].p_first_ccb = p_ccb;
-      p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].p_serve_ccb = p_ccb;
-      p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].quota =
-          L2CAP_GET_PRIORITY_QUOTA(p_ccb->ccb_priority);
-      p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].num_ccb = 1;
+      l2c_sched.Configure(p_ccb - l2cb.ccb_pool, l2cu_sched_class(p_ccb),
+                          l2cu_sched_weight(p_ccb));
     }
-#endif
   }
 }
 
+/******************************************************************************
+ *
+ * Function         l2cu_change_tx_weight_ccb
+ *
+ * Description      Sets the round robin weight of a channel, 0 for the default
+ *                  weight of its priority
+ *
+ * Returns          -
+ *
+ ******************************************************************************/
+void l2cu_change_tx_weight_ccb(tL2C_CCB* p_ccb, uint8_t weight) {
+  p_ccb->tx_weight = weight;
+  l2c_sched.Configure(p_ccb - l2cb.ccb_pool, l2cu_sched_class(p_ccb),
+                      l2cu_sched_weight(p_ccb));
+}
+
 /*******************************************************************************
  *
  * Function         l2cu_allocate_ccb
@@ -1422,6 +1427,7 @@ tL2C_CCB* l2cu_allocate_ccb(tL2C_LCB* p_lcb, uint16_t cid) {
 
   /* Set priority then insert ccb into LCB queue (if we have an LCB) */
   p_ccb->ccb_priority = L2CAP_CHNL_PRIORITY_LOW;
+  p_ccb->tx_weight = 0;
 
   if (p_lcb) l2cu_enqueue_ccb(p_ccb);
 
@@ -1594,6 +1600,9 @@ void l2cu_release_ccb(tL2C_CCB* p_ccb) {
 
   l2c_fcr_cleanup(p_ccb);
 
+  /* Fixed channels stay on their LCB queue, but they are done sending */
+  l2c_sched.Detach(p_ccb - l2cb.ccb_pool);
+
   /* Channel may not be assigned to any LCB if it was just pre-reserved */
   if ((p_lcb) && ((p_ccb->local_cid >= L2CAP_BASE_APPL_CID))) {
     l2cu_dequeue_ccb(p_ccb);
@@ -3091,98 +3100,67 @@ tL2C_CCB* l2cu_find_ccb_by_cid(tL2C_LCB* p_lcb, uint16_t local_cid) {
 
 /******************************************************************************
  *
- * Function         l2cu_get_next_channel_in_rr
+ * Function         l2cu_sched_ccb_state
  *
- * Description      get the next channel to send on a link. It also adjusts the
- *                  CCB queue to do a basic priority and round-robin scheduling.
+ * Description      Tells the scheduler whether a channel has data to send, and
+ *                  whether it may send it now.
  *
- * Returns          pointer to CCB or NULL
+ * Returns          state of the channel
  *
  ******************************************************************************/
-static tL2C_CCB* l2cu_get_next_channel_in_rr(tL2C_LCB* p_lcb) {
-  tL2C_CCB* p_serve_ccb = NULL;
-  tL2C_CCB* p_ccb;
-
-  int i, j;
+static L2cScheduler::State l2cu_sched_ccb_state(size_t channel) {
+  tL2C_CCB* p_ccb = &l2cb.ccb_pool[channel];
 
-  /* scan all of priority until finding a channel to serve */
-  for (i = 0; (i < L2CAP_NUM_CHNL_PRIORITY) && (!p_serve_ccb); i++) {
-    /* scan all channel within serving priority group until finding a channel to
-     * serve */
-    for (j = 0; (j < p_lcb->rr_serv[p_lcb->rr_pri].num_ccb) && (!p_serve_ccb);
-         j++) {
-      /* scaning from next serving channel */
-      p_ccb = p_lcb->rr_serv[p_lcb->rr_pri].p_serve_ccb;
+  if (!p_ccb->in_use || p_ccb->p_lcb == NULL) return L2cScheduler::kEmpty;
 
-      if (!p_ccb) {
-        L2CAP_TRACE_ERROR("p_serve_ccb is NULL, rr_pri=%d", p_lcb->rr_pri);
-        return NULL;
-      }
-
-      L2CAP_TRACE_DEBUG("RR scan pri=%d, lcid=0x%04x, q_cout=%d",
-                        p_ccb->ccb_priority, p_ccb->local_cid,
-                        fixed_queue_length(p_ccb->xmit_hold_q));
-
-      /* store the next serving channel */
-      /* this channel is the last channel of its priority group */
-      if ((p_ccb->p_next_ccb == NULL) ||
-          (p_ccb->p_next_ccb->ccb_priority != p_ccb->ccb_priority)) {
-        /* next serving channel is set to the first channel in the group */
-        p_lcb->rr_serv[p_lcb->rr_pri].p_serve_ccb =
-            p_lcb->rr_serv[p_lcb->rr_pri].p_first_ccb;
-      } else {
-        /* next serving channel is set to the next channel in the group */
-        p_lcb->rr_serv[p_lcb->rr_pri].p_serve_ccb = p_ccb->p_next_ccb;
-      }
-
-      if (p_ccb->chnl_state != CST_OPEN) continue;
-
-      if (p_ccb->p_lcb->transport == BT_TRANSPORT_LE) {
-        L2CAP_TRACE_DEBUG("%s : Connection oriented channel", __func__);
-        if (fixed_queue_is_empty(p_ccb->xmit_hold_q)) continue;
+  if (p_ccb->p_lcb->transport == BT_TRANSPORT_LE) {
+    if (fixed_queue_is_empty(p_ccb->xmit_hold_q)) return L2cScheduler::kEmpty;
+    if (p_ccb->chnl_state != CST_OPEN || p_ccb->peer_conn_cfg.credits == 0)
+      return L2cScheduler::kBlocked;
+    return L2cScheduler::kReady;
+  }
 
-      } else {
-        /* eL2CAP option in use */
-        if (p_ccb->peer_cfg.fcr.mode != L2CAP_FCR_BASIC_MODE) {
-          if (p_ccb->fcrb.wait_ack || p_ccb->fcrb.remote_busy) continue;
+  if (p_ccb->peer_cfg.fcr.mode == L2CAP_FCR_BASIC_MODE) {
+    if (fixed_queue_is_empty(p_ccb->xmit_hold_q)) return L2cScheduler::kEmpty;
+    if (p_ccb->chnl_state != CST_OPEN) return L2cScheduler::kBlocked;
+    return L2cScheduler::kReady;
+  }
 
-          if (fixed_queue_is_empty(p_ccb->fcrb.retrans_q)) {
-            if (fixed_queue_is_empty(p_ccb->xmit_hold_q)) continue;
+  /* eL2CAP option in use */
+  bool retransmit = !fixed_queue_is_empty(p_ccb->fcrb.retrans_q);
+  if (!retransmit && fixed_queue_is_empty(p_ccb->xmit_hold_q))
+    return L2cScheduler::kEmpty;
 
-            /* If in eRTM mode, check for window closure */
-            if ((p_ccb->peer_cfg.fcr.mode == L2CAP_FCR_ERTM_MODE) &&
-                (l2c_fcr_is_flow_controlled(p_ccb)))
-              continue;
-          }
-        } else {
-          if (fixed_queue_is_empty(p_ccb->xmit_hold_q)) continue;
-        }
-      }
+  if (p_ccb->chnl_state != CST_OPEN || p_ccb->fcrb.wait_ack ||
+      p_ccb->fcrb.remote_busy)
+    return L2cScheduler::kBlocked;
 
-      /* found a channel to serve */
-      p_serve_ccb = p_ccb;
-      /* decrease quota of its priority group */
-      p_lcb->rr_serv[p_lcb->rr_pri].quota--;
-    }
+  /* If in eRTM mode, check for window closure */
+  if (!retransmit && (p_ccb->peer_cfg.fcr.mode == L2CAP_FCR_ERTM_MODE) &&
+      (l2c_fcr_is_flow_controlled(p_ccb)))
+    return L2cScheduler::kBlocked;
 
-    /* if there is no more quota of the priority group or no channel to have
-     * data to send */
-    if ((p_lcb->rr_serv[p_lcb->rr_pri].quota == 0) || (!p_serve_ccb)) {
-      /* serve next priority group */
-      p_lcb->rr_pri = (p_lcb->rr_pri + 1) % L2CAP_NUM_CHNL_PRIORITY;
-      /* initialize its quota */
-      p_lcb->rr_serv[p_lcb->rr_pri].quota =
-          L2CAP_GET_PRIORITY_QUOTA(p_lcb->rr_pri);
-    }
-  }
+  return L2cScheduler::kReady;
+}
 
-  if (p_serve_ccb) {
-    L2CAP_TRACE_DEBUG("RR service pri=%d, quota=%d, lcid=0x%04x",
-                      p_serve_ccb->ccb_priority,
-                      p_lcb->rr_serv[p_serve_ccb->ccb_priority].quota,
-                      p_serve_ccb->local_cid);
-  }
+/******************************************************************************
+ *
+ * Function         l2cu_get_next_channel_in_rr
+ *
+ * Description      get the next channel to send on a link. High priority
+ *                  channels are served first, the others in deficit round
+ *                  robin by their weight.
+ *
+ * Returns          pointer to CCB or NULL
+ *
+ ******************************************************************************/
+static tL2C_CCB* l2cu_get_next_channel_in_rr(tL2C_LCB* p_lcb) {
+  int channel = l2c_sched.Next(p_lcb - l2cb.lcb_pool, l2cu_sched_ccb_state);
+  if (channel == L2cScheduler::kNone) return NULL;
 
+  tL2C_CCB* p_serve_ccb = &l2cb.ccb_pool[channel];
+  L2CAP_TRACE_DEBUG("RR service pri=%d, lcid=0x%04x",
+                    p_serve_ccb->ccb_priority, p_serve_ccb->local_cid);
   return p_serve_ccb;
 }
 
@@ -3309,6 +3287,7 @@ BT_HDR* l2cu_get_next_buffer_to_send(tL2C_LCB* p_lcb,
     /* Check credits */
     if (p_ccb->peer_conn_cfg.credits == 0) {
       L2CAP_TRACE_DEBUG("%s No credits to send packets", __func__);
+      l2c_sched.Yield(p_ccb - l2cb.ccb_pool);
       return NULL;
     }
 
@@ -3324,16 +3303,22 @@ BT_HDR* l2cu_get_next_buffer_to_send(tL2C_LCB* p_lcb,
   } else {
     if (p_ccb->peer_cfg.fcr.mode != L2CAP_FCR_BASIC_MODE) {
       p_buf = l2c_fcr_get_next_xmit_sdu_seg(p_ccb, 0);
-      if (p_buf == NULL) return (NULL);
+      if (p_buf == NULL) {
+        l2c_sched.Yield(p_ccb - l2cb.ccb_pool);
+        return (NULL);
+      }
     } else {
       p_buf = (BT_HDR*)fixed_queue_try_dequeue(p_ccb->xmit_hold_q);
       if (NULL == p_buf) {
         L2CAP_TRACE_ERROR("l2cu_get_buffer_to_send() #2: No data to be sent");
+        l2c_sched.Yield(p_ccb - l2cb.ccb_pool);
         return (NULL);
       }
     }
   }
 
+  if (p_buf) l2c_sched.Charge(p_ccb - l2cb.ccb_pool, p_buf->len);
+
   if (p_ccb->p_rcb && p_ccb->p_rcb->api.pL2CA_TxComplete_Cb &&
       (p_ccb->peer_cfg.fcr.mode != L2CAP_FCR_ERTM_MODE))
     (*p_ccb->p_rcb->api.pL2CA_TxComplete_Cb)(p_ccb->local_cid, 1);
@@ -3465,3 +3450,97 @@ void l2cu_check_channel_congestion(tL2C_CCB* p_ccb) {
  *
  ******************************************************************************/
 bool l2cu_is_ccb_active(tL2C_CCB* p_ccb) { return (p_ccb && p_ccb->in_use); }
+
+/*******************************************************************************
+ *
+ * Function         l2cu_sched_init
+ *
+ * Description      Forgets all the channels and links of the scheduler
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void l2cu_sched_init(void) {
+  l2c_sched = L2cScheduler(MAX_L2CAP_LINKS, MAX_L2CAP_CHANNELS,
+                           L2CAP_SCHED_QUANTUM, L2CAP_SCHED_STRICT_BURST);
+}
+
+/*******************************************************************************
+ *
+ * Function         l2cu_sched_wake
+ *
+ * Description      Called when data was queued on a channel, so that the
+ *                  scheduler serves it
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void l2cu_sched_wake(tL2C_CCB* p_ccb) {
+#if (L2CAP_ROUND_ROBIN_CHANNEL_SERVICE == TRUE)
+  l2c_sched.Wake(p_ccb - l2cb.ccb_pool);
+#endif
+}
+
+/*******************************************************************************
+ *
+ * Function         l2cu_sched_credits_used
+ *
+ * Description      Counts the controller buffers taken by a link
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void l2cu_sched_credits_used(tL2C_LCB* p_lcb, uint16_t count) {
+  l2c_sched.CreditsUsed(p_lcb - l2cb.lcb_pool, count);
+}
+
+/*******************************************************************************
+ *
+ * Function         l2cu_sched_credits_returned
+ *
+ * Description      Counts the controller buffers given back to a link
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void l2cu_sched_credits_returned(tL2C_LCB* p_lcb, uint16_t count) {
+  l2c_sched.CreditsReturned(p_lcb - l2cb.lcb_pool, count);
+}
+
+/*******************************************************************************
+ *
+ * Function         l2cu_sched_stalled
+ *
+ * Description      Called when a link ran out of controller buffers. It is
+ *                  counted if some channel of the link had data to send.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void l2cu_sched_stalled(tL2C_LCB* p_lcb) {
+  size_t link = p_lcb - l2cb.lcb_pool;
+  if (l2c_sched.ready(link) != 0) l2c_sched.Stalled(link);
+}
+
+void stack_debug_l2cap_dump(int fd) {
+  dprintf(fd, "\nL2CAP link scheduler:\n");
+  for (int xx = 0; xx < MAX_L2CAP_LINKS; xx++) {
+    tL2C_LCB* p_lcb = &l2cb.lcb_pool[xx];
+    if (!p_lcb->in_use) continue;
+
+    const L2cScheduler::LinkStats& stats = l2c_sched.stats(xx);
+    dprintf(fd, "  %s handle: 0x%04x\n",
+            p_lcb->remote_bd_addr.ToString().c_str(), p_lcb->handle);
+    dprintf(fd, "    PDUs: %" PRIu64 ", bytes: %" PRIu64
+                ", high priority bytes: %" PRIu64 "\n",
+            stats.pdus, stats.bytes, stats.strict_bytes);
+    dprintf(fd, "    Credits used: %" PRIu64 ", returned: %" PRIu64
+                ", in use: %u, max in use: %u\n",
+            stats.credits_used, stats.credits_returned, stats.credits_in_use,
+            stats.max_credits_in_use);
+    dprintf(fd,
+            "    Stalled: %" PRIu64 ", high priority bursts broken: %" PRIu64
+            "\n",
+            stats.stalls, stats.burst_breaks);
+  }
+}
@@ -122,8 +122,10 @@ void port_set_defaults(tPORT* p_port) {
   memset(&p_port->rx, 0, sizeof(p_port->rx));
   memset(&p_port->tx, 0, sizeof(p_port->tx));
 
-  p_port->tx.queue = fixed_queue_new(SIZE_MAX);
-  p_port->rx.queue = fixed_queue_new(SIZE_MAX);
+  p_port->tx.queue =
+      fixed_queue_new_with_mode(PORT_TX_BUF_CAPACITY, FIXED_QUEUE_MODE_MPSC);
+  p_port->rx.queue =
+      fixed_queue_new_with_mode(PORT_RX_BUF_CAPACITY, FIXED_QUEUE_MODE_MPSC);
 }
 
 /*******************************************************************************
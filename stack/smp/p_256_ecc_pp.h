@@ -63,4 +63,12 @@ void ECC_PointMult_Bin_NAF(Point* q, Point* p, uint32_t* n, uint32_t keyLength);
 #define ECC_PointMult(q, p, n, keyLength) \
   ECC_PointMult_Bin_NAF(q, p, n, keyLength)
 
+// q = n * G for the P-256 base point, with a precomputed comb. |n| is 256
+// bits. Runs in time independent of |n|, and leaves q affine with q->z = 1.
+void ECC_PointMult_Base(Point* q, const uint32_t* n);
+
+// q = n * p on P-256, with a Montgomery ladder. Runs in time independent of
+// |n| and of |p|; p->z is ignored, and q is left affine with q->z = 1.
+void ECC_PointMult_Ladder(Point* q, const Point& p, const uint32_t* n);
+
 void p_256_init_curve(uint32_t keyLength);
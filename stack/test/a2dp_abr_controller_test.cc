@@ -0,0 +1,293 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+#include "a2dp_abr_controller.h"
+
+namespace {
+
+constexpr size_t kStepUpIntervals = 5;
+constexpr uint32_t kIntervalMs = 1000;
+constexpr size_t kQueueCapacity = 50;
+
+// One row of a recorded metric series
+struct TraceRow {
+  size_t queue_length;
+  uint32_t dropped_packets;
+  uint32_t congested_ms;
+  uint32_t failed_contacts;
+  int8_t rssi;
+  uint8_t expected_bitrate_percent;
+};
+
+tA2DP_ABR_METRICS Metrics(const TraceRow& row) {
+  tA2DP_ABR_METRICS metrics = {};
+  metrics.interval_ms = kIntervalMs;
+  metrics.queue_length = row.queue_length;
+  metrics.queue_capacity = kQueueCapacity;
+  metrics.dropped_packets = row.dropped_packets;
+  metrics.congested_ms = row.congested_ms;
+  metrics.failed_contacts = row.failed_contacts;
+  metrics.has_rssi = true;
+  metrics.rssi = row.rssi;
+  return metrics;
+}
+
+tA2DP_ABR_METRICS CleanMetrics() {
+  return Metrics({2, 0, 0, 0, 0, 0});
+}
+
+tA2DP_ABR_METRICS BadMetrics() {
+  return Metrics({30, 0, 0, 0, 0, 0});
+}
+
+tA2DP_ABR_METRICS CriticalMetrics() {
+  return Metrics({10, 1, 0, 0, 0, 0});
+}
+
+// Replays |trace|, and checks the bit rate picked after each row
+void Replay(A2dpAbrController* abr, const TraceRow* trace, size_t rows) {
+  for (size_t i = 0; i < rows; i++) {
+    EXPECT_EQ(trace[i].expected_bitrate_percent,
+              abr->Update(Metrics(trace[i])))
+        << "at row " << i;
+  }
+}
+
+// A link carrying |capacity_kbps| during one interval, with the Failed Contact
+// Counter increase and RSSI read at the end of it.
+struct LinkRow {
+  uint32_t capacity_kbps;
+  uint32_t failed_contacts;
+  int8_t rssi;
+};
+
+// Walking away from the phone, and back: the link loses up to half its
+// capacity for a while.
+constexpr LinkRow kWalkAwayTrace[] = {
+    {420, 0, 0},   {420, 0, 0},   {410, 0, 0},   {400, 0, -1},  {390, 0, -2},
+    {360, 1, -3},  {330, 2, -5},  {300, 3, -6},  {270, 4, -8},  {240, 6, -9},
+    {220, 7, -10}, {210, 8, -11}, {200, 8, -12}, {200, 9, -12}, {210, 8, -11},
+    {220, 7, -10}, {210, 8, -11}, {230, 6, -9},  {250, 5, -8},  {280, 3, -6},
+    {310, 2, -5},  {340, 1, -4},  {370, 0, -2},  {400, 0, -1},  {420, 0, 0},
+    {420, 0, 0},   {420, 0, 0},   {420, 0, 0},   {420, 0, 0},   {420, 0, 0},
+    {420, 0, 0},   {420, 0, 0},   {420, 0, 0},   {420, 0, 0},   {420, 0, 0},
+    {420, 0, 0},   {420, 0, 0},   {420, 0, 0},   {420, 0, 0},   {420, 0, 0},
+    {420, 0, 0},   {420, 0, 0},   {420, 0, 0},   {420, 0, 0},   {420, 0, 0},
+};
+constexpr size_t kWalkAwayTraceRows =
+    sizeof(kWalkAwayTrace) / sizeof(kWalkAwayTrace[0]);
+
+constexpr uint32_t kEncoderKbps = 328;
+constexpr uint32_t kPacketBytes = 600;
+
+struct SimulationResult {
+  uint32_t dropped_packets;
+  uint8_t final_bitrate_percent;
+};
+
+// Streams through the link of |trace|: the encoder output that the link can't
+// carry waits in a queue, that drops its oldest packets when full.
+// The bit rate is adapted with |abr| if not null.
+SimulationResult Simulate(A2dpAbrController* abr, const LinkRow* trace,
+                          size_t rows) {
+  SimulationResult result = {0, 100};
+  uint64_t queue_bytes = 0;
+  uint8_t bitrate_percent = 100;
+  for (size_t i = 0; i < rows; i++) {
+    uint64_t produced = kEncoderKbps * 1000 / 8 * bitrate_percent / 100;
+    uint64_t capacity = trace[i].capacity_kbps * 1000 / 8;
+    uint64_t offered = queue_bytes + produced;
+
+    tA2DP_ABR_METRICS metrics = {};
+    metrics.interval_ms = kIntervalMs;
+    metrics.queue_capacity = kQueueCapacity;
+    metrics.failed_contacts = trace[i].failed_contacts;
+    metrics.has_rssi = true;
+    metrics.rssi = trace[i].rssi;
+    if (offered > capacity) {
+      metrics.congested_ms = std::min<uint64_t>(
+          kIntervalMs, (offered - capacity) * kIntervalMs / capacity);
+    }
+
+    queue_bytes = offered - std::min(offered, capacity);
+    size_t queue_length = queue_bytes / kPacketBytes;
+    if (queue_length > kQueueCapacity) {
+      metrics.dropped_packets = queue_length - kQueueCapacity;
+      queue_length = kQueueCapacity;
+      queue_bytes = queue_length * kPacketBytes;
+    }
+    metrics.queue_length = queue_length;
+    result.dropped_packets += metrics.dropped_packets;
+
+    if (abr != nullptr) bitrate_percent = abr->Update(metrics);
+  }
+  result.final_bitrate_percent = bitrate_percent;
+  return result;
+}
+
+}  // namespace
+
+TEST(A2dpAbrControllerTest, rates_intervals) {
+  EXPECT_EQ(A2dpAbrController::kClean,
+            A2dpAbrController::Rate(Metrics({12, 0, 0, 0, -4, 0})));
+  EXPECT_EQ(A2dpAbrController::kMarginal,
+            A2dpAbrController::Rate(Metrics({13, 0, 0, 0, 0, 0})));
+  EXPECT_EQ(A2dpAbrController::kMarginal,
+            A2dpAbrController::Rate(Metrics({0, 0, 1, 0, 0, 0})));
+  EXPECT_EQ(A2dpAbrController::kMarginal,
+            A2dpAbrController::Rate(Metrics({0, 0, 0, 1, 0, 0})));
+  EXPECT_EQ(A2dpAbrController::kMarginal,
+            A2dpAbrController::Rate(Metrics({0, 0, 0, 0, -5, 0})));
+  EXPECT_EQ(A2dpAbrController::kBad,
+            A2dpAbrController::Rate(Metrics({25, 0, 0, 0, 0, 0})));
+  EXPECT_EQ(A2dpAbrController::kBad,
+            A2dpAbrController::Rate(Metrics({0, 0, 250, 0, 0, 0})));
+  EXPECT_EQ(A2dpAbrController::kBad,
+            A2dpAbrController::Rate(Metrics({0, 0, 0, 5, 0, 0})));
+  EXPECT_EQ(A2dpAbrController::kCritical,
+            A2dpAbrController::Rate(Metrics({38, 0, 0, 0, 0, 0})));
+  EXPECT_EQ(A2dpAbrController::kCritical,
+            A2dpAbrController::Rate(Metrics({0, 1, 0, 0, 0, 0})));
+
+  // Metrics not read are ignored
+  tA2DP_ABR_METRICS metrics = Metrics({0, 0, 0, 0, -20, 0});
+  metrics.has_rssi = false;
+  metrics.queue_capacity = 0;
+  metrics.queue_length = 10;
+  metrics.interval_ms = 0;
+  EXPECT_EQ(A2dpAbrController::kClean, A2dpAbrController::Rate(metrics));
+}
+
+TEST(A2dpAbrControllerTest, clean_link_keeps_full_bitrate) {
+  A2dpAbrController abr(kStepUpIntervals);
+  for (int i = 0; i < 100; i++) EXPECT_EQ(100, abr.Update(CleanMetrics()));
+  EXPECT_EQ(100u, abr.stats().intervals);
+  EXPECT_EQ(0u, abr.stats().step_downs);
+  EXPECT_EQ(100, abr.stats().min_bitrate_percent);
+}
+
+TEST(A2dpAbrControllerTest, holds_after_step_down) {
+  A2dpAbrController abr(kStepUpIntervals);
+  EXPECT_EQ(85, abr.Update(BadMetrics()));
+  // The queues had no time to drain
+  EXPECT_EQ(85, abr.Update(BadMetrics()));
+  EXPECT_EQ(70, abr.Update(BadMetrics()));
+  // Drops step down at once, by two steps
+  EXPECT_EQ(40, abr.Update(CriticalMetrics()));
+  EXPECT_EQ(40, abr.Update(CriticalMetrics()));
+  EXPECT_EQ(3u, abr.stats().step_downs);
+  EXPECT_EQ(40, abr.stats().min_bitrate_percent);
+}
+
+TEST(A2dpAbrControllerTest, backs_off_failed_step_up) {
+  A2dpAbrController abr(kStepUpIntervals);
+  EXPECT_EQ(70, abr.Update(CriticalMetrics()));
+  for (size_t i = 1; i < kStepUpIntervals; i++) {
+    EXPECT_EQ(70, abr.Update(CleanMetrics()));
+  }
+  EXPECT_EQ(85, abr.Update(CleanMetrics()));
+
+  // The link can't carry the raised bit rate: it takes twice as long to try
+  // again.
+  EXPECT_EQ(70, abr.Update(BadMetrics()));
+  for (size_t i = 1; i < 2 * kStepUpIntervals; i++) {
+    EXPECT_EQ(70, abr.Update(CleanMetrics()));
+  }
+  EXPECT_EQ(85, abr.Update(CleanMetrics()));
+
+  for (size_t i = 1; i < 2 * kStepUpIntervals; i++) {
+    EXPECT_EQ(85, abr.Update(CleanMetrics()));
+  }
+  EXPECT_EQ(100, abr.Update(CleanMetrics()));
+
+  // The raised bit rate holds: back to the normal pace
+  for (size_t i = 0; i < 2 * kStepUpIntervals; i++) {
+    EXPECT_EQ(100, abr.Update(CleanMetrics()));
+  }
+  EXPECT_EQ(70, abr.Update(CriticalMetrics()));
+  for (size_t i = 1; i < kStepUpIntervals; i++) {
+    EXPECT_EQ(70, abr.Update(CleanMetrics()));
+  }
+  EXPECT_EQ(85, abr.Update(CleanMetrics()));
+  EXPECT_EQ(4u, abr.stats().step_ups);
+}
+
+TEST(A2dpAbrControllerTest, reset) {
+  A2dpAbrController abr(kStepUpIntervals);
+  abr.Update(CriticalMetrics());
+  abr.Reset();
+  EXPECT_EQ(100, abr.bitrate_percent());
+  EXPECT_EQ(0u, abr.stats().intervals);
+  EXPECT_EQ(0u, abr.stats().step_downs);
+  EXPECT_EQ(100, abr.stats().min_bitrate_percent);
+}
+
+TEST(A2dpAbrControllerTest, replays_recorded_metrics) {
+  // queue, dropped, congested ms, failed contacts, rssi, expected bit rate
+  const TraceRow trace[] = {
+      {2, 0, 0, 0, 0, 100},       {4, 0, 0, 0, -2, 100},
+      {14, 0, 120, 1, -6, 100},   {27, 0, 400, 3, -8, 85},
+      {30, 0, 350, 2, -8, 85},    {40, 3, 900, 9, -10, 55},
+      {20, 0, 300, 4, -9, 55},    {9, 0, 100, 1, -7, 55},
+      {3, 0, 0, 0, -4, 55},       {2, 0, 0, 0, -3, 55},
+      {2, 0, 0, 0, -3, 55},       {1, 0, 0, 0, -2, 55},
+      {1, 0, 0, 0, -2, 70},       {2, 0, 0, 0, -2, 70},
+      {28, 0, 300, 2, -6, 55},    {8, 0, 0, 0, -4, 55},
+      {2, 0, 0, 0, -3, 55},       {2, 0, 0, 0, -3, 55},
+      {2, 0, 0, 0, -3, 55},       {2, 0, 0, 0, -3, 55},
+      {2, 0, 0, 0, -3, 55},       {2, 0, 0, 0, -3, 55},
+      {2, 0, 0, 0, -3, 55},       {2, 0, 0, 0, -3, 55},
+      {2, 0, 0, 0, -2, 70},       {2, 0, 0, 0, -2, 70},
+      {2, 0, 0, 0, -2, 70},       {2, 0, 0, 0, -2, 70},
+      {2, 0, 0, 0, -2, 70},       {2, 0, 0, 0, -2, 70},
+      {2, 0, 0, 0, -1, 70},       {2, 0, 0, 0, -1, 70},
+      {2, 0, 0, 0, -1, 70},       {2, 0, 0, 0, -1, 70},
+      {2, 0, 0, 0, -1, 85},       {2, 0, 0, 0, 0, 85},
+      {2, 0, 0, 0, 0, 85},        {2, 0, 0, 0, 0, 85},
+      {2, 0, 0, 0, 0, 85},        {2, 0, 0, 0, 0, 85},
+      {2, 0, 0, 0, 0, 85},        {2, 0, 0, 0, 0, 85},
+      {2, 0, 0, 0, 0, 85},        {2, 0, 0, 0, 0, 85},
+      {2, 0, 0, 0, 0, 100},
+  };
+  A2dpAbrController abr(kStepUpIntervals);
+  Replay(&abr, trace, sizeof(trace) / sizeof(trace[0]));
+
+  EXPECT_EQ(1u, abr.stats().critical_intervals);
+  EXPECT_EQ(4u, abr.stats().bad_intervals);
+  EXPECT_EQ(2u, abr.stats().marginal_intervals);
+  EXPECT_EQ(3u, abr.stats().step_downs);
+  EXPECT_EQ(4u, abr.stats().step_ups);
+}
+
+TEST(A2dpAbrControllerTest, trades_bitrate_for_fewer_drops) {
+  SimulationResult fixed =
+      Simulate(nullptr, kWalkAwayTrace, kWalkAwayTraceRows);
+
+  A2dpAbrController abr(kStepUpIntervals);
+  SimulationResult adaptive =
+      Simulate(&abr, kWalkAwayTrace, kWalkAwayTraceRows);
+
+  EXPECT_GT(fixed.dropped_packets, 0u);
+  EXPECT_LT(adaptive.dropped_packets, fixed.dropped_packets / 4);
+  EXPECT_GT(abr.stats().step_downs, 0u);
+  // Back to the full bit rate once the link recovered, without swinging
+  EXPECT_EQ(100, adaptive.final_bitrate_percent);
+  EXPECT_LE(abr.stats().step_ups, abr.stats().step_downs * 2);
+}
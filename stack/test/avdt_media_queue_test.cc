@@ -0,0 +1,191 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <stdlib.h>
+
+#include <set>
+
+#include "avdt_media_queue.h"
+
+namespace {
+
+constexpr uint64_t kMaxDelayUs = 200000;
+
+std::set<void*> freed;
+
+void FreePacket(void* p) {
+  freed.insert(p);
+  free(p);
+}
+
+BT_HDR* NewPacket(uint16_t len) {
+  BT_HDR* p_pkt = static_cast<BT_HDR*>(calloc(1, sizeof(BT_HDR)));
+  p_pkt->len = len;
+  return p_pkt;
+}
+
+class AvdtMediaQueueTest : public ::testing::Test {
+ protected:
+  void SetUp() override { freed.clear(); }
+};
+
+}  // namespace
+
+TEST_F(AvdtMediaQueueTest, pops_in_order) {
+  AvdtMediaQueue queue(4, kMaxDelayUs, FreePacket);
+  BT_HDR* p1 = NewPacket(100);
+  BT_HDR* p2 = NewPacket(200);
+  queue.Push(p1, 1000);
+  queue.Push(p2, 2000);
+  EXPECT_EQ(2u, queue.size());
+  EXPECT_EQ(300u, queue.GetStats(2000).depth_bytes);
+
+  EXPECT_EQ(p1, queue.Pop(3000));
+  EXPECT_EQ(p2, queue.Pop(3000));
+  EXPECT_EQ(nullptr, queue.Pop(3000));
+  EXPECT_TRUE(freed.empty());
+
+  tAVDT_MEDIA_QUEUE_STATS stats = queue.GetStats(3000);
+  EXPECT_EQ(0u, stats.depth);
+  EXPECT_EQ(0u, stats.depth_bytes);
+  EXPECT_EQ(2u, stats.max_depth);
+  EXPECT_EQ(2u, stats.enqueued);
+  EXPECT_EQ(2u, stats.sent);
+  EXPECT_EQ(3000u, stats.total_latency_us);
+  EXPECT_EQ(2000u, stats.max_latency_us);
+  // 1 ms and 2 ms
+  EXPECT_EQ(1u, stats.latency_hist[1]);
+  EXPECT_EQ(1u, stats.latency_hist[2]);
+  free(p1);
+  free(p2);
+}
+
+TEST_F(AvdtMediaQueueTest, overflow_drops_oldest) {
+  AvdtMediaQueue queue(2, kMaxDelayUs, FreePacket);
+  BT_HDR* p1 = NewPacket(1);
+  BT_HDR* p2 = NewPacket(1);
+  BT_HDR* p3 = NewPacket(1);
+  queue.Push(p1, 0);
+  queue.Push(p2, 0);
+  queue.Push(p3, 0);
+  EXPECT_EQ(2u, queue.size());
+  EXPECT_EQ(1u, freed.count(p1));
+  EXPECT_EQ(1u, queue.GetStats(0).dropped[AVDT_MEDIA_DROP_OVERFLOW]);
+
+  EXPECT_EQ(p2, queue.Pop(0));
+  EXPECT_EQ(p3, queue.Pop(0));
+  free(p2);
+  free(p3);
+}
+
+TEST_F(AvdtMediaQueueTest, drops_expired_oldest_first) {
+  AvdtMediaQueue queue(8, kMaxDelayUs, FreePacket);
+  BT_HDR* p1 = NewPacket(1);
+  BT_HDR* p2 = NewPacket(1);
+  BT_HDR* p3 = NewPacket(1);
+  queue.Push(p1, 0);
+  queue.Push(p2, 50000);
+  queue.Push(p3, 100000);
+
+  EXPECT_EQ(0u, queue.DropExpired(kMaxDelayUs));
+  EXPECT_EQ(2u, queue.DropExpired(kMaxDelayUs + 50001));
+  EXPECT_EQ(1u, freed.count(p1));
+  EXPECT_EQ(1u, freed.count(p2));
+  EXPECT_EQ(2u, queue.GetStats(0).dropped[AVDT_MEDIA_DROP_EXPIRED]);
+
+  EXPECT_EQ(p3, queue.Pop(kMaxDelayUs + 50001));
+  free(p3);
+}
+
+TEST_F(AvdtMediaQueueTest, flush_and_destruction_free_packets) {
+  BT_HDR* p1 = NewPacket(1);
+  BT_HDR* p2 = NewPacket(1);
+  {
+    AvdtMediaQueue queue(8, kMaxDelayUs, FreePacket);
+    queue.Push(p1, 0);
+    EXPECT_EQ(1u, queue.Flush());
+    EXPECT_EQ(1u, freed.count(p1));
+    EXPECT_EQ(1u, queue.GetStats(0).dropped[AVDT_MEDIA_DROP_FLUSHED]);
+    queue.Push(p2, 0);
+  }
+  EXPECT_EQ(1u, freed.count(p2));
+}
+
+TEST_F(AvdtMediaQueueTest, wraps_around) {
+  AvdtMediaQueue queue(3, kMaxDelayUs, FreePacket);
+  for (int i = 0; i < 10; i++) {
+    BT_HDR* p1 = NewPacket(i);
+    BT_HDR* p2 = NewPacket(i + 1);
+    queue.Push(p1, i);
+    queue.Push(p2, i);
+    EXPECT_EQ(p1, queue.Pop(i));
+    EXPECT_EQ(p2, queue.Pop(i));
+    free(p1);
+    free(p2);
+  }
+  EXPECT_TRUE(queue.empty());
+  EXPECT_EQ(20u, queue.GetStats(0).sent);
+}
+
+TEST_F(AvdtMediaQueueTest, counts_congestion) {
+  AvdtMediaQueue queue(8, kMaxDelayUs, FreePacket);
+  queue.SetCongested(true, 1000);
+  queue.SetCongested(true, 2000);
+  EXPECT_EQ(4000u, queue.GetStats(5000).congested_us);
+  queue.SetCongested(false, 6000);
+  queue.SetCongested(true, 10000);
+  queue.SetCongested(false, 11000);
+
+  tAVDT_MEDIA_QUEUE_STATS stats = queue.GetStats(20000);
+  EXPECT_EQ(2u, stats.congestion_count);
+  EXPECT_EQ(6000u, stats.congested_us);
+}
+
+TEST_F(AvdtMediaQueueTest, reset) {
+  AvdtMediaQueue queue(8, kMaxDelayUs, FreePacket);
+  BT_HDR* p1 = NewPacket(1);
+  queue.Push(p1, 0);
+  queue.SetCongested(true, 0);
+  queue.Reset();
+  EXPECT_TRUE(queue.empty());
+  EXPECT_EQ(1u, freed.count(p1));
+
+  tAVDT_MEDIA_QUEUE_STATS stats = queue.GetStats(1000);
+  EXPECT_EQ(0u, stats.enqueued);
+  EXPECT_EQ(0u, stats.dropped[AVDT_MEDIA_DROP_FLUSHED]);
+  EXPECT_EQ(0u, stats.congestion_count);
+  EXPECT_EQ(0u, stats.congested_us);
+}
+
+TEST_F(AvdtMediaQueueTest, reset_stats_rebases_congestion) {
+  AvdtMediaQueue queue(8, kMaxDelayUs, FreePacket);
+  queue.SetCongested(true, 1000);
+  queue.ResetStats(5000);
+
+  tAVDT_MEDIA_QUEUE_STATS stats = queue.GetStats(7000);
+  EXPECT_EQ(1u, stats.congestion_count);
+  EXPECT_EQ(2000u, stats.congested_us);
+
+  queue.SetCongested(false, 8000);
+  queue.ResetStats(9000);
+  stats = queue.GetStats(12000);
+  EXPECT_EQ(0u, stats.congestion_count);
+  EXPECT_EQ(0u, stats.congested_us);
+}
@@ -0,0 +1,201 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "stack/btm/btm_ble_adv_cache.h"
+
+#include <gtest/gtest.h>
+#include <vector>
+
+namespace {
+
+const uint8_t kPublic = 0x00;
+const uint8_t kRandom = 0x01;
+
+RawAddress address(int i) {
+  return RawAddress({0xC0, 0xDE, 0x00, 0x00, (uint8_t)(i >> 8), (uint8_t)i});
+}
+
+class AdvertisingCacheTest : public ::testing::Test {
+ protected:
+  const std::vector<uint8_t>* Set(AdvertisingCache& cache, uint8_t addr_type,
+                                  const RawAddress& addr,
+                                  std::vector<uint8_t> data,
+                                  bool more_data = false) {
+    return cache.Set(addr_type, addr, data.data(), data.size(), more_data,
+                     now_ms_);
+  }
+
+  const std::vector<uint8_t>* Append(AdvertisingCache& cache,
+                                     uint8_t addr_type, const RawAddress& addr,
+                                     std::vector<uint8_t> data,
+                                     bool more_data = false) {
+    return cache.Append(addr_type, addr, data.data(), data.size(), more_data,
+                        now_ms_);
+  }
+
+  uint64_t now_ms_ = 1000;
+};
+
+}  // namespace
+
+TEST_F(AdvertisingCacheTest, set_and_append) {
+  AdvertisingCache cache(8, 0);
+
+  const std::vector<uint8_t>* data =
+      Set(cache, kPublic, address(1), {0x02, 0x01, 0x06});
+  ASSERT_NE(nullptr, data);
+  EXPECT_EQ((std::vector<uint8_t>{0x02, 0x01, 0x06}), *data);
+
+  data = Append(cache, kPublic, address(1), {0x02, 0x0A, 0x00});
+  ASSERT_NE(nullptr, data);
+  EXPECT_EQ((std::vector<uint8_t>{0x02, 0x01, 0x06, 0x02, 0x0A, 0x00}), *data);
+
+  // Set starts over, for a device that never sent its scan response
+  data = Set(cache, kPublic, address(1), {0x02, 0x01, 0x1A});
+  ASSERT_NE(nullptr, data);
+  EXPECT_EQ((std::vector<uint8_t>{0x02, 0x01, 0x1A}), *data);
+
+  // Append without a start stores the data as is
+  data = Append(cache, kPublic, address(2), {0x02, 0x0A, 0x00});
+  ASSERT_NE(nullptr, data);
+  EXPECT_EQ((std::vector<uint8_t>{0x02, 0x0A, 0x00}), *data);
+  EXPECT_EQ(2u, cache.size());
+  EXPECT_EQ(2u, cache.stats().inserted);
+}
+
+TEST_F(AdvertisingCacheTest, address_type_is_part_of_the_key) {
+  AdvertisingCache cache(8, 0);
+
+  Set(cache, kPublic, address(1), {0x01});
+  Set(cache, kRandom, address(1), {0x02});
+  EXPECT_EQ(2u, cache.size());
+  EXPECT_EQ((std::vector<uint8_t>{0x01, 0x03}),
+            *Append(cache, kPublic, address(1), {0x03}));
+
+  cache.Clear(kPublic, address(1));
+  EXPECT_EQ(1u, cache.size());
+  EXPECT_EQ((std::vector<uint8_t>{0x02, 0x04}),
+            *Append(cache, kRandom, address(1), {0x04}));
+}
+
+TEST_F(AdvertisingCacheTest, evicts_least_recently_updated) {
+  AdvertisingCache cache(3, 0);
+
+  Set(cache, kPublic, address(1), {0x01}, true);
+  Set(cache, kPublic, address(2), {0x02});
+  Set(cache, kPublic, address(3), {0x03});
+  // Device 1 is still being reassembled, so device 2 goes first
+  Append(cache, kPublic, address(1), {0x11}, true);
+  Set(cache, kPublic, address(4), {0x04});
+
+  EXPECT_EQ(3u, cache.size());
+  EXPECT_EQ(1u, cache.stats().evicted);
+  EXPECT_EQ(0u, cache.stats().incomplete_chains);
+  EXPECT_TRUE(Append(cache, kPublic, address(2), {})->empty());
+  EXPECT_EQ(2u, cache.stats().evicted);
+
+  // Device 1 is the oldest now, and drops with its chain incomplete
+  Set(cache, kPublic, address(5), {0x05});
+  EXPECT_EQ(3u, cache.stats().evicted);
+  EXPECT_EQ(1u, cache.stats().incomplete_chains);
+  EXPECT_EQ((std::vector<uint8_t>{0x12}),
+            *Append(cache, kPublic, address(1), {0x12}));
+}
+
+TEST_F(AdvertisingCacheTest, expires_stale_devices) {
+  AdvertisingCache cache(8, 500);
+
+  Set(cache, kPublic, address(1), {0x01}, true);
+  now_ms_ += 300;
+  Set(cache, kPublic, address(2), {0x02});
+  now_ms_ += 300;
+  Set(cache, kPublic, address(3), {0x03});
+
+  EXPECT_EQ(2u, cache.size());
+  EXPECT_EQ(1u, cache.stats().expired);
+  EXPECT_EQ(1u, cache.stats().incomplete_chains);
+  EXPECT_EQ(0u, cache.stats().evicted);
+
+  // An update keeps a device alive
+  now_ms_ += 200;
+  Append(cache, kPublic, address(2), {0x12});
+  now_ms_ += 400;
+  EXPECT_EQ((std::vector<uint8_t>{0x02, 0x12, 0x22}),
+            *Append(cache, kPublic, address(2), {0x22}));
+  EXPECT_EQ(2u, cache.stats().expired);
+  EXPECT_EQ(1u, cache.stats().incomplete_chains);
+  EXPECT_EQ(1u, cache.size());
+}
+
+TEST_F(AdvertisingCacheTest, drops_overlong_data) {
+  AdvertisingCache cache(8, 0);
+  std::vector<uint8_t> chunk(229, 0xAA);
+
+  size_t len = 0;
+  while (len + chunk.size() <= AdvertisingCache::kMaxDataLen) {
+    ASSERT_NE(nullptr, Append(cache, kPublic, address(1), chunk, true));
+    len += chunk.size();
+  }
+  EXPECT_EQ(nullptr, Append(cache, kPublic, address(1), chunk, true));
+  EXPECT_EQ(0u, cache.size());
+  EXPECT_EQ(1u, cache.stats().overflowed);
+}
+
+TEST_F(AdvertisingCacheTest, many_devices_stay_reachable) {
+  const int kDevices = 64;
+  AdvertisingCache cache(kDevices, 0);
+
+  // Churn through many more devices than fit, in a pattern that exercises
+  // removals from the middle of probe sequences
+  for (int round = 0; round < 8; round++) {
+    for (int i = 0; i < kDevices; i++) {
+      int device = round * kDevices / 2 + i;
+      Set(cache, kRandom, address(device), {(uint8_t)device});
+      if (i % 3 == 0) cache.Clear(kRandom, address(device - 1));
+    }
+  }
+  EXPECT_LE(cache.size(), (size_t)kDevices);
+
+  // Every device left must still be found
+  for (int device = -1; device < 8 * kDevices; device++)
+    cache.Clear(kRandom, address(device));
+  EXPECT_EQ(0u, cache.size());
+
+  AdvertisingCache fresh(kDevices, 0);
+  for (int i = 0; i < kDevices; i++)
+    Set(fresh, kRandom, address(i), {(uint8_t)i});
+  EXPECT_EQ((size_t)kDevices, fresh.size());
+  for (int i = 0; i < kDevices; i++) {
+    EXPECT_EQ((std::vector<uint8_t>{(uint8_t)i, 0xFF}),
+              *Append(fresh, kRandom, address(i), {0xFF}));
+  }
+  EXPECT_EQ(0u, fresh.stats().evicted);
+}
+
+TEST_F(AdvertisingCacheTest, configure_drops_everything) {
+  AdvertisingCache cache(8, 0);
+  Set(cache, kPublic, address(1), {0x01});
+  Set(cache, kPublic, address(2), {0x02});
+
+  cache.Configure(2, 100);
+  EXPECT_EQ(0u, cache.size());
+  EXPECT_EQ(2u, cache.capacity());
+  EXPECT_EQ(100u, cache.expiry_ms());
+  EXPECT_EQ((std::vector<uint8_t>{0x03}),
+            *Append(cache, kPublic, address(1), {0x03}));
+}
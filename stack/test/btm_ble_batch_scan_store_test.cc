@@ -0,0 +1,198 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "stack/btm/btm_ble_batch_scan_store.h"
+
+#include <gtest/gtest.h>
+
+#include "btm_api_types.h"
+#include "btm_ble_api_types.h"
+
+namespace {
+
+RawAddress address(int i) {
+  return RawAddress({0x11, 0x22, 0x33, 0x44, 0x55, (uint8_t)i});
+}
+
+const std::vector<uint8_t> kAdvData = {0x02, 0x01, 0x06, 0x03, 0x03, 0x0F,
+                                       0x18};
+
+bool Add(BatchScanStore& store, int i, int8_t rssi, uint64_t now_ms,
+         const std::vector<uint8_t>& data = kAdvData) {
+  return store.Add(address(i), 0x01, 0x7F, rssi, data.data(), data.size(),
+                   now_ms);
+}
+
+/* Addresses of the results read, in order */
+std::vector<RawAddress> Addresses(const std::vector<uint8_t>& out,
+                                  uint8_t format) {
+  std::vector<RawAddress> addresses;
+  size_t position = 0;
+  while (position < out.size()) {
+    RawAddress bda;
+    for (size_t i = 0; i < RawAddress::kLength; i++)
+      bda.address[RawAddress::kLength - 1 - i] = out[position + i];
+    addresses.push_back(bda);
+    position += BatchScanStore::kTruncatedResultLen;
+    if (format == BatchScanStore::kFull) {
+      position += 1 + out[position];
+      position += 1 + out[position];
+    }
+  }
+  return addresses;
+}
+
+}  // namespace
+
+TEST(BatchScanStoreTest, full_and_truncated_results) {
+  BatchScanStore store(1024);
+  store.SetMode(BTM_BLE_BATCH_SCAN_MODE_PASS_ACTI,
+                BTM_BLE_DISCARD_OLD_ITEMS);
+  Add(store, 1, -40, 1000);
+
+  std::vector<uint8_t> out;
+  ASSERT_EQ(1, store.Read(BatchScanStore::kTruncated, 1500, &out));
+  EXPECT_EQ((std::vector<uint8_t>{0x01, 0x55, 0x44, 0x33, 0x22, 0x11, 0x01,
+                                  0x7F, (uint8_t)-40, 10, 0}),
+            out);
+
+  ASSERT_EQ(1, store.Read(BatchScanStore::kFull, 2000, &out));
+  std::vector<uint8_t> expected = {0x01, 0x55, 0x44, 0x33, 0x22, 0x11, 0x01,
+                                   0x7F, (uint8_t)-40, 20, 0, 7};
+  expected.insert(expected.end(), kAdvData.begin(), kAdvData.end());
+  expected.push_back(0);
+  EXPECT_EQ(expected, out);
+
+  // Read results are gone
+  EXPECT_EQ(0, store.Read(BatchScanStore::kFull, 2000, &out));
+  EXPECT_TRUE(out.empty());
+}
+
+TEST(BatchScanStoreTest, stores_by_scan_mode) {
+  BatchScanStore store(1024);
+  store.SetMode(BTM_BLE_BATCH_SCAN_MODE_PASS, BTM_BLE_DISCARD_OLD_ITEMS);
+  Add(store, 1, -40, 0);
+  EXPECT_EQ(BatchScanStore::kTruncatedResultLen,
+            store.used(BatchScanStore::kTruncated));
+  EXPECT_EQ(0u, store.used(BatchScanStore::kFull));
+
+  store.SetMode(BTM_BLE_BATCH_SCAN_MODE_DISABLE, BTM_BLE_DISCARD_OLD_ITEMS);
+  Add(store, 2, -40, 0);
+  EXPECT_EQ(BatchScanStore::kTruncatedResultLen,
+            store.used(BatchScanStore::kTruncated));
+}
+
+TEST(BatchScanStoreTest, discards_oldest) {
+  BatchScanStore store(1000);
+  // 5 truncated results of 11 bytes
+  store.Configure(0, 6, 0);
+  store.SetMode(BTM_BLE_BATCH_SCAN_MODE_PASS, BTM_BLE_DISCARD_OLD_ITEMS);
+  for (int i = 0; i < 8; i++) Add(store, i, -40, i);
+
+  std::vector<uint8_t> out;
+  ASSERT_EQ(5, store.Read(BatchScanStore::kTruncated, 10, &out));
+  EXPECT_EQ((std::vector<RawAddress>{address(3), address(4), address(5),
+                                     address(6), address(7)}),
+            Addresses(out, BatchScanStore::kTruncated));
+}
+
+TEST(BatchScanStoreTest, discards_lowest_rssi) {
+  BatchScanStore store(1000);
+  store.Configure(0, 6, 0);
+  store.SetMode(BTM_BLE_BATCH_SCAN_MODE_PASS,
+                BTM_BLE_DISCARD_LOWER_RSSI_ITEMS);
+  const int8_t rssi[] = {-40, -80, -50, -60, -45, -90, -30, -70};
+  for (int i = 0; i < 8; i++) Add(store, i, rssi[i], i);
+
+  std::vector<uint8_t> out;
+  ASSERT_EQ(5, store.Read(BatchScanStore::kTruncated, 10, &out));
+  EXPECT_EQ((std::vector<RawAddress>{address(0), address(2), address(3),
+                                     address(4), address(6)}),
+            Addresses(out, BatchScanStore::kTruncated));
+}
+
+TEST(BatchScanStoreTest, full_results_reuse_their_buffer) {
+  BatchScanStore store(1000);
+  store.Configure(30, 0, 0);
+  store.SetMode(BTM_BLE_BATCH_SCAN_MODE_ACTI, BTM_BLE_DISCARD_OLD_ITEMS);
+
+  // Results of varied length keep pushing each other out, 300 bytes hold
+  // at least 3 of them
+  for (int i = 0; i < 200; i++) {
+    std::vector<uint8_t> data(20 + (i * 7) % 60, (uint8_t)i);
+    Add(store, i, -40, i, data);
+    EXPECT_LE(store.used(BatchScanStore::kFull), 300u);
+  }
+
+  std::vector<uint8_t> out;
+  uint8_t count = store.Read(BatchScanStore::kFull, 200, &out);
+  ASSERT_GE(count, 3);
+  std::vector<RawAddress> addresses = Addresses(out, BatchScanStore::kFull);
+  ASSERT_EQ(count, addresses.size());
+  EXPECT_EQ(address(199), addresses.back());
+
+  // The data of every result is its own
+  size_t position = 0;
+  for (int i = 200 - count; i < 200; i++) {
+    position += BatchScanStore::kTruncatedResultLen;
+    size_t len = out[position++];
+    EXPECT_EQ(20 + (i * 7) % 60, (int)len);
+    for (size_t j = 0; j < len; j++) EXPECT_EQ((uint8_t)i, out[position + j]);
+    position += len;
+    EXPECT_EQ(0, out[position++]);
+  }
+}
+
+TEST(BatchScanStoreTest, long_data_is_split) {
+  BatchScanStore store(4096);
+  store.Configure(100, 0, 0);
+  store.SetMode(BTM_BLE_BATCH_SCAN_MODE_ACTI, BTM_BLE_DISCARD_OLD_ITEMS);
+  Add(store, 1, -40, 0, std::vector<uint8_t>(600, 0xAB));
+
+  std::vector<uint8_t> out;
+  ASSERT_EQ(1, store.Read(BatchScanStore::kFull, 0, &out));
+  EXPECT_EQ(255, out[11]);
+  EXPECT_EQ(255, out[12 + 255]);
+  EXPECT_EQ(11u + 2 + 510, out.size());
+}
+
+TEST(BatchScanStoreTest, notify_threshold) {
+  BatchScanStore store(1000);
+  // 110 bytes, notified at 55
+  store.Configure(0, 11, 50);
+  store.SetMode(BTM_BLE_BATCH_SCAN_MODE_PASS, BTM_BLE_DISCARD_OLD_ITEMS);
+  for (int i = 0; i < 4; i++) EXPECT_FALSE(Add(store, i, -40, 0));
+  EXPECT_TRUE(Add(store, 4, -40, 0));
+  EXPECT_FALSE(Add(store, 5, -40, 0));
+
+  std::vector<uint8_t> out;
+  store.Read(BatchScanStore::kTruncated, 0, &out);
+  for (int i = 0; i < 4; i++) EXPECT_FALSE(Add(store, i, -40, 0));
+  EXPECT_TRUE(Add(store, 4, -40, 0));
+}
+
+TEST(BatchScanStoreTest, at_most_255_results) {
+  BatchScanStore store(8192);
+  store.Configure(0, 100, 0);
+  store.SetMode(BTM_BLE_BATCH_SCAN_MODE_PASS, BTM_BLE_DISCARD_OLD_ITEMS);
+  for (int i = 0; i < 300; i++) Add(store, i, -40, 0);
+
+  std::vector<uint8_t> out;
+  EXPECT_EQ(255, store.Read(BatchScanStore::kTruncated, 0, &out));
+  EXPECT_EQ(255 * BatchScanStore::kTruncatedResultLen, out.size());
+}
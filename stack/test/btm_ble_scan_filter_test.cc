@@ -0,0 +1,217 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "stack/btm/btm_ble_scan_filter.h"
+
+#include <gtest/gtest.h>
+
+#include "btm_api_types.h"
+#include "btm_ble_api_types.h"
+
+using bluetooth::Uuid;
+
+namespace {
+
+const RawAddress kAddr1({0x11, 0x22, 0x33, 0x44, 0x55, 0x66});
+const RawAddress kAddr2({0x11, 0x22, 0x33, 0x44, 0x55, 0x77});
+
+/* Flags, 16 bit service UUIDs 0x180F and 0xFE2C, a name, manufacturer data
+ * of company 0x00E0, and service data of 0xFE2C */
+const std::vector<uint8_t> kAdvData = {
+    0x02, 0x01, 0x06,                                // flags
+    0x05, 0x03, 0x0F, 0x18, 0x2C, 0xFE,              // UUIDs
+    0x06, 0x09, 'P', 'i', 'x', 'e', 'l',             // name
+    0x06, 0xFF, 0xE0, 0x00, 0x01, 0x02, 0x03,        // manufacturer data
+    0x06, 0x16, 0x2C, 0xFE, 0x00, 0xAA, 0xBB,        // service data
+};
+
+ApcfCommand Command(uint8_t type) {
+  ApcfCommand cmd = {};
+  cmd.type = type;
+  return cmd;
+}
+
+btgatt_filt_param_setup_t Params(uint16_t feat_seln,
+                                 uint8_t dely_mode = 0) {
+  btgatt_filt_param_setup_t params = {};
+  params.feat_seln = feat_seln;
+  params.filt_logic_type = BTM_BLE_PF_LOGIC_AND;
+  params.rssi_high_thres = (uint8_t)-128;
+  params.dely_mode = dely_mode;
+  return params;
+}
+
+uint16_t Bit(uint8_t feature) { return 1 << feature; }
+
+uint8_t Match(const HostScanFilter& filter, const RawAddress& bda,
+              const std::vector<uint8_t>& data, int8_t rssi = -50) {
+  return filter.Match(bda, rssi, data.data(), data.size());
+}
+
+}  // namespace
+
+TEST(HostScanFilterTest, disabled_lets_everything_through) {
+  HostScanFilter filter(16);
+  EXPECT_EQ(HostScanFilter::kReportNow | HostScanFilter::kBatch,
+            Match(filter, kAddr1, kAdvData));
+  EXPECT_TRUE(filter.MayMatch(kAddr1));
+}
+
+TEST(HostScanFilterTest, enabled_without_filters_drops_everything) {
+  HostScanFilter filter(16);
+  filter.Enable(true);
+  EXPECT_EQ(0, Match(filter, kAddr1, kAdvData));
+}
+
+TEST(HostScanFilterTest, all_pass_filter) {
+  HostScanFilter filter(16);
+  filter.Enable(true);
+  filter.SetParams(0, Params(0));
+  EXPECT_EQ(HostScanFilter::kReportNow, Match(filter, kAddr1, {}));
+  EXPECT_EQ(15u, filter.available());
+}
+
+TEST(HostScanFilterTest, address_filter_gates_on_address) {
+  HostScanFilter filter(16);
+  filter.Enable(true);
+  ApcfCommand cmd = Command(BTM_BLE_PF_ADDR_FILTER);
+  cmd.address = kAddr1;
+  ASSERT_TRUE(filter.AddCondition(4, cmd));
+  ASSERT_TRUE(filter.SetParams(4, Params(Bit(BTM_BLE_PF_ADDR_FILTER))));
+
+  EXPECT_TRUE(filter.MayMatch(kAddr1));
+  EXPECT_FALSE(filter.MayMatch(kAddr2));
+  EXPECT_EQ(HostScanFilter::kReportNow, Match(filter, kAddr1, kAdvData));
+  EXPECT_EQ(0, Match(filter, kAddr2, kAdvData));
+
+  // An all pass filter next to it opens the gate
+  filter.SetParams(5, Params(0));
+  EXPECT_TRUE(filter.MayMatch(kAddr2));
+  filter.DeleteParams(5);
+  EXPECT_FALSE(filter.MayMatch(kAddr2));
+}
+
+TEST(HostScanFilterTest, service_uuid) {
+  HostScanFilter filter(16);
+  filter.Enable(true);
+  ApcfCommand cmd = Command(BTM_BLE_PF_SRVC_UUID);
+  cmd.uuid = Uuid::From16Bit(0xFE2C);
+  filter.AddCondition(1, cmd);
+  filter.SetParams(1, Params(Bit(BTM_BLE_PF_SRVC_UUID)));
+  EXPECT_EQ(HostScanFilter::kReportNow, Match(filter, kAddr1, kAdvData));
+
+  // A 128 bit UUID in the data is found by its 16 bit form
+  std::vector<uint8_t> data = {0x11, 0x07};
+  Uuid::UUID128Bit uuid = Uuid::From16Bit(0xFE2C).To128BitLE();
+  data.insert(data.end(), uuid.begin(), uuid.end());
+  EXPECT_EQ(HostScanFilter::kReportNow, Match(filter, kAddr1, data));
+
+  filter.ClearFilter(1);
+  cmd.uuid = Uuid::From16Bit(0x180D);
+  filter.AddCondition(1, cmd);
+  filter.SetParams(1, Params(Bit(BTM_BLE_PF_SRVC_UUID)));
+  EXPECT_EQ(0, Match(filter, kAddr1, kAdvData));
+
+  // Masked out, 0x180D matches 0x180F
+  filter.ClearFilter(1);
+  cmd.uuid_mask = Uuid::From16Bit(0xFFF0);
+  filter.AddCondition(1, cmd);
+  filter.SetParams(1, Params(Bit(BTM_BLE_PF_SRVC_UUID)));
+  EXPECT_EQ(HostScanFilter::kReportNow, Match(filter, kAddr1, kAdvData));
+}
+
+TEST(HostScanFilterTest, name_manufacturer_and_service_data) {
+  HostScanFilter filter(16);
+  filter.Enable(true);
+
+  ApcfCommand name = Command(BTM_BLE_PF_LOCAL_NAME);
+  name.name = {'P', 'i', 'x'};
+  filter.AddCondition(2, name);
+
+  ApcfCommand manu = Command(BTM_BLE_PF_MANU_DATA);
+  manu.company = 0x00E0;
+  manu.data = {0x01, 0x00, 0x03};
+  manu.data_mask = {0xFF, 0x00, 0xFF};
+  filter.AddCondition(2, manu);
+
+  ApcfCommand srvc = Command(BTM_BLE_PF_SRVC_DATA_PATTERN);
+  srvc.data = {0x2C, 0xFE, 0x00, 0xAA};
+  srvc.data_mask = {0xFF, 0xFF, 0xFF, 0xFF};
+  filter.AddCondition(2, srvc);
+
+  filter.SetParams(2, Params(Bit(BTM_BLE_PF_LOCAL_NAME) |
+                             Bit(BTM_BLE_PF_MANU_DATA) |
+                             Bit(BTM_BLE_PF_SRVC_DATA_PATTERN)));
+  EXPECT_EQ(HostScanFilter::kReportNow, Match(filter, kAddr1, kAdvData));
+
+  // All the features are required
+  std::vector<uint8_t> data(kAdvData);
+  data[13] = 'X';
+  EXPECT_EQ(0, Match(filter, kAddr1, data));
+
+  // Either one is enough
+  btgatt_filt_param_setup_t params = Params(Bit(BTM_BLE_PF_LOCAL_NAME) |
+                                            Bit(BTM_BLE_PF_MANU_DATA));
+  params.filt_logic_type = BTM_BLE_PF_LOGIC_OR;
+  filter.SetParams(2, params);
+  EXPECT_EQ(HostScanFilter::kReportNow, Match(filter, kAddr1, data));
+}
+
+TEST(HostScanFilterTest, rssi_threshold_and_delivery) {
+  HostScanFilter filter(16);
+  filter.Enable(true);
+
+  btgatt_filt_param_setup_t params = Params(0, HostScanFilter::kDeliveryBatched);
+  params.rssi_high_thres = (uint8_t)-60;
+  filter.SetParams(2, params);
+  EXPECT_EQ(HostScanFilter::kBatch, Match(filter, kAddr1, kAdvData, -50));
+  EXPECT_EQ(0, Match(filter, kAddr1, kAdvData, -70));
+
+  filter.SetParams(3, Params(0));
+  EXPECT_EQ(HostScanFilter::kReportNow | HostScanFilter::kBatch,
+            Match(filter, kAddr1, kAdvData, -50));
+
+  filter.ClearParams();
+  EXPECT_EQ(0, Match(filter, kAddr1, kAdvData));
+  EXPECT_EQ(16u, filter.available());
+}
+
+TEST(HostScanFilterTest, invalid_conditions) {
+  HostScanFilter filter(16);
+  EXPECT_FALSE(filter.AddCondition(16, Command(BTM_BLE_PF_ADDR_FILTER)));
+  EXPECT_FALSE(filter.SetParams(16, Params(0)));
+
+  ApcfCommand manu = Command(BTM_BLE_PF_MANU_DATA);
+  manu.data = {0x01, 0x02};
+  manu.data_mask = {0xFF};
+  EXPECT_FALSE(filter.AddCondition(0, manu));
+}
+
+TEST(HostScanFilterTest, malformed_data) {
+  HostScanFilter filter(16);
+  filter.Enable(true);
+  ApcfCommand name = Command(BTM_BLE_PF_LOCAL_NAME);
+  name.name = {'P'};
+  filter.AddCondition(0, name);
+  filter.SetParams(0, Params(Bit(BTM_BLE_PF_LOCAL_NAME)));
+
+  // The name field runs past the end of the data
+  EXPECT_EQ(0, Match(filter, kAddr1, {0x06, 0x09, 'P', 'i'}));
+  EXPECT_EQ(HostScanFilter::kReportNow,
+            Match(filter, kAddr1, {0x02, 0x09, 'P'}));
+}
@@ -0,0 +1,246 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "stack/btm/btm_dev_index.h"
+
+#include <gtest/gtest.h>
+#include <memory>
+#include <vector>
+
+#include "stack/crypto_toolbox/crypto_toolbox.h"
+
+namespace {
+
+RawAddress address1{{0x01, 0x01, 0x01, 0x01, 0x01, 0x01}};
+RawAddress address2{{0x22, 0x22, 0x02, 0x22, 0x33, 0x22}};
+RawAddress address3{{0x33, 0x03, 0x33, 0x33, 0x44, 0x33}};
+
+Octet16 irk1{{0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a,
+              0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x10}};
+Octet16 irk2{{0xf0, 0xe1, 0xd2, 0xc3, 0xb4, 0xa5, 0x96, 0x87, 0x78, 0x69,
+              0x5a, 0x4b, 0x3c, 0x2d, 0x1e, 0x0f}};
+
+// Same construction as generate_rpa_from_irk_and_rand() in btm_ble_addr.cc
+RawAddress make_rpa(const Octet16& irk, uint32_t prand) {
+  uint8_t rand[3] = {static_cast<uint8_t>(prand),
+                     static_cast<uint8_t>(prand >> 8),
+                     static_cast<uint8_t>((prand >> 16) & 0x3f)};
+  rand[2] |= 0x40;
+
+  RawAddress rpa;
+  rpa.address[2] = rand[0];
+  rpa.address[1] = rand[1];
+  rpa.address[0] = rand[2];
+  Octet16 hash = crypto_toolbox::aes_128(irk, rand, 3);
+  rpa.address[5] = hash[0];
+  rpa.address[4] = hash[1];
+  rpa.address[3] = hash[2];
+  return rpa;
+}
+
+class DeviceRecordIndexTest : public ::testing::Test {
+ protected:
+  tBTM_SEC_DEV_REC* NewRecord(const RawAddress& bd_addr) {
+    records_.emplace_back(new tBTM_SEC_DEV_REC());
+    tBTM_SEC_DEV_REC* p_dev_rec = records_.back().get();
+    p_dev_rec->bd_addr = bd_addr;
+    p_dev_rec->hci_handle = BTM_SEC_INVALID_HANDLE;
+    p_dev_rec->ble_hci_handle = BTM_SEC_INVALID_HANDLE;
+    index_.Add(p_dev_rec);
+    return p_dev_rec;
+  }
+
+  tBTM_SEC_DEV_REC* NewBond(const RawAddress& bd_addr, const Octet16& irk) {
+    tBTM_SEC_DEV_REC* p_dev_rec = NewRecord(bd_addr);
+    p_dev_rec->device_type = BT_DEVICE_TYPE_BLE;
+    p_dev_rec->ble.key_type = BTM_LE_KEY_PID;
+    p_dev_rec->ble.keys.irk = irk;
+    p_dev_rec->ble.identity_addr = bd_addr;
+    index_.Update(p_dev_rec);
+    return p_dev_rec;
+  }
+
+  DeviceRecordIndex index_;
+  std::vector<std::unique_ptr<tBTM_SEC_DEV_REC>> records_;
+};
+
+}  // namespace
+
+TEST_F(DeviceRecordIndexTest, find_by_address) {
+  tBTM_SEC_DEV_REC* p_rec1 = NewRecord(address1);
+  tBTM_SEC_DEV_REC* p_rec2 = NewRecord(address2);
+
+  EXPECT_EQ(p_rec1, index_.FindByAddress(address1));
+  EXPECT_EQ(p_rec2, index_.FindByAddress(address2));
+  EXPECT_EQ(nullptr, index_.FindByAddress(address3));
+
+  p_rec2->ble.pseudo_addr = address3;
+  index_.Update(p_rec2);
+  EXPECT_EQ(p_rec2, index_.FindByAddress(address2));
+  EXPECT_EQ(p_rec2, index_.FindByAddress(address3));
+
+  p_rec2->bd_addr = address1;
+  index_.Update(p_rec2);
+  EXPECT_EQ(nullptr, index_.FindByAddress(address2));
+
+  index_.Remove(p_rec1);
+  EXPECT_EQ(p_rec2, index_.FindByAddress(address1));
+  EXPECT_EQ(1u, index_.size());
+}
+
+TEST_F(DeviceRecordIndexTest, find_by_handle) {
+  tBTM_SEC_DEV_REC* p_rec1 = NewRecord(address1);
+  tBTM_SEC_DEV_REC* p_rec2 = NewRecord(address2);
+
+  p_rec1->hci_handle = 0x0001;
+  index_.Update(p_rec1);
+  p_rec2->ble_hci_handle = 0x0040;
+  index_.Update(p_rec2);
+
+  EXPECT_EQ(p_rec1, index_.FindByHandle(0x0001));
+  EXPECT_EQ(p_rec2, index_.FindByHandle(0x0040));
+  EXPECT_EQ(p_rec1, index_.FindByHandle(BTM_SEC_INVALID_HANDLE));
+  EXPECT_EQ(nullptr, index_.FindByHandle(0x0002));
+
+  p_rec1->hci_handle = BTM_SEC_INVALID_HANDLE;
+  index_.Update(p_rec1);
+  EXPECT_EQ(nullptr, index_.FindByHandle(0x0001));
+}
+
+TEST_F(DeviceRecordIndexTest, find_by_identity_address) {
+  tBTM_SEC_DEV_REC* p_rec1 = NewRecord(address1);
+  NewBond(address2, irk2);
+
+  EXPECT_EQ(nullptr, index_.FindByIdentityAddress(address1));
+
+  p_rec1->ble.identity_addr = address3;
+  index_.Update(p_rec1);
+  EXPECT_EQ(p_rec1, index_.FindByIdentityAddress(address3));
+  EXPECT_EQ(records_[1].get(), index_.FindByIdentityAddress(address2));
+}
+
+TEST_F(DeviceRecordIndexTest, shared_key_returns_oldest_record) {
+  // Records sharing an address until btm_consolidate_dev() merges them
+  tBTM_SEC_DEV_REC* p_rec1 = NewRecord(address2);
+  tBTM_SEC_DEV_REC* p_rec2 = NewRecord(address1);
+  tBTM_SEC_DEV_REC* p_rec3 = NewRecord(address1);
+
+  p_rec1->bd_addr = address1;
+  index_.Update(p_rec1);
+  EXPECT_EQ(p_rec1, index_.FindByAddress(address1));
+  EXPECT_TRUE(index_.AddedBefore(p_rec1, p_rec3));
+  EXPECT_FALSE(index_.AddedBefore(p_rec3, p_rec2));
+
+  index_.Remove(p_rec1);
+  EXPECT_EQ(p_rec2, index_.FindByAddress(address1));
+  index_.Remove(p_rec2);
+  EXPECT_EQ(p_rec3, index_.FindByAddress(address1));
+}
+
+TEST_F(DeviceRecordIndexTest, resolve_rpa) {
+  tBTM_SEC_DEV_REC* p_rec1 = NewBond(address1, irk1);
+  tBTM_SEC_DEV_REC* p_rec2 = NewBond(address2, irk2);
+  NewRecord(address3);
+
+  RawAddress rpa1 = make_rpa(irk1, 0x123456);
+  RawAddress rpa2 = make_rpa(irk2, 0x654321);
+  EXPECT_TRUE(rpa_matches_irk(rpa1, irk1));
+  EXPECT_FALSE(rpa_matches_irk(rpa1, irk2));
+
+  EXPECT_EQ(p_rec1, index_.Resolve(rpa1));
+  EXPECT_EQ(p_rec2, index_.Resolve(rpa2));
+  EXPECT_EQ(p_rec1, index_.Resolve(rpa1));
+  EXPECT_EQ(2u, index_.rpa_cache_size());
+}
+
+TEST_F(DeviceRecordIndexTest, resolve_rpa_needs_le_irk) {
+  tBTM_SEC_DEV_REC* p_rec = NewBond(address1, irk1);
+  RawAddress rpa = make_rpa(irk1, 0x000001);
+
+  p_rec->device_type = BT_DEVICE_TYPE_BREDR;
+  index_.Update(p_rec);
+  EXPECT_EQ(nullptr, index_.Resolve(rpa));
+
+  p_rec->device_type = BT_DEVICE_TYPE_DUMO;
+  index_.Update(p_rec);
+  EXPECT_EQ(p_rec, index_.Resolve(rpa));
+
+  p_rec->ble.key_type = BTM_LE_KEY_PENC;
+  index_.Update(p_rec);
+  EXPECT_EQ(nullptr, index_.Resolve(rpa));
+}
+
+TEST_F(DeviceRecordIndexTest, resolve_rpa_cache_invalidation) {
+  RawAddress rpa1 = make_rpa(irk1, 0x2a2a2a);
+  RawAddress rpa2 = make_rpa(irk2, 0x2a2a2a);
+
+  tBTM_SEC_DEV_REC* p_rec1 = NewBond(address1, irk1);
+  EXPECT_EQ(p_rec1, index_.Resolve(rpa1));
+  // Unresolvable addresses are cached too
+  EXPECT_EQ(nullptr, index_.Resolve(rpa2));
+  EXPECT_EQ(2u, index_.rpa_cache_size());
+
+  // A new bond may resolve an address that used not to
+  tBTM_SEC_DEV_REC* p_rec2 = NewBond(address2, irk2);
+  EXPECT_EQ(0u, index_.rpa_cache_size());
+  EXPECT_EQ(p_rec2, index_.Resolve(rpa2));
+
+  // As may a changed IRK
+  p_rec1->ble.keys.irk = irk2;
+  index_.Update(p_rec1);
+  EXPECT_EQ(p_rec1, index_.Resolve(rpa2));
+  EXPECT_EQ(nullptr, index_.Resolve(rpa1));
+
+  // Changing anything else keeps the cache
+  p_rec1->hci_handle = 0x0003;
+  index_.Update(p_rec1);
+  EXPECT_EQ(2u, index_.rpa_cache_size());
+
+  index_.Remove(p_rec1);
+  EXPECT_EQ(0u, index_.rpa_cache_size());
+  EXPECT_EQ(p_rec2, index_.Resolve(rpa2));
+}
+
+TEST_F(DeviceRecordIndexTest, resolve_rpa_cache_evicts_least_recently_used) {
+  DeviceRecordIndex index(2);
+  records_.emplace_back(new tBTM_SEC_DEV_REC());
+  tBTM_SEC_DEV_REC* p_rec = records_.back().get();
+  p_rec->bd_addr = address1;
+  p_rec->device_type = BT_DEVICE_TYPE_BLE;
+  p_rec->ble.key_type = BTM_LE_KEY_PID;
+  p_rec->ble.keys.irk = irk1;
+  index.Add(p_rec);
+
+  RawAddress rpa1 = make_rpa(irk1, 1);
+  RawAddress rpa2 = make_rpa(irk1, 2);
+  RawAddress rpa3 = make_rpa(irk1, 3);
+  EXPECT_EQ(p_rec, index.Resolve(rpa1));
+  EXPECT_EQ(p_rec, index.Resolve(rpa2));
+  EXPECT_EQ(p_rec, index.Resolve(rpa1));
+  EXPECT_EQ(p_rec, index.Resolve(rpa3));
+  EXPECT_EQ(2u, index.rpa_cache_size());
+
+  // rpa2 was evicted; resolving it again still works, and evicts rpa1
+  EXPECT_EQ(p_rec, index.Resolve(rpa2));
+  EXPECT_EQ(2u, index.rpa_cache_size());
+
+  DeviceRecordIndex uncached(0);
+  uncached.Add(p_rec);
+  EXPECT_EQ(p_rec, uncached.Resolve(rpa1));
+  EXPECT_EQ(0u, uncached.rpa_cache_size());
+}
@@ -0,0 +1,111 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "stack/btm/btm_inq_db_index.h"
+
+#include <gtest/gtest.h>
+#include <string.h>
+#include <algorithm>
+
+namespace {
+
+const size_t kDbSize = 40;
+
+RawAddress address(int i) {
+  return RawAddress({0x11, 0x22, 0x33, 0x44, (uint8_t)(i >> 8), (uint8_t)i});
+}
+
+class InquiryDbIndexTest : public ::testing::Test {
+ protected:
+  InquiryDbIndexTest() : index_(db_, kDbSize) {}
+
+  // Takes entry |i| into use for |bda|, as btm_inq_db_new() does
+  tINQ_DB_ENT* Use(size_t i, const RawAddress& bda) {
+    tINQ_DB_ENT* p_ent = &db_[i];
+    if (p_ent->in_use) index_.Remove(p_ent);
+    memset(p_ent, 0, sizeof(tINQ_DB_ENT));
+    p_ent->inq_info.results.remote_bd_addr = bda;
+    p_ent->in_use = true;
+    index_.Add(p_ent);
+    return p_ent;
+  }
+
+  void Free(size_t i) {
+    index_.Remove(&db_[i]);
+    db_[i].in_use = false;
+  }
+
+  tINQ_DB_ENT db_[kDbSize] = {};
+  InquiryDbIndex index_;
+};
+
+}  // namespace
+
+TEST_F(InquiryDbIndexTest, finds_entries_by_address) {
+  for (size_t i = 0; i < kDbSize; i++) Use(i, address(i));
+
+  for (size_t i = 0; i < kDbSize; i++)
+    EXPECT_EQ(&db_[i], index_.Find(address(i)));
+  EXPECT_EQ(nullptr, index_.Find(address(kDbSize)));
+  EXPECT_EQ(nullptr, index_.Find(RawAddress::kEmpty));
+}
+
+TEST_F(InquiryDbIndexTest, freed_and_reused_entries) {
+  for (size_t i = 0; i < kDbSize; i++) Use(i, address(i));
+
+  Free(3);
+  EXPECT_EQ(nullptr, index_.Find(address(3)));
+
+  // The oldest entry is reused for a new device
+  Use(7, address(100));
+  EXPECT_EQ(nullptr, index_.Find(address(7)));
+  EXPECT_EQ(&db_[7], index_.Find(address(100)));
+
+  Use(3, address(7));
+  EXPECT_EQ(&db_[3], index_.Find(address(7)));
+  for (size_t i = 0; i < kDbSize; i++) {
+    if (i == 3 || i == 7) continue;
+    EXPECT_EQ(&db_[i], index_.Find(address(i)));
+  }
+}
+
+TEST_F(InquiryDbIndexTest, entry_freed_behind_its_back_is_not_found) {
+  Use(0, address(1));
+  db_[0].in_use = false;
+  EXPECT_EQ(nullptr, index_.Find(address(1)));
+}
+
+TEST_F(InquiryDbIndexTest, rebuild_after_entries_moved) {
+  for (size_t i = 0; i < 10; i++) Use(i, address(i));
+
+  // Sorted, as btm_sort_inq_result() does
+  std::reverse(db_, db_ + 10);
+  index_.Rebuild();
+  for (size_t i = 0; i < 10; i++)
+    EXPECT_EQ(&db_[9 - i], index_.Find(address(i)));
+}
+
+TEST_F(InquiryDbIndexTest, indexes_entries_in_use_at_construction) {
+  db_[5].inq_info.results.remote_bd_addr = address(5);
+  db_[5].in_use = true;
+  db_[6].inq_info.results.remote_bd_addr = address(6);
+
+  InquiryDbIndex index(db_, kDbSize);
+  EXPECT_EQ(&db_[5], index.Find(address(5)));
+  EXPECT_EQ(nullptr, index.Find(address(6)));
+}
@@ -397,4 +397,157 @@ TEST(CryptoToolboxTest, bt_spec_example_d_12_test) {
   EXPECT_EQ(expected_ltk, ltk);
 }
 
+// The spec vectors above, run against every AES implementation the CPU has
+class CryptoToolboxImplTest : public ::testing::TestWithParam<AesImpl> {
+ protected:
+  void SetUp() override {
+    saved_impl_ = aes_get_impl();
+    if (!aes_set_impl(GetParam())) skipped_ = true;
+  }
+  void TearDown() override { aes_set_impl(saved_impl_); }
+
+  bool skipped_ = false;
+
+ private:
+  AesImpl saved_impl_;
+};
+
+namespace {
+
+struct CmacVector {
+  std::vector<uint8_t> m;
+  Octet16 aes_cmac_k_m;
+};
+
+// BT Spec 5.0 | Vol 3, Part H D.1, in the spec's big endian order
+const Octet16 kSpecKey{0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+                       0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c};
+
+const std::vector<CmacVector> kSpecCmacVectors = {
+    // D.1.1
+    {{},
+     {0xbb, 0x1d, 0x69, 0x29, 0xe9, 0x59, 0x37, 0x28, 0x7f, 0xa3, 0x7d, 0x12,
+      0x9b, 0x75, 0x67, 0x46}},
+    // D.1.2
+    {{0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96, 0xe9, 0x3d, 0x7e, 0x11,
+      0x73, 0x93, 0x17, 0x2a},
+     {0x07, 0x0a, 0x16, 0xb4, 0x6b, 0x4d, 0x41, 0x44, 0xf7, 0x9b, 0xdd, 0x9d,
+      0xd0, 0x4a, 0x28, 0x7c}},
+    // D.1.3
+    {{0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96, 0xe9, 0x3d,
+      0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a, 0xae, 0x2d, 0x8a, 0x57,
+      0x1e, 0x03, 0xac, 0x9c, 0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf,
+      0x8e, 0x51, 0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11},
+     {0xdf, 0xa6, 0x67, 0x47, 0xde, 0x9a, 0xe6, 0x30, 0x30, 0xca, 0x32, 0x61,
+      0x14, 0x97, 0xc8, 0x27}},
+    // D.1.4
+    {{0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96, 0xe9, 0x3d, 0x7e,
+      0x11, 0x73, 0x93, 0x17, 0x2a, 0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03,
+      0xac, 0x9c, 0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51, 0x30,
+      0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11, 0xe5, 0xfb, 0xc1, 0x19,
+      0x1a, 0x0a, 0x52, 0xef, 0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b,
+      0x17, 0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10},
+     {0x51, 0xf0, 0xbe, 0xbf, 0x7e, 0x3b, 0x9d, 0x92, 0xfc, 0x49, 0x74, 0x17,
+      0x79, 0x36, 0x3c, 0xfe}},
+};
+
+Octet16 reversed(Octet16 x) {
+  std::reverse(x.begin(), x.end());
+  return x;
+}
+
+// Deterministic filler, so a failure reproduces
+Octet16 pattern(uint32_t seed) {
+  Octet16 x;
+  for (uint8_t& b : x) {
+    seed = seed * 1103515245 + 12345;
+    b = seed >> 16;
+  }
+  return x;
+}
+
+}  // namespace
+
+TEST_P(CryptoToolboxImplTest, bt_spec_test_d_1_aes_128) {
+  if (skipped_) return;
+  Octet16 m{};
+  Octet16 aes_128_k_m{0x7d, 0xf7, 0x6b, 0x0c, 0x1a, 0xb8, 0x99, 0xb3,
+                      0x3e, 0x42, 0xf0, 0x47, 0xb9, 0x1b, 0x54, 0x6f};
+
+  EXPECT_EQ(reversed(aes_128_k_m), aes_128(reversed(kSpecKey), m));
+}
+
+TEST_P(CryptoToolboxImplTest, bt_spec_example_d_1_aes_cmac) {
+  if (skipped_) return;
+  for (const CmacVector& v : kSpecCmacVectors) {
+    std::vector<uint8_t> m(v.m.rbegin(), v.m.rend());
+    EXPECT_EQ(reversed(v.aes_cmac_k_m),
+              aes_cmac(reversed(kSpecKey), m.data(), m.size()))
+        << "message length " << m.size();
+  }
+}
+
+// BT Spec 5.0 | Vol 3, Part H D.6, exercising aes_cmac() through h6()
+TEST_P(CryptoToolboxImplTest, bt_spec_example_d_6_h6) {
+  if (skipped_) return;
+  Octet16 key{0xec, 0x02, 0x34, 0xa3, 0x57, 0xc8, 0xad, 0x05,
+              0x34, 0x10, 0x10, 0xa6, 0x0a, 0x39, 0x7d, 0x9b};
+  std::array<uint8_t, 4> keyid{0x6c, 0x65, 0x62, 0x72};
+  Octet16 expected_aes_cmac{0x2d, 0x9a, 0xe1, 0x02, 0xe7, 0x6d, 0xc9, 0x1c,
+                            0xe8, 0xd3, 0xa9, 0xe2, 0x80, 0xb1, 0x63, 0x99};
+
+  std::reverse(std::begin(keyid), std::end(keyid));
+  EXPECT_EQ(reversed(expected_aes_cmac), h6(reversed(key), keyid));
+}
+
+TEST_P(CryptoToolboxImplTest, aes_128_matches_byte_impl) {
+  if (skipped_) return;
+  for (uint32_t i = 0; i < 256; i++) {
+    Octet16 key = pattern(2 * i);
+    Octet16 message = pattern(2 * i + 1);
+    Octet16 output = aes_128(key, message);
+
+    ASSERT_TRUE(aes_set_impl(AesImpl::BYTE));
+    EXPECT_EQ(aes_128(key, message), output) << "block " << i;
+    ASSERT_TRUE(aes_set_impl(GetParam()));
+  }
+}
+
+TEST_P(CryptoToolboxImplTest, aes_cmac_matches_byte_impl) {
+  if (skipped_) return;
+  std::vector<uint8_t> message(100);
+  for (size_t i = 0; i < message.size(); i++) message[i] = i * 7;
+  for (uint16_t length = 0; length <= message.size(); length++) {
+    Octet16 key = pattern(length);
+    Octet16 mac = aes_cmac(key, message.data(), length);
+
+    ASSERT_TRUE(aes_set_impl(AesImpl::BYTE));
+    EXPECT_EQ(aes_cmac(key, message.data(), length), mac)
+        << "length " << length;
+    ASSERT_TRUE(aes_set_impl(GetParam()));
+  }
+}
+
+TEST_P(CryptoToolboxImplTest, aes_128_batch_matches_aes_128) {
+  if (skipped_) return;
+  // Lengths around the interleaving width, including a partial last group
+  for (size_t n = 0; n <= 13; n++) {
+    std::vector<Octet16> keys, messages;
+    for (size_t i = 0; i < n; i++) {
+      keys.push_back(pattern(100 * n + 2 * i));
+      messages.push_back(pattern(100 * n + 2 * i + 1));
+    }
+    std::vector<Octet16> outputs(n);
+    aes_128_batch(keys.data(), messages.data(), outputs.data(), n);
+    for (size_t i = 0; i < n; i++) {
+      EXPECT_EQ(aes_128(keys[i], messages[i]), outputs[i])
+          << "block " << i << " of " << n;
+    }
+  }
+}
+
+INSTANTIATE_TEST_CASE_P(AesImpls, CryptoToolboxImplTest,
+                        ::testing::Values(AesImpl::BYTE, AesImpl::TTABLE,
+                                          AesImpl::AESNI));
+
 }  // namespace crypto_toolbox
@@ -0,0 +1,199 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "stack/gatt/gatt_db_index.h"
+
+#include <gtest/gtest.h>
+#include <list>
+#include <vector>
+
+using bluetooth::Uuid;
+
+namespace {
+
+const Uuid kPrimaryService = Uuid::From16Bit(GATT_UUID_PRI_SERVICE);
+const Uuid kCharDecl = Uuid::From16Bit(GATT_UUID_CHAR_DECLARE);
+const Uuid kCccd = Uuid::From16Bit(GATT_UUID_CHAR_CLIENT_CONFIG);
+const Uuid kHeartRate = Uuid::From16Bit(0x2A37);
+const Uuid kCustom = Uuid::FromString("6e400002-b5a3-f393-e0a9-e50e24dcca9e");
+
+std::vector<uint16_t> handles(GattDbIndex::Range range) {
+  std::vector<uint16_t> result;
+  for (const GattDbIndex::Entry& entry : range) {
+    EXPECT_EQ(entry.handle, entry.p_attr->handle);
+    result.push_back(entry.handle);
+  }
+  return result;
+}
+
+class GattDbIndexTest : public ::testing::Test {
+ protected:
+  // Starts a service at |s_hdl|: a primary service declaration followed by
+  // one attribute of every type in |types|, as GATTS_AddService() would.
+  GattDbIndex::ServiceIterator StartService(uint16_t s_hdl,
+                                            const std::vector<Uuid>& types) {
+    dbs_.emplace_back();
+    tGATT_SVC_DB& db = dbs_.back();
+    uint16_t handle = s_hdl;
+    db.attr_list.emplace_back();
+    db.attr_list.back().handle = handle++;
+    db.attr_list.back().uuid = kPrimaryService;
+    for (const Uuid& type : types) {
+      db.attr_list.emplace_back();
+      db.attr_list.back().handle = handle++;
+      db.attr_list.back().uuid = type;
+    }
+
+    auto it = services_.begin();
+    while (it != services_.end() && it->s_hdl < s_hdl) it++;
+    it = services_.emplace(it);
+    it->s_hdl = s_hdl;
+    it->e_hdl = handle - 1;
+    it->p_db = &db;
+    it->type = GATT_UUID_PRI_SERVICE;
+    index_.AddService(it);
+    return it;
+  }
+
+  void StopService(GattDbIndex::ServiceIterator it) {
+    index_.RemoveService(it);
+    services_.erase(it);
+  }
+
+  GattDbIndex index_;
+  std::list<tGATT_SVC_DB> dbs_;
+  std::list<tGATT_SRV_LIST_ELEM> services_;
+};
+
+}  // namespace
+
+TEST_F(GattDbIndexTest, finds_attributes_by_handle) {
+  auto gap = StartService(20, {kCharDecl, kHeartRate});
+  auto app = StartService(40, {kCharDecl, kHeartRate, kCccd});
+
+  for (uint16_t handle = 20; handle <= 22; handle++) {
+    const GattDbIndex::Entry* entry = index_.Find(handle);
+    ASSERT_NE(nullptr, entry);
+    EXPECT_EQ(&*gap, entry->p_service);
+    EXPECT_EQ(&gap->p_db->attr_list[handle - 20], entry->p_attr);
+  }
+  for (uint16_t handle = 40; handle <= 43; handle++) {
+    const GattDbIndex::Entry* entry = index_.Find(handle);
+    ASSERT_NE(nullptr, entry);
+    EXPECT_EQ(&*app, entry->p_service);
+    EXPECT_EQ(handle, entry->p_attr->handle);
+  }
+
+  EXPECT_EQ(nullptr, index_.Find(0));
+  EXPECT_EQ(nullptr, index_.Find(19));
+  EXPECT_EQ(nullptr, index_.Find(23));
+  EXPECT_EQ(nullptr, index_.Find(44));
+  EXPECT_EQ(nullptr, index_.Find(0xFFFF));
+}
+
+TEST_F(GattDbIndexTest, finds_service_owning_handle) {
+  auto gatt = StartService(1, {kCharDecl, kHeartRate});
+  auto app = StartService(40, {kCharDecl, kHeartRate});
+
+  ASSERT_NE(nullptr, index_.FindService(1));
+  EXPECT_EQ(gatt, *index_.FindService(1));
+  EXPECT_EQ(gatt, *index_.FindService(3));
+  EXPECT_EQ(nullptr, index_.FindService(4));
+  EXPECT_EQ(nullptr, index_.FindService(39));
+  ASSERT_NE(nullptr, index_.FindService(42));
+  EXPECT_EQ(app, *index_.FindService(42));
+  EXPECT_EQ(nullptr, index_.FindService(43));
+  EXPECT_EQ(nullptr, index_.FindService(0));
+}
+
+TEST_F(GattDbIndexTest, range_spans_services_in_handle_order) {
+  // Started out of order, as the GATT and GAP services can be
+  StartService(40, {kCharDecl, kHeartRate});
+  StartService(1, {kCharDecl, kHeartRate});
+  StartService(20, {kCharDecl});
+
+  EXPECT_EQ((std::vector<uint16_t>{1, 2, 3, 20, 21, 40, 41, 42}),
+            handles(index_.Find(1, 0xFFFF)));
+  EXPECT_EQ((std::vector<uint16_t>{3, 20, 21, 40}),
+            handles(index_.Find(3, 40)));
+  EXPECT_EQ((std::vector<uint16_t>{21}), handles(index_.Find(21, 21)));
+  EXPECT_TRUE(index_.Find(4, 19).empty());
+  EXPECT_TRUE(index_.Find(43, 0xFFFF).empty());
+  EXPECT_TRUE(index_.Find(41, 40).empty());
+}
+
+TEST_F(GattDbIndexTest, finds_attributes_by_type_in_range) {
+  StartService(1, {kCharDecl, kHeartRate, kCccd});
+  StartService(20, {kCharDecl, kCustom, kCharDecl, kHeartRate});
+  StartService(40, {kCharDecl, kHeartRate, kCccd});
+
+  EXPECT_EQ((std::vector<uint16_t>{2, 21, 23, 41}),
+            handles(index_.FindByType(kCharDecl, 1, 0xFFFF)));
+  EXPECT_EQ((std::vector<uint16_t>{21, 23}),
+            handles(index_.FindByType(kCharDecl, 3, 40)));
+  EXPECT_EQ((std::vector<uint16_t>{1, 20, 40}),
+            handles(index_.FindByType(kPrimaryService, 1, 0xFFFF)));
+  EXPECT_EQ((std::vector<uint16_t>{22}),
+            handles(index_.FindByType(kCustom, 1, 0xFFFF)));
+  EXPECT_EQ((std::vector<uint16_t>{3, 24, 42}),
+            handles(index_.FindByType(kHeartRate, 1, 0xFFFF)));
+  EXPECT_TRUE(index_.FindByType(kHeartRate, 25, 41).empty());
+  EXPECT_TRUE(index_.FindByType(Uuid::From16Bit(0x2A00), 1, 0xFFFF).empty());
+}
+
+TEST_F(GattDbIndexTest, stopped_service_is_removed) {
+  StartService(1, {kCharDecl, kHeartRate});
+  auto custom = StartService(20, {kCharDecl, kCustom});
+  StartService(40, {kCharDecl, kHeartRate});
+  EXPECT_EQ(3u, index_.num_services());
+  EXPECT_EQ(9u, index_.num_attributes());
+  EXPECT_EQ(4u, index_.num_types());
+
+  StopService(custom);
+  EXPECT_EQ(2u, index_.num_services());
+  EXPECT_EQ(6u, index_.num_attributes());
+  EXPECT_EQ(3u, index_.num_types());
+  EXPECT_EQ(nullptr, index_.Find(21));
+  EXPECT_EQ(nullptr, index_.FindService(21));
+  EXPECT_EQ((std::vector<uint16_t>{1, 2, 3, 40, 41, 42}),
+            handles(index_.Find(1, 0xFFFF)));
+  EXPECT_EQ((std::vector<uint16_t>{2, 41}),
+            handles(index_.FindByType(kCharDecl, 1, 0xFFFF)));
+  EXPECT_TRUE(index_.FindByType(kCustom, 1, 0xFFFF).empty());
+
+  // The freed handles are reused by the next service
+  auto hr = StartService(20, {kCharDecl, kHeartRate, kCccd});
+  EXPECT_EQ((std::vector<uint16_t>{2, 21, 41}),
+            handles(index_.FindByType(kCharDecl, 1, 0xFFFF)));
+  ASSERT_NE(nullptr, index_.Find(23));
+  EXPECT_EQ(&*hr, index_.Find(23)->p_service);
+  EXPECT_EQ(kCccd, index_.Find(23)->p_attr->uuid);
+}
+
+TEST_F(GattDbIndexTest, clear) {
+  StartService(1, {kCharDecl, kHeartRate});
+  StartService(40, {kCharDecl, kHeartRate});
+
+  index_.Clear();
+  EXPECT_EQ(0u, index_.num_services());
+  EXPECT_EQ(0u, index_.num_attributes());
+  EXPECT_EQ(0u, index_.num_types());
+  EXPECT_EQ(nullptr, index_.Find(2));
+  EXPECT_EQ(nullptr, index_.FindService(2));
+  EXPECT_TRUE(index_.FindByType(kCharDecl, 1, 0xFFFF).empty());
+}
@@ -0,0 +1,104 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "stack/l2cap/l2c_fcs.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+namespace {
+
+/* One bit at a time, as in the specification */
+uint16_t ReferenceFcs(uint16_t fcs, const uint8_t* p, size_t len) {
+  while (len--) {
+    fcs ^= *p++;
+    for (int bit = 0; bit < 8; bit++)
+      fcs = (fcs & 1) ? (fcs >> 1) ^ 0xa001 : fcs >> 1;
+  }
+  return fcs;
+}
+
+std::vector<uint8_t> RandomData(size_t len, uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::vector<uint8_t> data(len);
+  for (uint8_t& byte : data) byte = rng();
+  return data;
+}
+
+}  // namespace
+
+TEST(L2cFcsTest, specification_examples) {
+  // I-frame and S-frame of the Core specification, Vol 3, Part A, 3.3.5
+  const uint8_t i_frame[] = {0x0e, 0x00, 0x40, 0x00, 0x02, 0x00, 0x00, 0x01,
+                             0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09};
+  EXPECT_EQ(0x6138, l2c_fcs_update(0, i_frame, sizeof(i_frame)));
+
+  const uint8_t s_frame[] = {0x04, 0x00, 0x40, 0x00, 0x01, 0x01};
+  EXPECT_EQ(0x14d4, l2c_fcs_update(0, s_frame, sizeof(s_frame)));
+
+  const uint8_t check[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+  EXPECT_EQ(0xbb3d, l2c_fcs_update(0, check, sizeof(check)));
+}
+
+TEST(L2cFcsTest, matches_reference_at_every_length_and_alignment) {
+  std::vector<uint8_t> data = RandomData(1100, 1);
+  for (size_t start = 0; start < 8; start++) {
+    for (size_t len = 0; len + start <= data.size();
+         len += (len < 64 ? 1 : 37)) {
+      const uint8_t* p = data.data() + start;
+      ASSERT_EQ(ReferenceFcs(0, p, len), l2c_fcs_update(0, p, len))
+          << "start " << start << " len " << len;
+      ASSERT_EQ(ReferenceFcs(0x1234, p, len), l2c_fcs_update(0x1234, p, len));
+    }
+  }
+}
+
+TEST(L2cFcsTest, incremental) {
+  std::vector<uint8_t> data = RandomData(1000, 2);
+  uint16_t fcs = l2c_fcs_update(0, data.data(), 13);
+  fcs = l2c_fcs_update(fcs, data.data() + 13, 500);
+  fcs = l2c_fcs_update(fcs, data.data() + 513, 487);
+  EXPECT_EQ(ReferenceFcs(0, data.data(), data.size()), fcs);
+}
+
+TEST(L2cFcsTest, update_copy) {
+  std::vector<uint8_t> data = RandomData(1021, 3);
+  for (size_t len : {0, 1, 7, 8, 9, 100, 1021}) {
+    std::vector<uint8_t> copy(len + 1, 0xee);
+    EXPECT_EQ(ReferenceFcs(0, data.data(), len),
+              l2c_fcs_update_copy(0, copy.data(), data.data(), len));
+    EXPECT_TRUE(std::equal(data.begin(), data.begin() + len, copy.begin()));
+    // Nothing written past the end
+    EXPECT_EQ(0xee, copy[len]);
+  }
+}
+
+TEST(L2cFcsTest, combine) {
+  std::vector<uint8_t> data = RandomData(70000, 4);
+  for (size_t head : {0, 1, 6, 8}) {
+    for (size_t len : {0, 1, 2, 3, 8, 255, 1000, 1017, 65535, 69000}) {
+      uint16_t fcs_a = l2c_fcs_update(0, data.data(), head);
+      uint16_t fcs_b = l2c_fcs_update(0, data.data() + head, len);
+      EXPECT_EQ(ReferenceFcs(0, data.data(), head + len),
+                l2c_fcs_combine(fcs_a, fcs_b, len))
+          << "head " << head << " len " << len;
+    }
+  }
+}
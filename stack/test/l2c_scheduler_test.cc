@@ -0,0 +1,281 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "stack/l2cap/l2c_scheduler.h"
+
+#include <gtest/gtest.h>
+
+#include <deque>
+
+namespace {
+
+constexpr size_t kNumLinks = 2;
+constexpr size_t kNumChannels = 8;
+constexpr uint32_t kQuantum = 1000;
+
+/* PDU lengths queued on each channel */
+std::deque<size_t> queues[kNumChannels];
+bool blocked[kNumChannels];
+
+L2cScheduler::State State(size_t channel) {
+  if (queues[channel].empty()) return L2cScheduler::kEmpty;
+  if (blocked[channel]) return L2cScheduler::kBlocked;
+  return L2cScheduler::kReady;
+}
+
+class L2cSchedulerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    for (size_t i = 0; i < kNumChannels; i++) {
+      queues[i].clear();
+      blocked[i] = false;
+    }
+  }
+
+  void Queue(L2cScheduler& scheduler, size_t channel, size_t len,
+             size_t count = 1) {
+    for (size_t i = 0; i < count; i++) queues[channel].push_back(len);
+    scheduler.Wake(channel);
+  }
+
+  /* Sends one PDU of |link|, returns its channel */
+  int Send(L2cScheduler& scheduler, size_t link) {
+    int channel = scheduler.Next(link, State);
+    if (channel == L2cScheduler::kNone) return channel;
+    scheduler.Charge(channel, queues[channel].front());
+    queues[channel].pop_front();
+    return channel;
+  }
+};
+
+}  // namespace
+
+TEST_F(L2cSchedulerTest, nothing_to_send) {
+  L2cScheduler scheduler(kNumLinks, kNumChannels, kQuantum, 0);
+  scheduler.Attach(0, 1, L2cScheduler::kWeighted, 1);
+  EXPECT_EQ(L2cScheduler::kNone, scheduler.Next(0, State));
+
+  // Woken channel with an empty queue leaves the ready list
+  scheduler.Wake(1);
+  EXPECT_EQ(1u, scheduler.ready(0));
+  EXPECT_EQ(L2cScheduler::kNone, scheduler.Next(0, State));
+  EXPECT_EQ(0u, scheduler.ready(0));
+
+  // Detached channels are never woken
+  scheduler.Detach(1);
+  Queue(scheduler, 1, 100);
+  EXPECT_EQ(0u, scheduler.ready(0));
+}
+
+TEST_F(L2cSchedulerTest, bytes_follow_weights) {
+  L2cScheduler scheduler(kNumLinks, kNumChannels, kQuantum, 0);
+  scheduler.Attach(0, 0, L2cScheduler::kWeighted, 1);
+  scheduler.Attach(0, 1, L2cScheduler::kWeighted, 3);
+  // Small PDUs on the light channel, big ones on the heavy one
+  Queue(scheduler, 0, 100, 10000);
+  Queue(scheduler, 1, 900, 10000);
+
+  size_t bytes[2] = {0, 0};
+  for (int i = 0; i < 4000; i++) {
+    int channel = Send(scheduler, 0);
+    ASSERT_NE(L2cScheduler::kNone, channel);
+    bytes[channel] += channel == 0 ? 100 : 900;
+  }
+  double ratio = (double)bytes[1] / bytes[0];
+  EXPECT_NEAR(3.0, ratio, 0.1);
+}
+
+TEST_F(L2cSchedulerTest, links_are_independent) {
+  L2cScheduler scheduler(kNumLinks, kNumChannels, kQuantum, 0);
+  scheduler.Attach(0, 0, L2cScheduler::kWeighted, 1);
+  scheduler.Attach(1, 1, L2cScheduler::kWeighted, 1);
+  Queue(scheduler, 0, 100);
+  Queue(scheduler, 1, 100);
+
+  EXPECT_EQ(1, Send(scheduler, 1));
+  EXPECT_EQ(L2cScheduler::kNone, Send(scheduler, 1));
+  EXPECT_EQ(0, Send(scheduler, 0));
+}
+
+TEST_F(L2cSchedulerTest, strict_channels_go_first) {
+  L2cScheduler scheduler(kNumLinks, kNumChannels, kQuantum, 0);
+  scheduler.Attach(0, 0, L2cScheduler::kWeighted, 8);
+  scheduler.Attach(0, 1, L2cScheduler::kStrict, 1);
+  Queue(scheduler, 0, 100, 10);
+  Queue(scheduler, 1, 600, 5);
+
+  for (int i = 0; i < 5; i++) EXPECT_EQ(1, Send(scheduler, 0));
+  EXPECT_EQ(0, Send(scheduler, 0));
+
+  // Media queued in the middle of a bulk turn goes next
+  Queue(scheduler, 1, 600);
+  EXPECT_EQ(1, Send(scheduler, 0));
+  EXPECT_EQ(0, Send(scheduler, 0));
+  EXPECT_EQ(3000u + 600, scheduler.stats(0).strict_bytes);
+}
+
+TEST_F(L2cSchedulerTest, strict_burst_limit) {
+  L2cScheduler scheduler(kNumLinks, kNumChannels, kQuantum, 4);
+  scheduler.Attach(0, 0, L2cScheduler::kWeighted, 1);
+  scheduler.Attach(0, 1, L2cScheduler::kStrict, 1);
+  Queue(scheduler, 0, 100, 10);
+  Queue(scheduler, 1, 100, 10);
+
+  std::vector<int> order;
+  for (int i = 0; i < 12; i++) order.push_back(Send(scheduler, 0));
+  EXPECT_EQ((std::vector<int>{1, 1, 1, 1, 0, 1, 1, 1, 1, 0, 1, 1}), order);
+  EXPECT_EQ(2u, scheduler.stats(0).burst_breaks);
+}
+
+TEST_F(L2cSchedulerTest, blocked_channels_lose_their_turn) {
+  L2cScheduler scheduler(kNumLinks, kNumChannels, kQuantum, 0);
+  scheduler.Attach(0, 0, L2cScheduler::kWeighted, 1);
+  scheduler.Attach(0, 1, L2cScheduler::kWeighted, 1);
+  scheduler.Attach(0, 2, L2cScheduler::kStrict, 1);
+  Queue(scheduler, 0, 100, 10);
+  Queue(scheduler, 1, 100, 10);
+  Queue(scheduler, 2, 100, 10);
+  blocked[0] = true;
+  blocked[2] = true;
+
+  // Blocked channels stay ready, and are skipped
+  EXPECT_EQ(1, Send(scheduler, 0));
+  EXPECT_EQ(3u, scheduler.ready(0));
+
+  blocked[1] = true;
+  EXPECT_EQ(L2cScheduler::kNone, Send(scheduler, 0));
+
+  blocked[0] = false;
+  EXPECT_EQ(0, Send(scheduler, 0));
+  blocked[2] = false;
+  EXPECT_EQ(2, Send(scheduler, 0));
+}
+
+TEST_F(L2cSchedulerTest, yield_passes_the_turn) {
+  L2cScheduler scheduler(kNumLinks, kNumChannels, kQuantum, 0);
+  scheduler.Attach(0, 0, L2cScheduler::kWeighted, 1);
+  scheduler.Attach(0, 1, L2cScheduler::kWeighted, 1);
+  Queue(scheduler, 0, 100, 10);
+  Queue(scheduler, 1, 100, 10);
+
+  EXPECT_EQ(0, scheduler.Next(0, State));
+  scheduler.Yield(0);
+  EXPECT_EQ(1, scheduler.Next(0, State));
+}
+
+TEST_F(L2cSchedulerTest, configure_moves_between_classes) {
+  L2cScheduler scheduler(kNumLinks, kNumChannels, kQuantum, 0);
+  scheduler.Attach(0, 0, L2cScheduler::kWeighted, 1);
+  scheduler.Attach(0, 1, L2cScheduler::kWeighted, 1);
+  Queue(scheduler, 0, 100, 10);
+  Queue(scheduler, 1, 100, 10);
+
+  scheduler.Configure(1, L2cScheduler::kStrict, 1);
+  EXPECT_EQ(2u, scheduler.ready(0));
+  for (int i = 0; i < 10; i++) EXPECT_EQ(1, Send(scheduler, 0));
+  EXPECT_EQ(0, Send(scheduler, 0));
+}
+
+TEST_F(L2cSchedulerTest, credit_stats) {
+  L2cScheduler scheduler(kNumLinks, kNumChannels, kQuantum, 0);
+  scheduler.CreditsUsed(0, 3);
+  scheduler.CreditsUsed(0, 2);
+  scheduler.CreditsReturned(0, 4);
+  scheduler.CreditsUsed(0, 1);
+  scheduler.Stalled(0);
+
+  const L2cScheduler::LinkStats& stats = scheduler.stats(0);
+  EXPECT_EQ(6u, stats.credits_used);
+  EXPECT_EQ(4u, stats.credits_returned);
+  EXPECT_EQ(2u, stats.credits_in_use);
+  EXPECT_EQ(5u, stats.max_credits_in_use);
+  EXPECT_EQ(1u, stats.stalls);
+
+  // More credits returned than used, after a reset
+  scheduler.ResetStats(0);
+  scheduler.CreditsReturned(0, 2);
+  EXPECT_EQ(0u, scheduler.stats(0).credits_in_use);
+  EXPECT_EQ(0u, scheduler.stats(1).credits_used);
+}
+
+/* A2DP media with RFCOMM and OBEX bulk transfers on the same link. The
+ * controller has a few buffers, and returns one every tick. */
+TEST_F(L2cSchedulerTest, mixed_traffic) {
+  constexpr size_t kMedia = 0, kRfcomm = 1, kObex = 2;
+  constexpr int kTicks = 20000;
+  constexpr int kMediaPeriod = 10;
+  constexpr uint16_t kBuffers = 4;
+
+  L2cScheduler scheduler(kNumLinks, kNumChannels, kQuantum, 8);
+  scheduler.Attach(0, kMedia, L2cScheduler::kStrict, 1);
+  scheduler.Attach(0, kRfcomm, L2cScheduler::kWeighted, 2);
+  scheduler.Attach(0, kObex, L2cScheduler::kWeighted, 1);
+
+  std::deque<int> media_queued_at;
+  int max_media_latency = 0;
+  size_t bytes[3] = {0, 0, 0};
+  uint16_t buffers = kBuffers;
+
+  for (int tick = 0; tick < kTicks; tick++) {
+    if (tick % kMediaPeriod == 0) {
+      Queue(scheduler, kMedia, 660);
+      media_queued_at.push_back(tick);
+    }
+    // Bulk channels always have more to send
+    if (queues[kRfcomm].size() < 4) Queue(scheduler, kRfcomm, 990, 4);
+    if (queues[kObex].size() < 4) Queue(scheduler, kObex, 1021, 4);
+
+    if (buffers < kBuffers) {
+      buffers++;
+      scheduler.CreditsReturned(0, 1);
+    }
+
+    while (buffers > 0) {
+      int channel = scheduler.Next(0, State);
+      if (channel == L2cScheduler::kNone) break;
+      size_t len = queues[channel].front();
+      queues[channel].pop_front();
+      scheduler.Charge(channel, len);
+      bytes[channel] += len;
+      buffers--;
+      scheduler.CreditsUsed(0, 1);
+
+      if (channel == kMedia) {
+        max_media_latency =
+            std::max(max_media_latency, tick - media_queued_at.front());
+        media_queued_at.pop_front();
+      }
+    }
+    if (buffers == 0 && scheduler.ready(0) != 0) scheduler.Stalled(0);
+  }
+
+  // Media goes out in the tick it is queued, and gets all its bandwidth
+  EXPECT_EQ(0, max_media_latency);
+  EXPECT_LE(media_queued_at.size(), 1u);
+  EXPECT_EQ(bytes[kMedia], scheduler.stats(0).strict_bytes);
+
+  // The rest is shared by weight
+  double ratio = (double)bytes[kRfcomm] / bytes[kObex];
+  EXPECT_NEAR(2.0, ratio, 0.05);
+
+  const L2cScheduler::LinkStats& stats = scheduler.stats(0);
+  EXPECT_EQ(bytes[kMedia] + bytes[kRfcomm] + bytes[kObex], stats.bytes);
+  EXPECT_EQ(kBuffers, stats.max_credits_in_use);
+  EXPECT_LE(stats.credits_in_use, kBuffers);
+  EXPECT_GT(stats.stalls, 0u);
+}
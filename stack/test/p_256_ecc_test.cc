@@ -0,0 +1,205 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+#include <random>
+#include <string>
+
+#include "stack/smp/p_256_ecc_pp.h"
+
+namespace {
+
+// |hex| is 64 hex digits, most significant first, as the specifications
+// print them.
+void words_from_hex(uint32_t* w, const char* hex) {
+  std::string s(hex);
+  for (int i = 0; i < KEY_LENGTH_DWORDS_P256; i++) {
+    w[i] = std::stoul(s.substr(56 - 8 * i, 8), nullptr, 16);
+  }
+}
+
+::testing::AssertionResult PointEquals(const char* x, const char* y,
+                                       const Point& p) {
+  uint32_t expected_x[KEY_LENGTH_DWORDS_P256];
+  uint32_t expected_y[KEY_LENGTH_DWORDS_P256];
+  words_from_hex(expected_x, x);
+  words_from_hex(expected_y, y);
+  if (memcmp(expected_x, p.x, sizeof(p.x)) != 0 ||
+      memcmp(expected_y, p.y, sizeof(p.y)) != 0) {
+    return ::testing::AssertionFailure() << "point differs from " << x << ", "
+                                         << y;
+  }
+  return ::testing::AssertionSuccess();
+}
+
+// The existing implementation, which consumes its scalar and sets p->z
+void point_mult_bin_naf(Point* q, const Point& p, const uint32_t* n) {
+  Point p_copy = p;
+  uint32_t n_copy[KEY_LENGTH_DWORDS_P256];
+  memcpy(n_copy, n, sizeof(n_copy));
+  ECC_PointMult_Bin_NAF(q, &p_copy, n_copy, KEY_LENGTH_DWORDS_P256);
+}
+
+const char kGx[] =
+    "6b17d1f2e12c4247f8bce6e563a440f277037d812deb33a0f4a13945d898c296";
+const char kGy[] =
+    "4fe342e2fe1a7f9b8ee7eb4a7c0f9e162bce33576b315ececbb6406837bf51f5";
+
+class P256EccTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    p_256_init_curve(KEY_LENGTH_DWORDS_P256);
+    base_ = curve_p256.G;
+  }
+
+  Point base_;
+};
+
+}  // namespace
+
+// Small multiples and n - 1 of the base point, from the NIST P-256 test data
+TEST_F(P256EccTest, base_point_multiples) {
+  uint32_t n[KEY_LENGTH_DWORDS_P256] = {1};
+  Point q;
+
+  ECC_PointMult_Base(&q, n);
+  EXPECT_TRUE(PointEquals(kGx, kGy, q));
+  ECC_PointMult_Ladder(&q, base_, n);
+  EXPECT_TRUE(PointEquals(kGx, kGy, q));
+
+  const char k2x[] =
+      "7cf27b188d034f7e8a52380304b51ac3c08969e277f21b35a60b48fc47669978";
+  const char k2y[] =
+      "07775510db8ed040293d9ac69f7430dbba7dade63ce982299e04b79d227873d1";
+  n[0] = 2;
+  ECC_PointMult_Base(&q, n);
+  EXPECT_TRUE(PointEquals(k2x, k2y, q));
+  ECC_PointMult_Ladder(&q, base_, n);
+  EXPECT_TRUE(PointEquals(k2x, k2y, q));
+
+  const char k3x[] =
+      "5ecbe4d1a6330a44c8f7ef951d4bf165e6c6b721efada985fb41661bc6e7fd6c";
+  const char k3y[] =
+      "8734640c4998ff7e374b06ce1a64a2ecd82ab036384fb83d9a79b127a27d5032";
+  n[0] = 3;
+  ECC_PointMult_Base(&q, n);
+  EXPECT_TRUE(PointEquals(k3x, k3y, q));
+  ECC_PointMult_Ladder(&q, base_, n);
+  EXPECT_TRUE(PointEquals(k3x, k3y, q));
+
+  // (n - 1) * G = -G
+  const char minus_gy[] =
+      "b01cbd1c01e58065711814b583f061e9d431cca994cea1313449bf97c840ae0a";
+  words_from_hex(
+      n, "ffffffff00000000ffffffffffffffffbce6faada7179e84f3b9cac2fc632550");
+  ECC_PointMult_Base(&q, n);
+  EXPECT_TRUE(PointEquals(kGx, minus_gy, q));
+  ECC_PointMult_Ladder(&q, base_, n);
+  EXPECT_TRUE(PointEquals(kGx, minus_gy, q));
+}
+
+// The P-256 sample data of the Core specification, Vol 3, Part H, 2.3.5.6.1
+TEST_F(P256EccTest, bt_spec_sample_data) {
+  const char private_a[] =
+      "3f49f6d4a3c55f3874c9b3e3d2103f504aff607beb40b7995899b8a6cd3c1abd";
+  const char public_a_x[] =
+      "20b003d2f297be2c5e2c83a7e9f9a5b9eff49111acf4fddbcc0301480e359de6";
+  const char public_a_y[] =
+      "dc809c49652aeb6d63329abf5a52155c766345c28fed3024741c8ed01589d28b";
+  const char private_b[] =
+      "55188b3d32f6bb9a900afcfbeed4e72a59cb9ac2f19d7cfb6b4fdd49f47fc5fd";
+  const char public_b_x[] =
+      "1ea1f0f01faf1d9609592284f19e4c0047b58afd8615a69f559077b22faaa190";
+  const char public_b_y[] =
+      "4c55f33e429dad377356703a9ab85160472d1130e28e36765f89aff915b1214a";
+  const char dhkey[] =
+      "ec0234a357c8ad05341010a60a397d9b99796b13b4f866f1868d34f373bfa698";
+
+  uint32_t a[KEY_LENGTH_DWORDS_P256];
+  uint32_t b[KEY_LENGTH_DWORDS_P256];
+  words_from_hex(a, private_a);
+  words_from_hex(b, private_b);
+
+  Point public_a;
+  Point public_b;
+  ECC_PointMult_Base(&public_a, a);
+  EXPECT_TRUE(PointEquals(public_a_x, public_a_y, public_a));
+  ECC_PointMult_Base(&public_b, b);
+  EXPECT_TRUE(PointEquals(public_b_x, public_b_y, public_b));
+
+  uint32_t expected[KEY_LENGTH_DWORDS_P256];
+  words_from_hex(expected, dhkey);
+  Point shared;
+  ECC_PointMult_Ladder(&shared, public_b, a);
+  EXPECT_EQ(0, memcmp(expected, shared.x, sizeof(expected)));
+  ECC_PointMult_Ladder(&shared, public_a, b);
+  EXPECT_EQ(0, memcmp(expected, shared.x, sizeof(expected)));
+}
+
+TEST_F(P256EccTest, matches_bin_naf) {
+  std::mt19937 rng(256);
+  for (int i = 0; i < 32; i++) {
+    uint32_t k1[KEY_LENGTH_DWORDS_P256];
+    uint32_t k2[KEY_LENGTH_DWORDS_P256];
+    for (uint32_t& w : k1) w = rng();
+    for (uint32_t& w : k2) w = rng();
+
+    Point expected;
+    Point actual;
+    point_mult_bin_naf(&expected, base_, k1);
+    ECC_PointMult_Base(&actual, k1);
+    EXPECT_EQ(0, memcmp(expected.x, actual.x, sizeof(actual.x)));
+    EXPECT_EQ(0, memcmp(expected.y, actual.y, sizeof(actual.y)));
+    EXPECT_TRUE(ECC_ValidatePoint(actual));
+
+    Point peer = actual;
+    point_mult_bin_naf(&expected, peer, k2);
+    ECC_PointMult_Ladder(&actual, peer, k2);
+    EXPECT_EQ(0, memcmp(expected.x, actual.x, sizeof(actual.x)));
+    EXPECT_EQ(0, memcmp(expected.y, actual.y, sizeof(actual.y)));
+  }
+}
+
+// Scalars next to multiples of the group order, where the ladder's co-Z
+// formulas meet equal points and its result is patched in
+TEST_F(P256EccTest, ladder_edge_scalars) {
+  const char* scalars[] = {
+      "0000000000000000000000000000000000000000000000000000000000000001",
+      "0000000000000000000000000000000000000000000000000000000000000002",
+      "ffffffff00000000ffffffffffffffffbce6faada7179e84f3b9cac2fc63254e",
+      "ffffffff00000000ffffffffffffffffbce6faada7179e84f3b9cac2fc63254f",
+      "ffffffff00000000ffffffffffffffffbce6faada7179e84f3b9cac2fc632550",
+      "ffffffff00000000ffffffffffffffffbce6faada7179e84f3b9cac2fc632552",
+      "ffffffff00000000ffffffffffffffffbce6faada7179e84f3b9cac2fc632553",
+      "ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff",
+  };
+  for (const char* scalar : scalars) {
+    uint32_t n[KEY_LENGTH_DWORDS_P256];
+    words_from_hex(n, scalar);
+
+    Point expected;
+    Point actual;
+    ECC_PointMult_Base(&expected, n);
+    ECC_PointMult_Ladder(&actual, base_, n);
+    EXPECT_EQ(0, memcmp(expected.x, actual.x, sizeof(actual.x))) << scalar;
+    EXPECT_EQ(0, memcmp(expected.y, actual.y, sizeof(actual.y))) << scalar;
+    EXPECT_TRUE(ECC_ValidatePoint(actual)) << scalar;
+  }
+}
@@ -0,0 +1,62 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+// Converts a snoop log ring file, kept when persist.bluetooth.btsnoopringsize
+// is set, into a btsnoop file that Wireshark and other tools can read:
+//
+//   adb pull /data/misc/bluetooth/logs/btsnoop_hci.log.ring.last
+//   btsnoop_ring_recover btsnoop_hci.log.ring.last btsnoop_hci.log
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "hci/include/btsnoop_ring.h"
+
+int main(int argc, char** argv) {
+  if (argc != 3) {
+    fprintf(stderr, "Usage: %s <ring file> <btsnoop file>\n", argv[0]);
+    return 1;
+  }
+
+  int ring_fd = open(argv[1], O_RDONLY);
+  if (ring_fd == -1) {
+    fprintf(stderr, "Unable to open %s: %s\n", argv[1], strerror(errno));
+    return 1;
+  }
+
+  int out_fd = open(argv[2], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (out_fd == -1) {
+    fprintf(stderr, "Unable to open %s: %s\n", argv[2], strerror(errno));
+    close(ring_fd);
+    return 1;
+  }
+
+  int records = BtsnoopRing::Recover(ring_fd, out_fd);
+  close(out_fd);
+  close(ring_fd);
+  if (records < 0) {
+    fprintf(stderr, "%s is not a snoop log ring file\n", argv[1]);
+    return 1;
+  }
+
+  printf("Recovered %d records into %s\n", records, argv[2]);
+  return 0;
+}
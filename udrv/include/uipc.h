@@ -47,6 +47,7 @@ typedef enum {
 #define UIPC_REG_CBACK 2
 #define UIPC_REG_REMOVE_ACTIVE_READSET 3
 #define UIPC_SET_READ_POLL_TMO 4
+#define UIPC_GET_FD 5
 
 typedef void(tUIPC_RCV_CBACK)(
     tUIPC_CH_ID ch_id,
@@ -115,6 +116,19 @@ void UIPC_Close(tUIPC_STATE& uipc, tUIPC_CH_ID ch_id);
 bool UIPC_Send(tUIPC_STATE& uipc, tUIPC_CH_ID ch_id, uint16_t msg_evt,
                const uint8_t* p_buf, uint16_t msglen);
 
+/**
+ * Send a message over UIPC, passing file descriptors along with it
+ *
+ * @param ch_id Channel ID
+ * @param p_buf Buffer for the message
+ * @param msglen Message length, at least one byte
+ * @param fds File descriptors to pass; they stay open on this side
+ * @param num_fds Number of file descriptors
+ * @return true on success, otherwise false
+ */
+bool UIPC_SendFds(tUIPC_STATE& uipc, tUIPC_CH_ID ch_id, const uint8_t* p_buf,
+                  uint16_t msglen, const int* fds, size_t num_fds);
+
 /**
  * Read a message from UIPC
  *
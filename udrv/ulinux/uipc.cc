@@ -67,6 +67,9 @@
 
 #define UIPC_FLUSH_BUFFER_SIZE 1024
 
+/* Most file descriptors UIPC_SendFds() passes in one message */
+#define UIPC_MAX_FDS 4
+
 /*****************************************************************************
  *  Local type definitions
  *****************************************************************************/
@@ -608,6 +611,59 @@ bool UIPC_Send(tUIPC_STATE& uipc, tUIPC_CH_ID ch_id,
   return false;
 }
 
+/*******************************************************************************
+ **
+ ** Function         UIPC_SendFds
+ **
+ ** Description      Called to transmit a message over UIPC, with file
+ **                  descriptors attached to it.
+ **
+ ** Returns          true in case of success, false in case of failure.
+ **
+ ******************************************************************************/
+bool UIPC_SendFds(tUIPC_STATE& uipc, tUIPC_CH_ID ch_id, const uint8_t* p_buf,
+                  uint16_t msglen, const int* fds, size_t num_fds) {
+  BTIF_TRACE_DEBUG("UIPC_SendFds : ch_id:%d %d bytes %zu fds", ch_id, msglen,
+                   num_fds);
+
+  if (ch_id >= UIPC_CH_NUM || msglen == 0 || num_fds == 0 ||
+      num_fds > UIPC_MAX_FDS) {
+    BTIF_TRACE_ERROR("UIPC_SendFds : invalid request");
+    return false;
+  }
+
+  std::lock_guard<std::recursive_mutex> lock(uipc.mutex);
+
+  struct iovec iov;
+  iov.iov_base = (void*)p_buf;
+  iov.iov_len = msglen;
+
+  char control_buf[CMSG_SPACE(UIPC_MAX_FDS * sizeof(int))];
+  memset(control_buf, 0, sizeof(control_buf));
+
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control_buf;
+  msg.msg_controllen = CMSG_SPACE(num_fds * sizeof(int));
+
+  struct cmsghdr* header = CMSG_FIRSTHDR(&msg);
+  header->cmsg_level = SOL_SOCKET;
+  header->cmsg_type = SCM_RIGHTS;
+  header->cmsg_len = CMSG_LEN(num_fds * sizeof(int));
+  memcpy(CMSG_DATA(header), fds, num_fds * sizeof(int));
+
+  ssize_t ret;
+  OSI_NO_INTR(ret = sendmsg(uipc.ch[ch_id].fd, &msg, MSG_NOSIGNAL));
+  if (ret != msglen) {
+    BTIF_TRACE_ERROR("failed to send fds (%s)", strerror(errno));
+    return false;
+  }
+
+  return true;
+}
+
 /*******************************************************************************
  **
  ** Function         UIPC_Read
@@ -731,6 +787,10 @@ extern bool UIPC_Ioctl(tUIPC_STATE& uipc, tUIPC_CH_ID ch_id, uint32_t request,
                        uipc.ch[ch_id].read_poll_tmo_ms);
       break;
 
+    case UIPC_GET_FD:
+      *(int*)param = uipc.ch[ch_id].fd;
+      break;
+
     default:
       BTIF_TRACE_EVENT("UIPC_Ioctl : request not handled (%d)", request);
       break;